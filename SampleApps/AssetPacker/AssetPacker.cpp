@@ -0,0 +1,263 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Packs a folder of assets into one archive for the WebView2APISample, which
+// serves assets.pak beside its executable from a memory mapping instead of
+// opening loose files (see AssetArchive.h). Builds on Windows and on POSIX
+// systems.
+//
+// With --gzip, text files are also stored gzipped, under their path with .gz,
+// for the app to answer requests that accept gzip with (see
+// ContentEncoding.h). A file.gz or file.zst beside a file in the folder, as
+// made by the gzip or zstd tools, is stored as that file's variant in the same
+// way.
+//
+// With --domains, it instead builds the app's BlockedDomains.trie from a list
+// of domains, one to a line (see DomainTrie.h).
+
+#include "../WebView2APISample/AssetArchive.h"
+#include "../WebView2APISample/ContentEncoding.h"
+#include "../WebView2APISample/DomainTrie.h"
+#include "../WebView2APISample/MimeTypes.h"
+#include "GzipEncoder.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// Files smaller than this aren't worth compressing.
+static constexpr size_t c_minCompressSize = 256;
+
+static void PrintUsage()
+{
+    fprintf(
+        stderr,
+        "Usage: AssetPacker <folder> <archive> [options]\n"
+        "       AssetPacker --list <archive>\n"
+        "       AssetPacker --domains <list> <trie>\n"
+        "\n"
+        "Packs every file under a folder into an asset archive, or lists the\n"
+        "entries of one. With --domains, builds a blocked domain trie from a\n"
+        "list of domains, one to a line; '#' starts a comment.\n"
+        "\n"
+        "  --root <name>   Put the files under this path in the archive. The\n"
+        "                  default is the folder's name, such as assets.\n"
+        "  --no-hashes     Don't store a hash of each file.\n"
+        "  --gzip          Also store a gzipped variant of each text file.\n");
+}
+
+// The Content-Type to serve a file with, by its extension.
+static std::string GetContentType(const std::filesystem::path& file)
+{
+    std::string_view type = GetMimeTypeForPath(file.filename().string());
+    return type.empty() ? "application/octet-stream" : std::string(type);
+}
+
+// Whether files of a type are worth compressing: text, and the formats that
+// aren't compressed already.
+static bool IsCompressible(std::string_view contentType)
+{
+    for (std::string_view part : {"text/", "javascript", "json", "xml", "wasm"})
+    {
+        if (contentType.find(part) != std::string_view::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// If path ends with the suffix of a coding, the path of the file it is a
+// variant of.
+static bool GetVariantOf(const std::wstring& path, std::wstring* original)
+{
+    for (ContentCoding coding : {ContentCoding::Gzip, ContentCoding::Zstd})
+    {
+        std::wstring_view suffix = GetContentCodingSuffix(coding);
+        if (path.size() > suffix.size() &&
+            path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0)
+        {
+            *original = path.substr(0, path.size() - suffix.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+static int List(const char* archivePath)
+{
+    std::shared_ptr<AssetArchive> archive = AssetArchive::Open(archivePath);
+    if (!archive)
+    {
+        fprintf(stderr, "%s is not an asset archive, or can't be opened.\n", archivePath);
+        return 1;
+    }
+    for (size_t i = 0; i < archive->GetItemCount(); ++i)
+    {
+        AssetArchiveItem item = archive->GetItem(i);
+        printf(
+            "%10zu  %016" PRIx64 "  %-24.*s  %.*s\n", item.size, item.hash,
+            static_cast<int>(item.contentType.size()), item.contentType.data(),
+            static_cast<int>(item.path.size()), item.path.data());
+    }
+    return 0;
+}
+
+static int BuildDomainTrie(const char* listPath, const char* triePath)
+{
+    std::vector<uint8_t> list;
+    if (!AssetCache::LoadFile(std::filesystem::path(listPath).wstring(), &list))
+    {
+        fprintf(stderr, "Can't read %s\n", listPath);
+        return 1;
+    }
+    DomainTrie trie;
+    size_t skipped = 0;
+    std::string_view text(reinterpret_cast<const char*>(list.data()), list.size());
+    while (!text.empty())
+    {
+        size_t end = (std::min)(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix((std::min)(end + 1, text.size()));
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") != std::string_view::npos && !trie.Add(line))
+        {
+            ++skipped;
+        }
+    }
+    if (!trie.Write(triePath))
+    {
+        fprintf(stderr, "Can't write %s\n", triePath);
+        return 1;
+    }
+    printf(
+        "Wrote %zu domains, %zu bytes, to %s; skipped %zu malformed lines.\n",
+        trie.GetDomainCount(), trie.GetMemoryUsage(), triePath, skipped);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--list") == 0)
+    {
+        return List(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "--domains") == 0)
+    {
+        return BuildDomainTrie(argv[2], argv[3]);
+    }
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::filesystem::path folder(argv[1]);
+    std::filesystem::path folderName = folder.lexically_normal();
+    if (!folderName.has_filename())
+    {
+        // As in "assets/".
+        folderName = folderName.parent_path();
+    }
+    std::wstring root = folderName.filename().wstring();
+    bool hashes = true;
+    bool gzip = false;
+    for (int i = 3; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--root") == 0 && hasValue)
+        {
+            root = std::filesystem::path(argv[++i]).wstring();
+        }
+        else if (strcmp(argv[i], "--no-hashes") == 0)
+        {
+            hashes = false;
+        }
+        else if (strcmp(argv[i], "--gzip") == 0)
+        {
+            gzip = true;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator files(folder, error);
+    if (error)
+    {
+        fprintf(stderr, "Can't read %s: %s\n", argv[1], error.message().c_str());
+        return 1;
+    }
+    // The files, by their path in the archive.
+    std::map<std::wstring, std::filesystem::path> paths;
+    for (const std::filesystem::directory_entry& file : files)
+    {
+        if (file.is_regular_file())
+        {
+            paths.emplace(
+                root + L"/" + file.path().lexically_relative(folder).generic_wstring(),
+                file.path());
+        }
+    }
+    AssetArchiveWriter writer;
+    uint64_t totalBytes = 0;
+    size_t variantCount = 0;
+    for (const auto& [path, file] : paths)
+    {
+        std::vector<uint8_t> bytes;
+        if (!AssetCache::LoadFile(file.wstring(), &bytes))
+        {
+            fprintf(stderr, "Can't read %s\n", file.string().c_str());
+            return 1;
+        }
+        // A variant is served with its original's type.
+        std::wstring original;
+        bool isVariant = GetVariantOf(path, &original) && paths.count(original) != 0;
+        std::string contentType = GetContentType(isVariant ? paths.at(original) : file);
+        std::wstring gzipPath = path + std::wstring(GetContentCodingSuffix(ContentCoding::Gzip));
+        if (isVariant)
+        {
+            ++variantCount;
+        }
+        else
+        {
+            totalBytes += bytes.size();
+        }
+        if (!isVariant && gzip && bytes.size() >= c_minCompressSize &&
+            IsCompressible(contentType) && paths.count(gzipPath) == 0)
+        {
+            // Keep the variant only if it saves at least a tenth.
+            std::vector<uint8_t> compressed = GzipCompress(bytes.data(), bytes.size());
+            if (compressed.size() <= bytes.size() - bytes.size() / 10 &&
+                writer.Add(gzipPath, contentType, std::move(compressed)))
+            {
+                ++variantCount;
+            }
+        }
+        if (!writer.Add(path, contentType, std::move(bytes)))
+        {
+            fprintf(
+                stderr, "%s can't be added; is its name a duplicate?\n", file.string().c_str());
+            return 1;
+        }
+    }
+    if (!writer.Write(argv[2], hashes))
+    {
+        fprintf(stderr, "Can't write %s\n", argv[2]);
+        return 1;
+    }
+    printf(
+        "Packed %zu files, %" PRIu64 " bytes, with %zu compressed variants, into %s\n",
+        writer.GetItemCount() - variantCount, totalBytes, variantCount, argv[2]);
+    return 0;
+}
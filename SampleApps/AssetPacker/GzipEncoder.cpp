@@ -0,0 +1,664 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "GzipEncoder.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+constexpr uint32_t c_windowSize = 32768;
+constexpr uint32_t c_hashBits = 15;
+constexpr uint32_t c_minMatch = 3;
+constexpr uint32_t c_maxMatch = 258;
+// How many earlier positions with the same hash are tried for each match.
+constexpr uint32_t c_maxChain = 128;
+// A match this long is taken without checking for a longer one a byte later.
+constexpr uint32_t c_niceMatch = 128;
+// A 3-byte match further back than this costs more than three literals.
+constexpr uint32_t c_maxShortMatchDistance = 4096;
+constexpr size_t c_blockTokens = 16384;
+constexpr size_t c_maxStoredBlock = 65535;
+
+constexpr uint32_t c_literalCodes = 288;
+constexpr uint32_t c_usedLiteralCodes = 286;
+constexpr uint32_t c_endOfBlock = 256;
+constexpr uint32_t c_distanceCodes = 30;
+constexpr uint32_t c_codeLengthCodes = 19;
+constexpr uint32_t c_maxCodeLength = 15;
+constexpr uint32_t c_maxCodeLengthCodeLength = 7;
+constexpr uint8_t c_codeLengthOrder[c_codeLengthCodes] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// A literal byte, or a match of length bytes distance bytes back.
+struct Token
+{
+    uint16_t value;
+    // 0 for a literal.
+    uint16_t distance;
+};
+
+// A length or distance code and its extra bits.
+struct Code
+{
+    uint32_t code;
+    uint32_t extraBitCount;
+    uint32_t extraBits;
+};
+
+uint32_t FloorLog2(uint32_t value)
+{
+    uint32_t log = 0;
+    while (value >>= 1)
+    {
+        ++log;
+    }
+    return log;
+}
+
+// Codes 257 to 285: four codes for each number of extra bits from 1 to 5,
+// after eight without, and 285 for 258 alone.
+Code GetLengthCode(uint32_t length)
+{
+    uint32_t offset = length - c_minMatch;
+    if (offset < 8)
+    {
+        return {257 + offset, 0, 0};
+    }
+    if (length == c_maxMatch)
+    {
+        return {285, 0, 0};
+    }
+    uint32_t log = FloorLog2(offset);
+    return {257 + 4 * (log - 1) + ((offset >> (log - 2)) & 3), log - 2,
+            offset & ((1u << (log - 2)) - 1)};
+}
+
+// Codes 0 to 29: two codes for each number of extra bits from 1 to 13, after
+// four without.
+Code GetDistanceCode(uint32_t distance)
+{
+    uint32_t offset = distance - 1;
+    if (offset < 4)
+    {
+        return {offset, 0, 0};
+    }
+    uint32_t log = FloorLog2(offset);
+    return {2 * log + ((offset >> (log - 1)) & 1), log - 1, offset & ((1u << (log - 1)) - 1)};
+}
+
+uint32_t GetLengthExtraBitCount(uint32_t code)
+{
+    return code < 265 || code == 285 ? 0 : (code - 261) / 4;
+}
+
+uint32_t GetDistanceExtraBitCount(uint32_t code)
+{
+    return code < 4 ? 0 : code / 2 - 1;
+}
+
+// Set the length of each symbol's code by its frequency, at most maxLength.
+// Unused symbols get 0.
+void BuildCodeLengths(
+    const uint32_t* frequencies, uint32_t count, uint32_t maxLength, uint8_t* lengths)
+{
+    std::fill(lengths, lengths + count, uint8_t(0));
+    std::vector<uint32_t> symbols;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (frequencies[i] != 0)
+        {
+            symbols.push_back(i);
+        }
+    }
+    if (symbols.size() <= 1)
+    {
+        if (!symbols.empty())
+        {
+            lengths[symbols[0]] = 1;
+        }
+        return;
+    }
+    std::stable_sort(
+        symbols.begin(), symbols.end(),
+        [frequencies](uint32_t a, uint32_t b) { return frequencies[a] < frequencies[b]; });
+
+    // Huffman's algorithm with two queues: the sorted leaves, and the internal
+    // nodes, which are made in order of weight.
+    size_t leafCount = symbols.size();
+    std::vector<uint64_t> weights(2 * leafCount - 1);
+    std::vector<size_t> parents(2 * leafCount - 1);
+    for (size_t i = 0; i < leafCount; ++i)
+    {
+        weights[i] = frequencies[symbols[i]];
+    }
+    size_t nextLeaf = 0;
+    size_t nextNode = leafCount;
+    for (size_t node = leafCount; node < weights.size(); ++node)
+    {
+        size_t children[2];
+        for (size_t& child : children)
+        {
+            if (nextLeaf < leafCount &&
+                (nextNode >= node || weights[nextLeaf] <= weights[nextNode]))
+            {
+                child = nextLeaf++;
+            }
+            else
+            {
+                child = nextNode++;
+            }
+        }
+        weights[node] = weights[children[0]] + weights[children[1]];
+        parents[children[0]] = node;
+        parents[children[1]] = node;
+    }
+    // Parents come after their children, so depths can be set root first.
+    std::vector<uint32_t> depths(weights.size());
+    std::vector<uint32_t> lengthCounts(maxLength + 1);
+    for (size_t node = weights.size() - 1; node-- > 0;)
+    {
+        depths[node] = depths[parents[node]] + 1;
+        if (node < leafCount)
+        {
+            ++lengthCounts[(std::min)(depths[node], maxLength)];
+        }
+    }
+
+    // Codes that were too long were cut to maxLength above, which leaves too
+    // many codes for the lengths. Lengthen the longest shorter code for each
+    // excess code until the lengths are a complete prefix code, as miniz does.
+    uint64_t total = 0;
+    for (uint32_t length = 1; length <= maxLength; ++length)
+    {
+        total += uint64_t(lengthCounts[length]) << (maxLength - length);
+    }
+    while (total > (uint64_t(1) << maxLength))
+    {
+        --lengthCounts[maxLength];
+        for (uint32_t length = maxLength - 1; length > 0; --length)
+        {
+            if (lengthCounts[length] != 0)
+            {
+                --lengthCounts[length];
+                lengthCounts[length + 1] += 2;
+                break;
+            }
+        }
+        --total;
+    }
+
+    // The most frequent symbols get the shortest codes.
+    size_t symbol = leafCount;
+    for (uint32_t length = 1; length <= maxLength; ++length)
+    {
+        for (uint32_t i = 0; i < lengthCounts[length]; ++i)
+        {
+            lengths[symbols[--symbol]] = static_cast<uint8_t>(length);
+        }
+    }
+}
+
+// The canonical codes for the lengths, bit-reversed, since DEFLATE writes
+// Huffman codes from their most significant bit into an LSB-first stream.
+void BuildCodes(const uint8_t* lengths, uint32_t count, uint16_t* codes)
+{
+    uint32_t lengthCounts[c_maxCodeLength + 1] = {};
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ++lengthCounts[lengths[i]];
+    }
+    lengthCounts[0] = 0;
+    uint32_t nextCodes[c_maxCodeLength + 1] = {};
+    uint32_t code = 0;
+    for (uint32_t length = 1; length <= c_maxCodeLength; ++length)
+    {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCodes[length] = code;
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t length = lengths[i];
+        if (length == 0)
+        {
+            codes[i] = 0;
+            continue;
+        }
+        uint32_t value = nextCodes[length]++;
+        uint32_t reversed = 0;
+        for (uint32_t bit = 0; bit < length; ++bit)
+        {
+            reversed = (reversed << 1) | ((value >> bit) & 1);
+        }
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+}
+
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>* out) : m_out(out) {}
+
+    // Write the low count bits of bits, least significant first.
+    void Write(uint32_t bits, uint32_t count)
+    {
+        m_bits |= uint64_t(bits) << m_count;
+        m_count += count;
+        while (m_count >= 8)
+        {
+            m_out->push_back(static_cast<uint8_t>(m_bits));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void AlignToByte()
+    {
+        if (m_count > 0)
+        {
+            Write(0, 8 - m_count);
+        }
+    }
+
+private:
+    std::vector<uint8_t>* m_out;
+    uint64_t m_bits = 0;
+    uint32_t m_count = 0;
+};
+
+// The codes that one block is written with.
+struct BlockCodes
+{
+    uint8_t literalLengths[c_literalCodes] = {};
+    uint16_t literalCodes[c_literalCodes] = {};
+    uint8_t distanceLengths[c_distanceCodes] = {};
+    uint16_t distanceCodes[c_distanceCodes] = {};
+};
+
+class DeflateEncoder
+{
+public:
+    DeflateEncoder(const uint8_t* data, size_t size, std::vector<uint8_t>* out)
+        : m_data(data), m_size(size), m_writer(out), m_head(size_t(1) << c_hashBits, -1),
+          m_previous(c_windowSize, -1)
+    {
+        // The fixed codes of RFC 1951 3.2.6.
+        for (uint32_t i = 0; i < c_literalCodes; ++i)
+        {
+            m_fixed.literalLengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        }
+        std::fill(m_fixed.distanceLengths, m_fixed.distanceLengths + c_distanceCodes, uint8_t(5));
+        BuildCodes(m_fixed.literalLengths, c_literalCodes, m_fixed.literalCodes);
+        BuildCodes(m_fixed.distanceLengths, c_distanceCodes, m_fixed.distanceCodes);
+    }
+
+    void Encode()
+    {
+        size_t position = 0;
+        size_t blockStart = 0;
+        while (position < m_size)
+        {
+            uint32_t distance = 0;
+            uint32_t length = FindMatch(position, &distance);
+            Insert(position);
+            // Lazy matching: a longer match a byte later is worth a literal.
+            if (length != 0 && length < c_niceMatch && position + 1 < m_size)
+            {
+                uint32_t nextDistance = 0;
+                if (FindMatch(position + 1, &nextDistance) > length)
+                {
+                    length = 0;
+                }
+            }
+            if (length != 0)
+            {
+                m_tokens.push_back(
+                    {static_cast<uint16_t>(length), static_cast<uint16_t>(distance)});
+                for (size_t i = 1; i < length; ++i)
+                {
+                    Insert(position + i);
+                }
+                position += length;
+            }
+            else
+            {
+                m_tokens.push_back({m_data[position], 0});
+                ++position;
+            }
+            if (m_tokens.size() >= c_blockTokens)
+            {
+                WriteBlock(blockStart, position, false);
+                blockStart = position;
+            }
+        }
+        WriteBlock(blockStart, position, true);
+        m_writer.AlignToByte();
+    }
+
+private:
+    uint32_t Hash(size_t position) const
+    {
+        uint32_t bytes = m_data[position] | (m_data[position + 1] << 8) |
+                         (m_data[position + 2] << 16);
+        return (bytes * 2654435761u) >> (32 - c_hashBits);
+    }
+
+    void Insert(size_t position)
+    {
+        if (position + c_minMatch <= m_size)
+        {
+            uint32_t hash = Hash(position);
+            m_previous[position % c_windowSize] = m_head[hash];
+            m_head[hash] = static_cast<int64_t>(position);
+        }
+    }
+
+    // The length of the longest match for the bytes at position, or 0.
+    uint32_t FindMatch(size_t position, uint32_t* distance) const
+    {
+        if (position + c_minMatch > m_size)
+        {
+            return 0;
+        }
+        uint32_t limit = static_cast<uint32_t>((std::min)(size_t(c_maxMatch), m_size - position));
+        const uint8_t* current = m_data + position;
+        uint32_t best = 0;
+        int64_t candidate = m_head[Hash(position)];
+        // Every position in the window is still in the chains, since a slot of
+        // m_previous is only reused for a position a window later.
+        for (uint32_t chain = 0; chain < c_maxChain && candidate >= 0 &&
+                                 position - static_cast<size_t>(candidate) <= c_windowSize;
+             ++chain)
+        {
+            const uint8_t* match = m_data + candidate;
+            if (match[best] == current[best] && match[0] == current[0])
+            {
+                uint32_t length = 0;
+                while (length < limit && match[length] == current[length])
+                {
+                    ++length;
+                }
+                if (length > best)
+                {
+                    best = length;
+                    *distance = static_cast<uint32_t>(position - static_cast<size_t>(candidate));
+                    if (length == limit)
+                    {
+                        break;
+                    }
+                }
+            }
+            candidate = m_previous[candidate % c_windowSize];
+        }
+        if (best < c_minMatch || (best == c_minMatch && *distance > c_maxShortMatchDistance))
+        {
+            return 0;
+        }
+        return best;
+    }
+
+    // The bits the block's tokens take with the given code lengths.
+    uint64_t GetDataBitCount(const uint8_t* literalLengths, const uint8_t* distanceLengths) const
+    {
+        uint64_t bits = 0;
+        for (uint32_t code = 0; code < c_usedLiteralCodes; ++code)
+        {
+            bits += uint64_t(m_literalFrequencies[code]) *
+                    (literalLengths[code] + GetLengthExtraBitCount(code));
+        }
+        for (uint32_t code = 0; code < c_distanceCodes; ++code)
+        {
+            bits += uint64_t(m_distanceFrequencies[code]) *
+                    (distanceLengths[code] + GetDistanceExtraBitCount(code));
+        }
+        return bits;
+    }
+
+    void WriteBlock(size_t byteStart, size_t byteEnd, bool final)
+    {
+        std::fill(std::begin(m_literalFrequencies), std::end(m_literalFrequencies), 0u);
+        std::fill(std::begin(m_distanceFrequencies), std::end(m_distanceFrequencies), 0u);
+        for (const Token& token : m_tokens)
+        {
+            if (token.distance == 0)
+            {
+                ++m_literalFrequencies[token.value];
+            }
+            else
+            {
+                ++m_literalFrequencies[GetLengthCode(token.value).code];
+                ++m_distanceFrequencies[GetDistanceCode(token.distance).code];
+            }
+        }
+        m_literalFrequencies[c_endOfBlock] = 1;
+
+        BlockCodes dynamic;
+        BuildCodeLengths(
+            m_literalFrequencies, c_usedLiteralCodes, c_maxCodeLength, dynamic.literalLengths);
+        BuildCodeLengths(
+            m_distanceFrequencies, c_distanceCodes, c_maxCodeLength, dynamic.distanceLengths);
+        // The distance code has at least one length, even when it is unused.
+        if (std::all_of(
+                dynamic.distanceLengths, dynamic.distanceLengths + c_distanceCodes,
+                [](uint8_t length) { return length == 0; }))
+        {
+            dynamic.distanceLengths[0] = 1;
+        }
+        BuildCodes(dynamic.literalLengths, c_literalCodes, dynamic.literalCodes);
+        BuildCodes(dynamic.distanceLengths, c_distanceCodes, dynamic.distanceCodes);
+
+        // The code lengths, run-length encoded with codes 16 to 18.
+        uint32_t literalCount = c_usedLiteralCodes;
+        while (literalCount > 257 && dynamic.literalLengths[literalCount - 1] == 0)
+        {
+            --literalCount;
+        }
+        uint32_t distanceCount = c_distanceCodes;
+        while (distanceCount > 1 && dynamic.distanceLengths[distanceCount - 1] == 0)
+        {
+            --distanceCount;
+        }
+        std::vector<uint8_t> lengths(
+            dynamic.literalLengths, dynamic.literalLengths + literalCount);
+        lengths.insert(
+            lengths.end(), dynamic.distanceLengths, dynamic.distanceLengths + distanceCount);
+        // Pairs of code length code and extra bits.
+        std::vector<std::pair<uint8_t, uint8_t>> runs;
+        for (size_t i = 0; i < lengths.size();)
+        {
+            uint8_t length = lengths[i];
+            size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == length)
+            {
+                ++run;
+            }
+            i += run;
+            if (length == 0)
+            {
+                while (run >= 11)
+                {
+                    size_t count = (std::min)(run, size_t(138));
+                    runs.push_back({18, static_cast<uint8_t>(count - 11)});
+                    run -= count;
+                }
+                if (run >= 3)
+                {
+                    runs.push_back({17, static_cast<uint8_t>(run - 3)});
+                    run = 0;
+                }
+            }
+            else
+            {
+                runs.push_back({length, 0});
+                --run;
+                while (run >= 3)
+                {
+                    size_t count = (std::min)(run, size_t(6));
+                    runs.push_back({16, static_cast<uint8_t>(count - 3)});
+                    run -= count;
+                }
+            }
+            for (; run > 0; --run)
+            {
+                runs.push_back({length, 0});
+            }
+        }
+        uint32_t codeLengthFrequencies[c_codeLengthCodes] = {};
+        for (const auto& run : runs)
+        {
+            ++codeLengthFrequencies[run.first];
+        }
+        uint8_t codeLengthLengths[c_codeLengthCodes];
+        uint16_t codeLengthCodes[c_codeLengthCodes];
+        BuildCodeLengths(
+            codeLengthFrequencies, c_codeLengthCodes, c_maxCodeLengthCodeLength,
+            codeLengthLengths);
+        BuildCodes(codeLengthLengths, c_codeLengthCodes, codeLengthCodes);
+        uint32_t codeLengthCount = c_codeLengthCodes;
+        while (codeLengthCount > 4 &&
+               codeLengthLengths[c_codeLengthOrder[codeLengthCount - 1]] == 0)
+        {
+            --codeLengthCount;
+        }
+
+        static const uint8_t c_runExtraBitCounts[3] = {2, 3, 7};
+        uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount +
+                               GetDataBitCount(dynamic.literalLengths, dynamic.distanceLengths);
+        for (const auto& run : runs)
+        {
+            dynamicBits += codeLengthLengths[run.first] +
+                           (run.first >= 16 ? c_runExtraBitCounts[run.first - 16] : 0);
+        }
+        uint64_t fixedBits =
+            3 + GetDataBitCount(m_fixed.literalLengths, m_fixed.distanceLengths);
+        size_t byteCount = byteEnd - byteStart;
+        size_t storedBlocks =
+            (std::max)(size_t(1), (byteCount + c_maxStoredBlock - 1) / c_maxStoredBlock);
+        uint64_t storedBits = storedBlocks * (3 + 7 + 32) + uint64_t(byteCount) * 8;
+
+        if (storedBits < dynamicBits && storedBits < fixedBits)
+        {
+            for (size_t block = 0; block < storedBlocks; ++block)
+            {
+                size_t start = byteStart + block * c_maxStoredBlock;
+                size_t count = (std::min)(c_maxStoredBlock, byteEnd - start);
+                m_writer.Write(final && block + 1 == storedBlocks ? 1 : 0, 1);
+                m_writer.Write(0, 2);
+                m_writer.AlignToByte();
+                m_writer.Write(static_cast<uint32_t>(count), 16);
+                m_writer.Write(static_cast<uint32_t>(~count & 0xFFFF), 16);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    m_writer.Write(m_data[start + i], 8);
+                }
+            }
+        }
+        else if (fixedBits <= dynamicBits)
+        {
+            m_writer.Write(final ? 1 : 0, 1);
+            m_writer.Write(1, 2);
+            WriteTokens(m_fixed);
+        }
+        else
+        {
+            m_writer.Write(final ? 1 : 0, 1);
+            m_writer.Write(2, 2);
+            m_writer.Write(literalCount - 257, 5);
+            m_writer.Write(distanceCount - 1, 5);
+            m_writer.Write(codeLengthCount - 4, 4);
+            for (uint32_t i = 0; i < codeLengthCount; ++i)
+            {
+                m_writer.Write(codeLengthLengths[c_codeLengthOrder[i]], 3);
+            }
+            for (const auto& run : runs)
+            {
+                m_writer.Write(codeLengthCodes[run.first], codeLengthLengths[run.first]);
+                if (run.first >= 16)
+                {
+                    m_writer.Write(run.second, c_runExtraBitCounts[run.first - 16]);
+                }
+            }
+            WriteTokens(dynamic);
+        }
+        m_tokens.clear();
+    }
+
+    void WriteTokens(const BlockCodes& codes)
+    {
+        for (const Token& token : m_tokens)
+        {
+            if (token.distance == 0)
+            {
+                m_writer.Write(codes.literalCodes[token.value], codes.literalLengths[token.value]);
+                continue;
+            }
+            Code length = GetLengthCode(token.value);
+            m_writer.Write(codes.literalCodes[length.code], codes.literalLengths[length.code]);
+            m_writer.Write(length.extraBits, length.extraBitCount);
+            Code distance = GetDistanceCode(token.distance);
+            m_writer.Write(
+                codes.distanceCodes[distance.code], codes.distanceLengths[distance.code]);
+            m_writer.Write(distance.extraBits, distance.extraBitCount);
+        }
+        m_writer.Write(codes.literalCodes[c_endOfBlock], codes.literalLengths[c_endOfBlock]);
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    BitWriter m_writer;
+    // The last position with each hash, and for each position in the window
+    // the one before it with the same hash; -1 for none.
+    std::vector<int64_t> m_head;
+    std::vector<int64_t> m_previous;
+    std::vector<Token> m_tokens;
+    uint32_t m_literalFrequencies[c_usedLiteralCodes] = {};
+    uint32_t m_distanceFrequencies[c_distanceCodes] = {};
+    BlockCodes m_fixed;
+};
+
+void WriteUint32(std::vector<uint8_t>* out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+} // namespace
+
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = []
+    {
+        std::array<uint32_t, 256> entries = {};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::vector<uint8_t> GzipCompress(const uint8_t* data, size_t size)
+{
+    // No file name or modification time, so that a build is reproducible; the
+    // operating system is unknown.
+    std::vector<uint8_t> out = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255};
+    out.reserve(size / 2 + 64);
+    DeflateEncoder(data, size, &out).Encode();
+    WriteUint32(&out, UpdateCrc32(0, data, size));
+    WriteUint32(&out, static_cast<uint32_t>(size));
+    return out;
+}
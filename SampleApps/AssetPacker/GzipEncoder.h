@@ -0,0 +1,21 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compresses data into a gzip file (RFC 1952) for AssetPacker to store beside
+// the original as a precompressed variant.
+//
+// The DEFLATE stream (RFC 1951) is made with LZ77 over hash chains, with lazy
+// matching, and each block is written with whichever of dynamic Huffman codes,
+// the fixed codes or no compression is smallest. This is about what zlib does
+// at its default level; it is slower, but only runs at build time.
+std::vector<uint8_t> GzipCompress(const uint8_t* data, size_t size);
+
+// The CRC-32 that gzip stores, of the bytes, continuing from crc.
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* data, size_t size);
@@ -0,0 +1,237 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Examines an event trace written by the WebView2APISample event monitor.
+// Only the events that are printed are read from the file, so a trace of any
+// size can be filtered quickly. Builds on Windows and on POSIX systems.
+
+#include "../WebView2APISample/EventTrace.h"
+#include "../WebView2APISample/MonitorEvent.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+static void PrintUsage()
+{
+    fprintf(
+        stderr,
+        "Usage: EventTraceTool <trace file> [options]\n"
+        "\n"
+        "Lists the events in an event monitor trace, one per line.\n"
+        "\n"
+        "  --kind <name>   Only events of this kind, such as NavigationStarting.\n"
+        "                  May be given more than once.\n"
+        "  --uri <pattern> Only events whose URI matches. * matches any run of\n"
+        "                  characters and ? any one character.\n"
+        "  --from <n>      Start at the event with sequence number n.\n"
+        "  --count <n>     Stop after n matching events.\n"
+        "  --json          Write the matching events as a JSON array.\n"
+        "  --summary       Only print the number of events of each kind.\n");
+}
+
+// Returns MonitorEventKind::Count if name isn't a known kind.
+static MonitorEventKind ParseKind(const char* name)
+{
+    for (uint16_t kind = 0; kind < static_cast<uint16_t>(MonitorEventKind::Count); ++kind)
+    {
+        const wchar_t* kindName = MonitorEventKindToString(static_cast<MonitorEventKind>(kind));
+        size_t i = 0;
+        // Kind names are ASCII.
+        while (kindName[i] != L'\0' && static_cast<wchar_t>(name[i]) == kindName[i])
+        {
+            ++i;
+        }
+        if (kindName[i] == L'\0' && name[i] == '\0')
+        {
+            return static_cast<MonitorEventKind>(kind);
+        }
+    }
+    return MonitorEventKind::Count;
+}
+
+static std::string KindToString(uint16_t kind)
+{
+    const wchar_t* kindName = kind < static_cast<uint16_t>(MonitorEventKind::Count)
+                                  ? MonitorEventKindToString(static_cast<MonitorEventKind>(kind))
+                                  : L"Unknown";
+    return std::string(kindName, kindName + wcslen(kindName));
+}
+
+// Glob match with * and ?, without backtracking more than one star.
+static bool MatchesPattern(std::string_view text, std::string_view pattern)
+{
+    size_t t = 0;
+    size_t p = 0;
+    size_t starPattern = std::string_view::npos;
+    size_t starText = 0;
+    while (t < text.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t]))
+        {
+            ++t;
+            ++p;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            starPattern = p++;
+            starText = t;
+        }
+        else if (starPattern != std::string_view::npos)
+        {
+            p = starPattern + 1;
+            t = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<bool> kinds;
+    const char* uriPattern = nullptr;
+    uint64_t from = 0;
+    uint64_t count = UINT64_MAX;
+    bool json = false;
+    bool summary = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--kind") == 0 && hasValue)
+        {
+            MonitorEventKind kind = ParseKind(argv[++i]);
+            if (kind == MonitorEventKind::Count)
+            {
+                fprintf(stderr, "Unknown event kind: %s\n", argv[i]);
+                return 2;
+            }
+            kinds.resize(static_cast<size_t>(MonitorEventKind::Count));
+            kinds[static_cast<size_t>(kind)] = true;
+        }
+        else if (strcmp(argv[i], "--uri") == 0 && hasValue)
+        {
+            uriPattern = argv[++i];
+        }
+        else if (strcmp(argv[i], "--from") == 0 && hasValue)
+        {
+            from = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--count") == 0 && hasValue)
+        {
+            count = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--summary") == 0)
+        {
+            summary = true;
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    json = json && !summary;
+
+    EventTraceReader reader;
+    if (!reader.Open(argv[1]))
+    {
+        fprintf(stderr, "%s is not an event trace, or can't be opened.\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint64_t> kindCounts(static_cast<size_t>(MonitorEventKind::Count) + 1);
+    uint64_t offset = reader.Seek(from);
+    uint64_t printed = 0;
+    int64_t firstTimestamp = 0;
+    EventTraceEntry entry;
+    if (json)
+    {
+        printf("[\n");
+    }
+    while (printed < count && reader.Next(&offset, &entry))
+    {
+        if (entry.event.sequence < from)
+        {
+            continue;
+        }
+        if (!kinds.empty() && (entry.event.kind >= kinds.size() || !kinds[entry.event.kind]))
+        {
+            continue;
+        }
+        if (uriPattern && !MatchesPattern(entry.uri, uriPattern))
+        {
+            continue;
+        }
+
+        if (printed == 0)
+        {
+            firstTimestamp = entry.event.timestamp;
+        }
+        if (summary)
+        {
+            ++kindCounts[(std::min)(
+                size_t(entry.event.kind), static_cast<size_t>(MonitorEventKind::Count))];
+        }
+        else if (json)
+        {
+            printf(
+                "%s%.*s", printed == 0 ? "" : ",\n", static_cast<int>(entry.json.size()),
+                entry.json.data());
+        }
+        else
+        {
+            // Sequence number, milliseconds since the first printed event, kind, URI.
+            printf(
+                "%llu\t%.3f\t%s\t%.*s\n", static_cast<unsigned long long>(entry.event.sequence),
+                (entry.event.timestamp - firstTimestamp) / 1000.0,
+                KindToString(entry.event.kind).c_str(), static_cast<int>(entry.uri.size()),
+                entry.uri.data());
+        }
+        ++printed;
+    }
+    if (json)
+    {
+        printf("%s]\n", printed == 0 ? "" : "\n");
+    }
+
+    if (summary)
+    {
+        for (size_t kind = 0; kind < kindCounts.size(); ++kind)
+        {
+            if (kindCounts[kind] != 0)
+            {
+                printf(
+                    "%s\t%llu\n", KindToString(static_cast<uint16_t>(kind)).c_str(),
+                    static_cast<unsigned long long>(kindCounts[kind]));
+            }
+        }
+        printf(
+            "Total\t%llu of %llu\n", static_cast<unsigned long long>(printed),
+            static_cast<unsigned long long>(reader.GetEventCount()));
+    }
+    return 0;
+}
@@ -10,21 +10,27 @@
 #include "AppStartPage.h"
 #include "AppWindow.h"
 #include "CheckFailure.h"
+#include "Url.h"
 
 using namespace Microsoft::WRL;
 
 namespace AppStartPage
 {
 
-bool AreFileUrisEqual(std::wstring leftUri, std::wstring rightUri)
+bool AreFileUrisEqual(std::wstring_view leftUri, std::wstring_view rightUri)
 {
-    // Have to to lower due to current bug
-    std::transform(leftUri.begin(), leftUri.end(),
-            leftUri.begin(), ::tolower);
-    std::transform(rightUri.begin(), rightUri.end(),
-            rightUri.begin(), ::tolower);
-
-    return leftUri == rightUri;
+    // Both are parsed, so that they are compared as the WebView serializes them,
+    // and compared without case, as Windows paths are.
+    Url left;
+    Url right;
+    if (!left.Parse(leftUri) || !right.Parse(rightUri))
+    {
+        return false;
+    }
+    return std::equal(
+        left.GetHref().begin(), left.GetHref().end(), right.GetHref().begin(),
+        right.GetHref().end(),
+        [](char a, char b) { return ::tolower(a) == ::tolower(b); });
 }
 
 std::wstring ResolvePathAndTrimFile(std::wstring path)
@@ -10,9 +10,9 @@
 #include <ShObjIdl_core.h>
 #include <Shellapi.h>
 #include <ShlObj_core.h>
+#include <algorithm>
 #include <functional>
 #include <iostream>
-#include <regex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -20,6 +20,7 @@
 
 #include "App.h"
 #include "AppStartPage.h"
+#include "AssetComStream.h"
 #include "AudioComponent.h"
 #include "CheckFailure.h"
 #include "ControlComponent.h"
@@ -57,6 +58,7 @@
 #include "ScriptComponent.h"
 #include "SettingsComponent.h"
 #include "TextInputDialog.h"
+#include "Url.h"
 #include "ViewComponent.h"
 using namespace Microsoft::WRL;
 static constexpr size_t s_maxLoadString = 100;
@@ -516,6 +518,20 @@ bool AppWindow::ExecuteWebViewCommands(WPARAM wParam, LPARAM lParam)
         NewComponent<ScenarioWebViewEventMonitor>(this);
         return true;
     }
+    case IDM_SCENARIO_WEB_VIEW_EVENT_MONITOR_LATENCY:
+    {
+        if (auto monitor = GetComponent<ScenarioWebViewEventMonitor>())
+        {
+            monitor->ShowLatencyReport();
+        }
+        else
+        {
+            MessageBox(
+                m_mainWindow, L"Open the WebView Event Monitor first.",
+                L"Event Monitor Latency", MB_OK);
+        }
+        return true;
+    }
     case IDM_SCENARIO_JAVA_SCRIPT:
     {
         WCHAR c_scriptPath[] = L"ScenarioJavaScriptDebugIndex.html";
@@ -1583,6 +1599,8 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
         // browser might not have support for the latest version of the
         // ICoreWebView2_N interface.
         coreWebView2.query_to(&m_webView);
+        m_webResourceRequestedDispatcher =
+            std::make_shared<WebResourceRequestedDispatcher>(m_webView.get());
         // Save PID of the browser process serving last WebView created from our
         // CoreWebView2Environment. We know the controller was created with
         // S_OK, and it hasn't been closed (we haven't called Close and no
@@ -1635,6 +1653,10 @@ HRESULT AppWindow::OnCreateCoreWebView2ControllerCompleted(
                 L"appassets.example", L"assets",
                 COREWEBVIEW2_HOST_RESOURCE_ACCESS_KIND_DENY_CORS);
             //! [AddVirtualHostNameToFolderMapping]
+            if (GetAppAssetArchive())
+            {
+                ServeAppAssetsFromArchive();
+            }
         }
         NewComponent<ScenarioPermissionManagement>(this);
         NewComponent<ScenarioNotificationReceived>(this);
@@ -1802,11 +1824,11 @@ void AppWindow::RegisterEventHandlers()
                     CHECK_FAILURE(frame_info->get_Source(&source));
                     // The host can decide how to open based on source frame info,
                     // such as URI.
-                    static const wchar_t* browser_launching_domain = L"www.example.com";
-                    wil::unique_bstr source_domain = GetDomainOfUri(source.get());
-                    const wchar_t* source_domain_as_wchar = source_domain.get();
-                    if (source_domain_as_wchar &&
-                        wcscmp(browser_launching_domain, source_domain_as_wchar) == 0)
+                    static const std::string_view browser_launching_domain =
+                        "www.example.com";
+                    Url source_url;
+                    if (source_url.Parse(source.get()) &&
+                        source_url.GetHost() == browser_launching_domain)
                     {
                         // Open the URI in the default browser.
                         wil::unique_cotaskmem_string target_uri;
@@ -2132,6 +2154,7 @@ bool AppWindow::CloseWebView(bool cleanupUserDataFolder)
     {
         m_controller->Close();
         m_controller = nullptr;
+        m_webResourceRequestedDispatcher = nullptr;
         m_webView = nullptr;
         m_webView3 = nullptr;
     }
@@ -2311,6 +2334,53 @@ std::wstring AppWindow::GetLocalPath(std::wstring relativePath, bool keep_exe_pa
     return path;
 }
 
+// Answer requests for appassets.example from the asset archive, so that they are
+// served from its mapping rather than each opening a file. Requests for files
+// the archive doesn't have are left to the folder mapping.
+void AppWindow::ServeAppAssetsFromArchive()
+{
+    static const std::wstring appAssetsUrl = L"https://appassets.example/";
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Add(
+        (appAssetsUrl + L"*").c_str(), COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT,
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+            {
+                wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                CHECK_FAILURE(args->get_Request(&request));
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(request->get_Uri(&uri));
+                wil::unique_cotaskmem_string method;
+                CHECK_FAILURE(request->get_Method(&method));
+                if (wcscmp(method.get(), L"GET") != 0)
+                {
+                    return S_OK;
+                }
+                // The dispatcher only passes on requests that match the filter.
+                std::wstring_view path(uri.get());
+                path.remove_prefix(appAssetsUrl.size());
+                path = path.substr(0, path.find_first_of(L"?#"));
+                // Escaped paths are left to the folder mapping, which unescapes them.
+                if (path.find(L'%') != std::wstring_view::npos)
+                {
+                    return S_OK;
+                }
+                std::wstring assetPath = L"assets/" + std::wstring(path);
+                AssetArchiveItem item;
+                if (!GetAppAssetArchive()->Find(assetPath, &item))
+                {
+                    return S_OK;
+                }
+                wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+                CHECK_FAILURE(CreateAssetResponse(
+                    m_webViewEnvironment.get(), assetPath, request.get(), L"", &response));
+                CHECK_FAILURE(args->put_Response(response.get()));
+                return S_OK;
+            })
+            .Get(),
+        nullptr));
+}
+
 std::wstring AppWindow::GetLocalUri(
     std::wstring relativePath, bool useVirtualHostName /*= true*/)
 {
@@ -2318,18 +2388,30 @@ std::wstring AppWindow::GetLocalUri(
     {
         //! [LocalUrlUsage]
         const std::wstring localFileRootUrl = L"https://appassets.example/";
-        return localFileRootUrl + regex_replace(relativePath, std::wregex(L"\\\\"), L"/");
+        std::replace(relativePath.begin(), relativePath.end(), L'\\', L'/');
+        return localFileRootUrl + relativePath;
         //! [LocalUrlUsage]
     }
     else
     {
         std::wstring path = GetLocalPath(L"assets\\" + relativePath, false);
-        wil::com_ptr<IUri> uri;
-        CHECK_FAILURE(CreateUri(path.c_str(), Uri_CREATE_ALLOW_IMPLICIT_FILE_SCHEME, 0, &uri));
-
-        wil::unique_bstr uriBstr;
-        CHECK_FAILURE(uri->GetAbsoluteUri(&uriBstr));
-        return std::wstring(uriBstr.get());
+        // A UNC path, as \\server\share, has the server as its host.
+        std::wstring fileUri = path.compare(0, 2, L"\\\\") == 0 ? L"file:" : L"file:///";
+        for (wchar_t c : path)
+        {
+            if (c == L'%' || c == L'#' || c == L'?')
+            {
+                // Otherwise these would start an escape, the query or the fragment.
+                fileUri += c == L'%' ? L"%25" : c == L'#' ? L"%23" : L"%3F";
+            }
+            else
+            {
+                fileUri += c;
+            }
+        }
+        Url url;
+        CHECK_FAILURE_BOOL(url.Parse(fileUri));
+        return std::wstring(url.GetHref().begin(), url.GetHref().end());
     }
 }
 
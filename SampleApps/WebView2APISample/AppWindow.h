@@ -8,6 +8,7 @@
 
 #include "ComponentBase.h"
 #include "Toolbar.h"
+#include "WebResourceRequestedDispatcher.h"
 #include "resource.h"
 #include <dcomp.h>
 #include <functional>
@@ -112,6 +113,12 @@ public:
     {
         return m_webViewEnvironment.get();
     }
+    // Components that add WebResourceRequested handlers through this keep it,
+    // so that they can remove them after the WebView is closed.
+    const std::shared_ptr<WebResourceRequestedDispatcher>& GetWebResourceRequestedDispatcher()
+    {
+        return m_webResourceRequestedDispatcher;
+    }
     HWND GetMainWindow()
     {
         return m_mainWindow;
@@ -216,6 +223,7 @@ private:
     bool PrintToPdfStream();
     void ToggleTrackingPrevention();
     std::wstring GetLocalPath(std::wstring path, bool keep_exe_path);
+    void ServeAppAssetsFromArchive();
     void DeleteAllComponents();
 
     template <class ComponentType> std::unique_ptr<ComponentType> MoveComponent();
@@ -241,6 +249,7 @@ private:
     wil::com_ptr<ICoreWebView2Controller> m_controller;
     wil::com_ptr<ICoreWebView2> m_webView;
     wil::com_ptr<ICoreWebView2_3> m_webView3;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
 
     bool m_shouldHandleNewWindowRequest = true;
 
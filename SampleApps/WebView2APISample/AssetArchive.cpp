@@ -0,0 +1,274 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace
+{
+char FoldAsciiCase(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string ToUtf8(std::wstring_view value)
+{
+    std::string utf8(value.size() * 4, '\0');
+    utf8.resize(WriteUtf8(value, &utf8[0]));
+    return utf8;
+}
+
+uint64_t AlignUp(uint64_t value)
+{
+    return (value + c_assetArchiveAlignment - 1) & ~uint64_t(c_assetArchiveAlignment - 1);
+}
+} // namespace
+
+int CompareAssetPaths(std::string_view a, std::string_view b)
+{
+    size_t count = (std::min)(a.size(), b.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned char left = static_cast<unsigned char>(FoldAsciiCase(a[i]));
+        unsigned char right = static_cast<unsigned char>(FoldAsciiCase(b[i]));
+        if (left != right)
+        {
+            return left < right ? -1 : 1;
+        }
+    }
+    if (a.size() == b.size())
+    {
+        return 0;
+    }
+    return a.size() < b.size() ? -1 : 1;
+}
+
+std::shared_ptr<AssetArchive> AssetArchive::Open(const std::filesystem::path& path)
+{
+    std::shared_ptr<AssetArchive> archive(new AssetArchive());
+    if (!archive->m_file.OpenReadOnly(path) ||
+        archive->m_file.Size() < sizeof(AssetArchiveHeader))
+    {
+        return nullptr;
+    }
+    archive->m_header = reinterpret_cast<const AssetArchiveHeader*>(archive->m_file.Data());
+    if (!archive->ReadIndex())
+    {
+        return nullptr;
+    }
+    return archive;
+}
+
+bool AssetArchive::ReadIndex()
+{
+    const AssetArchiveHeader& header = *m_header;
+    uint64_t fileSize = m_file.Size();
+    if (memcmp(header.magic, c_assetArchiveMagic, sizeof(header.magic)) != 0 ||
+        header.version != c_assetArchiveVersion || header.fileSize != fileSize ||
+        header.headerSize < sizeof(AssetArchiveHeader) || header.headerSize % 8 != 0)
+    {
+        return false;
+    }
+    // Each region must follow the one before, and the sums can't overflow
+    // since every term is checked against the file size first.
+    uint64_t entriesEnd =
+        header.headerSize + uint64_t(header.entryCount) * sizeof(AssetArchiveEntry);
+    if (header.headerSize > fileSize || header.entryCount > fileSize ||
+        entriesEnd > header.stringsOffset || header.stringsOffset > fileSize ||
+        header.stringsSize > fileSize - header.stringsOffset ||
+        header.stringsOffset + header.stringsSize > header.dataOffset ||
+        header.dataOffset > fileSize)
+    {
+        return false;
+    }
+    m_entries = reinterpret_cast<const AssetArchiveEntry*>(m_file.Data() + header.headerSize);
+    m_strings = reinterpret_cast<const char*>(m_file.Data() + header.stringsOffset);
+    for (uint32_t i = 0; i < header.entryCount; ++i)
+    {
+        const AssetArchiveEntry& entry = m_entries[i];
+        if (entry.pathSize == 0 || entry.pathOffset > header.stringsSize ||
+            entry.pathSize > header.stringsSize - entry.pathOffset ||
+            entry.contentTypeOffset > header.stringsSize ||
+            entry.contentTypeSize > header.stringsSize - entry.contentTypeOffset ||
+            entry.dataOffset < header.dataOffset || entry.dataOffset > fileSize ||
+            entry.dataSize > fileSize - entry.dataOffset)
+        {
+            return false;
+        }
+        // Lookups rely on the order, and on there being one entry per path.
+        if (i > 0 && CompareAssetPaths(GetItem(i - 1).path, GetItem(i).path) >= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AssetArchive::Find(std::wstring_view path, AssetArchiveItem* item) const
+{
+    std::string key = ToUtf8(AssetCache::NormalizeKey(path));
+    return !key.empty() && FindKey(key, item);
+}
+
+bool AssetArchive::FindKey(std::string_view key, AssetArchiveItem* item) const
+{
+    size_t low = 0;
+    size_t high = GetItemCount();
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const AssetArchiveEntry& entry = m_entries[middle];
+        int order =
+            CompareAssetPaths(std::string_view(m_strings + entry.pathOffset, entry.pathSize), key);
+        if (order == 0)
+        {
+            *item = GetItem(middle);
+            return true;
+        }
+        if (order < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return false;
+}
+
+AssetArchiveItem AssetArchive::GetItem(size_t index) const
+{
+    const AssetArchiveEntry& entry = m_entries[index];
+    AssetArchiveItem item;
+    item.path = std::string_view(m_strings + entry.pathOffset, entry.pathSize);
+    item.contentType = std::string_view(m_strings + entry.contentTypeOffset, entry.contentTypeSize);
+    item.data = m_file.Data() + entry.dataOffset;
+    item.size = static_cast<size_t>(entry.dataSize);
+    item.hash = entry.hash;
+    return item;
+}
+
+AssetPtr AssetArchive::GetAsset(std::wstring_view path, AssetArchiveItem* found) const
+{
+    std::wstring key = AssetCache::NormalizeKey(path);
+    std::string utf8 = ToUtf8(key);
+    AssetArchiveItem item;
+    if (utf8.empty() || !FindKey(utf8, &item))
+    {
+        return nullptr;
+    }
+    if (found)
+    {
+        *found = item;
+    }
+    auto asset = std::make_shared<Asset>();
+    asset->key = std::move(key);
+    asset->data = item.data;
+    asset->size = item.size;
+    asset->hash = item.hash;
+    asset->hasHash = HasHashes();
+    asset->owner = shared_from_this();
+    return asset;
+}
+
+bool AssetArchiveWriter::Add(
+    std::wstring_view path, std::string contentType, std::vector<uint8_t> bytes)
+{
+    std::string key = ToUtf8(AssetCache::NormalizeKey(path));
+    if (key.empty())
+    {
+        return false;
+    }
+    // Kept in path order, so that Write() doesn't have to sort.
+    auto position = std::lower_bound(
+        m_items.begin(), m_items.end(), key,
+        [](const Item& item, const std::string& target)
+        { return CompareAssetPaths(item.path, target) < 0; });
+    if (position != m_items.end() && CompareAssetPaths(position->path, key) == 0)
+    {
+        return false;
+    }
+    m_items.insert(position, Item{std::move(key), std::move(contentType), std::move(bytes)});
+    return true;
+}
+
+bool AssetArchiveWriter::Write(const std::filesystem::path& path, bool hashes) const
+{
+    AssetArchiveHeader header = {};
+    memcpy(header.magic, c_assetArchiveMagic, sizeof(header.magic));
+    header.version = c_assetArchiveVersion;
+    header.headerSize = sizeof(AssetArchiveHeader);
+    header.entryCount = static_cast<uint32_t>(m_items.size());
+    header.flags = hashes ? uint32_t(AssetArchiveHasHashes) : 0;
+
+    std::vector<AssetArchiveEntry> entries(m_items.size());
+    std::string strings;
+    for (size_t i = 0; i < m_items.size(); ++i)
+    {
+        const Item& item = m_items[i];
+        AssetArchiveEntry& entry = entries[i];
+        entry.pathOffset = static_cast<uint32_t>(strings.size());
+        entry.pathSize = static_cast<uint32_t>(item.path.size());
+        strings += item.path;
+        entry.contentTypeOffset = static_cast<uint32_t>(strings.size());
+        entry.contentTypeSize = static_cast<uint32_t>(item.contentType.size());
+        strings += item.contentType;
+        entry.dataSize = item.bytes.size();
+        entry.hash = hashes ? HashAssetBytes(item.bytes.data(), item.bytes.size()) : 0;
+    }
+    if (m_items.size() > UINT32_MAX || strings.size() > UINT32_MAX)
+    {
+        return false;
+    }
+    header.stringsOffset = header.headerSize + entries.size() * sizeof(AssetArchiveEntry);
+    header.stringsSize = strings.size();
+    header.dataOffset = AlignUp(header.stringsOffset + header.stringsSize);
+    uint64_t offset = header.dataOffset;
+    for (AssetArchiveEntry& entry : entries)
+    {
+        entry.dataOffset = offset;
+        offset = AlignUp(offset + entry.dataSize);
+    }
+    header.fileSize =
+        entries.empty() ? offset : entries.back().dataOffset + entries.back().dataSize;
+
+    // Written beside the target and renamed over it, so that a running app
+    // never maps a half-written archive.
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(
+            reinterpret_cast<const char*>(entries.data()),
+            entries.size() * sizeof(AssetArchiveEntry));
+        file.write(strings.data(), strings.size());
+        uint64_t written = header.stringsOffset + header.stringsSize;
+        const char padding[c_assetArchiveAlignment] = {};
+        for (size_t i = 0; i < m_items.size(); ++i)
+        {
+            file.write(padding, static_cast<std::streamsize>(entries[i].dataOffset - written));
+            file.write(
+                reinterpret_cast<const char*>(m_items[i].bytes.data()),
+                static_cast<std::streamsize>(m_items[i].bytes.size()));
+            written = entries[i].dataOffset + entries[i].dataSize;
+        }
+        file.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+        if (!file.flush())
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
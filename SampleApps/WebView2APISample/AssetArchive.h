@@ -0,0 +1,143 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AssetCache.h"
+#include "EventTrace.h"
+
+// An asset archive packs the files under assets/ into one file, so that the
+// app opens and maps a single file at startup instead of opening each asset
+// as it is requested. It is written by AssetPacker at build time, and read
+// through a memory mapping; entries are served straight from the mapped pages.
+//
+// Layout, little-endian:
+//
+//   AssetArchiveHeader
+//   AssetArchiveEntry[entryCount]     sorted by path, ignoring ASCII case
+//   strings                           UTF-8 paths and content types
+//   data                              each entry c_assetArchiveAlignment-aligned
+//
+// Paths are as AssetCache::NormalizeKey() makes them, with '/' separators.
+
+constexpr char c_assetArchiveMagic[8] = {'W', 'V', '2', 'A', 'S', 'S', 'E', 'T'};
+constexpr uint32_t c_assetArchiveVersion = 1;
+constexpr uint32_t c_assetArchiveAlignment = 16;
+
+enum AssetArchiveFlags : uint32_t
+{
+    // Every entry has a hash of its bytes.
+    AssetArchiveHasHashes = 1,
+};
+
+struct AssetArchiveHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t entryCount;
+    uint32_t flags;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t dataOffset;
+    uint64_t fileSize;
+};
+
+struct AssetArchiveEntry
+{
+    // Offsets into the strings.
+    uint32_t pathOffset;
+    uint32_t pathSize;
+    uint32_t contentTypeOffset;
+    uint32_t contentTypeSize;
+    // Offset from the start of the file.
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    // HashAssetBytes() of the data, or 0 if the archive has no hashes.
+    uint64_t hash;
+};
+
+// Compare paths as the archive sorts them: bytewise, ignoring ASCII case.
+int CompareAssetPaths(std::string_view a, std::string_view b);
+
+// An entry of an open archive. Its strings and bytes point into the mapping,
+// and are valid while the archive is.
+struct AssetArchiveItem
+{
+    std::string_view path;
+    std::string_view contentType;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    // 0 if the archive has no hashes.
+    uint64_t hash = 0;
+};
+
+// A mapped archive. Open() checks the whole index once, so lookups don't
+// have to; a file that fails any check isn't opened. Lookups can be made from
+// any thread.
+class AssetArchive : public std::enable_shared_from_this<AssetArchive>
+{
+public:
+    // nullptr if the file is missing or isn't a valid archive.
+    static std::shared_ptr<AssetArchive> Open(const std::filesystem::path& path);
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    // Look up a path, which is normalized first. Returns false if it isn't in
+    // the archive.
+    bool Find(std::wstring_view path, AssetArchiveItem* item) const;
+    // Look up a path that is already a normalized UTF-8 key.
+    bool FindKey(std::string_view key, AssetArchiveItem* item) const;
+    // The entry at index, in path order.
+    AssetArchiveItem GetItem(size_t index) const;
+    // The entry for path as an asset for AssetStream, without copying its
+    // bytes; the asset keeps the archive mapped. nullptr if it isn't there.
+    // The entry is also returned in item, if it is set.
+    AssetPtr GetAsset(std::wstring_view path, AssetArchiveItem* item = nullptr) const;
+
+    size_t GetItemCount() const { return m_header->entryCount; }
+    bool HasHashes() const { return (m_header->flags & AssetArchiveHasHashes) != 0; }
+
+private:
+    AssetArchive() = default;
+    // Check the header and every entry, and find the index.
+    bool ReadIndex();
+
+    MappedFile m_file;
+    const AssetArchiveHeader* m_header = nullptr;
+    const AssetArchiveEntry* m_entries = nullptr;
+    const char* m_strings = nullptr;
+};
+
+// Builds an archive in memory and writes it out in one go.
+class AssetArchiveWriter
+{
+public:
+    // Add a file under a path, which is normalized. Returns false if the path
+    // is empty or escapes its root, or if a path differing only in ASCII case
+    // was added already.
+    bool Add(std::wstring_view path, std::string contentType, std::vector<uint8_t> bytes);
+    // Write the archive, with a hash of every entry if hashes is set.
+    bool Write(const std::filesystem::path& path, bool hashes) const;
+
+    size_t GetItemCount() const { return m_items.size(); }
+
+private:
+    struct Item
+    {
+        std::string path;
+        std::string contentType;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::vector<Item> m_items;
+};
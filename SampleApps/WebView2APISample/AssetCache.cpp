@@ -0,0 +1,418 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AssetCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+uint64_t HashAssetBytes(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+AssetCache::AssetCache(Options options, Loader loader)
+    : m_options(options), m_loader(std::move(loader))
+{
+}
+
+AssetPtr AssetCache::Get(std::wstring_view path)
+{
+    std::wstring key = NormalizeKey(path);
+    if (key.empty())
+    {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (AssetPtr cached = Find(key, lock))
+    {
+        return cached;
+    }
+    auto loading = m_loading.find(key);
+    if (loading != m_loading.end())
+    {
+        ++m_stats.sharedLoads;
+        std::shared_future<AssetPtr> result = loading->second;
+        lock.unlock();
+        return result.get();
+    }
+    ++m_stats.misses;
+    std::promise<AssetPtr> promise;
+    m_loading.emplace(key, promise.get_future().share());
+    lock.unlock();
+
+    // Read without the lock, so that other files can be served meanwhile.
+    AssetPtr result;
+    AssetFileInfo info;
+    try
+    {
+        result = Load(key, m_options.maxAssetBytes, &info);
+    }
+    catch (...)
+    {
+        // The waiters get the exception too, and the next request tries again.
+        lock.lock();
+        m_loading.erase(key);
+        ++m_stats.failedLoads;
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    m_loading.erase(key);
+    if (!result)
+    {
+        ++m_stats.failedLoads;
+    }
+    else if (!result->isOnDisk)
+    {
+        Insert(result, info);
+    }
+    lock.unlock();
+    promise.set_value(result);
+    return result;
+}
+
+AssetPtr AssetCache::GetWithoutLoading(std::wstring_view path)
+{
+    std::wstring key = NormalizeKey(path);
+    if (key.empty())
+    {
+        return nullptr;
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (AssetPtr cached = Find(key, lock))
+        {
+            return cached;
+        }
+    }
+    AssetFileInfo info;
+    AssetPtr result = Load(key, 0, &info);
+    if (!result)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.failedLoads;
+    }
+    return result;
+}
+
+AssetPtr AssetCache::Find(const std::wstring& key, std::unique_lock<std::mutex>& lock)
+{
+    auto entry = m_entries.find(key);
+    if (entry == m_entries.end())
+    {
+        return nullptr;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - entry->second.checked >= m_options.checkInterval)
+    {
+        // Marked as checked first, so that requests meanwhile are served the
+        // cached asset rather than all checking it.
+        entry->second.checked = now;
+        ++m_stats.checks;
+        AssetPtr asset = *entry->second.asset;
+        AssetFileInfo cachedInfo = entry->second.info;
+        lock.unlock();
+        AssetFileInfo info;
+        std::vector<uint8_t> bytes;
+        bool found = m_loader(key, 0, &info, &bytes);
+        lock.lock();
+        entry = m_entries.find(key);
+        if (entry == m_entries.end())
+        {
+            return nullptr;
+        }
+        if (*entry->second.asset == asset &&
+            (!found || info.size != cachedInfo.size ||
+             info.lastWriteTime != cachedInfo.lastWriteTime))
+        {
+            ++m_stats.changes;
+            Erase(entry);
+            return nullptr;
+        }
+    }
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, entry->second.asset);
+    return *entry->second.asset;
+}
+
+AssetPtr AssetCache::Load(const std::wstring& key, size_t maxBytes, AssetFileInfo* info)
+{
+    auto asset = std::make_shared<Asset>();
+    asset->key = key;
+    if (!m_loader(key, maxBytes, info, &asset->bytes))
+    {
+        return nullptr;
+    }
+    if (info->size > maxBytes)
+    {
+        // Not read here; streams read it as they go.
+        asset->bytes.clear();
+        asset->size = static_cast<size_t>(info->size);
+        asset->isOnDisk = true;
+        // The bytes are unknown, and can change without the size and time
+        // changing, so they only make a weak ETag.
+        asset->hash = HashAssetBytes(reinterpret_cast<const uint8_t*>(info), sizeof(*info));
+        asset->hashIsWeak = true;
+    }
+    else
+    {
+        asset->data = asset->bytes.data();
+        asset->size = asset->bytes.size();
+        asset->hash = HashAssetBytes(asset->data, asset->size);
+    }
+    asset->hasHash = true;
+    return asset;
+}
+
+void AssetCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_stats.bytes = 0;
+}
+
+AssetCache::Stats AssetCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.assetCount = m_entries.size();
+    return stats;
+}
+
+void AssetCache::Insert(AssetPtr asset, const AssetFileInfo& info)
+{
+    auto existing = m_entries.find(asset->key);
+    if (existing != m_entries.end())
+    {
+        Erase(existing);
+    }
+    m_stats.bytes += asset->size;
+    m_lru.push_front(asset);
+    Entry& entry = m_entries[asset->key];
+    entry.asset = m_lru.begin();
+    entry.info = info;
+    entry.checked = std::chrono::steady_clock::now();
+    // Streams still reading an evicted asset keep it alive until they are done.
+    while (m_stats.bytes > m_options.maxBytes && m_lru.size() > 1)
+    {
+        Erase(m_entries.find(m_lru.back()->key));
+        ++m_stats.evictions;
+    }
+}
+
+void AssetCache::Erase(std::unordered_map<std::wstring, Entry>::iterator entry)
+{
+    m_stats.bytes -= (*entry->second.asset)->size;
+    m_lru.erase(entry->second.asset);
+    m_entries.erase(entry);
+}
+
+std::wstring AssetCache::NormalizeKey(std::wstring_view path)
+{
+    std::wstring key;
+    key.reserve(path.size());
+    // Where each segment written to key starts, for ".." to go back to.
+    std::vector<size_t> segments;
+    size_t start = 0;
+    // A leading separator, as in "/root" or "\\server\share", is kept.
+    while (start < path.size() && (path[start] == L'/' || path[start] == L'\\'))
+    {
+        key += L'/';
+        ++start;
+    }
+    size_t root = key.size();
+    while (start <= path.size())
+    {
+        size_t end = path.find_first_of(L"/\\", start);
+        if (end == std::wstring_view::npos)
+        {
+            end = path.size();
+        }
+        std::wstring_view segment = path.substr(start, end - start);
+        start = end + 1;
+        if (segment.empty() || segment == L".")
+        {
+            continue;
+        }
+        if (segment == L"..")
+        {
+            if (segments.empty())
+            {
+                return std::wstring();
+            }
+            key.resize(segments.back());
+            segments.pop_back();
+            continue;
+        }
+        segments.push_back(key.size());
+        if (key.size() > root)
+        {
+            key += L'/';
+        }
+        key += segment;
+    }
+    if (key.size() == root)
+    {
+        return std::wstring();
+    }
+    return key;
+}
+
+bool AssetCache::LoadFile(const std::wstring& path, std::vector<uint8_t>* bytes)
+{
+    std::ifstream file(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    std::streamoff size = file.tellg();
+    if (size < 0)
+    {
+        return false;
+    }
+    bytes->resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return size == 0 ||
+           file.read(reinterpret_cast<char*>(bytes->data()), static_cast<std::streamsize>(size));
+}
+
+bool AssetCache::LoadSmallFile(
+    const std::wstring& path, size_t maxBytes, AssetFileInfo* info, std::vector<uint8_t>* bytes)
+{
+    std::filesystem::path filePath(path);
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(filePath, error);
+    if (error)
+    {
+        return false;
+    }
+    std::filesystem::file_time_type lastWriteTime =
+        std::filesystem::last_write_time(filePath, error);
+    if (error)
+    {
+        return false;
+    }
+    info->size = size;
+    info->lastWriteTime = static_cast<int64_t>(lastWriteTime.time_since_epoch().count());
+    if (size > maxBytes)
+    {
+        return true;
+    }
+    if (!LoadFile(path, bytes))
+    {
+        return false;
+    }
+    // The file may have changed in between.
+    info->size = bytes->size();
+    return true;
+}
+
+AssetStream::AssetStream(AssetPtr asset)
+    : m_asset(std::move(asset)), m_data(m_asset->data), m_offset(0), m_size(m_asset->size)
+{
+}
+
+AssetStream::AssetStream(AssetPtr asset, uint64_t offset, uint64_t size)
+    : m_asset(std::move(asset)), m_data(m_asset->data ? m_asset->data + offset : nullptr),
+      m_offset(offset), m_size(size)
+{
+}
+
+AssetStream::AssetStream(const AssetStream& other)
+    : m_asset(other.m_asset), m_data(other.m_data), m_offset(other.m_offset),
+      m_size(other.m_size), m_position(other.m_position)
+{
+}
+
+AssetStream& AssetStream::operator=(const AssetStream& other)
+{
+    if (this != &other)
+    {
+        m_asset = other.m_asset;
+        m_data = other.m_data;
+        m_offset = other.m_offset;
+        m_size = other.m_size;
+        m_position = other.m_position;
+        m_file.reset();
+    }
+    return *this;
+}
+
+size_t AssetStream::Read(void* buffer, size_t size)
+{
+    if (m_position >= m_size)
+    {
+        return 0;
+    }
+    size_t count = static_cast<size_t>((std::min)(uint64_t(size), m_size - m_position));
+    if (!m_data)
+    {
+        return ReadFile(buffer, count);
+    }
+    memcpy(buffer, m_data + m_position, count);
+    m_position += count;
+    return count;
+}
+
+size_t AssetStream::ReadFile(void* buffer, size_t size)
+{
+    uint64_t filePosition = m_offset + m_position;
+    if (!m_file)
+    {
+        m_file = std::make_unique<std::ifstream>(
+            std::filesystem::path(m_asset->key), std::ios::binary);
+        m_filePosition = 0;
+    }
+    else
+    {
+        m_file->clear();
+    }
+    // Only seek when the position moved, as seeking drops the read buffer.
+    if (filePosition != m_filePosition &&
+        !m_file->seekg(static_cast<std::streamoff>(filePosition)))
+    {
+        return 0;
+    }
+    m_file->read(static_cast<char*>(buffer), static_cast<std::streamsize>(size));
+    size_t count = static_cast<size_t>(m_file->gcount());
+    m_position += count;
+    m_filePosition = filePosition + count;
+    return count;
+}
+
+bool AssetStream::Seek(int64_t offset, AssetSeekOrigin origin, uint64_t* position)
+{
+    int64_t base = 0;
+    if (origin == AssetSeekOrigin::Current)
+    {
+        base = static_cast<int64_t>(m_position);
+    }
+    else if (origin == AssetSeekOrigin::End)
+    {
+        base = static_cast<int64_t>(GetSize());
+    }
+    if (offset < -base)
+    {
+        return false;
+    }
+    m_position = static_cast<uint64_t>(base + offset);
+    if (position)
+    {
+        *position = m_position;
+    }
+    return true;
+}
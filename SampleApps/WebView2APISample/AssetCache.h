@@ -0,0 +1,203 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The bytes of a file served from the cache or an archive. They are never
+// modified once loaded, and are shared by the cache and every stream reading
+// them.
+struct Asset
+{
+    // The normalized path the asset was loaded from.
+    std::wstring key;
+    // Point at bytes, or into the archive mapping that owner keeps open.
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::vector<uint8_t> bytes;
+    std::shared_ptr<const void> owner;
+    // A hash for the asset's ETag, if hasHash is set: HashAssetBytes() of the
+    // bytes, or if hashIsWeak, of the AssetFileInfo of a file on disk, which
+    // may change without it.
+    uint64_t hash = 0;
+    bool hasHash = false;
+    bool hashIsWeak = false;
+    // A file too large to keep in memory: data is null, and streams read the
+    // file at key as they go.
+    bool isOnDisk = false;
+};
+using AssetPtr = std::shared_ptr<const Asset>;
+
+// FNV-1a, 64-bit, of the bytes.
+uint64_t HashAssetBytes(const uint8_t* data, size_t size);
+
+// What the file system says about a file, without reading it.
+struct AssetFileInfo
+{
+    uint64_t size = 0;
+    // In the file clock's ticks.
+    int64_t lastWriteTime = 0;
+};
+
+// Keeps the files that web resource requests are answered with in memory, so
+// that a file is read from disk once rather than on every request.
+//
+// Files are keyed by their path after NormalizeKey(). The cache holds at most
+// maxBytes of them, and evicts the least recently used first; a file larger
+// than maxAssetBytes isn't read at all, but returned as an asset on disk that
+// streams read in pieces. A cached file is checked for changes at most once
+// every checkInterval, and is dropped and read again if its size or last write
+// time has changed. Get() can be called from any thread. A file that several
+// threads ask for at once is loaded by the first, and the others wait for its
+// result.
+class AssetCache
+{
+public:
+    // Set info for the file at a normalized path, and read it into bytes unless
+    // it is larger than maxBytes. Returns false if it can't be read. Checks for
+    // changes call it with a maxBytes of 0.
+    using Loader = std::function<bool(
+        const std::wstring& path, size_t maxBytes, AssetFileInfo* info,
+        std::vector<uint8_t>* bytes)>;
+
+    struct Options
+    {
+        size_t maxBytes = 32 * 1024 * 1024;
+        size_t maxAssetBytes = 8 * 1024 * 1024;
+        std::chrono::steady_clock::duration checkInterval = std::chrono::seconds(1);
+    };
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Requests that waited for another thread's load of the same file.
+        uint64_t sharedLoads = 0;
+        uint64_t failedLoads = 0;
+        uint64_t evictions = 0;
+        uint64_t checks = 0;
+        // Cached files dropped because they changed on disk.
+        uint64_t changes = 0;
+        size_t assetCount = 0;
+        size_t bytes = 0;
+    };
+
+    explicit AssetCache(Options options, Loader loader = LoadSmallFile);
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    // The file at path, loading it if it isn't cached, or nullptr if it can't be
+    // read or the path leaves the directory it is relative to. If the loader
+    // throws, so does Get(), and so do the requests that waited for that load;
+    // the next request loads the file again.
+    AssetPtr Get(std::wstring_view path);
+    // The file at path if it is cached, or else an asset on disk for it that
+    // isn't read until it is streamed. For requests that only want some of the
+    // bytes of a file, such as a range.
+    AssetPtr GetWithoutLoading(std::wstring_view path);
+    // Forget every cached file.
+    void Clear();
+    Stats GetStats() const;
+
+    // The path with '/' for '\', and without empty and "." segments, and with
+    // ".." segments applied. Case is kept. Returns an empty string for a path
+    // that is empty, or that ".." would take above where it starts.
+    static std::wstring NormalizeKey(std::wstring_view path);
+    static bool LoadFile(const std::wstring& path, std::vector<uint8_t>* bytes);
+    // The default Loader.
+    static bool LoadSmallFile(
+        const std::wstring& path, size_t maxBytes, AssetFileInfo* info,
+        std::vector<uint8_t>* bytes);
+
+private:
+    struct Entry
+    {
+        std::list<AssetPtr>::iterator asset;
+        AssetFileInfo info;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    // The cached asset for a key, as the most recently used, or nullptr if it
+    // isn't cached. If it is due a check, lock is released while the file is
+    // described, and the asset is dropped if the file has changed.
+    AssetPtr Find(const std::wstring& key, std::unique_lock<std::mutex>& lock);
+    // Load the file at a normalized key, or only describe it if it is larger
+    // than maxBytes.
+    AssetPtr Load(const std::wstring& key, size_t maxBytes, AssetFileInfo* info);
+    // Add a loaded asset as the most recently used, and evict to make room.
+    void Insert(AssetPtr asset, const AssetFileInfo& info);
+    void Erase(std::unordered_map<std::wstring, Entry>::iterator entry);
+
+    Options m_options;
+    Loader m_loader;
+
+    mutable std::mutex m_mutex;
+    // Most recently used first.
+    std::list<AssetPtr> m_lru;
+    std::unordered_map<std::wstring, Entry> m_entries;
+    // The loads under way, which later requests for the same file wait for.
+    std::unordered_map<std::wstring, std::shared_future<AssetPtr>> m_loading;
+    Stats m_stats;
+};
+
+enum class AssetSeekOrigin
+{
+    Begin,
+    Current,
+    End,
+};
+
+// A read-only cursor over an asset's bytes, or a range of them. Copies share
+// the bytes and have positions of their own, so a stream can be handed out many
+// times for the cost of a reference count. The bytes of an asset on disk are
+// read from the file, which each copy opens the first time it reads.
+class AssetStream
+{
+public:
+    explicit AssetStream(AssetPtr asset);
+    // Over size bytes from offset, which must be within the asset's bytes.
+    AssetStream(AssetPtr asset, uint64_t offset, uint64_t size);
+    AssetStream(const AssetStream& other);
+    AssetStream& operator=(const AssetStream& other);
+    AssetStream(AssetStream&&) = default;
+    AssetStream& operator=(AssetStream&&) = default;
+
+    // Copy up to size bytes to buffer, and advance. Returns the number copied,
+    // which is less than size only at the end.
+    size_t Read(void* buffer, size_t size);
+    // Move to offset from origin. Returns false, without moving, if that is
+    // before the start. Positions past the end read nothing.
+    bool Seek(int64_t offset, AssetSeekOrigin origin, uint64_t* position = nullptr);
+
+    uint64_t GetPosition() const { return m_position; }
+    uint64_t GetSize() const { return m_size; }
+    // The bytes the stream reads, from position 0, or null for an asset on disk.
+    const uint8_t* GetData() const { return m_data; }
+    const AssetPtr& GetAsset() const { return m_asset; }
+
+private:
+    size_t ReadFile(void* buffer, size_t size);
+
+    AssetPtr m_asset;
+    const uint8_t* m_data;
+    uint64_t m_offset;
+    uint64_t m_size;
+    uint64_t m_position = 0;
+    // For an asset on disk, and where the next read from it starts.
+    std::unique_ptr<std::ifstream> m_file;
+    uint64_t m_filePosition = 0;
+};
@@ -0,0 +1,449 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "AssetComStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+
+#include "ContentEncoding.h"
+#include "HttpSemantics.h"
+#include "MimeTypes.h"
+
+using namespace Microsoft::WRL;
+
+AssetComStream::AssetComStream(AssetStream stream) : m_stream(std::move(stream))
+{
+}
+
+HRESULT AssetComStream::Read(void* buffer, ULONG size, ULONG* read)
+{
+    if (!buffer)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+    ULONG count = static_cast<ULONG>(m_stream.Read(buffer, size));
+    if (read)
+    {
+        *read = count;
+    }
+    return count < size ? S_FALSE : S_OK;
+}
+
+HRESULT AssetComStream::Write(const void* buffer, ULONG size, ULONG* written)
+{
+    return STG_E_ACCESSDENIED;
+}
+
+HRESULT AssetComStream::Seek(LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* newPosition)
+{
+    AssetSeekOrigin assetOrigin;
+    switch (origin)
+    {
+    case STREAM_SEEK_SET:
+        assetOrigin = AssetSeekOrigin::Begin;
+        break;
+    case STREAM_SEEK_CUR:
+        assetOrigin = AssetSeekOrigin::Current;
+        break;
+    case STREAM_SEEK_END:
+        assetOrigin = AssetSeekOrigin::End;
+        break;
+    default:
+        return STG_E_INVALIDFUNCTION;
+    }
+    uint64_t position = 0;
+    if (!m_stream.Seek(offset.QuadPart, assetOrigin, &position))
+    {
+        return STG_E_INVALIDFUNCTION;
+    }
+    if (newPosition)
+    {
+        newPosition->QuadPart = position;
+    }
+    return S_OK;
+}
+
+HRESULT AssetComStream::SetSize(ULARGE_INTEGER newSize)
+{
+    return STG_E_ACCESSDENIED;
+}
+
+HRESULT AssetComStream::CopyTo(
+    IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* read, ULARGE_INTEGER* written)
+{
+    if (!target)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+    if (!m_stream.GetData())
+    {
+        return CopyFileTo(target, size, read, written);
+    }
+    // Write straight from the asset's bytes, without a buffer in between.
+    uint64_t position = m_stream.GetPosition();
+    uint64_t streamSize = m_stream.GetSize();
+    uint64_t available = position < streamSize ? streamSize - position : 0;
+    uint64_t count = (std::min)(size.QuadPart, available);
+    uint64_t total = 0;
+    HRESULT hr = S_OK;
+    while (total < count)
+    {
+        ULONG chunk = static_cast<ULONG>((std::min)(count - total, uint64_t(ULONG_MAX)));
+        ULONG chunkWritten = 0;
+        hr = target->Write(m_stream.GetData() + position + total, chunk, &chunkWritten);
+        total += chunkWritten;
+        if (FAILED(hr) || chunkWritten < chunk)
+        {
+            break;
+        }
+    }
+    m_stream.Seek(static_cast<int64_t>(total), AssetSeekOrigin::Current);
+    if (read)
+    {
+        read->QuadPart = total;
+    }
+    if (written)
+    {
+        written->QuadPart = total;
+    }
+    return hr;
+}
+
+HRESULT AssetComStream::CopyFileTo(
+    IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* read, ULARGE_INTEGER* written)
+{
+    std::vector<uint8_t> buffer(static_cast<size_t>((std::min)(size.QuadPart, c_copyBufferSize)));
+    uint64_t totalRead = 0;
+    uint64_t totalWritten = 0;
+    HRESULT hr = S_OK;
+    while (totalRead < size.QuadPart)
+    {
+        size_t chunk = m_stream.Read(
+            buffer.data(),
+            static_cast<size_t>((std::min)(size.QuadPart - totalRead, uint64_t(buffer.size()))));
+        if (chunk == 0)
+        {
+            break;
+        }
+        totalRead += chunk;
+        ULONG chunkWritten = 0;
+        hr = target->Write(buffer.data(), static_cast<ULONG>(chunk), &chunkWritten);
+        totalWritten += chunkWritten;
+        if (FAILED(hr) || chunkWritten < chunk)
+        {
+            break;
+        }
+    }
+    if (read)
+    {
+        read->QuadPart = totalRead;
+    }
+    if (written)
+    {
+        written->QuadPart = totalWritten;
+    }
+    return hr;
+}
+
+HRESULT AssetComStream::Commit(DWORD flags)
+{
+    return S_OK;
+}
+
+HRESULT AssetComStream::Revert()
+{
+    return S_OK;
+}
+
+HRESULT AssetComStream::LockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD type)
+{
+    return STG_E_INVALIDFUNCTION;
+}
+
+HRESULT AssetComStream::UnlockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD type)
+{
+    return STG_E_INVALIDFUNCTION;
+}
+
+HRESULT AssetComStream::Stat(STATSTG* stat, DWORD flags)
+{
+    if (!stat)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+    *stat = {};
+    if (!(flags & STATFLAG_NONAME))
+    {
+        const std::wstring& name = m_stream.GetAsset()->key;
+        size_t size = (name.size() + 1) * sizeof(wchar_t);
+        stat->pwcsName = static_cast<LPOLESTR>(CoTaskMemAlloc(size));
+        if (!stat->pwcsName)
+        {
+            return E_OUTOFMEMORY;
+        }
+        memcpy(stat->pwcsName, name.c_str(), size);
+    }
+    stat->type = STGTY_STREAM;
+    stat->cbSize.QuadPart = m_stream.GetSize();
+    stat->grfMode = STGM_READ | STGM_SHARE_DENY_WRITE;
+    return S_OK;
+}
+
+HRESULT AssetComStream::Clone(IStream** stream)
+{
+    if (!stream)
+    {
+        return STG_E_INVALIDPOINTER;
+    }
+    // The clone starts at this stream's position, as IStream::Clone requires.
+    ComPtr<AssetComStream> clone = Make<AssetComStream>(m_stream);
+    if (!clone)
+    {
+        return E_OUTOFMEMORY;
+    }
+    return clone.CopyTo(stream);
+}
+
+AssetCache& GetAppAssetCache()
+{
+    static AssetCache cache{AssetCache::Options()};
+    return cache;
+}
+
+const std::shared_ptr<AssetArchive>& GetAppAssetArchive()
+{
+    static const std::shared_ptr<AssetArchive> archive = []
+    {
+        WCHAR modulePath[MAX_PATH];
+        GetModuleFileNameW(nullptr, modulePath, ARRAYSIZE(modulePath));
+        std::filesystem::path path(modulePath);
+        return AssetArchive::Open(path.replace_filename(L"assets.pak"));
+    }();
+    return archive;
+}
+
+ImageReplacer& GetAppImageReplacer()
+{
+    static ImageReplacer replacer(
+        []
+        {
+            std::vector<uint8_t> text;
+            std::vector<ImageReplacer::Rule> rules;
+            if (AssetCache::LoadFile(L"assets/ImageReplacements.txt", &text))
+            {
+                rules = ImageReplacer::ParseRules(
+                    std::string_view(reinterpret_cast<const char*>(text.data()), text.size()));
+            }
+            if (rules.empty())
+            {
+                rules.push_back({"image/*", 0, L"assets/EdgeWebView2-80.jpg"});
+            }
+            return rules;
+        }(),
+        ImageReplacer::Options());
+    return replacer;
+}
+
+HRESULT CreateAssetStream(const std::wstring& path, IStream** stream)
+{
+    *stream = nullptr;
+    AssetPtr asset;
+    if (const std::shared_ptr<AssetArchive>& archive = GetAppAssetArchive())
+    {
+        asset = archive->GetAsset(path);
+    }
+    if (!asset)
+    {
+        asset = GetAppAssetCache().Get(path);
+    }
+    if (!asset)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    ComPtr<AssetComStream> assetStream = Make<AssetComStream>(AssetStream(std::move(asset)));
+    if (!assetStream)
+    {
+        return E_OUTOFMEMORY;
+    }
+    return assetStream.CopyTo(stream);
+}
+
+namespace
+{
+// The value of a request header, or an empty string if there is none.
+std::wstring GetRequestHeader(ICoreWebView2HttpRequestHeaders* headers, LPCWSTR name)
+{
+    wil::unique_cotaskmem_string value;
+    if (headers->GetHeader(name, &value) != S_OK)
+    {
+        return std::wstring();
+    }
+    return value.get();
+}
+
+// Get the file at path, or the variant of it for acceptEncoding if the archive
+// has one. coding is set to the variant's coding, and hasVariants to whether
+// there are any. If isPartial, as for a Range, a loose file that isn't cached
+// isn't read whole; only the bytes that are streamed are read.
+AssetPtr GetAssetForEncoding(
+    const std::wstring& path, std::wstring_view acceptEncoding, bool isPartial,
+    std::string* contentType, ContentCoding* coding, bool* hasVariants)
+{
+    *coding = ContentCoding::Identity;
+    *hasVariants = false;
+    const std::shared_ptr<AssetArchive>& archive = GetAppAssetArchive();
+    AssetArchiveItem item;
+    if (!archive || !archive->Find(path, &item))
+    {
+        std::string_view type = GetMimeTypeForPath(path);
+        *contentType = type.empty() ? "application/octet-stream" : std::string(type);
+        return isPartial ? GetAppAssetCache().GetWithoutLoading(path)
+                         : GetAppAssetCache().Get(path);
+    }
+    *contentType = std::string(item.contentType);
+
+    ContentCodings available = 0;
+    for (ContentCoding variant : {ContentCoding::Gzip, ContentCoding::Zstd})
+    {
+        AssetArchiveItem variantItem;
+        if (archive->Find(path + std::wstring(GetContentCodingSuffix(variant)), &variantItem))
+        {
+            available |= ToContentCodings(variant);
+        }
+    }
+    *hasVariants = available != 0;
+    if (*hasVariants)
+    {
+        *coding = NegotiateContentCoding(acceptEncoding, available);
+    }
+    return archive->GetAsset(path + std::wstring(GetContentCodingSuffix(*coding)));
+}
+} // namespace
+
+HRESULT CreateAssetResponse(
+    ICoreWebView2Environment* environment, const std::wstring& path,
+    ICoreWebView2WebResourceRequest* request, std::wstring_view extraHeaders,
+    ICoreWebView2WebResourceResponse** response)
+{
+    *response = nullptr;
+    wil::com_ptr<ICoreWebView2HttpRequestHeaders> requestHeaders;
+    RETURN_IF_FAILED(request->get_Headers(&requestHeaders));
+    wil::unique_cotaskmem_string method;
+    RETURN_IF_FAILED(request->get_Method(&method));
+    // Only the representation of a GET can be validated or sent in part.
+    bool isGet = wcscmp(method.get(), L"GET") == 0 || wcscmp(method.get(), L"HEAD") == 0;
+    std::wstring range = isGet ? GetRequestHeader(requestHeaders.get(), L"Range") : L"";
+
+    // A range is of the file itself, whose byte offsets the client knows.
+    std::string contentType;
+    ContentCoding coding;
+    bool hasVariants;
+    AssetPtr asset = GetAssetForEncoding(
+        path, range.empty() ? GetRequestHeader(requestHeaders.get(), L"Accept-Encoding") : L"",
+        !range.empty(), &contentType, &coding, &hasVariants);
+    if (!asset)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    // The headers of every response for the file, including a 304 (RFC 9110
+    // 15.4.5).
+    std::wstring headers = L"Accept-Ranges: bytes";
+    std::wstring etag;
+    if (asset->hasHash)
+    {
+        etag = FormatEntityTag(asset->hash, asset->hashIsWeak);
+        headers += L"\nETag: " + etag;
+    }
+    // Caches must keep the variants apart.
+    if (hasVariants)
+    {
+        headers += L"\nVary: Accept-Encoding";
+    }
+    if (!extraHeaders.empty())
+    {
+        headers += L"\n";
+        headers += extraHeaders;
+    }
+    if (isGet && !etag.empty() &&
+        MatchesIfNoneMatch(GetRequestHeader(requestHeaders.get(), L"If-None-Match"), etag))
+    {
+        return environment->CreateWebResourceResponse(
+            nullptr, 304, L"Not Modified", headers.c_str(), response);
+    }
+    if (coding != ContentCoding::Identity)
+    {
+        headers += L"\nContent-Encoding: ";
+        headers += GetContentCodingName(coding);
+    }
+
+    std::vector<ByteRange> ranges;
+    RangeStatus rangeStatus = RangeStatus::Ignored;
+    std::wstring ifRange = GetRequestHeader(requestHeaders.get(), L"If-Range");
+    if (!range.empty() && (ifRange.empty() || MatchesIfRange(ifRange, etag)))
+    {
+        rangeStatus = ParseRange(range, asset->size, &ranges);
+    }
+    if (rangeStatus == RangeStatus::Unsatisfiable)
+    {
+        headers += L"\nContent-Range: " + FormatUnsatisfiedContentRange(asset->size);
+        return environment->CreateWebResourceResponse(
+            nullptr, 416, L"Range Not Satisfiable", headers.c_str(), response);
+    }
+
+    ComPtr<AssetComStream> stream;
+    if (rangeStatus == RangeStatus::Satisfiable && ranges.size() == 1)
+    {
+        // Served from the cached or mapped bytes at the offset, without a copy,
+        // or read from the offset of a file that isn't cached.
+        headers += L"\nContent-Type: ";
+        headers.append(contentType.begin(), contentType.end());
+        headers += L"\nContent-Range: " + FormatContentRange(ranges[0], asset->size);
+        stream = Make<AssetComStream>(AssetStream(asset, ranges[0].offset, ranges[0].size));
+    }
+    else if (rangeStatus == RangeStatus::Satisfiable)
+    {
+        // The boundary only has to be unlikely to be in the content.
+        static std::atomic<uint64_t> s_boundaryCount;
+        std::string boundary = "WebView2APISample-" + std::to_string(GetTickCount64()) + "-" +
+                               std::to_string(++s_boundaryCount);
+        auto parts = std::make_shared<Asset>();
+        parts->key = asset->key;
+        // Each range is read on its own, from memory or from the file.
+        AssetStream source(asset);
+        if (!BuildMultipartByteRanges(
+                [&source](const ByteRange& part, uint8_t* buffer)
+                {
+                    return source.Seek(static_cast<int64_t>(part.offset), AssetSeekOrigin::Begin) &&
+                           source.Read(buffer, static_cast<size_t>(part.size)) == part.size;
+                },
+                asset->size, ranges, contentType, boundary, &parts->bytes))
+        {
+            return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        }
+        parts->data = parts->bytes.data();
+        parts->size = parts->bytes.size();
+        headers += L"\nContent-Type: multipart/byteranges; boundary=";
+        headers.append(boundary.begin(), boundary.end());
+        stream = Make<AssetComStream>(AssetStream(std::move(parts)));
+    }
+    else
+    {
+        headers += L"\nContent-Type: ";
+        headers.append(contentType.begin(), contentType.end());
+        stream = Make<AssetComStream>(AssetStream(std::move(asset)));
+    }
+    if (!stream)
+    {
+        return E_OUTOFMEMORY;
+    }
+    bool partial = rangeStatus == RangeStatus::Satisfiable;
+    return environment->CreateWebResourceResponse(
+        stream.Get(), partial ? 206 : 200, partial ? L"Partial Content" : L"OK",
+        headers.c_str(), response);
+}
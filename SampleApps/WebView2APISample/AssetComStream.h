@@ -0,0 +1,88 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <string>
+
+#include "AssetArchive.h"
+#include "AssetCache.h"
+#include "ImageReplacer.h"
+
+// A read-only IStream over an asset, for CreateWebResourceResponse. Clones
+// share the asset's bytes, so handing one out costs no copy.
+class AssetComStream : public Microsoft::WRL::RuntimeClass<
+                           Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>,
+                           Microsoft::WRL::ChainInterfaces<IStream, ISequentialStream>,
+                           Microsoft::WRL::FtmBase>
+{
+public:
+    explicit AssetComStream(AssetStream stream);
+
+    // ISequentialStream implementation
+    STDMETHODIMP Read(void* buffer, ULONG size, ULONG* read) override;
+    STDMETHODIMP Write(const void* buffer, ULONG size, ULONG* written) override;
+
+    // IStream implementation
+    STDMETHODIMP Seek(
+        LARGE_INTEGER offset, DWORD origin, ULARGE_INTEGER* newPosition) override;
+    STDMETHODIMP SetSize(ULARGE_INTEGER newSize) override;
+    STDMETHODIMP CopyTo(
+        IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* read,
+        ULARGE_INTEGER* written) override;
+    STDMETHODIMP Commit(DWORD flags) override;
+    STDMETHODIMP Revert() override;
+    STDMETHODIMP LockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD type) override;
+    STDMETHODIMP UnlockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER size, DWORD type) override;
+    STDMETHODIMP Stat(STATSTG* stat, DWORD flags) override;
+    STDMETHODIMP Clone(IStream** stream) override;
+
+private:
+    // CopyTo for an asset on disk, through a buffer.
+    HRESULT CopyFileTo(
+        IStream* target, ULARGE_INTEGER size, ULARGE_INTEGER* read, ULARGE_INTEGER* written);
+
+    static constexpr uint64_t c_copyBufferSize = 64 * 1024;
+
+    AssetStream m_stream;
+};
+
+// The cache of the files under the app's folder that web resource requests are
+// answered with, shared by every window. A file edited while the app runs is
+// served anew within a second.
+AssetCache& GetAppAssetCache();
+
+// The archive of the app's assets, assets.pak beside the executable, as built
+// by AssetPacker. nullptr if there is none, in which case the loose files are
+// used.
+const std::shared_ptr<AssetArchive>& GetAppAssetArchive();
+
+// The images that Settings -> Replace images serves, shared by every window,
+// by the rules in assets/ImageReplacements.txt. If there is no such file, every
+// image is replaced with assets/EdgeWebView2-80.jpg.
+ImageReplacer& GetAppImageReplacer();
+
+// Open a file for reading, in place of SHCreateStreamOnFileEx with STGM_READ.
+// A file in GetAppAssetArchive() is served from its mapping, and any other is
+// read through GetAppAssetCache(). Fails with
+// HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) if the file can't be read.
+HRESULT CreateAssetStream(const std::wstring& path, IStream** stream);
+
+// Answer a web resource request with a file, read as CreateAssetStream does.
+// If GetAppAssetArchive() has compressed variants of the file, the one that
+// the request's Accept-Encoding prefers is sent (see ContentEncoding.h). The
+// response has a strong ETag of the content's hash, or, for a file that is
+// streamed from disk unread, a weak one of its size and last write time. A GET
+// is answered with 304 Not Modified if it matches If-None-Match, or with 206
+// Partial Content over just the bytes of a Range, which are all that is read
+// of a file that isn't cached. An If-Range only lets a Range apply if it
+// matches a strong ETag (see HttpSemantics.h). extraHeaders, such as
+// "Access-Control-Allow-Origin: *", are added to every response. Fails with
+// HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) if the file can't be read.
+HRESULT CreateAssetResponse(
+    ICoreWebView2Environment* environment, const std::wstring& path,
+    ICoreWebView2WebResourceRequest* request, std::wstring_view extraHeaders,
+    ICoreWebView2WebResourceResponse** response);
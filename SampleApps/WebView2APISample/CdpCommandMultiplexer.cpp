@@ -0,0 +1,206 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpCommandMultiplexer.h"
+
+#include <algorithm>
+#include <memory>
+
+CdpCommandMultiplexer::CdpCommandMultiplexer(Options options, Endpoint endpoint, Clock clock)
+    : m_options(options), m_endpoint(std::move(endpoint)), m_clock(std::move(clock))
+{
+    m_options.maxInFlightPerSession = (std::max)(m_options.maxInFlightPerSession, size_t(1));
+}
+
+uint64_t CdpCommandMultiplexer::Send(
+    std::wstring_view sessionId, std::wstring_view method, std::wstring_view params,
+    std::chrono::milliseconds timeout, Callback callback)
+{
+    uint64_t id = ++m_lastId;
+    Command& command = m_commands[id];
+    command.sessionId = sessionId;
+    command.method = method;
+    command.params = params;
+    command.callback = std::move(callback);
+    command.deadline = timeout.count() > 0 ? m_clock() + timeout
+                                           : std::chrono::steady_clock::time_point::max();
+    if (timeout.count() > 0)
+    {
+        m_deadlines.emplace(command.deadline, id);
+    }
+    m_sessions[command.sessionId].queue.push_back(id);
+    SendQueued(command.sessionId);
+    return id;
+}
+
+uint64_t CdpCommandMultiplexer::Gather(
+    const std::vector<std::wstring>& sessionIds, std::wstring_view method,
+    std::wstring_view params, std::chrono::milliseconds timeout, GatherCallback callback)
+{
+    uint64_t gatherId = ++m_lastId;
+    struct State
+    {
+        std::vector<CdpGatherResult> results;
+        size_t remaining = 0;
+        GatherCallback callback;
+    };
+    auto state = std::make_shared<State>();
+    state->results.resize(sessionIds.size());
+    for (size_t i = 0; i < sessionIds.size(); ++i)
+    {
+        state->results[i].sessionId = sessionIds[i];
+    }
+    state->remaining = sessionIds.size();
+    state->callback = std::move(callback);
+    if (sessionIds.empty())
+    {
+        state->callback(state->results);
+        return gatherId;
+    }
+
+    m_gathers[gatherId].reserve(sessionIds.size());
+    for (size_t i = 0; i < sessionIds.size(); ++i)
+    {
+        uint64_t commandId = Send(
+            sessionIds[i], method, params, timeout,
+            [this, state, gatherId, i](const CdpCommandResult& result)
+            {
+                state->results[i].result = result;
+                if (--state->remaining == 0)
+                {
+                    m_gathers.erase(gatherId);
+                    state->callback(state->results);
+                }
+            });
+        // The gather is gone if its last command completed within Send().
+        auto gather = m_gathers.find(gatherId);
+        if (gather != m_gathers.end())
+        {
+            gather->second.push_back(commandId);
+        }
+    }
+    return gatherId;
+}
+
+bool CdpCommandMultiplexer::Cancel(uint64_t id)
+{
+    auto gather = m_gathers.find(id);
+    if (gather != m_gathers.end())
+    {
+        // The last cancellation completes the gather, which removes it.
+        std::vector<uint64_t> commandIds = std::move(gather->second);
+        for (uint64_t commandId : commandIds)
+        {
+            Cancel(commandId);
+        }
+        return true;
+    }
+    if (m_commands.find(id) == m_commands.end())
+    {
+        return false;
+    }
+    CdpCommandResult result;
+    result.status = CdpCommandStatus::Canceled;
+    Complete(id, std::move(result));
+    return true;
+}
+
+void CdpCommandMultiplexer::OnCommandCompleted(
+    uint64_t commandId, int32_t error, std::wstring_view json)
+{
+    if (m_commands.find(commandId) == m_commands.end())
+    {
+        // Timed out or canceled already.
+        return;
+    }
+    CdpCommandResult result;
+    result.status = error < 0 ? CdpCommandStatus::Failed : CdpCommandStatus::Succeeded;
+    result.error = error;
+    result.json = json;
+    Complete(commandId, std::move(result));
+}
+
+void CdpCommandMultiplexer::ExpireCommands()
+{
+    std::chrono::steady_clock::time_point now = m_clock();
+    while (!m_deadlines.empty() && m_deadlines.begin()->first <= now)
+    {
+        CdpCommandResult result;
+        result.status = CdpCommandStatus::TimedOut;
+        Complete(m_deadlines.begin()->second, std::move(result));
+    }
+}
+
+std::chrono::steady_clock::time_point CdpCommandMultiplexer::GetNextDeadline() const
+{
+    return m_deadlines.empty() ? std::chrono::steady_clock::time_point::max()
+                               : m_deadlines.begin()->first;
+}
+
+void CdpCommandMultiplexer::SendQueued(std::wstring sessionId)
+{
+    // The endpoint may complete commands, and so change the sessions, before it
+    // returns, so the session is looked up again for each command.
+    while (true)
+    {
+        auto session = m_sessions.find(sessionId);
+        if (session == m_sessions.end())
+        {
+            return;
+        }
+        if (session->second.queue.empty())
+        {
+            if (session->second.inFlight == 0)
+            {
+                m_sessions.erase(session);
+            }
+            return;
+        }
+        if (session->second.inFlight >= m_options.maxInFlightPerSession)
+        {
+            return;
+        }
+        uint64_t id = session->second.queue.front();
+        session->second.queue.pop_front();
+        ++session->second.inFlight;
+        ++m_inFlightCount;
+        Command& command = m_commands.at(id);
+        command.sent = true;
+        std::wstring method = std::move(command.method);
+        std::wstring params = std::move(command.params);
+        m_endpoint(id, sessionId, method, params);
+    }
+}
+
+void CdpCommandMultiplexer::Complete(uint64_t commandId, CdpCommandResult result)
+{
+    auto found = m_commands.find(commandId);
+    if (found == m_commands.end())
+    {
+        return;
+    }
+    Command command = std::move(found->second);
+    m_commands.erase(found);
+    if (command.deadline != std::chrono::steady_clock::time_point::max())
+    {
+        m_deadlines.erase(std::make_pair(command.deadline, commandId));
+    }
+    Session& session = m_sessions.at(command.sessionId);
+    if (command.sent)
+    {
+        // A canceled or timed out command may still be running in the endpoint,
+        // but no longer holds up the commands queued behind it.
+        --session.inFlight;
+        --m_inFlightCount;
+    }
+    else
+    {
+        session.queue.erase(std::find(session.queue.begin(), session.queue.end(), commandId));
+    }
+    SendQueued(command.sessionId);
+    if (command.callback)
+    {
+        command.callback(result);
+    }
+}
@@ -0,0 +1,141 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class CdpCommandStatus
+{
+    Succeeded,
+    // The endpoint reported an error, which is then in error and json.
+    Failed,
+    TimedOut,
+    Canceled,
+};
+
+struct CdpCommandResult
+{
+    CdpCommandStatus status = CdpCommandStatus::Succeeded;
+    // The HRESULT the endpoint completed the command with, or 0 if it didn't.
+    int32_t error = 0;
+    std::wstring json;
+};
+
+// A result of CdpCommandMultiplexer::Gather(), for one session.
+struct CdpGatherResult
+{
+    std::wstring sessionId;
+    CdpCommandResult result;
+};
+
+// Tracks DevTools protocol commands sent to a WebView, to any number of
+// sessions at once, so that callers don't count their outstanding calls
+// themselves.
+//
+// Each command gets an id, which the endpoint reports back with its result
+// through OnCommandCompleted(). Up to maxInFlightPerSession commands are sent
+// to a session at once and the rest queue in order, so one busy worker doesn't
+// get flooded. A command can time out, counted from when it was sent to the
+// multiplexer, or be canceled; its callback then runs right away, and a result
+// that arrives later is dropped. Gather() sends one method to many sessions
+// and reports all the results together, once the last one is in.
+//
+// Every callback runs exactly once, and may send or cancel other commands.
+// The endpoint, which would call CallDevToolsProtocolMethodForSession, and the
+// clock are injected, so the scheduling can be driven by a simulated endpoint.
+class CdpCommandMultiplexer
+{
+public:
+    using Clock = std::function<std::chrono::steady_clock::time_point()>;
+    // Send a command to the endpoint. An empty session id is the page's own
+    // target.
+    using Endpoint = std::function<void(
+        uint64_t commandId, const std::wstring& sessionId, const std::wstring& method,
+        const std::wstring& params)>;
+    using Callback = std::function<void(const CdpCommandResult& result)>;
+    // results are in the order of the session ids passed to Gather().
+    using GatherCallback = std::function<void(std::vector<CdpGatherResult>& results)>;
+
+    struct Options
+    {
+        size_t maxInFlightPerSession = 8;
+    };
+
+    CdpCommandMultiplexer(
+        Options options, Endpoint endpoint, Clock clock = std::chrono::steady_clock::now);
+    CdpCommandMultiplexer(const CdpCommandMultiplexer&) = delete;
+    CdpCommandMultiplexer& operator=(const CdpCommandMultiplexer&) = delete;
+
+    // Send method to a session, and call callback with its result. A timeout of
+    // zero waits for as long as it takes. Returns the command's id.
+    uint64_t Send(
+        std::wstring_view sessionId, std::wstring_view method, std::wstring_view params,
+        std::chrono::milliseconds timeout, Callback callback);
+    // Send method to each session, each command with the given timeout, and call
+    // callback once all of them have completed. Returns an id that Cancel()
+    // takes to cancel all of the commands.
+    uint64_t Gather(
+        const std::vector<std::wstring>& sessionIds, std::wstring_view method,
+        std::wstring_view params, std::chrono::milliseconds timeout, GatherCallback callback);
+    // Complete a command, or the pending commands of a gather, as canceled.
+    // Returns false if the id is of nothing pending.
+    bool Cancel(uint64_t id);
+
+    // The endpoint completed a command with an HRESULT and result JSON.
+    void OnCommandCompleted(uint64_t commandId, int32_t error, std::wstring_view json);
+    // Time out every command whose timeout has passed.
+    void ExpireCommands();
+
+    // When ExpireCommands() next has something to do, or time_point::max().
+    std::chrono::steady_clock::time_point GetNextDeadline() const;
+    size_t GetPendingCount() const { return m_commands.size(); }
+    size_t GetInFlightCount() const { return m_inFlightCount; }
+    const Options& GetOptions() const { return m_options; }
+
+private:
+    struct Command
+    {
+        std::wstring sessionId;
+        // Emptied when the command is sent.
+        std::wstring method;
+        std::wstring params;
+        std::chrono::steady_clock::time_point deadline;
+        Callback callback;
+        bool sent = false;
+    };
+    struct Session
+    {
+        std::deque<uint64_t> queue;
+        size_t inFlight = 0;
+    };
+
+    // Send queued commands of a session while it has room.
+    void SendQueued(std::wstring sessionId);
+    // Forget a pending command and call its callback with result.
+    void Complete(uint64_t commandId, CdpCommandResult result);
+
+    Options m_options;
+    Endpoint m_endpoint;
+    Clock m_clock;
+
+    uint64_t m_lastId = 0;
+    std::unordered_map<uint64_t, Command> m_commands;
+    std::unordered_map<std::wstring, Session> m_sessions;
+    size_t m_inFlightCount = 0;
+    // The commands that have a timeout, soonest first.
+    std::set<std::pair<std::chrono::steady_clock::time_point, uint64_t>> m_deadlines;
+    // The commands of each gather still pending.
+    std::unordered_map<uint64_t, std::vector<uint64_t>> m_gathers;
+};
@@ -0,0 +1,209 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpEventHub.h"
+
+#include <algorithm>
+
+std::wstring_view CdpEvent::GetTargetId() const
+{
+    if (!m_targetIdResolved)
+    {
+        m_targetIdResolved = true;
+        if (m_hub->m_targetResolver)
+        {
+            m_targetId = m_hub->m_targetResolver(m_sessionId);
+        }
+    }
+    return m_targetId;
+}
+
+JsonValue CdpEvent::GetParameters() const
+{
+    if (!m_parsed)
+    {
+        m_parsed = true;
+        ++m_hub->m_stats.parses;
+        m_document->Parse(m_json);
+    }
+    // The root is missing if the parse failed.
+    return m_document->GetRoot();
+}
+
+bool CdpTargetEvent::Read(const CdpEvent& event, CdpTargetEvent* target)
+{
+    JsonValue parameters = event.GetParameters();
+    if (parameters.GetType() != JsonType::Object)
+    {
+        return false;
+    }
+    JsonValue targetInfo = parameters[L"targetInfo"];
+    target->sessionId = parameters[L"sessionId"].GetStringOr();
+    // Target.detachedFromTarget has the target's id without a targetInfo.
+    target->targetId = targetInfo.Exists() ? targetInfo[L"targetId"].GetStringOr()
+                                           : parameters[L"targetId"].GetStringOr();
+    target->type = targetInfo[L"type"].GetStringOr();
+    target->url = targetInfo[L"url"].GetStringOr();
+    return true;
+}
+
+CdpEventHub::CdpEventHub(
+    AddReceiver addReceiver, RemoveReceiver removeReceiver, TargetResolver targetResolver)
+    : m_addReceiver(std::move(addReceiver)), m_removeReceiver(std::move(removeReceiver)),
+      m_targetResolver(std::move(targetResolver))
+{
+}
+
+CdpEventHub::~CdpEventHub()
+{
+    Clear();
+}
+
+uint64_t CdpEventHub::Subscribe(
+    std::wstring_view eventName, Handler handler, CdpEventFilter filter)
+{
+    auto channel = m_channels.find(eventName);
+    if (channel == m_channels.end())
+    {
+        channel = m_channels.emplace(std::wstring(eventName), Channel()).first;
+        if (!m_addReceiver(channel->first))
+        {
+            m_channels.erase(channel);
+            return 0;
+        }
+    }
+    auto subscriber = std::make_unique<Subscriber>();
+    subscriber->id = ++m_lastId;
+    subscriber->filter = std::move(filter);
+    subscriber->handler = std::move(handler);
+    channel->second.subscribers.push_back(std::move(subscriber));
+    m_subscriptions.emplace(m_lastId, channel);
+    return m_lastId;
+}
+
+bool CdpEventHub::Unsubscribe(uint64_t id)
+{
+    auto subscription = m_subscriptions.find(id);
+    if (subscription == m_subscriptions.end())
+    {
+        return false;
+    }
+    auto channel = subscription->second;
+    m_subscriptions.erase(subscription);
+    std::vector<std::unique_ptr<Subscriber>>& subscribers = channel->second.subscribers;
+    auto subscriber = std::find_if(
+        subscribers.begin(), subscribers.end(),
+        [id](const std::unique_ptr<Subscriber>& entry) { return entry->id == id; });
+    if (m_dispatchDepth > 0)
+    {
+        // The subscriber may be running, or about to be reached by the loop.
+        (*subscriber)->removed = true;
+        ++channel->second.removedCount;
+        m_sweepNeeded = true;
+        return true;
+    }
+    subscribers.erase(subscriber);
+    if (subscribers.empty())
+    {
+        std::wstring eventName = channel->first;
+        m_channels.erase(channel);
+        m_removeReceiver(eventName);
+    }
+    return true;
+}
+
+void CdpEventHub::Clear()
+{
+    std::vector<uint64_t> ids;
+    ids.reserve(m_subscriptions.size());
+    for (const auto& subscription : m_subscriptions)
+    {
+        ids.push_back(subscription.first);
+    }
+    for (uint64_t id : ids)
+    {
+        Unsubscribe(id);
+    }
+}
+
+void CdpEventHub::Dispatch(
+    std::wstring_view eventName, std::wstring_view sessionId, std::wstring_view parametersJson)
+{
+    auto channel = m_channels.find(eventName);
+    if (channel == m_channels.end())
+    {
+        return;
+    }
+    ++m_stats.events;
+    if (m_documents.size() <= m_dispatchDepth)
+    {
+        m_documents.push_back(std::make_unique<JsonDocument>());
+    }
+    CdpEvent event(
+        this, m_documents[m_dispatchDepth].get(), channel->first, sessionId, parametersJson);
+    ++m_dispatchDepth;
+    // The channel stays put while a delivery is under way, but handlers may add
+    // subscribers, which wait for the next event.
+    std::vector<std::unique_ptr<Subscriber>>& subscribers = channel->second.subscribers;
+    size_t count = subscribers.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        Subscriber* subscriber = subscribers[i].get();
+        if (!subscriber->removed && Matches(subscriber->filter, event))
+        {
+            ++m_stats.deliveries;
+            subscriber->handler(event);
+        }
+    }
+    --m_dispatchDepth;
+    if (m_dispatchDepth == 0 && m_sweepNeeded)
+    {
+        Sweep();
+    }
+}
+
+size_t CdpEventHub::GetSubscriberCount(std::wstring_view eventName) const
+{
+    auto channel = m_channels.find(eventName);
+    if (channel == m_channels.end())
+    {
+        return 0;
+    }
+    return channel->second.subscribers.size() - channel->second.removedCount;
+}
+
+bool CdpEventHub::Matches(const CdpEventFilter& filter, const CdpEvent& event)
+{
+    return (!filter.sessionId || *filter.sessionId == event.GetSessionId()) &&
+           (!filter.targetId || *filter.targetId == event.GetTargetId());
+}
+
+void CdpEventHub::Sweep()
+{
+    m_sweepNeeded = false;
+    for (auto channel = m_channels.begin(); channel != m_channels.end();)
+    {
+        std::vector<std::unique_ptr<Subscriber>>& subscribers = channel->second.subscribers;
+        if (channel->second.removedCount > 0)
+        {
+            subscribers.erase(
+                std::remove_if(
+                    subscribers.begin(), subscribers.end(),
+                    [](const std::unique_ptr<Subscriber>& subscriber)
+                    { return subscriber->removed; }),
+                subscribers.end());
+            channel->second.removedCount = 0;
+        }
+        if (subscribers.empty())
+        {
+            std::wstring eventName = channel->first;
+            channel = m_channels.erase(channel);
+            m_removeReceiver(eventName);
+        }
+        else
+        {
+            ++channel;
+        }
+    }
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JsonReader.h"
+
+class CdpEventHub;
+
+// Which events a subscriber gets. Unset fields match every event.
+struct CdpEventFilter
+{
+    // Empty for the page's own target.
+    std::optional<std::wstring> sessionId;
+    std::optional<std::wstring> targetId;
+};
+
+// A DevTools protocol event, as delivered to subscribers. It and everything
+// read from it are only valid during the delivery.
+class CdpEvent
+{
+public:
+    std::wstring_view GetName() const { return m_name; }
+    // Empty for the page's own target.
+    std::wstring_view GetSessionId() const { return m_sessionId; }
+    // The target of the session, or empty if it isn't known.
+    std::wstring_view GetTargetId() const;
+    std::wstring_view GetParametersJson() const { return m_json; }
+    // The parameters, parsed the first time any subscriber asks, or a missing
+    // value if they aren't valid JSON.
+    JsonValue GetParameters() const;
+
+private:
+    friend class CdpEventHub;
+
+    CdpEvent(
+        const CdpEventHub* hub, JsonDocument* document, std::wstring_view name,
+        std::wstring_view sessionId, std::wstring_view json)
+        : m_hub(hub), m_document(document), m_name(name), m_sessionId(sessionId), m_json(json)
+    {
+    }
+
+    const CdpEventHub* m_hub;
+    JsonDocument* m_document;
+    std::wstring_view m_name;
+    std::wstring_view m_sessionId;
+    std::wstring_view m_json;
+    mutable std::wstring_view m_targetId;
+    mutable bool m_targetIdResolved = false;
+    mutable bool m_parsed = false;
+};
+
+// The fields of the Target domain's events that name a target, such as
+// Target.attachedToTarget and Target.targetInfoChanged. Fields the event
+// doesn't have are empty.
+struct CdpTargetEvent
+{
+    std::wstring_view sessionId;
+    std::wstring_view targetId;
+    std::wstring_view type;
+    std::wstring_view url;
+
+    // Returns false if the parameters aren't a JSON object.
+    static bool Read(const CdpEvent& event, CdpTargetEvent* target);
+};
+
+// Delivers DevTools protocol events to any number of subscribers through one
+// receiver per event name, so that an event is received and parsed once however
+// many tools want it.
+//
+// The first subscriber to an event adds its receiver, through the injected
+// AddReceiver, and the last one to leave removes it. Each subscriber can be
+// limited to a session or target; the target of a session is looked up through
+// the injected TargetResolver, once per event. Subscribers can subscribe and
+// unsubscribe from their handlers, and an event dispatched from a handler, as
+// from a nested message loop, is delivered in full. Subscribers added during a
+// delivery get the next event.
+//
+// The receivers, which would call add_DevToolsProtocolEventReceived, are
+// injected.
+class CdpEventHub
+{
+public:
+    // Start receiving an event. Returns false if it can't be received.
+    using AddReceiver = std::function<bool(const std::wstring& eventName)>;
+    using RemoveReceiver = std::function<void(const std::wstring& eventName)>;
+    // The target of an attached session, or empty if it isn't known.
+    using TargetResolver = std::function<std::wstring_view(std::wstring_view sessionId)>;
+    using Handler = std::function<void(const CdpEvent& event)>;
+
+    struct Stats
+    {
+        uint64_t events = 0;
+        uint64_t deliveries = 0;
+        uint64_t parses = 0;
+    };
+
+    CdpEventHub(
+        AddReceiver addReceiver, RemoveReceiver removeReceiver,
+        TargetResolver targetResolver = nullptr);
+    // Removes every receiver still added.
+    ~CdpEventHub();
+    CdpEventHub(const CdpEventHub&) = delete;
+    CdpEventHub& operator=(const CdpEventHub&) = delete;
+
+    // Call handler with each event of the given name that passes the filter.
+    // Returns the subscription's id, or 0 if the event's receiver couldn't be
+    // added.
+    uint64_t Subscribe(std::wstring_view eventName, Handler handler, CdpEventFilter filter = {});
+    // Call handler with each event read as an Event, which has a
+    // static bool Read(const CdpEvent&, Event*). Events that can't be read are
+    // skipped.
+    template <typename Event, typename TypedHandler>
+    uint64_t SubscribeAs(
+        std::wstring_view eventName, TypedHandler handler, CdpEventFilter filter = {})
+    {
+        return Subscribe(
+            eventName,
+            [handler = std::move(handler)](const CdpEvent& event)
+            {
+                Event typed;
+                if (Event::Read(event, &typed))
+                {
+                    handler(typed);
+                }
+            },
+            std::move(filter));
+    }
+    // Returns false if the id is of no subscription.
+    bool Unsubscribe(uint64_t id);
+    // Unsubscribe everyone, and remove every receiver.
+    void Clear();
+
+    // A receiver got an event: deliver it to the subscribers.
+    void Dispatch(
+        std::wstring_view eventName, std::wstring_view sessionId, std::wstring_view parametersJson);
+
+    size_t GetSubscriberCount(std::wstring_view eventName) const;
+    size_t GetReceiverCount() const { return m_channels.size(); }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    friend class CdpEvent;
+
+    struct Subscriber
+    {
+        uint64_t id = 0;
+        CdpEventFilter filter;
+        Handler handler;
+        // Set by Unsubscribe() during a delivery, and swept up after it.
+        bool removed = false;
+    };
+    // The subscribers to one event name. They are held by pointer, so that a
+    // handler isn't moved while it runs.
+    struct Channel
+    {
+        std::vector<std::unique_ptr<Subscriber>> subscribers;
+        size_t removedCount = 0;
+    };
+    using ChannelMap = std::map<std::wstring, Channel, std::less<>>;
+
+    static bool Matches(const CdpEventFilter& filter, const CdpEvent& event);
+    // Drop the subscribers unsubscribed during deliveries, and the receivers
+    // left without subscribers.
+    void Sweep();
+
+    AddReceiver m_addReceiver;
+    RemoveReceiver m_removeReceiver;
+    TargetResolver m_targetResolver;
+
+    uint64_t m_lastId = 0;
+    ChannelMap m_channels;
+    // The channel of each subscription.
+    std::unordered_map<uint64_t, ChannelMap::iterator> m_subscriptions;
+    // How many deliveries are under way, and a document for each, so that a
+    // nested dispatch doesn't reparse over an outer one.
+    size_t m_dispatchDepth = 0;
+    std::vector<std::unique_ptr<JsonDocument>> m_documents;
+    bool m_sweepNeeded = false;
+    mutable Stats m_stats;
+};
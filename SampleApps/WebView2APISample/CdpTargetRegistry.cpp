@@ -0,0 +1,301 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpTargetRegistry.h"
+
+#include <algorithm>
+
+namespace
+{
+// Removed strings are dropped from the character buffer once there are at
+// least this many characters of them, and they are more than half of it.
+constexpr size_t c_minCompactedChars = 4096;
+// Hash tables grow to keep at most 3/4 of their entries in use.
+constexpr size_t c_minIndexSize = 16;
+} // namespace
+
+uint32_t CdpTargetRegistry::Hash(std::wstring_view id)
+{
+    // FNV-1a over the UTF-16 code units, with a final mix so that the low bits,
+    // which pick the bucket, depend on every character.
+    uint32_t hash = 2166136261u;
+    for (wchar_t c : id)
+    {
+        hash = (hash ^ static_cast<uint32_t>(c)) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+CdpTargetRegistry::StringRef CdpTargetRegistry::AddString(std::wstring_view string)
+{
+    StringRef added;
+    added.offset = static_cast<uint32_t>(m_chars.size());
+    added.length = static_cast<uint32_t>(string.size());
+    m_chars.insert(m_chars.end(), string.begin(), string.end());
+    return added;
+}
+
+void CdpTargetRegistry::RemoveString(StringRef string)
+{
+    m_removedChars += string.length;
+}
+
+void CdpTargetRegistry::CompactStrings()
+{
+    if (m_removedChars < c_minCompactedChars || m_removedChars * 2 < m_chars.size())
+    {
+        return;
+    }
+    std::vector<wchar_t> chars;
+    chars.reserve(m_chars.size() - m_removedChars);
+    auto move = [&](StringRef& string)
+    {
+        const wchar_t* begin = m_chars.data() + string.offset;
+        string.offset = static_cast<uint32_t>(chars.size());
+        chars.insert(chars.end(), begin, begin + string.length);
+    };
+    for (SessionSlot& session : m_sessions)
+    {
+        if (session.target != c_noSlot)
+        {
+            move(session.id);
+        }
+    }
+    for (TargetSlot& target : m_targets)
+    {
+        if (target.sessionCount != 0)
+        {
+            move(target.id);
+            move(target.label);
+        }
+    }
+    m_chars.swap(chars);
+    m_removedChars = 0;
+}
+
+template <typename Slot>
+uint32_t CdpTargetRegistry::FindSlot(
+    const std::vector<IndexEntry>& index, const std::vector<Slot>& slots, uint32_t hash,
+    std::wstring_view id) const
+{
+    if (index.empty())
+    {
+        return c_noSlot;
+    }
+    size_t mask = index.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const IndexEntry& entry = index[i];
+        if (entry.slot == c_noSlot)
+        {
+            return c_noSlot;
+        }
+        if (entry.hash == hash && GetString(slots[entry.slot].id) == id)
+        {
+            return entry.slot;
+        }
+    }
+}
+
+void CdpTargetRegistry::AddToIndex(
+    std::vector<IndexEntry>& index, size_t& count, uint32_t hash, uint32_t slot)
+{
+    if ((count + 1) * 4 > index.size() * 3)
+    {
+        std::vector<IndexEntry> grown((std::max)(c_minIndexSize, index.size() * 2));
+        size_t mask = grown.size() - 1;
+        for (const IndexEntry& entry : index)
+        {
+            if (entry.slot != c_noSlot)
+            {
+                size_t i = entry.hash & mask;
+                while (grown[i].slot != c_noSlot)
+                {
+                    i = (i + 1) & mask;
+                }
+                grown[i] = entry;
+            }
+        }
+        index.swap(grown);
+    }
+    size_t mask = index.size() - 1;
+    size_t i = hash & mask;
+    while (index[i].slot != c_noSlot)
+    {
+        i = (i + 1) & mask;
+    }
+    index[i].hash = hash;
+    index[i].slot = slot;
+    ++count;
+}
+
+void CdpTargetRegistry::RemoveFromIndex(
+    std::vector<IndexEntry>& index, size_t& count, uint32_t hash, uint32_t slot)
+{
+    size_t mask = index.size() - 1;
+    size_t hole = hash & mask;
+    while (index[hole].slot != slot)
+    {
+        hole = (hole + 1) & mask;
+    }
+    // Move back each following entry that the hole would stop a lookup from
+    // reaching, so that no tombstones are needed.
+    for (size_t i = (hole + 1) & mask; index[i].slot != c_noSlot; i = (i + 1) & mask)
+    {
+        size_t home = index[i].hash & mask;
+        bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable)
+        {
+            index[hole] = index[i];
+            hole = i;
+        }
+    }
+    index[hole] = IndexEntry();
+    --count;
+}
+
+uint32_t CdpTargetRegistry::AddTarget(
+    std::wstring_view targetId, uint32_t hash, std::wstring_view label)
+{
+    uint32_t target;
+    if (m_freeTargets.empty())
+    {
+        target = static_cast<uint32_t>(m_targets.size());
+        m_targets.emplace_back();
+    }
+    else
+    {
+        target = m_freeTargets.back();
+        m_freeTargets.pop_back();
+    }
+    m_targets[target].id = AddString(targetId);
+    m_targets[target].label = AddString(label);
+    AddToIndex(m_targetIndex, m_targetIndexCount, hash, target);
+    return target;
+}
+
+void CdpTargetRegistry::ReleaseTarget(uint32_t target)
+{
+    TargetSlot& slot = m_targets[target];
+    if (--slot.sessionCount != 0)
+    {
+        return;
+    }
+    RemoveFromIndex(m_targetIndex, m_targetIndexCount, Hash(GetString(slot.id)), target);
+    RemoveString(slot.id);
+    RemoveString(slot.label);
+    slot = TargetSlot();
+    m_freeTargets.push_back(target);
+}
+
+CdpSessionHandle CdpTargetRegistry::AttachSession(
+    std::wstring_view sessionId, std::wstring_view targetId, std::wstring_view label)
+{
+    uint32_t targetHash = Hash(targetId);
+    uint32_t target = FindSlot(m_targetIndex, m_targets, targetHash, targetId);
+    if (target == c_noSlot)
+    {
+        target = AddTarget(targetId, targetHash, label);
+    }
+    else if (GetString(m_targets[target].label) != label)
+    {
+        RemoveString(m_targets[target].label);
+        m_targets[target].label = AddString(label);
+    }
+    ++m_targets[target].sessionCount;
+
+    uint32_t sessionHash = Hash(sessionId);
+    uint32_t session = FindSlot(m_sessionIndex, m_sessions, sessionHash, sessionId);
+    if (session != c_noSlot)
+    {
+        // The count was taken for the session above, so releasing its previous
+        // target keeps the new one even if they are the same.
+        ReleaseTarget(m_sessions[session].target);
+        m_sessions[session].target = target;
+    }
+    else
+    {
+        if (m_freeSessions.empty())
+        {
+            session = static_cast<uint32_t>(m_sessions.size());
+            m_sessions.emplace_back();
+        }
+        else
+        {
+            session = m_freeSessions.back();
+            m_freeSessions.pop_back();
+        }
+        m_sessions[session].id = AddString(sessionId);
+        m_sessions[session].target = target;
+        AddToIndex(m_sessionIndex, m_sessionIndexCount, sessionHash, session);
+    }
+    CompactStrings();
+    return CdpSessionHandle{session, m_sessions[session].generation};
+}
+
+bool CdpTargetRegistry::DetachSession(std::wstring_view sessionId)
+{
+    uint32_t hash = Hash(sessionId);
+    uint32_t session = FindSlot(m_sessionIndex, m_sessions, hash, sessionId);
+    if (session == c_noSlot)
+    {
+        return false;
+    }
+    SessionSlot& slot = m_sessions[session];
+    RemoveFromIndex(m_sessionIndex, m_sessionIndexCount, hash, session);
+    RemoveString(slot.id);
+    ReleaseTarget(slot.target);
+    slot.id = StringRef();
+    slot.target = c_noSlot;
+    ++slot.generation;
+    m_freeSessions.push_back(session);
+    CompactStrings();
+    return true;
+}
+
+bool CdpTargetRegistry::SetTargetLabel(std::wstring_view targetId, std::wstring_view label)
+{
+    uint32_t target = FindSlot(m_targetIndex, m_targets, Hash(targetId), targetId);
+    if (target == c_noSlot)
+    {
+        return false;
+    }
+    if (GetString(m_targets[target].label) != label)
+    {
+        RemoveString(m_targets[target].label);
+        m_targets[target].label = AddString(label);
+        CompactStrings();
+    }
+    return true;
+}
+
+CdpSessionHandle CdpTargetRegistry::FindSession(std::wstring_view sessionId) const
+{
+    uint32_t session = FindSlot(m_sessionIndex, m_sessions, Hash(sessionId), sessionId);
+    if (session == c_noSlot)
+    {
+        return CdpSessionHandle();
+    }
+    return CdpSessionHandle{session, m_sessions[session].generation};
+}
+
+std::wstring_view CdpTargetRegistry::GetSessionId(CdpSessionHandle session) const
+{
+    return IsValid(session) ? GetString(m_sessions[session.index].id) : std::wstring_view();
+}
+
+std::wstring_view CdpTargetRegistry::GetTargetId(CdpSessionHandle session) const
+{
+    return IsValid(session) ? GetString(m_targets[m_sessions[session.index].target].id)
+                            : std::wstring_view();
+}
+
+std::wstring_view CdpTargetRegistry::GetTargetLabel(CdpSessionHandle session) const
+{
+    return IsValid(session) ? GetString(m_targets[m_sessions[session.index].target].label)
+                            : std::wstring_view();
+}
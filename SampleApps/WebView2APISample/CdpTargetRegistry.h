@@ -0,0 +1,151 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Names a session in a CdpTargetRegistry. A handle stays valid until its
+// session detaches; the registry then rejects it, even once the slot it named
+// holds another session.
+struct CdpSessionHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsNull() const { return index == UINT32_MAX; }
+};
+
+// The DevTools protocol sessions a WebView is attached to, and the targets
+// (such as workers and iframes) they are attached to, each with a label for
+// messages, such as "<target type>,<target url>".
+//
+// Session and target ids are interned into slots that are found through
+// open-addressing hash tables, and the ids and labels are kept together in one
+// character buffer. Finding a session and reading its label allocate nothing,
+// so they can be done for every event. Views returned by the registry are
+// invalidated by the next change to it.
+//
+// Several sessions may be attached to one target; the target is forgotten when
+// its last session detaches.
+class CdpTargetRegistry
+{
+public:
+    CdpTargetRegistry() = default;
+    CdpTargetRegistry(const CdpTargetRegistry&) = delete;
+    CdpTargetRegistry& operator=(const CdpTargetRegistry&) = delete;
+
+    // Record that sessionId is attached to targetId, and set the target's label.
+    // A session that is already attached moves to targetId and keeps its handle.
+    CdpSessionHandle AttachSession(
+        std::wstring_view sessionId, std::wstring_view targetId, std::wstring_view label);
+    // Forget a session, and its target if no other session is attached to it.
+    // Returns false if the session isn't attached.
+    bool DetachSession(std::wstring_view sessionId);
+    // Returns false if no session is attached to the target.
+    bool SetTargetLabel(std::wstring_view targetId, std::wstring_view label);
+
+    // The handle of an attached session, or a null handle.
+    CdpSessionHandle FindSession(std::wstring_view sessionId) const;
+    bool IsValid(CdpSessionHandle session) const
+    {
+        return session.index < m_sessions.size() &&
+               m_sessions[session.index].generation == session.generation &&
+               m_sessions[session.index].target != c_noSlot;
+    }
+    // Each is empty for a null or stale handle.
+    std::wstring_view GetSessionId(CdpSessionHandle session) const;
+    std::wstring_view GetTargetId(CdpSessionHandle session) const;
+    std::wstring_view GetTargetLabel(CdpSessionHandle session) const;
+
+    size_t GetSessionCount() const { return m_sessionIndexCount; }
+    size_t GetTargetCount() const { return m_targetIndexCount; }
+
+    // Call visitor(handle) for each attached session.
+    template <typename Visitor> void ForEachSession(Visitor&& visitor) const
+    {
+        for (uint32_t i = 0; i < m_sessions.size(); ++i)
+        {
+            if (m_sessions[i].target != c_noSlot)
+            {
+                visitor(CdpSessionHandle{i, m_sessions[i].generation});
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t c_noSlot = UINT32_MAX;
+
+    // A string in m_chars.
+    struct StringRef
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    struct SessionSlot
+    {
+        StringRef id;
+        // The slot of the session's target, or c_noSlot if the slot is free.
+        uint32_t target = c_noSlot;
+        // Incremented when the session detaches, to make its handles stale.
+        uint32_t generation = 0;
+    };
+    struct TargetSlot
+    {
+        StringRef id;
+        StringRef label;
+        // 0 if the slot is free.
+        uint32_t sessionCount = 0;
+    };
+    // An entry of a hash table from ids to slots, which is empty if slot is
+    // c_noSlot. The hash is kept so that the table can grow, and entries can be
+    // removed, without reading the ids.
+    struct IndexEntry
+    {
+        uint32_t hash = 0;
+        uint32_t slot = c_noSlot;
+    };
+
+    static uint32_t Hash(std::wstring_view id);
+
+    std::wstring_view GetString(StringRef string) const
+    {
+        return std::wstring_view(m_chars.data() + string.offset, string.length);
+    }
+    StringRef AddString(std::wstring_view string);
+    void RemoveString(StringRef string);
+    // Rebuild m_chars without removed strings once they make up most of it.
+    void CompactStrings();
+
+    // The slot whose id is the given one, through index, or c_noSlot.
+    template <typename Slot>
+    uint32_t FindSlot(
+        const std::vector<IndexEntry>& index, const std::vector<Slot>& slots, uint32_t hash,
+        std::wstring_view id) const;
+    static void AddToIndex(
+        std::vector<IndexEntry>& index, size_t& count, uint32_t hash, uint32_t slot);
+    static void RemoveFromIndex(
+        std::vector<IndexEntry>& index, size_t& count, uint32_t hash, uint32_t slot);
+
+    uint32_t AddTarget(std::wstring_view targetId, uint32_t hash, std::wstring_view label);
+    void ReleaseTarget(uint32_t target);
+
+    std::vector<SessionSlot> m_sessions;
+    std::vector<uint32_t> m_freeSessions;
+    std::vector<IndexEntry> m_sessionIndex;
+    size_t m_sessionIndexCount = 0;
+
+    std::vector<TargetSlot> m_targets;
+    std::vector<uint32_t> m_freeTargets;
+    std::vector<IndexEntry> m_targetIndex;
+    size_t m_targetIndexCount = 0;
+
+    // Every id and label, one after the other.
+    std::vector<wchar_t> m_chars;
+    // How many characters of m_chars belong to removed strings.
+    size_t m_removedChars = 0;
+};
@@ -0,0 +1,486 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ConsoleLogPipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <new>
+
+#include "EventTrace.h"
+
+namespace
+{
+// Lines are written once this much is buffered, even while the queue is busy.
+constexpr size_t c_maxBufferSize = 64 * 1024;
+// The length of "YYYY-MM-DDThh:mm:ss.sssZ".
+constexpr size_t c_timestampLength = 24;
+
+double GetMillisecondsSince1970()
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count());
+}
+
+// Append time, in milliseconds since 1970, in UTC as c_timestampLength
+// characters. The date is worked out as in Howard Hinnant's civil_from_days.
+void AppendTimestamp(std::string& out, double time)
+{
+    int64_t milliseconds = std::isfinite(time) ? static_cast<int64_t>(std::floor(time)) : 0;
+    int64_t days = milliseconds / 86400000;
+    int64_t millisecondOfDay = milliseconds % 86400000;
+    if (millisecondOfDay < 0)
+    {
+        millisecondOfDay += 86400000;
+        --days;
+    }
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t dayOfEra = z - era * 146097;
+    int64_t yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+    int64_t day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    int64_t month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    int64_t year = yearOfEra + era * 400 + (month <= 2);
+    // Years outside 0 to 9999 would need more characters.
+    year = (std::min)((std::max)(year, int64_t(0)), int64_t(9999));
+
+    char text[c_timestampLength + 1];
+    snprintf(
+        text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", static_cast<int>(year),
+        static_cast<int>(month), static_cast<int>(day),
+        static_cast<int>(millisecondOfDay / 3600000),
+        static_cast<int>(millisecondOfDay / 60000 % 60),
+        static_cast<int>(millisecondOfDay / 1000 % 60),
+        static_cast<int>(millisecondOfDay % 1000));
+    out.append(text, c_timestampLength);
+}
+} // namespace
+
+// A queued event: the node is followed in the same allocation by the source
+// label and then the parameters.
+struct ConsoleLogPipeline::Node
+{
+    std::atomic<Node*> next{nullptr};
+    uint32_t sourceLength = 0;
+    uint32_t jsonLength = 0;
+
+    const wchar_t* GetChars() const { return reinterpret_cast<const wchar_t*>(this + 1); }
+    wchar_t* GetChars() { return reinterpret_cast<wchar_t*>(this + 1); }
+};
+
+ConsoleLogPipeline::ConsoleLogPipeline(Options options) : m_options(std::move(options))
+{
+    m_stub = new (::operator new(sizeof(Node))) Node();
+    m_head.store(m_stub, std::memory_order_relaxed);
+    m_tail = m_stub;
+
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(m_options.path, error);
+    m_fileSize = error ? 0 : size;
+    m_file.open(m_options.path, std::ios::binary | std::ios::app);
+
+    m_thread = std::thread([this] { Run(); });
+}
+
+ConsoleLogPipeline::~ConsoleLogPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    // Every event has been taken, which leaves the stub at the tail.
+    FreeNode(m_tail);
+}
+
+bool ConsoleLogPipeline::Push(std::wstring_view source, std::wstring_view parametersJson)
+{
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    // Check before allocating, so that a full queue costs as little as possible.
+    if (m_pending.load(std::memory_order_relaxed) >= m_options.queueCapacity)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t length = source.size() + parametersJson.size();
+    Node* node = new (::operator new(sizeof(Node) + length * sizeof(wchar_t))) Node();
+    node->sourceLength = static_cast<uint32_t>(source.size());
+    node->jsonLength = static_cast<uint32_t>(parametersJson.size());
+    std::copy(source.begin(), source.end(), node->GetChars());
+    std::copy(parametersJson.begin(), parametersJson.end(), node->GetChars() + source.size());
+
+    size_t pending = m_pending.fetch_add(1, std::memory_order_acq_rel);
+    if (pending >= m_options.queueCapacity)
+    {
+        m_pending.fetch_sub(1, std::memory_order_relaxed);
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        FreeNode(node);
+        return false;
+    }
+    Enqueue(node);
+    if (pending == 0)
+    {
+        // The writer thread may be waiting. Taking the lock makes sure it is
+        // either waiting already or will see the count.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+ConsoleLogPipeline::Stats ConsoleLogPipeline::GetStats() const
+{
+    Stats stats;
+    stats.received = m_received.load(std::memory_order_relaxed);
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    stats.repeated = m_repeated.load(std::memory_order_relaxed);
+    stats.rateLimited = m_rateLimited.load(std::memory_order_relaxed);
+    stats.linesWritten = m_linesWritten.load(std::memory_order_relaxed);
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.rotations = m_rotations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ConsoleLogPipeline::Enqueue(Node* node)
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+    // Until this store, the writer thread can't see the node or any after it.
+    previous->next.store(node, std::memory_order_release);
+}
+
+ConsoleLogPipeline::Node* ConsoleLogPipeline::Dequeue()
+{
+    Node* tail = m_tail;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == m_stub)
+    {
+        if (!next)
+        {
+            return nullptr;
+        }
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+    if (tail != m_head.load(std::memory_order_acquire))
+    {
+        // A producer has swapped in a node but not linked it yet.
+        return nullptr;
+    }
+    // tail is the last node. Put the stub behind it, so that it can be taken.
+    Enqueue(m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+void ConsoleLogPipeline::FreeNode(Node* node)
+{
+    node->~Node();
+    ::operator delete(node);
+}
+
+void ConsoleLogPipeline::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        bool ready = m_wake.wait_for(
+            lock, m_options.idleFlushInterval,
+            [this] { return m_stopping || m_pending.load(std::memory_order_acquire) > 0; });
+        bool stopping = m_stopping;
+        lock.unlock();
+
+        if (ready)
+        {
+            while (m_pending.load(std::memory_order_acquire) > 0)
+            {
+                Node* node = Dequeue();
+                if (!node)
+                {
+                    // A producer is between counting its event and linking it.
+                    std::this_thread::yield();
+                    continue;
+                }
+                Process(*node);
+                FreeNode(node);
+                m_pending.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+        else
+        {
+            FlushNotes();
+        }
+        NoteDropped();
+        if (stopping)
+        {
+            FlushNotes();
+        }
+        WriteBuffer();
+        m_file.flush();
+        if (stopping)
+        {
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void ConsoleLogPipeline::Process(const Node& node)
+{
+    const wchar_t* chars = node.GetChars();
+    m_source.resize(node.sourceLength * size_t(4));
+    m_source.resize(WriteUtf8(std::wstring_view(chars, node.sourceLength), &m_source[0]));
+    m_utf8.resize(node.jsonLength * size_t(4));
+    m_utf8.resize(WriteUtf8(
+        std::wstring_view(chars + node.sourceLength, node.jsonLength), &m_utf8[0]));
+    Format();
+
+    if (!m_lastText.empty() && m_text == m_lastText && m_source == m_lastSource)
+    {
+        ++m_repeats;
+        m_repeated.fetch_add(1, std::memory_order_relaxed);
+        m_lastTime = m_time;
+        return;
+    }
+    FlushRepeats();
+    if (!Admit(m_source))
+    {
+        m_rateLimited.fetch_add(1, std::memory_order_relaxed);
+        // Repeats of a message that wasn't written are rate limited too.
+        m_lastText.clear();
+        return;
+    }
+    WriteLine(m_source, m_time, m_text);
+    m_lastSource = m_source;
+    m_lastText = m_text;
+    m_lastTime = m_time;
+}
+
+void ConsoleLogPipeline::Format()
+{
+    m_text.clear();
+    if (!m_index.Build(m_utf8))
+    {
+        m_text = m_utf8;
+        m_time = GetMillisecondsSince1970();
+        return;
+    }
+    // The arguments can carry large previews of objects; only the fields that
+    // are shown are read.
+    JsonIndexedValue root = m_index.GetRoot();
+    if (!root["timestamp"].GetDouble(&m_time))
+    {
+        m_time = GetMillisecondsSince1970();
+    }
+    m_text += root["type"].GetStringOr("log");
+    m_text += ':';
+    root["args"].ForEachElement(
+        [this](JsonIndexedValue arg)
+        {
+            // A RemoteObject: primitives have a value, or an unserializableValue
+            // such as "NaN"; objects have a description.
+            m_text += ' ';
+            JsonIndexedValue value = arg["value"];
+            std::string_view string;
+            if (value.GetString(&string))
+            {
+                m_text += string;
+            }
+            else if (value.Exists())
+            {
+                m_text += value.GetRawJson();
+            }
+            else if (
+                arg["unserializableValue"].GetString(&string) ||
+                arg["description"].GetString(&string) || arg["type"].GetString(&string))
+            {
+                m_text += string;
+            }
+            return true;
+        });
+}
+
+bool ConsoleLogPipeline::Admit(const std::string& source)
+{
+    if (m_options.messagesPerSecond <= 0)
+    {
+        return true;
+    }
+    auto found = m_sources.find(source);
+    if (found == m_sources.end())
+    {
+        SourceState state;
+        state.tokens = m_options.burstMessages;
+        state.refillTime = m_time;
+        found = m_sources.emplace(source, state).first;
+    }
+    SourceState& state = found->second;
+    if (m_time > state.refillTime)
+    {
+        state.tokens = (std::min)(
+            m_options.burstMessages,
+            state.tokens + (m_time - state.refillTime) / 1000 * m_options.messagesPerSecond);
+        state.refillTime = m_time;
+    }
+    if (state.tokens < 1)
+    {
+        ++state.suppressed;
+        return false;
+    }
+    state.tokens -= 1;
+    if (state.suppressed > 0)
+    {
+        WriteLine(
+            source, m_time,
+            "(" + std::to_string(state.suppressed) + " messages suppressed by rate limit)");
+        state.suppressed = 0;
+    }
+    return true;
+}
+
+void ConsoleLogPipeline::FlushRepeats()
+{
+    if (m_repeats > 0)
+    {
+        WriteLine(
+            m_lastSource, m_lastTime,
+            "(last message repeated " + std::to_string(m_repeats) + " more times)");
+        m_repeats = 0;
+    }
+}
+
+void ConsoleLogPipeline::FlushNotes()
+{
+    FlushRepeats();
+    double now = GetMillisecondsSince1970();
+    for (auto source = m_sources.begin(); source != m_sources.end();)
+    {
+        SourceState& state = source->second;
+        if (state.suppressed > 0)
+        {
+            WriteLine(
+                source->first, now,
+                "(" + std::to_string(state.suppressed) + " messages suppressed by rate limit)");
+            state.suppressed = 0;
+        }
+        // A source whose bucket has filled up again is as good as new.
+        double refilled =
+            state.tokens + (now - state.refillTime) / 1000 * m_options.messagesPerSecond;
+        if (refilled >= m_options.burstMessages)
+        {
+            source = m_sources.erase(source);
+        }
+        else
+        {
+            ++source;
+        }
+    }
+}
+
+void ConsoleLogPipeline::NoteDropped()
+{
+    uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped > m_droppedNoted)
+    {
+        WriteLine(
+            std::string_view(), GetMillisecondsSince1970(),
+            "(" + std::to_string(dropped - m_droppedNoted) +
+                " messages dropped because the log queue was full)");
+        m_droppedNoted = dropped;
+    }
+}
+
+void ConsoleLogPipeline::WriteLine(std::string_view source, double time, std::string_view text)
+{
+    size_t length = c_timestampLength + 1 + text.size() + 2;
+    if (!source.empty())
+    {
+        length += source.size() + 8;
+    }
+    uint64_t size = m_fileSize + m_buffer.size();
+    if (size > 0 && size + length > m_options.maxFileBytes)
+    {
+        WriteBuffer();
+        Rotate();
+    }
+
+    size_t start = m_buffer.size();
+    AppendTimestamp(m_buffer, time);
+    m_buffer += ' ';
+    if (!source.empty())
+    {
+        m_buffer += "(from ";
+        m_buffer += source;
+        m_buffer += ") ";
+    }
+    m_buffer += text;
+    m_buffer += "\r\n";
+    m_linesWritten.fetch_add(1, std::memory_order_relaxed);
+    m_bytesWritten.fetch_add(length, std::memory_order_relaxed);
+    if (m_options.echo)
+    {
+        m_options.echo(std::string_view(m_buffer).substr(start));
+    }
+    if (m_buffer.size() >= c_maxBufferSize)
+    {
+        WriteBuffer();
+    }
+}
+
+void ConsoleLogPipeline::WriteBuffer()
+{
+    if (m_buffer.empty())
+    {
+        return;
+    }
+    m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+    m_fileSize += m_buffer.size();
+    m_buffer.clear();
+}
+
+void ConsoleLogPipeline::Rotate()
+{
+    m_file.close();
+    std::error_code error;
+    if (m_options.maxFiles > 1)
+    {
+        std::filesystem::remove(GetRotatedPath(m_options.maxFiles - 1), error);
+        for (size_t i = m_options.maxFiles - 1; i > 1; --i)
+        {
+            std::filesystem::rename(GetRotatedPath(i - 1), GetRotatedPath(i), error);
+        }
+        std::filesystem::rename(m_options.path, GetRotatedPath(1), error);
+    }
+    m_file.clear();
+    m_file.open(m_options.path, std::ios::binary | std::ios::trunc);
+    m_fileSize = 0;
+    m_rotations.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::filesystem::path ConsoleLogPipeline::GetRotatedPath(size_t index) const
+{
+    std::filesystem::path rotated = m_options.path;
+    rotated.replace_extension();
+    rotated += "." + std::to_string(index);
+    rotated += m_options.path.extension();
+    return rotated;
+}
@@ -0,0 +1,152 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "JsonStructuralIndex.h"
+
+// Writes Runtime.consoleAPICalled events to a log file on a thread of its own,
+// so that a page that logs a lot doesn't slow down the thread that receives
+// the events.
+//
+// Push() copies the event's parameters into a node of a lock-free queue that
+// any number of threads may push to, and only takes a lock to wake the writer
+// thread when the queue was empty. Once the queue holds queueCapacity events,
+// further events are dropped and counted. The writer thread then formats each
+// event as the DevTools console would show it, and
+// - collapses a run of identical messages from one source into the first and
+//   a count, written when the run ends or the queue has been idle for a while;
+// - lets each source log at most messagesPerSecond messages by the console's
+//   timestamps, with bursts of up to burstMessages, and counts the rest;
+// - appends lines to a UTF-8 log file, which is renamed to <name>.1<ext> once
+//   it would grow past maxFileBytes, keeping the latest maxFiles files.
+// Dropped, repeated and rate-limited messages are noted in the log.
+class ConsoleLogPipeline
+{
+public:
+    struct Options
+    {
+        std::filesystem::path path;
+        uint64_t maxFileBytes = 4 * 1024 * 1024;
+        // The log file and the rotated files before it.
+        size_t maxFiles = 4;
+        size_t queueCapacity = 64 * 1024;
+        double messagesPerSecond = 200;
+        double burstMessages = 1000;
+        // How long the queue must be idle before pending counts are written.
+        std::chrono::milliseconds idleFlushInterval{1000};
+        // Called on the writer thread with each line written, if set.
+        std::function<void(std::string_view line)> echo;
+    };
+
+    struct Stats
+    {
+        uint64_t received = 0;
+        // Not queued because the queue was full.
+        uint64_t dropped = 0;
+        uint64_t repeated = 0;
+        uint64_t rateLimited = 0;
+        uint64_t linesWritten = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t rotations = 0;
+    };
+
+    explicit ConsoleLogPipeline(Options options);
+    // Writes every queued event before returning.
+    ~ConsoleLogPipeline();
+    ConsoleLogPipeline(const ConsoleLogPipeline&) = delete;
+    ConsoleLogPipeline& operator=(const ConsoleLogPipeline&) = delete;
+
+    // Queue the parameters of a Runtime.consoleAPICalled event, and a label for
+    // its source, which is empty for the page itself. Returns false if the
+    // event was dropped.
+    bool Push(std::wstring_view source, std::wstring_view parametersJson);
+
+    Stats GetStats() const;
+    const Options& GetOptions() const { return m_options; }
+
+private:
+    struct Node;
+    struct SourceState
+    {
+        double tokens = 0;
+        // The console timestamp the tokens were last counted at.
+        double refillTime = 0;
+        uint64_t suppressed = 0;
+    };
+
+    // The queue, after Dmitry Vyukov's intrusive MPSC queue. Producers swap
+    // themselves into m_head; the writer thread takes nodes from m_tail.
+    void Enqueue(Node* node);
+    Node* Dequeue();
+    static void FreeNode(Node* node);
+
+    void Run();
+    void Process(const Node& node);
+    // Format the event in m_utf8 into m_text, and set m_time.
+    void Format();
+    // Take a token from the source's bucket. A source that had messages
+    // suppressed gets a note first.
+    bool Admit(const std::string& source);
+    void FlushRepeats();
+    // Write every pending count, when the queue has been idle or at the end.
+    void FlushNotes();
+    void NoteDropped();
+    void WriteLine(std::string_view source, double time, std::string_view text);
+    void WriteBuffer();
+    void Rotate();
+    std::filesystem::path GetRotatedPath(size_t index) const;
+
+    Options m_options;
+
+    std::atomic<Node*> m_head;
+    Node* m_tail;
+    Node* m_stub;
+    // Events pushed but not yet processed.
+    std::atomic<size_t> m_pending{0};
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_repeated{0};
+    std::atomic<uint64_t> m_rateLimited{0};
+    std::atomic<uint64_t> m_linesWritten{0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+    std::atomic<uint64_t> m_rotations{0};
+
+    // The rest belongs to the writer thread.
+    std::string m_source;
+    std::string m_utf8;
+    std::string m_text;
+    JsonStructuralIndex m_index;
+    // The console's timestamp of the event, in milliseconds since 1970.
+    double m_time = 0;
+    std::string m_lastSource;
+    std::string m_lastText;
+    double m_lastTime = 0;
+    uint64_t m_repeats = 0;
+    uint64_t m_droppedNoted = 0;
+    std::map<std::string, SourceState, std::less<>> m_sources;
+    std::string m_buffer;
+    std::ofstream m_file;
+    uint64_t m_fileSize = 0;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,224 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ContentEncoding.h"
+
+namespace
+{
+// The codings, in the order they are preferred when weights tie.
+constexpr ContentCoding c_codingsByPreference[] = {
+    ContentCoding::Zstd, ContentCoding::Gzip, ContentCoding::Identity};
+constexpr size_t c_codingCount = 3;
+
+// Weights are in thousandths, the precision of a qvalue.
+constexpr int c_maxWeight = 1000;
+constexpr int c_notListed = -1;
+
+bool IsWhitespace(wchar_t c)
+{
+    return c == L' ' || c == L'\t';
+}
+
+std::wstring_view Trim(std::wstring_view text)
+{
+    while (!text.empty() && IsWhitespace(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && IsWhitespace(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool EqualsIgnoringCase(std::wstring_view text, std::wstring_view lowercase)
+{
+    if (text.size() != lowercase.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        wchar_t c = text[i];
+        if (c >= L'A' && c <= L'Z')
+        {
+            c += L'a' - L'A';
+        }
+        if (c != lowercase[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+bool ParseWeight(std::wstring_view text, int* weight)
+{
+    if (text.empty() || (text[0] != L'0' && text[0] != L'1'))
+    {
+        return false;
+    }
+    int value = (text[0] - L'0') * c_maxWeight;
+    if (text.size() > 1)
+    {
+        if (text[1] != L'.' || text.size() > 5)
+        {
+            return false;
+        }
+        int scale = c_maxWeight / 10;
+        for (size_t i = 2; i < text.size(); ++i, scale /= 10)
+        {
+            if (text[i] < L'0' || text[i] > L'9')
+            {
+                return false;
+            }
+            value += (text[i] - L'0') * scale;
+        }
+    }
+    if (value > c_maxWeight)
+    {
+        return false;
+    }
+    *weight = value;
+    return true;
+}
+
+// Parse one element of the list: a coding and its parameters, of which only q
+// means anything.
+bool ParseElement(std::wstring_view element, std::wstring_view* coding, int* weight)
+{
+    size_t semicolon = element.find(L';');
+    *coding = Trim(element.substr(0, semicolon));
+    *weight = c_maxWeight;
+    if (coding->empty() || coding->find_first_of(L" \t") != std::wstring_view::npos)
+    {
+        return false;
+    }
+    while (semicolon != std::wstring_view::npos)
+    {
+        element.remove_prefix(semicolon + 1);
+        semicolon = element.find(L';');
+        std::wstring_view parameter = Trim(element.substr(0, semicolon));
+        size_t equals = parameter.find(L'=');
+        if (equals == std::wstring_view::npos)
+        {
+            return false;
+        }
+        std::wstring_view name = Trim(parameter.substr(0, equals));
+        if (EqualsIgnoringCase(name, L"q") &&
+            !ParseWeight(Trim(parameter.substr(equals + 1)), weight))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The index of the coding in c_codingsByPreference, or c_codingCount.
+size_t FindCoding(std::wstring_view name)
+{
+    for (size_t i = 0; i < c_codingCount; ++i)
+    {
+        if (EqualsIgnoringCase(name, GetContentCodingName(c_codingsByPreference[i])))
+        {
+            return i;
+        }
+    }
+    if (EqualsIgnoringCase(name, L"x-gzip"))
+    {
+        return 1;
+    }
+    return c_codingCount;
+}
+} // namespace
+
+ContentCoding NegotiateContentCoding(std::wstring_view acceptEncoding, ContentCodings available)
+{
+    int weights[c_codingCount] = {c_notListed, c_notListed, c_notListed};
+    int otherWeight = c_notListed;
+    bool any = false;
+    while (!acceptEncoding.empty())
+    {
+        size_t comma = acceptEncoding.find(L',');
+        std::wstring_view element = acceptEncoding.substr(0, comma);
+        acceptEncoding.remove_prefix(
+            comma == std::wstring_view::npos ? acceptEncoding.size() : comma + 1);
+        std::wstring_view coding;
+        int weight = 0;
+        // Empty elements are allowed, as in "gzip,,zstd".
+        if (Trim(element).empty() || !ParseElement(element, &coding, &weight))
+        {
+            continue;
+        }
+        any = true;
+        // A coding listed twice keeps its first weight.
+        if (coding == L"*")
+        {
+            if (otherWeight == c_notListed)
+            {
+                otherWeight = weight;
+            }
+        }
+        else
+        {
+            size_t index = FindCoding(coding);
+            if (index < c_codingCount && weights[index] == c_notListed)
+            {
+                weights[index] = weight;
+            }
+        }
+    }
+    if (!any)
+    {
+        return ContentCoding::Identity;
+    }
+
+    ContentCoding best = ContentCoding::Identity;
+    int bestWeight = 0;
+    for (size_t i = 0; i < c_codingCount; ++i)
+    {
+        ContentCoding coding = c_codingsByPreference[i];
+        int weight = weights[i] != c_notListed ? weights[i] : otherWeight;
+        if (weight == c_notListed)
+        {
+            weight = coding == ContentCoding::Identity ? 1 : 0;
+        }
+        if ((available | ToContentCodings(ContentCoding::Identity)) &
+                ToContentCodings(coding) &&
+            weight > bestWeight)
+        {
+            best = coding;
+            bestWeight = weight;
+        }
+    }
+    return best;
+}
+
+std::wstring_view GetContentCodingName(ContentCoding coding)
+{
+    switch (coding)
+    {
+    case ContentCoding::Gzip:
+        return L"gzip";
+    case ContentCoding::Zstd:
+        return L"zstd";
+    default:
+        return L"identity";
+    }
+}
+
+std::wstring_view GetContentCodingSuffix(ContentCoding coding)
+{
+    switch (coding)
+    {
+    case ContentCoding::Gzip:
+        return L".gz";
+    case ContentCoding::Zstd:
+        return L".zst";
+    default:
+        return L"";
+    }
+}
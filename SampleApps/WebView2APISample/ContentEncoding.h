@@ -0,0 +1,45 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Chooses which precompressed variant of an asset to answer a request with,
+// from its Accept-Encoding header (RFC 9110 12.5.3). AssetPacker stores the
+// variants in the asset archive beside the file, under the file's path and
+// the coding's suffix, such as assets/AppStartPage.js.gz.
+
+enum class ContentCoding : uint32_t
+{
+    Identity,
+    Gzip,
+    Zstd,
+};
+
+// A set of codings, with bit 1 << coding for each.
+using ContentCodings = uint32_t;
+
+constexpr ContentCodings ToContentCodings(ContentCoding coding)
+{
+    return ContentCodings(1) << static_cast<uint32_t>(coding);
+}
+
+// The coding to answer with, of those available, which always include
+// identity. The coding the header gives the highest weight wins, and ties go to
+// zstd, then gzip, then identity. Codings are matched in any case, x-gzip is
+// gzip, and "*" stands for every coding the header doesn't name. identity is
+// acceptable unless it is refused with a weight of 0, but when the header
+// doesn't name it, only as a last choice. Malformed elements are ignored. If
+// the header is empty, or refuses every available coding, identity is chosen,
+// as if there were no header.
+ContentCoding NegotiateContentCoding(std::wstring_view acceptEncoding, ContentCodings available);
+
+// The coding's name for the Content-Encoding header, such as "gzip".
+std::wstring_view GetContentCodingName(ContentCoding coding);
+
+// The suffix of the archive entry with the coding's variant, such as ".gz", or
+// an empty string for identity.
+std::wstring_view GetContentCodingSuffix(ContentCoding coding);
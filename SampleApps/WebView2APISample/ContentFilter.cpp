@@ -0,0 +1,840 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ContentFilter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "EventTrace.h"
+#include "Url.h"
+
+namespace
+{
+enum RuleFlags : uint32_t
+{
+    RuleException = 1 << 0,
+    RuleImportant = 1 << 1,
+    RuleThirdParty = 1 << 2,
+    RuleFirstParty = 1 << 3,
+    RuleMatchCase = 1 << 4,
+    // || at the start: the pattern starts at a label of the host.
+    RuleHostAnchor = 1 << 5,
+    // | at the start or end.
+    RuleStartAnchor = 1 << 6,
+    RuleEndAnchor = 1 << 7,
+};
+
+// The most UTF-8 bytes one UTF-16 or UTF-32 code unit takes.
+constexpr size_t c_maxUtf8PerChar = 4;
+// URLs up to this long, in UTF-8, are matched without allocating.
+constexpr size_t c_stackBufferSize = 4096;
+
+// Tokens so common in URLs that a rule filed under one would be checked by
+// nearly every request. A rule only uses one if it has nothing better.
+constexpr std::string_view c_commonTokens[] = {"http", "https", "www", "com", "net",
+                                               "org",  "js",    "html", "php"};
+constexpr uint32_t c_commonTokenPenalty = 1 << 20;
+
+struct TypeOption
+{
+    std::string_view name;
+    uint32_t types;
+};
+
+constexpr TypeOption c_typeOptions[] = {
+    {"script", ContentFilterScript},
+    {"image", ContentFilterImage},
+    {"stylesheet", ContentFilterStylesheet},
+    {"css", ContentFilterStylesheet},
+    {"object", ContentFilterObject},
+    {"xmlhttprequest", ContentFilterXmlHttpRequest},
+    {"xhr", ContentFilterXmlHttpRequest},
+    {"subdocument", ContentFilterSubdocument},
+    {"frame", ContentFilterSubdocument},
+    {"ping", ContentFilterPing},
+    {"websocket", ContentFilterWebSocket},
+    {"font", ContentFilterFont},
+    {"media", ContentFilterMedia},
+    {"other", ContentFilterOther},
+};
+
+bool IsTokenChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '%' ||
+           (c >= 'A' && c <= 'Z');
+}
+
+// What ^ matches, apart from the end of the URL.
+bool IsSeparator(char c)
+{
+    return !IsTokenChar(c) && c != '_' && c != '-' && c != '.' &&
+           static_cast<unsigned char>(c) < 0x80;
+}
+
+uint32_t HashToken(const char* token, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i)
+    {
+        char c = token[i] >= 'A' && token[i] <= 'Z' ? char(token[i] - 'A' + 'a') : token[i];
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    // 0 marks an empty bucket.
+    return hash != 0 ? hash : 1;
+}
+
+// The token's bit in Index::tokenBits, from other bits of its hash than its
+// bucket is found by.
+uint32_t GetTokenBit(uint32_t token)
+{
+    return (token * 0x9E3779B1u) >> 8;
+}
+
+void FoldAsciiCase(char* text, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (text[i] >= 'A' && text[i] <= 'Z')
+        {
+            text[i] = static_cast<char>(text[i] - 'A' + 'a');
+        }
+    }
+}
+
+std::string_view Trim(std::string_view text)
+{
+    while (!text.empty() && strchr(" \t\r\n", text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && strchr(" \t\r\n", text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// The host of an absolute URL, as the offsets it starts and ends at. Both are 0
+// if the URL has no host.
+template <typename Char>
+void FindHost(std::basic_string_view<Char> url, size_t* begin, size_t* end)
+{
+    using View = std::basic_string_view<Char>;
+    *begin = 0;
+    *end = 0;
+    const Char schemeEnd[] = {':', '/', '/', 0};
+    size_t scheme = url.find(schemeEnd);
+    if (scheme == View::npos)
+    {
+        return;
+    }
+    size_t authorityBegin = scheme + 3;
+    size_t authorityEnd = authorityBegin;
+    while (authorityEnd < url.size() && url[authorityEnd] != Char('/') &&
+           url[authorityEnd] != Char('?') && url[authorityEnd] != Char('#'))
+    {
+        ++authorityEnd;
+    }
+    View authority = url.substr(authorityBegin, authorityEnd - authorityBegin);
+    size_t at = authority.rfind(Char('@'));
+    size_t hostBegin = at == View::npos ? 0 : at + 1;
+    size_t hostEnd = authority.size();
+    if (hostBegin < authority.size() && authority[hostBegin] == Char('['))
+    {
+        hostEnd = (std::min)(authority.find(Char(']'), hostBegin) + 1, authority.size());
+    }
+    else
+    {
+        hostEnd = (std::min)(authority.find(Char(':'), hostBegin), authority.size());
+    }
+    *begin = authorityBegin + hostBegin;
+    *end = authorityBegin + hostEnd;
+}
+
+// Write text as UTF-8 twice: as it is into original, and with ASCII case
+// folded into folded. Returns the size of each.
+size_t WriteUtf8AndFolded(std::wstring_view text, char* original, char* folded)
+{
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        wchar_t c = text[i];
+        if (c >= 0x80)
+        {
+            size_t rest = WriteUtf8(text.substr(i), original + i);
+            memcpy(folded + i, original + i, rest);
+            FoldAsciiCase(folded + i, rest);
+            return i + rest;
+        }
+        original[i] = static_cast<char>(c);
+        folded[i] = static_cast<char>(c >= L'A' && c <= L'Z' ? c - L'A' + L'a' : c);
+    }
+    return text.size();
+}
+
+// Whether host is domain or under it.
+bool IsDomainOrSubdomain(std::string_view host, std::string_view domain)
+{
+    return host.size() >= domain.size() &&
+           host.compare(host.size() - domain.size(), domain.size(), domain) == 0 &&
+           (host.size() == domain.size() || host[host.size() - domain.size() - 1] == '.');
+}
+
+// Match a part of a pattern that has no * at url[position]. Returns the end of
+// the match, or npos.
+size_t MatchSegmentAt(std::string_view segment, std::string_view url, size_t position)
+{
+    for (size_t i = 0; i < segment.size(); ++i, ++position)
+    {
+        char c = segment[i];
+        if (position == url.size())
+        {
+            // ^ also matches the end of the URL.
+            return c == '^' && i + 1 == segment.size() ? position : std::string_view::npos;
+        }
+        if (c == '^' ? !IsSeparator(url[position]) : url[position] != c)
+        {
+            return std::string_view::npos;
+        }
+    }
+    return position;
+}
+
+// Match the pattern's segments from segment onward, each after the one before.
+// The first at or after position is the best place for each, since whatever
+// follows it only needs to be further on.
+bool MatchSegmentsFrom(
+    const std::string_view* segments, size_t count, size_t segment, std::string_view url,
+    size_t position, bool endAnchor)
+{
+    for (; segment < count; ++segment)
+    {
+        std::string_view text = segments[segment];
+        if (segment + 1 == count && endAnchor)
+        {
+            // Only the positions that would end the match at the end of the URL.
+            for (size_t tail = 0; tail < 2; ++tail)
+            {
+                size_t size = text.size() - tail;
+                if ((tail == 0 || text.back() == '^') && url.size() >= position + size &&
+                    MatchSegmentAt(text, url, url.size() - size) == url.size())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        size_t end = std::string_view::npos;
+        for (; position <= url.size(); ++position)
+        {
+            if (text[0] != '^')
+            {
+                position = url.find(text[0], position);
+                if (position == std::string_view::npos)
+                {
+                    return false;
+                }
+            }
+            end = MatchSegmentAt(text, url, position);
+            if (end != std::string_view::npos)
+            {
+                break;
+            }
+        }
+        if (end == std::string_view::npos)
+        {
+            return false;
+        }
+        position = end;
+    }
+    return true;
+}
+
+bool MatchPattern(
+    std::string_view pattern, uint32_t flags, std::string_view url, size_t hostBegin,
+    size_t hostEnd)
+{
+    // Split on *, which at most a few patterns have more than one of.
+    std::string_view segments[16];
+    size_t count = 0;
+    while (!pattern.empty())
+    {
+        size_t star = pattern.find('*');
+        if (star != 0)
+        {
+            if (count == std::size(segments))
+            {
+                return false;
+            }
+            segments[count++] = pattern.substr(0, star);
+        }
+        pattern.remove_prefix((std::min)(star, pattern.size() - 1) + 1);
+    }
+    bool endAnchor = (flags & RuleEndAnchor) != 0;
+    if (count == 0)
+    {
+        return true;
+    }
+    if (flags & RuleStartAnchor)
+    {
+        size_t end = MatchSegmentAt(segments[0], url, 0);
+        return end != std::string_view::npos &&
+               (count == 1 ? !endAnchor || end == url.size()
+                           : MatchSegmentsFrom(segments, count, 1, url, end, endAnchor));
+    }
+    if (flags & RuleHostAnchor)
+    {
+        // At the start of the host, or of any label of it.
+        for (size_t position = hostBegin; position < hostEnd; ++position)
+        {
+            if (position != hostBegin && url[position - 1] != '.')
+            {
+                continue;
+            }
+            size_t end = MatchSegmentAt(segments[0], url, position);
+            if (end != std::string_view::npos &&
+                (count == 1 ? !endAnchor || end == url.size()
+                            : MatchSegmentsFrom(segments, count, 1, url, end, endAnchor)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    return MatchSegmentsFrom(segments, count, 0, url, 0, endAnchor);
+}
+} // namespace
+
+struct ContentFilter::Context
+{
+    // The URL, with ASCII case folded, and as it was for match-case rules.
+    std::string_view url;
+    std::string_view originalUrl;
+    size_t hostBegin = 0;
+    size_t hostEnd = 0;
+    std::string_view documentHost;
+    uint32_t type = 0;
+    // Decided the first time a rule asks: -1 until then.
+    int thirdParty = -1;
+};
+
+ContentFilter::ContentFilter(std::string_view list)
+{
+    // Parse every rule, keeping the tokens each could be filed under.
+    RuleList parsed;
+    std::vector<uint32_t> ruleTokens;
+    std::vector<uint32_t> ruleTokenEnds;
+    std::vector<uint32_t> tokens;
+    while (!list.empty())
+    {
+        size_t end = (std::min)(list.find('\n'), list.size());
+        std::string_view line = list.substr(0, end);
+        list.remove_prefix((std::min)(end + 1, list.size()));
+        tokens.clear();
+        if (ParseRule(line, &parsed, &tokens))
+        {
+            ruleTokens.insert(ruleTokens.end(), tokens.begin(), tokens.end());
+            ruleTokenEnds.push_back(static_cast<uint32_t>(ruleTokens.size()));
+        }
+    }
+
+    // File each rule under the token that fewest rules could be filed under.
+    std::unordered_map<uint32_t, uint32_t> tokenCounts;
+    for (uint32_t token : ruleTokens)
+    {
+        ++tokenCounts[token];
+    }
+    for (std::string_view common : c_commonTokens)
+    {
+        auto count = tokenCounts.find(HashToken(common.data(), common.size()));
+        if (count != tokenCounts.end())
+        {
+            count->second += c_commonTokenPenalty;
+        }
+    }
+    std::vector<uint32_t> chosenTokens(parsed.rules.size());
+    std::vector<uint32_t> importantRules;
+    std::vector<uint32_t> blockingRules;
+    std::vector<uint32_t> exceptionRules;
+    uint32_t tokenBegin = 0;
+    for (uint32_t rule = 0; rule < parsed.rules.size(); ++rule)
+    {
+        uint32_t best = 0;
+        uint32_t bestCount = UINT32_MAX;
+        for (uint32_t i = tokenBegin; i < ruleTokenEnds[rule]; ++i)
+        {
+            uint32_t count = tokenCounts[ruleTokens[i]];
+            if (count < bestCount)
+            {
+                best = ruleTokens[i];
+                bestCount = count;
+            }
+        }
+        tokenBegin = ruleTokenEnds[rule];
+        chosenTokens[rule] = best;
+        m_stats.untokenizedRules += best == 0 ? 1 : 0;
+        uint32_t flags = parsed.rules[rule].flags;
+        (flags & RuleException   ? exceptionRules
+         : flags & RuleImportant ? importantRules
+                                 : blockingRules)
+            .push_back(rule);
+    }
+    m_stats.blockingRules = importantRules.size() + blockingRules.size();
+    m_stats.exceptionRules = exceptionRules.size();
+    m_strings.reserve(parsed.strings.size());
+    m_domains.reserve(parsed.domains.size());
+    BuildIndex(&m_important, parsed, importantRules, chosenTokens);
+    BuildIndex(&m_blocking, parsed, blockingRules, chosenTokens);
+    BuildIndex(&m_exceptions, parsed, exceptionRules, chosenTokens);
+}
+
+bool ContentFilter::ParseRule(
+    std::string_view line, RuleList* list, std::vector<uint32_t>* tokens)
+{
+    line = Trim(line);
+    if (line.empty() || line[0] == '!' || line[0] == '[')
+    {
+        return false;
+    }
+    if (line.find("##") != std::string_view::npos || line.find("#@#") != std::string_view::npos ||
+        line.find("#?#") != std::string_view::npos || line.find("#$#") != std::string_view::npos)
+    {
+        ++m_stats.elementHidingRules;
+        return false;
+    }
+    Rule rule = {};
+    rule.types = ContentFilterAllTypes;
+    if (line.size() >= 2 && line[0] == '@' && line[1] == '@')
+    {
+        rule.flags |= RuleException;
+        line.remove_prefix(2);
+    }
+    if (line.size() > 2 && line.front() == '/' && line.back() == '/')
+    {
+        // A regular expression.
+        ++m_stats.unsupportedRules;
+        return false;
+    }
+
+    std::string_view pattern = line;
+    size_t dollar = line.rfind('$');
+    uint32_t domainsBegin = static_cast<uint32_t>(list->domains.size());
+    size_t stringsSize = list->strings.size();
+    auto reject = [&]
+    {
+        list->domains.resize(domainsBegin);
+        list->strings.resize(stringsSize);
+        ++m_stats.unsupportedRules;
+        return false;
+    };
+    if (dollar != std::string_view::npos)
+    {
+        pattern = line.substr(0, dollar);
+        std::string_view options = line.substr(dollar + 1);
+        uint32_t includedTypes = 0;
+        uint32_t excludedTypes = 0;
+        while (!options.empty())
+        {
+            size_t comma = (std::min)(options.find(','), options.size());
+            std::string option(Trim(options.substr(0, comma)));
+            options.remove_prefix((std::min)(comma + 1, options.size()));
+            bool negated = !option.empty() && option[0] == '~';
+            if (negated)
+            {
+                option.erase(0, 1);
+            }
+            size_t equals = option.find('=');
+            FoldAsciiCase(&option[0], (std::min)(equals, option.size()));
+            auto type = std::find_if(
+                std::begin(c_typeOptions), std::end(c_typeOptions),
+                [&option](const TypeOption& candidate) { return candidate.name == option; });
+            if (type != std::end(c_typeOptions))
+            {
+                (negated ? excludedTypes : includedTypes) |= type->types;
+            }
+            else if (option == "third-party" || option == "3p")
+            {
+                rule.flags |= negated ? RuleFirstParty : RuleThirdParty;
+            }
+            else if (option == "first-party" || option == "1p")
+            {
+                rule.flags |= negated ? RuleThirdParty : RuleFirstParty;
+            }
+            else if (option == "match-case" && !negated)
+            {
+                rule.flags |= RuleMatchCase;
+            }
+            else if (option == "important" && !negated)
+            {
+                rule.flags |= RuleImportant;
+            }
+            else if (option.compare(0, 7, "domain=") == 0 && !negated)
+            {
+                std::string_view domains = std::string_view(option).substr(7);
+                while (!domains.empty())
+                {
+                    size_t bar = (std::min)(domains.find('|'), domains.size());
+                    std::string_view domain = domains.substr(0, bar);
+                    domains.remove_prefix((std::min)(bar + 1, domains.size()));
+                    Domain entry = {};
+                    entry.excluded = !domain.empty() && domain[0] == '~';
+                    domain.remove_prefix(entry.excluded ? 1 : 0);
+                    if (domain.empty())
+                    {
+                        return reject();
+                    }
+                    entry.offset = static_cast<uint32_t>(list->strings.size());
+                    entry.size = static_cast<uint32_t>(domain.size());
+                    list->strings.append(domain);
+                    FoldAsciiCase(&list->strings[entry.offset], entry.size);
+                    list->domains.push_back(entry);
+                }
+            }
+            else
+            {
+                // Including options for whole pages, such as $document and
+                // $popup, which don't apply to a single request.
+                return reject();
+            }
+        }
+        if (includedTypes != 0)
+        {
+            rule.types = includedTypes;
+        }
+        rule.types &= ~excludedTypes;
+        if (rule.types == 0)
+        {
+            return reject();
+        }
+    }
+    rule.domainsBegin = domainsBegin;
+    rule.domainsEnd = static_cast<uint32_t>(list->domains.size());
+
+    if (pattern.size() >= 2 && pattern[0] == '|' && pattern[1] == '|')
+    {
+        rule.flags |= RuleHostAnchor;
+        pattern.remove_prefix(2);
+    }
+    else if (!pattern.empty() && pattern[0] == '|')
+    {
+        rule.flags |= RuleStartAnchor;
+        pattern.remove_prefix(1);
+    }
+    if (!pattern.empty() && pattern.back() == '|')
+    {
+        rule.flags |= RuleEndAnchor;
+        pattern.remove_suffix(1);
+    }
+    // A * at either end makes the anchor there meaningless.
+    if (!pattern.empty() && pattern.front() == '*')
+    {
+        rule.flags &= ~uint32_t(RuleHostAnchor | RuleStartAnchor);
+    }
+    if (!pattern.empty() && pattern.back() == '*')
+    {
+        rule.flags &= ~uint32_t(RuleEndAnchor);
+    }
+    while (!pattern.empty() && pattern.front() == '*')
+    {
+        pattern.remove_prefix(1);
+    }
+    while (!pattern.empty() && pattern.back() == '*')
+    {
+        pattern.remove_suffix(1);
+    }
+    if (pattern.find('|') != std::string_view::npos)
+    {
+        return reject();
+    }
+    rule.patternOffset = static_cast<uint32_t>(list->strings.size());
+    rule.patternSize = static_cast<uint32_t>(pattern.size());
+    list->strings.append(pattern);
+    if (!(rule.flags & RuleMatchCase))
+    {
+        FoldAsciiCase(&list->strings[rule.patternOffset], rule.patternSize);
+    }
+
+    // A token is only safe to file under if any URL the pattern matches has it
+    // whole: with no * beside it, and at an end only if that end is anchored.
+    for (size_t i = 0; i < pattern.size();)
+    {
+        if (!IsTokenChar(pattern[i]))
+        {
+            ++i;
+            continue;
+        }
+        size_t start = i;
+        while (i < pattern.size() && IsTokenChar(pattern[i]))
+        {
+            ++i;
+        }
+        bool startSafe = start > 0 ? pattern[start - 1] != '*'
+                                   : (rule.flags & (RuleHostAnchor | RuleStartAnchor)) != 0;
+        bool endSafe = i < pattern.size() ? pattern[i] != '*' : (rule.flags & RuleEndAnchor) != 0;
+        if (startSafe && endSafe)
+        {
+            tokens->push_back(HashToken(pattern.data() + start, i - start));
+        }
+    }
+    list->rules.push_back(rule);
+    return true;
+}
+
+void ContentFilter::BuildIndex(
+    Index* index, const RuleList& list, const std::vector<uint32_t>& rules,
+    const std::vector<uint32_t>& chosenTokens)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> filed;
+    for (uint32_t rule : rules)
+    {
+        if (chosenTokens[rule] == 0)
+        {
+            index->untokenized.push_back(CopyRule(list, rule));
+        }
+        else
+        {
+            filed.emplace_back(chosenTokens[rule], rule);
+        }
+    }
+    // Rules in list order within a bucket, and buckets at most half full.
+    std::stable_sort(
+        filed.begin(), filed.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    size_t bucketCount = 0;
+    for (size_t i = 0; i < filed.size(); ++i)
+    {
+        bucketCount += i == 0 || filed[i].first != filed[i - 1].first ? 1 : 0;
+    }
+    size_t tableSize = 16;
+    while (tableSize < bucketCount * 2)
+    {
+        tableSize *= 2;
+    }
+    index->buckets.assign(tableSize, Bucket{});
+    index->mask = static_cast<uint32_t>(tableSize - 1);
+    // About 16 bits for each token, so that few tokens without a bucket look
+    // like they have one.
+    index->tokenBits.assign(tableSize / 8, 0);
+    index->tokenBitsMask = static_cast<uint32_t>(tableSize * 8 - 1);
+    index->rules.reserve(filed.size());
+    Bucket* bucket = nullptr;
+    for (size_t i = 0; i < filed.size(); ++i)
+    {
+        uint32_t token = filed[i].first;
+        if (i == 0 || token != filed[i - 1].first)
+        {
+            uint32_t slot = token & index->mask;
+            while (index->buckets[slot].token != 0)
+            {
+                slot = (slot + 1) & index->mask;
+            }
+            bucket = &index->buckets[slot];
+            *bucket = {token, static_cast<uint32_t>(index->rules.size()), 0};
+            uint32_t bit = GetTokenBit(token) & index->tokenBitsMask;
+            index->tokenBits[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+        ++bucket->count;
+        index->rules.push_back(CopyRule(list, filed[i].second));
+    }
+}
+
+ContentFilter::Rule ContentFilter::CopyRule(const RuleList& list, uint32_t rule)
+{
+    const Rule& parsed = list.rules[rule];
+    Rule copy = parsed;
+    copy.patternOffset = static_cast<uint32_t>(m_strings.size());
+    m_strings.append(list.strings, parsed.patternOffset, parsed.patternSize);
+    copy.domainsBegin = static_cast<uint32_t>(m_domains.size());
+    for (uint32_t i = parsed.domainsBegin; i < parsed.domainsEnd; ++i)
+    {
+        Domain domain = list.domains[i];
+        domain.offset = static_cast<uint32_t>(m_strings.size());
+        m_strings.append(list.strings, list.domains[i].offset, domain.size);
+        m_domains.push_back(domain);
+    }
+    copy.domainsEnd = static_cast<uint32_t>(m_domains.size());
+    return copy;
+}
+
+ContentFilterResult ContentFilter::Match(const ContentFilterRequest& request) const
+{
+    if (request.type == ContentFilterDocument)
+    {
+        return ContentFilterResult::NoMatch;
+    }
+    // The URL as it was and with case folded, then the document's host, all in
+    // UTF-8 in one buffer.
+    size_t documentHostBegin = 0;
+    size_t documentHostEnd = 0;
+    FindHost(request.documentUrl, &documentHostBegin, &documentHostEnd);
+    std::wstring_view documentHost =
+        request.documentUrl.substr(documentHostBegin, documentHostEnd - documentHostBegin);
+    char stackBuffer[c_stackBufferSize];
+    std::string heapBuffer;
+    size_t needed = (request.url.size() * 2 + documentHost.size() * 2) * c_maxUtf8PerChar;
+    char* buffer = stackBuffer;
+    if (needed > sizeof(stackBuffer))
+    {
+        heapBuffer.resize(needed);
+        buffer = &heapBuffer[0];
+    }
+    char* folded = buffer + request.url.size() * c_maxUtf8PerChar;
+    size_t urlSize = WriteUtf8AndFolded(request.url, buffer, folded);
+    char* document = folded + request.url.size() * c_maxUtf8PerChar;
+    size_t documentHostSize = WriteUtf8AndFolded(
+        documentHost, document + documentHost.size() * c_maxUtf8PerChar, document);
+
+    Context context;
+    context.originalUrl = std::string_view(buffer, urlSize);
+    context.url = std::string_view(folded, urlSize);
+    FindHost(context.url, &context.hostBegin, &context.hostEnd);
+    context.documentHost = std::string_view(document, documentHostSize);
+    context.type = request.type;
+
+    if (MatchIndex(m_important, context))
+    {
+        return ContentFilterResult::Block;
+    }
+    if (!MatchIndex(m_blocking, context))
+    {
+        return ContentFilterResult::NoMatch;
+    }
+    return MatchIndex(m_exceptions, context) ? ContentFilterResult::Exception
+                                             : ContentFilterResult::Block;
+}
+
+size_t ContentFilter::GetMemoryUsage() const
+{
+    size_t size = m_domains.capacity() * sizeof(Domain) + m_strings.capacity();
+    for (const Index* index : {&m_important, &m_blocking, &m_exceptions})
+    {
+        size += index->buckets.capacity() * sizeof(Bucket) +
+                (index->rules.capacity() + index->untokenized.capacity()) * sizeof(Rule);
+    }
+    return size;
+}
+
+bool ContentFilter::MatchIndex(const Index& index, Context& context) const
+{
+    if (index.rules.empty() && index.untokenized.empty())
+    {
+        return false;
+    }
+    std::string_view url = context.url;
+    for (size_t i = 0; i < url.size();)
+    {
+        if (!IsTokenChar(url[i]))
+        {
+            ++i;
+            continue;
+        }
+        size_t start = i;
+        while (i < url.size() && IsTokenChar(url[i]))
+        {
+            ++i;
+        }
+        uint32_t token = HashToken(url.data() + start, i - start);
+        uint32_t bit = GetTokenBit(token) & index.tokenBitsMask;
+        if (!(index.tokenBits[bit / 64] & (uint64_t(1) << (bit % 64))))
+        {
+            continue;
+        }
+        for (uint32_t slot = token & index.mask; index.buckets[slot].token != 0;
+             slot = (slot + 1) & index.mask)
+        {
+            const Bucket& bucket = index.buckets[slot];
+            if (bucket.token != token)
+            {
+                continue;
+            }
+            for (uint32_t rule = bucket.begin; rule < bucket.begin + bucket.count; ++rule)
+            {
+                if (MatchRule(index.rules[rule], context))
+                {
+                    return true;
+                }
+            }
+            break;
+        }
+    }
+    for (const Rule& rule : index.untokenized)
+    {
+        if (MatchRule(rule, context))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ContentFilter::MatchRule(const Rule& rule, Context& context) const
+{
+    if (!(rule.types & context.type))
+    {
+        return false;
+    }
+    if (rule.flags & (RuleThirdParty | RuleFirstParty))
+    {
+        if (context.documentHost.empty())
+        {
+            return false;
+        }
+        if (context.thirdParty < 0)
+        {
+            std::string_view host =
+                context.url.substr(context.hostBegin, context.hostEnd - context.hostBegin);
+            context.thirdParty = GetUrlSite(host) != GetUrlSite(context.documentHost) ? 1 : 0;
+        }
+        if (((rule.flags & RuleThirdParty) != 0) != (context.thirdParty == 1))
+        {
+            return false;
+        }
+    }
+    if (rule.domainsBegin != rule.domainsEnd && !MatchDomains(rule, context.documentHost))
+    {
+        return false;
+    }
+    std::string_view pattern(m_strings.data() + rule.patternOffset, rule.patternSize);
+    return MatchPattern(
+        pattern, rule.flags, (rule.flags & RuleMatchCase) ? context.originalUrl : context.url,
+        context.hostBegin, context.hostEnd);
+}
+
+bool ContentFilter::MatchDomains(const Rule& rule, std::string_view documentHost) const
+{
+    if (documentHost.empty())
+    {
+        return false;
+    }
+    bool hasIncluded = false;
+    bool included = false;
+    for (uint32_t i = rule.domainsBegin; i < rule.domainsEnd; ++i)
+    {
+        const Domain& domain = m_domains[i];
+        std::string_view name(m_strings.data() + domain.offset, domain.size);
+        if (domain.excluded)
+        {
+            if (IsDomainOrSubdomain(documentHost, name))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            hasIncluded = true;
+            included = included || IsDomainOrSubdomain(documentHost, name);
+        }
+    }
+    return !hasIncluded || included;
+}
+
+std::wstring_view GetContentFilterDocumentUrl(std::wstring_view referer, std::wstring_view origin)
+{
+    if (!referer.empty())
+    {
+        return referer;
+    }
+    return origin == L"null" ? std::wstring_view() : origin;
+}
@@ -0,0 +1,182 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Blocks requests by a list of network filter rules in Adblock Plus syntax, as
+// EasyList is written. A rule is a URL pattern with options:
+//
+//   ||ads.example.com^              the domain and its subdomains
+//   |https://example.com/ad         a URL that starts with this
+//   /banner/*/img^                  * is any text, ^ a separator or the end
+//   swf|                            a URL that ends with this
+//   ||cdn.example.com^$third-party  only when loaded by another site
+//   /ad.png$image,domain=a.com|~b.a.com
+//                                   only images, only on a.com but not b.a.com
+//   @@||example.com/ads.js$script   an exception, which unblocks requests
+//
+// The type options are script, image, stylesheet, object, xmlhttprequest,
+// subdocument, ping, websocket, font, media and other, each of which can be
+// negated with ~. The other options are third-party, ~third-party, domain=,
+// match-case and important, with which a block can't be excepted. A rule with
+// any other option, a regular expression rule or an element hiding rule is
+// skipped, and counted in the stats.
+//
+// Each rule is filed under one token of its pattern, a run of letters, digits
+// and '%' that any URL it matches must have as a whole token, choosing the one
+// that fewest other rules have. A request then only checks the rules filed
+// under the tokens of its URL, and the few rules that have no such token.
+// Exceptions are indexed apart, and only checked once a request would be
+// blocked; so are $important rules, which are checked first.
+
+// The kinds of request a rule can be limited to.
+enum ContentFilterTypes : uint32_t
+{
+    ContentFilterScript = 1 << 0,
+    ContentFilterImage = 1 << 1,
+    ContentFilterStylesheet = 1 << 2,
+    ContentFilterObject = 1 << 3,
+    ContentFilterXmlHttpRequest = 1 << 4,
+    ContentFilterSubdocument = 1 << 5,
+    ContentFilterPing = 1 << 6,
+    ContentFilterWebSocket = 1 << 7,
+    ContentFilterFont = 1 << 8,
+    ContentFilterMedia = 1 << 9,
+    ContentFilterOther = 1 << 10,
+    ContentFilterAllTypes = (1 << 11) - 1,
+    // A page's own document, as opposed to a frame's, which no rule blocks: as
+    // in Adblock Plus, rules are for what a page loads, not for the page.
+    ContentFilterDocument = 1 << 11,
+};
+
+struct ContentFilterRequest
+{
+    std::wstring_view url;
+    // The URL of the page that made the request, which $third-party and
+    // $domain= are decided by. If it is empty, rules with either don't apply.
+    std::wstring_view documentUrl;
+    ContentFilterTypes type = ContentFilterOther;
+};
+
+// The documentUrl of a request, from the headers that say which document made
+// it: Referer, or Origin if the referrer policy withheld it. Either has the
+// document's host, which is all that $third-party and $domain= look at. Returns
+// an empty view if neither names one, as for an opaque "null" origin.
+std::wstring_view GetContentFilterDocumentUrl(std::wstring_view referer, std::wstring_view origin);
+
+enum class ContentFilterResult
+{
+    // No blocking rule matched.
+    NoMatch,
+    Block,
+    // A blocking rule matched, and so did an exception.
+    Exception,
+};
+
+class ContentFilter
+{
+public:
+    struct Stats
+    {
+        size_t blockingRules = 0;
+        size_t exceptionRules = 0;
+        // Rules with no token, which every request checks.
+        size_t untokenizedRules = 0;
+        size_t elementHidingRules = 0;
+        size_t unsupportedRules = 0;
+    };
+
+    // Parse and index a list, one rule to a line.
+    explicit ContentFilter(std::string_view list);
+    ContentFilter(const ContentFilter&) = delete;
+    ContentFilter& operator=(const ContentFilter&) = delete;
+
+    // Can be called from any thread.
+    ContentFilterResult Match(const ContentFilterRequest& request) const;
+
+    const Stats& GetStats() const { return m_stats; }
+    // The bytes the rules and their index take.
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Rule
+    {
+        // The pattern, without its anchors, in m_strings.
+        uint32_t patternOffset;
+        uint32_t patternSize;
+        // The rule's $domain= entries, in m_domains.
+        uint32_t domainsBegin;
+        uint32_t domainsEnd;
+        uint32_t types;
+        uint32_t flags;
+    };
+
+    struct Domain
+    {
+        uint32_t offset;
+        uint32_t size;
+        bool excluded;
+    };
+
+    struct Bucket
+    {
+        // 0 for an empty slot.
+        uint32_t token;
+        uint32_t begin;
+        uint32_t count;
+    };
+
+    // Rules filed by token, in an open-addressing table of buckets whose
+    // rules are ranges of one array. A bucket's rules, and their patterns in
+    // m_strings, are side by side in memory.
+    struct Index
+    {
+        // A bit for each token hash, set if some bucket may have it. It is
+        // small enough to stay in cache, where the buckets don't, and most
+        // tokens of a URL have no bucket.
+        std::vector<uint64_t> tokenBits;
+        std::vector<Bucket> buckets;
+        std::vector<Rule> rules;
+        std::vector<Rule> untokenized;
+        uint32_t mask = 0;
+        uint32_t tokenBitsMask = 0;
+    };
+
+    // Rules as they are parsed, in list order.
+    struct RuleList
+    {
+        std::vector<Rule> rules;
+        std::vector<Domain> domains;
+        std::string strings;
+    };
+
+    // The parts of a request that every rule it checks looks at.
+    struct Context;
+
+    // Parse a line into list, and the tokens it could be filed under into
+    // tokens. Returns false if the line isn't a network rule this can apply.
+    bool ParseRule(std::string_view line, RuleList* list, std::vector<uint32_t>* tokens);
+    // Copy rules into an index, and their strings into m_strings.
+    void BuildIndex(
+        Index* index, const RuleList& list, const std::vector<uint32_t>& rules,
+        const std::vector<uint32_t>& chosenTokens);
+    // Copy a rule's strings and domains from list into this filter.
+    Rule CopyRule(const RuleList& list, uint32_t rule);
+    bool MatchIndex(const Index& index, Context& context) const;
+    bool MatchRule(const Rule& rule, Context& context) const;
+    bool MatchDomains(const Rule& rule, std::string_view documentHost) const;
+
+    std::vector<Domain> m_domains;
+    std::string m_strings;
+    Index m_important;
+    Index m_blocking;
+    Index m_exceptions;
+    Stats m_stats;
+};
@@ -0,0 +1,511 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DomainTrie.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+#include "Url.h"
+
+namespace
+{
+constexpr uint32_t c_initialTableSize = 16;
+// The most UTF-8 bytes one UTF-16 or UTF-32 code unit takes.
+constexpr size_t c_maxUtf8PerChar = 4;
+
+uint32_t HashLabel(uint32_t parent, const char* label, size_t size)
+{
+    // FNV-1a, seeded with the parent so that the same label under different
+    // domains lands in different slots.
+    uint32_t hash = 2166136261u ^ (parent * 0x9E3779B1u);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(label[i])) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+void FoldAsciiCase(char* text, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (text[i] >= 'A' && text[i] <= 'Z')
+        {
+            text[i] = static_cast<char>(text[i] - 'A' + 'a');
+        }
+    }
+}
+
+// Write a label of a host as lowercase UTF-8, into a buffer that holds
+// c_maxDomainLabelSize * c_maxUtf8PerChar bytes.
+size_t WriteLabel(std::string_view label, char* out)
+{
+    memcpy(out, label.data(), label.size());
+    FoldAsciiCase(out, label.size());
+    return label.size();
+}
+
+size_t WriteLabel(std::wstring_view label, char* out)
+{
+    size_t size = WriteUtf8(label, out);
+    FoldAsciiCase(out, size);
+    return size;
+}
+
+// The domain as it is stored: trimmed, without a leading "*." or "." or a
+// trailing ".", and with ASCII case folded. A domain that isn't ASCII is mapped
+// to ASCII as a URL's host is, so that it matches the hosts Url gives, or is
+// returned empty if it isn't a valid host.
+std::string NormalizeDomain(std::string_view domain)
+{
+    while (!domain.empty() && strchr(" \t\r\n", domain.front()))
+    {
+        domain.remove_prefix(1);
+    }
+    while (!domain.empty() && strchr(" \t\r\n", domain.back()))
+    {
+        domain.remove_suffix(1);
+    }
+    if (domain.size() >= 2 && domain[0] == '*' && domain[1] == '.')
+    {
+        domain.remove_prefix(2);
+    }
+    else if (!domain.empty() && domain.front() == '.')
+    {
+        domain.remove_prefix(1);
+    }
+    if (!domain.empty() && domain.back() == '.')
+    {
+        domain.remove_suffix(1);
+    }
+    std::string normalized;
+    if (std::all_of(domain.begin(), domain.end(), [](char c) { return (c & 0x80) == 0; }))
+    {
+        normalized = domain;
+        FoldAsciiCase(&normalized[0], normalized.size());
+    }
+    else if (!DomainToAscii(domain, &normalized))
+    {
+        // Not a valid domain, which FindDomain() then rejects.
+        normalized.clear();
+    }
+    return normalized;
+}
+
+std::string ToUtf8(std::wstring_view value)
+{
+    std::string utf8(value.size() * c_maxUtf8PerChar, '\0');
+    utf8.resize(WriteUtf8(value, &utf8[0]));
+    return utf8;
+}
+
+// Append UTF-8 as UTF-16, or UTF-32 where wchar_t is 32 bits. Labels only hold
+// what WriteUtf8() or a checked file put there, so this doesn't validate.
+void AppendUtf8(std::string_view utf8, std::wstring* out)
+{
+    for (size_t i = 0; i < utf8.size();)
+    {
+        unsigned char lead = static_cast<unsigned char>(utf8[i]);
+        size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+        uint32_t codePoint = length == 1   ? lead
+                             : length == 2 ? lead & 0x1F
+                             : length == 3 ? lead & 0x0F
+                                           : lead & 0x07;
+        for (size_t j = 1; j < length && i + j < utf8.size(); ++j)
+        {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(utf8[i + j]) & 0x3F);
+        }
+        i += length;
+        if (codePoint >= 0x10000 && sizeof(wchar_t) == 2)
+        {
+            codePoint -= 0x10000;
+            out->push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+            out->push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+        }
+        else
+        {
+            out->push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+}
+} // namespace
+
+DomainTrie::DomainTrie()
+{
+    Clear();
+}
+
+std::unique_ptr<DomainTrie> DomainTrie::Open(const std::filesystem::path& path)
+{
+    std::unique_ptr<DomainTrie> trie(new DomainTrie());
+    auto file = std::make_unique<MappedFile>();
+    if (!file->OpenReadOnly(path) || file->Size() < sizeof(DomainTrieHeader))
+    {
+        return nullptr;
+    }
+    DomainTrieHeader header;
+    memcpy(&header, file->Data(), sizeof(header));
+    uint64_t nodesSize = uint64_t(header.nodeCount) * sizeof(DomainTrieNode);
+    uint64_t tableBytes = uint64_t(header.tableSize) * sizeof(uint32_t);
+    if (memcmp(header.magic, c_domainTrieMagic, sizeof(header.magic)) != 0 ||
+        header.version != c_domainTrieVersion || header.headerSize != sizeof(DomainTrieHeader) ||
+        header.nodeCount == 0 || header.tableSize <= header.nodeCount ||
+        (header.tableSize & (header.tableSize - 1)) != 0 ||
+        header.headerSize + nodesSize + tableBytes + header.labelsSize != file->Size())
+    {
+        return nullptr;
+    }
+    const uint8_t* data = file->Data();
+    trie->m_mappedNodes = reinterpret_cast<const DomainTrieNode*>(data + header.headerSize);
+    trie->m_mappedTable = reinterpret_cast<const uint32_t*>(data + header.headerSize + nodesSize);
+    trie->m_mappedLabels =
+        reinterpret_cast<const char*>(data + header.headerSize + nodesSize + tableBytes);
+    trie->m_mappedLabelsSize = header.labelsSize;
+    trie->m_nodeCount = header.nodeCount;
+    trie->m_tableMask = header.tableSize - 1;
+    trie->m_file = std::move(file);
+
+    // Check every node, and that the table finds each of them under its own
+    // parent and label. With that, and an empty slot to end every probe,
+    // lookups can trust whatever they read.
+    const DomainTrieNode* nodes = trie->m_mappedNodes;
+    const uint32_t* table = trie->m_mappedTable;
+    if (nodes[0].parent != 0 || nodes[0].labelOffset != 0 || nodes[0].labelSize != 0 ||
+        nodes[0].flags != 0 || nodes[0].hash != 0)
+    {
+        return nullptr;
+    }
+    size_t domainCount = 0;
+    for (uint32_t i = 1; i < header.nodeCount; ++i)
+    {
+        const DomainTrieNode& node = nodes[i];
+        if (node.parent >= i || node.labelSize == 0 || node.labelSize > c_maxDomainLabelSize ||
+            node.labelOffset > header.labelsSize ||
+            node.labelSize > header.labelsSize - node.labelOffset ||
+            (node.flags & ~uint16_t(DomainTrieNodeBlocked)) != 0 ||
+            node.hash !=
+                HashLabel(node.parent, trie->m_mappedLabels + node.labelOffset, node.labelSize))
+        {
+            return nullptr;
+        }
+        domainCount += (node.flags & DomainTrieNodeBlocked) ? 1 : 0;
+    }
+    uint32_t usedSlots = 0;
+    for (uint32_t i = 0; i < header.tableSize; ++i)
+    {
+        if (table[i] > header.nodeCount || table[i] == 1)
+        {
+            return nullptr;
+        }
+        usedSlots += table[i] != 0 ? 1 : 0;
+    }
+    if (usedSlots != header.nodeCount - 1 || domainCount != header.domainCount)
+    {
+        return nullptr;
+    }
+    for (uint32_t i = 1; i < header.nodeCount; ++i)
+    {
+        const DomainTrieNode& node = nodes[i];
+        std::string_view label(trie->m_mappedLabels + node.labelOffset, node.labelSize);
+        if (trie->FindChild(node.parent, label, node.hash) != i)
+        {
+            return nullptr;
+        }
+    }
+    trie->m_domainCount = domainCount;
+    return trie;
+}
+
+bool DomainTrie::Write(const std::filesystem::path& path) const
+{
+    size_t labelsSize = m_file ? m_mappedLabelsSize : m_labels.size();
+    if (labelsSize > UINT32_MAX)
+    {
+        return false;
+    }
+    DomainTrieHeader header = {};
+    memcpy(header.magic, c_domainTrieMagic, sizeof(header.magic));
+    header.version = c_domainTrieVersion;
+    header.headerSize = sizeof(DomainTrieHeader);
+    header.nodeCount = m_nodeCount;
+    header.tableSize = m_tableMask + 1;
+    header.labelsSize = static_cast<uint32_t>(labelsSize);
+    header.domainCount = static_cast<uint32_t>(m_domainCount);
+
+    // Written beside the target and renamed over it, as asset archives are.
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(
+            reinterpret_cast<const char*>(Nodes()),
+            static_cast<std::streamsize>(m_nodeCount * sizeof(DomainTrieNode)));
+        file.write(
+            reinterpret_cast<const char*>(Table()),
+            static_cast<std::streamsize>(header.tableSize * sizeof(uint32_t)));
+        file.write(Labels(), static_cast<std::streamsize>(labelsSize));
+        if (!file.flush())
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+bool DomainTrie::Add(std::wstring_view domain)
+{
+    return Add(std::string_view(ToUtf8(domain)));
+}
+
+bool DomainTrie::Add(std::string_view domain)
+{
+    Detach();
+    uint32_t node = FindDomain(NormalizeDomain(domain), true);
+    if (node == 0)
+    {
+        return false;
+    }
+    if (!(m_nodes[node].flags & DomainTrieNodeBlocked))
+    {
+        m_nodes[node].flags |= DomainTrieNodeBlocked;
+        ++m_domainCount;
+    }
+    return true;
+}
+
+bool DomainTrie::Remove(std::wstring_view domain)
+{
+    uint32_t node = FindDomain(NormalizeDomain(ToUtf8(domain)), false);
+    if (node == 0 || !(Nodes()[node].flags & DomainTrieNodeBlocked))
+    {
+        return false;
+    }
+    Detach();
+    m_nodes[node].flags &= ~uint16_t(DomainTrieNodeBlocked);
+    --m_domainCount;
+    return true;
+}
+
+void DomainTrie::Clear()
+{
+    m_file.reset();
+    m_nodes.assign(1, DomainTrieNode{});
+    m_table.assign(c_initialTableSize, 0);
+    m_labels.clear();
+    m_nodeCount = 1;
+    m_tableMask = c_initialTableSize - 1;
+    m_domainCount = 0;
+}
+
+bool DomainTrie::Contains(std::wstring_view host) const
+{
+    return ContainsHost(host);
+}
+
+bool DomainTrie::Contains(std::string_view host) const
+{
+    return ContainsHost(host);
+}
+
+template <typename Char> bool DomainTrie::ContainsHost(std::basic_string_view<Char> host) const
+{
+    if (std::any_of(
+            host.begin(), host.end(), [](Char c) { return static_cast<uint32_t>(c) >= 0x80; }))
+    {
+        // Url never gives such a host; map it as Add() would.
+        std::string ascii;
+        if constexpr (sizeof(Char) == 1)
+        {
+            if (!DomainToAscii(host, &ascii))
+            {
+                return false;
+            }
+        }
+        else if (!DomainToAscii(ToUtf8(host), &ascii))
+        {
+            return false;
+        }
+        return ContainsHost(std::string_view(ascii));
+    }
+    if (!host.empty() && host.back() == Char('.'))
+    {
+        host.remove_suffix(1);
+    }
+    const DomainTrieNode* nodes = Nodes();
+    char label[c_maxDomainLabelSize * c_maxUtf8PerChar];
+    uint32_t node = 0;
+    // From the last label to the first, stopping at the first domain that is
+    // in the set, or the first that no domain in the set is under.
+    while (!host.empty())
+    {
+        size_t dot = host.rfind(Char('.'));
+        size_t start = dot == host.npos ? 0 : dot + 1;
+        std::basic_string_view<Char> text = host.substr(start);
+        if (text.empty() || text.size() > c_maxDomainLabelSize)
+        {
+            return false;
+        }
+        size_t size = WriteLabel(text, label);
+        node = FindChild(node, std::string_view(label, size), HashLabel(node, label, size));
+        if (node == 0)
+        {
+            return false;
+        }
+        if (nodes[node].flags & DomainTrieNodeBlocked)
+        {
+            return true;
+        }
+        host.remove_suffix(host.size() - (dot == host.npos ? 0 : dot));
+    }
+    return false;
+}
+
+std::vector<std::wstring> DomainTrie::GetDomains() const
+{
+    const DomainTrieNode* nodes = Nodes();
+    const char* labels = Labels();
+    std::vector<std::wstring> domains;
+    domains.reserve(m_domainCount);
+    for (uint32_t i = 1; i < m_nodeCount; ++i)
+    {
+        if (!(nodes[i].flags & DomainTrieNodeBlocked))
+        {
+            continue;
+        }
+        std::wstring domain;
+        for (uint32_t node = i; node != 0; node = nodes[node].parent)
+        {
+            if (node != i)
+            {
+                domain.push_back(L'.');
+            }
+            AppendUtf8(
+                std::string_view(labels + nodes[node].labelOffset, nodes[node].labelSize),
+                &domain);
+        }
+        domains.push_back(std::move(domain));
+    }
+    return domains;
+}
+
+size_t DomainTrie::GetMemoryUsage() const
+{
+    return m_nodeCount * sizeof(DomainTrieNode) + (m_tableMask + size_t(1)) * sizeof(uint32_t) +
+           (m_file ? m_mappedLabelsSize : m_labels.size());
+}
+
+uint32_t DomainTrie::FindChild(uint32_t parent, std::string_view label, uint32_t hash) const
+{
+    const DomainTrieNode* nodes = Nodes();
+    const uint32_t* table = Table();
+    const char* labels = Labels();
+    for (uint32_t slot = hash & m_tableMask;; slot = (slot + 1) & m_tableMask)
+    {
+        uint32_t entry = table[slot];
+        if (entry == 0)
+        {
+            return 0;
+        }
+        const DomainTrieNode& node = nodes[entry - 1];
+        if (node.hash == hash && node.parent == parent && node.labelSize == label.size() &&
+            memcmp(labels + node.labelOffset, label.data(), label.size()) == 0)
+        {
+            return entry - 1;
+        }
+    }
+}
+
+uint32_t DomainTrie::FindDomain(std::string_view domain, bool create)
+{
+    if (domain.empty())
+    {
+        return 0;
+    }
+    uint32_t node = 0;
+    while (!domain.empty())
+    {
+        size_t dot = domain.rfind('.');
+        size_t start = dot == domain.npos ? 0 : dot + 1;
+        std::string_view label = domain.substr(start);
+        if (label.empty() || label.size() > c_maxDomainLabelSize)
+        {
+            return 0;
+        }
+        uint32_t hash = HashLabel(node, label.data(), label.size());
+        uint32_t child = FindChild(node, label, hash);
+        if (child == 0)
+        {
+            if (!create || m_nodeCount == UINT32_MAX ||
+                m_labels.size() + label.size() > UINT32_MAX)
+            {
+                return 0;
+            }
+            DomainTrieNode newNode = {};
+            newNode.parent = node;
+            newNode.labelOffset = static_cast<uint32_t>(m_labels.size());
+            newNode.labelSize = static_cast<uint16_t>(label.size());
+            newNode.hash = hash;
+            m_labels.append(label);
+            m_nodes.push_back(newNode);
+            child = m_nodeCount++;
+            if (size_t(m_nodeCount) * 2 > m_tableMask + size_t(1))
+            {
+                GrowTable();
+            }
+            else
+            {
+                InsertIntoTable(child);
+            }
+        }
+        node = child;
+        domain.remove_suffix(domain.size() - (dot == domain.npos ? 0 : dot));
+    }
+    return node;
+}
+
+void DomainTrie::Detach()
+{
+    if (!m_file)
+    {
+        return;
+    }
+    m_nodes.assign(m_mappedNodes, m_mappedNodes + m_nodeCount);
+    m_table.assign(m_mappedTable, m_mappedTable + m_tableMask + 1);
+    m_labels.assign(m_mappedLabels, m_mappedLabelsSize);
+    m_file.reset();
+    m_mappedNodes = nullptr;
+    m_mappedTable = nullptr;
+    m_mappedLabels = nullptr;
+    m_mappedLabelsSize = 0;
+}
+
+void DomainTrie::InsertIntoTable(uint32_t node)
+{
+    uint32_t slot = m_nodes[node].hash & m_tableMask;
+    while (m_table[slot] != 0)
+    {
+        slot = (slot + 1) & m_tableMask;
+    }
+    m_table[slot] = node + 1;
+}
+
+void DomainTrie::GrowTable()
+{
+    // Kept at most half full, so probes stay short.
+    m_table.assign(m_table.size() * 2, 0);
+    m_tableMask = static_cast<uint32_t>(m_table.size() - 1);
+    for (uint32_t node = 1; node < m_nodeCount; ++node)
+    {
+        InsertIntoTable(node);
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EventTrace.h"
+
+// A set of blocked domains, which answers whether a host or any domain it is
+// under is in the set: with "example.com" in it, "example.com" and
+// "www.example.com" are blocked, and "badexample.com" isn't.
+//
+// Domains are stored as a trie of their labels, from the last label to the
+// first, so a lookup takes one probe per label of the host and doesn't
+// allocate. Each node is a label and the node of the domain it is under; the
+// children of a node are found through one open-addressing hash table, keyed by
+// the parent and the label. Labels are kept lowercase, in UTF-8, which is ASCII
+// for every domain added through Add().
+//
+// The nodes, table and labels are flat arrays, which Write() saves as they are
+// and Open() maps back in, so a prebuilt list of any size is ready to use as
+// soon as it is mapped. Layout, little-endian:
+//
+//   DomainTrieHeader
+//   DomainTrieNode[nodeCount]        node 0 is the root, which has no label
+//   uint32_t[tableSize]              node index + 1, or 0 for an empty slot
+//   labels                           UTF-8, lowercase
+
+constexpr char c_domainTrieMagic[8] = {'W', 'V', '2', 'D', 'T', 'R', 'I', 'E'};
+constexpr uint32_t c_domainTrieVersion = 1;
+// The longest label, in UTF-8 bytes. DNS allows 63; names that aren't DNS
+// names, such as those of custom schemes, can be longer.
+constexpr size_t c_maxDomainLabelSize = 255;
+
+enum DomainTrieNodeFlags : uint16_t
+{
+    // The node's domain is in the set, and so is every domain under it.
+    DomainTrieNodeBlocked = 1,
+};
+
+struct DomainTrieHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t nodeCount;
+    // A power of two, larger than nodeCount.
+    uint32_t tableSize;
+    uint32_t labelsSize;
+    uint32_t domainCount;
+};
+
+struct DomainTrieNode
+{
+    // Every node's parent comes before it.
+    uint32_t parent;
+    uint32_t labelOffset;
+    uint16_t labelSize;
+    uint16_t flags;
+    // The hash of the parent and the label, which the table is keyed by.
+    uint32_t hash;
+};
+
+class DomainTrie
+{
+public:
+    DomainTrie();
+    DomainTrie(DomainTrie&&) = default;
+    DomainTrie& operator=(DomainTrie&&) = default;
+
+    // A trie written by Write(), mapped. nullptr if the file is missing or
+    // isn't a valid trie; every node and slot is checked first, so lookups
+    // don't have to.
+    static std::unique_ptr<DomainTrie> Open(const std::filesystem::path& path);
+    // Write the trie, to be opened with Open().
+    bool Write(const std::filesystem::path& path) const;
+
+    // Add a domain, such as "example.com". Surrounding whitespace, a leading
+    // "*." or "." and a trailing "." are ignored, and ASCII case is folded. A
+    // domain that isn't ASCII, such as "bücher.de", is mapped to the Punycode
+    // that Url gives its hosts, as DomainToAscii() does. Returns false if the
+    // domain is empty, has an empty or overlong label, or can't be mapped.
+    // A mapped trie is copied into memory the first time it is changed.
+    bool Add(std::wstring_view domain);
+    bool Add(std::string_view domain);
+    // Remove a domain that was added. Domains under it that were added too stay
+    // in the set, and its nodes stay for it to be added again. Returns false if
+    // it wasn't in the set.
+    bool Remove(std::wstring_view domain);
+    void Clear();
+
+    // Whether host, or any domain it is under, is in the set. Lookups of ASCII
+    // hosts, as Url gives them, don't allocate; other hosts are mapped to ASCII
+    // as Add() maps domains first.
+    bool Contains(std::wstring_view host) const;
+    bool Contains(std::string_view host) const;
+
+    // The domains in the set, as they were added after folding case and
+    // mapping to ASCII.
+    std::vector<std::wstring> GetDomains() const;
+    size_t GetDomainCount() const { return m_domainCount; }
+    // The bytes the nodes, table and labels take, mapped or not.
+    size_t GetMemoryUsage() const;
+
+private:
+    // Find the child of parent with a label, or return 0.
+    uint32_t FindChild(uint32_t parent, std::string_view label, uint32_t hash) const;
+    // The node of a domain, adding it and the nodes above it if create is set.
+    // Returns 0 if the domain isn't valid, or isn't there.
+    uint32_t FindDomain(std::string_view domain, bool create);
+    // Copy a mapped trie into memory, to change it.
+    void Detach();
+    void InsertIntoTable(uint32_t node);
+    void GrowTable();
+    template <typename Char> bool ContainsHost(std::basic_string_view<Char> host) const;
+
+    const DomainTrieNode* Nodes() const { return m_file ? m_mappedNodes : m_nodes.data(); }
+    const uint32_t* Table() const { return m_file ? m_mappedTable : m_table.data(); }
+    const char* Labels() const { return m_file ? m_mappedLabels : m_labels.data(); }
+
+    std::vector<DomainTrieNode> m_nodes;
+    std::vector<uint32_t> m_table;
+    std::string m_labels;
+    uint32_t m_nodeCount = 0;
+    uint32_t m_tableMask = 0;
+    size_t m_domainCount = 0;
+
+    // Set while the trie is mapped from a file, and not yet changed.
+    std::unique_ptr<MappedFile> m_file;
+    const DomainTrieNode* m_mappedNodes = nullptr;
+    const uint32_t* m_mappedTable = nullptr;
+    const char* m_mappedLabels = nullptr;
+    size_t m_mappedLabelsSize = 0;
+};
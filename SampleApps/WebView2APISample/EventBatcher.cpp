@@ -0,0 +1,72 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventBatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+EventBatcher::EventBatcher(Options options, Sink sink, Clock clock)
+    : m_options(options), m_sink(std::move(sink)), m_clock(std::move(clock))
+{
+    m_options.maxBatchEvents = (std::max)(m_options.maxBatchEvents, size_t(1));
+    m_lastFlush = m_clock();
+}
+
+void EventBatcher::OnEventsAvailable(uint64_t begin, uint64_t end)
+{
+    m_begin = begin;
+    m_end = end;
+    if (GetReadyCount() >= m_options.maxBatchEvents)
+    {
+        Flush();
+    }
+}
+
+void EventBatcher::OnRangeRequested(uint64_t next)
+{
+    m_hasRequest = true;
+    m_requested = next;
+    // Catch up quickly on a backlog instead of sending one batch per tick.
+    if (GetReadyCount() >= m_options.maxBatchEvents)
+    {
+        Flush();
+    }
+}
+
+void EventBatcher::OnTick()
+{
+    if (m_clock() - m_lastFlush >= m_options.flushInterval)
+    {
+        Flush();
+    }
+}
+
+void EventBatcher::Flush()
+{
+    if (!m_hasRequest || m_requested >= m_end)
+    {
+        return;
+    }
+
+    uint64_t first = (std::max)(m_requested, m_begin);
+    uint64_t dropped = first - m_requested;
+    size_t count =
+        static_cast<size_t>((std::min)(m_end - first, uint64_t(m_options.maxBatchEvents)));
+
+    m_hasRequest = false;
+    m_lastFlush = m_clock();
+    m_totalDropped += dropped;
+    m_sink(first, count, dropped);
+}
+
+uint64_t EventBatcher::GetReadyCount() const
+{
+    if (!m_hasRequest)
+    {
+        return 0;
+    }
+    uint64_t first = (std::max)(m_requested, m_begin);
+    return m_end > first ? m_end - first : 0;
+}
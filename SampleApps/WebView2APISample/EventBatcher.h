@@ -0,0 +1,69 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Decides when to send recorded events to a receiver that pulls them in
+// batches. Events are identified by consecutive sequence numbers; the events
+// themselves live elsewhere (see EventRing), and only [begin, end) are still
+// available.
+//
+// The receiver asks for the events from a sequence number on, and doesn't ask
+// again until it has handled the batch it was sent. A request is answered on
+// the first OnTick() after the flush interval has passed, or right away once
+// maxBatchEvents are ready. If the receiver asks for events that are no longer
+// available, the batch starts at begin and reports how many were dropped.
+//
+// The clock and sink are injected, so the timing and drop policy can be driven
+// deterministically.
+class EventBatcher
+{
+public:
+    using Clock = std::function<std::chrono::steady_clock::time_point()>;
+    // Send the events [first, first + count). dropped events before first were
+    // lost before the receiver could get them.
+    using Sink = std::function<void(uint64_t first, size_t count, uint64_t dropped)>;
+
+    struct Options
+    {
+        std::chrono::milliseconds flushInterval{16};
+        size_t maxBatchEvents = 256;
+    };
+
+    EventBatcher(Options options, Sink sink, Clock clock = std::chrono::steady_clock::now);
+
+    // The producer has recorded events. Only [begin, end) can still be sent.
+    void OnEventsAvailable(uint64_t begin, uint64_t end);
+    // The receiver wants the events from next on.
+    void OnRangeRequested(uint64_t next);
+    // Flush if the flush interval has passed since the last flush.
+    void OnTick();
+    // Answer the outstanding request now, if there is anything to send.
+    void Flush();
+
+    bool HasPendingRequest() const { return m_hasRequest; }
+    // Total number of events dropped since construction.
+    uint64_t GetDroppedCount() const { return m_totalDropped; }
+    const Options& GetOptions() const { return m_options; }
+
+private:
+    // Number of events that would be sent if the request were answered now.
+    uint64_t GetReadyCount() const;
+
+    Options m_options;
+    Sink m_sink;
+    Clock m_clock;
+
+    uint64_t m_begin = 0;
+    uint64_t m_end = 0;
+    bool m_hasRequest = false;
+    uint64_t m_requested = 0;
+    std::chrono::steady_clock::time_point m_lastFlush;
+    uint64_t m_totalDropped = 0;
+};
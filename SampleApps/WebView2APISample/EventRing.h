@@ -0,0 +1,91 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// A fixed-size, lock-free ring of records with one producer and any number of
+// readers. Every pushed record gets the next sequence number, starting at 0.
+// The producer never waits: once the ring is full each push overwrites the
+// oldest record, so memory stays bounded however long the session runs.
+//
+// Readers copy a record out by sequence number. Each slot carries the sequence
+// number of the record it holds, written after the record itself, so a reader
+// can tell when the record it wanted was overwritten while it was copying.
+template <typename Record> class EventRing
+{
+    static_assert(std::is_trivially_copyable<Record>::value, "Records are copied as raw memory");
+
+public:
+    // capacity is rounded up to a power of two.
+    explicit EventRing(size_t capacity)
+    {
+        m_capacity = 1;
+        while (m_capacity < capacity)
+        {
+            m_capacity <<= 1;
+        }
+        m_slots.reset(new Slot[m_capacity]);
+    }
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    // Producer only. Returns the sequence number of the new record.
+    uint64_t Push(const Record& record)
+    {
+        uint64_t sequence = m_end.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[sequence & (m_capacity - 1)];
+        slot.sequence.store(c_writing, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.store(sequence, std::memory_order_release);
+        m_end.store(sequence + 1, std::memory_order_release);
+        return sequence;
+    }
+
+    // The sequence number the next pushed record will get.
+    uint64_t End() const { return m_end.load(std::memory_order_acquire); }
+
+    // The oldest sequence number that may still be readable.
+    uint64_t Begin() const
+    {
+        uint64_t end = End();
+        return end > m_capacity ? end - m_capacity : 0;
+    }
+
+    size_t Capacity() const { return m_capacity; }
+
+    // Copy the record with the given sequence number into *record. Returns
+    // false if it hasn't been pushed yet or has already been overwritten.
+    bool TryRead(uint64_t sequence, Record* record) const
+    {
+        const Slot& slot = m_slots[sequence & (m_capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != sequence)
+        {
+            return false;
+        }
+        *record = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+private:
+    static constexpr uint64_t c_writing = ~uint64_t(0);
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{c_writing};
+        Record record;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_capacity;
+    std::atomic<uint64_t> m_end{0};
+};
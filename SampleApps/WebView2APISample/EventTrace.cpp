@@ -0,0 +1,536 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventTrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(EventTraceFileHeader) == 64, "The file header is part of the format");
+static_assert(sizeof(EventTraceBlockHeader) == 8, "The block header is part of the format");
+static_assert(sizeof(EventTraceEvent) == 40, "The event header is part of the format");
+static_assert(sizeof(EventTraceIndex) == 24, "The index header is part of the format");
+
+// The file grows by doubling, up to this much at a time.
+static constexpr size_t c_initialFileSize = 1024 * 1024;
+static constexpr size_t c_maxFileGrowth = 64 * 1024 * 1024;
+
+static size_t AlignBlockSize(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+size_t WriteUtf8(std::wstring_view value, char* out)
+{
+    char* start = out;
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        uint32_t codePoint = static_cast<uint32_t>(value[i]);
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+        {
+            // Only reachable with 16-bit wchar_t, or a malformed 32-bit string.
+            if (codePoint <= 0xDBFF && i + 1 < value.size() &&
+                value[i + 1] >= 0xDC00 && value[i + 1] <= 0xDFFF)
+            {
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) +
+                            (static_cast<uint32_t>(value[i + 1]) - 0xDC00);
+                ++i;
+            }
+            else
+            {
+                codePoint = 0xFFFD;
+            }
+        }
+        else if (codePoint > 0x10FFFF)
+        {
+            codePoint = 0xFFFD;
+        }
+
+        if (codePoint < 0x80)
+        {
+            *out++ = static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            *out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            *out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            *out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+    return out - start;
+}
+
+MappedFile::~MappedFile()
+{
+    Close(m_size);
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Create(const std::filesystem::path& path, size_t size)
+{
+    Close(m_size);
+    HANDLE file = CreateFileW(
+        path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_file = file;
+    m_writable = true;
+    m_size = size;
+    if (!Map())
+    {
+        Close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::OpenReadOnly(const std::filesystem::path& path)
+{
+    Close(m_size);
+    HANDLE file = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_file = file;
+    m_writable = false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || !Map())
+    {
+        Close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Map()
+{
+    if (!m_writable)
+    {
+        LARGE_INTEGER size;
+        GetFileSizeEx(m_file, &size);
+        m_size = static_cast<size_t>(size.QuadPart);
+    }
+    // A writable mapping larger than the file extends the file.
+    ULARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = m_size;
+    m_mapping = CreateFileMappingW(
+        m_file, nullptr, m_writable ? PAGE_READWRITE : PAGE_READONLY, mappingSize.HighPart,
+        mappingSize.LowPart, nullptr);
+    if (!m_mapping)
+    {
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(MapViewOfFile(
+        m_mapping, m_writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_size));
+    return m_data != nullptr;
+}
+
+void MappedFile::Unmap()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+}
+
+void MappedFile::Close(size_t finalSize)
+{
+    Unmap();
+    if (m_file)
+    {
+        if (m_writable)
+        {
+            LARGE_INTEGER size;
+            size.QuadPart = finalSize;
+            SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN);
+            SetEndOfFile(m_file);
+        }
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+    m_size = 0;
+}
+
+#else
+
+bool MappedFile::Create(const std::filesystem::path& path, size_t size)
+{
+    Close(m_size);
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    m_writable = true;
+    m_size = size;
+    if (ftruncate(m_fd, size) != 0 || !Map())
+    {
+        Close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::OpenReadOnly(const std::filesystem::path& path)
+{
+    Close(m_size);
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    m_writable = false;
+    struct stat status;
+    if (fstat(m_fd, &status) != 0 || status.st_size == 0)
+    {
+        Close(0);
+        return false;
+    }
+    m_size = static_cast<size_t>(status.st_size);
+    if (!Map())
+    {
+        Close(0);
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Map()
+{
+    void* data = mmap(
+        nullptr, m_size, m_writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(data);
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (m_data)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+}
+
+void MappedFile::Close(size_t finalSize)
+{
+    Unmap();
+    if (m_fd >= 0)
+    {
+        if (m_writable && ftruncate(m_fd, finalSize) != 0)
+        {
+            // The trace is still readable; it just keeps its unused tail.
+        }
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+#endif
+
+bool MappedFile::Resize(size_t size)
+{
+    if (!m_writable)
+    {
+        return false;
+    }
+    Unmap();
+    m_size = size;
+#ifndef _WIN32
+    if (ftruncate(m_fd, size) != 0)
+    {
+        return false;
+    }
+#endif
+    return Map();
+}
+
+EventTraceWriter::~EventTraceWriter()
+{
+    Close();
+}
+
+bool EventTraceWriter::Open(const std::filesystem::path& path)
+{
+    Close();
+    if (!m_file.Create(path, c_initialFileSize))
+    {
+        return false;
+    }
+    EventTraceFileHeader* header = Header();
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, c_eventTraceMagic, sizeof(header->magic));
+    header->version = c_eventTraceVersion;
+    header->headerSize = sizeof(EventTraceFileHeader);
+    m_size = sizeof(EventTraceFileHeader);
+    m_eventCount = 0;
+    m_lastIndexOffset = 0;
+    m_unindexed.clear();
+    Commit();
+    return true;
+}
+
+void EventTraceWriter::Close()
+{
+    if (!m_file.IsOpen())
+    {
+        return;
+    }
+    WriteIndex();
+    m_file.Close(m_size);
+}
+
+bool EventTraceWriter::Reserve(size_t size)
+{
+    if (m_size + size <= m_file.Size())
+    {
+        return true;
+    }
+    size_t newSize = m_file.Size() + (std::min)(m_file.Size(), c_maxFileGrowth);
+    newSize = (std::max)(newSize, m_size + size);
+    return m_file.Resize(newSize);
+}
+
+bool EventTraceWriter::Append(
+    EventTraceEvent event, std::wstring_view uri, std::wstring_view json)
+{
+    if (!m_file.IsOpen())
+    {
+        return false;
+    }
+    size_t maxSize =
+        sizeof(EventTraceBlockHeader) + sizeof(EventTraceEvent) + 4 * (uri.size() + json.size());
+    if (maxSize > UINT32_MAX || !Reserve(AlignBlockSize(maxSize)))
+    {
+        return false;
+    }
+
+    uint8_t* block = m_file.Data() + m_size;
+    char* text = reinterpret_cast<char*>(
+        block + sizeof(EventTraceBlockHeader) + sizeof(EventTraceEvent));
+    event.sequence = m_eventCount;
+    event.uriSize = static_cast<uint32_t>(WriteUtf8(uri, text));
+    event.jsonSize = static_cast<uint32_t>(WriteUtf8(json, text + event.uriSize));
+    event.reserved = 0;
+    size_t blockSize = AlignBlockSize(
+        sizeof(EventTraceBlockHeader) + sizeof(EventTraceEvent) + event.uriSize +
+        event.jsonSize);
+    EventTraceBlockHeader blockHeader = {
+        EventTraceBlockType::Event, static_cast<uint32_t>(blockSize)};
+    memcpy(block, &blockHeader, sizeof(blockHeader));
+    memcpy(block + sizeof(blockHeader), &event, sizeof(event));
+
+    m_unindexed.push_back(m_size);
+    m_size += blockSize;
+    ++m_eventCount;
+    if (m_unindexed.size() >= c_eventTraceIndexInterval)
+    {
+        return WriteIndex();
+    }
+    Commit();
+    return true;
+}
+
+bool EventTraceWriter::WriteIndex()
+{
+    if (m_unindexed.empty())
+    {
+        return true;
+    }
+    size_t blockSize = sizeof(EventTraceBlockHeader) + sizeof(EventTraceIndex) +
+                       m_unindexed.size() * sizeof(uint64_t);
+    if (!Reserve(blockSize))
+    {
+        return false;
+    }
+
+    uint8_t* block = m_file.Data() + m_size;
+    EventTraceBlockHeader blockHeader = {
+        EventTraceBlockType::Index, static_cast<uint32_t>(blockSize)};
+    EventTraceIndex index = {};
+    index.firstSequence = m_eventCount - m_unindexed.size();
+    index.previousIndexOffset = m_lastIndexOffset;
+    index.count = static_cast<uint32_t>(m_unindexed.size());
+    memcpy(block, &blockHeader, sizeof(blockHeader));
+    memcpy(block + sizeof(blockHeader), &index, sizeof(index));
+    memcpy(
+        block + sizeof(blockHeader) + sizeof(index), m_unindexed.data(),
+        m_unindexed.size() * sizeof(uint64_t));
+
+    m_lastIndexOffset = m_size;
+    m_size += blockSize;
+    m_unindexed.clear();
+    Commit();
+    return true;
+}
+
+void EventTraceWriter::Commit()
+{
+    EventTraceFileHeader* header = Header();
+    header->eventCount = m_eventCount;
+    header->lastIndexOffset = m_lastIndexOffset;
+    header->committedSize = m_size;
+}
+
+bool EventTraceReader::Open(const std::filesystem::path& path)
+{
+    if (!m_file.OpenReadOnly(path) || m_file.Size() < sizeof(EventTraceFileHeader))
+    {
+        return false;
+    }
+    EventTraceFileHeader header;
+    memcpy(&header, m_file.Data(), sizeof(header));
+    if (memcmp(header.magic, c_eventTraceMagic, sizeof(header.magic)) != 0 ||
+        header.version != c_eventTraceVersion || header.headerSize < sizeof(header) ||
+        header.headerSize > header.committedSize || header.committedSize > m_file.Size())
+    {
+        return false;
+    }
+    m_headerSize = header.headerSize;
+    m_committedSize = header.committedSize;
+    m_lastIndexOffset = header.lastIndexOffset;
+    m_eventCount = header.eventCount;
+    return true;
+}
+
+bool EventTraceReader::ReadBlock(uint64_t offset, EventTraceBlockHeader* header) const
+{
+    if (offset < m_headerSize || offset + sizeof(*header) > m_committedSize)
+    {
+        return false;
+    }
+    memcpy(header, m_file.Data() + offset, sizeof(*header));
+    return header->size >= sizeof(*header) && header->size <= m_committedSize - offset;
+}
+
+uint64_t EventTraceReader::Seek(uint64_t sequence) const
+{
+    // Walk back through the index blocks to the one covering sequence.
+    uint64_t indexOffset = m_lastIndexOffset;
+    bool isLastIndex = true;
+    while (indexOffset != 0)
+    {
+        EventTraceBlockHeader blockHeader;
+        EventTraceIndex index;
+        if (!ReadBlock(indexOffset, &blockHeader) ||
+            blockHeader.type != EventTraceBlockType::Index ||
+            blockHeader.size < sizeof(blockHeader) + sizeof(index))
+        {
+            break;
+        }
+        const uint8_t* data = m_file.Data() + indexOffset + sizeof(blockHeader);
+        memcpy(&index, data, sizeof(index));
+        if (sizeof(blockHeader) + sizeof(index) + uint64_t(index.count) * sizeof(uint64_t) >
+            blockHeader.size)
+        {
+            break;
+        }
+        if (sequence >= index.firstSequence + index.count)
+        {
+            // Past the newest index: scan the events written after it.
+            if (isLastIndex)
+            {
+                return indexOffset + blockHeader.size;
+            }
+            break;
+        }
+        if (sequence >= index.firstSequence)
+        {
+            uint64_t offset;
+            memcpy(
+                &offset,
+                data + sizeof(index) + (sequence - index.firstSequence) * sizeof(uint64_t),
+                sizeof(offset));
+            return offset;
+        }
+        // Index blocks only point back, so a damaged trace can't loop.
+        if (index.previousIndexOffset >= indexOffset)
+        {
+            break;
+        }
+        indexOffset = index.previousIndexOffset;
+        isLastIndex = false;
+    }
+
+    // No usable index: scan from the start.
+    uint64_t offset = m_headerSize;
+    for (uint64_t next = offset;; offset = next)
+    {
+        EventTraceEntry entry;
+        if (!Next(&next, &entry) || entry.event.sequence >= sequence)
+        {
+            return offset;
+        }
+    }
+}
+
+bool EventTraceReader::Next(uint64_t* offset, EventTraceEntry* entry) const
+{
+    EventTraceBlockHeader blockHeader;
+    while (ReadBlock(*offset, &blockHeader))
+    {
+        uint64_t blockOffset = *offset;
+        *offset += blockHeader.size;
+        if (blockHeader.type != EventTraceBlockType::Event)
+        {
+            continue;
+        }
+        if (blockHeader.size < sizeof(blockHeader) + sizeof(entry->event))
+        {
+            return false;
+        }
+        const uint8_t* data = m_file.Data() + blockOffset + sizeof(blockHeader);
+        memcpy(&entry->event, data, sizeof(entry->event));
+        if (sizeof(blockHeader) + sizeof(entry->event) + uint64_t(entry->event.uriSize) +
+                entry->event.jsonSize >
+            blockHeader.size)
+        {
+            return false;
+        }
+        const char* text = reinterpret_cast<const char*>(data + sizeof(entry->event));
+        entry->uri = std::string_view(text, entry->event.uriSize);
+        entry->json = std::string_view(text + entry->event.uriSize, entry->event.jsonSize);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+// An event trace is an append-only file of the events the event monitor saw,
+// so a long session can be examined after the event view is closed. It is
+// written and read through a memory mapping, and EventTraceTool reads it on
+// any machine.
+//
+// Layout, little-endian, every block 8-byte aligned:
+//
+//   EventTraceFileHeader
+//   EventTraceBlockHeader + EventTraceEvent + URI + event JSON   (event block)
+//   ...
+//   EventTraceBlockHeader + EventTraceIndex + block offsets      (index block)
+//   ...
+//
+// After every c_eventTraceIndexInterval events an index block lists the offsets
+// of those events and the offset of the previous index block, so an event can
+// be found by sequence number without scanning the file. The header is updated
+// after each block is complete, and readers stop at committedSize, so a trace
+// cut short by a crash is readable up to the last event written.
+
+constexpr char c_eventTraceMagic[8] = {'W', 'V', '2', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t c_eventTraceVersion = 1;
+constexpr uint32_t c_eventTraceIndexInterval = 1024;
+
+struct EventTraceFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    // The file is valid up to here; anything after is unwritten.
+    uint64_t committedSize;
+    // 0 if there is no index block yet.
+    uint64_t lastIndexOffset;
+    uint64_t eventCount;
+    uint64_t reserved[3];
+};
+
+enum class EventTraceBlockType : uint32_t
+{
+    Event = 1,
+    Index = 2,
+};
+
+struct EventTraceBlockHeader
+{
+    EventTraceBlockType type;
+    // Size of the whole block including this header and padding.
+    uint32_t size;
+};
+
+struct EventTraceEvent
+{
+    // Position of the event in the trace, starting at 0.
+    uint64_t sequence;
+    // Microseconds on the steady clock when the event handler ran.
+    int64_t timestamp;
+    uint64_t navigationId;
+    // A MonitorEventKind.
+    uint16_t kind;
+    uint16_t flags;
+    // Sizes in bytes of the UTF-8 URI and event JSON that follow.
+    uint32_t uriSize;
+    uint32_t jsonSize;
+    uint32_t reserved;
+};
+
+struct EventTraceIndex
+{
+    uint64_t firstSequence;
+    uint64_t previousIndexOffset;
+    // Number of uint64_t event block offsets that follow.
+    uint32_t count;
+    uint32_t reserved;
+};
+
+// A file mapped into memory, either read-only or growable for writing.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Create or truncate the file and map its first size bytes for writing.
+    bool Create(const std::filesystem::path& path, size_t size);
+    // Map the whole of an existing file for reading.
+    bool OpenReadOnly(const std::filesystem::path& path);
+    // Change the size of a file opened with Create. Data moves.
+    bool Resize(size_t size);
+    // Unmap and close. A file opened with Create is cut to finalSize.
+    void Close(size_t finalSize);
+
+    bool IsOpen() const { return m_data != nullptr; }
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    bool Map();
+    void Unmap();
+
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_writable = false;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+class EventTraceWriter
+{
+public:
+    ~EventTraceWriter();
+
+    bool Open(const std::filesystem::path& path);
+    // Write the final index block and cut the file to its committed size.
+    void Close();
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+    // Append an event. sequence is assigned by the writer; uri and json are
+    // stored as UTF-8.
+    bool Append(EventTraceEvent event, std::wstring_view uri, std::wstring_view json);
+
+    uint64_t GetEventCount() const { return m_eventCount; }
+
+private:
+    EventTraceFileHeader* Header() const
+    {
+        return reinterpret_cast<EventTraceFileHeader*>(m_file.Data());
+    }
+    // Make room for size more bytes after m_size.
+    bool Reserve(size_t size);
+    bool WriteIndex();
+    void Commit();
+
+    MappedFile m_file;
+    size_t m_size = 0;
+    uint64_t m_eventCount = 0;
+    uint64_t m_lastIndexOffset = 0;
+    // Offsets of the event blocks written since the last index block.
+    std::vector<uint64_t> m_unindexed;
+};
+
+struct EventTraceEntry
+{
+    EventTraceEvent event;
+    std::string_view uri;
+    std::string_view json;
+};
+
+class EventTraceReader
+{
+public:
+    // Returns false if the file can't be mapped or isn't a trace of a known
+    // version.
+    bool Open(const std::filesystem::path& path);
+
+    uint64_t GetEventCount() const { return m_eventCount; }
+
+    // The offset to pass to Next to read from the event with the given
+    // sequence number on.
+    uint64_t Seek(uint64_t sequence) const;
+    // Read the event at or after *offset and move *offset past it. Returns
+    // false at the end of the trace, or if the rest of it is damaged.
+    bool Next(uint64_t* offset, EventTraceEntry* entry) const;
+
+private:
+    bool ReadBlock(uint64_t offset, EventTraceBlockHeader* header) const;
+
+    MappedFile m_file;
+    uint64_t m_committedSize = 0;
+    uint64_t m_lastIndexOffset = 0;
+    uint64_t m_eventCount = 0;
+    uint32_t m_headerSize = 0;
+};
+
+// Write value as UTF-8 to out, which must have room for 4 bytes per code
+// unit. Returns the number of bytes written. Unpaired surrogates become U+FFFD.
+size_t WriteUtf8(std::wstring_view value, char* out);
@@ -0,0 +1,76 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapLeakDetector.h"
+
+#include <algorithm>
+#include <vector>
+
+double GetTheilSenSlope(
+    const double* times, const double* values, size_t count, double* risingFraction)
+{
+    std::vector<double> slopes;
+    slopes.reserve(count > 1 ? count * (count - 1) / 2 : 0);
+    size_t rising = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t j = i + 1; j < count; ++j)
+        {
+            if (times[j] == times[i])
+            {
+                continue;
+            }
+            double slope = (values[j] - values[i]) / (times[j] - times[i]);
+            rising += slope > 0;
+            slopes.push_back(slope);
+        }
+    }
+    if (risingFraction)
+    {
+        *risingFraction = slopes.empty() ? 0 : double(rising) / slopes.size();
+    }
+    if (slopes.empty())
+    {
+        return 0;
+    }
+    size_t middle = slopes.size() / 2;
+    std::nth_element(slopes.begin(), slopes.begin() + middle, slopes.end());
+    double median = slopes[middle];
+    if (slopes.size() % 2 == 0)
+    {
+        median = (median + *std::max_element(slopes.begin(), slopes.begin() + middle)) / 2;
+    }
+    return median;
+}
+
+HeapLeakReport DetectHeapLeak(const HeapTimeSeries& series, const HeapLeakOptions& options)
+{
+    // The period in progress is left out, as its floor is still coming down.
+    size_t available = series.GetCompleteSampleCount(options.tier);
+    size_t count = (std::min)(available, options.window);
+    HeapLeakReport report;
+    report.sampleCount = count;
+    if (count < 2)
+    {
+        return report;
+    }
+    std::vector<double> hours(count);
+    std::vector<double> floors(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        HeapSample sample = series.GetSample(options.tier, available - count + i);
+        hours[i] = sample.time / (60.0 * 60 * 1000);
+        floors[i] = sample.usedMin;
+    }
+    report.slopeBytesPerHour =
+        GetTheilSenSlope(hours.data(), floors.data(), count, &report.risingFraction);
+    size_t half = count / 2;
+    report.recentSlopeBytesPerHour =
+        GetTheilSenSlope(hours.data() + half, floors.data() + half, count - half);
+    report.suspected = count >= options.minSamples &&
+                       report.slopeBytesPerHour >= options.minSlopeBytesPerHour &&
+                       report.recentSlopeBytesPerHour >= options.minSlopeBytesPerHour / 2 &&
+                       report.risingFraction >= options.minRisingFraction;
+    return report;
+}
@@ -0,0 +1,50 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+
+#include "HeapTimeSeries.h"
+
+struct HeapLeakOptions
+{
+    // The tier to look at, and how many of its latest ended periods.
+    HeapTier tier = HeapTier::Minute;
+    size_t window = 60;
+    // Fewer periods than this are never reported as a leak.
+    size_t minSamples = 10;
+    // How fast the heap must keep growing to be reported.
+    double minSlopeBytesPerHour = 1024 * 1024;
+    // The share of pairs of periods in which the later one is higher.
+    double minRisingFraction = 0.75;
+};
+
+struct HeapLeakReport
+{
+    bool suspected = false;
+    size_t sampleCount = 0;
+    // The growth over the whole window, and over its later half.
+    double slopeBytesPerHour = 0;
+    double recentSlopeBytesPerHour = 0;
+    double risingFraction = 0;
+};
+
+// Decide whether a target's heap is growing steadily. Each period is measured
+// by its lowest used size, the floor that garbage collection gets back to, so
+// the sawtooth of allocation and collection doesn't count as growth.
+//
+// The growth is the Theil-Sen slope, the median of the slopes between every
+// pair of periods, which a few outliers such as a burst of allocations can't
+// move. A leak is reported when the slope is large enough, most pairs rise,
+// and the later half of the window still grows at least half as fast, so a
+// heap that grew once and then leveled off isn't reported.
+HeapLeakReport DetectHeapLeak(
+    const HeapTimeSeries& series, const HeapLeakOptions& options = HeapLeakOptions());
+
+// The Theil-Sen slope of the points (times[i], values[i]), and the share of
+// pairs of points in which the later one is higher. Both are 0 for fewer than
+// two distinct times.
+double GetTheilSenSlope(
+    const double* times, const double* values, size_t count, double* risingFraction = nullptr);
@@ -0,0 +1,154 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapSampleStore.h"
+
+#include <algorithm>
+#include <charconv>
+
+#include "JsonWriter.h"
+
+namespace
+{
+void AppendNumber(std::wstring& out, double value)
+{
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+// A CSV field, quoted if it has a comma, quote or line break.
+void AppendCsvField(std::wstring& out, std::wstring_view field)
+{
+    if (field.find_first_of(L",\"\r\n") == std::wstring_view::npos)
+    {
+        out += field;
+        return;
+    }
+    out += L'"';
+    for (wchar_t c : field)
+    {
+        if (c == L'"')
+        {
+            out += L'"';
+        }
+        out += c;
+    }
+    out += L'"';
+}
+} // namespace
+
+HeapSampleStore::Target& HeapSampleStore::Add(
+    std::wstring_view targetId, std::wstring_view label, int64_t time, double usedBytes,
+    double totalBytes)
+{
+    auto found = m_targets.find(targetId);
+    if (found == m_targets.end())
+    {
+        found = m_targets.emplace(std::wstring(targetId), std::make_unique<Target>()).first;
+    }
+    Target& target = *found->second;
+    target.label = label;
+    target.series.Add(time, usedBytes, totalBytes);
+    return target;
+}
+
+void HeapSampleStore::Retain(const std::vector<std::wstring>& targetIds)
+{
+    for (auto target = m_targets.begin(); target != m_targets.end();)
+    {
+        if (std::find(targetIds.begin(), targetIds.end(), target->first) == targetIds.end())
+        {
+            target = m_targets.erase(target);
+        }
+        else
+        {
+            ++target;
+        }
+    }
+}
+
+const HeapSampleStore::Target* HeapSampleStore::GetTarget(std::wstring_view targetId) const
+{
+    auto found = m_targets.find(targetId);
+    return found == m_targets.end() ? nullptr : found->second.get();
+}
+
+void HeapSampleStore::WriteCsv(std::wstring& csv) const
+{
+    csv += L"targetId,label,tier,time,count,usedMin,usedMax,usedMean,totalMean\r\n";
+    for (const auto& entry : m_targets)
+    {
+        const Target& target = *entry.second;
+        for (size_t tier = 0; tier < static_cast<size_t>(HeapTier::Count); ++tier)
+        {
+            HeapTier heapTier = static_cast<HeapTier>(tier);
+            size_t count = target.series.GetSampleCount(heapTier);
+            for (size_t i = 0; i < count; ++i)
+            {
+                HeapSample sample = target.series.GetSample(heapTier, i);
+                AppendCsvField(csv, entry.first);
+                csv += L',';
+                AppendCsvField(csv, target.label);
+                csv += L',';
+                csv += HeapTierToString(heapTier);
+                csv += L',';
+                csv += std::to_wstring(sample.time);
+                csv += L',';
+                csv += std::to_wstring(sample.count);
+                for (double value :
+                     {sample.usedMin, sample.usedMax, sample.usedMean, sample.totalMean})
+                {
+                    csv += L',';
+                    AppendNumber(csv, value);
+                }
+                csv += L"\r\n";
+            }
+        }
+    }
+}
+
+void HeapSampleStore::WriteJson(JsonWriter& json) const
+{
+    json.BeginObject();
+    json.Key(L"targets").BeginArray();
+    for (const auto& entry : m_targets)
+    {
+        const Target& target = *entry.second;
+        json.BeginObject();
+        json.Key(L"targetId").String(entry.first);
+        json.Key(L"label").String(target.label);
+        json.Key(L"leak").BeginObject();
+        json.Key(L"suspected").Bool(target.leak.suspected);
+        json.Key(L"samples").UInt(target.leak.sampleCount);
+        json.Key(L"slopeBytesPerHour").Double(target.leak.slopeBytesPerHour);
+        json.Key(L"recentSlopeBytesPerHour").Double(target.leak.recentSlopeBytesPerHour);
+        json.Key(L"risingFraction").Double(target.leak.risingFraction);
+        json.EndObject();
+        json.Key(L"tiers").BeginObject();
+        for (size_t tier = 0; tier < static_cast<size_t>(HeapTier::Count); ++tier)
+        {
+            HeapTier heapTier = static_cast<HeapTier>(tier);
+            json.Key(HeapTierToString(heapTier)).BeginArray();
+            size_t count = target.series.GetSampleCount(heapTier);
+            for (size_t i = 0; i < count; ++i)
+            {
+                HeapSample sample = target.series.GetSample(heapTier, i);
+                json.BeginObject();
+                json.Key(L"time").Int(sample.time);
+                json.Key(L"count").UInt(sample.count);
+                json.Key(L"usedMin").Double(sample.usedMin);
+                json.Key(L"usedMax").Double(sample.usedMax);
+                json.Key(L"usedMean").Double(sample.usedMean);
+                json.Key(L"totalMean").Double(sample.totalMean);
+                json.EndObject();
+            }
+            json.EndArray();
+        }
+        json.EndObject();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+}
@@ -0,0 +1,63 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "HeapLeakDetector.h"
+#include "HeapTimeSeries.h"
+
+class JsonWriter;
+
+// The heap usage of every target that is being sampled, by target ID, with
+// exports for analysis elsewhere.
+class HeapSampleStore
+{
+public:
+    struct Target
+    {
+        std::wstring label;
+        HeapTimeSeries series;
+        HeapLeakReport leak;
+        // Set once the target is first suspected of leaking, so that it is
+        // reported once.
+        bool leakReported = false;
+    };
+
+    // Record a sample for a target, which is added if it's new. Times are in
+    // milliseconds since sampling started.
+    Target& Add(
+        std::wstring_view targetId, std::wstring_view label, int64_t time, double usedBytes,
+        double totalBytes);
+    // Forget every target that isn't in targetIds, such as detached workers.
+    void Retain(const std::vector<std::wstring>& targetIds);
+    void Clear() { m_targets.clear(); }
+
+    size_t GetTargetCount() const { return m_targets.size(); }
+    const Target* GetTarget(std::wstring_view targetId) const;
+    // Call visitor(targetId, target) for each target, in order of ID.
+    template <typename Visitor> void ForEachTarget(Visitor&& visitor)
+    {
+        for (auto& target : m_targets)
+        {
+            visitor(target.first, *target.second);
+        }
+    }
+
+    // One row per period of every tier, after a header row:
+    // targetId,label,tier,time,count,usedMin,usedMax,usedMean,totalMean
+    void WriteCsv(std::wstring& csv) const;
+    // {"targets":[{"targetId", "label", "leak":{...}, "tiers":{"second":[...],
+    // "minute":[...], "hour":[...]}}]}, with a period as
+    // {"time", "count", "usedMin", "usedMax", "usedMean", "totalMean"}.
+    void WriteJson(JsonWriter& json) const;
+
+private:
+    std::map<std::wstring, std::unique_ptr<Target>, std::less<>> m_targets;
+};
@@ -0,0 +1,128 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapTimeSeries.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+constexpr int64_t c_periods[] = {1000, 60 * 1000, 60 * 60 * 1000};
+constexpr size_t c_capacities[] = {10 * 60, 24 * 60, 30 * 24};
+static_assert(std::size(c_periods) == static_cast<size_t>(HeapTier::Count), "");
+static_assert(std::size(c_capacities) == static_cast<size_t>(HeapTier::Count), "");
+
+// Combine b into a.
+void Merge(HeapSample& a, const HeapSample& b)
+{
+    double count = double(a.count) + b.count;
+    a.usedMin = (std::min)(a.usedMin, b.usedMin);
+    a.usedMax = (std::max)(a.usedMax, b.usedMax);
+    a.usedMean = (a.usedMean * a.count + b.usedMean * b.count) / count;
+    a.totalMean = (a.totalMean * a.count + b.totalMean * b.count) / count;
+    a.count += b.count;
+}
+} // namespace
+
+const wchar_t* HeapTierToString(HeapTier tier)
+{
+    switch (tier)
+    {
+    case HeapTier::Second:
+        return L"second";
+    case HeapTier::Minute:
+        return L"minute";
+    case HeapTier::Hour:
+        return L"hour";
+    default:
+        return L"";
+    }
+}
+
+HeapTimeSeries::HeapTimeSeries()
+{
+    for (size_t tier = 0; tier < std::size(m_tiers); ++tier)
+    {
+        m_tiers[tier].ring.resize(c_capacities[tier]);
+    }
+}
+
+int64_t HeapTimeSeries::GetPeriod(HeapTier tier)
+{
+    return c_periods[static_cast<size_t>(tier)];
+}
+
+size_t HeapTimeSeries::GetCapacity(HeapTier tier)
+{
+    return c_capacities[static_cast<size_t>(tier)];
+}
+
+void HeapTimeSeries::Add(int64_t time, double usedBytes, double totalBytes)
+{
+    const Tier& seconds = m_tiers[0];
+    if (seconds.current.count != 0 && time < seconds.current.time)
+    {
+        return;
+    }
+    HeapSample sample;
+    sample.time = time;
+    sample.count = 1;
+    sample.usedMin = usedBytes;
+    sample.usedMax = usedBytes;
+    sample.usedMean = usedBytes;
+    sample.totalMean = totalBytes;
+    AddToTier(0, sample);
+}
+
+void HeapTimeSeries::AddToTier(size_t tier, const HeapSample& sample)
+{
+    Tier& target = m_tiers[tier];
+    int64_t start = sample.time - sample.time % c_periods[tier];
+    if (target.current.count != 0 && target.current.time == start)
+    {
+        Merge(target.current, sample);
+        return;
+    }
+    if (target.current.count != 0)
+    {
+        HeapSample ended = target.current;
+        if (target.count < target.ring.size())
+        {
+            target.ring[(target.begin + target.count++) % target.ring.size()] = ended;
+        }
+        else
+        {
+            target.ring[target.begin] = ended;
+            target.begin = (target.begin + 1) % target.ring.size();
+        }
+        if (tier + 1 < std::size(m_tiers))
+        {
+            AddToTier(tier + 1, ended);
+        }
+    }
+    target.current = sample;
+    target.current.time = start;
+}
+
+size_t HeapTimeSeries::GetSampleCount(HeapTier tier) const
+{
+    const Tier& source = m_tiers[static_cast<size_t>(tier)];
+    return source.count + (source.current.count != 0 ? 1 : 0);
+}
+
+size_t HeapTimeSeries::GetCompleteSampleCount(HeapTier tier) const
+{
+    return m_tiers[static_cast<size_t>(tier)].count;
+}
+
+HeapSample HeapTimeSeries::GetSample(HeapTier tier, size_t index) const
+{
+    const Tier& source = m_tiers[static_cast<size_t>(tier)];
+    if (index < source.count)
+    {
+        return source.ring[(source.begin + index) % source.ring.size()];
+    }
+    return index == source.count ? source.current : HeapSample();
+}
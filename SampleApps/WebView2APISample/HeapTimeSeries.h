@@ -0,0 +1,73 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The JS heap usage of one target over a period of time: either one sample as
+// reported by Runtime.getHeapUsage, or several combined.
+struct HeapSample
+{
+    // The start of the period, in milliseconds on the sampler's clock.
+    int64_t time = 0;
+    // How many samples were combined; 0 for no sample.
+    uint32_t count = 0;
+    double usedMin = 0;
+    double usedMax = 0;
+    double usedMean = 0;
+    double totalMean = 0;
+};
+
+// The resolutions a HeapTimeSeries keeps.
+enum class HeapTier
+{
+    Second,
+    Minute,
+    Hour,
+    Count,
+};
+
+const wchar_t* HeapTierToString(HeapTier tier);
+
+// The heap usage of one target, kept in fixed memory however long it is
+// sampled. Samples are combined into one per second, and each tier is a ring
+// buffer that keeps its latest periods: 10 minutes of seconds, a day of
+// minutes and 30 days of hours. When a period of one tier ends, it is added
+// to the next tier in turn, so each tier's periods combine every sample of
+// the lower tiers.
+class HeapTimeSeries
+{
+public:
+    HeapTimeSeries();
+
+    // Record a sample. Samples from before the current second are ignored.
+    void Add(int64_t time, double usedBytes, double totalBytes);
+
+    // The number of periods of a tier, including the one in progress.
+    size_t GetSampleCount(HeapTier tier) const;
+    // The number of periods of a tier that have ended.
+    size_t GetCompleteSampleCount(HeapTier tier) const;
+    // A period of a tier, oldest first. The period in progress is last.
+    HeapSample GetSample(HeapTier tier, size_t index) const;
+
+    static int64_t GetPeriod(HeapTier tier);
+    static size_t GetCapacity(HeapTier tier);
+
+private:
+    struct Tier
+    {
+        std::vector<HeapSample> ring;
+        // The index in ring of the oldest period.
+        size_t begin = 0;
+        size_t count = 0;
+        HeapSample current;
+    };
+
+    void AddToTier(size_t tier, const HeapSample& sample);
+
+    Tier m_tiers[static_cast<size_t>(HeapTier::Count)];
+};
@@ -0,0 +1,329 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HttpSemantics.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+// Ranges beyond this many are taken for abuse, and the Range is ignored.
+constexpr size_t c_maxRanges = 64;
+// Ranges closer than this are cheaper to send as one part than as two.
+constexpr uint64_t c_coalesceGap = 80;
+
+bool IsWhitespace(wchar_t c)
+{
+    return c == L' ' || c == L'\t';
+}
+
+std::wstring_view Trim(std::wstring_view text)
+{
+    while (!text.empty() && IsWhitespace(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && IsWhitespace(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool EqualsIgnoringCase(std::wstring_view text, std::wstring_view lowercase)
+{
+    if (text.size() != lowercase.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        wchar_t c = text[i];
+        if (c >= L'A' && c <= L'Z')
+        {
+            c += L'a' - L'A';
+        }
+        if (c != lowercase[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Parse the entity tag at the start of text, as [W/] and a quoted opaque tag,
+// and remove it from text. Returns false if it is malformed.
+bool ParseEntityTag(std::wstring_view* text, std::wstring_view* opaqueTag, bool* weak)
+{
+    *weak = text->size() >= 2 && (*text)[0] == L'W' && (*text)[1] == L'/';
+    size_t start = *weak ? 2 : 0;
+    if (text->size() <= start || (*text)[start] != L'"')
+    {
+        return false;
+    }
+    size_t end = text->find(L'"', start + 1);
+    if (end == std::wstring_view::npos)
+    {
+        return false;
+    }
+    for (size_t i = start + 1; i < end; ++i)
+    {
+        // etagc = %x21 / %x23-7E / obs-text
+        if ((*text)[i] <= 0x20 || (*text)[i] == 0x7F)
+        {
+            return false;
+        }
+    }
+    *opaqueTag = text->substr(start, end + 1 - start);
+    text->remove_prefix(end + 1);
+    return true;
+}
+
+// Parse 1*DIGIT, saturating at UINT64_MAX. Returns false if text isn't digits.
+bool ParsePosition(std::wstring_view text, uint64_t* value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    *value = 0;
+    for (wchar_t c : text)
+    {
+        if (c < L'0' || c > L'9')
+        {
+            return false;
+        }
+        uint64_t digit = c - L'0';
+        *value = *value > (UINT64_MAX - digit) / 10 ? UINT64_MAX : *value * 10 + digit;
+    }
+    return true;
+}
+
+std::string FormatContentRangeUtf8(const ByteRange& range, uint64_t size)
+{
+    char text[80];
+    snprintf(
+        text, sizeof(text), "bytes %" PRIu64 "-%" PRIu64 "/%" PRIu64, range.offset,
+        range.offset + range.size - 1, size);
+    return text;
+}
+
+std::wstring Widen(const std::string& ascii)
+{
+    return std::wstring(ascii.begin(), ascii.end());
+}
+} // namespace
+
+std::wstring FormatEntityTag(uint64_t hash, bool weak)
+{
+    char text[24];
+    snprintf(text, sizeof(text), "%s\"%016" PRIx64 "\"", weak ? "W/" : "", hash);
+    return Widen(text);
+}
+
+bool MatchesIfNoneMatch(std::wstring_view ifNoneMatch, std::wstring_view etag)
+{
+    std::wstring_view etagOpaque;
+    bool etagWeak = false;
+    if (!ParseEntityTag(&etag, &etagOpaque, &etagWeak))
+    {
+        return false;
+    }
+    ifNoneMatch = Trim(ifNoneMatch);
+    if (ifNoneMatch == L"*")
+    {
+        return true;
+    }
+    // 1#entity-tag, where empty elements are allowed.
+    bool matched = false;
+    while (!ifNoneMatch.empty())
+    {
+        if (ifNoneMatch.front() == L',' || IsWhitespace(ifNoneMatch.front()))
+        {
+            ifNoneMatch.remove_prefix(1);
+            continue;
+        }
+        std::wstring_view opaque;
+        bool weak = false;
+        if (!ParseEntityTag(&ifNoneMatch, &opaque, &weak))
+        {
+            return false;
+        }
+        matched = matched || opaque == etagOpaque;
+        ifNoneMatch = Trim(ifNoneMatch);
+        if (!ifNoneMatch.empty() && ifNoneMatch.front() != L',')
+        {
+            return false;
+        }
+    }
+    return matched;
+}
+
+bool MatchesIfRange(std::wstring_view ifRange, std::wstring_view etag)
+{
+    ifRange = Trim(ifRange);
+    std::wstring_view opaque;
+    bool weak = false;
+    std::wstring_view etagOpaque;
+    bool etagWeak = false;
+    return ParseEntityTag(&ifRange, &opaque, &weak) && ifRange.empty() && !weak &&
+           ParseEntityTag(&etag, &etagOpaque, &etagWeak) && !etagWeak && opaque == etagOpaque;
+}
+
+RangeStatus ParseRange(std::wstring_view range, uint64_t size, std::vector<ByteRange>* ranges)
+{
+    ranges->clear();
+    range = Trim(range);
+    size_t equals = range.find(L'=');
+    if (equals == std::wstring_view::npos || !EqualsIgnoringCase(range.substr(0, equals), L"bytes"))
+    {
+        return RangeStatus::Ignored;
+    }
+    range.remove_prefix(equals + 1);
+
+    size_t specCount = 0;
+    while (!range.empty())
+    {
+        size_t comma = range.find(L',');
+        std::wstring_view spec = Trim(range.substr(0, comma));
+        range.remove_prefix(comma == std::wstring_view::npos ? range.size() : comma + 1);
+        if (spec.empty())
+        {
+            continue;
+        }
+        if (++specCount > c_maxRanges)
+        {
+            ranges->clear();
+            return RangeStatus::Ignored;
+        }
+        size_t dash = spec.find(L'-');
+        if (dash == std::wstring_view::npos)
+        {
+            ranges->clear();
+            return RangeStatus::Ignored;
+        }
+        uint64_t first = 0;
+        uint64_t last = UINT64_MAX;
+        if (dash == 0)
+        {
+            // suffix-range: the last bytes.
+            uint64_t suffix = 0;
+            if (!ParsePosition(spec.substr(1), &suffix))
+            {
+                ranges->clear();
+                return RangeStatus::Ignored;
+            }
+            if (suffix == 0 || size == 0)
+            {
+                continue;
+            }
+            first = size - (std::min)(suffix, size);
+        }
+        else if (
+            !ParsePosition(spec.substr(0, dash), &first) ||
+            (dash + 1 < spec.size() && !ParsePosition(spec.substr(dash + 1), &last)) ||
+            last < first)
+        {
+            ranges->clear();
+            return RangeStatus::Ignored;
+        }
+        if (first < size)
+        {
+            ranges->push_back({first, (std::min)(last, size - 1) - first + 1});
+        }
+    }
+    if (specCount == 0)
+    {
+        return RangeStatus::Ignored;
+    }
+    if (ranges->empty())
+    {
+        return RangeStatus::Unsatisfiable;
+    }
+
+    std::vector<ByteRange> sorted = *ranges;
+    std::sort(
+        sorted.begin(), sorted.end(),
+        [](const ByteRange& a, const ByteRange& b) { return a.offset < b.offset; });
+    std::vector<ByteRange> coalesced = {sorted[0]};
+    for (size_t i = 1; i < sorted.size(); ++i)
+    {
+        ByteRange& previous = coalesced.back();
+        uint64_t previousEnd = previous.offset + previous.size;
+        if (sorted[i].offset <= previousEnd + c_coalesceGap)
+        {
+            previous.size = (std::max)(previousEnd, sorted[i].offset + sorted[i].size) -
+                            previous.offset;
+        }
+        else
+        {
+            coalesced.push_back(sorted[i]);
+        }
+    }
+    if (coalesced.size() < ranges->size())
+    {
+        *ranges = std::move(coalesced);
+    }
+    return RangeStatus::Satisfiable;
+}
+
+std::wstring FormatContentRange(const ByteRange& range, uint64_t size)
+{
+    return Widen(FormatContentRangeUtf8(range, size));
+}
+
+std::wstring FormatUnsatisfiedContentRange(uint64_t size)
+{
+    return L"bytes */" + std::to_wstring(size);
+}
+
+std::vector<uint8_t> BuildMultipartByteRanges(
+    const uint8_t* content, uint64_t size, const std::vector<ByteRange>& ranges,
+    std::string_view contentType, std::string_view boundary)
+{
+    std::vector<uint8_t> body;
+    BuildMultipartByteRanges(
+        [content](const ByteRange& range, uint8_t* buffer)
+        {
+            memcpy(buffer, content + range.offset, static_cast<size_t>(range.size));
+            return true;
+        },
+        size, ranges, contentType, boundary, &body);
+    return body;
+}
+
+bool BuildMultipartByteRanges(
+    const ByteRangeReader& read, uint64_t size, const std::vector<ByteRange>& ranges,
+    std::string_view contentType, std::string_view boundary, std::vector<uint8_t>* body)
+{
+    body->clear();
+    auto append = [body](std::string_view text)
+    {
+        body->insert(body->end(), text.begin(), text.end());
+    };
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        append(i == 0 ? "--" : "\r\n--");
+        append(boundary);
+        append("\r\nContent-Type: ");
+        append(contentType);
+        append("\r\nContent-Range: ");
+        append(FormatContentRangeUtf8(ranges[i], size));
+        append("\r\n\r\n");
+        size_t partOffset = body->size();
+        body->resize(partOffset + static_cast<size_t>(ranges[i].size));
+        if (!read(ranges[i], body->data() + partOffset))
+        {
+            body->clear();
+            return false;
+        }
+    }
+    append("\r\n--");
+    append(boundary);
+    append("--\r\n");
+    return true;
+}
@@ -0,0 +1,72 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The parts of HTTP semantics (RFC 9110) that the app needs to answer
+// conditional and range requests for its assets: entity tags, If-None-Match,
+// If-Range, Range and multipart/byteranges.
+
+// An entity tag for content with a hash, such as "0123456789abcdef" in quotes:
+// strong if the hash is of the bytes, and weak, with W/, if it is only of
+// something that changes with them, such as a file's size and time.
+std::wstring FormatEntityTag(uint64_t hash, bool weak = false);
+
+// Whether If-None-Match matches etag (RFC 9110 13.1.2): it is "*", or one of
+// its entity tags is etag by weak comparison, which ignores W/. A malformed
+// header matches nothing.
+bool MatchesIfNoneMatch(std::wstring_view ifNoneMatch, std::wstring_view etag);
+
+// Whether If-Range lets a Range apply (RFC 9110 13.1.5): it is an entity tag
+// that is etag by strong comparison. A date never matches, since the responses
+// have no Last-Modified to compare it with.
+bool MatchesIfRange(std::wstring_view ifRange, std::wstring_view etag);
+
+struct ByteRange
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+enum class RangeStatus
+{
+    // Answer with all of the content, as the Range is malformed, in a unit
+    // other than bytes, or asks for too many ranges.
+    Ignored,
+    // Answer 206 Partial Content with the ranges.
+    Satisfiable,
+    // Answer 416 Range Not Satisfiable, as no range starts within the content.
+    Unsatisfiable,
+};
+
+// Parse a Range header for content of size bytes (RFC 9110 14.1.2 and 14.2).
+// The satisfiable ranges are clipped to the content and returned in the order
+// asked for. If any overlap, or are closer than the headers of a part would be,
+// they are all coalesced, and returned in the order of their offsets instead.
+RangeStatus ParseRange(std::wstring_view range, uint64_t size, std::vector<ByteRange>* ranges);
+
+// "bytes first-last/size" for the Content-Range of a 206 response.
+std::wstring FormatContentRange(const ByteRange& range, uint64_t size);
+// "bytes */size" for the Content-Range of a 416 response.
+std::wstring FormatUnsatisfiedContentRange(uint64_t size);
+
+// The body of a 206 response with several ranges (RFC 9110 14.6), which is sent
+// with Content-Type: multipart/byteranges; boundary=<boundary>. Each range of
+// content is a part with its own Content-Type and Content-Range. Only the
+// bytes of the ranges are read.
+std::vector<uint8_t> BuildMultipartByteRanges(
+    const uint8_t* content, uint64_t size, const std::vector<ByteRange>& ranges,
+    std::string_view contentType, std::string_view boundary);
+// The same, for content that isn't in memory: read copies the bytes of a range
+// to the buffer, or returns false if they can't be read, and then so does this.
+using ByteRangeReader = std::function<bool(const ByteRange& range, uint8_t* buffer)>;
+bool BuildMultipartByteRanges(
+    const ByteRangeReader& read, uint64_t size, const std::vector<ByteRange>& ranges,
+    std::string_view contentType, std::string_view boundary, std::vector<uint8_t>* body);
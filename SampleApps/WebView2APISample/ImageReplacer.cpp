@@ -0,0 +1,237 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ImageReplacer.h"
+
+#include <algorithm>
+
+#include "MimeTypes.h"
+
+namespace
+{
+constexpr uint32_t c_maxWidth = 1 << 20;
+
+bool EqualsIgnoringCase(std::wstring_view text, std::wstring_view lowercase)
+{
+    if (text.size() != lowercase.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        wchar_t c = text[i];
+        if (c >= L'A' && c <= L'Z')
+        {
+            c += L'a' - L'A';
+        }
+        if (c != lowercase[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MatchesMimeType(std::string_view pattern, std::string_view mimeType)
+{
+    return pattern == "image/*" || pattern == mimeType;
+}
+
+std::string_view NextField(std::string_view* line)
+{
+    size_t start = line->find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+    {
+        *line = std::string_view();
+        return std::string_view();
+    }
+    line->remove_prefix(start);
+    size_t end = (std::min)(line->find_first_of(" \t"), line->size());
+    std::string_view field = line->substr(0, end);
+    line->remove_prefix(end);
+    return field;
+}
+} // namespace
+
+ImageReplacer::ImageReplacer(std::vector<Rule> rules, Options options)
+    : m_rules(std::move(rules)), m_options(options)
+{
+    for (const Rule& rule : m_rules)
+    {
+        auto file = std::find_if(
+            m_files.begin(), m_files.end(),
+            [&rule](const File& candidate) { return candidate.path == rule.path; });
+        m_ruleFiles.push_back(file - m_files.begin());
+        if (file == m_files.end())
+        {
+            File newFile;
+            newFile.path = rule.path;
+            std::string_view type = GetMimeTypeForPath(rule.path);
+            newFile.contentType = type.empty() ? "application/octet-stream" : std::string(type);
+            m_files.push_back(std::move(newFile));
+        }
+    }
+}
+
+bool ImageReplacer::GetReplacement(
+    std::wstring_view uri, bool isImage, Replacement* replacement)
+{
+    // The resource context says whether this is an image. The extension only
+    // tells which type, and not at all for a URL such as "photo.php?id=1".
+    std::string_view mimeType = GetMimeTypeForPath(uri);
+    if (mimeType.compare(0, 6, "image/") != 0)
+    {
+        mimeType = std::string_view();
+    }
+    uint32_t width = GetRequestedWidth(uri);
+    size_t rule = isImage ? 0 : m_rules.size();
+    while (rule < m_rules.size() &&
+           !(MatchesMimeType(m_rules[rule].mimeType, mimeType) &&
+             (m_rules[rule].maxWidth == 0 || (width != 0 && width <= m_rules[rule].maxWidth))))
+    {
+        ++rule;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+    if (rule == m_rules.size())
+    {
+        return false;
+    }
+    File& file = m_files[m_ruleFiles[rule]];
+    auto now = std::chrono::steady_clock::now();
+    if (!file.asset || now - file.checked >= m_options.checkInterval)
+    {
+        file.checked = now;
+        Refresh(file);
+    }
+    if (!file.asset)
+    {
+        return false;
+    }
+    replacement->asset = file.asset;
+    replacement->contentType = file.contentType;
+    return true;
+}
+
+ImageReplacer::Stats ImageReplacer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ImageReplacer::Refresh(File& file)
+{
+    ++m_stats.checks;
+    std::error_code error;
+    std::filesystem::path path(file.path);
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    uintmax_t size = error ? 0 : std::filesystem::file_size(path, error);
+    if (error || (file.asset && time == file.time && size == file.size))
+    {
+        return;
+    }
+    auto asset = std::make_shared<Asset>();
+    asset->key = file.path;
+    if (!AssetCache::LoadFile(file.path, &asset->bytes))
+    {
+        ++m_stats.failedLoads;
+        return;
+    }
+    ++m_stats.loads;
+    asset->data = asset->bytes.data();
+    asset->size = asset->bytes.size();
+    asset->hash = HashAssetBytes(asset->data, asset->size);
+    asset->hasHash = true;
+    // Views of the old bytes keep them alive until they are done.
+    file.asset = std::move(asset);
+    file.time = time;
+    file.size = size;
+}
+
+std::vector<ImageReplacer::Rule> ImageReplacer::ParseRules(std::string_view text)
+{
+    std::vector<Rule> rules;
+    while (!text.empty())
+    {
+        size_t end = (std::min)(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix((std::min)(end + 1, text.size()));
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        std::string_view mimeType = NextField(&line);
+        std::string_view width = NextField(&line);
+        std::string_view path = NextField(&line);
+        if (mimeType.empty() || mimeType[0] == '#' || path.empty() ||
+            !NextField(&line).empty())
+        {
+            continue;
+        }
+        Rule rule;
+        rule.mimeType = std::string(mimeType);
+        std::transform(
+            rule.mimeType.begin(), rule.mimeType.end(), rule.mimeType.begin(),
+            [](char c) { return c >= 'A' && c <= 'Z' ? char(c + ('a' - 'A')) : c; });
+        if (width != "*")
+        {
+            if (width.find_first_not_of("0123456789") != std::string_view::npos ||
+                width.size() > 7)
+            {
+                continue;
+            }
+            rule.maxWidth = static_cast<uint32_t>(std::stoul(std::string(width)));
+            if (rule.maxWidth == 0)
+            {
+                continue;
+            }
+        }
+        rule.path = std::filesystem::u8path(path.begin(), path.end()).wstring();
+        rules.push_back(std::move(rule));
+    }
+    return rules;
+}
+
+uint32_t ImageReplacer::GetRequestedWidth(std::wstring_view uri)
+{
+    uri = uri.substr(0, uri.find(L'#'));
+    size_t query = uri.find(L'?');
+    if (query == std::wstring_view::npos)
+    {
+        return 0;
+    }
+    uri.remove_prefix(query + 1);
+    while (!uri.empty())
+    {
+        size_t end = (std::min)(uri.find(L'&'), uri.size());
+        std::wstring_view parameter = uri.substr(0, end);
+        uri.remove_prefix((std::min)(end + 1, uri.size()));
+        size_t equals = parameter.find(L'=');
+        if (equals == std::wstring_view::npos)
+        {
+            continue;
+        }
+        std::wstring_view name = parameter.substr(0, equals);
+        std::wstring_view value = parameter.substr(equals + 1);
+        if (!EqualsIgnoringCase(name, L"w") && !EqualsIgnoringCase(name, L"width"))
+        {
+            continue;
+        }
+        uint32_t width = 0;
+        for (wchar_t c : value)
+        {
+            if (c < L'0' || c > L'9')
+            {
+                break;
+            }
+            width = (std::min)(width * 10 + (c - L'0'), c_maxWidth);
+        }
+        if (width != 0)
+        {
+            return width;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AssetCache.h"
+
+// Chooses and holds the images that Settings -> Replace images puts in place
+// of a page's images.
+//
+// Each replacement file is read once into an immutable asset, which every
+// request in every window shares through AssetStream views. A request costs a
+// rule lookup and a reference count, and no file I/O. A file is checked for
+// changes at most once every checkInterval, and is read again if its size or
+// time has changed. If it can't be read, the last bytes read keep being served.
+//
+// Only requests whose resource context is an image are replaced. Rules then
+// choose a file by the MIME type of the image, from the extension of its URL,
+// and by its width bucket. The width comes from a w= or width= query
+// parameter, as image CDNs use, since nothing else about the image is known
+// before it is answered.
+class ImageReplacer
+{
+public:
+    struct Rule
+    {
+        // A MIME type such as "image/png", or "image/*" for any image, including
+        // one whose URL has no image extension, such as "photo.php?id=1".
+        std::string mimeType;
+        // The widest image the rule applies to, in pixels, or 0 for any image.
+        // A rule with a width only applies when the URL gives a width.
+        uint32_t maxWidth = 0;
+        std::wstring path;
+    };
+
+    struct Options
+    {
+        std::chrono::steady_clock::duration checkInterval = std::chrono::seconds(1);
+    };
+
+    struct Replacement
+    {
+        AssetPtr asset;
+        // The MIME type of the replacement file.
+        std::string_view contentType;
+    };
+
+    struct Stats
+    {
+        uint64_t requests = 0;
+        uint64_t checks = 0;
+        uint64_t loads = 0;
+        uint64_t failedLoads = 0;
+    };
+
+    // Rules are tried in order, and the first that applies is used.
+    ImageReplacer(std::vector<Rule> rules, Options options);
+    ImageReplacer(const ImageReplacer&) = delete;
+    ImageReplacer& operator=(const ImageReplacer&) = delete;
+
+    // The replacement for a request for uri. isImage is whether the request's
+    // resource context is an image. Returns false if it isn't, if no rule
+    // applies, or if the rule's file has never been read. Can be called from
+    // any thread.
+    bool GetReplacement(std::wstring_view uri, bool isImage, Replacement* replacement);
+    Stats GetStats() const;
+
+    // Parse rules, one to a line, as "<MIME type> <width or *> <path>". Blank
+    // lines and lines that start with '#' are skipped, as are malformed ones.
+    static std::vector<Rule> ParseRules(std::string_view text);
+    // The width an image URL asks for, or 0 if it doesn't give one.
+    static uint32_t GetRequestedWidth(std::wstring_view uri);
+
+private:
+    struct File
+    {
+        std::wstring path;
+        std::string contentType;
+        AssetPtr asset;
+        std::filesystem::file_time_type time;
+        uintmax_t size = 0;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    // Read the file again if it has changed since it was read.
+    void Refresh(File& file);
+
+    std::vector<Rule> m_rules;
+    // The file of each rule, in m_files.
+    std::vector<size_t> m_ruleFiles;
+    Options m_options;
+
+    mutable std::mutex m_mutex;
+    std::vector<File> m_files;
+    Stats m_stats;
+};
@@ -0,0 +1,369 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonEscape.h"
+
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#define JSON_ESCAPE_AVX2 1
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define JSON_ESCAPE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+bool NeedsEscape(uint32_t c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+template <typename CharT> size_t FindEscapeScalar(const CharT* data, size_t length)
+{
+    using Unsigned = std::make_unsigned_t<CharT>;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (NeedsEscape(static_cast<Unsigned>(data[i])))
+        {
+            return i;
+        }
+    }
+    return length;
+}
+
+#if JSON_ESCAPE_AVX2 || JSON_ESCAPE_SSE2
+unsigned CountTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+#if JSON_ESCAPE_AVX2
+// A code unit x needs escaping if x == '"', x == '\\', or x <= 0x1F. For 8 and
+// 16-bit units the last test is done as an unsigned saturating subtract of
+// 0x1F, which is zero exactly when x <= 0x1F.
+__m256i Escapes8(__m256i chunk)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+        _mm256_cmpeq_epi8(
+            _mm256_subs_epu8(chunk, _mm256_set1_epi8(0x1F)), _mm256_setzero_si256()));
+}
+
+__m256i Escapes16(__m256i chunk)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi16(chunk, _mm256_set1_epi16('"')),
+            _mm256_cmpeq_epi16(chunk, _mm256_set1_epi16('\\'))),
+        _mm256_cmpeq_epi16(
+            _mm256_subs_epu16(chunk, _mm256_set1_epi16(0x1F)), _mm256_setzero_si256()));
+}
+
+// There is no unsigned 32-bit compare, so x <= 0x1F is tested as a signed
+// x - 2^31 < 0x20 - 2^31.
+__m256i Escapes32(__m256i chunk)
+{
+    const __m256i bias = _mm256_set1_epi32(INT32_MIN);
+    return _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi32(chunk, _mm256_set1_epi32('"')),
+            _mm256_cmpeq_epi32(chunk, _mm256_set1_epi32('\\'))),
+        _mm256_cmpgt_epi32(
+            _mm256_xor_si256(_mm256_set1_epi32(0x20), bias), _mm256_xor_si256(chunk, bias)));
+}
+
+__m256i Load(const void* data)
+{
+    return _mm256_loadu_si256(static_cast<const __m256i*>(data));
+}
+
+size_t FindEscapeSimd(const uint8_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(Escapes8(Load(data + i))));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+
+// Two vectors of 16 code units are tested per iteration. Their results are
+// packed to one byte per unit, so a single movemask gives one bit per unit;
+// packing works within 128-bit lanes, so the quarters are put back in order.
+size_t FindEscapeSimd(const uint16_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i packed = _mm256_packs_epi16(
+            Escapes16(Load(data + i)), Escapes16(Load(data + i + 16)));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(packed));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+
+// Four vectors of 8 code units are tested per iteration, with one movemask of
+// their union; the unit is only located once one of them has a match.
+size_t FindEscapeSimd(const uint32_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i escapes[4];
+        for (size_t part = 0; part < 4; ++part)
+        {
+            escapes[part] = Escapes32(Load(data + i + part * 8));
+        }
+        __m256i any = _mm256_or_si256(
+            _mm256_or_si256(escapes[0], escapes[1]), _mm256_or_si256(escapes[2], escapes[3]));
+        if (_mm256_movemask_epi8(any) != 0)
+        {
+            for (size_t part = 0;; ++part)
+            {
+                uint32_t mask = static_cast<uint32_t>(
+                    _mm256_movemask_ps(_mm256_castsi256_ps(escapes[part])));
+                if (mask != 0)
+                {
+                    return i + part * 8 + CountTrailingZeros(mask);
+                }
+            }
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+#elif JSON_ESCAPE_SSE2
+// See the AVX2 version above for how the comparisons work.
+__m128i Escapes8(__m128i chunk)
+{
+    return _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+        _mm_cmpeq_epi8(_mm_subs_epu8(chunk, _mm_set1_epi8(0x1F)), _mm_setzero_si128()));
+}
+
+__m128i Escapes16(__m128i chunk)
+{
+    return _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi16(chunk, _mm_set1_epi16('"')),
+            _mm_cmpeq_epi16(chunk, _mm_set1_epi16('\\'))),
+        _mm_cmpeq_epi16(_mm_subs_epu16(chunk, _mm_set1_epi16(0x1F)), _mm_setzero_si128()));
+}
+
+__m128i Escapes32(__m128i chunk)
+{
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    return _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi32(chunk, _mm_set1_epi32('"')),
+            _mm_cmpeq_epi32(chunk, _mm_set1_epi32('\\'))),
+        _mm_cmplt_epi32(_mm_xor_si128(chunk, bias), _mm_xor_si128(_mm_set1_epi32(0x20), bias)));
+}
+
+__m128i Load(const void* data)
+{
+    return _mm_loadu_si128(static_cast<const __m128i*>(data));
+}
+
+size_t FindEscapeSimd(const uint8_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(Escapes8(Load(data + i))));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+
+size_t FindEscapeSimd(const uint16_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i packed =
+            _mm_packs_epi16(Escapes16(Load(data + i)), Escapes16(Load(data + i + 8)));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(packed));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+
+// Packing 32-bit results twice keeps them in order, so four vectors of 4 code
+// units also need a single movemask.
+size_t FindEscapeSimd(const uint32_t* data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i low =
+            _mm_packs_epi32(Escapes32(Load(data + i)), Escapes32(Load(data + i + 4)));
+        __m128i high =
+            _mm_packs_epi32(Escapes32(Load(data + i + 8)), Escapes32(Load(data + i + 12)));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(low, high)));
+        if (mask != 0)
+        {
+            return i + CountTrailingZeros(mask);
+        }
+    }
+    return i + FindEscapeScalar(data + i, length - i);
+}
+#else
+size_t FindEscapeSimd(const uint8_t* data, size_t length)
+{
+    return FindEscapeScalar(data, length);
+}
+
+size_t FindEscapeSimd(const uint16_t* data, size_t length)
+{
+    return FindEscapeScalar(data, length);
+}
+
+size_t FindEscapeSimd(const uint32_t* data, size_t length)
+{
+    return FindEscapeScalar(data, length);
+}
+#endif
+
+template <typename CharT> size_t FindEscape(const CharT* data, size_t length)
+{
+    if constexpr (sizeof(CharT) == 1)
+    {
+        return FindEscapeSimd(reinterpret_cast<const uint8_t*>(data), length);
+    }
+    else if constexpr (sizeof(CharT) == 2)
+    {
+        return FindEscapeSimd(reinterpret_cast<const uint16_t*>(data), length);
+    }
+    else
+    {
+        // wchar_t is 32 bits outside of Windows.
+        return FindEscapeSimd(reinterpret_cast<const uint32_t*>(data), length);
+    }
+}
+
+template <typename CharT> void AppendEscape(std::basic_string<CharT>& out, uint32_t c)
+{
+    static constexpr char c_hexDigits[] = "0123456789abcdef";
+    CharT escape[6] = {CharT('\\')};
+    size_t escapeLength = 2;
+    switch (c)
+    {
+    case '\b':
+        escape[1] = CharT('b');
+        break;
+    case '\f':
+        escape[1] = CharT('f');
+        break;
+    case '\n':
+        escape[1] = CharT('n');
+        break;
+    case '\r':
+        escape[1] = CharT('r');
+        break;
+    case '\t':
+        escape[1] = CharT('t');
+        break;
+    case '\\':
+        escape[1] = CharT('\\');
+        break;
+    case '"':
+        escape[1] = CharT('"');
+        break;
+    default:
+        // Any other control character is written as \u00XX.
+        escape[1] = CharT('u');
+        escape[2] = CharT('0');
+        escape[3] = CharT('0');
+        escape[4] = CharT(c_hexDigits[(c >> 4) & 0xF]);
+        escape[5] = CharT(c_hexDigits[c & 0xF]);
+        escapeLength = 6;
+        break;
+    }
+    out.append(escape, escapeLength);
+}
+
+template <typename CharT>
+void AppendEscaped(std::basic_string<CharT>& out, std::basic_string_view<CharT> value)
+{
+    using Unsigned = std::make_unsigned_t<CharT>;
+    const CharT* data = value.data();
+    size_t length = value.size();
+    size_t i = 0;
+    while (i < length)
+    {
+        size_t run = FindEscape(data + i, length - i);
+        out.append(data + i, run);
+        i += run;
+        if (i == length)
+        {
+            break;
+        }
+        AppendEscape(out, static_cast<Unsigned>(data[i]));
+        ++i;
+    }
+}
+} // namespace
+
+size_t FindJsonEscape(std::wstring_view value)
+{
+    return FindEscape(value.data(), value.size());
+}
+
+size_t FindJsonEscape(std::string_view value)
+{
+    return FindEscape(value.data(), value.size());
+}
+
+void AppendJsonEscaped(std::wstring& out, std::wstring_view value)
+{
+    AppendEscaped(out, value);
+}
+
+void AppendJsonEscaped(std::string& out, std::string_view value)
+{
+    AppendEscaped(out, value);
+}
+
+size_t FindJsonEscape(std::u16string_view value)
+{
+    return FindEscape(value.data(), value.size());
+}
+
+void AppendJsonEscaped(std::u16string& out, std::u16string_view value)
+{
+    AppendEscaped(out, value);
+}
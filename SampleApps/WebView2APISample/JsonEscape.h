@@ -0,0 +1,34 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Escaping of string contents for JSON string values, for both UTF-16
+// (std::wstring on Windows) and UTF-8 input. The quote, the backslash and every
+// control character below U+0020 are escaped, which is what JSON requires; all
+// other code units, including non-ASCII ones, are copied through unchanged.
+//
+// Runs of characters that need no escaping are found with SSE2 and copied in
+// bulk; 16-bit code units are tested 16 at a time with a single movemask. AVX2,
+// which doubles the width, is only used when the compiler targets it, such as
+// with /arch:AVX2. The sample's x64 build doesn't set that, so it runs the SSE2
+// code on any x64 CPU. Other targets use a scalar loop.
+
+// Returns the index of the first code unit in value that must be escaped, or
+// value.size() if there is none.
+size_t FindJsonEscape(std::wstring_view value);
+size_t FindJsonEscape(std::string_view value);
+// UTF-16 on every platform, so that the code path std::wstring takes on Windows
+// can be tested and measured on others.
+size_t FindJsonEscape(std::u16string_view value);
+
+// Appends value to out with JSON escaping applied. Surrounding quotes are not
+// added.
+void AppendJsonEscaped(std::wstring& out, std::wstring_view value);
+void AppendJsonEscaped(std::string& out, std::string_view value);
+void AppendJsonEscaped(std::u16string& out, std::u16string_view value);
@@ -0,0 +1,481 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// The pieces of JSON parsing that JsonDocument and JsonStructuralIndex share:
+// validation of strings, numbers and literals, decoding of strings, and the
+// arena that decoded strings are kept in. Each works on UTF-16 (wchar_t) and
+// UTF-8 (char) text.
+namespace JsonParsing
+{
+// Longer numbers are only read as doubles, through a heap copy.
+constexpr size_t c_maxNumberBufferLength = 64;
+
+template <typename Char> uint32_t Unit(Char c)
+{
+    return static_cast<std::make_unsigned_t<Char>>(c);
+}
+
+template <typename Char> bool IsWhitespace(Char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+template <typename Char> const Char* SkipWhitespace(const Char* p, const Char* end)
+{
+    while (p < end && IsWhitespace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+template <typename Char> bool IsDigit(Char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+template <typename Char> int HexValue(Char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// The four hex digits at p, which have been checked.
+template <typename Char> uint32_t ReadHex4(const Char* p)
+{
+    return (HexValue(p[0]) << 12) | (HexValue(p[1]) << 8) | (HexValue(p[2]) << 4) |
+           HexValue(p[3]);
+}
+
+// Returns the position after the UTF-8 sequence at p, or nullptr if it is
+// malformed. Uses the ranges of the WHATWG decoder, which reject overlong forms,
+// surrogates and code points above U+10FFFF.
+inline const char* SkipUtf8Sequence(const char* p, const char* end)
+{
+    uint32_t byte = Unit(*p);
+    size_t length;
+    uint32_t lower = 0x80;
+    uint32_t upper = 0xBF;
+    if (byte >= 0xC2 && byte <= 0xDF)
+    {
+        length = 2;
+    }
+    else if (byte >= 0xE0 && byte <= 0xEF)
+    {
+        length = 3;
+        lower = byte == 0xE0 ? 0xA0 : 0x80;
+        upper = byte == 0xED ? 0x9F : 0xBF;
+    }
+    else if (byte >= 0xF0 && byte <= 0xF4)
+    {
+        length = 4;
+        lower = byte == 0xF0 ? 0x90 : 0x80;
+        upper = byte == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+    {
+        return nullptr;
+    }
+    if (static_cast<size_t>(end - p) < length)
+    {
+        return nullptr;
+    }
+    for (size_t i = 1; i < length; ++i)
+    {
+        uint32_t next = Unit(p[i]);
+        if (next < lower || next > upper)
+        {
+            return nullptr;
+        }
+        lower = 0x80;
+        upper = 0xBF;
+    }
+    return p + length;
+}
+
+// Validation of the pieces of a document. Each returns the position after the
+// piece, or nullptr if the text at p isn't a valid one.
+
+template <typename Char> const Char* ValidateString(const Char* p, const Char* end)
+{
+    // Skip the opening quote.
+    ++p;
+    while (p < end)
+    {
+        // Most characters need no further checks.
+        while (p < end && Unit(*p) >= 0x20 && *p != '"' && *p != '\\' &&
+               (!std::is_same_v<Char, char> || Unit(*p) < 0x80))
+        {
+            ++p;
+        }
+        if (p == end)
+        {
+            break;
+        }
+        uint32_t c = Unit(*p);
+        if (c == '"')
+        {
+            return p + 1;
+        }
+        if (c == '\\')
+        {
+            if (++p == end)
+            {
+                return nullptr;
+            }
+            switch (*p)
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                ++p;
+                break;
+            case 'u':
+                if (end - p < 5 || HexValue(p[1]) < 0 || HexValue(p[2]) < 0 ||
+                    HexValue(p[3]) < 0 || HexValue(p[4]) < 0)
+                {
+                    return nullptr;
+                }
+                p += 5;
+                break;
+            default:
+                return nullptr;
+            }
+        }
+        else if (c < 0x20)
+        {
+            return nullptr;
+        }
+        else if constexpr (std::is_same_v<Char, char>)
+        {
+            if (c >= 0x80)
+            {
+                p = SkipUtf8Sequence(p, end);
+                if (!p)
+                {
+                    return nullptr;
+                }
+            }
+            else
+            {
+                ++p;
+            }
+        }
+        else
+        {
+            ++p;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Char> const Char* ValidateNumber(const Char* p, const Char* end)
+{
+    if (p < end && *p == '-')
+    {
+        ++p;
+    }
+    if (p == end)
+    {
+        return nullptr;
+    }
+    if (*p == '0')
+    {
+        ++p;
+    }
+    else if (*p >= '1' && *p <= '9')
+    {
+        while (++p < end && IsDigit(*p))
+        {
+        }
+    }
+    else
+    {
+        return nullptr;
+    }
+    if (p < end && *p == '.')
+    {
+        if (++p == end || !IsDigit(*p))
+        {
+            return nullptr;
+        }
+        while (++p < end && IsDigit(*p))
+        {
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        if (++p < end && (*p == '+' || *p == '-'))
+        {
+            ++p;
+        }
+        if (p == end || !IsDigit(*p))
+        {
+            return nullptr;
+        }
+        while (++p < end && IsDigit(*p))
+        {
+        }
+    }
+    return p;
+}
+
+template <typename Char>
+const Char* ValidateLiteral(const Char* p, const Char* end, const char* literal)
+{
+    for (; *literal; ++literal, ++p)
+    {
+        if (p == end || *p != *literal)
+        {
+            return nullptr;
+        }
+    }
+    return p;
+}
+
+// p is at the opening quote of a valid string; returns the position after the
+// closing one.
+template <typename Char> const Char* SkipString(const Char* p)
+{
+    ++p;
+    while (*p != '"')
+    {
+        p += *p == '\\' ? 2 : 1;
+    }
+    return p + 1;
+}
+
+// Write codePoint to out in the encoding of Char. Returns the number of
+// characters written. A lone surrogate from a \u escape is kept in UTF-16 and
+// UTF-32, and becomes U+FFFD in UTF-8, which can't represent it.
+template <typename Char> size_t WriteCodePoint(uint32_t codePoint, Char* out)
+{
+    if constexpr (std::is_same_v<Char, char>)
+    {
+        if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+        {
+            codePoint = 0xFFFD;
+        }
+        if (codePoint < 0x80)
+        {
+            out[0] = static_cast<char>(codePoint);
+            return 1;
+        }
+        if (codePoint < 0x800)
+        {
+            out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+            out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            return 2;
+        }
+        if (codePoint < 0x10000)
+        {
+            out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+            out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+        out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 4;
+    }
+    else
+    {
+        if (sizeof(Char) == 2 && codePoint >= 0x10000)
+        {
+            codePoint -= 0x10000;
+            out[0] = static_cast<Char>(0xD800 + (codePoint >> 10));
+            out[1] = static_cast<Char>(0xDC00 + (codePoint & 0x3FF));
+            return 2;
+        }
+        out[0] = static_cast<Char>(codePoint);
+        return 1;
+    }
+}
+
+// Decode the contents of the string whose opening quote is at p into out.
+// Returns the number of characters written, which is at most the length of
+// the escaped contents.
+template <typename Char> size_t DecodeString(const Char* p, Char* out)
+{
+    Char* begin = out;
+    ++p;
+    while (*p != '"')
+    {
+        if (*p != '\\')
+        {
+            *out++ = *p++;
+            continue;
+        }
+        Char escape = p[1];
+        p += 2;
+        switch (escape)
+        {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+        {
+            uint32_t codePoint = ReadHex4(p);
+            p += 4;
+            // Join a surrogate pair written as two escapes.
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF && p[0] == '\\' && p[1] == 'u')
+            {
+                uint32_t low = ReadHex4(p + 2);
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            out += WriteCodePoint(codePoint, out);
+            break;
+        }
+        default:
+            // '"', '\\' and '/' stand for themselves.
+            *out++ = escape;
+            break;
+        }
+    }
+    return out - begin;
+}
+
+// Whether the raw string at p, including quotes, is exactly name once decoded.
+template <typename Char>
+bool StringEquals(const Char* p, std::basic_string_view<Char> name, Char* scratch)
+{
+    const Char* contents = p + 1;
+    size_t i = 0;
+    for (; contents[i] != '"' && contents[i] != '\\'; ++i)
+    {
+        if (i == name.size() || contents[i] != name[i])
+        {
+            return false;
+        }
+    }
+    if (contents[i] == '"')
+    {
+        return i == name.size();
+    }
+    // The name has escapes. Decoding doesn't make it longer, so it can't
+    // match if its escaped form is shorter than name.
+    size_t escapedLength = SkipString(p) - contents - 1;
+    if (escapedLength < name.size())
+    {
+        return false;
+    }
+    size_t length = DecodeString(p, scratch);
+    return std::basic_string_view<Char>(scratch, length) == name;
+}
+
+// Parse a number with std::from_chars, which only takes char.
+template <typename Char, typename T> bool ParseNumber(std::basic_string_view<Char> text, T* value)
+{
+    char buffer[c_maxNumberBufferLength];
+    std::string longText;
+    const char* begin = buffer;
+    if (text.size() <= c_maxNumberBufferLength)
+    {
+        std::copy(text.begin(), text.end(), buffer);
+    }
+    else
+    {
+        longText.assign(text.begin(), text.end());
+        begin = longText.data();
+    }
+    const char* end = begin + text.size();
+    T result;
+    std::from_chars_result parsed = std::from_chars(begin, end, result);
+    if (parsed.ec != std::errc() || parsed.ptr != end)
+    {
+        return false;
+    }
+    *value = result;
+    return true;
+}
+
+// Decoded strings, which stay valid until Reset(). Memory is allocated in
+// blocks, and Reset() keeps the first one, so an arena that is reused for every
+// message stops allocating unless a message has unusually many escapes.
+template <typename Char> class StringArena
+{
+public:
+    // Room for length characters.
+    Char* Allocate(size_t length)
+    {
+        if (m_blocks.empty() || m_blockSize - m_blockUsed < length)
+        {
+            m_blockSize = (std::max)(c_blockSize, length);
+            m_blockUsed = 0;
+            m_blocks.push_back(std::make_unique<Char[]>(m_blockSize));
+            if (m_blocks.size() == 1)
+            {
+                m_firstBlockSize = m_blockSize;
+            }
+        }
+        Char* string = m_blocks.back().get() + m_blockUsed;
+        m_blockUsed += length;
+        return string;
+    }
+
+    void Reset()
+    {
+        if (m_blocks.size() > 1)
+        {
+            m_blocks.resize(1);
+        }
+        m_blockSize = m_firstBlockSize;
+        m_blockUsed = 0;
+    }
+
+private:
+    static constexpr size_t c_blockSize = 4096;
+
+    std::vector<std::unique_ptr<Char[]>> m_blocks;
+    size_t m_firstBlockSize = 0;
+    size_t m_blockSize = 0;
+    size_t m_blockUsed = 0;
+};
+} // namespace JsonParsing
@@ -0,0 +1,391 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonReader.h"
+
+using namespace JsonParsing;
+
+namespace
+{
+// Navigation of a document that Parse() has checked.
+template <typename Char> const Char* SkipValue(const Char* p, const Char* end)
+{
+    if (*p == '"')
+    {
+        return SkipString(p);
+    }
+    if (*p == '{' || *p == '[')
+    {
+        size_t depth = 0;
+        do
+        {
+            if (*p == '"')
+            {
+                p = SkipString(p);
+                continue;
+            }
+            if (*p == '{' || *p == '[')
+            {
+                ++depth;
+            }
+            else if (*p == '}' || *p == ']')
+            {
+                --depth;
+            }
+            ++p;
+        } while (depth != 0);
+        return p;
+    }
+    // A number or literal ends at the first character that can't be part of it.
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !IsWhitespace(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+} // namespace
+
+template <typename Char> bool BasicJsonDocument<Char>::Parse(View json)
+{
+    m_json = json;
+    m_valid = false;
+    m_errorOffset = 0;
+    m_strings.Reset();
+
+    // The containers enclosing the current position: true for an object.
+    bool isObject[c_maxDepth];
+    size_t depth = 0;
+    const Char* p = json.data();
+    const Char* end = p + json.size();
+    enum class Expect
+    {
+        Value,
+        // A member name, after '{' or ','.
+        Name,
+        // A ',' or the end of the container, after a value.
+        Next,
+    } expect = Expect::Value;
+
+    while (true)
+    {
+        p = SkipWhitespace(p, end);
+        if (expect == Expect::Next && depth == 0)
+        {
+            // The root value is complete; only whitespace may follow.
+            break;
+        }
+        if (p == end)
+        {
+            m_errorOffset = json.size();
+            return false;
+        }
+
+        const Char* next = nullptr;
+        if (expect == Expect::Name)
+        {
+            if (*p == '"' && (next = ValidateString(p, end)) != nullptr)
+            {
+                next = SkipWhitespace(next, end);
+                next = next < end && *next == ':' ? next + 1 : nullptr;
+            }
+            expect = Expect::Value;
+        }
+        else if (expect == Expect::Next)
+        {
+            if (*p == ',')
+            {
+                next = p + 1;
+                expect = isObject[depth - 1] ? Expect::Name : Expect::Value;
+            }
+            else if (*p == (isObject[depth - 1] ? '}' : ']'))
+            {
+                next = p + 1;
+                --depth;
+            }
+        }
+        else if (*p == '{' || *p == '[')
+        {
+            bool object = *p == '{';
+            const Char* contents = SkipWhitespace(p + 1, end);
+            if (contents < end && *contents == (object ? '}' : ']'))
+            {
+                // Empty containers are complete values.
+                next = contents + 1;
+                expect = Expect::Next;
+            }
+            else if (depth < c_maxDepth)
+            {
+                isObject[depth++] = object;
+                next = p + 1;
+                expect = object ? Expect::Name : Expect::Value;
+            }
+        }
+        else
+        {
+            switch (*p)
+            {
+            case '"':
+                next = ValidateString(p, end);
+                break;
+            case 't':
+                next = ValidateLiteral(p, end, "true");
+                break;
+            case 'f':
+                next = ValidateLiteral(p, end, "false");
+                break;
+            case 'n':
+                next = ValidateLiteral(p, end, "null");
+                break;
+            default:
+                next = ValidateNumber(p, end);
+                break;
+            }
+            expect = Expect::Next;
+        }
+
+        if (!next)
+        {
+            m_errorOffset = p - json.data();
+            return false;
+        }
+        p = next;
+    }
+
+    if (p != end)
+    {
+        m_errorOffset = p - json.data();
+        return false;
+    }
+    m_valid = true;
+    return true;
+}
+
+template <typename Char> BasicJsonValue<Char> BasicJsonDocument<Char>::GetRoot() const
+{
+    if (!m_valid)
+    {
+        return BasicJsonValue<Char>();
+    }
+    return BasicJsonValue<Char>(this, SkipWhitespace(m_json.data(), m_json.data() + m_json.size()));
+}
+
+template <typename Char> JsonType BasicJsonValue<Char>::GetType() const
+{
+    if (!m_begin)
+    {
+        return JsonType::Missing;
+    }
+    switch (*m_begin)
+    {
+    case '"':
+        return JsonType::String;
+    case '{':
+        return JsonType::Object;
+    case '[':
+        return JsonType::Array;
+    case 't':
+    case 'f':
+        return JsonType::Bool;
+    case 'n':
+        return JsonType::Null;
+    default:
+        return JsonType::Number;
+    }
+}
+
+template <typename Char> const Char* BasicJsonValue<Char>::FirstChild(Char bracket) const
+{
+    return m_begin && *m_begin == bracket ? m_begin + 1 : nullptr;
+}
+
+template <typename Char>
+bool BasicJsonValue<Char>::NextMember(const Char** cursor, View* name, BasicJsonValue* value) const
+{
+    if (!*cursor)
+    {
+        return false;
+    }
+    const Char* end = m_document->m_json.data() + m_document->m_json.size();
+    const Char* p = SkipWhitespace(*cursor, end);
+    if (*p == ',')
+    {
+        p = SkipWhitespace(p + 1, end);
+    }
+    if (*p == '}')
+    {
+        *cursor = nullptr;
+        return false;
+    }
+    // Reuse GetString to decode the name.
+    BasicJsonValue(m_document, p).GetString(name);
+    p = SkipWhitespace(SkipString(p), end);
+    // Skip the ':'.
+    p = SkipWhitespace(p + 1, end);
+    *value = BasicJsonValue(m_document, p);
+    *cursor = SkipValue(p, end);
+    return true;
+}
+
+template <typename Char>
+bool BasicJsonValue<Char>::NextElement(const Char** cursor, BasicJsonValue* value) const
+{
+    if (!*cursor)
+    {
+        return false;
+    }
+    const Char* end = m_document->m_json.data() + m_document->m_json.size();
+    const Char* p = SkipWhitespace(*cursor, end);
+    if (*p == ',')
+    {
+        p = SkipWhitespace(p + 1, end);
+    }
+    if (*p == ']')
+    {
+        *cursor = nullptr;
+        return false;
+    }
+    *value = BasicJsonValue(m_document, p);
+    *cursor = SkipValue(p, end);
+    return true;
+}
+
+template <typename Char> BasicJsonValue<Char> BasicJsonValue<Char>::operator[](View name) const
+{
+    const Char* cursor = FirstChild(static_cast<Char>('{'));
+    if (!cursor)
+    {
+        return BasicJsonValue();
+    }
+    const Char* end = m_document->m_json.data() + m_document->m_json.size();
+    // Names are compared in their escaped form, and only decoded, into a
+    // buffer allocated on first use, when they contain escapes.
+    Char* scratch = nullptr;
+    size_t scratchLength = 0;
+    const Char* p = SkipWhitespace(cursor, end);
+    while (*p != '}')
+    {
+        const Char* nameEnd = SkipString(p);
+        bool found;
+        if (std::find(p + 1, nameEnd - 1, static_cast<Char>('\\')) == nameEnd - 1)
+        {
+            found = View(p + 1, nameEnd - p - 2) == name;
+        }
+        else
+        {
+            if (scratchLength < static_cast<size_t>(nameEnd - p))
+            {
+                scratchLength = nameEnd - p;
+                scratch = m_document->AllocateString(scratchLength);
+            }
+            found = StringEquals(p, name, scratch);
+        }
+        p = SkipWhitespace(nameEnd, end);
+        p = SkipWhitespace(p + 1, end);
+        if (found)
+        {
+            return BasicJsonValue(m_document, p);
+        }
+        p = SkipWhitespace(SkipValue(p, end), end);
+        if (*p == ',')
+        {
+            p = SkipWhitespace(p + 1, end);
+        }
+    }
+    return BasicJsonValue();
+}
+
+template <typename Char> BasicJsonValue<Char> BasicJsonValue<Char>::GetElement(size_t index) const
+{
+    const Char* cursor = FirstChild(static_cast<Char>('['));
+    BasicJsonValue value;
+    while (NextElement(&cursor, &value))
+    {
+        if (index-- == 0)
+        {
+            return value;
+        }
+    }
+    return BasicJsonValue();
+}
+
+template <typename Char> bool BasicJsonValue<Char>::GetString(View* value) const
+{
+    if (GetType() != JsonType::String)
+    {
+        return false;
+    }
+    const Char* contents = m_begin + 1;
+    const Char* p = contents;
+    while (*p != '"' && *p != '\\')
+    {
+        ++p;
+    }
+    if (*p == '"')
+    {
+        *value = View(contents, p - contents);
+        return true;
+    }
+    Char* decoded = m_document->AllocateString(SkipString(m_begin) - contents - 1);
+    *value = View(decoded, DecodeString(m_begin, decoded));
+    return true;
+}
+
+template <typename Char> auto BasicJsonValue<Char>::GetStringOr(View fallback) const -> View
+{
+    View value;
+    return GetString(&value) ? value : fallback;
+}
+
+template <typename Char> bool BasicJsonValue<Char>::GetBool(bool* value) const
+{
+    if (GetType() != JsonType::Bool)
+    {
+        return false;
+    }
+    *value = *m_begin == 't';
+    return true;
+}
+
+template <typename Char> auto BasicJsonValue<Char>::GetNumberText() const -> View
+{
+    if (GetType() != JsonType::Number)
+    {
+        return View();
+    }
+    const Char* end = m_document->m_json.data() + m_document->m_json.size();
+    return View(m_begin, SkipValue(m_begin, end) - m_begin);
+}
+
+template <typename Char> bool BasicJsonValue<Char>::GetInt64(int64_t* value) const
+{
+    View text = GetNumberText();
+    return !text.empty() && text.size() <= c_maxNumberBufferLength && ParseNumber(text, value);
+}
+
+template <typename Char> bool BasicJsonValue<Char>::GetUInt64(uint64_t* value) const
+{
+    View text = GetNumberText();
+    return !text.empty() && text.size() <= c_maxNumberBufferLength && ParseNumber(text, value);
+}
+
+template <typename Char> bool BasicJsonValue<Char>::GetDouble(double* value) const
+{
+    View text = GetNumberText();
+    return !text.empty() && ParseNumber(text, value);
+}
+
+template <typename Char> auto BasicJsonValue<Char>::GetRawJson() const -> View
+{
+    if (!m_begin)
+    {
+        return View();
+    }
+    const Char* end = m_document->m_json.data() + m_document->m_json.size();
+    return View(m_begin, SkipValue(m_begin, end) - m_begin);
+}
+
+template class BasicJsonDocument<char>;
+template class BasicJsonDocument<wchar_t>;
+template class BasicJsonValue<char>;
+template class BasicJsonValue<wchar_t>;
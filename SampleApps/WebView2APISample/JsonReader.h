@@ -0,0 +1,162 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "JsonParsing.h"
+
+// A JSON reader for pulling a few fields out of a message, such as the
+// parameters of a DevTools protocol event, without building a DOM.
+//
+// Parse() checks the whole text against RFC 8259 in one pass and allocates
+// nothing. Values are then found on demand: a value is a position in the text,
+// and looking up a member only skips over the members before it. Strings are
+// returned as views of the text, except for strings with escapes, which are
+// decoded into an arena that the document keeps until the next Parse(), so a
+// document that is reused stops allocating.
+//
+// The text may be UTF-16 (wchar_t) or UTF-8 (char); decoded strings are in the
+// same encoding.
+//
+//     JsonDocument json;
+//     if (json.Parse(message))
+//     {
+//         std::wstring_view targetId = json.GetRoot()[L"targetInfo"][L"targetId"].GetStringOr();
+//     }
+
+enum class JsonType
+{
+    // A member or element that doesn't exist, or a value of an invalid document.
+    Missing,
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+template <typename Char> class BasicJsonDocument;
+
+template <typename Char> class BasicJsonValue
+{
+public:
+    using View = std::basic_string_view<Char>;
+
+    BasicJsonValue() = default;
+
+    JsonType GetType() const;
+    bool Exists() const { return m_begin != nullptr; }
+    bool IsNull() const { return GetType() == JsonType::Null; }
+
+    // The member of an object with the given name, or a missing value. If
+    // there are several, the first one.
+    BasicJsonValue operator[](View name) const;
+    BasicJsonValue operator[](const Char* name) const { return (*this)[View(name)]; }
+    // The element of an array at the given index, or a missing value.
+    BasicJsonValue GetElement(size_t index) const;
+
+    // Each returns false, leaving the output unchanged, if the value is of
+    // another type. Integers must be written without a fraction or exponent,
+    // and fit in the output.
+    bool GetString(View* value) const;
+    bool GetBool(bool* value) const;
+    bool GetInt64(int64_t* value) const;
+    bool GetUInt64(uint64_t* value) const;
+    bool GetDouble(double* value) const;
+    // The string, or fallback if the value isn't a string.
+    View GetStringOr(View fallback = View()) const;
+
+    // The JSON text of the value, such as an object to be passed on as is.
+    View GetRawJson() const;
+
+    // Call visitor(name, value) for each member of an object, in order, until
+    // it returns false.
+    template <typename Visitor> void ForEachMember(Visitor&& visitor) const
+    {
+        const Char* cursor = FirstChild(static_cast<Char>('{'));
+        View name;
+        BasicJsonValue value;
+        while (NextMember(&cursor, &name, &value) && visitor(name, value))
+        {
+        }
+    }
+    // Call visitor(value) for each element of an array, in order, until it
+    // returns false.
+    template <typename Visitor> void ForEachElement(Visitor&& visitor) const
+    {
+        const Char* cursor = FirstChild(static_cast<Char>('['));
+        BasicJsonValue value;
+        while (NextElement(&cursor, &value) && visitor(value))
+        {
+        }
+    }
+
+private:
+    friend class BasicJsonDocument<Char>;
+
+    BasicJsonValue(const BasicJsonDocument<Char>* document, const Char* begin)
+        : m_document(document), m_begin(begin)
+    {
+    }
+
+    // The position after the opening bracket if this is a container of the
+    // given kind, or nullptr.
+    const Char* FirstChild(Char bracket) const;
+    // Step past the member or element at *cursor. *cursor becomes nullptr at
+    // the end of the container.
+    bool NextMember(const Char** cursor, View* name, BasicJsonValue* value) const;
+    bool NextElement(const Char** cursor, BasicJsonValue* value) const;
+    // The numeric text of the value, or an empty view.
+    View GetNumberText() const;
+
+    const BasicJsonDocument<Char>* m_document = nullptr;
+    // The first character of the value in the document text.
+    const Char* m_begin = nullptr;
+};
+
+template <typename Char> class BasicJsonDocument
+{
+public:
+    using View = std::basic_string_view<Char>;
+
+    BasicJsonDocument() = default;
+    BasicJsonDocument(const BasicJsonDocument&) = delete;
+    BasicJsonDocument& operator=(const BasicJsonDocument&) = delete;
+
+    // Check json and make it the document's text. The text isn't copied, so it
+    // must outlive the document's values and the strings read from them.
+    // Returns false if json isn't valid JSON, and the root is then missing.
+    bool Parse(View json);
+    bool Parse(const Char* json) { return Parse(json ? View(json) : View()); }
+
+    BasicJsonValue<Char> GetRoot() const;
+    // Where the text stopped being valid JSON, after a failed Parse().
+    size_t GetErrorOffset() const { return m_errorOffset; }
+
+    // Deepest nesting of arrays and objects that Parse() accepts.
+    static constexpr size_t c_maxDepth = 1024;
+
+private:
+    friend class BasicJsonValue<Char>;
+
+    // Room for a decoded string of up to length characters. Decoded strings
+    // are never longer than their escaped form.
+    Char* AllocateString(size_t length) const { return m_strings.Allocate(length); }
+
+    View m_json;
+    bool m_valid = false;
+    size_t m_errorOffset = 0;
+    // Strings with escapes, decoded when they are read.
+    mutable JsonParsing::StringArena<Char> m_strings;
+};
+
+using JsonDocument = BasicJsonDocument<wchar_t>;
+using JsonValue = BasicJsonValue<wchar_t>;
+using Utf8JsonDocument = BasicJsonDocument<char>;
+using Utf8JsonValue = BasicJsonValue<char>;
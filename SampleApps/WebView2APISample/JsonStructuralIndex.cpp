@@ -0,0 +1,634 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonStructuralIndex.h"
+
+#include <cstring>
+
+// Define JSON_INDEX_NO_SSE2 to build the scalar loop on x86 too, as the tests do.
+#if !defined(JSON_INDEX_NO_SSE2) && (defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__))
+#define JSON_INDEX_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace JsonParsing;
+
+namespace
+{
+constexpr size_t c_blockSize = 64;
+
+// Bit i of each mask is set if byte i of a 64-byte block is of that class.
+struct BlockMasks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    // { } [ ] : ,
+    uint64_t op;
+    uint64_t whitespace;
+    // Below U+0020.
+    uint64_t control;
+    uint64_t nonAscii;
+};
+
+unsigned CountTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+    {
+        return index;
+    }
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return index + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+// Bit i of the result is the XOR of bits 0 to i of value: for a mask of
+// quotes, the bits from an opening quote up to its closing quote.
+uint64_t PrefixXor(uint64_t value)
+{
+    value ^= value << 1;
+    value ^= value << 2;
+    value ^= value << 4;
+    value ^= value << 8;
+    value ^= value << 16;
+    value ^= value << 32;
+    return value;
+}
+
+BlockMasks ClassifyBlock(const char* block)
+{
+    BlockMasks masks = {};
+#if JSON_INDEX_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(' ');
+    for (size_t i = 0; i < c_blockSize; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8('{')),
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8('}'))),
+            _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(bytes, _mm_set1_epi8('[')),
+                    _mm_cmpeq_epi8(bytes, _mm_set1_epi8(']'))),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')),
+                    _mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')))));
+        __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+        // The comparison is signed, so bytes of 0x80 and above are below
+        // 0x20 too; they are removed with the non-ASCII mask.
+        uint64_t nonAscii = static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+        uint64_t belowSpace = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(bytes, space)));
+        masks.quote |= uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))) << i;
+        masks.backslash |= uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, backslash))) << i;
+        masks.op |= uint64_t(_mm_movemask_epi8(op)) << i;
+        masks.whitespace |= uint64_t(_mm_movemask_epi8(whitespace)) << i;
+        masks.control |= (belowSpace & ~nonAscii) << i;
+        masks.nonAscii |= nonAscii << i;
+    }
+#else
+    for (size_t i = 0; i < c_blockSize; ++i)
+    {
+        uint64_t bit = uint64_t(1) << i;
+        unsigned char c = static_cast<unsigned char>(block[i]);
+        switch (c)
+        {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks.op |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            masks.whitespace |= bit;
+            break;
+        }
+        if (c < 0x20)
+        {
+            masks.control |= bit;
+        }
+        else if (c >= 0x80)
+        {
+            masks.nonAscii |= bit;
+        }
+    }
+#endif
+    return masks;
+}
+
+bool IsEscapeChar(char c)
+{
+    return c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' ||
+           c == 'r' || c == 't' || c == 'u';
+}
+
+// Whether a number or literal may end right before c.
+bool IsScalarDelimiter(char c)
+{
+    return IsWhitespace(c) || c == ',' || c == '}' || c == ']' || c == ':' || c == '{' ||
+           c == '[' || c == '"';
+}
+} // namespace
+
+bool JsonStructuralIndex::Build(std::string_view json)
+{
+    m_json = json;
+    m_valid = false;
+    m_errorOffset = 0;
+    m_positions.clear();
+    m_next.clear();
+    m_strings.Reset();
+    if (json.size() >= UINT32_MAX)
+    {
+        return false;
+    }
+    m_valid = FindTokens() && CheckTokens();
+    return m_valid;
+}
+
+bool JsonStructuralIndex::FindTokens()
+{
+    const char* json = m_json.data();
+    size_t size = m_json.size();
+    // The state carried from one block to the next: whether the block ended
+    // inside a string (all ones) or not (zero), whether its last byte was an
+    // escaping backslash, and whether it ended in a number or literal.
+    uint64_t inStringCarry = 0;
+    uint64_t escapedCarry = 0;
+    uint64_t scalarCarry = 0;
+    // Non-ASCII bytes before this position have been checked.
+    size_t utf8Checked = 0;
+    char tail[c_blockSize];
+
+    for (size_t base = 0; base < size; base += c_blockSize)
+    {
+        const char* block = json + base;
+        if (size - base < c_blockSize)
+        {
+            // Pad the last block with spaces, which change nothing.
+            memset(tail, ' ', c_blockSize);
+            memcpy(tail, block, size - base);
+            block = tail;
+        }
+        BlockMasks masks = ClassifyBlock(block);
+
+        // Find the backslashes that escape the next character. Backslashes
+        // are rare, so they are followed one by one.
+        uint64_t escaped = escapedCarry;
+        uint64_t escapes = 0;
+        escapedCarry = 0;
+        for (uint64_t backslashes = masks.backslash; backslashes != 0;
+             backslashes &= backslashes - 1)
+        {
+            unsigned i = CountTrailingZeros(backslashes);
+            if (escaped & (uint64_t(1) << i))
+            {
+                continue;
+            }
+            escapes |= uint64_t(1) << i;
+            if (i == c_blockSize - 1)
+            {
+                escapedCarry = 1;
+            }
+            else
+            {
+                escaped |= uint64_t(1) << (i + 1);
+            }
+        }
+
+        // Each string runs from its opening quote up to, but not including,
+        // its closing quote.
+        uint64_t quotes = masks.quote & ~escaped;
+        uint64_t inString = PrefixXor(quotes) ^ inStringCarry;
+        inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+        if (uint64_t control = masks.control & inString)
+        {
+            return Fail(base + CountTrailingZeros(control));
+        }
+        for (uint64_t stringEscapes = escapes & inString; stringEscapes != 0;
+             stringEscapes &= stringEscapes - 1)
+        {
+            size_t position = base + CountTrailingZeros(stringEscapes);
+            if (position + 1 >= size || !IsEscapeChar(json[position + 1]))
+            {
+                return Fail(position);
+            }
+            if (json[position + 1] == 'u' &&
+                (size - position < 6 || HexValue(json[position + 2]) < 0 ||
+                 HexValue(json[position + 3]) < 0 || HexValue(json[position + 4]) < 0 ||
+                 HexValue(json[position + 5]) < 0))
+            {
+                return Fail(position);
+            }
+        }
+        // Non-ASCII bytes are only valid in strings, where they must be
+        // UTF-8; elsewhere they are rejected as part of a number or literal.
+        for (uint64_t nonAscii = masks.nonAscii; nonAscii != 0; nonAscii &= nonAscii - 1)
+        {
+            size_t position = base + CountTrailingZeros(nonAscii);
+            if (position < utf8Checked)
+            {
+                continue;
+            }
+            const char* next = SkipUtf8Sequence(json + position, json + size);
+            if (!next)
+            {
+                return Fail(position);
+            }
+            utf8Checked = next - json;
+        }
+
+        uint64_t scalar = ~(masks.op | masks.whitespace | inString | quotes);
+        uint64_t scalarStarts = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+        for (uint64_t tokens = (masks.op & ~inString) | quotes | scalarStarts; tokens != 0;
+             tokens &= tokens - 1)
+        {
+            m_positions.push_back(static_cast<uint32_t>(base + CountTrailingZeros(tokens)));
+        }
+    }
+    if (inStringCarry)
+    {
+        return Fail(size);
+    }
+    return true;
+}
+
+bool JsonStructuralIndex::CheckTokens()
+{
+    const char* json = m_json.data();
+    const char* end = json + m_json.size();
+    uint32_t count = static_cast<uint32_t>(m_positions.size());
+    m_next.resize(count);
+
+    // The opening tokens of the containers enclosing the current token.
+    uint32_t open[c_maxDepth];
+    size_t depth = 0;
+    enum class Expect
+    {
+        Value,
+        // A member name, after '{' or ','.
+        Name,
+        // A ',' or the end of the container, after a value.
+        Next,
+    } expect = Expect::Value;
+
+    uint32_t token = 0;
+    while (token < count)
+    {
+        size_t position = m_positions[token];
+        char c = json[position];
+        if (expect == Expect::Next && depth == 0)
+        {
+            // Only whitespace may follow the root value.
+            return Fail(position);
+        }
+
+        if (expect == Expect::Name)
+        {
+            // The closing quote is always the next token.
+            if (c != '"' || token + 2 >= count || GetTokenChar(token + 2) != ':')
+            {
+                return Fail(position);
+            }
+            token += 3;
+            expect = Expect::Value;
+        }
+        else if (expect == Expect::Next)
+        {
+            bool isObject = GetTokenChar(open[depth - 1]) == '{';
+            if (c == ',')
+            {
+                ++token;
+                expect = isObject ? Expect::Name : Expect::Value;
+            }
+            else if (c == (isObject ? '}' : ']'))
+            {
+                m_next[open[--depth]] = ++token;
+            }
+            else
+            {
+                return Fail(position);
+            }
+        }
+        else if (c == '{' || c == '[')
+        {
+            bool isObject = c == '{';
+            if (token + 1 < count && GetTokenChar(token + 1) == (isObject ? '}' : ']'))
+            {
+                m_next[token] = token + 2;
+                token += 2;
+                expect = Expect::Next;
+            }
+            else if (depth < c_maxDepth)
+            {
+                open[depth++] = token++;
+                expect = isObject ? Expect::Name : Expect::Value;
+            }
+            else
+            {
+                return Fail(position);
+            }
+        }
+        else if (c == '"')
+        {
+            m_next[token] = token + 2;
+            token += 2;
+            expect = Expect::Next;
+        }
+        else
+        {
+            const char* scalar = json + position;
+            const char* scalarEnd;
+            switch (c)
+            {
+            case 't':
+                scalarEnd = ValidateLiteral(scalar, end, "true");
+                break;
+            case 'f':
+                scalarEnd = ValidateLiteral(scalar, end, "false");
+                break;
+            case 'n':
+                scalarEnd = ValidateLiteral(scalar, end, "null");
+                break;
+            default:
+                scalarEnd = ValidateNumber(scalar, end);
+                break;
+            }
+            if (!scalarEnd || (scalarEnd < end && !IsScalarDelimiter(*scalarEnd)))
+            {
+                return Fail(position);
+            }
+            m_next[token] = token + 1;
+            ++token;
+            expect = Expect::Next;
+        }
+    }
+    if (expect != Expect::Next || depth != 0)
+    {
+        return Fail(m_json.size());
+    }
+    return true;
+}
+
+JsonIndexedValue JsonStructuralIndex::GetRoot() const
+{
+    return m_valid ? JsonIndexedValue(this, 0) : JsonIndexedValue();
+}
+
+char JsonIndexedValue::GetFirstChar() const
+{
+    return m_index->GetTokenChar(m_token);
+}
+
+JsonType JsonIndexedValue::GetType() const
+{
+    if (!m_index)
+    {
+        return JsonType::Missing;
+    }
+    switch (GetFirstChar())
+    {
+    case '"':
+        return JsonType::String;
+    case '{':
+        return JsonType::Object;
+    case '[':
+        return JsonType::Array;
+    case 't':
+    case 'f':
+        return JsonType::Bool;
+    case 'n':
+        return JsonType::Null;
+    default:
+        return JsonType::Number;
+    }
+}
+
+uint32_t JsonIndexedValue::FirstChild(char bracket) const
+{
+    return m_index && GetFirstChar() == bracket ? m_token + 1 : c_noToken;
+}
+
+bool JsonIndexedValue::NextMember(
+    uint32_t* token, std::string_view* name, JsonIndexedValue* value) const
+{
+    if (*token == c_noToken)
+    {
+        return false;
+    }
+    if (m_index->GetTokenChar(*token) == ',')
+    {
+        ++*token;
+    }
+    if (m_index->GetTokenChar(*token) == '}')
+    {
+        *token = c_noToken;
+        return false;
+    }
+    JsonIndexedValue(m_index, *token).GetString(name);
+    *value = JsonIndexedValue(m_index, *token + 3);
+    *token = m_index->m_next[*token + 3];
+    return true;
+}
+
+bool JsonIndexedValue::NextElement(uint32_t* token, JsonIndexedValue* value) const
+{
+    if (*token == c_noToken)
+    {
+        return false;
+    }
+    if (m_index->GetTokenChar(*token) == ',')
+    {
+        ++*token;
+    }
+    if (m_index->GetTokenChar(*token) == ']')
+    {
+        *token = c_noToken;
+        return false;
+    }
+    *value = JsonIndexedValue(m_index, *token);
+    *token = m_index->m_next[*token];
+    return true;
+}
+
+JsonIndexedValue JsonIndexedValue::operator[](std::string_view name) const
+{
+    uint32_t token = FirstChild('{');
+    if (token == c_noToken)
+    {
+        return JsonIndexedValue();
+    }
+    const char* json = m_index->m_json.data();
+    // Names are compared in their escaped form, and only decoded, into a
+    // buffer allocated on first use, when they contain escapes.
+    char* scratch = nullptr;
+    size_t scratchLength = 0;
+    while (m_index->GetTokenChar(token) != '}')
+    {
+        const char* quote = json + m_index->m_positions[token];
+        std::string_view escapedName(
+            quote + 1, json + m_index->m_positions[token + 1] - quote - 1);
+        bool found;
+        if (escapedName.find('\\') == std::string_view::npos)
+        {
+            found = escapedName == name;
+        }
+        else
+        {
+            if (scratchLength < escapedName.size())
+            {
+                scratchLength = escapedName.size();
+                scratch = m_index->m_strings.Allocate(scratchLength);
+            }
+            found = StringEquals(quote, name, scratch);
+        }
+        if (found)
+        {
+            return JsonIndexedValue(m_index, token + 3);
+        }
+        token = m_index->m_next[token + 3];
+        if (m_index->GetTokenChar(token) == ',')
+        {
+            ++token;
+        }
+    }
+    return JsonIndexedValue();
+}
+
+JsonIndexedValue JsonIndexedValue::GetElement(size_t index) const
+{
+    uint32_t token = FirstChild('[');
+    JsonIndexedValue value;
+    while (NextElement(&token, &value))
+    {
+        if (index-- == 0)
+        {
+            return value;
+        }
+    }
+    return JsonIndexedValue();
+}
+
+bool JsonIndexedValue::GetString(std::string_view* value) const
+{
+    if (GetType() != JsonType::String)
+    {
+        return false;
+    }
+    const char* json = m_index->m_json.data();
+    const char* quote = json + m_index->m_positions[m_token];
+    std::string_view contents(quote + 1, json + m_index->m_positions[m_token + 1] - quote - 1);
+    if (contents.find('\\') == std::string_view::npos)
+    {
+        *value = contents;
+        return true;
+    }
+    char* decoded = m_index->m_strings.Allocate(contents.size());
+    *value = std::string_view(decoded, DecodeString(quote, decoded));
+    return true;
+}
+
+std::string_view JsonIndexedValue::GetStringOr(std::string_view fallback) const
+{
+    std::string_view value;
+    return GetString(&value) ? value : fallback;
+}
+
+bool JsonIndexedValue::GetBool(bool* value) const
+{
+    if (GetType() != JsonType::Bool)
+    {
+        return false;
+    }
+    *value = GetFirstChar() == 't';
+    return true;
+}
+
+std::string_view JsonIndexedValue::GetScalarText() const
+{
+    const char* begin = m_index->m_json.data() + m_index->m_positions[m_token];
+    const char* end = m_index->m_json.data() + m_index->m_json.size();
+    const char* p = begin;
+    while (p < end && !IsScalarDelimiter(*p))
+    {
+        ++p;
+    }
+    return std::string_view(begin, p - begin);
+}
+
+bool JsonIndexedValue::GetInt64(int64_t* value) const
+{
+    if (GetType() != JsonType::Number)
+    {
+        return false;
+    }
+    std::string_view text = GetScalarText();
+    return text.size() <= c_maxNumberBufferLength && ParseNumber(text, value);
+}
+
+bool JsonIndexedValue::GetUInt64(uint64_t* value) const
+{
+    if (GetType() != JsonType::Number)
+    {
+        return false;
+    }
+    std::string_view text = GetScalarText();
+    return text.size() <= c_maxNumberBufferLength && ParseNumber(text, value);
+}
+
+bool JsonIndexedValue::GetDouble(double* value) const
+{
+    return GetType() == JsonType::Number && ParseNumber(GetScalarText(), value);
+}
+
+std::string_view JsonIndexedValue::GetRawJson() const
+{
+    if (!m_index)
+    {
+        return std::string_view();
+    }
+    const char* json = m_index->m_json.data();
+    size_t begin = m_index->m_positions[m_token];
+    switch (GetFirstChar())
+    {
+    case '{':
+    case '[':
+    case '"':
+        // The last token of the value is its closing bracket or quote.
+        return std::string_view(
+            json + begin, m_index->m_positions[m_index->m_next[m_token] - 1] + 1 - begin);
+    default:
+        return GetScalarText();
+    }
+}
@@ -0,0 +1,156 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "JsonParsing.h"
+#include "JsonReader.h"
+
+// A reader for large UTF-8 JSON documents, such as DevTools protocol events
+// with big argument previews, in two stages as in simdjson:
+//
+// 1. Build() classifies 64 bytes at a time with SSE2 where available, or a
+//    scalar loop otherwise, and records the position of every token: the
+//    brackets, colons and commas outside strings, both quotes of each string,
+//    and the first character of each number and literal. String contents are
+//    never looked at one byte at a time except to check escapes and non-ASCII
+//    characters.
+// 2. Build() then checks the grammar over the tokens alone, and links every
+//    array and object to the token after its end.
+//
+// Values are positions in the token list, so looking up a member skips each
+// member before it in constant time, however large it is. The API follows
+// JsonValue; strings with escapes are decoded into an arena that is reused
+// by the next Build(), as are the token lists.
+
+class JsonStructuralIndex;
+
+class JsonIndexedValue
+{
+public:
+    JsonIndexedValue() = default;
+
+    JsonType GetType() const;
+    bool Exists() const { return m_index != nullptr; }
+    bool IsNull() const { return GetType() == JsonType::Null; }
+
+    // The member of an object with the given name, or a missing value. If
+    // there are several, the first one.
+    JsonIndexedValue operator[](std::string_view name) const;
+    JsonIndexedValue operator[](const char* name) const { return (*this)[std::string_view(name)]; }
+    // The element of an array at the given index, or a missing value.
+    JsonIndexedValue GetElement(size_t index) const;
+
+    // Each returns false, leaving the output unchanged, if the value is of
+    // another type. Integers must be written without a fraction or exponent,
+    // and fit in the output.
+    bool GetString(std::string_view* value) const;
+    bool GetBool(bool* value) const;
+    bool GetInt64(int64_t* value) const;
+    bool GetUInt64(uint64_t* value) const;
+    bool GetDouble(double* value) const;
+    // The string, or fallback if the value isn't a string.
+    std::string_view GetStringOr(std::string_view fallback = std::string_view()) const;
+
+    // The JSON text of the value.
+    std::string_view GetRawJson() const;
+
+    // Call visitor(name, value) for each member of an object, in order, until
+    // it returns false.
+    template <typename Visitor> void ForEachMember(Visitor&& visitor) const
+    {
+        uint32_t token = FirstChild('{');
+        std::string_view name;
+        JsonIndexedValue value;
+        while (NextMember(&token, &name, &value) && visitor(name, value))
+        {
+        }
+    }
+    // Call visitor(value) for each element of an array, in order, until it
+    // returns false.
+    template <typename Visitor> void ForEachElement(Visitor&& visitor) const
+    {
+        uint32_t token = FirstChild('[');
+        JsonIndexedValue value;
+        while (NextElement(&token, &value) && visitor(value))
+        {
+        }
+    }
+
+private:
+    friend class JsonStructuralIndex;
+
+    static constexpr uint32_t c_noToken = UINT32_MAX;
+
+    JsonIndexedValue(const JsonStructuralIndex* index, uint32_t token)
+        : m_index(index), m_token(token)
+    {
+    }
+
+    char GetFirstChar() const;
+    // The token after the opening bracket if this is a container of the given
+    // kind, or c_noToken.
+    uint32_t FirstChild(char bracket) const;
+    // Step past the member or element at *token. *token becomes c_noToken at
+    // the end of the container.
+    bool NextMember(uint32_t* token, std::string_view* name, JsonIndexedValue* value) const;
+    bool NextElement(uint32_t* token, JsonIndexedValue* value) const;
+    // The text of a number or literal.
+    std::string_view GetScalarText() const;
+
+    const JsonStructuralIndex* m_index = nullptr;
+    // The index of the value's first token.
+    uint32_t m_token = 0;
+};
+
+class JsonStructuralIndex
+{
+public:
+    JsonStructuralIndex() = default;
+    JsonStructuralIndex(const JsonStructuralIndex&) = delete;
+    JsonStructuralIndex& operator=(const JsonStructuralIndex&) = delete;
+
+    // Index json, which isn't copied and must outlive the values and strings
+    // read from it. Returns false if it isn't valid JSON, or is 4 GB or more;
+    // the root is then missing.
+    bool Build(std::string_view json);
+
+    JsonIndexedValue GetRoot() const;
+    // Where the text stopped being valid JSON, after a failed Build().
+    size_t GetErrorOffset() const { return m_errorOffset; }
+    size_t GetTokenCount() const { return m_positions.size(); }
+
+    // Deepest nesting of arrays and objects that Build() accepts.
+    static constexpr size_t c_maxDepth = 1024;
+
+private:
+    friend class JsonIndexedValue;
+
+    // Stage 1: fill m_positions, and check string contents.
+    bool FindTokens();
+    // Stage 2: check the grammar and fill m_next.
+    bool CheckTokens();
+    bool Fail(size_t offset)
+    {
+        m_errorOffset = offset;
+        return false;
+    }
+
+    char GetTokenChar(uint32_t token) const { return m_json[m_positions[token]]; }
+
+    std::string_view m_json;
+    bool m_valid = false;
+    size_t m_errorOffset = 0;
+    // The position in m_json of each token.
+    std::vector<uint32_t> m_positions;
+    // For the first token of each value, the token after the value. A string
+    // is two tokens, its quotes.
+    std::vector<uint32_t> m_next;
+    mutable JsonParsing::StringArena<char> m_strings;
+};
@@ -0,0 +1,196 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonWriter.h"
+
+#include <charconv>
+#include <cmath>
+
+#include "JsonEscape.h"
+
+void JsonWriter::Reset()
+{
+    m_buffer.clear();
+    m_hasMembers.assign(1, false);
+    m_afterKey = false;
+}
+
+void JsonWriter::BeginValue()
+{
+    if (m_afterKey)
+    {
+        m_afterKey = false;
+        return;
+    }
+    if (m_hasMembers.back())
+    {
+        m_buffer.push_back(L',');
+    }
+    m_hasMembers.back() = true;
+}
+
+JsonWriter& JsonWriter::BeginObject()
+{
+    BeginValue();
+    m_buffer.push_back(L'{');
+    m_hasMembers.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject()
+{
+    m_buffer.push_back(L'}');
+    if (m_hasMembers.size() > 1)
+    {
+        m_hasMembers.pop_back();
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray()
+{
+    BeginValue();
+    m_buffer.push_back(L'[');
+    m_hasMembers.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray()
+{
+    m_buffer.push_back(L']');
+    if (m_hasMembers.size() > 1)
+    {
+        m_hasMembers.pop_back();
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::wstring_view name)
+{
+    BeginValue();
+    m_buffer.push_back(L'"');
+    AppendJsonEscaped(m_buffer, name);
+    m_buffer.append(L"\":");
+    m_afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(uint64_t name)
+{
+    BeginValue();
+    m_buffer.push_back(L'"');
+    AppendDigits(name);
+    m_buffer.append(L"\":");
+    m_afterKey = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::wstring_view value)
+{
+    BeginValue();
+    m_buffer.push_back(L'"');
+    AppendJsonEscaped(m_buffer, value);
+    m_buffer.push_back(L'"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(const wchar_t* value)
+{
+    if (!value)
+    {
+        return Null();
+    }
+    return String(std::wstring_view(value));
+}
+
+JsonWriter& JsonWriter::BeginString()
+{
+    BeginValue();
+    m_buffer.push_back(L'"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::AppendToString(std::wstring_view value)
+{
+    AppendJsonEscaped(m_buffer, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndString()
+{
+    m_buffer.push_back(L'"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(int64_t value)
+{
+    BeginValue();
+    if (value < 0)
+    {
+        m_buffer.push_back(L'-');
+        // Negate in unsigned arithmetic so INT64_MIN doesn't overflow.
+        AppendDigits(0 - static_cast<uint64_t>(value));
+    }
+    else
+    {
+        AppendDigits(static_cast<uint64_t>(value));
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::UInt(uint64_t value)
+{
+    BeginValue();
+    AppendDigits(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Double(double value)
+{
+    if (!std::isfinite(value))
+    {
+        return Null();
+    }
+    BeginValue();
+    char digits[32];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    m_buffer.append(digits, result.ptr);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value)
+{
+    BeginValue();
+    m_buffer.append(value ? L"true" : L"false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null()
+{
+    BeginValue();
+    m_buffer.append(L"null");
+    return *this;
+}
+
+JsonWriter& JsonWriter::RawValue(std::wstring_view json)
+{
+    BeginValue();
+    m_buffer.append(json);
+    return *this;
+}
+
+void JsonWriter::AppendDigits(uint64_t value)
+{
+    wchar_t digits[20];
+    size_t count = 0;
+    do
+    {
+        digits[count++] = static_cast<wchar_t>(L'0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0)
+    {
+        m_buffer.push_back(digits[--count]);
+    }
+}
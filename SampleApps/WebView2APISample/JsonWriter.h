@@ -0,0 +1,67 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// An append-only JSON writer. Values are written straight into a buffer that
+// the writer owns, and Reset() keeps the buffer's capacity, so a writer that is
+// reused for every message stops allocating once it has seen the largest one.
+// Commas between members and elements are inserted automatically.
+class JsonWriter
+{
+public:
+    // Discard the current contents but keep the allocated buffer.
+    void Reset();
+    const std::wstring& GetString() const { return m_buffer; }
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    // Write the name of the next object member.
+    JsonWriter& Key(std::wstring_view name);
+    // Write a number as the name of the next object member, for objects keyed
+    // by id, without formatting it into a temporary string.
+    JsonWriter& Key(uint64_t name);
+
+    // Write a complete, escaped string value. A null pointer writes null.
+    JsonWriter& String(std::wstring_view value);
+    JsonWriter& String(const wchar_t* value);
+
+    // Write a string value in pieces, for values that are built from more than
+    // one source string, without a temporary concatenation.
+    JsonWriter& BeginString();
+    JsonWriter& AppendToString(std::wstring_view value);
+    JsonWriter& EndString();
+
+    JsonWriter& Int(int64_t value);
+    JsonWriter& UInt(uint64_t value);
+    // Written in the shortest form that reads back as the same value. JSON has
+    // no infinities or NaN, so those are written as null.
+    JsonWriter& Double(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& Null();
+    // Write a value that is already JSON, such as the output of another
+    // JsonWriter. It is copied as is.
+    JsonWriter& RawValue(std::wstring_view json);
+
+private:
+    // Called before any value or key to write a separating comma if needed.
+    void BeginValue();
+    void AppendDigits(uint64_t value);
+
+    std::wstring m_buffer;
+    // One entry for the top level and each open container, which is true once
+    // it has a member. Like m_buffer, it keeps its capacity across Reset().
+    std::vector<bool> m_hasMembers = std::vector<bool>(1, false);
+    // True right after Key(), when the value must not be preceded by a comma.
+    bool m_afterKey = false;
+};
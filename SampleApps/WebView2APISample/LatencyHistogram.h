@@ -0,0 +1,185 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A histogram of non-negative values such as durations in nanoseconds, with
+// log-linear buckets in the style of HdrHistogram: values below 64 have a
+// bucket each, and every power of two above that is split into 32 equal
+// buckets. A percentile is reported as the upper end of its bucket, so it is
+// never below the true value and at most 1/32 (about 3%) above it. Values above
+// c_maxValue (about 18 minutes in nanoseconds) are counted as c_maxValue.
+//
+// Recording is lock-free and may happen on any number of threads. Reading
+// while values are recorded gives a consistent-enough snapshot for reporting.
+// Histograms can be merged, for example to combine per-thread histograms.
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned c_subBucketBits = 6;
+    static constexpr uint64_t c_maxValue = (uint64_t(1) << 40) - 1;
+
+    LatencyHistogram() { Reset(); }
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void Record(uint64_t value, uint64_t count = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        value = value > c_maxValue ? c_maxValue : value;
+        m_counts[GetBucketIndex(value)].fetch_add(count, std::memory_order_relaxed);
+        m_totalCount.fetch_add(count, std::memory_order_relaxed);
+        m_sum.fetch_add(value * count, std::memory_order_relaxed);
+        UpdateMin(value);
+        UpdateMax(value);
+    }
+
+    // Add other's values to this histogram.
+    void Merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < c_bucketCount; ++i)
+        {
+            uint64_t count = other.m_counts[i].load(std::memory_order_relaxed);
+            if (count != 0)
+            {
+                m_counts[i].fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+        m_totalCount.fetch_add(other.GetCount(), std::memory_order_relaxed);
+        m_sum.fetch_add(other.m_sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (other.GetCount() != 0)
+        {
+            UpdateMin(other.GetMin());
+            UpdateMax(other.GetMax());
+        }
+    }
+
+    // Not safe to call while values are being recorded.
+    void Reset()
+    {
+        for (std::atomic<uint64_t>& count : m_counts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_totalCount.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(UINT64_MAX, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t GetCount() const { return m_totalCount.load(std::memory_order_relaxed); }
+    uint64_t GetMin() const { return GetCount() == 0 ? 0 : m_min.load(std::memory_order_relaxed); }
+    uint64_t GetMax() const { return m_max.load(std::memory_order_relaxed); }
+    double GetMean() const
+    {
+        uint64_t count = GetCount();
+        return count == 0 ? 0 : double(m_sum.load(std::memory_order_relaxed)) / count;
+    }
+
+    // The value below or at which the given percentage (0 to 100) of the
+    // recorded values lie. 0 if nothing was recorded.
+    uint64_t GetValueAtPercentile(double percentile) const
+    {
+        uint64_t total = GetCount();
+        if (total == 0)
+        {
+            return 0;
+        }
+        percentile = percentile < 0 ? 0 : (percentile > 100 ? 100 : percentile);
+        uint64_t rank = static_cast<uint64_t>(percentile / 100 * total + 0.5);
+        rank = rank == 0 ? 1 : rank;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < c_bucketCount; ++i)
+        {
+            seen += m_counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                uint64_t value = GetBucketHighestValue(i);
+                uint64_t max = GetMax();
+                return value < max ? value : max;
+            }
+        }
+        return GetMax();
+    }
+
+    // Bucket layout, exposed for tests. Buckets below 2^c_subBucketBits hold
+    // one value each; above, bucket index i covers a range of 2^shift values.
+    static size_t GetBucketIndex(uint64_t value)
+    {
+        if (value < c_linearLimit)
+        {
+            return static_cast<size_t>(value);
+        }
+        unsigned shift = HighestBit(value) - c_subBucketBits + 1;
+        return static_cast<size_t>(
+            (shift + 1) * c_halfSubBucketCount + ((value >> shift) - c_halfSubBucketCount));
+    }
+    static uint64_t GetBucketLowestValue(size_t index)
+    {
+        if (index < c_linearLimit)
+        {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / c_halfSubBucketCount) - 1;
+        uint64_t mantissa = index % c_halfSubBucketCount + c_halfSubBucketCount;
+        return mantissa << shift;
+    }
+    static uint64_t GetBucketHighestValue(size_t index)
+    {
+        if (index < c_linearLimit)
+        {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / c_halfSubBucketCount) - 1;
+        return GetBucketLowestValue(index) + (uint64_t(1) << shift) - 1;
+    }
+
+private:
+    static constexpr uint64_t c_linearLimit = uint64_t(1) << c_subBucketBits;
+    static constexpr uint64_t c_halfSubBucketCount = c_linearLimit / 2;
+    // One past the index of c_maxValue's bucket.
+    static constexpr size_t c_bucketCount =
+        (40 - c_subBucketBits + 2) * c_halfSubBucketCount;
+
+    static unsigned HighestBit(uint64_t value)
+    {
+        unsigned bit = 0;
+        while (value >>= 1)
+        {
+            ++bit;
+        }
+        return bit;
+    }
+
+    void UpdateMin(uint64_t value)
+    {
+        uint64_t current = m_min.load(std::memory_order_relaxed);
+        while (value < current &&
+               !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void UpdateMax(uint64_t value)
+    {
+        uint64_t current = m_max.load(std::memory_order_relaxed);
+        while (value > current &&
+               !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<uint64_t> m_counts[c_bucketCount];
+    std::atomic<uint64_t> m_totalCount;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_min;
+    std::atomic<uint64_t> m_max;
+};
@@ -0,0 +1,623 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MimeTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace
+{
+struct MimeType
+{
+    std::string_view extension;
+    std::string_view type;
+};
+
+// Extensions are lowercase ASCII and unique; the table below doesn't build
+// otherwise.
+constexpr MimeType c_mimeTypes[] = {
+    {"3g2", "video/3gpp2"},
+    {"3gp", "video/3gpp"},
+    {"3mf", "model/3mf"},
+    {"7z", "application/x-7z-compressed"},
+    {"aac", "audio/aac"},
+    {"abw", "application/x-abiword"},
+    {"ai", "application/postscript"},
+    {"aif", "audio/x-aiff"},
+    {"aifc", "audio/x-aiff"},
+    {"aiff", "audio/x-aiff"},
+    {"apk", "application/vnd.android.package-archive"},
+    {"apng", "image/apng"},
+    {"appcache", "text/cache-manifest"},
+    {"arc", "application/x-freearc"},
+    {"asf", "video/x-ms-asf"},
+    {"asm", "text/x-asm"},
+    {"atom", "application/atom+xml"},
+    {"au", "audio/basic"},
+    {"avi", "video/x-msvideo"},
+    {"avif", "image/avif"},
+    {"azw", "application/vnd.amazon.ebook"},
+    {"bat", "application/x-msdownload"},
+    {"bin", "application/octet-stream"},
+    {"bmp", "image/bmp"},
+    {"br", "application/x-brotli"},
+    {"bz", "application/x-bzip"},
+    {"bz2", "application/x-bzip2"},
+    {"c", "text/x-c"},
+    {"cab", "application/vnd.ms-cab-compressed"},
+    {"cbor", "application/cbor"},
+    {"cc", "text/x-c"},
+    {"cda", "application/x-cdf"},
+    {"cer", "application/pkix-cert"},
+    {"cjs", "text/javascript"},
+    {"class", "application/java-vm"},
+    {"cmd", "text/plain"},
+    {"conf", "text/plain"},
+    {"cpp", "text/x-c"},
+    {"crl", "application/pkix-crl"},
+    {"crt", "application/x-x509-ca-cert"},
+    {"csh", "application/x-csh"},
+    {"css", "text/css"},
+    {"csv", "text/csv"},
+    {"cur", "image/x-icon"},
+    {"cxx", "text/x-c"},
+    {"dart", "application/vnd.dart"},
+    {"deb", "application/x-debian-package"},
+    {"def", "text/plain"},
+    {"der", "application/x-x509-ca-cert"},
+    {"diff", "text/x-diff"},
+    {"dll", "application/x-msdownload"},
+    {"dmg", "application/x-apple-diskimage"},
+    {"doc", "application/msword"},
+    {"docm", "application/vnd.ms-word.document.macroenabled.12"},
+    {"docx", "application/vnd.openxmlformats-officedocument.wordprocessingml.document"},
+    {"dot", "application/msword"},
+    {"dotx", "application/vnd.openxmlformats-officedocument.wordprocessingml.template"},
+    {"dtd", "application/xml-dtd"},
+    {"dwg", "image/vnd.dwg"},
+    {"dxf", "image/vnd.dxf"},
+    {"ear", "application/java-archive"},
+    {"eml", "message/rfc822"},
+    {"eot", "application/vnd.ms-fontobject"},
+    {"eps", "application/postscript"},
+    {"epub", "application/epub+zip"},
+    {"exe", "application/x-msdownload"},
+    {"f4v", "video/x-f4v"},
+    {"flac", "audio/flac"},
+    {"flv", "video/x-flv"},
+    {"gif", "image/gif"},
+    {"glb", "model/gltf-binary"},
+    {"gltf", "model/gltf+json"},
+    {"go", "text/x-go"},
+    {"gz", "application/gzip"},
+    {"h", "text/x-c"},
+    {"h261", "video/h261"},
+    {"h263", "video/h263"},
+    {"h264", "video/h264"},
+    {"heic", "image/heic"},
+    {"heif", "image/heif"},
+    {"hh", "text/x-c"},
+    {"hpp", "text/x-c"},
+    {"hqx", "application/mac-binhex40"},
+    {"htc", "text/x-component"},
+    {"htm", "text/html"},
+    {"html", "text/html"},
+    {"ico", "image/x-icon"},
+    {"ics", "text/calendar"},
+    {"ifb", "text/calendar"},
+    {"img", "application/octet-stream"},
+    {"ini", "text/plain"},
+    {"iso", "application/x-iso9660-image"},
+    {"jad", "text/vnd.sun.j2me.app-descriptor"},
+    {"jar", "application/java-archive"},
+    {"java", "text/x-java-source"},
+    {"jfif", "image/jpeg"},
+    {"jng", "image/x-jng"},
+    {"jnlp", "application/x-java-jnlp-file"},
+    {"jp2", "image/jp2"},
+    {"jpe", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"jpg", "image/jpeg"},
+    {"jpm", "image/jpm"},
+    {"jpx", "image/jpx"},
+    {"js", "text/javascript"},
+    {"json", "application/json"},
+    {"json5", "application/json5"},
+    {"jsonld", "application/ld+json"},
+    {"jsx", "text/jsx"},
+    {"jxl", "image/jxl"},
+    {"jxr", "image/jxr"},
+    {"key", "application/vnd.apple.keynote"},
+    {"kml", "application/vnd.google-earth.kml+xml"},
+    {"kmz", "application/vnd.google-earth.kmz"},
+    {"ktx", "image/ktx"},
+    {"ktx2", "image/ktx2"},
+    {"less", "text/less"},
+    {"list", "text/plain"},
+    {"log", "text/plain"},
+    {"lua", "text/x-lua"},
+    {"lz", "application/x-lzip"},
+    {"lzh", "application/x-lzh-compressed"},
+    {"m1v", "video/mpeg"},
+    {"m2a", "audio/mpeg"},
+    {"m2ts", "video/mp2t"},
+    {"m2v", "video/mpeg"},
+    {"m3a", "audio/mpeg"},
+    {"m3u", "audio/x-mpegurl"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"m4a", "audio/mp4"},
+    {"m4b", "audio/mp4"},
+    {"m4p", "application/mp4"},
+    {"m4s", "video/iso.segment"},
+    {"m4v", "video/mp4"},
+    {"man", "text/troff"},
+    {"manifest", "text/cache-manifest"},
+    {"map", "application/json"},
+    {"markdown", "text/markdown"},
+    {"mathml", "application/mathml+xml"},
+    {"md", "text/markdown"},
+    {"mdb", "application/x-msaccess"},
+    {"me", "text/troff"},
+    {"mht", "message/rfc822"},
+    {"mhtml", "message/rfc822"},
+    {"mid", "audio/midi"},
+    {"midi", "audio/midi"},
+    {"mjs", "text/javascript"},
+    {"mka", "audio/x-matroska"},
+    {"mkv", "video/x-matroska"},
+    {"mml", "text/mathml"},
+    {"mng", "video/x-mng"},
+    {"mov", "video/quicktime"},
+    {"mp1", "audio/mpeg"},
+    {"mp2", "audio/mpeg"},
+    {"mp3", "audio/mpeg"},
+    {"mp4", "video/mp4"},
+    {"mp4a", "audio/mp4"},
+    {"mp4v", "video/mp4"},
+    {"mpd", "application/dash+xml"},
+    {"mpe", "video/mpeg"},
+    {"mpeg", "video/mpeg"},
+    {"mpg", "video/mpeg"},
+    {"mpg4", "video/mp4"},
+    {"mpga", "audio/mpeg"},
+    {"mpkg", "application/vnd.apple.installer+xml"},
+    {"msg", "application/vnd.ms-outlook"},
+    {"msi", "application/x-msdownload"},
+    {"msix", "application/msix"},
+    {"msixbundle", "application/msixbundle"},
+    {"msp", "application/octet-stream"},
+    {"mts", "model/vnd.mts"},
+    {"mxml", "application/xv+xml"},
+    {"n3", "text/n3"},
+    {"nb", "application/mathematica"},
+    {"nc", "application/x-netcdf"},
+    {"nfo", "text/x-nfo"},
+    {"numbers", "application/vnd.apple.numbers"},
+    {"obj", "model/obj"},
+    {"oda", "application/oda"},
+    {"odb", "application/vnd.oasis.opendocument.database"},
+    {"odc", "application/vnd.oasis.opendocument.chart"},
+    {"odf", "application/vnd.oasis.opendocument.formula"},
+    {"odg", "application/vnd.oasis.opendocument.graphics"},
+    {"odi", "application/vnd.oasis.opendocument.image"},
+    {"odp", "application/vnd.oasis.opendocument.presentation"},
+    {"ods", "application/vnd.oasis.opendocument.spreadsheet"},
+    {"odt", "application/vnd.oasis.opendocument.text"},
+    {"oga", "audio/ogg"},
+    {"ogg", "audio/ogg"},
+    {"ogv", "video/ogg"},
+    {"ogx", "application/ogg"},
+    {"onepkg", "application/onenote"},
+    {"onetoc", "application/onenote"},
+    {"opus", "audio/ogg"},
+    {"otf", "font/otf"},
+    {"owl", "application/rdf+xml"},
+    {"p10", "application/pkcs10"},
+    {"p12", "application/x-pkcs12"},
+    {"p7b", "application/x-pkcs7-certificates"},
+    {"p7c", "application/pkcs7-mime"},
+    {"p7m", "application/pkcs7-mime"},
+    {"p7s", "application/pkcs7-signature"},
+    {"p8", "application/pkcs8"},
+    {"pages", "application/vnd.apple.pages"},
+    {"pas", "text/x-pascal"},
+    {"patch", "text/x-diff"},
+    {"pbm", "image/x-portable-bitmap"},
+    {"pdb", "application/x-pilot"},
+    {"pdf", "application/pdf"},
+    {"pem", "application/x-pem-file"},
+    {"pfx", "application/x-pkcs12"},
+    {"pgm", "image/x-portable-graymap"},
+    {"pgp", "application/pgp-encrypted"},
+    {"php", "application/x-httpd-php"},
+    {"pic", "image/x-pict"},
+    {"pkg", "application/octet-stream"},
+    {"pl", "application/x-perl"},
+    {"pls", "audio/x-scpls"},
+    {"pm", "application/x-perl"},
+    {"png", "image/png"},
+    {"pnm", "image/x-portable-anymap"},
+    {"pot", "application/vnd.ms-powerpoint"},
+    {"potx", "application/vnd.openxmlformats-officedocument.presentationml.template"},
+    {"ppm", "image/x-portable-pixmap"},
+    {"pps", "application/vnd.ms-powerpoint"},
+    {"ppsx", "application/vnd.openxmlformats-officedocument.presentationml.slideshow"},
+    {"ppt", "application/vnd.ms-powerpoint"},
+    {"pptm", "application/vnd.ms-powerpoint.presentation.macroenabled.12"},
+    {"pptx", "application/vnd.openxmlformats-officedocument.presentationml.presentation"},
+    {"prc", "application/x-mobipocket-ebook"},
+    {"ps", "application/postscript"},
+    {"psd", "image/vnd.adobe.photoshop"},
+    {"pub", "application/x-mspublisher"},
+    {"py", "text/x-python"},
+    {"qt", "video/quicktime"},
+    {"ra", "audio/x-realaudio"},
+    {"ram", "audio/x-pn-realaudio"},
+    {"rar", "application/vnd.rar"},
+    {"ras", "image/x-cmu-raster"},
+    {"rb", "text/x-ruby"},
+    {"rdf", "application/rdf+xml"},
+    {"rgb", "image/x-rgb"},
+    {"rm", "application/vnd.rn-realmedia"},
+    {"rpm", "application/x-redhat-package-manager"},
+    {"rs", "text/x-rust"},
+    {"rss", "application/rss+xml"},
+    {"rtf", "application/rtf"},
+    {"rtx", "text/richtext"},
+    {"run", "application/x-makeself"},
+    {"s", "text/x-asm"},
+    {"sass", "text/x-sass"},
+    {"scss", "text/x-scss"},
+    {"sea", "application/x-sea"},
+    {"sgm", "text/sgml"},
+    {"sgml", "text/sgml"},
+    {"sh", "application/x-sh"},
+    {"shtml", "text/html"},
+    {"sig", "application/pgp-signature"},
+    {"sit", "application/x-stuffit"},
+    {"sitx", "application/x-stuffitx"},
+    {"snd", "audio/basic"},
+    {"so", "application/octet-stream"},
+    {"spx", "audio/ogg"},
+    {"sql", "application/sql"},
+    {"src", "application/x-wais-source"},
+    {"srt", "application/x-subrip"},
+    {"ssml", "application/ssml+xml"},
+    {"stl", "model/stl"},
+    {"svg", "image/svg+xml"},
+    {"svgz", "image/svg+xml"},
+    {"swf", "application/x-shockwave-flash"},
+    {"t", "text/troff"},
+    {"tar", "application/x-tar"},
+    {"tcl", "application/x-tcl"},
+    {"tex", "application/x-tex"},
+    {"text", "text/plain"},
+    {"tga", "image/x-tga"},
+    {"tgz", "application/gzip"},
+    {"tif", "image/tiff"},
+    {"tiff", "image/tiff"},
+    {"tk", "application/x-tcl"},
+    {"toml", "application/toml"},
+    {"torrent", "application/x-bittorrent"},
+    {"tr", "text/troff"},
+    // TypeScript, which the sample serves for script debugging, rather than an
+    // MPEG transport stream; those are .m2ts.
+    {"ts", "text/typescript"},
+    {"tsv", "text/tab-separated-values"},
+    {"tsx", "text/tsx"},
+    {"ttc", "font/collection"},
+    {"ttf", "font/ttf"},
+    {"ttl", "text/turtle"},
+    {"txt", "text/plain"},
+    {"udeb", "application/x-debian-package"},
+    {"uri", "text/uri-list"},
+    {"uris", "text/uri-list"},
+    {"urls", "text/uri-list"},
+    {"ustar", "application/x-ustar"},
+    {"vcard", "text/vcard"},
+    {"vcf", "text/x-vcard"},
+    {"vcs", "text/x-vcalendar"},
+    {"vob", "video/x-ms-vob"},
+    {"vsd", "application/vnd.visio"},
+    {"vsdx", "application/vnd.ms-visio.drawing"},
+    {"vtt", "text/vtt"},
+    {"war", "application/java-archive"},
+    {"wasm", "application/wasm"},
+    {"wav", "audio/wav"},
+    {"wbmp", "image/vnd.wap.wbmp"},
+    {"weba", "audio/webm"},
+    {"webm", "video/webm"},
+    {"webmanifest", "application/manifest+json"},
+    {"webp", "image/webp"},
+    {"wgt", "application/widget"},
+    {"wm", "video/x-ms-wm"},
+    {"wma", "audio/x-ms-wma"},
+    {"wmf", "image/wmf"},
+    {"wml", "text/vnd.wap.wml"},
+    {"wmlc", "application/vnd.wap.wmlc"},
+    {"wmls", "text/vnd.wap.wmlscript"},
+    {"wmv", "video/x-ms-wmv"},
+    {"wmx", "video/x-ms-wmx"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"wpd", "application/vnd.wordperfect"},
+    {"wps", "application/vnd.ms-works"},
+    {"wri", "application/x-mswrite"},
+    {"wsdl", "application/wsdl+xml"},
+    {"wvx", "video/x-ms-wvx"},
+    {"x3d", "model/x3d+xml"},
+    {"xaml", "application/xaml+xml"},
+    {"xap", "application/x-silverlight-app"},
+    {"xbm", "image/x-xbitmap"},
+    {"xdf", "application/xcap-diff+xml"},
+    {"xhr", "text/plain"},
+    {"xht", "application/xhtml+xml"},
+    {"xhtml", "application/xhtml+xml"},
+    {"xla", "application/vnd.ms-excel"},
+    {"xlc", "application/vnd.ms-excel"},
+    {"xlm", "application/vnd.ms-excel"},
+    {"xls", "application/vnd.ms-excel"},
+    {"xlsb", "application/vnd.ms-excel.sheet.binary.macroenabled.12"},
+    {"xlsm", "application/vnd.ms-excel.sheet.macroenabled.12"},
+    {"xlsx", "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"},
+    {"xlt", "application/vnd.ms-excel"},
+    {"xltx", "application/vnd.openxmlformats-officedocument.spreadsheetml.template"},
+    {"xml", "application/xml"},
+    {"xpi", "application/x-xpinstall"},
+    {"xpm", "image/x-xpixmap"},
+    {"xps", "application/vnd.ms-xpsdocument"},
+    {"xsd", "application/xml"},
+    {"xsl", "application/xml"},
+    {"xslt", "application/xslt+xml"},
+    {"xspf", "application/xspf+xml"},
+    {"xul", "application/vnd.mozilla.xul+xml"},
+    {"xwd", "image/x-xwindowdump"},
+    {"xz", "application/x-xz"},
+    {"yaml", "application/yaml"},
+    {"yml", "application/yaml"},
+    {"z", "application/x-compress"},
+    {"zip", "application/zip"},
+    {"zst", "application/zstd"},
+};
+
+constexpr size_t c_mimeTypeCount = sizeof(c_mimeTypes) / sizeof(c_mimeTypes[0]);
+// Longer extensions aren't hashed, since no extension in the table is.
+constexpr size_t c_maxExtensionSize = 16;
+// Powers of two. Keys are spread over the buckets by one hash, and each bucket
+// has a displacement that moves all of its keys into free slots by another.
+constexpr uint32_t c_bucketCount = 256;
+constexpr uint32_t c_slotCount = 1024;
+constexpr uint32_t c_maxDisplacement = 0xFFFF;
+constexpr uint32_t c_maxBucketSize = 8;
+
+static_assert(c_mimeTypeCount < c_slotCount / 2, "Grow c_slotCount with the table");
+
+constexpr char FoldAsciiCase(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// FNV-1a of the lowercased extension. Returns 0, which no extension in the
+// table hashes to, for one that is too long or isn't ASCII.
+template <typename Char> constexpr uint64_t HashExtension(const Char* extension, size_t size)
+{
+    if (size == 0 || size > c_maxExtensionSize)
+    {
+        return 0;
+    }
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        uint32_t c = static_cast<uint32_t>(extension[i]);
+        if (c > 0x7F)
+        {
+            return 0;
+        }
+        hash = (hash ^ static_cast<uint8_t>(FoldAsciiCase(static_cast<char>(c)))) *
+               0x100000001b3ull;
+    }
+    return hash;
+}
+
+// The murmur3 finalizer, so that every bit of the hash moves the result.
+constexpr uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+constexpr uint32_t GetBucket(uint64_t hash)
+{
+    return static_cast<uint32_t>(Mix(hash) >> 32) & (c_bucketCount - 1);
+}
+
+constexpr uint32_t GetSlot(uint64_t hash, uint32_t displacement)
+{
+    return static_cast<uint32_t>(Mix(hash + displacement * 0x9e3779b97f4a7c15ull)) &
+           (c_slotCount - 1);
+}
+
+struct MimeTypeTable
+{
+    uint16_t displacements[c_bucketCount];
+    // Index into c_mimeTypes plus one, or 0 for a free slot.
+    uint16_t slots[c_slotCount];
+    bool built;
+};
+
+constexpr MimeTypeTable BuildMimeTypeTable()
+{
+    MimeTypeTable table{};
+    uint64_t hashes[c_mimeTypeCount]{};
+    // The keys of each bucket, counting-sorted: bucket b's are
+    // members[starts[b]] up to members[starts[b + 1]].
+    uint32_t starts[c_bucketCount + 1]{};
+    uint16_t members[c_mimeTypeCount]{};
+    uint32_t largestBucket = 0;
+    for (size_t i = 0; i < c_mimeTypeCount; ++i)
+    {
+        const std::string_view& extension = c_mimeTypes[i].extension;
+        hashes[i] = HashExtension(extension.data(), extension.size());
+        if (hashes[i] == 0)
+        {
+            return table;
+        }
+        ++starts[GetBucket(hashes[i]) + 1];
+    }
+    for (uint32_t b = 0; b < c_bucketCount; ++b)
+    {
+        uint32_t size = starts[b + 1];
+        largestBucket = size > largestBucket ? size : largestBucket;
+        starts[b + 1] += starts[b];
+    }
+    if (largestBucket > c_maxBucketSize)
+    {
+        return table;
+    }
+    uint32_t filled[c_bucketCount]{};
+    for (size_t i = 0; i < c_mimeTypeCount; ++i)
+    {
+        uint32_t bucket = GetBucket(hashes[i]);
+        members[starts[bucket] + filled[bucket]++] = static_cast<uint16_t>(i);
+    }
+
+    // Place the largest buckets first, while most slots are free.
+    for (uint32_t size = largestBucket; size > 0; --size)
+    {
+        for (uint32_t b = 0; b < c_bucketCount; ++b)
+        {
+            if (starts[b + 1] - starts[b] != size)
+            {
+                continue;
+            }
+            uint32_t displacement = 0;
+            for (;; ++displacement)
+            {
+                if (displacement > c_maxDisplacement)
+                {
+                    // Two extensions are the same.
+                    return table;
+                }
+                uint32_t slots[c_maxBucketSize]{};
+                bool fits = true;
+                for (uint32_t k = 0; k < size && fits; ++k)
+                {
+                    slots[k] = GetSlot(hashes[members[starts[b] + k]], displacement);
+                    fits = table.slots[slots[k]] == 0;
+                    for (uint32_t j = 0; j < k && fits; ++j)
+                    {
+                        fits = slots[j] != slots[k];
+                    }
+                }
+                if (fits)
+                {
+                    for (uint32_t k = 0; k < size; ++k)
+                    {
+                        table.slots[slots[k]] = members[starts[b] + k] + 1;
+                    }
+                    break;
+                }
+            }
+            table.displacements[b] = static_cast<uint16_t>(displacement);
+        }
+    }
+    table.built = true;
+    return table;
+}
+
+constexpr MimeTypeTable c_mimeTypeTable = BuildMimeTypeTable();
+static_assert(
+    c_mimeTypeTable.built,
+    "c_mimeTypes has an extension twice or one that isn't ASCII, or needs more buckets");
+
+template <typename Char> std::string_view FindMimeType(const Char* extension, size_t size)
+{
+    uint64_t hash = HashExtension(extension, size);
+    if (hash == 0)
+    {
+        return {};
+    }
+    uint32_t displacement = c_mimeTypeTable.displacements[GetBucket(hash)];
+    uint16_t slot = c_mimeTypeTable.slots[GetSlot(hash, displacement)];
+    if (slot == 0)
+    {
+        return {};
+    }
+    const MimeType& mimeType = c_mimeTypes[slot - 1];
+    if (mimeType.extension.size() != size)
+    {
+        return {};
+    }
+    for (size_t i = 0; i < size; ++i)
+    {
+        // Extensions in the table are ASCII, and the hash checked that this is.
+        if (mimeType.extension[i] != FoldAsciiCase(static_cast<char>(extension[i])))
+        {
+            return {};
+        }
+    }
+    return mimeType.type;
+}
+
+template <typename Char> std::string_view FindMimeTypeForPath(std::basic_string_view<Char> path)
+{
+    // The extension runs from the last '.' of the last segment to the end, or
+    // to the query or fragment.
+    size_t end = 0;
+    while (end < path.size() && path[end] != '?' && path[end] != '#')
+    {
+        ++end;
+    }
+    for (size_t dot = end; dot > 0; --dot)
+    {
+        Char c = path[dot - 1];
+        if (c == '.')
+        {
+            return FindMimeType(path.data() + dot, end - dot);
+        }
+        if (c == '/' || c == '\\')
+        {
+            break;
+        }
+    }
+    return {};
+}
+} // namespace
+
+std::string_view GetMimeTypeForExtension(std::string_view extension)
+{
+    return FindMimeType(extension.data(), extension.size());
+}
+
+std::string_view GetMimeTypeForExtension(std::wstring_view extension)
+{
+    return FindMimeType(extension.data(), extension.size());
+}
+
+std::string_view GetMimeTypeForPath(std::string_view path)
+{
+    return FindMimeTypeForPath(path);
+}
+
+std::string_view GetMimeTypeForPath(std::wstring_view path)
+{
+    return FindMimeTypeForPath(path);
+}
+
+std::wstring GetContentTypeHeader(std::wstring_view path)
+{
+    std::string_view type = GetMimeTypeForPath(path);
+    if (type.empty())
+    {
+        type = "application/octet-stream";
+    }
+    std::wstring header = L"Content-Type: ";
+    header.append(type.begin(), type.end());
+    return header;
+}
@@ -0,0 +1,28 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Looks up the MIME type to serve a file with by its extension, for the
+// Content-Type of web resource responses. The extensions are in a perfect-hash
+// table that is built at compile time, so a lookup hashes the extension once,
+// reads two array elements and compares one string, in any case and without
+// allocating.
+
+// The MIME type for an extension without its dot, such as "html" or "PNG", or
+// an empty string if it isn't known.
+std::string_view GetMimeTypeForExtension(std::string_view extension);
+std::string_view GetMimeTypeForExtension(std::wstring_view extension);
+
+// The MIME type for the extension of the last segment of a path or URL, which
+// may have a query and fragment, or an empty string if it isn't known.
+std::string_view GetMimeTypeForPath(std::string_view path);
+std::string_view GetMimeTypeForPath(std::wstring_view path);
+
+// "Content-Type: " and the MIME type for path, or application/octet-stream if
+// it isn't known, for the headers of CreateWebResourceResponse.
+std::wstring GetContentTypeHeader(std::wstring_view path);
@@ -0,0 +1,53 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MonitorEvent.h"
+
+const wchar_t* MonitorEventKindToString(MonitorEventKind kind)
+{
+    switch (kind)
+    {
+#define KIND_ENTRY(kindValue)                                                                  \
+    case MonitorEventKind::kindValue:                                                          \
+        return L"" #kindValue;
+
+        KIND_ENTRY(NavigationStarting);
+        KIND_ENTRY(FrameNavigationStarting);
+        KIND_ENTRY(SourceChanged);
+        KIND_ENTRY(ContentLoading);
+        KIND_ENTRY(HistoryChanged);
+        KIND_ENTRY(NavigationCompleted);
+        KIND_ENTRY(FrameNavigationCompleted);
+        KIND_ENTRY(DOMContentLoaded);
+        KIND_ENTRY(DocumentTitleChanged);
+        KIND_ENTRY(WebMessageReceived);
+        KIND_ENTRY(NewWindowRequested);
+        KIND_ENTRY(WebResourceRequested);
+        KIND_ENTRY(WebResourceResponseReceived);
+        KIND_ENTRY(DownloadStarting);
+        KIND_ENTRY(DownloadStateChanged);
+        KIND_ENTRY(DownloadBytesReceivedChanged);
+        KIND_ENTRY(DownloadEstimatedEndTimeChanged);
+        KIND_ENTRY(FrameCreated);
+        KIND_ENTRY(GotFocus);
+        KIND_ENTRY(LostFocus);
+        KIND_ENTRY(IsDefaultDownloadDialogOpenChanged);
+        KIND_ENTRY(PermissionRequested);
+
+#undef KIND_ENTRY
+
+    case MonitorEventKind::CoreWebView2FrameDestroyed:
+        return L"CoreWebView2Frame::Destroyed";
+    case MonitorEventKind::CoreWebView2FrameNavigationStarting:
+        return L"CoreWebView2Frame::NavigationStarting";
+    case MonitorEventKind::CoreWebView2FrameContentLoading:
+        return L"CoreWebView2Frame::ContentLoading";
+    case MonitorEventKind::CoreWebView2FrameNavigationCompleted:
+        return L"CoreWebView2Frame::NavigationCompleted";
+    case MonitorEventKind::CoreWebView2FrameDOMContentLoaded:
+        return L"CoreWebView2Frame::DOMContentLoaded";
+    default:
+        return nullptr;
+    }
+}
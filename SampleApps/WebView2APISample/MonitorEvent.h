@@ -0,0 +1,87 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdint>
+
+// The compact binary form in which ScenarioWebViewEventMonitor records events.
+// Strings are stored as StringInterner ids; JSON is only produced when the
+// event view asks for a range of events.
+
+enum class MonitorEventKind : uint16_t
+{
+    NavigationStarting,
+    FrameNavigationStarting,
+    SourceChanged,
+    ContentLoading,
+    HistoryChanged,
+    NavigationCompleted,
+    FrameNavigationCompleted,
+    DOMContentLoaded,
+    DocumentTitleChanged,
+    WebMessageReceived,
+    NewWindowRequested,
+    WebResourceRequested,
+    WebResourceResponseReceived,
+    DownloadStarting,
+    DownloadStateChanged,
+    DownloadBytesReceivedChanged,
+    DownloadEstimatedEndTimeChanged,
+    FrameCreated,
+    GotFocus,
+    LostFocus,
+    IsDefaultDownloadDialogOpenChanged,
+    PermissionRequested,
+    // Events of ICoreWebView2Frame.
+    CoreWebView2FrameDestroyed,
+    CoreWebView2FrameNavigationStarting,
+    CoreWebView2FrameContentLoading,
+    CoreWebView2FrameNavigationCompleted,
+    CoreWebView2FrameDOMContentLoaded,
+    Count
+};
+
+// The event name shown in the event view, or nullptr for an unknown kind.
+const wchar_t* MonitorEventKindToString(MonitorEventKind kind);
+
+// Bits of MonitorEventRecord::flags. Which of the event-specific bits are
+// meaningful depends on the kind.
+enum MonitorEventFlags : uint16_t
+{
+    // The record has title, source, canGoBack and canGoForward of the WebView.
+    c_monitorEventHasWebView = 1 << 0,
+    c_monitorEventCanGoBack = 1 << 1,
+    c_monitorEventCanGoForward = 1 << 2,
+    c_monitorEventCancel = 1 << 3,
+    c_monitorEventIsRedirected = 1 << 4,
+    c_monitorEventIsUserInitiated = 1 << 5,
+    c_monitorEventIsErrorPage = 1 << 6,
+    c_monitorEventIsSuccess = 1 << 7,
+    // WebResource events: the request has a body.
+    c_monitorEventHasContent = 1 << 8,
+    // WebResourceRequested: value holds the request source kind.
+    c_monitorEventHasSource = 1 << 9,
+};
+
+struct MonitorEventRecord
+{
+    // steady_clock ticks when the event handler ran.
+    int64_t timestamp;
+    uint64_t navigationId;
+    // Kind specific: the web error status, HTTP status code, request source kind...
+    int64_t value;
+    uint32_t uriId;
+    // JSON array of the request headers.
+    uint32_t headersId;
+    // Kind specific JSON: the whole args object for rarely fired events, the
+    // request method for WebResource events.
+    uint32_t argsId;
+    // Kind specific JSON: the response object for WebResourceResponseReceived.
+    uint32_t detailId;
+    uint32_t titleId;
+    uint32_t sourceId;
+    MonitorEventKind kind;
+    uint16_t flags;
+};
@@ -10,6 +10,7 @@
 
 #include "ProcessComponent.h"
 #include "CheckFailure.h"
+#include "Url.h"
 
 using namespace Microsoft::WRL;
 
@@ -154,14 +155,15 @@ ProcessComponent::ProcessComponent(AppWindow* appWindow)
 // static
 bool ProcessComponent::IsAppContentUri(const std::wstring& source)
 {
-    wil::com_ptr<IUri> uri;
-    CHECK_FAILURE(CreateUri(source.c_str(), Uri_CREATE_CANONICALIZE, 0, &uri));
-    wil::unique_bstr domain;
-    CHECK_FAILURE(uri->GetDomain(&domain));
+    Url url;
+    if (!url.Parse(source))
+    {
+        return false;
+    }
 
     // Content from our app uses a mapped host name.
-    const std::wstring mappedAppHostName = L"appassets.example";
-    return domain.get() == mappedAppHostName;
+    const std::string_view mappedAppHostName = "appassets.example";
+    return GetUrlSite(url.GetHost()) == mappedAppHostName;
 }
 
 bool ProcessComponent::HandleWindowMessage(
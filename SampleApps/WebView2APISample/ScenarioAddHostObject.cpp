@@ -11,18 +11,24 @@
 #include "AppWindow.h"
 #include "CheckFailure.h"
 #include "HostObjectSampleImpl.h"
+#include "Url.h"
 
 using namespace Microsoft::WRL;
 
-bool AreFileUrisEqual (std::wstring leftUri, std::wstring rightUri)
+bool AreFileUrisEqual(std::wstring_view leftUri, std::wstring_view rightUri)
 {
-    // Have to to lower due to current bug
-    std::transform(leftUri.begin(), leftUri.end(),
-            leftUri.begin(), ::tolower);
-    std::transform(rightUri.begin(), rightUri.end(),
-            rightUri.begin(), ::tolower);
-
-    return leftUri == rightUri;
+    // The target is the URI as the WebView has it, so the sample URI is
+    // normalized the same way before the paths are compared without case.
+    Url left;
+    Url right;
+    if (!left.Parse(leftUri) || !right.Parse(rightUri))
+    {
+        return false;
+    }
+    return std::equal(
+        left.GetHref().begin(), left.GetHref().end(), right.GetHref().begin(),
+        right.GetHref().end(),
+        [](char a, char b) { return ::tolower(a) == ::tolower(b); });
 }
 
 ScenarioAddHostObject::ScenarioAddHostObject(AppWindow* appWindow)
@@ -6,20 +6,18 @@
 #include "ScenarioCustomScheme.h"
 
 #include "AppWindow.h"
+#include "AssetComStream.h"
 #include "CheckFailure.h"
 
-#include <Shlwapi.h>
-
 using namespace Microsoft::WRL;
 
-ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow) : m_appWindow(appWindow)
+ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow)
+    : m_appWindow(appWindow),
+      m_webResourceRequestedDispatcher(appWindow->GetWebResourceRequestedDispatcher())
 {
-    m_appWindow->GetWebView()->QueryInterface(IID_PPV_ARGS(&m_webView2_22));
-    CHECK_FEATURE_RETURN_EMPTY(m_webView2_22);
-    CHECK_FAILURE(m_webView2_22->AddWebResourceRequestedFilterWithRequestSourceKinds(
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Add(
         L"custom-scheme*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT));
-    CHECK_FAILURE(m_appWindow->GetWebView()->add_WebResourceRequested(
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT,
         Callback<ICoreWebView2WebResourceRequestedEventHandler>(
             [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
             {
@@ -32,18 +30,11 @@ ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow) : m_appWindow(a
                 {
                     std::wstring assetsFilePath = L"assets/";
                     assetsFilePath += wcsstr(uri.get(), L":") + 1;
-                    wil::com_ptr<IStream> stream;
-                    SHCreateStreamOnFileEx(
-                        assetsFilePath.c_str(), STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE,
-                        nullptr, &stream);
-                    if (stream)
+                    // The file is read from disk once, and then served from memory.
+                    if (SUCCEEDED(CreateAssetResponse(
+                            m_appWindow->GetWebViewEnvironment(), assetsFilePath, request.get(),
+                            L"Access-Control-Allow-Origin: *", &response)))
                     {
-                        CHECK_FAILURE(
-                            m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
-                                stream.get(), 200, L"OK",
-                                L"Content-Type: application/json\nAccess-Control-Allow-Origin: "
-                                L"*",
-                                &response));
                         CHECK_FAILURE(args->put_Response(response.get()));
                     }
                     else
@@ -107,6 +98,5 @@ ScenarioCustomScheme::ScenarioCustomScheme(AppWindow* appWindow) : m_appWindow(a
 
 ScenarioCustomScheme::~ScenarioCustomScheme()
 {
-    CHECK_FAILURE(
-        m_appWindow->GetWebView()->remove_WebResourceRequested(m_webResourceRequestedToken));
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Remove(m_webResourceRequestedToken));
 }
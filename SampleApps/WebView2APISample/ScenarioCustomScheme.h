@@ -5,6 +5,7 @@
 #pragma once
 #include "stdafx.h"
 
+#include <memory>
 #include <string>
 
 #include "AppWindow.h"
@@ -20,7 +21,6 @@ private:
     EventRegistrationToken m_webResourceRequestedToken = {};
     EventRegistrationToken m_navigationCompletedToken = {};
 
-    wil::com_ptr<ICoreWebView2_22> m_webView2_22;
-
     AppWindow* m_appWindow = nullptr;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
 };
@@ -6,21 +6,18 @@
 #include "ScenarioCustomSchemeNavigate.h"
 
 #include "AppWindow.h"
+#include "AssetComStream.h"
 #include "CheckFailure.h"
 
-#include <Shlwapi.h>
-
 using namespace Microsoft::WRL;
 
 ScenarioCustomSchemeNavigate::ScenarioCustomSchemeNavigate(AppWindow* appWindow)
-    : m_appWindow(appWindow)
+    : m_appWindow(appWindow),
+      m_webResourceRequestedDispatcher(appWindow->GetWebResourceRequestedDispatcher())
 {
-    m_appWindow->GetWebView()->QueryInterface(IID_PPV_ARGS(&m_webView2_22));
-    CHECK_FEATURE_RETURN_EMPTY(m_webView2_22);
-    CHECK_FAILURE(m_webView2_22->AddWebResourceRequestedFilterWithRequestSourceKinds(
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Add(
         L"wv2rocks*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT));
-    CHECK_FAILURE(m_appWindow->GetWebView()->add_WebResourceRequested(
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT,
         Callback<ICoreWebView2WebResourceRequestedEventHandler>(
             [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
             {
@@ -38,46 +35,11 @@ ScenarioCustomSchemeNavigate::ScenarioCustomSchemeNavigate(AppWindow* appWindow)
                     std::wstring assetsFilePath = L"assets/";
                     assetsFilePath +=
                         wcsstr(uri.get(), L"://domain/") + ARRAYSIZE(L"://domain/") - 1;
-                    wil::com_ptr<IStream> stream;
-                    SHCreateStreamOnFileEx(
-                        assetsFilePath.c_str(), STGM_READ, FILE_ATTRIBUTE_NORMAL, FALSE,
-                        nullptr, &stream);
-                    if (stream)
+                    // The file is read from disk once, and then served from memory.
+                    if (SUCCEEDED(CreateAssetResponse(
+                            m_appWindow->GetWebViewEnvironment(), assetsFilePath, request.get(),
+                            L"", &response)))
                     {
-                        std::wstring headers;
-                        if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) ==
-                            L"html")
-                        {
-                            headers = L"Content-Type: text/html";
-                        }
-                        else if (
-                            assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) ==
-                            L"jpg")
-                        {
-                            headers = L"Content-Type: image/jpeg";
-                        }
-                        else if (
-                            assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) ==
-                            L"png")
-                        {
-                            headers = L"Content-Type: image/png";
-                        }
-                        else if (
-                            assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) ==
-                            L"css")
-                        {
-                            headers = L"Content-Type: text/css";
-                        }
-                        else if (
-                            assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) ==
-                            L"js")
-                        {
-                            headers = L"Content-Type: application/javascript";
-                        }
-
-                        CHECK_FAILURE(
-                            m_appWindow->GetWebViewEnvironment()->CreateWebResourceResponse(
-                                stream.get(), 200, L"OK", headers.c_str(), &response));
                         CHECK_FAILURE(args->put_Response(response.get()));
                     }
                     else
@@ -100,6 +62,5 @@ ScenarioCustomSchemeNavigate::ScenarioCustomSchemeNavigate(AppWindow* appWindow)
 
 ScenarioCustomSchemeNavigate::~ScenarioCustomSchemeNavigate()
 {
-    CHECK_FAILURE(
-        m_appWindow->GetWebView()->remove_WebResourceRequested(m_webResourceRequestedToken));
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Remove(m_webResourceRequestedToken));
 }
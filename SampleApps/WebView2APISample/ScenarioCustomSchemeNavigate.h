@@ -5,6 +5,7 @@
 #pragma once
 #include "stdafx.h"
 
+#include <memory>
 #include <string>
 
 #include "AppWindow.h"
@@ -21,6 +22,5 @@ private:
     EventRegistrationToken m_navigationCompletedToken = {};
 
     AppWindow* m_appWindow = nullptr;
-
-    wil::com_ptr<ICoreWebView2_22> m_webView2_22;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
 };
@@ -7,6 +7,7 @@
 
 #include "AppWindow.h"
 #include "CheckFailure.h"
+#include "Url.h"
 
 #include <string>
 
@@ -14,8 +15,6 @@ using namespace Microsoft::WRL;
 
 static constexpr WCHAR c_samplePath[] = L"ScenarioFileSystemHandleShare.html";
 
-extern wil::unique_bstr GetDomainOfUri(PWSTR uri);
-
 //! [PostWebMessageWithAdditionalObjects]
 ScenarioFileSystemHandleShare::ScenarioFileSystemHandleShare(AppWindow* appWindow)
     : m_appWindow(appWindow)
@@ -50,11 +49,11 @@ ScenarioFileSystemHandleShare::ScenarioFileSystemHandleShare(AppWindow* appWindo
                 wil::unique_cotaskmem_string source;
                 CHECK_FAILURE(m_webView->get_Source(&source));
 
-                static const wchar_t* expectedDomain = L"appassets.example";
-                wil::unique_bstr sourceDomain = GetDomainOfUri(source.get());
+                static const std::string_view expectedDomain = "appassets.example";
+                Url sourceUrl;
 
                 // Check the source to ensure the message is sent to the correct target content.
-                if (std::wstring(expectedDomain) == sourceDomain.get())
+                if (sourceUrl.Parse(source.get()) && sourceUrl.GetHost() == expectedDomain)
                 {
                     CHECK_FAILURE(webview23->PostWebMessageAsJsonWithAdditionalObjects(
                         L"{ \"messageType\" : \"RootDirectoryHandle\" }",
@@ -6,24 +6,24 @@
 #include "ScenarioSharedWorkerWRR.h"
 
 #include "AppWindow.h"
+#include "AssetComStream.h"
 #include "CheckFailure.h"
 
-#include <Shlwapi.h>
-
 using namespace Microsoft::WRL;
 
 ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
-    : m_webView(appWindow->GetWebView())
+    : m_webView(appWindow->GetWebView()),
+      m_webResourceRequestedDispatcher(appWindow->GetWebResourceRequestedDispatcher())
 {
     //! [WebResourceRequested2]
     wil::com_ptr<ICoreWebView2_22> webView = m_webView.try_query<ICoreWebView2_22>();
     if (webView)
     {
-        // Filter must be added for application to receive any WebResourceRequested event
-        CHECK_FAILURE(webView->AddWebResourceRequestedFilterWithRequestSourceKinds(
+        // The dispatcher adds the filter, which the application needs to receive
+        // any WebResourceRequested event, and only runs this handler for it.
+        CHECK_FAILURE(m_webResourceRequestedDispatcher->Add(
             L"*worker.js", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL));
-        CHECK_FAILURE(m_webView->add_WebResourceRequested(
+            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL,
             Callback<ICoreWebView2WebResourceRequestedEventHandler>(
                 [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
                 {
@@ -39,10 +39,9 @@ ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
                         if (requestSourceKind ==
                             COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SHARED_WORKER)
                         {
-                            Microsoft::WRL::ComPtr<IStream> response_stream;
-                            CHECK_FAILURE(SHCreateStreamOnFileEx(
-                                L"assets/DemoWorker.js", STGM_READ, FILE_ATTRIBUTE_NORMAL,
-                                FALSE, nullptr, &response_stream));
+                            const std::wstring workerPath = L"assets/DemoWorker.js";
+                            Microsoft::WRL::ComPtr<ICoreWebView2WebResourceRequest> request;
+                            CHECK_FAILURE(args->get_Request(&request));
 
                             Microsoft::WRL::ComPtr<ICoreWebView2WebResourceResponse> response;
                             // Get the default webview environment
@@ -51,8 +50,8 @@ ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
 
                             Microsoft::WRL::ComPtr<ICoreWebView2Environment> environment;
                             CHECK_FAILURE(webview2->get_Environment(&environment));
-                            CHECK_FAILURE(environment->CreateWebResourceResponse(
-                                response_stream.Get(), 200, L"OK", L"", &response));
+                            CHECK_FAILURE(CreateAssetResponse(
+                                environment.Get(), workerPath, request.Get(), L"", &response));
 
                             CHECK_FAILURE(args->put_Response(response.Get()));
                         }
@@ -70,12 +69,5 @@ ScenarioSharedWorkerWRR::ScenarioSharedWorkerWRR(AppWindow* appWindow)
 
 ScenarioSharedWorkerWRR::~ScenarioSharedWorkerWRR()
 {
-    wil::com_ptr<ICoreWebView2_22> webView = m_webView.try_query<ICoreWebView2_22>();
-    if (webView)
-    {
-        CHECK_FAILURE(webView->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
-            L"*worker.js", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL));
-    }
-    CHECK_FAILURE(m_webView->remove_WebResourceRequested(m_webResourceRequestedToken));
+    CHECK_FAILURE(m_webResourceRequestedDispatcher->Remove(m_webResourceRequestedToken));
 }
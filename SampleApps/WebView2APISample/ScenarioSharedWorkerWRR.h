@@ -5,6 +5,7 @@
 #pragma once
 #include "stdafx.h"
 
+#include <memory>
 #include <string>
 
 #include "AppWindow.h"
@@ -20,4 +21,5 @@ private:
     EventRegistrationToken m_webResourceRequestedToken = {};
 
     wil::com_ptr<ICoreWebView2> m_webView;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
 };
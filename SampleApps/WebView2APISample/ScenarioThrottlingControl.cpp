@@ -7,7 +7,7 @@
 #include "ScenarioThrottlingControl.h"
 
 #include "CheckFailure.h"
-#include "ScriptComponent.h"
+#include "JsonReader.h"
 
 using namespace Microsoft::WRL;
 
@@ -164,11 +164,17 @@ void ScenarioThrottlingControl::WebViewMessageReceived(
     wil::unique_cotaskmem_string json;
     CHECK_FAILURE(args->get_WebMessageAsJson(&json));
 
-    auto command = GetJSONStringField(json.get(), L"command");
+    JsonDocument message;
+    if (!message.Parse(json.get()))
+    {
+        return;
+    }
+    JsonValue params = message.GetRoot()[L"params"];
+    auto command = message.GetRoot()[L"command"].GetStringOr();
     if (command.compare(L"set-interval") == 0)
     {
-        auto category = GetJSONStringField(json.get(), L"priority");
-        auto interval = GetJSONStringField(json.get(), L"intervalMs");
+        auto category = params[L"priority"].GetStringOr();
+        auto interval = std::wstring(params[L"intervalMs"].GetStringOr());
 
         wil::com_ptr<ICoreWebView2Settings> settings;
         m_webview->get_Settings(&settings);
@@ -199,7 +205,7 @@ void ScenarioThrottlingControl::WebViewMessageReceived(
     }
     else if (command.compare(L"scenario") == 0)
     {
-        auto label = GetJSONStringField(json.get(), L"label");
+        auto label = params[L"label"].GetStringOr();
         if (label.compare(L"interaction-throttle") == 0)
         {
             OnNoUserInteraction();
@@ -1,1281 +1,1710 @@
-// Copyright (C) Microsoft Corporation. All rights reserved.
-// Use of this source code is governed by a BSD-style license that can be
-// found in the LICENSE file.
-
-#include "stdafx.h"
-
-#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING 1
-
-#include "AppWindow.h"
-#include "CheckFailure.h"
-#include "ScenarioPermissionManagement.h"
-#include "ScenarioWebViewEventMonitor.h"
-#include <WebView2.h>
-#include <codecvt>
-#include <locale>
-#include <regex>
-#include <string>
-
-using namespace Microsoft::WRL;
-using namespace std;
-
-static constexpr wchar_t c_samplePath[] = L"ScenarioWebViewEventMonitor.html";
-
-std::wstring WebResourceSourceToString(COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS source)
-{
-    switch (source)
-    {
-    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT:
-        return L"\"main\"";
-    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SHARED_WORKER:
-        return L"\"shared_worker\"";
-    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SERVICE_WORKER:
-        return L"\"service_worker\"";
-    default:
-        return L"\"unknown_source\"";
-    }
-}
-
-ScenarioWebViewEventMonitor::ScenarioWebViewEventMonitor(AppWindow* appWindowEventSource)
-    : m_appWindowEventSource(appWindowEventSource),
-      m_webviewEventSource(appWindowEventSource->GetWebView()),
-      m_controllerEventSource(appWindowEventSource->GetWebViewController())
-{
-    m_sampleUri = m_appWindowEventSource->GetLocalUri(c_samplePath);
-    m_appWindowEventView = new AppWindow(
-        IDM_CREATION_MODE_WINDOWED, appWindowEventSource->GetWebViewOption(),
-        m_sampleUri, appWindowEventSource->GetUserDataFolder(),
-        false, [this]() -> void { InitializeEventView(m_appWindowEventView->GetWebView()); });
-    // Delete this component when the event monitor window closes.
-    // Since this is a component of the event source window, it will automatically
-    // be deleted when the event source webview is closed.
-    m_appWindowEventView->SetOnAppWindowClosing([&]{
-        m_appWindowEventSource->DeleteComponent(this);
-    });
-    m_webviewEventSource2 = m_webviewEventSource.query<ICoreWebView2_2>();
-}
-
-ScenarioWebViewEventMonitor::~ScenarioWebViewEventMonitor()
-{
-    m_webviewEventSource->remove_NavigationStarting(m_navigationStartingToken);
-    m_webviewEventSource->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
-    m_webviewEventSource->remove_SourceChanged(m_sourceChangedToken);
-    m_webviewEventSource->remove_ContentLoading(m_contentLoadingToken);
-    m_webviewEventSource->remove_HistoryChanged(m_historyChangedToken);
-    m_webviewEventSource->remove_FrameNavigationCompleted(m_frameNavigationCompletedToken);
-    m_webviewEventSource->remove_NavigationCompleted(m_navigationCompletedToken);
-    m_webviewEventSource->remove_DocumentTitleChanged(m_documentTitleChangedToken);
-    m_webviewEventSource->remove_WebMessageReceived(m_webMessageReceivedToken);
-    m_webviewEventSource->remove_NewWindowRequested(m_newWindowRequestedToken);
-    m_webviewEventSource2->remove_DOMContentLoaded(m_DOMContentLoadedToken);
-    if (m_webviewEventSource4)
-    {
-        m_webviewEventSource4->remove_DownloadStarting(m_downloadStartingToken);
-        m_webviewEventSource4->remove_FrameCreated(m_frameCreatedToken);
-    }
-    m_controllerEventSource->remove_GotFocus(m_gotFocusToken);
-    m_controllerEventSource->remove_LostFocus(m_lostFocusToken);
-    EnableWebResourceRequestedEvent(false);
-    EnableWebResourceResponseReceivedEvent(false);
-
-    m_webviewEventView->remove_WebMessageReceived(m_eventViewWebMessageReceivedToken);
-    if (m_webViewEventSource9) {
-        m_webViewEventSource9->remove_IsDefaultDownloadDialogOpenChanged(
-            m_isDefaultDownloadDialogOpenChangedToken);
-    }
-
-    // Clear our app window's reference to this.
-    m_appWindowEventView->SetOnAppWindowClosing(nullptr);
-}
-
-std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status)
-{
-    switch (status)
-    {
-#define STATUS_ENTRY(statusValue)                                                              \
-    case statusValue:                                                                          \
-        return L#statusValue;
-
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_COMMON_NAME_IS_INCORRECT);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_EXPIRED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CLIENT_CERTIFICATE_CONTAINS_ERRORS);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_REVOKED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_IS_INVALID);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_ERROR_HTTP_INVALID_SERVER_RESPONSE);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_RESET);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CANNOT_CONNECT);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_HOST_NAME_NOT_RESOLVED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_REDIRECT_FAILED);
-        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_UNEXPECTED_ERROR);
-
-#undef STATUS_ENTRY
-    }
-
-    return L"ERROR";
-}
-
-std::wstring BoolToString(BOOL value)
-{
-    return value ? L"true" : L"false";
-}
-
-std::wstring EncodeQuote(std::wstring raw)
-{
-    std::wstring encoded;
-    // Allocate 10 more chars to reduce memory re-allocation
-    // due to adding potential escaping chars.
-    encoded.reserve(raw.length() + 10);
-    encoded.push_back(L'"');
-    for (size_t i = 0; i < raw.length(); ++i)
-    {
-        // Escape chars as listed in https://tc39.es/ecma262/#sec-json.stringify.
-        switch (raw[i])
-        {
-        case '\b':
-            encoded.append(L"\\b");
-            break;
-        case '\f':
-            encoded.append(L"\\f");
-            break;
-        case '\n':
-            encoded.append(L"\\n");
-            break;
-        case '\r':
-            encoded.append(L"\\r");
-            break;
-        case '\t':
-            encoded.append(L"\\t");
-            break;
-        case '\\':
-            encoded.append(L"\\\\");
-            break;
-        case '"':
-            encoded.append(L"\\\"");
-            break;
-        default:
-            encoded.push_back(raw[i]);
-        }
-    }
-    encoded.push_back(L'"');
-    return encoded;
-}
-
-//! [HttpRequestHeaderIterator]
-std::wstring RequestHeadersToJsonString(ICoreWebView2HttpRequestHeaders* requestHeaders)
-{
-    wil::com_ptr<ICoreWebView2HttpHeadersCollectionIterator> iterator;
-    CHECK_FAILURE(requestHeaders->GetIterator(&iterator));
-    BOOL hasCurrent = FALSE;
-    std::wstring result = L"[";
-
-    while (SUCCEEDED(iterator->get_HasCurrentHeader(&hasCurrent)) && hasCurrent)
-    {
-        wil::unique_cotaskmem_string name;
-        wil::unique_cotaskmem_string value;
-
-        CHECK_FAILURE(iterator->GetCurrentHeader(&name, &value));
-        result += L"{\"name\": " + EncodeQuote(name.get())
-            + L", \"value\": " + EncodeQuote(value.get()) + L"}";
-
-        BOOL hasNext = FALSE;
-        CHECK_FAILURE(iterator->MoveNext(&hasNext));
-        if (hasNext)
-        {
-            result += L", ";
-        }
-    }
-
-    return result + L"]";
-}
-//! [HttpRequestHeaderIterator]
-
-std::wstring ResponseHeadersToJsonString(ICoreWebView2HttpResponseHeaders* responseHeaders)
-{
-    wil::com_ptr<ICoreWebView2HttpHeadersCollectionIterator> iterator;
-    CHECK_FAILURE(responseHeaders->GetIterator(&iterator));
-    BOOL hasCurrent = FALSE;
-    std::wstring result = L"[";
-
-    while (SUCCEEDED(iterator->get_HasCurrentHeader(&hasCurrent)) && hasCurrent)
-    {
-        wil::unique_cotaskmem_string name;
-        wil::unique_cotaskmem_string value;
-
-        CHECK_FAILURE(iterator->GetCurrentHeader(&name, &value));
-        result += EncodeQuote(std::wstring(name.get()) + L": " + value.get());
-
-        BOOL hasNext = FALSE;
-        CHECK_FAILURE(iterator->MoveNext(&hasNext));
-        if (hasNext)
-        {
-            result += L", ";
-        }
-    }
-
-    return result + L"]";
-}
-
-std::wstring RequestToJsonString(ICoreWebView2WebResourceRequest* request)
-{
-    wil::com_ptr<IStream> content;
-    CHECK_FAILURE(request->get_Content(&content));
-    wil::com_ptr<ICoreWebView2HttpRequestHeaders> headers;
-    CHECK_FAILURE(request->get_Headers(&headers));
-    wil::unique_cotaskmem_string method;
-    CHECK_FAILURE(request->get_Method(&method));
-    wil::unique_cotaskmem_string uri;
-    CHECK_FAILURE(request->get_Uri(&uri));
-
-    std::wstring result = L"{";
-
-    result += L"\"content\": ";
-    result += (content == nullptr ? L"null" : L"\"...\"");
-    result += L", ";
-
-    result += L"\"headers\": " + RequestHeadersToJsonString(headers.get()) + L", ";
-    result += L"\"method\": " + EncodeQuote(method.get()) + L", ";
-    result += L"\"uri\": " + EncodeQuote(uri.get()) + L" ";
-
-    result += L"}";
-
-    return result;
-}
-
-std::wstring GetPreviewOfContent(IStream* content, bool& readAll)
-{
-    char buffer[50];
-    unsigned long read;
-    content->Read(buffer, 50U, &read);
-    readAll = read < 50;
-
-    WCHAR converted[50];
-    CHECK_FAILURE(MultiByteToWideChar(CP_UTF8, MB_PRECOMPOSED, buffer, 50, converted, 50));
-    return std::wstring(converted);
-}
-
-std::wstring ResponseToJsonString(
-    ICoreWebView2WebResourceResponseView* response, IStream* content)
-{
-    wil::com_ptr<ICoreWebView2HttpResponseHeaders> headers;
-    CHECK_FAILURE(response->get_Headers(&headers));
-    int statusCode;
-    CHECK_FAILURE(response->get_StatusCode(&statusCode));
-    wil::unique_cotaskmem_string reasonPhrase;
-    CHECK_FAILURE(response->get_ReasonPhrase(&reasonPhrase));
-    BOOL containsContentType = FALSE;
-    headers->Contains(L"Content-Type", &containsContentType);
-    wil::unique_cotaskmem_string contentType;
-    bool isBinaryContent = true;
-    if (containsContentType)
-    {
-        headers->GetHeader(L"Content-Type", &contentType);
-        if (wcsncmp(L"text/", contentType.get(), ARRAYSIZE(L"text/")) == 0)
-        {
-            isBinaryContent = false;
-        }
-    }
-    std::wstring result = L"{";
-
-    result += L"\"content\": ";
-    if (!content)
-    {
-        result += L"null";
-    }
-    else
-    {
-        if (isBinaryContent)
-        {
-            result += EncodeQuote(L"BINARY_DATA");
-        }
-        else
-        {
-            bool readAll = false;
-            result += EncodeQuote(GetPreviewOfContent(content, readAll));
-            if (!readAll)
-            {
-              result += L"...";
-            }
-        }
-    }
-    result += L", ";
-
-    result += L"\"headers\": " + ResponseHeadersToJsonString(headers.get()) + L", ";
-    result += L"\"status\": ";
-    WCHAR statusCodeString[4];
-    _itow_s(statusCode, statusCodeString, 4, 10);
-    result += statusCodeString;
-    result += L", ";
-    result += L"\"reason\": " + EncodeQuote(reasonPhrase.get()) + L" ";
-
-    result += L"}";
-
-    return result;
-}
-
-std::wstring WebViewPropertiesToJsonString(ICoreWebView2* webview)
-{
-    wil::unique_cotaskmem_string documentTitle;
-    CHECK_FAILURE(webview->get_DocumentTitle(&documentTitle));
-    wil::unique_cotaskmem_string source;
-    CHECK_FAILURE(webview->get_Source(&source));
-    BOOL canGoBack = FALSE;
-    CHECK_FAILURE(webview->get_CanGoBack(&canGoBack));
-    BOOL canGoForward = FALSE;
-    CHECK_FAILURE(webview->get_CanGoForward(&canGoForward));
-
-    std::wstring result = L", \"webview\": {"
-        L"\"documentTitle\": " + EncodeQuote(documentTitle.get()) + L", "
-        + L"\"source\": " + EncodeQuote(source.get()) + L", "
-        + L"\"canGoBack\": " + BoolToString(canGoBack) + L", "
-        + L"\"canGoForward\": " + BoolToString(canGoForward)
-        + L"}";
-
-    return result;
-}
-
-std::wstring NavigationStartingArgsToJsonString(
-    ICoreWebView2* webview, ICoreWebView2NavigationStartingEventArgs* args,
-    const std::wstring& eventName)
-{
-    BOOL cancel = FALSE;
-    CHECK_FAILURE(args->get_Cancel(&cancel));
-    BOOL isRedirected = FALSE;
-    CHECK_FAILURE(args->get_IsRedirected(&isRedirected));
-    BOOL isUserInitiated = FALSE;
-    CHECK_FAILURE(args->get_IsUserInitiated(&isUserInitiated));
-    wil::com_ptr<ICoreWebView2HttpRequestHeaders> requestHeaders;
-    CHECK_FAILURE(args->get_RequestHeaders(&requestHeaders));
-    wil::unique_cotaskmem_string uri;
-    CHECK_FAILURE(args->get_Uri(&uri));
-    UINT64 navigationId = 0;
-    CHECK_FAILURE(args->get_NavigationId(&navigationId));
-
-    std::wstring message =
-        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
-
-    message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
-
-    message += L"\"cancel\": " + BoolToString(cancel) + L", " + L"\"isRedirected\": " +
-               BoolToString(isRedirected) + L", " + L"\"isUserInitiated\": " +
-               BoolToString(isUserInitiated) + L", " + L"\"requestHeaders\": " +
-               RequestHeadersToJsonString(requestHeaders.get()) + L", " + L"\"uri\": " +
-               EncodeQuote(uri.get()) + L" " + L"}" + WebViewPropertiesToJsonString(webview) +
-               L"}";
-
-    return message;
-}
-
-std::wstring ContentLoadingArgsToJsonString(
-    ICoreWebView2* webview, ICoreWebView2ContentLoadingEventArgs* args,
-    const std::wstring& eventName)
-{
-    BOOL isErrorPage = FALSE;
-    CHECK_FAILURE(args->get_IsErrorPage(&isErrorPage));
-    UINT64 navigationId = 0;
-    CHECK_FAILURE(args->get_NavigationId(&navigationId));
-
-    std::wstring message =
-        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
-
-    message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
-    message += L"\"isErrorPage\": " + BoolToString(isErrorPage) + L"}" +
-               WebViewPropertiesToJsonString(webview) + L"}";
-    return message;
-}
-
-std::wstring NavigationCompletedArgsToJsonString(
-    ICoreWebView2* webview, ICoreWebView2NavigationCompletedEventArgs* args,
-    const std::wstring& eventName)
-{
-    BOOL isSuccess = FALSE;
-    CHECK_FAILURE(args->get_IsSuccess(&isSuccess));
-    COREWEBVIEW2_WEB_ERROR_STATUS webErrorStatus;
-    CHECK_FAILURE(args->get_WebErrorStatus(&webErrorStatus));
-    UINT64 navigationId = 0;
-    CHECK_FAILURE(args->get_NavigationId(&navigationId));
-
-    std::wstring message =
-        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
-
-    message += L"\"navigationId\": " + std::to_wstring(navigationId) + L", ";
-
-    message += L"\"isSuccess\": " + BoolToString(isSuccess) +
-               L", "
-               L"\"webErrorStatus\": " +
-               EncodeQuote(WebErrorStatusToString(webErrorStatus)) +
-               L" "
-               L"}" +
-               WebViewPropertiesToJsonString(webview) + L"}";
-    return message;
-}
-
-std::wstring DOMContentLoadedArgsToJsonString(
-    ICoreWebView2* webview, ICoreWebView2DOMContentLoadedEventArgs* args,
-    const std::wstring& eventName)
-{
-    UINT64 navigationId = 0;
-    CHECK_FAILURE(args->get_NavigationId(&navigationId));
-
-    std::wstring message =
-        L"{ \"kind\": \"event\", \"name\": \"" + eventName + L"\", \"args\": {";
-
-    message += L"\"navigationId\": " + std::to_wstring(navigationId);
-
-    message += L"}" + WebViewPropertiesToJsonString(webview) + L"}";
-    return message;
-}
-
-std::wstring WebResourceRequestedToJsonString(
-    ICoreWebView2WebResourceRequest* webResourceRequest,
-    const std::wstring& source = std::wstring())
-{
-    std::wstring message = L"{ \"kind\": \"event\", \"name\": "
-                           L"\"WebResourceRequested\", \"args\": {"
-                           L"\"request\": " +
-                           RequestToJsonString(webResourceRequest) +
-                           L", "
-                           L"\"response\": null" +
-                           source + L"}";
-
-    return message;
-}
-
-void ScenarioWebViewEventMonitor::EnableWebResourceResponseReceivedEvent(bool enable) {
-    if (!enable && m_webResourceResponseReceivedToken.value != 0)
-    {
-        m_webviewEventSource2->remove_WebResourceResponseReceived(m_webResourceResponseReceivedToken);
-        m_webResourceResponseReceivedToken.value = 0;
-    }
-    else if (enable && m_webResourceResponseReceivedToken.value == 0)
-    {
-        m_webviewEventSource2->add_WebResourceResponseReceived(
-            Callback<ICoreWebView2WebResourceResponseReceivedEventHandler>(
-                [this](ICoreWebView2* webview, ICoreWebView2WebResourceResponseReceivedEventArgs* args)
-                    -> HRESULT {
-                    wil::com_ptr<ICoreWebView2WebResourceRequest> webResourceRequest;
-                    CHECK_FAILURE(args->get_Request(&webResourceRequest));
-                    wil::com_ptr<ICoreWebView2WebResourceResponseView>
-                        webResourceResponse;
-                    CHECK_FAILURE(args->get_Response(&webResourceResponse));
-                    //! [GetContent]
-                    webResourceResponse->GetContent(
-                        Callback<
-                            ICoreWebView2WebResourceResponseViewGetContentCompletedHandler>(
-                            [this, webResourceRequest,
-                             webResourceResponse](HRESULT result, IStream* content) {
-                                std::wstring message =
-                                    L"{ \"kind\": \"event\", \"name\": "
-                                    L"\"WebResourceResponseReceived\", \"args\": {"
-                                    L"\"request\": " +
-                                    RequestToJsonString(webResourceRequest.get()) +
-                                    L", "
-                                    L"\"response\": " +
-                                    ResponseToJsonString(webResourceResponse.get(), content) +
-                                    L"}";
-
-                                message +=
-                                    WebViewPropertiesToJsonString(m_webviewEventSource.get());
-                                message += L"}";
-                                PostEventMessage(message);
-                                return S_OK;
-                            })
-                            .Get());
-                    //! [GetContent]
-                    return S_OK;
-                })
-                .Get(),
-            &m_webResourceResponseReceivedToken);
-    }
-}
-
-void ScenarioWebViewEventMonitor::EnableWebResourceRequestedEvent(bool enable)
-{
-    if (!enable && m_webResourceRequestedToken.value != 0)
-    {
-        m_webviewEventSource->remove_WebResourceRequested(m_webResourceRequestedToken);
-        m_webResourceRequestedToken.value = 0;
-    }
-    else if (enable && m_webResourceRequestedToken.value == 0)
-    {
-        auto webView2_22 = m_webviewEventSource.try_query<ICoreWebView2_22>();
-        if (webView2_22)
-        {
-            webView2_22->AddWebResourceRequestedFilterWithRequestSourceKinds(
-                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
-                COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL);
-        }
-
-        m_webviewEventSource->add_WebResourceRequested(
-            Callback<ICoreWebView2WebResourceRequestedEventHandler>(
-                [this](ICoreWebView2* webview, ICoreWebView2WebResourceRequestedEventArgs* args)
-                    -> HRESULT {
-                    wil::com_ptr<ICoreWebView2WebResourceRequest> webResourceRequest;
-                    CHECK_FAILURE(args->get_Request(&webResourceRequest));
-                    wil::com_ptr<ICoreWebView2WebResourceResponse> webResourceResponse;
-                    CHECK_FAILURE(args->get_Response(&webResourceResponse));
-
-                    std::wstring message =
-                        WebResourceRequestedToJsonString(webResourceRequest.get());
-
-                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs> argsPtr = args;
-                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2>
-                        webResourceRequestArgs =
-                            argsPtr.try_query<ICoreWebView2WebResourceRequestedEventArgs2>();
-                    if (webResourceRequestArgs)
-                    {
-                        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS requestedSourceKind =
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL;
-                        CHECK_FAILURE(webResourceRequestArgs->get_RequestedSourceKind(
-                            &requestedSourceKind));
-                        if (requestedSourceKind !=
-                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL)
-                        {
-                            std::wstring source = L", \"source\": " + WebResourceSourceToString(
-                                                                          requestedSourceKind);
-
-                            message = WebResourceRequestedToJsonString(
-                                webResourceRequest.get(), source);
-                        }
-                    }
-                    message += WebViewPropertiesToJsonString(m_webviewEventSource.get());
-                    message += L"}";
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            &m_webResourceRequestedToken);
-    }
-}
-
-void ScenarioWebViewEventMonitor::InitializeEventView(ICoreWebView2* webviewEventView)
-{
-    m_webviewEventView = webviewEventView;
-
-    m_webviewEventView->add_WebMessageReceived(
-        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
-                -> HRESULT {
-                wil::unique_cotaskmem_string source;
-                CHECK_FAILURE(args->get_Source(&source));
-                wil::unique_cotaskmem_string webMessageAsString;
-                if (SUCCEEDED(args->TryGetWebMessageAsString(&webMessageAsString)))
-                {
-                    if (wcscmp(source.get(), m_sampleUri.c_str()) == 0)
-                    {
-                        if (wcscmp(webMessageAsString.get(), L"webResourceRequested,on") == 0)
-                        {
-                            EnableWebResourceRequestedEvent(true);
-                        }
-                        else if (wcscmp(webMessageAsString.get(), L"webResourceRequested,off") == 0)
-                        {
-                            EnableWebResourceRequestedEvent(false);
-                        }
-                        else if (wcscmp(webMessageAsString.get(), L"webResourceResponseReceived,on") == 0)
-                        {
-                            EnableWebResourceResponseReceivedEvent(true);
-                        }
-                        else if (
-                            wcscmp(webMessageAsString.get(), L"webResourceResponseReceived,off") == 0)
-                        {
-                            EnableWebResourceResponseReceivedEvent(false);
-                        }
-                    }
-                }
-
-                return S_OK;
-            })
-            .Get(),
-        &m_eventViewWebMessageReceivedToken);
-
-    m_webviewEventSource->add_WebMessageReceived(
-        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
-                -> HRESULT {
-                wil::unique_cotaskmem_string source;
-                CHECK_FAILURE(args->get_Source(&source));
-                wil::unique_cotaskmem_string webMessageAsString;
-                HRESULT webMessageAsStringHR =
-                    args->TryGetWebMessageAsString(&webMessageAsString);
-                wil::unique_cotaskmem_string webMessageAsJson;
-                CHECK_FAILURE(args->get_WebMessageAsJson(&webMessageAsJson));
-
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"WebMessageReceived\", \"args\": {"
-                    L"\"source\": " + EncodeQuote(source.get()) + L", ";
-
-                if (SUCCEEDED(webMessageAsStringHR))
-                {
-                    message += L"\"webMessageAsString\": " + EncodeQuote(webMessageAsString.get()) + L", ";
-                }
-                else
-                {
-                    message += L"\"webMessageAsString\": null, ";
-                }
-
-                message += L"\"webMessageAsJson\": " + EncodeQuote(webMessageAsJson.get()) + L" "
-                    L"}";
-                message += WebViewPropertiesToJsonString(m_webviewEventSource.get());
-
-                message += L"}";
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_webMessageReceivedToken);
-
-    m_webviewEventSource->add_NewWindowRequested(
-        Callback<ICoreWebView2NewWindowRequestedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2NewWindowRequestedEventArgs* args)
-                -> HRESULT {
-                BOOL handled = FALSE;
-                CHECK_FAILURE(args->get_Handled(&handled));
-                BOOL isUserInitiated = FALSE;
-                CHECK_FAILURE(args->get_IsUserInitiated(&isUserInitiated));
-                wil::unique_cotaskmem_string uri;
-                CHECK_FAILURE(args->get_Uri(&uri));
-
-                wil::com_ptr<ICoreWebView2NewWindowRequestedEventArgs2>
-                    args2;
-                wil::unique_cotaskmem_string name;
-                std::wstring encodedName = EncodeQuote(L"");
-
-                if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2)))) {
-                    CHECK_FAILURE(args2->get_Name(&name));
-                    encodedName = EncodeQuote(name.get());
-                }
-
-                wil::com_ptr<ICoreWebView2NewWindowRequestedEventArgs3> args3;
-                std::wstring frameName = EncodeQuote(L"");
-                std::wstring frameUri = EncodeQuote(L"");
-                if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args3))))
-                {
-                    wil::com_ptr<ICoreWebView2FrameInfo> frame_info;
-                    CHECK_FAILURE(args3->get_OriginalSourceFrameInfo(&frame_info));
-                    wil::unique_cotaskmem_string name;
-                    CHECK_FAILURE(frame_info->get_Name(&name));
-                    frameName = EncodeQuote(name.get());
-                    wil::unique_cotaskmem_string source;
-                    CHECK_FAILURE(frame_info->get_Source(&source));
-                    frameUri = EncodeQuote(source.get());
-                }
-
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"NewWindowRequested\", \"args\": {"
-                    L"\"handled\": " +
-                    BoolToString(handled) +
-                    L", "
-                    L"\"isUserInitiated\": " +
-                    BoolToString(isUserInitiated) +
-                    L", "
-                    L"\"uri\": " +
-                    EncodeQuote(uri.get()) +
-                    L", "
-                    L"\"name\": " +
-                    encodedName +
-                    L", "
-                    L"\"newWindow\": null" +
-                    L", "
-                    L"\"frameName\": " +
-                    frameName +
-                    L", "
-                    L"\"frameUri\": " +
-                    frameUri + L"}" +
-                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_newWindowRequestedToken);
-
-    m_webviewEventSource->add_NavigationStarting(
-        Callback<ICoreWebView2NavigationStartingEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
-                -> HRESULT {
-                std::wstring message =
-                    NavigationStartingArgsToJsonString(sender, args, L"NavigationStarting");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_navigationStartingToken);
-
-    m_webviewEventSource->add_FrameNavigationStarting(
-        Callback<ICoreWebView2NavigationStartingEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
-                -> HRESULT {
-                std::wstring message = NavigationStartingArgsToJsonString(
-                    sender, args, L"FrameNavigationStarting");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_frameNavigationStartingToken);
-
-    m_webviewEventSource->add_SourceChanged(
-        Callback<ICoreWebView2SourceChangedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs* args)
-                -> HRESULT {
-                BOOL isNewDocument = FALSE;
-                CHECK_FAILURE(args->get_IsNewDocument(&isNewDocument));
-
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"SourceChanged\", \"args\": {";
-                message += L"\"isNewDocument\": " + BoolToString(isNewDocument) + L"}" +
-                           WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_sourceChangedToken);
-
-    m_webviewEventSource->add_ContentLoading(
-        Callback<ICoreWebView2ContentLoadingEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2ContentLoadingEventArgs* args) -> HRESULT {
-                std::wstring message =
-                    ContentLoadingArgsToJsonString(sender, args, L"ContentLoading");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_contentLoadingToken);
-
-    m_webviewEventSource->add_HistoryChanged(
-        Callback<ICoreWebView2HistoryChangedEventHandler>(
-            [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"HistoryChanged\", \"args\": {";
-                message +=
-                    L"}" + WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_historyChangedToken);
-
-    m_webviewEventSource->add_NavigationCompleted(
-        Callback<ICoreWebView2NavigationCompletedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
-                -> HRESULT {
-                std::wstring message =
-                    NavigationCompletedArgsToJsonString(sender, args, L"NavigationCompleted");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_navigationCompletedToken);
-
-        m_webviewEventSource->add_FrameNavigationCompleted(
-        Callback<ICoreWebView2NavigationCompletedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
-                -> HRESULT {
-                std::wstring message = NavigationCompletedArgsToJsonString(
-                    sender, args, L"FrameNavigationCompleted");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_frameNavigationCompletedToken);
-
-    m_webviewEventSource2->add_DOMContentLoaded(
-        Callback<ICoreWebView2DOMContentLoadedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
-                -> HRESULT {
-                std::wstring message =
-                    DOMContentLoadedArgsToJsonString(sender, args, L"DOMContentLoaded");
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_DOMContentLoadedToken);
-
-    m_webviewEventSource->add_DocumentTitleChanged(
-        Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
-            [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"DocumentTitleChanged\", \"args\": {"
-                    L"}" +
-                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) +
-                    L"}";
-                PostEventMessage(message);
-
-                return S_OK;
-            })
-            .Get(),
-        &m_documentTitleChangedToken);
-
-    m_webviewEventSource4 = m_webviewEventSource.try_query<ICoreWebView2_4>();
-    if (m_webviewEventSource4) {
-        m_webviewEventSource4->add_DownloadStarting(
-            Callback<ICoreWebView2DownloadStartingEventHandler>(
-                [this](ICoreWebView2* sender, ICoreWebView2DownloadStartingEventArgs* args)
-                    -> HRESULT {
-                    wil::com_ptr<ICoreWebView2DownloadOperation> download;
-                    CHECK_FAILURE(args->get_DownloadOperation(&download));
-
-                    BOOL cancel = FALSE;
-                    CHECK_FAILURE(args->get_Cancel(&cancel));
-
-                    INT64 totalBytesToReceive = 0;
-                    CHECK_FAILURE(
-                        download->get_TotalBytesToReceive(&totalBytesToReceive));
-
-                    wil::unique_cotaskmem_string uri;
-                    CHECK_FAILURE(download->get_Uri(&uri));
-
-                    wil::unique_cotaskmem_string mimeType;
-                    CHECK_FAILURE(download->get_MimeType(&mimeType));
-
-                    wil::unique_cotaskmem_string contentDisposition;
-                    CHECK_FAILURE(download->get_ContentDisposition(&contentDisposition));
-
-                    wil::unique_cotaskmem_string resultFilePath;
-                    CHECK_FAILURE(args->get_ResultFilePath(&resultFilePath));
-
-                    COREWEBVIEW2_DOWNLOAD_STATE state;
-                    CHECK_FAILURE(download->get_State(&state));
-
-                    BOOL handled = FALSE;
-                    CHECK_FAILURE(args->get_Handled(&handled));
-
-                    download->add_StateChanged(
-                        Callback<ICoreWebView2StateChangedEventHandler>(
-                            [this, download](
-                                ICoreWebView2DownloadOperation* sender,
-                                IUnknown* args)
-                                -> HRESULT {
-                                COREWEBVIEW2_DOWNLOAD_STATE state;
-                                CHECK_FAILURE(download->get_State(&state));
-
-                                std::wstring state_string = L"";
-                                switch (state)
-                                {
-                                case COREWEBVIEW2_DOWNLOAD_STATE_IN_PROGRESS:
-                                    state_string = L"In progress";
-                                    break;
-                                case COREWEBVIEW2_DOWNLOAD_STATE_COMPLETED:
-                                    state_string = L"Complete";
-                                    download->remove_StateChanged(
-                                        m_stateChangedToken);
-                                    download->remove_BytesReceivedChanged(
-                                        m_bytesReceivedChangedToken);
-                                    download->remove_EstimatedEndTimeChanged(
-                                        m_estimatedEndTimeChanged);
-                                    break;
-                                case COREWEBVIEW2_DOWNLOAD_STATE_INTERRUPTED:
-                                    state_string = L"Interrupted";
-                                    break;
-                                }
-
-                                COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason;
-                                CHECK_FAILURE(download->get_InterruptReason(&interrupt_reason));
-                                std::wstring interrupt_reason_string =
-                                    InterruptReasonToString(interrupt_reason);
-
-                                std::wstring message = L"{ \"kind\": \"event\", \"name\": "
-                                                      L"\"DownloadStateChanged\", \"args\": {";
-                                message += L"\"state\": " + EncodeQuote(state_string) + L", " +
-                                          L"\"interruptReason\": " +
-                                          EncodeQuote(interrupt_reason_string) + L" ";
-
-                                message +=
-                                    L"}" +
-                                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) +
-                                    L"}";
-                                PostEventMessage(message);
-                                return S_OK;
-                            })
-                            .Get(),
-                        &m_stateChangedToken);
-
-                    download->add_BytesReceivedChanged(
-                        Callback<
-                            ICoreWebView2BytesReceivedChangedEventHandler>(
-                            [this, download](
-                                ICoreWebView2DownloadOperation* sender, IUnknown* args) -> HRESULT {
-                                INT64 bytesReceived = 0;
-                                CHECK_FAILURE(download->get_BytesReceived(
-                                    &bytesReceived));
-
-                                std::wstring message =
-                                    L"{ \"kind\": \"event\", \"name\": "
-                                    L"\"DownloadBytesReceivedChanged\", \"args\": {";
-                                message += L"\"bytesReceived\": " +
-                                          std::to_wstring(bytesReceived) + L" ";
-
-                                message +=
-                                    L"}" +
-                                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) +
-                                    L"}";
-                                PostEventMessage(message);
-                                return S_OK;
-                            })
-                            .Get(),
-                        &m_bytesReceivedChangedToken);
-
-                    download->add_EstimatedEndTimeChanged(
-                        Callback<ICoreWebView2EstimatedEndTimeChangedEventHandler>(
-                            [this, download](
-                                ICoreWebView2DownloadOperation* sender, IUnknown* args) -> HRESULT {
-                                wil::unique_cotaskmem_string estimatedEndTime;
-                                CHECK_FAILURE(download->get_EstimatedEndTime(&estimatedEndTime));
-
-                                std::wstring message =
-                                    L"{ \"kind\": \"event\", \"name\": "
-                                    L"\"DownloadEstimatedEndTimeChanged\", \"args\": {";
-                                message += L"\"estimatedEndTime\": " +
-                                          EncodeQuote(estimatedEndTime.get()) + L" ";
-
-                                message +=
-                                    L"}" +
-                                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) +
-                                    L"}";
-                                PostEventMessage(message);
-                                return S_OK;
-                            })
-                            .Get(),
-                        &m_estimatedEndTimeChanged);
-
-                    std::wstring message =
-                        L"{ \"kind\": \"event\", \"name\": \"DownloadStarting\", \"args\": {";
-
-                    message += L"\"cancel\": " + BoolToString(cancel) + L", " +
-                              L"\"resultFilePath\": " + EncodeQuote(resultFilePath.get()) + L", " +
-                              L"\"handled\": " + BoolToString(handled) + L", " +
-                              L"\"uri\": " + EncodeQuote(uri.get()) + L", " + L"\"mimeType\": " +
-                              EncodeQuote(mimeType.get()) + L", " + L"\"contentDisposition\": " +
-                              EncodeQuote(contentDisposition.get()) + L", " +
-                              L"\"totalBytesToReceive\": " +
-                              std::to_wstring(totalBytesToReceive) + L" ";
-
-                    message +=
-                        L"}" + WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            &m_downloadStartingToken);
-
-        m_webviewEventSource4->add_FrameCreated(
-            Callback<ICoreWebView2FrameCreatedEventHandler>(
-                [this](ICoreWebView2* sender, ICoreWebView2FrameCreatedEventArgs* args)
-                    -> HRESULT {
-                    wil::com_ptr<ICoreWebView2Frame> webviewFrame;
-                    CHECK_FAILURE(args->get_Frame(&webviewFrame));
-                    InitializeFrameEventView(webviewFrame);
-                    wil::unique_cotaskmem_string name;
-                    CHECK_FAILURE(webviewFrame->get_Name(&name));
-
-                    std::wstring message =
-                        L"{ \"kind\": \"event\", \"name\": \"FrameCreated\", \"args\": {";
-                    message += L"\"frame\": " + EncodeQuote(name.get());
-
-                    auto webView2_20 =
-                        wil::com_ptr<ICoreWebView2>(sender).try_query<ICoreWebView2_20>();
-                    if (webView2_20)
-                    {
-                        UINT32 frameId = 0;
-                        CHECK_FAILURE(webView2_20->get_FrameId(&frameId));
-                        message +=
-                            L",\"sender main frame id\": " + std::to_wstring((int)frameId);
-                    }
-                    auto frame5 = webviewFrame.try_query<ICoreWebView2Frame5>();
-                    if (frame5)
-                    {
-                        UINT32 frameId = 0;
-                        CHECK_FAILURE(frame5->get_FrameId(&frameId));
-                        message += L",\"frame id\": " + std::to_wstring((int)frameId);
-                    }
-                    message +=
-                        L"}" + WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            &m_frameCreatedToken);
-    }
-
-    m_controllerEventSource->add_GotFocus(
-        Callback<ICoreWebView2FocusChangedEventHandler>(
-            [this](ICoreWebView2Controller* sender, IUnknown* args)
-                -> HRESULT {
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"GotFocus\", \"args\": {} }";
-                PostEventMessage(message);
-                return S_OK;
-            })
-            .Get(),
-        &m_gotFocusToken);
-    m_controllerEventSource->add_LostFocus(
-        Callback<ICoreWebView2FocusChangedEventHandler>(
-            [this](ICoreWebView2Controller* sender, IUnknown* args)
-                -> HRESULT {
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"LostFocus\", \"args\": {} }";
-                PostEventMessage(message);
-                return S_OK;
-            })
-            .Get(),
-        &m_lostFocusToken);
-
-    m_webViewEventSource9 = m_webviewEventSource.try_query<ICoreWebView2_9>();
-    if (m_webViewEventSource9)
-    {
-        m_webViewEventSource9->add_IsDefaultDownloadDialogOpenChanged(
-            Callback<ICoreWebView2IsDefaultDownloadDialogOpenChangedEventHandler>(
-                [this](
-                    ICoreWebView2* sender, IUnknown* args) -> HRESULT {
-                    std::wstring message =
-                        L"{ \"kind\": \"event\", \"name\": "
-                        L"\"IsDefaultDownloadDialogOpenChanged\", \"args\": {";
-                    BOOL isOpen;
-                    m_webViewEventSource9->get_IsDefaultDownloadDialogOpen(&isOpen);
-                    message += L"\"isDefaultDownloadDialogOpen\": " + BoolToString(isOpen);
-                    message +=
-                        L"}" + WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                    PostEventMessage(message);
-                    return S_OK;
-                })
-                .Get(),
-            &m_isDefaultDownloadDialogOpenChangedToken);
-    }
-
-    m_webviewEventSource->add_PermissionRequested(
-        Callback<ICoreWebView2PermissionRequestedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2PermissionRequestedEventArgs* args)
-                -> HRESULT
-            {
-                wil::unique_cotaskmem_string uri;
-                CHECK_FAILURE(args->get_Uri(&uri));
-                COREWEBVIEW2_PERMISSION_KIND kind;
-                CHECK_FAILURE(args->get_PermissionKind(&kind));
-                COREWEBVIEW2_PERMISSION_STATE state;
-                CHECK_FAILURE(args->get_State(&state));
-                wil::com_ptr<ICoreWebView2PermissionRequestedEventArgs3> extended_args;
-                CHECK_FAILURE(args->QueryInterface(IID_PPV_ARGS(&extended_args)));
-                BOOL saves_in_profile = TRUE;
-                CHECK_FAILURE(extended_args->get_SavesInProfile(&saves_in_profile));
-                std::wstring message =
-                    L"{ \"kind\": \"event\", \"name\": \"PermissionRequested\", \"args\": {"
-                    L"\"uri\": " +
-                    EncodeQuote(uri.get()) +
-                    L", "
-                    L"\"kind\": " +
-                    EncodeQuote(PermissionKindToString(kind)) +
-                    L", "
-                    L"\"state\": " +
-                    EncodeQuote(PermissionStateToString(state)) + L", \"SavesInProfile\": " +
-                    BoolToString(saves_in_profile) + L"}" +
-                    WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                PostEventMessage(message);
-                return S_OK;
-            })
-            .Get(),
-        &m_permissionRequestedToken);
-}
-
-void ScenarioWebViewEventMonitor::InitializeFrameEventView(
-    wil::com_ptr<ICoreWebView2Frame> webviewFrame)
-{
-    webviewFrame->add_Destroyed(
-        Callback<ICoreWebView2FrameDestroyedEventHandler>(
-            [this](ICoreWebView2Frame* sender, IUnknown* args) -> HRESULT {
-                std::wstring message = L"{ \"kind\": \"event\", \"name\": "
-                                       L"\"CoreWebView2Frame::Destroyed\", \"args\": {";
-                message +=
-                    L"}" + WebViewPropertiesToJsonString(m_webviewEventSource.get()) + L"}";
-                PostEventMessage(message);
-                return S_OK;
-            })
-            .Get(),
-        NULL);
-
-    wil::com_ptr<ICoreWebView2Frame2> frame2 = webviewFrame.try_query<ICoreWebView2Frame2>();
-    if (frame2)
-    {
-        frame2->add_NavigationStarting(
-            Callback<ICoreWebView2FrameNavigationStartingEventHandler>(
-                [this](
-                    ICoreWebView2Frame* sender,
-                    ICoreWebView2NavigationStartingEventArgs* args) -> HRESULT {
-                    std::wstring message = NavigationStartingArgsToJsonString(
-                        m_webviewEventSource.get(), args,
-                        L"CoreWebView2Frame::NavigationStarting");
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            NULL);
-
-        frame2->add_ContentLoading(
-            Callback<ICoreWebView2FrameContentLoadingEventHandler>(
-                [this](ICoreWebView2Frame* sender, ICoreWebView2ContentLoadingEventArgs* args)
-                    -> HRESULT {
-                    std::wstring message = ContentLoadingArgsToJsonString(
-                        m_webviewEventSource.get(), args, L"CoreWebView2Frame::ContentLoading");
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            NULL);
-
-        frame2->add_NavigationCompleted(
-            Callback<ICoreWebView2FrameNavigationCompletedEventHandler>(
-                [this](
-                    ICoreWebView2Frame* sender,
-                    ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
-                    std::wstring message = NavigationCompletedArgsToJsonString(
-                        m_webviewEventSource.get(), args,
-                        L"CoreWebView2Frame::NavigationCompleted");
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            NULL);
-
-        frame2->add_DOMContentLoaded(
-            Callback<ICoreWebView2FrameDOMContentLoadedEventHandler>(
-                [this](ICoreWebView2Frame* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
-                    -> HRESULT {
-                    std::wstring message = DOMContentLoadedArgsToJsonString(
-                        m_webviewEventSource.get(), args,
-                        L"CoreWebView2Frame::DOMContentLoaded");
-                    PostEventMessage(message);
-
-                    return S_OK;
-                })
-                .Get(),
-            NULL);
-    }
-}
-void ScenarioWebViewEventMonitor::PostEventMessage(std::wstring message)
-{
-    HRESULT hr = m_webviewEventView->PostWebMessageAsJson(message.c_str());
-    if (FAILED(hr))
-    {
-        ShowFailure(hr, L"PostWebMessageAsJson failed:\n" + message);
-    }
-}
-
-std::wstring ScenarioWebViewEventMonitor::InterruptReasonToString(
-    const COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason)
-{
-    std::wstring interrupt_reason_string = L"";
-    switch (interrupt_reason)
-    {
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NONE:
-        interrupt_reason_string = L"None";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_FAILED:
-        interrupt_reason_string = L"File failed";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_ACCESS_DENIED:
-        interrupt_reason_string = L"File access denied";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_NO_SPACE:
-        interrupt_reason_string = L"File no space";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_NAME_TOO_LONG:
-        interrupt_reason_string = L"File name too long";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TOO_LARGE:
-        interrupt_reason_string = L"File too large";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_MALICIOUS:
-        interrupt_reason_string = L"File malicious";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TRANSIENT_ERROR:
-        interrupt_reason_string = L"File transient error";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_BLOCKED_BY_POLICY:
-        interrupt_reason_string = L"File blocked by policy";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_SECURITY_CHECK_FAILED:
-        interrupt_reason_string = L"File security check failed";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TOO_SHORT:
-        interrupt_reason_string = L"File too short";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_HASH_MISMATCH:
-        interrupt_reason_string = L"File hash mismatch";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_FAILED:
-        interrupt_reason_string = L"Network failed";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_TIMEOUT:
-        interrupt_reason_string = L"Network timeout";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_DISCONNECTED:
-        interrupt_reason_string = L"Network disconnected";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_SERVER_DOWN:
-        interrupt_reason_string = L"Network server down";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_INVALID_REQUEST:
-        interrupt_reason_string = L"Network invalid request";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_FAILED:
-        interrupt_reason_string = L"Server failed";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_NO_RANGE:
-        interrupt_reason_string = L"Server no range";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_BAD_CONTENT:
-        interrupt_reason_string = L"Server bad content";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_UNAUTHORIZED:
-        interrupt_reason_string = L"Server unauthorized";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CERTIFICATE_PROBLEM:
-        interrupt_reason_string = L"Server certificate problem";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_FORBIDDEN:
-        interrupt_reason_string = L"Server forbidden";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_UNEXPECTED_RESPONSE:
-        interrupt_reason_string = L"Server unexpected response";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CONTENT_LENGTH_MISMATCH:
-        interrupt_reason_string = L"Server content length mismatch";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CROSS_ORIGIN_REDIRECT:
-        interrupt_reason_string = L"Server cross origin redirect";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_CANCELED:
-        interrupt_reason_string = L"User canceled";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_SHUTDOWN:
-        interrupt_reason_string = L"User shutdown";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_PAUSED:
-        interrupt_reason_string = L"User paused";
-        break;
-    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_DOWNLOAD_PROCESS_CRASHED:
-        interrupt_reason_string = L"Download process crashed";
-        break;
-    }
-    return interrupt_reason_string;
-}
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING 1
+
+#include "AppWindow.h"
+#include "CheckFailure.h"
+#include "EventTrace.h"
+#include "JsonWriter.h"
+#include "MonitorEvent.h"
+#include "ScenarioPermissionManagement.h"
+#include "ScenarioWebViewEventMonitor.h"
+#include "Utf8Decoder.h"
+#include <WebView2.h>
+#include <algorithm>
+#include <codecvt>
+#include <locale>
+#include <regex>
+#include <string>
+
+using namespace Microsoft::WRL;
+using namespace std;
+
+static constexpr wchar_t c_samplePath[] = L"ScenarioWebViewEventMonitor.html";
+// Number of characters of a text response body shown in the event view.
+static constexpr size_t c_contentPreviewLength = 50;
+// Strings at least this long are sent to the event view once and then referred
+// to by id; shorter ones are cheaper to repeat.
+static constexpr size_t c_minStringRefLength = 16;
+// Timer on the event source window that flushes batched events.
+static constexpr UINT_PTR c_eventBatchTimerId = 0x45564D4E;
+// Number of recorded events kept for the event view.
+static constexpr size_t c_eventRingCapacity = 16384;
+// Characters of URIs, headers and event args kept for the recorded events.
+static constexpr size_t c_eventStringCapacity = 4 * 1024 * 1024;
+// File in the user data folder the latency report is saved to.
+static constexpr wchar_t c_latencyReportFileName[] = L"EventMonitorLatency.json";
+
+// Event timestamps are steady_clock ticks.
+static int64_t GetEventTimestamp()
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+static uint64_t TicksToNanoseconds(int64_t ticks)
+{
+    if (ticks <= 0)
+    {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::duration(ticks))
+        .count();
+}
+
+const wchar_t* WebResourceSourceToString(COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS source)
+{
+    switch (source)
+    {
+    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT:
+        return L"main";
+    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SHARED_WORKER:
+        return L"shared_worker";
+    case COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_SERVICE_WORKER:
+        return L"service_worker";
+    default:
+        return L"unknown_source";
+    }
+}
+
+ScenarioWebViewEventMonitor::ScenarioWebViewEventMonitor(AppWindow* appWindowEventSource)
+    : m_eventRing(c_eventRingCapacity), m_eventStrings(c_eventStringCapacity),
+      m_eventBatcher(
+          EventBatcher::Options(),
+          [this](uint64_t first, size_t count, uint64_t dropped)
+          { PostEventBatch(first, count, dropped); }),
+      m_eventLatency(std::make_unique<EventLatency[]>(
+          static_cast<size_t>(MonitorEventKind::Count))),
+      m_appWindowEventSource(appWindowEventSource),
+      m_webviewEventSource(appWindowEventSource->GetWebView()),
+      m_controllerEventSource(appWindowEventSource->GetWebViewController()),
+      m_webResourceRequestedDispatcher(appWindowEventSource->GetWebResourceRequestedDispatcher())
+{
+    m_sampleUri = m_appWindowEventSource->GetLocalUri(c_samplePath);
+    m_appWindowEventView = new AppWindow(
+        IDM_CREATION_MODE_WINDOWED, appWindowEventSource->GetWebViewOption(),
+        m_sampleUri, appWindowEventSource->GetUserDataFolder(),
+        false, [this]() -> void { InitializeEventView(m_appWindowEventView->GetWebView()); });
+    // Delete this component when the event monitor window closes.
+    // Since this is a component of the event source window, it will automatically
+    // be deleted when the event source webview is closed.
+    m_appWindowEventView->SetOnAppWindowClosing([&]{
+        m_appWindowEventSource->DeleteComponent(this);
+    });
+    m_webviewEventSource2 = m_webviewEventSource.query<ICoreWebView2_2>();
+}
+
+ScenarioWebViewEventMonitor::~ScenarioWebViewEventMonitor()
+{
+    KillTimer(m_appWindowEventSource->GetMainWindow(), c_eventBatchTimerId);
+    m_webviewEventSource->remove_NavigationStarting(m_navigationStartingToken);
+    m_webviewEventSource->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
+    m_webviewEventSource->remove_SourceChanged(m_sourceChangedToken);
+    m_webviewEventSource->remove_ContentLoading(m_contentLoadingToken);
+    m_webviewEventSource->remove_HistoryChanged(m_historyChangedToken);
+    m_webviewEventSource->remove_FrameNavigationCompleted(m_frameNavigationCompletedToken);
+    m_webviewEventSource->remove_NavigationCompleted(m_navigationCompletedToken);
+    m_webviewEventSource->remove_DocumentTitleChanged(m_documentTitleChangedToken);
+    m_webviewEventSource->remove_WebMessageReceived(m_webMessageReceivedToken);
+    m_webviewEventSource->remove_NewWindowRequested(m_newWindowRequestedToken);
+    m_webviewEventSource2->remove_DOMContentLoaded(m_DOMContentLoadedToken);
+    if (m_webviewEventSource4)
+    {
+        m_webviewEventSource4->remove_DownloadStarting(m_downloadStartingToken);
+        m_webviewEventSource4->remove_FrameCreated(m_frameCreatedToken);
+    }
+    m_controllerEventSource->remove_GotFocus(m_gotFocusToken);
+    m_controllerEventSource->remove_LostFocus(m_lostFocusToken);
+    EnableWebResourceRequestedEvent(false);
+    EnableWebResourceResponseReceivedEvent(false);
+
+    m_webviewEventView->remove_WebMessageReceived(m_eventViewWebMessageReceivedToken);
+    if (m_webViewEventSource9) {
+        m_webViewEventSource9->remove_IsDefaultDownloadDialogOpenChanged(
+            m_isDefaultDownloadDialogOpenChangedToken);
+    }
+
+    EnableEventTrace(false);
+
+    // Clear our app window's reference to this.
+    m_appWindowEventView->SetOnAppWindowClosing(nullptr);
+}
+
+std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status)
+{
+    switch (status)
+    {
+#define STATUS_ENTRY(statusValue)                                                              \
+    case statusValue:                                                                          \
+        return L#statusValue;
+
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_UNKNOWN);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_COMMON_NAME_IS_INCORRECT);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_EXPIRED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CLIENT_CERTIFICATE_CONTAINS_ERRORS);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_REVOKED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CERTIFICATE_IS_INVALID);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_SERVER_UNREACHABLE);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_TIMEOUT);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_ERROR_HTTP_INVALID_SERVER_RESPONSE);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_ABORTED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CONNECTION_RESET);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_DISCONNECTED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_CANNOT_CONNECT);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_HOST_NAME_NOT_RESOLVED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_OPERATION_CANCELED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_REDIRECT_FAILED);
+        STATUS_ENTRY(COREWEBVIEW2_WEB_ERROR_STATUS_UNEXPECTED_ERROR);
+
+#undef STATUS_ENTRY
+    }
+
+    return L"ERROR";
+}
+
+//! [HttpRequestHeaderIterator]
+void RequestHeadersToJson(JsonWriter& json, ICoreWebView2HttpRequestHeaders* requestHeaders)
+{
+    wil::com_ptr<ICoreWebView2HttpHeadersCollectionIterator> iterator;
+    CHECK_FAILURE(requestHeaders->GetIterator(&iterator));
+    BOOL hasCurrent = FALSE;
+    json.BeginArray();
+
+    while (SUCCEEDED(iterator->get_HasCurrentHeader(&hasCurrent)) && hasCurrent)
+    {
+        wil::unique_cotaskmem_string name;
+        wil::unique_cotaskmem_string value;
+
+        CHECK_FAILURE(iterator->GetCurrentHeader(&name, &value));
+        json.BeginObject();
+        json.Key(L"name").String(name.get());
+        json.Key(L"value").String(value.get());
+        json.EndObject();
+
+        BOOL hasNext = FALSE;
+        CHECK_FAILURE(iterator->MoveNext(&hasNext));
+    }
+
+    json.EndArray();
+}
+//! [HttpRequestHeaderIterator]
+
+void ResponseHeadersToJson(JsonWriter& json, ICoreWebView2HttpResponseHeaders* responseHeaders)
+{
+    wil::com_ptr<ICoreWebView2HttpHeadersCollectionIterator> iterator;
+    CHECK_FAILURE(responseHeaders->GetIterator(&iterator));
+    BOOL hasCurrent = FALSE;
+    json.BeginArray();
+
+    while (SUCCEEDED(iterator->get_HasCurrentHeader(&hasCurrent)) && hasCurrent)
+    {
+        wil::unique_cotaskmem_string name;
+        wil::unique_cotaskmem_string value;
+
+        CHECK_FAILURE(iterator->GetCurrentHeader(&name, &value));
+        json.BeginString()
+            .AppendToString(name.get())
+            .AppendToString(L": ")
+            .AppendToString(value.get())
+            .EndString();
+
+        BOOL hasNext = FALSE;
+        CHECK_FAILURE(iterator->MoveNext(&hasNext));
+    }
+
+    json.EndArray();
+}
+
+// Decodes the start of a UTF-8 body into preview, reading no more of content
+// than needed. Returns the number of characters written.
+size_t GetPreviewOfContent(IStream* content, WCHAR* preview, size_t capacity, bool& truncated)
+{
+    return ReadUtf8Preview(
+        [content](void* buffer, size_t size) -> size_t
+        {
+            ULONG read = 0;
+            if (FAILED(content->Read(buffer, static_cast<ULONG>(size), &read)))
+            {
+                return 0;
+            }
+            return read;
+        },
+        preview, capacity, &truncated);
+}
+
+void ResponseToJson(
+    JsonWriter& json, ICoreWebView2WebResourceResponseView* response, IStream* content)
+{
+    wil::com_ptr<ICoreWebView2HttpResponseHeaders> headers;
+    CHECK_FAILURE(response->get_Headers(&headers));
+    int statusCode;
+    CHECK_FAILURE(response->get_StatusCode(&statusCode));
+    wil::unique_cotaskmem_string reasonPhrase;
+    CHECK_FAILURE(response->get_ReasonPhrase(&reasonPhrase));
+    BOOL containsContentType = FALSE;
+    headers->Contains(L"Content-Type", &containsContentType);
+    wil::unique_cotaskmem_string contentType;
+    bool isBinaryContent = true;
+    if (containsContentType)
+    {
+        headers->GetHeader(L"Content-Type", &contentType);
+        if (wcsncmp(L"text/", contentType.get(), ARRAYSIZE(L"text/") - 1) == 0)
+        {
+            isBinaryContent = false;
+        }
+    }
+
+    json.BeginObject();
+    json.Key(L"content");
+    if (!content)
+    {
+        json.Null();
+    }
+    else if (isBinaryContent)
+    {
+        json.String(L"BINARY_DATA");
+    }
+    else
+    {
+        WCHAR preview[c_contentPreviewLength];
+        bool truncated = false;
+        size_t previewLength =
+            GetPreviewOfContent(content, preview, ARRAYSIZE(preview), truncated);
+        json.BeginString().AppendToString(std::wstring_view(preview, previewLength));
+        if (truncated)
+        {
+            json.AppendToString(L"...");
+        }
+        json.EndString();
+    }
+
+    json.Key(L"headers");
+    ResponseHeadersToJson(json, headers.get());
+    json.Key(L"status").Int(statusCode);
+    json.Key(L"reason").String(reasonPhrase.get());
+    json.EndObject();
+}
+
+MonitorEventRecord ScenarioWebViewEventMonitor::NewEventRecord(
+    MonitorEventKind kind, bool includeWebViewProperties)
+{
+    MonitorEventRecord record = {};
+    record.timestamp = GetEventTimestamp();
+    record.kind = kind;
+    if (includeWebViewProperties)
+    {
+        ICoreWebView2* webview = m_webviewEventSource.get();
+        wil::unique_cotaskmem_string documentTitle;
+        CHECK_FAILURE(webview->get_DocumentTitle(&documentTitle));
+        wil::unique_cotaskmem_string source;
+        CHECK_FAILURE(webview->get_Source(&source));
+        BOOL canGoBack = FALSE;
+        CHECK_FAILURE(webview->get_CanGoBack(&canGoBack));
+        BOOL canGoForward = FALSE;
+        CHECK_FAILURE(webview->get_CanGoForward(&canGoForward));
+
+        record.flags |= c_monitorEventHasWebView;
+        record.titleId = m_eventStrings.Intern(documentTitle.get());
+        record.sourceId = m_eventStrings.Intern(source.get());
+        if (canGoBack)
+        {
+            record.flags |= c_monitorEventCanGoBack;
+        }
+        if (canGoForward)
+        {
+            record.flags |= c_monitorEventCanGoForward;
+        }
+    }
+    return record;
+}
+
+void ScenarioWebViewEventMonitor::RecordEvent(
+    const MonitorEventRecord& record, int64_t handlerStart)
+{
+    uint64_t sequence = m_eventRing.Push(record);
+    if (m_eventStrings.GetGeneration() != m_recordedGeneration)
+    {
+        m_recordedGeneration = m_eventStrings.GetGeneration();
+        m_stringReleases.push_back({m_recordedGeneration, sequence});
+    }
+    m_eventBatcher.OnEventsAvailable(m_eventRing.Begin(), m_eventRing.End());
+    m_eventLatency[static_cast<size_t>(record.kind)].handler.Record(TicksToNanoseconds(
+        GetEventTimestamp() - (handlerStart != 0 ? handlerStart : record.timestamp)));
+}
+
+JsonWriter& ScenarioWebViewEventMonitor::BeginScratchJson()
+{
+    m_scratchJson.Reset();
+    return m_scratchJson;
+}
+
+uint32_t ScenarioWebViewEventMonitor::InternScratchJson()
+{
+    return m_eventStrings.Intern(m_scratchJson.GetString());
+}
+
+JsonWriter& ScenarioWebViewEventMonitor::BeginEventArgs(MonitorEventKind kind)
+{
+    m_argsKind = kind;
+    m_argsTimestamp = GetEventTimestamp();
+    BeginScratchJson().BeginObject();
+    return m_scratchJson;
+}
+
+void ScenarioWebViewEventMonitor::EndEventArgs(bool includeWebViewProperties)
+{
+    m_scratchJson.EndObject();
+    MonitorEventRecord record = NewEventRecord(m_argsKind, includeWebViewProperties);
+    record.timestamp = m_argsTimestamp;
+    record.argsId = InternScratchJson();
+    RecordEvent(record);
+}
+
+void ScenarioWebViewEventMonitor::RecordNavigationStarting(
+    MonitorEventKind kind, ICoreWebView2NavigationStartingEventArgs* args)
+{
+    MonitorEventRecord record = NewEventRecord(kind);
+    BOOL cancel = FALSE;
+    CHECK_FAILURE(args->get_Cancel(&cancel));
+    BOOL isRedirected = FALSE;
+    CHECK_FAILURE(args->get_IsRedirected(&isRedirected));
+    BOOL isUserInitiated = FALSE;
+    CHECK_FAILURE(args->get_IsUserInitiated(&isUserInitiated));
+    wil::com_ptr<ICoreWebView2HttpRequestHeaders> requestHeaders;
+    CHECK_FAILURE(args->get_RequestHeaders(&requestHeaders));
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(args->get_Uri(&uri));
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    record.navigationId = navigationId;
+    record.flags |= (cancel ? c_monitorEventCancel : 0) |
+                    (isRedirected ? c_monitorEventIsRedirected : 0) |
+                    (isUserInitiated ? c_monitorEventIsUserInitiated : 0);
+    RequestHeadersToJson(BeginScratchJson(), requestHeaders.get());
+    record.headersId = InternScratchJson();
+    record.uriId = m_eventStrings.Intern(uri.get());
+    RecordEvent(record);
+}
+
+void ScenarioWebViewEventMonitor::RecordContentLoading(
+    MonitorEventKind kind, ICoreWebView2ContentLoadingEventArgs* args)
+{
+    MonitorEventRecord record = NewEventRecord(kind);
+    BOOL isErrorPage = FALSE;
+    CHECK_FAILURE(args->get_IsErrorPage(&isErrorPage));
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    record.navigationId = navigationId;
+    if (isErrorPage)
+    {
+        record.flags |= c_monitorEventIsErrorPage;
+    }
+    RecordEvent(record);
+}
+
+void ScenarioWebViewEventMonitor::RecordNavigationCompleted(
+    MonitorEventKind kind, ICoreWebView2NavigationCompletedEventArgs* args)
+{
+    MonitorEventRecord record = NewEventRecord(kind);
+    BOOL isSuccess = FALSE;
+    CHECK_FAILURE(args->get_IsSuccess(&isSuccess));
+    COREWEBVIEW2_WEB_ERROR_STATUS webErrorStatus;
+    CHECK_FAILURE(args->get_WebErrorStatus(&webErrorStatus));
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    record.navigationId = navigationId;
+    record.value = webErrorStatus;
+    if (isSuccess)
+    {
+        record.flags |= c_monitorEventIsSuccess;
+    }
+    RecordEvent(record);
+}
+
+void ScenarioWebViewEventMonitor::RecordDOMContentLoaded(
+    MonitorEventKind kind, ICoreWebView2DOMContentLoadedEventArgs* args)
+{
+    MonitorEventRecord record = NewEventRecord(kind);
+    UINT64 navigationId = 0;
+    CHECK_FAILURE(args->get_NavigationId(&navigationId));
+
+    record.navigationId = navigationId;
+    RecordEvent(record);
+}
+
+void ScenarioWebViewEventMonitor::RecordWebResourceRequest(
+    MonitorEventRecord& record, ICoreWebView2WebResourceRequest* request)
+{
+    wil::com_ptr<IStream> content;
+    CHECK_FAILURE(request->get_Content(&content));
+    wil::com_ptr<ICoreWebView2HttpRequestHeaders> headers;
+    CHECK_FAILURE(request->get_Headers(&headers));
+    wil::unique_cotaskmem_string method;
+    CHECK_FAILURE(request->get_Method(&method));
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(request->get_Uri(&uri));
+
+    if (content)
+    {
+        record.flags |= c_monitorEventHasContent;
+    }
+    RequestHeadersToJson(BeginScratchJson(), headers.get());
+    record.headersId = InternScratchJson();
+    record.argsId = m_eventStrings.Intern(method.get());
+    record.uriId = m_eventStrings.Intern(uri.get());
+}
+
+void ScenarioWebViewEventMonitor::WriteEventString(JsonWriter& json, uint32_t id, bool asShape)
+{
+    std::wstring_view value;
+    if (!m_eventStrings.TryGet(id, &value))
+    {
+        json.Null();
+    }
+    else if (asShape && value.size() >= c_minStringRefLength)
+    {
+        WriteStringRef(json, id, false);
+    }
+    else
+    {
+        json.String(value);
+    }
+}
+
+void ScenarioWebViewEventMonitor::WriteEventJson(JsonWriter& json, uint32_t id, bool asShape)
+{
+    std::wstring_view value;
+    if (!m_eventStrings.TryGet(id, &value))
+    {
+        json.Null();
+    }
+    else if (asShape)
+    {
+        // Even short JSON is kept out of shapes: it comes from the page, and
+        // could look like a placeholder.
+        WriteStringRef(json, id, true);
+    }
+    else
+    {
+        json.RawValue(value);
+    }
+}
+
+void ScenarioWebViewEventMonitor::UseString(uint32_t id, bool isJson)
+{
+    std::vector<bool>& sentStrings = m_sentStrings[StringInterner::GetTag(id)];
+    uint32_t index = StringInterner::GetIndex(id);
+    if (index >= sentStrings.size())
+    {
+        sentStrings.resize(index + 1);
+    }
+    if (!sentStrings[index])
+    {
+        sentStrings[index] = true;
+        m_unsentStrings.push_back({id, isJson});
+    }
+}
+
+void ScenarioWebViewEventMonitor::WriteStringRef(JsonWriter& json, uint32_t id, bool isJson)
+{
+    UseString(id, isJson);
+    json.BeginObject();
+    json.Key(L"?").String(L"string");
+    json.EndObject();
+    m_shapeValues.push_back(id);
+}
+
+void ScenarioWebViewEventMonitor::WriteEventNumber(
+    JsonWriter& json, uint64_t value, bool asShape)
+{
+    if (asShape)
+    {
+        json.BeginObject();
+        json.Key(L"?").String(L"value");
+        json.EndObject();
+        m_shapeValues.push_back(value);
+    }
+    else
+    {
+        json.UInt(value);
+    }
+}
+
+void ScenarioWebViewEventMonitor::RenderEvent(
+    JsonWriter& json, const MonitorEventRecord& record, bool asShape)
+{
+    json.BeginObject();
+    json.Key(L"kind").String(L"event");
+    json.Key(L"name").String(MonitorEventKindToString(record.kind));
+    json.Key(L"args");
+
+    switch (record.kind)
+    {
+    case MonitorEventKind::NavigationStarting:
+    case MonitorEventKind::FrameNavigationStarting:
+    case MonitorEventKind::CoreWebView2FrameNavigationStarting:
+        json.BeginObject();
+        json.Key(L"navigationId");
+        WriteEventNumber(json, record.navigationId, asShape);
+        json.Key(L"cancel").Bool(record.flags & c_monitorEventCancel);
+        json.Key(L"isRedirected").Bool(record.flags & c_monitorEventIsRedirected);
+        json.Key(L"isUserInitiated").Bool(record.flags & c_monitorEventIsUserInitiated);
+        json.Key(L"requestHeaders");
+        WriteEventJson(json, record.headersId, asShape);
+        json.Key(L"uri");
+        WriteEventString(json, record.uriId, asShape);
+        json.EndObject();
+        break;
+    case MonitorEventKind::ContentLoading:
+    case MonitorEventKind::CoreWebView2FrameContentLoading:
+        json.BeginObject();
+        json.Key(L"navigationId");
+        WriteEventNumber(json, record.navigationId, asShape);
+        json.Key(L"isErrorPage").Bool(record.flags & c_monitorEventIsErrorPage);
+        json.EndObject();
+        break;
+    case MonitorEventKind::NavigationCompleted:
+    case MonitorEventKind::FrameNavigationCompleted:
+    case MonitorEventKind::CoreWebView2FrameNavigationCompleted:
+        json.BeginObject();
+        json.Key(L"navigationId");
+        WriteEventNumber(json, record.navigationId, asShape);
+        json.Key(L"isSuccess").Bool(record.flags & c_monitorEventIsSuccess);
+        json.Key(L"webErrorStatus")
+            .String(WebErrorStatusToString(
+                static_cast<COREWEBVIEW2_WEB_ERROR_STATUS>(record.value)));
+        json.EndObject();
+        break;
+    case MonitorEventKind::DOMContentLoaded:
+    case MonitorEventKind::CoreWebView2FrameDOMContentLoaded:
+        json.BeginObject();
+        json.Key(L"navigationId");
+        WriteEventNumber(json, record.navigationId, asShape);
+        json.EndObject();
+        break;
+    case MonitorEventKind::WebResourceRequested:
+    case MonitorEventKind::WebResourceResponseReceived:
+        json.BeginObject();
+        json.Key(L"request").BeginObject();
+        json.Key(L"content");
+        if (record.flags & c_monitorEventHasContent)
+        {
+            json.String(L"...");
+        }
+        else
+        {
+            json.Null();
+        }
+        json.Key(L"headers");
+        WriteEventJson(json, record.headersId, asShape);
+        json.Key(L"method");
+        WriteEventString(json, record.argsId, asShape);
+        json.Key(L"uri");
+        WriteEventString(json, record.uriId, asShape);
+        json.EndObject();
+        json.Key(L"response");
+        if (record.kind == MonitorEventKind::WebResourceResponseReceived)
+        {
+            WriteEventJson(json, record.detailId, asShape);
+        }
+        else
+        {
+            json.Null();
+        }
+        if (record.flags & c_monitorEventHasSource)
+        {
+            json.Key(L"source").String(WebResourceSourceToString(
+                static_cast<COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS>(record.value)));
+        }
+        json.EndObject();
+        break;
+    default:
+        // Everything else is rare enough that its args are stored whole.
+        WriteEventJson(json, record.argsId, asShape);
+        break;
+    }
+
+    if (record.flags & c_monitorEventHasWebView)
+    {
+        json.Key(L"webview").BeginObject();
+        json.Key(L"documentTitle");
+        WriteEventString(json, record.titleId, asShape);
+        json.Key(L"source");
+        WriteEventString(json, record.sourceId, asShape);
+        json.Key(L"canGoBack").Bool(record.flags & c_monitorEventCanGoBack);
+        json.Key(L"canGoForward").Bool(record.flags & c_monitorEventCanGoForward);
+        json.EndObject();
+    }
+    json.EndObject();
+}
+
+void ScenarioWebViewEventMonitor::EnableWebResourceResponseReceivedEvent(bool enable) {
+    if (!enable && m_webResourceResponseReceivedToken.value != 0)
+    {
+        m_webviewEventSource2->remove_WebResourceResponseReceived(m_webResourceResponseReceivedToken);
+        m_webResourceResponseReceivedToken.value = 0;
+    }
+    else if (enable && m_webResourceResponseReceivedToken.value == 0)
+    {
+        m_webviewEventSource2->add_WebResourceResponseReceived(
+            Callback<ICoreWebView2WebResourceResponseReceivedEventHandler>(
+                [this](ICoreWebView2* webview, ICoreWebView2WebResourceResponseReceivedEventArgs* args)
+                    -> HRESULT {
+                    int64_t timestamp = GetEventTimestamp();
+                    wil::com_ptr<ICoreWebView2WebResourceRequest> webResourceRequest;
+                    CHECK_FAILURE(args->get_Request(&webResourceRequest));
+                    wil::com_ptr<ICoreWebView2WebResourceResponseView>
+                        webResourceResponse;
+                    CHECK_FAILURE(args->get_Response(&webResourceResponse));
+                    //! [GetContent]
+                    webResourceResponse->GetContent(
+                        Callback<
+                            ICoreWebView2WebResourceResponseViewGetContentCompletedHandler>(
+                            [this, timestamp, webResourceRequest,
+                             webResourceResponse](HRESULT result, IStream* content) {
+                                MonitorEventRecord record = NewEventRecord(
+                                    MonitorEventKind::WebResourceResponseReceived);
+                                // The handler cost is only that of this
+                                // callback, not the wait for the content.
+                                int64_t handlerStart = record.timestamp;
+                                record.timestamp = timestamp;
+                                RecordWebResourceRequest(record, webResourceRequest.get());
+                                ResponseToJson(
+                                    BeginScratchJson(), webResourceResponse.get(), content);
+                                record.detailId = InternScratchJson();
+                                RecordEvent(record, handlerStart);
+                                return S_OK;
+                            })
+                            .Get());
+                    //! [GetContent]
+                    return S_OK;
+                })
+                .Get(),
+            &m_webResourceResponseReceivedToken);
+    }
+}
+
+void ScenarioWebViewEventMonitor::EnableWebResourceRequestedEvent(bool enable)
+{
+    if (!enable && m_webResourceRequestedToken.value != 0)
+    {
+        m_webResourceRequestedDispatcher->Remove(m_webResourceRequestedToken);
+        m_webResourceRequestedToken.value = 0;
+    }
+    else if (enable && m_webResourceRequestedToken.value == 0)
+    {
+        // The handler is added through the window's dispatcher, so that the
+        // other handlers don't run for every request this filter raises.
+        // Without ICoreWebView2_22 only the requests of documents are raised.
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds =
+            m_webviewEventSource.try_query<ICoreWebView2_22>()
+                ? COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL
+                : COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT;
+        m_webResourceRequestedDispatcher->Add(
+            L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL, sourceKinds,
+            Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+                [this](ICoreWebView2* webview, ICoreWebView2WebResourceRequestedEventArgs* args)
+                    -> HRESULT {
+                    MonitorEventRecord record =
+                        NewEventRecord(MonitorEventKind::WebResourceRequested);
+                    wil::com_ptr<ICoreWebView2WebResourceRequest> webResourceRequest;
+                    CHECK_FAILURE(args->get_Request(&webResourceRequest));
+                    wil::com_ptr<ICoreWebView2WebResourceResponse> webResourceResponse;
+                    CHECK_FAILURE(args->get_Response(&webResourceResponse));
+
+                    RecordWebResourceRequest(record, webResourceRequest.get());
+
+                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs> argsPtr = args;
+                    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2>
+                        webResourceRequestArgs =
+                            argsPtr.try_query<ICoreWebView2WebResourceRequestedEventArgs2>();
+                    if (webResourceRequestArgs)
+                    {
+                        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS requestedSourceKind =
+                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL;
+                        CHECK_FAILURE(webResourceRequestArgs->get_RequestedSourceKind(
+                            &requestedSourceKind));
+                        if (requestedSourceKind !=
+                            COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_ALL)
+                        {
+                            record.flags |= c_monitorEventHasSource;
+                            record.value = requestedSourceKind;
+                        }
+                    }
+                    RecordEvent(record);
+
+                    return S_OK;
+                })
+                .Get(),
+            &m_webResourceRequestedToken);
+    }
+}
+
+void ScenarioWebViewEventMonitor::InitializeEventView(ICoreWebView2* webviewEventView)
+{
+    m_webviewEventView = webviewEventView;
+
+    m_webviewEventView->add_WebMessageReceived(
+        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
+                -> HRESULT {
+                wil::unique_cotaskmem_string source;
+                CHECK_FAILURE(args->get_Source(&source));
+                wil::unique_cotaskmem_string webMessageAsString;
+                if (SUCCEEDED(args->TryGetWebMessageAsString(&webMessageAsString)))
+                {
+                    if (wcscmp(source.get(), m_sampleUri.c_str()) == 0)
+                    {
+                        if (wcscmp(webMessageAsString.get(), L"webResourceRequested,on") == 0)
+                        {
+                            EnableWebResourceRequestedEvent(true);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"webResourceRequested,off") == 0)
+                        {
+                            EnableWebResourceRequestedEvent(false);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"webResourceResponseReceived,on") == 0)
+                        {
+                            EnableWebResourceResponseReceivedEvent(true);
+                        }
+                        else if (
+                            wcscmp(webMessageAsString.get(), L"webResourceResponseReceived,off") == 0)
+                        {
+                            EnableWebResourceResponseReceivedEvent(false);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"trace,on") == 0)
+                        {
+                            EnableEventTrace(true);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"trace,off") == 0)
+                        {
+                            EnableEventTrace(false);
+                        }
+                        else if (wcscmp(webMessageAsString.get(), L"strings,reset") == 0)
+                        {
+                            // The event view has no strings yet.
+                            for (std::vector<bool>& sentStrings : m_sentStrings)
+                            {
+                                sentStrings.clear();
+                            }
+                        }
+                        else if (wcsncmp(webMessageAsString.get(), L"events,", 7) == 0)
+                        {
+                            // The event view wants the events from this sequence number on.
+                            RecordDeliveryDelay();
+                            m_eventBatcher.OnRangeRequested(
+                                _wcstoui64(webMessageAsString.get() + 7, nullptr, 10));
+                        }
+                    }
+                }
+
+                return S_OK;
+            })
+            .Get(),
+        &m_eventViewWebMessageReceivedToken);
+
+    SetTimer(
+        m_appWindowEventSource->GetMainWindow(), c_eventBatchTimerId,
+        static_cast<UINT>(m_eventBatcher.GetOptions().flushInterval.count()), nullptr);
+
+    m_webviewEventSource->add_WebMessageReceived(
+        Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args)
+                -> HRESULT {
+                wil::unique_cotaskmem_string source;
+                CHECK_FAILURE(args->get_Source(&source));
+                wil::unique_cotaskmem_string webMessageAsString;
+                HRESULT webMessageAsStringHR =
+                    args->TryGetWebMessageAsString(&webMessageAsString);
+                wil::unique_cotaskmem_string webMessageAsJson;
+                CHECK_FAILURE(args->get_WebMessageAsJson(&webMessageAsJson));
+
+                JsonWriter& json = BeginEventArgs(MonitorEventKind::WebMessageReceived);
+                json.Key(L"source").String(source.get());
+
+                json.Key(L"webMessageAsString");
+                if (SUCCEEDED(webMessageAsStringHR))
+                {
+                    json.String(webMessageAsString.get());
+                }
+                else
+                {
+                    json.Null();
+                }
+
+                json.Key(L"webMessageAsJson").String(webMessageAsJson.get());
+                EndEventArgs();
+
+                return S_OK;
+            })
+            .Get(),
+        &m_webMessageReceivedToken);
+
+    m_webviewEventSource->add_NewWindowRequested(
+        Callback<ICoreWebView2NewWindowRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NewWindowRequestedEventArgs* args)
+                -> HRESULT {
+                BOOL handled = FALSE;
+                CHECK_FAILURE(args->get_Handled(&handled));
+                BOOL isUserInitiated = FALSE;
+                CHECK_FAILURE(args->get_IsUserInitiated(&isUserInitiated));
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(args->get_Uri(&uri));
+
+                wil::com_ptr<ICoreWebView2NewWindowRequestedEventArgs2>
+                    args2;
+                wil::unique_cotaskmem_string name;
+
+                if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2)))) {
+                    CHECK_FAILURE(args2->get_Name(&name));
+                }
+
+                wil::com_ptr<ICoreWebView2NewWindowRequestedEventArgs3> args3;
+                wil::unique_cotaskmem_string frameName;
+                wil::unique_cotaskmem_string frameUri;
+                if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args3))))
+                {
+                    wil::com_ptr<ICoreWebView2FrameInfo> frame_info;
+                    CHECK_FAILURE(args3->get_OriginalSourceFrameInfo(&frame_info));
+                    CHECK_FAILURE(frame_info->get_Name(&frameName));
+                    CHECK_FAILURE(frame_info->get_Source(&frameUri));
+                }
+
+                JsonWriter& json = BeginEventArgs(MonitorEventKind::NewWindowRequested);
+                json.Key(L"handled").Bool(handled);
+                json.Key(L"isUserInitiated").Bool(isUserInitiated);
+                json.Key(L"uri").String(uri.get());
+                json.Key(L"name").String(name ? name.get() : L"");
+                json.Key(L"newWindow").Null();
+                json.Key(L"frameName").String(frameName ? frameName.get() : L"");
+                json.Key(L"frameUri").String(frameUri ? frameUri.get() : L"");
+                EndEventArgs();
+
+                return S_OK;
+            })
+            .Get(),
+        &m_newWindowRequestedToken);
+
+    m_webviewEventSource->add_NavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT {
+                RecordNavigationStarting(MonitorEventKind::NavigationStarting, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationStartingToken);
+
+    m_webviewEventSource->add_FrameNavigationStarting(
+        Callback<ICoreWebView2NavigationStartingEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationStartingEventArgs* args)
+                -> HRESULT {
+                RecordNavigationStarting(MonitorEventKind::FrameNavigationStarting, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationStartingToken);
+
+    m_webviewEventSource->add_SourceChanged(
+        Callback<ICoreWebView2SourceChangedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs* args)
+                -> HRESULT {
+                BOOL isNewDocument = FALSE;
+                CHECK_FAILURE(args->get_IsNewDocument(&isNewDocument));
+
+                JsonWriter& json = BeginEventArgs(MonitorEventKind::SourceChanged);
+                json.Key(L"isNewDocument").Bool(isNewDocument);
+                EndEventArgs();
+
+                return S_OK;
+            })
+            .Get(),
+        &m_sourceChangedToken);
+
+    m_webviewEventSource->add_ContentLoading(
+        Callback<ICoreWebView2ContentLoadingEventHandler>(
+            [this](
+                ICoreWebView2* sender,
+                ICoreWebView2ContentLoadingEventArgs* args) -> HRESULT {
+                RecordContentLoading(MonitorEventKind::ContentLoading, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_contentLoadingToken);
+
+    m_webviewEventSource->add_HistoryChanged(
+        Callback<ICoreWebView2HistoryChangedEventHandler>(
+            [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
+                BeginEventArgs(MonitorEventKind::HistoryChanged);
+                EndEventArgs();
+
+                return S_OK;
+            })
+            .Get(),
+        &m_historyChangedToken);
+
+    m_webviewEventSource->add_NavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT {
+                RecordNavigationCompleted(MonitorEventKind::NavigationCompleted, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_navigationCompletedToken);
+
+        m_webviewEventSource->add_FrameNavigationCompleted(
+        Callback<ICoreWebView2NavigationCompletedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args)
+                -> HRESULT {
+                RecordNavigationCompleted(MonitorEventKind::FrameNavigationCompleted, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_frameNavigationCompletedToken);
+
+    m_webviewEventSource2->add_DOMContentLoaded(
+        Callback<ICoreWebView2DOMContentLoadedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
+                -> HRESULT {
+                RecordDOMContentLoaded(MonitorEventKind::DOMContentLoaded, args);
+
+                return S_OK;
+            })
+            .Get(),
+        &m_DOMContentLoadedToken);
+
+    m_webviewEventSource->add_DocumentTitleChanged(
+        Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
+            [this](ICoreWebView2* sender, IUnknown* args) -> HRESULT {
+                BeginEventArgs(MonitorEventKind::DocumentTitleChanged);
+                EndEventArgs();
+
+                return S_OK;
+            })
+            .Get(),
+        &m_documentTitleChangedToken);
+
+    m_webviewEventSource4 = m_webviewEventSource.try_query<ICoreWebView2_4>();
+    if (m_webviewEventSource4) {
+        m_webviewEventSource4->add_DownloadStarting(
+            Callback<ICoreWebView2DownloadStartingEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2DownloadStartingEventArgs* args)
+                    -> HRESULT {
+                    wil::com_ptr<ICoreWebView2DownloadOperation> download;
+                    CHECK_FAILURE(args->get_DownloadOperation(&download));
+
+                    BOOL cancel = FALSE;
+                    CHECK_FAILURE(args->get_Cancel(&cancel));
+
+                    INT64 totalBytesToReceive = 0;
+                    CHECK_FAILURE(
+                        download->get_TotalBytesToReceive(&totalBytesToReceive));
+
+                    wil::unique_cotaskmem_string uri;
+                    CHECK_FAILURE(download->get_Uri(&uri));
+
+                    wil::unique_cotaskmem_string mimeType;
+                    CHECK_FAILURE(download->get_MimeType(&mimeType));
+
+                    wil::unique_cotaskmem_string contentDisposition;
+                    CHECK_FAILURE(download->get_ContentDisposition(&contentDisposition));
+
+                    wil::unique_cotaskmem_string resultFilePath;
+                    CHECK_FAILURE(args->get_ResultFilePath(&resultFilePath));
+
+                    COREWEBVIEW2_DOWNLOAD_STATE state;
+                    CHECK_FAILURE(download->get_State(&state));
+
+                    BOOL handled = FALSE;
+                    CHECK_FAILURE(args->get_Handled(&handled));
+
+                    download->add_StateChanged(
+                        Callback<ICoreWebView2StateChangedEventHandler>(
+                            [this, download](
+                                ICoreWebView2DownloadOperation* sender,
+                                IUnknown* args)
+                                -> HRESULT {
+                                COREWEBVIEW2_DOWNLOAD_STATE state;
+                                CHECK_FAILURE(download->get_State(&state));
+
+                                std::wstring state_string = L"";
+                                switch (state)
+                                {
+                                case COREWEBVIEW2_DOWNLOAD_STATE_IN_PROGRESS:
+                                    state_string = L"In progress";
+                                    break;
+                                case COREWEBVIEW2_DOWNLOAD_STATE_COMPLETED:
+                                    state_string = L"Complete";
+                                    download->remove_StateChanged(
+                                        m_stateChangedToken);
+                                    download->remove_BytesReceivedChanged(
+                                        m_bytesReceivedChangedToken);
+                                    download->remove_EstimatedEndTimeChanged(
+                                        m_estimatedEndTimeChanged);
+                                    break;
+                                case COREWEBVIEW2_DOWNLOAD_STATE_INTERRUPTED:
+                                    state_string = L"Interrupted";
+                                    break;
+                                }
+
+                                COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason;
+                                CHECK_FAILURE(download->get_InterruptReason(&interrupt_reason));
+                                std::wstring interrupt_reason_string =
+                                    InterruptReasonToString(interrupt_reason);
+
+                                JsonWriter& json = BeginEventArgs(MonitorEventKind::DownloadStateChanged);
+                                json.Key(L"state").String(state_string);
+                                json.Key(L"interruptReason").String(interrupt_reason_string);
+                                EndEventArgs();
+                                return S_OK;
+                            })
+                            .Get(),
+                        &m_stateChangedToken);
+
+                    download->add_BytesReceivedChanged(
+                        Callback<
+                            ICoreWebView2BytesReceivedChangedEventHandler>(
+                            [this, download](
+                                ICoreWebView2DownloadOperation* sender, IUnknown* args) -> HRESULT {
+                                INT64 bytesReceived = 0;
+                                CHECK_FAILURE(download->get_BytesReceived(
+                                    &bytesReceived));
+
+                                JsonWriter& json =
+                                    BeginEventArgs(MonitorEventKind::DownloadBytesReceivedChanged);
+                                json.Key(L"bytesReceived").Int(bytesReceived);
+                                EndEventArgs();
+                                return S_OK;
+                            })
+                            .Get(),
+                        &m_bytesReceivedChangedToken);
+
+                    download->add_EstimatedEndTimeChanged(
+                        Callback<ICoreWebView2EstimatedEndTimeChangedEventHandler>(
+                            [this, download](
+                                ICoreWebView2DownloadOperation* sender, IUnknown* args) -> HRESULT {
+                                wil::unique_cotaskmem_string estimatedEndTime;
+                                CHECK_FAILURE(download->get_EstimatedEndTime(&estimatedEndTime));
+
+                                JsonWriter& json =
+                                    BeginEventArgs(MonitorEventKind::DownloadEstimatedEndTimeChanged);
+                                json.Key(L"estimatedEndTime").String(estimatedEndTime.get());
+                                EndEventArgs();
+                                return S_OK;
+                            })
+                            .Get(),
+                        &m_estimatedEndTimeChanged);
+
+                    JsonWriter& json = BeginEventArgs(MonitorEventKind::DownloadStarting);
+                    json.Key(L"cancel").Bool(cancel);
+                    json.Key(L"resultFilePath").String(resultFilePath.get());
+                    json.Key(L"handled").Bool(handled);
+                    json.Key(L"uri").String(uri.get());
+                    json.Key(L"mimeType").String(mimeType.get());
+                    json.Key(L"contentDisposition").String(contentDisposition.get());
+                    json.Key(L"totalBytesToReceive").Int(totalBytesToReceive);
+                    EndEventArgs();
+
+                    return S_OK;
+                })
+                .Get(),
+            &m_downloadStartingToken);
+
+        m_webviewEventSource4->add_FrameCreated(
+            Callback<ICoreWebView2FrameCreatedEventHandler>(
+                [this](ICoreWebView2* sender, ICoreWebView2FrameCreatedEventArgs* args)
+                    -> HRESULT {
+                    wil::com_ptr<ICoreWebView2Frame> webviewFrame;
+                    CHECK_FAILURE(args->get_Frame(&webviewFrame));
+                    InitializeFrameEventView(webviewFrame);
+                    wil::unique_cotaskmem_string name;
+                    CHECK_FAILURE(webviewFrame->get_Name(&name));
+
+                    JsonWriter& json = BeginEventArgs(MonitorEventKind::FrameCreated);
+                    json.Key(L"frame").String(name.get());
+
+                    auto webView2_20 =
+                        wil::com_ptr<ICoreWebView2>(sender).try_query<ICoreWebView2_20>();
+                    if (webView2_20)
+                    {
+                        UINT32 frameId = 0;
+                        CHECK_FAILURE(webView2_20->get_FrameId(&frameId));
+                        json.Key(L"sender main frame id").Int(frameId);
+                    }
+                    auto frame5 = webviewFrame.try_query<ICoreWebView2Frame5>();
+                    if (frame5)
+                    {
+                        UINT32 frameId = 0;
+                        CHECK_FAILURE(frame5->get_FrameId(&frameId));
+                        json.Key(L"frame id").Int(frameId);
+                    }
+                    EndEventArgs();
+
+                    return S_OK;
+                })
+                .Get(),
+            &m_frameCreatedToken);
+    }
+
+    m_controllerEventSource->add_GotFocus(
+        Callback<ICoreWebView2FocusChangedEventHandler>(
+            [this](ICoreWebView2Controller* sender, IUnknown* args)
+                -> HRESULT {
+                BeginEventArgs(MonitorEventKind::GotFocus);
+                EndEventArgs(false);
+                return S_OK;
+            })
+            .Get(),
+        &m_gotFocusToken);
+    m_controllerEventSource->add_LostFocus(
+        Callback<ICoreWebView2FocusChangedEventHandler>(
+            [this](ICoreWebView2Controller* sender, IUnknown* args)
+                -> HRESULT {
+                BeginEventArgs(MonitorEventKind::LostFocus);
+                EndEventArgs(false);
+                return S_OK;
+            })
+            .Get(),
+        &m_lostFocusToken);
+
+    m_webViewEventSource9 = m_webviewEventSource.try_query<ICoreWebView2_9>();
+    if (m_webViewEventSource9)
+    {
+        m_webViewEventSource9->add_IsDefaultDownloadDialogOpenChanged(
+            Callback<ICoreWebView2IsDefaultDownloadDialogOpenChangedEventHandler>(
+                [this](
+                    ICoreWebView2* sender, IUnknown* args) -> HRESULT {
+                    BOOL isOpen;
+                    m_webViewEventSource9->get_IsDefaultDownloadDialogOpen(&isOpen);
+                    JsonWriter& json = BeginEventArgs(MonitorEventKind::IsDefaultDownloadDialogOpenChanged);
+                    json.Key(L"isDefaultDownloadDialogOpen").Bool(isOpen);
+                    EndEventArgs();
+                    return S_OK;
+                })
+                .Get(),
+            &m_isDefaultDownloadDialogOpenChangedToken);
+    }
+
+    m_webviewEventSource->add_PermissionRequested(
+        Callback<ICoreWebView2PermissionRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2PermissionRequestedEventArgs* args)
+                -> HRESULT
+            {
+                wil::unique_cotaskmem_string uri;
+                CHECK_FAILURE(args->get_Uri(&uri));
+                COREWEBVIEW2_PERMISSION_KIND kind;
+                CHECK_FAILURE(args->get_PermissionKind(&kind));
+                COREWEBVIEW2_PERMISSION_STATE state;
+                CHECK_FAILURE(args->get_State(&state));
+                wil::com_ptr<ICoreWebView2PermissionRequestedEventArgs3> extended_args;
+                CHECK_FAILURE(args->QueryInterface(IID_PPV_ARGS(&extended_args)));
+                BOOL saves_in_profile = TRUE;
+                CHECK_FAILURE(extended_args->get_SavesInProfile(&saves_in_profile));
+                JsonWriter& json = BeginEventArgs(MonitorEventKind::PermissionRequested);
+                json.Key(L"uri").String(uri.get());
+                json.Key(L"kind").String(PermissionKindToString(kind));
+                json.Key(L"state").String(PermissionStateToString(state));
+                json.Key(L"SavesInProfile").Bool(saves_in_profile);
+                EndEventArgs();
+                return S_OK;
+            })
+            .Get(),
+        &m_permissionRequestedToken);
+}
+
+void ScenarioWebViewEventMonitor::InitializeFrameEventView(
+    wil::com_ptr<ICoreWebView2Frame> webviewFrame)
+{
+    webviewFrame->add_Destroyed(
+        Callback<ICoreWebView2FrameDestroyedEventHandler>(
+            [this](ICoreWebView2Frame* sender, IUnknown* args) -> HRESULT {
+                BeginEventArgs(MonitorEventKind::CoreWebView2FrameDestroyed);
+                EndEventArgs();
+                return S_OK;
+            })
+            .Get(),
+        NULL);
+
+    wil::com_ptr<ICoreWebView2Frame2> frame2 = webviewFrame.try_query<ICoreWebView2Frame2>();
+    if (frame2)
+    {
+        frame2->add_NavigationStarting(
+            Callback<ICoreWebView2FrameNavigationStartingEventHandler>(
+                [this](
+                    ICoreWebView2Frame* sender,
+                    ICoreWebView2NavigationStartingEventArgs* args) -> HRESULT {
+                    RecordNavigationStarting(MonitorEventKind::CoreWebView2FrameNavigationStarting, args);
+
+                    return S_OK;
+                })
+                .Get(),
+            NULL);
+
+        frame2->add_ContentLoading(
+            Callback<ICoreWebView2FrameContentLoadingEventHandler>(
+                [this](ICoreWebView2Frame* sender, ICoreWebView2ContentLoadingEventArgs* args)
+                    -> HRESULT {
+                    RecordContentLoading(MonitorEventKind::CoreWebView2FrameContentLoading, args);
+
+                    return S_OK;
+                })
+                .Get(),
+            NULL);
+
+        frame2->add_NavigationCompleted(
+            Callback<ICoreWebView2FrameNavigationCompletedEventHandler>(
+                [this](
+                    ICoreWebView2Frame* sender,
+                    ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
+                    RecordNavigationCompleted(MonitorEventKind::CoreWebView2FrameNavigationCompleted, args);
+
+                    return S_OK;
+                })
+                .Get(),
+            NULL);
+
+        frame2->add_DOMContentLoaded(
+            Callback<ICoreWebView2FrameDOMContentLoadedEventHandler>(
+                [this](ICoreWebView2Frame* sender, ICoreWebView2DOMContentLoadedEventArgs* args)
+                    -> HRESULT {
+                    RecordDOMContentLoaded(MonitorEventKind::CoreWebView2FrameDOMContentLoaded, args);
+
+                    return S_OK;
+                })
+                .Get(),
+            NULL);
+    }
+}
+
+bool ScenarioWebViewEventMonitor::HandleWindowMessage(
+    HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result)
+{
+    if (message == WM_TIMER && wParam == c_eventBatchTimerId)
+    {
+        m_eventBatcher.OnTick();
+        WriteEventTrace();
+        ReleaseEventStrings();
+        return true;
+    }
+    return false;
+}
+
+void ScenarioWebViewEventMonitor::EnableEventTrace(bool enable)
+{
+    if (!enable && m_eventTrace.IsOpen())
+    {
+        WriteEventTrace();
+        m_eventTrace.Close();
+    }
+    else if (enable && !m_eventTrace.IsOpen())
+    {
+        SYSTEMTIME now;
+        GetLocalTime(&now);
+        WCHAR fileName[MAX_PATH];
+        swprintf_s(
+            fileName, L"EventMonitor-%04u%02u%02u-%02u%02u%02u.wv2trace", now.wYear,
+            now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+        m_eventTracePath = m_appWindowEventSource->GetUserDataFolder() + L"\\" + fileName;
+        if (!m_eventTrace.Open(m_eventTracePath))
+        {
+            ShowFailure(
+                HRESULT_FROM_WIN32(GetLastError()),
+                L"Failed to create event trace " + m_eventTracePath);
+        }
+        // Only events from now on are traced.
+        m_eventTraceNext = m_eventRing.End();
+    }
+
+    JsonWriter& json = m_eventJson;
+    json.Reset();
+    json.BeginObject();
+    json.Key(L"kind").String(L"trace");
+    json.Key(L"path");
+    if (m_eventTrace.IsOpen())
+    {
+        json.String(m_eventTracePath);
+    }
+    else
+    {
+        json.Null();
+    }
+    json.EndObject();
+    if (m_webviewEventView)
+    {
+        m_webviewEventView->PostWebMessageAsJson(json.GetString().c_str());
+    }
+}
+
+void ScenarioWebViewEventMonitor::WriteEventTrace()
+{
+    if (!m_eventTrace.IsOpen())
+    {
+        return;
+    }
+    // The ring holds far more events than fire between two ticks, so records
+    // are only overwritten before they are traced under extreme load.
+    uint64_t end = m_eventRing.End();
+    for (uint64_t sequence = (std::max)(m_eventTraceNext, m_eventRing.Begin()); sequence < end;
+         ++sequence)
+    {
+        MonitorEventRecord record;
+        if (!m_eventRing.TryRead(sequence, &record))
+        {
+            continue;
+        }
+        EventTraceEvent event = {};
+        event.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::duration(record.timestamp))
+                              .count();
+        event.navigationId = record.navigationId;
+        event.kind = static_cast<uint16_t>(record.kind);
+        event.flags = record.flags;
+        std::wstring_view uri;
+        m_eventStrings.TryGet(record.uriId, &uri);
+        m_traceJson.Reset();
+        RenderEvent(m_traceJson, record, false);
+        if (!m_eventTrace.Append(event, uri, m_traceJson.GetString()))
+        {
+            m_eventTrace.Close();
+            ShowFailure(E_FAIL, L"Failed to write event trace " + m_eventTracePath);
+            break;
+        }
+    }
+    m_eventTraceNext = end;
+}
+
+void ScenarioWebViewEventMonitor::ReleaseEventStrings()
+{
+    uint64_t consumed = m_eventViewNext;
+    if (m_eventTrace.IsOpen())
+    {
+        consumed = (std::min)(consumed, m_eventTraceNext);
+    }
+    consumed = (std::max)(consumed, m_eventRing.Begin());
+    uint64_t oldest = m_eventStrings.GetOldestGeneration();
+    while (!m_stringReleases.empty() && m_stringReleases.front().sequence < consumed)
+    {
+        m_eventStrings.ReleaseGenerationsBefore(m_stringReleases.front().generation);
+        m_eventStringsBegin = m_stringReleases.front().sequence + 1;
+        m_stringReleases.pop_front();
+    }
+    // The event view drops its copies of the released strings with the next
+    // batch, before it is sent any string whose generation reuses the tag.
+    for (; oldest < m_eventStrings.GetOldestGeneration(); ++oldest)
+    {
+        uint32_t tag = StringInterner::GetGenerationTag(oldest);
+        m_sentStrings[tag].clear();
+        m_releasedStringTags.push_back(tag);
+    }
+}
+
+void ScenarioWebViewEventMonitor::WriteEventWithShape(
+    JsonWriter& json, const MonitorEventRecord& record)
+{
+    m_shapeJson.Reset();
+    m_shapeValues.clear();
+    RenderEvent(m_shapeJson, record, true);
+    uint32_t shapeId = m_eventStrings.Intern(m_shapeJson.GetString());
+    if (shapeId == StringInterner::c_noString)
+    {
+        // No room for the shape until the view catches up; send it whole.
+        RenderEvent(json, record, false);
+        return;
+    }
+    UseString(shapeId, true);
+    json.BeginArray();
+    json.UInt(shapeId);
+    for (uint64_t value : m_shapeValues)
+    {
+        json.UInt(value);
+    }
+    json.EndArray();
+}
+
+void ScenarioWebViewEventMonitor::PostEventBatch(uint64_t first, size_t count, uint64_t dropped)
+{
+    m_eventViewNext = first + count;
+    // The event view may ask again for records it was already sent, such as
+    // after a reload, but the strings of the older ones may be gone.
+    if (first < m_eventStringsBegin)
+    {
+        size_t skipped =
+            static_cast<size_t>((std::min)(m_eventStringsBegin - first, uint64_t(count)));
+        first += skipped;
+        count -= skipped;
+        dropped += skipped;
+    }
+
+    JsonWriter& json = m_eventJson;
+    json.Reset();
+    json.BeginObject();
+    json.Key(L"kind").String(L"events");
+    json.Key(L"next").UInt(first + count);
+    json.Key(L"released").BeginArray();
+    for (uint32_t tag : m_releasedStringTags)
+    {
+        json.UInt(tag);
+    }
+    m_releasedStringTags.clear();
+    json.EndArray();
+    json.Key(L"events").BeginArray();
+    if (dropped != 0)
+    {
+        json.BeginObject();
+        json.Key(L"kind").String(L"dropped");
+        json.Key(L"count").UInt(dropped);
+        json.EndObject();
+    }
+    int64_t now = GetEventTimestamp();
+    for (uint64_t sequence = first; sequence < first + count; ++sequence)
+    {
+        MonitorEventRecord record;
+        if (m_eventRing.TryRead(sequence, &record))
+        {
+            WriteEventWithShape(json, record);
+            size_t kind = static_cast<size_t>(record.kind);
+            m_eventLatency[kind].queueing.Record(TicksToNanoseconds(now - record.timestamp));
+            ++m_unacknowledgedEvents[kind];
+        }
+    }
+    json.EndArray();
+
+    // Define the strings the events above refer to for the first time.
+    json.Key(L"strings").BeginObject();
+    for (const UnsentString& string : m_unsentStrings)
+    {
+        json.Key(string.id);
+        if (string.isJson)
+        {
+            WriteEventJson(json, string.id, false);
+        }
+        else
+        {
+            WriteEventString(json, string.id, false);
+        }
+    }
+    m_unsentStrings.clear();
+    json.EndObject();
+    json.EndObject();
+
+    HRESULT hr = m_webviewEventView->PostWebMessageAsJson(json.GetString().c_str());
+    if (FAILED(hr))
+    {
+        ShowFailure(hr, L"PostWebMessageAsJson failed");
+    }
+    m_batchPostTime = GetEventTimestamp();
+}
+
+void ScenarioWebViewEventMonitor::RecordDeliveryDelay()
+{
+    if (m_batchPostTime == 0)
+    {
+        return;
+    }
+    uint64_t delay = TicksToNanoseconds(GetEventTimestamp() - m_batchPostTime);
+    for (size_t kind = 0; kind < m_unacknowledgedEvents.size(); ++kind)
+    {
+        m_eventLatency[kind].delivery.Record(delay, m_unacknowledgedEvents[kind]);
+    }
+    m_unacknowledgedEvents = {};
+    m_batchPostTime = 0;
+}
+
+void ScenarioWebViewEventMonitor::WriteLatencyJson(JsonWriter& json)
+{
+    auto writeHistogram = [&json](const wchar_t* name, const LatencyHistogram& histogram)
+    {
+        json.Key(name).BeginObject();
+        json.Key(L"count").UInt(histogram.GetCount());
+        json.Key(L"min").UInt(histogram.GetMin());
+        json.Key(L"mean").UInt(static_cast<uint64_t>(histogram.GetMean()));
+        json.Key(L"p50").UInt(histogram.GetValueAtPercentile(50));
+        json.Key(L"p90").UInt(histogram.GetValueAtPercentile(90));
+        json.Key(L"p99").UInt(histogram.GetValueAtPercentile(99));
+        json.Key(L"p999").UInt(histogram.GetValueAtPercentile(99.9));
+        json.Key(L"max").UInt(histogram.GetMax());
+        json.EndObject();
+    };
+
+    json.BeginObject();
+    json.Key(L"unit").String(L"ns");
+    json.Key(L"kinds").BeginObject();
+    for (size_t kind = 0; kind < static_cast<size_t>(MonitorEventKind::Count); ++kind)
+    {
+        const EventLatency& latency = m_eventLatency[kind];
+        if (latency.handler.GetCount() == 0)
+        {
+            continue;
+        }
+        json.Key(MonitorEventKindToString(static_cast<MonitorEventKind>(kind))).BeginObject();
+        writeHistogram(L"handler", latency.handler);
+        writeHistogram(L"queueing", latency.queueing);
+        writeHistogram(L"delivery", latency.delivery);
+        json.EndObject();
+    }
+    json.EndObject();
+    json.EndObject();
+}
+
+void ScenarioWebViewEventMonitor::ShowLatencyReport()
+{
+    std::wstring path =
+        m_appWindowEventSource->GetUserDataFolder() + L"\\" + c_latencyReportFileName;
+    JsonWriter json;
+    WriteLatencyJson(json);
+    std::string utf8(json.GetString().size() * 4, '\0');
+    utf8.resize(WriteUtf8(json.GetString(), &utf8[0]));
+    wil::unique_hfile file(CreateFileW(
+        path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+        nullptr));
+    DWORD written = 0;
+    bool saved = file && WriteFile(
+                             file.get(), utf8.data(), static_cast<DWORD>(utf8.size()),
+                             &written, nullptr);
+    if (!saved)
+    {
+        ShowFailure(
+            HRESULT_FROM_WIN32(GetLastError()), L"Failed to write latency report " + path);
+    }
+
+    // Percentiles in microseconds, for the kinds that have fired.
+    std::wstring report = L"p50 / p99 in microseconds: handler, queueing, delivery\n\n";
+    for (size_t kind = 0; kind < static_cast<size_t>(MonitorEventKind::Count); ++kind)
+    {
+        const EventLatency& latency = m_eventLatency[kind];
+        if (latency.handler.GetCount() == 0)
+        {
+            continue;
+        }
+        WCHAR line[256];
+        auto p = [](const LatencyHistogram& histogram, double percentile)
+        { return histogram.GetValueAtPercentile(percentile) / 1000.0; };
+        swprintf_s(
+            line, L"%s (%llu): %.0f / %.0f, %.0f / %.0f, %.0f / %.0f\n",
+            MonitorEventKindToString(static_cast<MonitorEventKind>(kind)),
+            static_cast<unsigned long long>(latency.handler.GetCount()), p(latency.handler, 50),
+            p(latency.handler, 99), p(latency.queueing, 50), p(latency.queueing, 99),
+            p(latency.delivery, 50), p(latency.delivery, 99));
+        report += line;
+    }
+    if (saved)
+    {
+        report += L"\nSaved to " + path;
+    }
+    MessageBox(
+        m_appWindowEventSource->GetMainWindow(), report.c_str(), L"Event Monitor Latency",
+        MB_OK);
+}
+
+std::wstring ScenarioWebViewEventMonitor::InterruptReasonToString(
+    const COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason)
+{
+    std::wstring interrupt_reason_string = L"";
+    switch (interrupt_reason)
+    {
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NONE:
+        interrupt_reason_string = L"None";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_FAILED:
+        interrupt_reason_string = L"File failed";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_ACCESS_DENIED:
+        interrupt_reason_string = L"File access denied";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_NO_SPACE:
+        interrupt_reason_string = L"File no space";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_NAME_TOO_LONG:
+        interrupt_reason_string = L"File name too long";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TOO_LARGE:
+        interrupt_reason_string = L"File too large";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_MALICIOUS:
+        interrupt_reason_string = L"File malicious";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TRANSIENT_ERROR:
+        interrupt_reason_string = L"File transient error";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_BLOCKED_BY_POLICY:
+        interrupt_reason_string = L"File blocked by policy";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_SECURITY_CHECK_FAILED:
+        interrupt_reason_string = L"File security check failed";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_TOO_SHORT:
+        interrupt_reason_string = L"File too short";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_FILE_HASH_MISMATCH:
+        interrupt_reason_string = L"File hash mismatch";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_FAILED:
+        interrupt_reason_string = L"Network failed";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_TIMEOUT:
+        interrupt_reason_string = L"Network timeout";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_DISCONNECTED:
+        interrupt_reason_string = L"Network disconnected";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_SERVER_DOWN:
+        interrupt_reason_string = L"Network server down";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_NETWORK_INVALID_REQUEST:
+        interrupt_reason_string = L"Network invalid request";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_FAILED:
+        interrupt_reason_string = L"Server failed";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_NO_RANGE:
+        interrupt_reason_string = L"Server no range";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_BAD_CONTENT:
+        interrupt_reason_string = L"Server bad content";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_UNAUTHORIZED:
+        interrupt_reason_string = L"Server unauthorized";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CERTIFICATE_PROBLEM:
+        interrupt_reason_string = L"Server certificate problem";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_FORBIDDEN:
+        interrupt_reason_string = L"Server forbidden";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_UNEXPECTED_RESPONSE:
+        interrupt_reason_string = L"Server unexpected response";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CONTENT_LENGTH_MISMATCH:
+        interrupt_reason_string = L"Server content length mismatch";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_SERVER_CROSS_ORIGIN_REDIRECT:
+        interrupt_reason_string = L"Server cross origin redirect";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_CANCELED:
+        interrupt_reason_string = L"User canceled";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_SHUTDOWN:
+        interrupt_reason_string = L"User shutdown";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_USER_PAUSED:
+        interrupt_reason_string = L"User paused";
+        break;
+    case COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON_DOWNLOAD_PROCESS_CRASHED:
+        interrupt_reason_string = L"Download process crashed";
+        break;
+    }
+    return interrupt_reason_string;
+}
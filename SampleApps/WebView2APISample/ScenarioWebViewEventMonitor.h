@@ -1,79 +1,224 @@
-// Copyright (C) Microsoft Corporation. All rights reserved.
-// Use of this source code is governed by a BSD-style license that can be
-// found in the LICENSE file.
-
-#pragma once
-
-#include "stdafx.h"
-
-#include <string>
-#include "ComponentBase.h"
-
-std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status);
-
-// The event monitor examines events from the m_appWindowEventSource and
-// m_webviewEventSource and displays the details of those events in
-// m_appWindowEventView and m_webviewEventView.
-class ScenarioWebViewEventMonitor : public ComponentBase
-{
-public:
-    ScenarioWebViewEventMonitor(AppWindow* appWindowEventSource);
-    ~ScenarioWebViewEventMonitor() override;
-
-    void InitializeEventView(ICoreWebView2* webviewEventView);
-
-private:
-    void InitializeFrameEventView(wil::com_ptr<ICoreWebView2Frame> webviewFrame);
-    // Because WebResourceRequested fires so much more often than
-    // all other events, we default to it off and it is configurable.
-    void EnableWebResourceRequestedEvent(bool enable);
-
-    void EnableWebResourceResponseReceivedEvent(bool enable);
-    // Send information about an event to the event view.
-    void PostEventMessage(std::wstring messageAsJson);
-
-    std::wstring InterruptReasonToString(const COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason);
-
-    // The event view displays the events and their details.
-    AppWindow* m_appWindowEventView;
-    wil::com_ptr<ICoreWebView2> m_webviewEventView;
-    // The URI of the HTML document that displays the events.
-    std::wstring m_sampleUri;
-
-    // The event source objects fire the events.
-    AppWindow* m_appWindowEventSource;
-    wil::com_ptr<ICoreWebView2> m_webviewEventSource;
-    wil::com_ptr<ICoreWebView2Controller> m_controllerEventSource;
-    wil::com_ptr<ICoreWebView2_2> m_webviewEventSource2;
-    wil::com_ptr<ICoreWebView2_4> m_webviewEventSource4;
-    wil::com_ptr<ICoreWebView2_9> m_webViewEventSource9;
-
-    // The events we register on the event sources
-    EventRegistrationToken m_frameNavigationStartingToken = {};
-    EventRegistrationToken m_frameNavigationCompletedToken = {};
-    EventRegistrationToken m_navigationStartingToken = {};
-    EventRegistrationToken m_sourceChangedToken = {};
-    EventRegistrationToken m_contentLoadingToken = {};
-    EventRegistrationToken m_historyChangedToken = {};
-    EventRegistrationToken m_navigationCompletedToken = {};
-    EventRegistrationToken m_DOMContentLoadedToken = {};
-    EventRegistrationToken m_documentTitleChangedToken = {};
-    EventRegistrationToken m_webMessageReceivedToken = {};
-    EventRegistrationToken m_webResourceRequestedToken = {};
-    EventRegistrationToken m_newWindowRequestedToken = {};
-    EventRegistrationToken m_webResourceResponseReceivedToken = {};
-    EventRegistrationToken m_downloadStartingToken = {};
-    EventRegistrationToken m_stateChangedToken = {};
-    EventRegistrationToken m_bytesReceivedChangedToken = {};
-    EventRegistrationToken m_estimatedEndTimeChanged = {};
-    EventRegistrationToken m_frameCreatedToken = {};
-    EventRegistrationToken m_gotFocusToken = {};
-    EventRegistrationToken m_lostFocusToken = {};
-    EventRegistrationToken m_isDefaultDownloadDialogOpenChangedToken = {};
-    EventRegistrationToken m_permissionRequestedToken = {};
-
-    // This event is registered with the event viewer so they
-    // can communicate back to us for toggling the WebResourceRequested
-    // event.
-    EventRegistrationToken m_eventViewWebMessageReceivedToken = {};
-};
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include "ComponentBase.h"
+#include "EventBatcher.h"
+#include "EventRing.h"
+#include "EventTrace.h"
+#include "JsonWriter.h"
+#include "LatencyHistogram.h"
+#include "MonitorEvent.h"
+#include "StringInterner.h"
+
+std::wstring WebErrorStatusToString(COREWEBVIEW2_WEB_ERROR_STATUS status);
+
+// The event monitor examines events from the m_appWindowEventSource and
+// m_webviewEventSource and displays the details of those events in
+// m_appWindowEventView and m_webviewEventView.
+class ScenarioWebViewEventMonitor : public ComponentBase
+{
+public:
+    ScenarioWebViewEventMonitor(AppWindow* appWindowEventSource);
+    ~ScenarioWebViewEventMonitor() override;
+
+    void InitializeEventView(ICoreWebView2* webviewEventView);
+
+    bool HandleWindowMessage(
+        HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam, LRESULT* result) override;
+
+    // Show the latency percentiles of each event kind, and save them as JSON
+    // in the user data folder.
+    void ShowLatencyReport();
+
+private:
+    void InitializeFrameEventView(wil::com_ptr<ICoreWebView2Frame> webviewFrame);
+    // Because WebResourceRequested fires so much more often than
+    // all other events, we default to it off and it is configurable.
+    void EnableWebResourceRequestedEvent(bool enable);
+
+    void EnableWebResourceResponseReceivedEvent(bool enable);
+    // Create a record of an event, with the event source's properties unless
+    // includeWebViewProperties is false.
+    MonitorEventRecord NewEventRecord(MonitorEventKind kind, bool includeWebViewProperties = true);
+    // Add a record to m_eventRing and let the batcher know it is there. The
+    // handler cost is measured from handlerStart, or from the record's
+    // timestamp if it is 0.
+    void RecordEvent(const MonitorEventRecord& record, int64_t handlerStart = 0);
+    // Write a JSON fragment in m_scratchJson, then intern it.
+    JsonWriter& BeginScratchJson();
+    uint32_t InternScratchJson();
+    // Events that fire rarely keep their whole args object as JSON. The
+    // returned writer is positioned inside the "args" object.
+    JsonWriter& BeginEventArgs(MonitorEventKind kind);
+    void EndEventArgs(bool includeWebViewProperties = true);
+    // Navigation and web resource events fire often enough that they are
+    // recorded field by field.
+    void RecordNavigationStarting(
+        MonitorEventKind kind, ICoreWebView2NavigationStartingEventArgs* args);
+    void RecordContentLoading(MonitorEventKind kind, ICoreWebView2ContentLoadingEventArgs* args);
+    void RecordNavigationCompleted(
+        MonitorEventKind kind, ICoreWebView2NavigationCompletedEventArgs* args);
+    void RecordDOMContentLoaded(
+        MonitorEventKind kind, ICoreWebView2DOMContentLoadedEventArgs* args);
+    void RecordWebResourceRequest(
+        MonitorEventRecord& record, ICoreWebView2WebResourceRequest* request);
+    // Write an interned string, or null if it has been evicted. With asShape,
+    // JSON values and long strings are written as {"?":"string"} placeholders
+    // and their ids are appended to m_shapeValues; the event view looks them
+    // up in the "strings" of its batches.
+    void WriteEventString(JsonWriter& json, uint32_t id, bool asShape);
+    void WriteEventJson(JsonWriter& json, uint32_t id, bool asShape);
+    void WriteStringRef(JsonWriter& json, uint32_t id, bool isJson);
+    // Add a string to the "strings" of the batch being written, unless the
+    // event view already has it.
+    void UseString(uint32_t id, bool isJson);
+    // Write a number that differs from one event to the next, such as a
+    // navigation id. With asShape it is written as a {"?":"value"} placeholder
+    // and appended to m_shapeValues.
+    void WriteEventNumber(JsonWriter& json, uint64_t value, bool asShape);
+    // Write the event message the event view displays for a record. With
+    // asShape, what varies from one event to the next is left out, so that
+    // events of the same kind and flags mostly render the same shape.
+    void RenderEvent(JsonWriter& json, const MonitorEventRecord& record, bool asShape);
+    // Start or stop saving every event to a trace file in the user data
+    // folder. The event view is told the path of the trace.
+    void EnableEventTrace(bool enable);
+    // Append the events recorded since the last call to the trace file.
+    void WriteEventTrace();
+    // Release the generations of m_eventStrings that only records the event
+    // view and the trace are done with refer to.
+    void ReleaseEventStrings();
+    // Write a record to a batch as its shape and placeholder values.
+    void WriteEventWithShape(JsonWriter& json, const MonitorEventRecord& record);
+    // Send the recorded events [first, first + count) to the event view.
+    void PostEventBatch(uint64_t first, size_t count, uint64_t dropped);
+    // Called when the event view asks for more events, which it does once it
+    // has displayed the last batch.
+    void RecordDeliveryDelay();
+    void WriteLatencyJson(JsonWriter& json);
+
+    std::wstring InterruptReasonToString(const COREWEBVIEW2_DOWNLOAD_INTERRUPT_REASON interrupt_reason);
+
+    // The event view displays the events and their details.
+    AppWindow* m_appWindowEventView;
+    wil::com_ptr<ICoreWebView2> m_webviewEventView;
+    // The URI of the HTML document that displays the events.
+    std::wstring m_sampleUri;
+    // Event handlers only append a fixed-size record to m_eventRing; the
+    // strings it refers to are kept in m_eventStrings. Records are turned into
+    // JSON when the event view asks for them, so events that are overwritten
+    // before then are never rendered.
+    EventRing<MonitorEventRecord> m_eventRing;
+    StringInterner m_eventStrings;
+    // A generation of m_eventStrings is only released once the records that
+    // may refer to it have been rendered or overwritten: the generations
+    // before generation may be referred to by the records up to sequence.
+    struct StringRelease
+    {
+        uint64_t generation;
+        uint64_t sequence;
+    };
+    std::deque<StringRelease> m_stringReleases;
+    uint64_t m_recordedGeneration = 0;
+    // Records before this may refer to released strings, so they aren't
+    // rendered again if the event view asks for them.
+    uint64_t m_eventStringsBegin = 0;
+    // The event view has been sent the records before this.
+    uint64_t m_eventViewNext = 0;
+    // Batches sent to the event view are written here. Its buffer is reused
+    // from one batch to the next.
+    JsonWriter m_eventJson;
+    // Headers, args and other JSON fragments are written here before they are
+    // interned.
+    JsonWriter m_scratchJson;
+    MonitorEventKind m_argsKind = MonitorEventKind::Count;
+    int64_t m_argsTimestamp = 0;
+    // The event view is sent each event as an array: the id of its shape, an
+    // interned string that the view is sent once, then the values of the
+    // shape's placeholders. Shapes are rendered here.
+    JsonWriter m_shapeJson;
+    std::vector<uint64_t> m_shapeValues;
+    // Which strings the event view already has, indexed by generation tag and
+    // StringInterner::GetIndex, the ones the batch being written refers to for
+    // the first time, and the tags released since the last batch.
+    struct UnsentString
+    {
+        uint32_t id;
+        bool isJson;
+    };
+    std::array<std::vector<bool>, StringInterner::c_tagCount> m_sentStrings;
+    std::vector<UnsentString> m_unsentStrings;
+    std::vector<uint32_t> m_releasedStringTags;
+    // The event view pulls events in batches: it asks for the events after
+    // the last one it has, and the request is answered from a timer on the
+    // event source window, so a busy page doesn't flood the event view with
+    // one cross-process message per event.
+    EventBatcher m_eventBatcher;
+    // Optional trace of all events, for sessions too long to keep in the ring.
+    // Events are rendered into m_traceJson and appended from the batch timer.
+    EventTraceWriter m_eventTrace;
+    std::wstring m_eventTracePath;
+    JsonWriter m_traceJson;
+    uint64_t m_eventTraceNext = 0;
+    // Latencies of each event kind, in nanoseconds: the time spent in the
+    // event handler, from the handler to the batch that sends the event, and
+    // from sending the batch to the event view asking for the next one.
+    struct EventLatency
+    {
+        LatencyHistogram handler;
+        LatencyHistogram queueing;
+        LatencyHistogram delivery;
+    };
+    std::unique_ptr<EventLatency[]> m_eventLatency;
+    // Events of each kind in the batch the event view hasn't acknowledged,
+    // and when it was sent, or 0.
+    std::array<uint32_t, static_cast<size_t>(MonitorEventKind::Count)> m_unacknowledgedEvents = {};
+    int64_t m_batchPostTime = 0;
+
+    // The event source objects fire the events.
+    AppWindow* m_appWindowEventSource;
+    wil::com_ptr<ICoreWebView2> m_webviewEventSource;
+    wil::com_ptr<ICoreWebView2Controller> m_controllerEventSource;
+    wil::com_ptr<ICoreWebView2_2> m_webviewEventSource2;
+    wil::com_ptr<ICoreWebView2_4> m_webviewEventSource4;
+    wil::com_ptr<ICoreWebView2_9> m_webViewEventSource9;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
+
+    // The events we register on the event sources
+    EventRegistrationToken m_frameNavigationStartingToken = {};
+    EventRegistrationToken m_frameNavigationCompletedToken = {};
+    EventRegistrationToken m_navigationStartingToken = {};
+    EventRegistrationToken m_sourceChangedToken = {};
+    EventRegistrationToken m_contentLoadingToken = {};
+    EventRegistrationToken m_historyChangedToken = {};
+    EventRegistrationToken m_navigationCompletedToken = {};
+    EventRegistrationToken m_DOMContentLoadedToken = {};
+    EventRegistrationToken m_documentTitleChangedToken = {};
+    EventRegistrationToken m_webMessageReceivedToken = {};
+    EventRegistrationToken m_webResourceRequestedToken = {};
+    EventRegistrationToken m_newWindowRequestedToken = {};
+    EventRegistrationToken m_webResourceResponseReceivedToken = {};
+    EventRegistrationToken m_downloadStartingToken = {};
+    EventRegistrationToken m_stateChangedToken = {};
+    EventRegistrationToken m_bytesReceivedChangedToken = {};
+    EventRegistrationToken m_estimatedEndTimeChanged = {};
+    EventRegistrationToken m_frameCreatedToken = {};
+    EventRegistrationToken m_gotFocusToken = {};
+    EventRegistrationToken m_lostFocusToken = {};
+    EventRegistrationToken m_isDefaultDownloadDialogOpenChangedToken = {};
+    EventRegistrationToken m_permissionRequestedToken = {};
+
+    // This event is registered with the event viewer so they
+    // can communicate back to us for toggling the WebResourceRequested
+    // event.
+    EventRegistrationToken m_eventViewWebMessageReceivedToken = {};
+};
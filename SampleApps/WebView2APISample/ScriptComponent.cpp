@@ -5,6 +5,8 @@
 #include "stdafx.h"
 
 #include <algorithm>
+#include <chrono>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -14,10 +16,71 @@
 #include "ScriptComponent.h"
 
 #include "CheckFailure.h"
+#include "EventTrace.h"
+#include "JsonReader.h"
+#include "JsonWriter.h"
 #include "TextInputDialog.h"
+#include "Url.h"
 
 using namespace Microsoft::WRL;
 
+// Timer for timing out DevTools protocol commands.
+static constexpr UINT_PTR c_cdpCommandTimerId = 0x43445043;
+// How long each target has to report its heap usage.
+static constexpr std::chrono::milliseconds c_heapUsageTimeout{5000};
+// Timer for taking heap samples.
+static constexpr UINT_PTR c_heapSamplingTimerId = 0x48454150;
+
+// Read the sizes from the result of Runtime.getHeapUsage. The sizes are numbers
+// of bytes, which the protocol types as doubles.
+static bool ParseHeapUsage(const std::wstring& resultJson, double* usedSize, double* totalSize)
+{
+    JsonDocument json;
+    return json.Parse(resultJson) && json.GetRoot()[L"usedSize"].GetDouble(usedSize) &&
+           json.GetRoot()[L"totalSize"].GetDouble(totalSize);
+}
+
+// Write text to a file as UTF-8, replacing the file.
+static bool WriteUtf8File(const std::wstring& path, std::wstring_view text)
+{
+    std::string utf8(text.size() * 4, '\0');
+    utf8.resize(WriteUtf8(text, &utf8[0]));
+    wil::unique_hfile file(CreateFileW(
+        path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+        nullptr));
+    DWORD written = 0;
+    return file && WriteFile(
+                       file.get(), utf8.data(), static_cast<DWORD>(utf8.size()), &written,
+                       nullptr);
+}
+
+// The console log at path, which windows that share a user data folder share,
+// whichever thread they run on.
+static std::shared_ptr<ConsoleLogPipeline> GetConsoleLog(const std::wstring& path)
+{
+    static std::mutex mutex;
+    static std::map<std::wstring, std::weak_ptr<ConsoleLogPipeline>> pipelines;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<ConsoleLogPipeline> pipeline = pipelines[path].lock();
+    if (!pipeline)
+    {
+        ConsoleLogPipeline::Options options;
+        options.path = path;
+        options.echo = [](std::string_view line)
+        {
+            // UTF-8 never takes fewer code units than UTF-16.
+            std::wstring message(line.size(), L'\0');
+            message.resize(MultiByteToWideChar(
+                CP_UTF8, 0, line.data(), static_cast<int>(line.size()), &message[0],
+                static_cast<int>(message.size())));
+            OutputDebugString((L"console.log Event: " + message).c_str());
+        };
+        pipeline = std::make_shared<ConsoleLogPipeline>(std::move(options));
+        pipelines[path] = pipeline;
+    }
+    return pipeline;
+}
+
 //! [AdditionalAllowedFrameAncestors_1]
 const std::wstring myTrustedSite = L"https://appassets.example";
 const std::wstring siteToEmbed = L"https://www.microsoft.com";
@@ -26,25 +89,14 @@ const std::wstring siteToEmbed = L"https://www.microsoft.com";
 // element to embed other sites.
 const std::wstring siteEmbeddingFrameName = L"my_site_embedding_frame";
 
+// Whether both URLs have the same scheme, host and port. A URL that can't be
+// parsed is no site's.
 bool AreSitesSame(PCWSTR url1, PCWSTR url2)
 {
-    wil::com_ptr<IUri> uri1;
-    CHECK_FAILURE(CreateUri(url1, Uri_CREATE_CANONICALIZE, 0, &uri1));
-    DWORD scheme1 = -1;
-    DWORD port1 = 0;
-    wil::unique_bstr host1;
-    CHECK_FAILURE(uri1->GetScheme(&scheme1));
-    CHECK_FAILURE(uri1->GetHost(&host1));
-    CHECK_FAILURE(uri1->GetPort(&port1));
-    wil::com_ptr<IUri> uri2;
-    CHECK_FAILURE(CreateUri(url2, Uri_CREATE_CANONICALIZE, 0, &uri2));
-    DWORD scheme2 = -1;
-    DWORD port2 = 0;
-    wil::unique_bstr host2;
-    CHECK_FAILURE(uri2->GetScheme(&scheme2));
-    CHECK_FAILURE(uri2->GetHost(&host2));
-    CHECK_FAILURE(uri2->GetPort(&port2));
-    return (scheme1 == scheme2) && (port1 == port2) && (wcscmp(host1.get(), host2.get()) == 0);
+    Url parsedUrl1;
+    Url parsedUrl2;
+    return parsedUrl1.Parse(url1) && parsedUrl2.Parse(url2) &&
+           parsedUrl1.GetOrigin().IsSameOrigin(parsedUrl2.GetOrigin());
 }
 
 // App specific logic to decide whether the page is fully trusted.
@@ -60,38 +112,18 @@ bool IsTargetSite(PCWSTR siteUrl)
 }
 //! [AdditionalAllowedFrameAncestors_1]
 
-// Simple functions to retrieve fields from a JSON message.
-// For production code, you should use a real JSON parser library.
-const std::wstring GetJSONStringField(PCWSTR JsonMessage, PCWSTR fieldName)
-{
-    std::wstring message(JsonMessage);
-    std::wstring startSubStr = L"\"";
-    startSubStr.append(fieldName);
-    startSubStr.append(L"\":\"");
-    std::string::size_type start = message.find(startSubStr);
-    if (start == std::wstring::npos)
-        return std::wstring();
-    start += startSubStr.length();
-    std::string::size_type end = message.find(L'\"', start);
-    if (end == std::wstring::npos)
-        return std::wstring();
-    return message.substr(start, end - start);
-}
-const int64_t GetJSONIntegerField(PCWSTR JsonMessage, PCWSTR fieldName)
-{
-    std::wstring message(JsonMessage);
-    std::wstring startSubStr = L"\"";
-    startSubStr.append(fieldName);
-    startSubStr.append(L"\":");
-    std::string::size_type start = message.find(startSubStr);
-    if (start == std::wstring::npos)
-        return 0;
-    start += startSubStr.length();
-    return _wtoi64(message.substr(start).c_str());
-}
-
 ScriptComponent::ScriptComponent(AppWindow* appWindow)
-    : m_appWindow(appWindow), m_webView(appWindow->GetWebView())
+    : m_appWindow(appWindow), m_webView(appWindow->GetWebView()),
+      m_cdpEvents(
+          [this](const std::wstring& eventName) { return AddCdpEventReceiver(eventName); },
+          [this](const std::wstring& eventName) { RemoveCdpEventReceiver(eventName); },
+          [this](std::wstring_view sessionId)
+          { return m_devToolsTargets.GetTargetId(m_devToolsTargets.FindSession(sessionId)); }),
+      m_cdpCommands(
+          CdpCommandMultiplexer::Options(),
+          [this](
+              uint64_t commandId, const std::wstring& sessionId, const std::wstring& method,
+              const std::wstring& params) { SendCdpCommand(commandId, sessionId, method, params); })
 {
     HandleIFrames();
     HandleCDPTargets();
@@ -104,6 +136,17 @@ bool ScriptComponent::HandleWindowMessage(
     LPARAM lParam,
     LRESULT* result)
 {
+    if (message == WM_TIMER && wParam == c_cdpCommandTimerId)
+    {
+        m_cdpCommands.ExpireCommands();
+        UpdateCdpCommandTimer();
+        return true;
+    }
+    if (message == WM_TIMER && wParam == c_heapSamplingTimerId)
+    {
+        SampleHeapUsage();
+        return true;
+    }
     if (message == WM_COMMAND)
     {
         switch (LOWORD(wParam))
@@ -135,6 +178,12 @@ bool ScriptComponent::HandleWindowMessage(
         case IDM_COLLECT_HEAP_MEMORY_VIA_CDP:
             CollectHeapUsageViaCdp();
             return true;
+        case IDM_TOGGLE_HEAP_SAMPLING_VIA_CDP:
+            ToggleHeapSampling();
+            return true;
+        case IDM_EXPORT_HEAP_SAMPLES:
+            ExportHeapSamples();
+            return true;
         case IDM_ADD_HOST_OBJECT:
             AddComObject();
             return true;
@@ -544,163 +593,89 @@ void ScriptComponent::SendJsonWebMessageIFrame()
 //! [DevToolsProtocolMethodMultiSession]
 void ScriptComponent::HandleCDPTargets()
 {
-    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
+    m_consoleLog = GetConsoleLog(m_appWindow->GetUserDataFolder() + L"\\ConsoleLog.txt");
     // Enable Runtime events to receive Runtime.consoleAPICalled events.
     m_webView->CallDevToolsProtocolMethod(L"Runtime.enable", L"{}", nullptr);
-    CHECK_FAILURE(
-        m_webView->GetDevToolsProtocolEventReceiver(L"Runtime.consoleAPICalled", &receiver));
-    CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
-        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args) -> HRESULT
+    m_cdpEvents.Subscribe(
+        L"Runtime.consoleAPICalled",
+        [this](const CdpEvent& event)
+        {
+            // Get which target the console.log message comes from. Leave the label
+            // empty for the default target of top page.
+            std::wstring_view eventSourceLabel;
+            if (!event.GetSessionId().empty())
             {
-                // Get console.log message details and which target it comes from.
-                wil::unique_cotaskmem_string parameterObjectAsJson;
-                CHECK_FAILURE(args->get_ParameterObjectAsJson(&parameterObjectAsJson));
-                std::wstring eventSourceLabel;
-                std::wstring eventDetails = parameterObjectAsJson.get();
-                wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceivedEventArgs2> args2;
-                if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2))))
-                {
-                    wil::unique_cotaskmem_string sessionId;
-                    CHECK_FAILURE(args2->get_SessionId(&sessionId));
-                    if (sessionId.get() && *sessionId.get())
-                    {
-                        std::wstring targetId = m_devToolsSessionMap[sessionId.get()];
-                        eventSourceLabel = m_devToolsTargetLabelMap[targetId];
-                    }
-                }
-                // else, leave eventSourceLabel as empty string for the default target of top
-                // page.
-
-                // Log events to debug output, not using dialog as there could be a lot of
-                // console.log events.
-                std::wstring message = L"console.log Event: ";
-                if (!eventSourceLabel.empty())
-                {
-                    message = message + L"(from " + eventSourceLabel + L")";
-                }
-                message += eventDetails + L"\n";
-                OutputDebugString(message.c_str());
-                return S_OK;
-            })
-            .Get(),
-        &m_consoleAPICalledToken));
-    receiver.reset();
+                eventSourceLabel = m_devToolsTargets.GetTargetLabel(
+                    m_devToolsTargets.FindSession(event.GetSessionId()));
+            }
+            // Log events to a file and debug output, not using dialog as there could be
+            // a lot of console.log events. The pipeline formats and writes them on a
+            // thread of its own, so the parameters aren't parsed here.
+            m_consoleLog->Push(eventSourceLabel, event.GetParametersJson());
+        });
     // Track Target and session info via CDP events.
-    CHECK_FAILURE(
-        m_webView->GetDevToolsProtocolEventReceiver(L"Target.attachedToTarget", &receiver));
-    CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
-        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args) -> HRESULT
-            {
-                // A new target is attached, add its info to maps.
-                wil::unique_cotaskmem_string jsonMessage;
-                CHECK_FAILURE(args->get_ParameterObjectAsJson(&jsonMessage));
-                std::wstring sessionId = GetJSONStringField(jsonMessage.get(), L"sessionId");
-                std::wstring targetId = GetJSONStringField(jsonMessage.get(), L"targetId");
-                m_devToolsSessionMap[sessionId] = targetId;
-                std::wstring type = GetJSONStringField(jsonMessage.get(), L"type");
-                std::wstring url = GetJSONStringField(jsonMessage.get(), L"url");
-                m_devToolsTargetLabelMap.insert_or_assign(targetId, type + L"," + url);
-                wil::com_ptr<ICoreWebView2_11> webview2 =
-                    m_webView.try_query<ICoreWebView2_11>();
-                if (webview2)
-                {
-                    // Auto-attach to targets further created from this target (identified by
-                    // its session ID), like dedicated worker target created in the iframe.
-                    webview2->CallDevToolsProtocolMethodForSession(
-                        sessionId.c_str(), L"Target.setAutoAttach",
-                        LR"({"autoAttach":true,"waitForDebuggerOnStart":false,"flatten":true})",
-                        nullptr);
-                    // Also enable Runtime events to receive Runtime.consoleAPICalled from the
-                    // target.
-                    webview2->CallDevToolsProtocolMethodForSession(
-                        sessionId.c_str(), L"Runtime.enable", L"{}", nullptr);
-                }
-                return S_OK;
-            })
-            .Get(),
-        &m_targetAttachedToken));
-    receiver.reset();
-    CHECK_FAILURE(
-        m_webView->GetDevToolsProtocolEventReceiver(L"Target.detachedFromTarget", &receiver));
-    CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
-        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args) -> HRESULT
-            {
-                // A target is detached, remove it from the maps.
-                wil::unique_cotaskmem_string jsonMessage;
-                CHECK_FAILURE(args->get_ParameterObjectAsJson(&jsonMessage));
-                std::wstring sessionId = GetJSONStringField(jsonMessage.get(), L"sessionId");
-                auto session = m_devToolsSessionMap.find(sessionId);
-                if (session != m_devToolsSessionMap.end())
-                {
-                    m_devToolsTargetLabelMap.erase(session->second);
-                    m_devToolsSessionMap.erase(session);
-                }
-                return S_OK;
-            })
-            .Get(),
-        &m_targetDetachedToken));
-    receiver.reset();
-    CHECK_FAILURE(
-        m_webView->GetDevToolsProtocolEventReceiver(L"Target.targetCreated", &receiver));
-    CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
-        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args) -> HRESULT
+    m_cdpEvents.SubscribeAs<CdpTargetEvent>(
+        L"Target.attachedToTarget",
+        [this](const CdpTargetEvent& target)
+        {
+            // A new target is attached, add its info to the registry.
+            std::wstring sessionId(target.sessionId);
+            std::wstring label(target.type);
+            label += L",";
+            label += target.url;
+            m_devToolsTargets.AttachSession(sessionId, target.targetId, label);
+            wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
+            if (webview2)
             {
-                // Shared worker targets are not auto attached. Have to attach it explicitly.
-                wil::unique_cotaskmem_string jsonMessage;
-                CHECK_FAILURE(args->get_ParameterObjectAsJson(&jsonMessage));
-                std::wstring type = GetJSONStringField(jsonMessage.get(), L"type");
-                if (type == L"shared_worker")
-                {
-                    std::wstring targetId = GetJSONStringField(jsonMessage.get(), L"targetId");
-                    std::wstring parameters =
-                        L"{\"targetId\":\"" + targetId + L"\",\"flatten\": true}";
-                    // Call Target.attachToTarget and ignore returned value, let
-                    // Target.attachedToTarget to handle the result.
-                    m_webView->CallDevToolsProtocolMethod(
-                        L"Target.attachToTarget", parameters.c_str(), nullptr);
-                }
-                return S_OK;
-            })
-            .Get(),
-        &m_targetCreatedToken));
-    receiver.reset();
-    CHECK_FAILURE(
-        m_webView->GetDevToolsProtocolEventReceiver(L"Target.targetInfoChanged", &receiver));
-    CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
-        Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
-            [this](
-                ICoreWebView2* sender,
-                ICoreWebView2DevToolsProtocolEventReceivedEventArgs* args) -> HRESULT
+                // Auto-attach to targets further created from this target (identified by
+                // its session ID), like dedicated worker target created in the iframe.
+                webview2->CallDevToolsProtocolMethodForSession(
+                    sessionId.c_str(), L"Target.setAutoAttach",
+                    LR"({"autoAttach":true,"waitForDebuggerOnStart":false,"flatten":true})",
+                    nullptr);
+                // Also enable Runtime events to receive Runtime.consoleAPICalled from the
+                // target.
+                webview2->CallDevToolsProtocolMethodForSession(
+                    sessionId.c_str(), L"Runtime.enable", L"{}", nullptr);
+            }
+        });
+    m_cdpEvents.SubscribeAs<CdpTargetEvent>(
+        L"Target.detachedFromTarget",
+        [this](const CdpTargetEvent& target)
+        {
+            // A target is detached, remove it from the registry.
+            m_devToolsTargets.DetachSession(target.sessionId);
+        });
+    m_cdpEvents.SubscribeAs<CdpTargetEvent>(
+        L"Target.targetCreated",
+        [this](const CdpTargetEvent& target)
+        {
+            // Shared worker targets are not auto attached. Have to attach it explicitly.
+            if (target.type == L"shared_worker")
             {
-                // A target's info (such as its URL) has changed, so update its label in the
-                // target label map.
-                wil::unique_cotaskmem_string jsonMessage;
-                CHECK_FAILURE(args->get_ParameterObjectAsJson(&jsonMessage));
-                std::wstring targetId = GetJSONStringField(jsonMessage.get(), L"targetId");
-                if (m_devToolsTargetLabelMap.find(targetId) !=
-                    m_devToolsTargetLabelMap.end())
-                {
-                    // This is a target that we are interested in, update label.
-                    std::wstring type = GetJSONStringField(jsonMessage.get(), L"type");
-                    std::wstring url = GetJSONStringField(jsonMessage.get(), L"url");
-                    m_devToolsTargetLabelMap[targetId] = type + L"," + url;
-                }
-                return S_OK;
-            })
-            .Get(),
-        &m_targetInfoChangedToken));
+                JsonWriter parameters;
+                parameters.BeginObject();
+                parameters.Key(L"targetId").String(target.targetId);
+                parameters.Key(L"flatten").Bool(true);
+                parameters.EndObject();
+                // Call Target.attachToTarget and ignore returned value, let
+                // Target.attachedToTarget to handle the result.
+                m_webView->CallDevToolsProtocolMethod(
+                    L"Target.attachToTarget", parameters.GetString().c_str(), nullptr);
+            }
+        });
+    m_cdpEvents.SubscribeAs<CdpTargetEvent>(
+        L"Target.targetInfoChanged",
+        [this](const CdpTargetEvent& target)
+        {
+            // A target's info (such as its URL) has changed, so update its label in the
+            // registry.
+            std::wstring label(target.type);
+            label += L",";
+            label += target.url;
+            // Only targets we are attached to, and so interested in, are updated.
+            m_devToolsTargets.SetTargetLabel(target.targetId, label);
+        });
     // Setup CDP targets operation mode.
     // Set auto attach to attach to dedicated worker target.
     m_webView->CallDevToolsProtocolMethod(
@@ -714,66 +689,251 @@ void ScriptComponent::HandleCDPTargets()
 
 void ScriptComponent::CollectHeapUsageViaCdp()
 {
-    if (m_pendingHeapUsageCollectionCount)
+    wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
+    CHECK_FEATURE_RETURN_EMPTY(webview2);
+    // Ask the main page, which is the session with an empty ID, and every attached
+    // target at once.
+    std::vector<std::wstring> sessionIds{L""};
+    std::vector<CdpSessionHandle> sessions{CdpSessionHandle()};
+    m_devToolsTargets.ForEachSession(
+        [&](CdpSessionHandle session)
+        {
+            sessionIds.emplace_back(m_devToolsTargets.GetSessionId(session));
+            sessions.push_back(session);
+        });
+    m_cdpCommands.Gather(
+        sessionIds, L"Runtime.getHeapUsage", L"{}", c_heapUsageTimeout,
+        [this, sessions](std::vector<CdpGatherResult>& results)
+        {
+            std::wstringstream report;
+            report << L"Heap Usage (KB)" << std::endl;
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                // A session may have detached while its call was pending.
+                std::wstring targetLabel = L"Main Page";
+                if (!sessions[i].IsNull())
+                {
+                    targetLabel = m_devToolsTargets.IsValid(sessions[i])
+                                      ? m_devToolsTargets.GetTargetLabel(sessions[i])
+                                      : L"(detached target)";
+                }
+                AppendHeapUsageResult(report, targetLabel, results[i].result);
+            }
+            MessageBox(nullptr, report.str().c_str(), L"Heap Usage", MB_OK);
+        });
+    UpdateCdpCommandTimer();
+}
+
+void ScriptComponent::AppendHeapUsageResult(
+    std::wstringstream& report, const std::wstring& targetInfo, const CdpCommandResult& result)
+{
+    if (result.status != CdpCommandStatus::Succeeded)
     {
-        // Already collecting, return
+        if (result.status == CdpCommandStatus::Failed)
+        {
+            report << L"failed (0x" << std::hex << static_cast<uint32_t>(result.error)
+                   << std::dec << L")";
+        }
+        else
+        {
+            report << (result.status == CdpCommandStatus::TimedOut ? L"timed out"
+                                                                    : L"canceled");
+        }
+        report << L", " << targetInfo << std::endl;
+        return;
+    }
+    double totalSize = 0;
+    double usedSize = 0;
+    ParseHeapUsage(result.json, &usedSize, &totalSize);
+    report << L"total:";
+    report.width(8);
+    report << static_cast<int64_t>(totalSize / 1024);
+    report << L", used:";
+    report.width(8);
+    report << static_cast<int64_t>(usedSize / 1024);
+    report << L", ";
+    report << targetInfo;
+    report << std::endl;
+}
+
+void ScriptComponent::ToggleHeapSampling()
+{
+    HWND mainWindow = m_appWindow->GetMainWindow();
+    if (m_heapSamplingInterval.count() != 0)
+    {
+        KillTimer(mainWindow, c_heapSamplingTimerId);
+        m_heapSamplingInterval = std::chrono::milliseconds(0);
+        m_cdpCommands.Cancel(m_heapSamplingGather);
+        MessageBox(
+            mainWindow,
+            L"Heap sampling stopped. The samples can still be exported.",
+            L"Heap Sampling", MB_OK);
         return;
     }
     wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
     CHECK_FEATURE_RETURN_EMPTY(webview2);
-    m_pendingHeapUsageCollectionCount = 0;
-    m_heapUsageResult.clear();
-    m_heapUsageResult.str(L"Heap Usage (KB)");
-    m_heapUsageResult << std::endl;
-    // Collect main target
-    ++m_pendingHeapUsageCollectionCount;
-    std::wstring main_targetInfo = L"Main Page";
-    m_webView->CallDevToolsProtocolMethod(
-        L"Runtime.getHeapUsage", L"{}",
-        Callback<ICoreWebView2CallDevToolsProtocolMethodCompletedHandler>(
-            [this, main_targetInfo](HRESULT error, PCWSTR resultJson) -> HRESULT
-            {
-                HandleHeapUsageResult(main_targetInfo, resultJson);
-                return S_OK;
-            })
-            .Get());
-    // Collect heap usage for other targets.
-    for (auto& target : m_devToolsSessionMap)
+    TextInputDialog dialog(
+        mainWindow, L"Heap Sampling", L"Interval (ms):",
+        L"Sample the JS heap usage of the page and every attached target at this "
+        L"interval, until heap sampling is toggled off.",
+        L"1000");
+    if (!dialog.confirmed)
     {
-        ++m_pendingHeapUsageCollectionCount;
-        std::wstring targetLabel = m_devToolsTargetLabelMap[target.second];
-        webview2->CallDevToolsProtocolMethodForSession(
-            target.first.c_str(), L"Runtime.getHeapUsage", L"{}",
-            Callback<ICoreWebView2CallDevToolsProtocolMethodCompletedHandler>(
-                [this, targetLabel](HRESULT error, PCWSTR resultJson) -> HRESULT
+        return;
+    }
+    m_heapSamplingInterval =
+        std::chrono::milliseconds((std::max)(_wtoi(dialog.input.c_str()), 100));
+    m_heapSamples.Clear();
+    m_heapSamplingStart = std::chrono::steady_clock::now();
+    SetTimer(
+        mainWindow, c_heapSamplingTimerId, static_cast<UINT>(m_heapSamplingInterval.count()),
+        nullptr);
+    SampleHeapUsage();
+}
+
+void ScriptComponent::SampleHeapUsage()
+{
+    if (m_heapSamplingPending)
+    {
+        // A target is slow to answer; skip a sample rather than queue them up.
+        return;
+    }
+    std::vector<std::wstring> sessionIds{L""};
+    std::vector<std::wstring> targetIds{L""};
+    std::vector<std::wstring> labels{L"Main Page"};
+    m_devToolsTargets.ForEachSession(
+        [&](CdpSessionHandle session)
+        {
+            sessionIds.emplace_back(m_devToolsTargets.GetSessionId(session));
+            targetIds.emplace_back(m_devToolsTargets.GetTargetId(session));
+            labels.emplace_back(m_devToolsTargets.GetTargetLabel(session));
+        });
+    int64_t time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - m_heapSamplingStart)
+                       .count();
+    // The gather can complete before it returns, if every call fails to start.
+    m_heapSamplingPending = true;
+    m_heapSamplingGather = m_cdpCommands.Gather(
+        sessionIds, L"Runtime.getHeapUsage", L"{}", c_heapUsageTimeout,
+        [this, targetIds, labels, time](std::vector<CdpGatherResult>& results)
+        {
+            m_heapSamplingPending = false;
+            if (m_heapSamplingInterval.count() == 0)
+            {
+                return;
+            }
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                double usedSize = 0;
+                double totalSize = 0;
+                if (results[i].result.status == CdpCommandStatus::Succeeded &&
+                    ParseHeapUsage(results[i].result.json, &usedSize, &totalSize))
                 {
-                    HandleHeapUsageResult(targetLabel, resultJson);
-                    return S_OK;
-                })
-                .Get());
+                    m_heapSamples.Add(targetIds[i], labels[i], time, usedSize, totalSize);
+                }
+            }
+            // Targets that have detached won't be sampled again.
+            m_heapSamples.Retain(targetIds);
+            m_heapSamples.ForEachTarget(
+                [](const std::wstring& targetId, HeapSampleStore::Target& target)
+                {
+                    target.leak = DetectHeapLeak(target.series);
+                    if (target.leak.suspected && !target.leakReported)
+                    {
+                        target.leakReported = true;
+                        // Log to debug output, as a kiosk may have no one to click a
+                        // dialog away.
+                        int64_t growth =
+                            static_cast<int64_t>(target.leak.slopeBytesPerHour / 1024);
+                        std::wstring message = L"Heap leak suspected: " + target.label +
+                                               L", growing " + std::to_wstring(growth) +
+                                               L" KB per hour\n";
+                        OutputDebugString(message.c_str());
+                    }
+                });
+        });
+    UpdateCdpCommandTimer();
+}
+
+void ScriptComponent::ExportHeapSamples()
+{
+    HWND mainWindow = m_appWindow->GetMainWindow();
+    if (m_heapSamples.GetTargetCount() == 0)
+    {
+        MessageBox(
+            mainWindow, L"There are no heap samples. Toggle heap sampling on first.",
+            L"Export Heap Samples", MB_OK);
+        return;
     }
+    std::wstring csvPath = m_appWindow->GetUserDataFolder() + L"\\HeapSamples.csv";
+    std::wstring jsonPath = m_appWindow->GetUserDataFolder() + L"\\HeapSamples.json";
+    std::wstring csv;
+    m_heapSamples.WriteCsv(csv);
+    JsonWriter json;
+    m_heapSamples.WriteJson(json);
+    if (!WriteUtf8File(csvPath, csv) || !WriteUtf8File(jsonPath, json.GetString()))
+    {
+        ShowFailure(HRESULT_FROM_WIN32(GetLastError()), L"Failed to export heap samples");
+        return;
+    }
+
+    std::wstringstream report;
+    report << L"Growth of the heap floor (KB per hour):" << std::endl;
+    m_heapSamples.ForEachTarget(
+        [&](const std::wstring& targetId, HeapSampleStore::Target& target)
+        {
+            report << static_cast<int64_t>(target.leak.slopeBytesPerHour / 1024);
+            report << (target.leak.suspected ? L" (leak suspected), " : L", ");
+            report << target.label << std::endl;
+        });
+    report << std::endl << L"Saved to " << csvPath << std::endl << L"and " << jsonPath;
+    MessageBox(mainWindow, report.str().c_str(), L"Export Heap Samples", MB_OK);
 }
 
-void ScriptComponent::HandleHeapUsageResult(std::wstring targetInfo, PCWSTR resultJson)
+void ScriptComponent::SendCdpCommand(
+    uint64_t commandId, const std::wstring& sessionId, const std::wstring& method,
+    const std::wstring& params)
 {
-    int64_t totalSize = GetJSONIntegerField(resultJson, L"totalSize");
-    int64_t usedSize = GetJSONIntegerField(resultJson, L"usedSize");
-    m_heapUsageResult << L"total:";
-    m_heapUsageResult.width(8);
-    m_heapUsageResult << (totalSize / 1024);
-    m_heapUsageResult << L", used:";
-    m_heapUsageResult.width(8);
-    m_heapUsageResult << (usedSize / 1024);
-    m_heapUsageResult << L", ";
-    m_heapUsageResult << targetInfo;
-    m_heapUsageResult << std::endl;
-    if (--m_pendingHeapUsageCollectionCount == 0)
+    auto completedHandler = Callback<ICoreWebView2CallDevToolsProtocolMethodCompletedHandler>(
+        [this, commandId](HRESULT error, PCWSTR resultJson) -> HRESULT
+        {
+            m_cdpCommands.OnCommandCompleted(commandId, error, resultJson ? resultJson : L"");
+            UpdateCdpCommandTimer();
+            return S_OK;
+        });
+    HRESULT hr = E_NOINTERFACE;
+    if (sessionId.empty())
+    {
+        hr = m_webView->CallDevToolsProtocolMethod(
+            method.c_str(), params.c_str(), completedHandler.Get());
+    }
+    else if (auto webview2 = m_webView.try_query<ICoreWebView2_11>())
+    {
+        hr = webview2->CallDevToolsProtocolMethodForSession(
+            sessionId.c_str(), method.c_str(), params.c_str(), completedHandler.Get());
+    }
+    if (FAILED(hr))
     {
-        MessageBox(nullptr, m_heapUsageResult.str().c_str(), L"Heap Usage", MB_OK);
+        // The call never started, so fail it now instead of at its timeout.
+        m_cdpCommands.OnCommandCompleted(commandId, hr, L"");
     }
 }
 
-    //! [DevToolsProtocolEventReceived]
+void ScriptComponent::UpdateCdpCommandTimer()
+{
+    HWND mainWindow = m_appWindow->GetMainWindow();
+    std::chrono::steady_clock::time_point deadline = m_cdpCommands.GetNextDeadline();
+    if (deadline == std::chrono::steady_clock::time_point::max())
+    {
+        KillTimer(mainWindow, c_cdpCommandTimerId);
+        return;
+    }
+    std::chrono::milliseconds wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    wait = (std::max)(wait, std::chrono::milliseconds(USER_TIMER_MINIMUM));
+    SetTimer(mainWindow, c_cdpCommandTimerId, static_cast<UINT>(wait.count()), nullptr);
+}
+
 // Prompt the user to name a CDP event, and then subscribe to that event.
 void ScriptComponent::SubscribeToCdpEvent()
 {
@@ -787,20 +947,47 @@ void ScriptComponent::SubscribeToCdpEvent()
         L"Log.entryAdded");
     if (dialog.confirmed)
     {
-		std::wstring eventName = dialog.input;
-        wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
-        CHECK_FAILURE(
-            m_webView->GetDevToolsProtocolEventReceiver(eventName.c_str(), &receiver));
-
-        // If we are already subscribed to this event, unsubscribe first.
-        auto preexistingToken = m_devToolsProtocolEventReceivedTokenMap.find(eventName);
-        if (preexistingToken != m_devToolsProtocolEventReceivedTokenMap.end())
+        std::wstring eventName = dialog.input;
+        uint64_t subscription = m_cdpEvents.Subscribe(
+            eventName,
+            [this](const CdpEvent& event)
+            {
+                std::wstring title(event.GetName());
+                std::wstring details(event.GetParametersJson());
+                if (!event.GetSessionId().empty())
+                {
+                    std::wstring sessionId(event.GetSessionId());
+                    title += L" (session:" + sessionId + L")";
+                    std::wstring targetLabel(m_devToolsTargets.GetTargetLabel(
+                        m_devToolsTargets.FindSession(sessionId)));
+                    details = L"From " + targetLabel + L" (session:" + sessionId + L")\r\n" +
+                              details;
+                }
+                m_appWindow->AsyncMessageBox(details, L"CDP Event Fired: " + title);
+            });
+        if (subscription == 0)
         {
-            CHECK_FAILURE(receiver->remove_DevToolsProtocolEventReceived(
-                preexistingToken->second));
+            return;
         }
+        // If we are already subscribed to this event, unsubscribe the earlier
+        // subscription. The new one keeps the event's receiver.
+        auto preexistingSubscription = m_cdpEventSubscriptions.find(eventName);
+        if (preexistingSubscription != m_cdpEventSubscriptions.end())
+        {
+            m_cdpEvents.Unsubscribe(preexistingSubscription->second);
+        }
+        m_cdpEventSubscriptions[eventName] = subscription;
+    }
+}
 
-        CHECK_FAILURE(receiver->add_DevToolsProtocolEventReceived(
+//! [DevToolsProtocolEventReceived]
+bool ScriptComponent::AddCdpEventReceiver(const std::wstring& eventName)
+{
+    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
+    HRESULT hr = m_webView->GetDevToolsProtocolEventReceiver(eventName.c_str(), &receiver);
+    if (SUCCEEDED(hr))
+    {
+        hr = receiver->add_DevToolsProtocolEventReceived(
             Callback<ICoreWebView2DevToolsProtocolEventReceivedEventHandler>(
                 [this, eventName](
                     ICoreWebView2* sender,
@@ -808,30 +995,47 @@ void ScriptComponent::SubscribeToCdpEvent()
                 {
                     wil::unique_cotaskmem_string parameterObjectAsJson;
                     CHECK_FAILURE(args->get_ParameterObjectAsJson(&parameterObjectAsJson));
-                    std::wstring title = eventName;
-                    std::wstring details = parameterObjectAsJson.get();
                     //! [DevToolsProtocolEventReceivedSessionId]
+                    wil::unique_cotaskmem_string sessionId;
                     wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceivedEventArgs2> args2;
                     if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2))))
                     {
-                        wil::unique_cotaskmem_string sessionId;
                         CHECK_FAILURE(args2->get_SessionId(&sessionId));
-                        if (sessionId.get() && *sessionId.get())
-                        {
-                            title = eventName + L" (session:" + sessionId.get() + L")";
-                            std::wstring targetId = m_devToolsSessionMap[sessionId.get()];
-                            std::wstring targetLabel = m_devToolsTargetLabelMap[targetId];
-                            details = L"From " + targetLabel + L" (session:" + sessionId.get() +
-                                      L")\r\n" + details;
-                        }
                     }
                     //! [DevToolsProtocolEventReceivedSessionId]
-                    m_appWindow->AsyncMessageBox(details, L"CDP Event Fired: " + title);
+                    // The event is parsed at most once, however many subscribers it has.
+                    m_cdpEvents.Dispatch(
+                        eventName, sessionId.get() ? sessionId.get() : L"",
+                        parameterObjectAsJson.get());
                     return S_OK;
                 })
                 .Get(),
-            &m_devToolsProtocolEventReceivedTokenMap[eventName]));
+            &m_cdpEventReceivedTokens[eventName]);
     }
+    if (FAILED(hr))
+    {
+        m_cdpEventReceivedTokens.erase(eventName);
+        ShowFailure(hr, L"Subscribe to " + eventName + L" failed");
+        return false;
+    }
+    return true;
+}
+
+void ScriptComponent::RemoveCdpEventReceiver(const std::wstring& eventName)
+{
+    auto token = m_cdpEventReceivedTokens.find(eventName);
+    if (token == m_cdpEventReceivedTokens.end())
+    {
+        return;
+    }
+    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
+    // WebView could have been closed at this time, so only proceed if
+    // GetDevToolsProtocolEventReceiver succeeded.
+    if (SUCCEEDED(m_webView->GetDevToolsProtocolEventReceiver(eventName.c_str(), &receiver)))
+    {
+        receiver->remove_DevToolsProtocolEventReceived(token->second);
+    }
+    m_cdpEventReceivedTokens.erase(token);
 }
 //! [DevToolsProtocolEventReceived]
 
@@ -871,13 +1075,14 @@ void ScriptComponent::CallCdpMethodForSession()
     wil::com_ptr<ICoreWebView2_11> webview2 = m_webView.try_query<ICoreWebView2_11>();
     CHECK_FEATURE_RETURN_EMPTY(webview2);
     std::wstring sessionList = L"Sessions:";
-    for (auto& target : m_devToolsSessionMap)
-    {
-        sessionList += L"\r\n";
-        sessionList += target.first;
-        sessionList += L":";
-        sessionList += m_devToolsTargetLabelMap[target.second];
-    }
+    m_devToolsTargets.ForEachSession(
+        [&](CdpSessionHandle session)
+        {
+            sessionList += L"\r\n";
+            sessionList += m_devToolsTargets.GetSessionId(session);
+            sessionList += L":";
+            sessionList += m_devToolsTargets.GetTargetLabel(session);
+        });
     std::wstring description =
         L"Enter the sessionId, CDP method name to call, and parameters in JSON format, "
         L"separated by space,\r\n" +
@@ -1284,35 +1489,8 @@ void ScriptComponent::OpenTaskManagerWindow()
 
 ScriptComponent::~ScriptComponent()
 {
-    for (auto& pair : m_devToolsProtocolEventReceivedTokenMap)
-    {
-        wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
-        CHECK_FAILURE(
-            m_webView->GetDevToolsProtocolEventReceiver(pair.first.c_str(), &receiver));
-        receiver->remove_DevToolsProtocolEventReceived(pair.second);
-    }
-    wil::com_ptr<ICoreWebView2DevToolsProtocolEventReceiver> receiver;
-    // WebView could have been closed at this time, so only proceed if first
-    // GetDevToolsProtocolEventReceiver succeeded.
-    if (SUCCEEDED(
-            m_webView->GetDevToolsProtocolEventReceiver(L"Target.attachedToTarget", &receiver)))
-    {
-        receiver->remove_DevToolsProtocolEventReceived(m_targetAttachedToken);
-        receiver.reset();
-        CHECK_FAILURE(m_webView->GetDevToolsProtocolEventReceiver(
-            L"Target.detachedFromTarget", &receiver));
-        receiver->remove_DevToolsProtocolEventReceived(m_targetDetachedToken);
-        receiver.reset();
-        CHECK_FAILURE(
-            m_webView->GetDevToolsProtocolEventReceiver(L"Target.targetCreated", &receiver));
-        receiver->remove_DevToolsProtocolEventReceived(m_targetCreatedToken);
-        receiver.reset();
-        CHECK_FAILURE(m_webView->GetDevToolsProtocolEventReceiver(
-            L"Target.targetInfoChanged", &receiver));
-        receiver->remove_DevToolsProtocolEventReceived(m_targetInfoChangedToken);
-        receiver.reset();
-        CHECK_FAILURE(m_webView->GetDevToolsProtocolEventReceiver(
-            L"Runtime.consoleAPICalled", &receiver));
-        receiver->remove_DevToolsProtocolEventReceived(m_consoleAPICalledToken);
-    }
+    KillTimer(m_appWindow->GetMainWindow(), c_cdpCommandTimerId);
+    KillTimer(m_appWindow->GetMainWindow(), c_heapSamplingTimerId);
+    // Remove the receiver of every event that still has subscribers.
+    m_cdpEvents.Clear();
 }
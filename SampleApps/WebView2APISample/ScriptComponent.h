@@ -7,15 +7,20 @@
 
 #include "stdafx.h"
 
+#include <chrono>
 #include <map>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
 
 #include "AppWindow.h"
+#include "CdpCommandMultiplexer.h"
+#include "CdpEventHub.h"
+#include "CdpTargetRegistry.h"
 #include "ComponentBase.h"
-
-const std::wstring GetJSONStringField(PCWSTR jsonMessage, PCWSTR fieldName);
+#include "ConsoleLogPipeline.h"
+#include "HeapSampleStore.h"
 
 // This component handles commands from the Script menu.
 class ScriptComponent : public ComponentBase
@@ -38,12 +43,28 @@ private:
     void SendStringWebMessage();
     void SendJsonWebMessage();
     void SubscribeToCdpEvent();
+    // The receivers of m_cdpEvents.
+    bool AddCdpEventReceiver(const std::wstring& eventName);
+    void RemoveCdpEventReceiver(const std::wstring& eventName);
     void CallCdpMethod();
     void HandleCDPTargets();
     void CallCdpMethodForSession();
     HRESULT CDPMethodCallback(HRESULT error, PCWSTR resultJson);
     void CollectHeapUsageViaCdp();
-    void HandleHeapUsageResult(std::wstring targetInfo, PCWSTR resultJson);
+    void AppendHeapUsageResult(
+        std::wstringstream& report, const std::wstring& targetInfo,
+        const CdpCommandResult& result);
+    // Start sampling the heap usage of every target, or stop.
+    void ToggleHeapSampling();
+    void SampleHeapUsage();
+    // Save the heap samples as CSV and JSON, and show how fast each heap grows.
+    void ExportHeapSamples();
+    // The endpoint of m_cdpCommands.
+    void SendCdpCommand(
+        uint64_t commandId, const std::wstring& sessionId, const std::wstring& method,
+        const std::wstring& params);
+    // Set a timer for when the next command in m_cdpCommands times out.
+    void UpdateCdpCommandTimer();
     void AddComObject();
     void OpenTaskManagerWindow();
     void SendStringWebMessageIFrame();
@@ -63,18 +84,31 @@ private:
     int m_siteEmbeddingIFrameCount = 0;
 
     std::wstring m_lastInitializeScriptId;
-    std::map<std::wstring, EventRegistrationToken> m_devToolsProtocolEventReceivedTokenMap;
-    EventRegistrationToken m_targetAttachedToken;
-    EventRegistrationToken m_targetDetachedToken;
-    EventRegistrationToken m_targetCreatedToken;
-    EventRegistrationToken m_targetInfoChangedToken;
-    EventRegistrationToken m_consoleAPICalledToken;
-    // SessionId to TargetId map
-    std::map<std::wstring, std::wstring> m_devToolsSessionMap;
-    // TargetId to description label map, where label is "<target type>,<target url>".
-    std::map<std::wstring, std::wstring> m_devToolsTargetLabelMap;
-    int m_pendingHeapUsageCollectionCount = 0;
-    std::wstringstream m_heapUsageResult;
+    // The subscription made through Subscribe to CDP event for each event name.
+    std::map<std::wstring, uint64_t> m_cdpEventSubscriptions;
+    // The handler added to the receiver of each event that m_cdpEvents has
+    // subscribers to.
+    std::map<std::wstring, EventRegistrationToken> m_cdpEventReceivedTokens;
+    // The sessions attached through Target.attachedToTarget, and the label of
+    // each one's target, "<target type>,<target url>".
+    CdpTargetRegistry m_devToolsTargets;
+    // Writes Runtime.consoleAPICalled events to ConsoleLog.txt in the user data
+    // folder, and to debug output. Shared by the windows that use the folder.
+    std::shared_ptr<ConsoleLogPipeline> m_consoleLog;
+    // Delivers DevTools protocol events to every subscriber through one receiver
+    // per event, from HandleCDPTargets and Subscribe to CDP event.
+    CdpEventHub m_cdpEvents;
+    // DevTools protocol commands waiting for their results, such as the calls of
+    // a heap usage collection.
+    CdpCommandMultiplexer m_cdpCommands;
+    // The heap usage of each target while heap sampling is on, and since it was
+    // last on.
+    HeapSampleStore m_heapSamples;
+    // 0 while heap sampling is off.
+    std::chrono::milliseconds m_heapSamplingInterval{0};
+    std::chrono::steady_clock::time_point m_heapSamplingStart;
+    uint64_t m_heapSamplingGather = 0;
+    bool m_heapSamplingPending = false;
 };
 
 #endif
@@ -6,13 +6,17 @@
 
 #include "SettingsComponent.h"
 
+#include "AssetComStream.h"
 #include "CheckFailure.h"
+#include "ContentFilter.h"
 #include "ScenarioPermissionManagement.h"
 #include "TextInputDialog.h"
+#include "Url.h"
 #include <gdiplus.h>
 #include <shellapi.h>
 #include <shlwapi.h>
 #include <windows.h>
+#include <filesystem>
 #include <sstream>
 
 using namespace Microsoft::WRL;
@@ -20,7 +24,8 @@ using namespace Microsoft::WRL;
 SettingsComponent::SettingsComponent(
     AppWindow* appWindow, ICoreWebView2Environment* environment, SettingsComponent* old)
     : m_appWindow(appWindow), m_webViewEnvironment(environment),
-      m_webView(appWindow->GetWebView())
+      m_webView(appWindow->GetWebView()),
+      m_webResourceRequestedDispatcher(appWindow->GetWebResourceRequestedDispatcher())
 {
     CHECK_FAILURE(m_webView->get_Settings(&m_settings));
 
@@ -107,12 +112,27 @@ SettingsComponent::SettingsComponent(
         }
         SetBlockImages(old->m_blockImages);
         SetReplaceImages(old->m_replaceImages);
+        SetContentFilter(old->m_contentFilter);
         m_isScriptEnabled = old->m_isScriptEnabled;
         m_blockedSitesSet = old->m_blockedSitesSet;
         m_blockedSites = std::move(old->m_blockedSites);
         EnableCustomClientCertificateSelection();
         ToggleCustomServerCertificateSupport();
     }
+    else
+    {
+        // A blocklist built by AssetPacker --domains is mapped in as it is.
+        WCHAR modulePath[MAX_PATH];
+        GetModuleFileNameW(nullptr, modulePath, ARRAYSIZE(modulePath));
+        std::filesystem::path path(modulePath);
+        std::unique_ptr<DomainTrie> blockedSites =
+            DomainTrie::Open(path.replace_filename(L"BlockedDomains.trie"));
+        if (blockedSites)
+        {
+            m_blockedSites = std::move(*blockedSites);
+            m_blockedSitesSet = true;
+        }
+    }
 
     //! [NavigationStarting]
     // Register a handler for the NavigationStarting event.
@@ -127,6 +147,8 @@ SettingsComponent::SettingsComponent(
             {
                 wil::unique_cotaskmem_string uri;
                 CHECK_FAILURE(args->get_Uri(&uri));
+                // The content filter lets this navigation's document through.
+                m_navigationUri = uri.get();
 
                 if (ShouldBlockUri(uri.get()))
                 {
@@ -159,11 +181,10 @@ SettingsComponent::SettingsComponent(
                 //! [UserAgent]
                 if (m_settings2)
                 {
-                    static const PCWSTR url_compare_example = L"fourthcoffee.com";
-                    wil::unique_bstr domain = GetDomainOfUri(uri.get());
-                    const wchar_t* domains = domain.get();
+                    static const std::string_view url_compare_example = "fourthcoffee.com";
+                    Url url;
 
-                    if (wcscmp(url_compare_example, domains) == 0)
+                    if (url.Parse(uri.get()) && url.GetHost() == url_compare_example)
                     {
                         SetUserAgent(L"example_navigation_ua");
                     }
@@ -556,6 +577,17 @@ bool SettingsComponent::HandleWindowMessage(
                 L"Settings change", MB_OK);
             return true;
         }
+        case ID_SETTINGS_CONTENT_FILTER:
+        {
+            SetContentFilter(!m_contentFilter);
+            MessageBox(
+                nullptr,
+                (std::wstring(L"Content filtering has been ") +
+                 (m_contentFilter ? L"enabled." : L"disabled."))
+                    .c_str(),
+                L"Settings change", MB_OK);
+            return true;
+        }
         case ID_SETTINGS_CONTEXT_MENUS_ENABLED:
         {
             //! [DisableContextMenu]
@@ -1417,7 +1449,7 @@ void SettingsComponent::ChangeBlockedSites()
     std::wstring blockedSitesString;
     if (m_blockedSitesSet)
     {
-        for (auto& site : m_blockedSites)
+        for (auto& site : m_blockedSites.GetDomains())
         {
             if (!blockedSitesString.empty())
             {
@@ -1433,11 +1465,12 @@ void SettingsComponent::ChangeBlockedSites()
 
     TextInputDialog dialog(
         m_appWindow->GetMainWindow(), L"Blocked Sites", L"Sites:",
-        L"Enter hostnames to block, separated by semicolons.", blockedSitesString.c_str());
+        L"Enter domains to block, separated by semicolons. Subdomains are blocked too.",
+        blockedSitesString.c_str());
     if (dialog.confirmed)
     {
         m_blockedSitesSet = true;
-        m_blockedSites.clear();
+        m_blockedSites.Clear();
         dialog.input.erase(
             std::remove_if(dialog.input.begin(), dialog.input.end(), isspace),
             dialog.input.end());
@@ -1448,26 +1481,20 @@ void SettingsComponent::ChangeBlockedSites()
             end = dialog.input.find(L';', begin);
             if (end != begin)
             {
-                m_blockedSites.push_back(dialog.input.substr(begin, end - begin));
+                m_blockedSites.Add(std::wstring_view(dialog.input).substr(begin, end - begin));
             }
             begin = end + 1;
         }
     }
 }
 
-// Check the URI's domain against the blocked sites list
+// Check the URI's domain, and the domains it is under, against the blocked
+// sites. This runs for every navigation, so the lookup takes time in the length
+// of the domain rather than the length of the list.
 bool SettingsComponent::ShouldBlockUri(PWSTR uri)
 {
-    wil::unique_bstr domain = GetDomainOfUri(uri);
-
-    for (auto site = m_blockedSites.begin(); site != m_blockedSites.end(); site++)
-    {
-        if (wcscmp(site->c_str(), domain.get()) == 0)
-        {
-            return true;
-        }
-    }
-    return false;
+    Url url;
+    return url.Parse(uri) && m_blockedSites.Contains(url.GetHost());
 }
 
 void SettingsComponent::SetCustomDataPartitionId()
@@ -1501,7 +1528,8 @@ bool SettingsComponent::ShouldBlockScriptForUri(PWSTR uri)
 }
 
 // Turn on or off image blocking by adding or removing a WebResourceRequested handler
-// which selectively intercepts requests for images.
+// which selectively intercepts requests for images. The handler is raised for every
+// request that any filter matches, so it checks that the request is for an image.
 void SettingsComponent::SetBlockImages(bool blockImages)
 {
     if (blockImages != m_blockImages)
@@ -1548,6 +1576,12 @@ void SettingsComponent::SetBlockImages(bool blockImages)
         {
             CHECK_FAILURE(m_webView->remove_WebResourceRequested(
                 m_webResourceRequestedTokenForImageBlocking));
+            if (m_webView2_22)
+            {
+                CHECK_FAILURE(m_webView2_22->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
+                    L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE,
+                    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT));
+            }
         }
         //! [WebResourceRequested0]
     }
@@ -1586,17 +1620,29 @@ void SettingsComponent::SetReplaceImages(bool replaceImages)
                         // It's not required for this scenario, but generally you should examine
                         // relevant HTTP request headers just like an HTTP server would do when
                         // producing a response stream.
-                        wil::com_ptr<IStream> stream;
-                        CHECK_FAILURE(SHCreateStreamOnFileEx(
-                            L"assets/EdgeWebView2-80.jpg", STGM_READ, FILE_ATTRIBUTE_NORMAL,
-                            FALSE, nullptr, &stream));
+                        // Every replaced image is a view of the same bytes in memory,
+                        // which the rules in assets/ImageReplacements.txt choose.
+                        wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                        CHECK_FAILURE(args->get_Request(&request));
+                        wil::unique_cotaskmem_string uri;
+                        CHECK_FAILURE(request->get_Uri(&uri));
+                        ImageReplacer::Replacement replacement;
+                        if (!GetAppImageReplacer().GetReplacement(uri.get(), true, &replacement))
+                        {
+                            return S_OK;
+                        }
+                        auto stream =
+                            Make<AssetComStream>(AssetStream(std::move(replacement.asset)));
+                        std::wstring headers = L"Content-Type: ";
+                        headers.append(
+                            replacement.contentType.begin(), replacement.contentType.end());
                         wil::com_ptr<ICoreWebView2WebResourceResponse> response;
                         wil::com_ptr<ICoreWebView2Environment> environment;
                         wil::com_ptr<ICoreWebView2_2> webview2;
                         CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
                         CHECK_FAILURE(webview2->get_Environment(&environment));
                         CHECK_FAILURE(environment->CreateWebResourceResponse(
-                            stream.get(), 200, L"OK", L"Content-Type: image/jpeg", &response));
+                            stream.Get(), 200, L"OK", headers.c_str(), &response));
                         CHECK_FAILURE(args->put_Response(response.get()));
                         return S_OK;
                     })
@@ -1607,11 +1653,141 @@ void SettingsComponent::SetReplaceImages(bool replaceImages)
         {
             CHECK_FAILURE(m_webView->remove_WebResourceRequested(
                 m_webResourceRequestedTokenForImageReplacing));
+            if (m_webView2_22)
+            {
+                CHECK_FAILURE(m_webView2_22->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
+                    L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE,
+                    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT));
+            }
         }
         //! [WebResourceRequested1]
     }
 }
 
+// The rules in assets/ContentFilter.txt, parsed and indexed the first time
+// they are needed, and shared by every window.
+static const ContentFilter& GetAppContentFilter()
+{
+    static const ContentFilter filter(
+        []
+        {
+            std::vector<uint8_t> list;
+            AssetCache::LoadFile(L"assets/ContentFilter.txt", &list);
+            return std::string(list.begin(), list.end());
+        }());
+    return filter;
+}
+
+// The type a rule's options would give a request in a resource context.
+static ContentFilterTypes GetContentFilterType(COREWEBVIEW2_WEB_RESOURCE_CONTEXT context)
+{
+    switch (context)
+    {
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT:
+        // A frame's; the page's own is told apart by its URI.
+        return ContentFilterSubdocument;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_STYLESHEET:
+        return ContentFilterStylesheet;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE:
+        return ContentFilterImage;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MEDIA:
+        return ContentFilterMedia;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FONT:
+        return ContentFilterFont;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT:
+        return ContentFilterScript;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_XML_HTTP_REQUEST:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FETCH:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_EVENT_SOURCE:
+        return ContentFilterXmlHttpRequest;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_WEBSOCKET:
+        return ContentFilterWebSocket;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_PING:
+        return ContentFilterPing;
+    default:
+        return ContentFilterOther;
+    }
+}
+
+// Turn on or off content filtering by adding or removing a WebResourceRequested
+// handler which blocks the requests that the rules in assets/ContentFilter.txt
+// match. Each request only checks the few rules indexed under the tokens of
+// its URL, so a list the size of EasyList costs little per request. The handler
+// is added through the window's dispatcher, so that it doesn't also run for the
+// requests that other handlers' filters raise.
+void SettingsComponent::SetContentFilter(bool contentFilter)
+{
+    if (contentFilter != m_contentFilter)
+    {
+        m_contentFilter = contentFilter;
+        if (m_contentFilter)
+        {
+            CHECK_FAILURE(m_webResourceRequestedDispatcher->Add(
+                L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL,
+                COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT,
+                Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+                    [this](
+                        ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+                    {
+                        COREWEBVIEW2_WEB_RESOURCE_CONTEXT resourceContext;
+                        CHECK_FAILURE(args->get_ResourceContext(&resourceContext));
+                        wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+                        CHECK_FAILURE(args->get_Request(&request));
+                        wil::unique_cotaskmem_string uri;
+                        CHECK_FAILURE(request->get_Uri(&uri));
+                        // $third-party and $domain= rules are decided by the
+                        // document that made the request, which may be a frame's,
+                        // or the page being left while a navigation starts.
+                        wil::com_ptr<ICoreWebView2HttpRequestHeaders> headers;
+                        CHECK_FAILURE(request->get_Headers(&headers));
+                        wil::unique_cotaskmem_string referer;
+                        wil::unique_cotaskmem_string origin;
+                        if (headers->GetHeader(L"Referer", &referer) != S_OK)
+                        {
+                            referer.reset();
+                        }
+                        if (headers->GetHeader(L"Origin", &origin) != S_OK)
+                        {
+                            origin.reset();
+                        }
+                        ContentFilterRequest filterRequest;
+                        filterRequest.url = uri.get();
+                        filterRequest.documentUrl = GetContentFilterDocumentUrl(
+                            referer ? referer.get() : L"", origin ? origin.get() : L"");
+                        // The document of the navigation that NavigationStarting
+                        // was last raised for is the page's own, which no rule
+                        // blocks; any other is a frame's.
+                        filterRequest.type =
+                            resourceContext == COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT &&
+                                    m_navigationUri == uri.get()
+                                ? ContentFilterDocument
+                                : GetContentFilterType(resourceContext);
+                        if (GetAppContentFilter().Match(filterRequest) !=
+                            ContentFilterResult::Block)
+                        {
+                            return S_OK;
+                        }
+                        wil::com_ptr<ICoreWebView2WebResourceResponse> response;
+                        wil::com_ptr<ICoreWebView2Environment> environment;
+                        wil::com_ptr<ICoreWebView2_2> webview2;
+                        CHECK_FAILURE(m_webView->QueryInterface(IID_PPV_ARGS(&webview2)));
+                        CHECK_FAILURE(webview2->get_Environment(&environment));
+                        CHECK_FAILURE(environment->CreateWebResourceResponse(
+                            nullptr, 403, L"Blocked", L"", &response));
+                        CHECK_FAILURE(args->put_Response(response.get()));
+                        return S_OK;
+                    })
+                    .Get(),
+                &m_webResourceRequestedTokenForContentFilter));
+        }
+        else
+        {
+            CHECK_FAILURE(m_webResourceRequestedDispatcher->Remove(
+                m_webResourceRequestedTokenForContentFilter));
+        }
+    }
+}
+
 // Prompt the user for a new User Agent string
 void SettingsComponent::ChangeUserAgent()
 {
@@ -1812,20 +1988,8 @@ SettingsComponent::~SettingsComponent()
     m_webView->remove_NavigationStarting(m_navigationStartingToken);
     m_webView->remove_FrameNavigationStarting(m_frameNavigationStartingToken);
     m_webView->remove_WebResourceRequested(m_webResourceRequestedTokenForImageBlocking);
+    m_webView->remove_WebResourceRequested(m_webResourceRequestedTokenForImageReplacing);
+    m_webResourceRequestedDispatcher->Remove(m_webResourceRequestedTokenForContentFilter);
     m_webView->remove_ScriptDialogOpening(m_scriptDialogOpeningToken);
     m_webView->remove_PermissionRequested(m_permissionRequestedToken);
 }
-// Take advantage of urlmon's URI library to parse a URI
-wil::unique_bstr GetDomainOfUri(PWSTR uri)
-{
-    wil::com_ptr<IUri> uriObject;
-    HRESULT hr = CreateUri(
-        uri, Uri_CREATE_CANONICALIZE | Uri_CREATE_NO_DECODE_EXTRA_INFO, 0, &uriObject);
-    if (FAILED(hr))
-    {
-        return nullptr;
-    }
-    wil::unique_bstr domain;
-    uriObject->GetHost(&domain);
-    return domain;
-}
@@ -13,9 +13,7 @@
 #include "AppWindow.h"
 #include "ComponentBase.h"
 #include "CustomStatusBar.h"
-
-// Some utility functions
-wil::unique_bstr GetDomainOfUri(PWSTR uri);
+#include "DomainTrie.h"
 
 // This component handles commands from the Settings menu.  It also handles the
 // NavigationStarting, FrameNavigationStarting, WebResourceRequested, ScriptDialogOpening,
@@ -38,6 +36,7 @@ public:
     bool ShouldBlockScriptForUri(PWSTR uri);
     void SetBlockImages(bool blockImages);
     void SetReplaceImages(bool replaceImages);
+    void SetContentFilter(bool contentFilter);
     void ChangeUserAgent();
     void SetUserAgent(const std::wstring& userAgent);
     void EnableCustomClientCertificateSelection();
@@ -53,6 +52,7 @@ private:
         ICoreWebView2* sender, ICoreWebView2PermissionRequestedEventArgs* args);
     AppWindow* m_appWindow = nullptr;
     wil::com_ptr<ICoreWebView2> m_webView;
+    std::shared_ptr<WebResourceRequestedDispatcher> m_webResourceRequestedDispatcher;
     wil::com_ptr<ICoreWebView2_5> m_webView2_5;
     wil::com_ptr<ICoreWebView2_11> m_webView2_11;
     wil::com_ptr<ICoreWebView2_12> m_webView2_12;
@@ -76,6 +76,7 @@ private:
 
     bool m_blockImages = false;
     bool m_replaceImages = false;
+    bool m_contentFilter = false;
     bool m_changeUserAgent = false;
     bool m_isScriptEnabled = true;
     bool m_blockedSitesSet = false;
@@ -83,7 +84,7 @@ private:
     BOOL m_allowCustomMenus = false;
     std::map<std::tuple<std::wstring, COREWEBVIEW2_PERMISSION_KIND, BOOL>, bool>
         m_cached_permissions;
-    std::vector<std::wstring> m_blockedSites;
+    DomainTrie m_blockedSites;
     std::wstring m_overridingUserAgent;
     ULONG_PTR gdiplusToken_;
     bool m_faviconChanged = false;
@@ -95,8 +96,12 @@ private:
 
     EventRegistrationToken m_navigationStartingToken = {};
     EventRegistrationToken m_frameNavigationStartingToken = {};
+    // The URI of the last top-level navigation to start, whose document request
+    // the content filter doesn't block.
+    std::wstring m_navigationUri;
     EventRegistrationToken m_webResourceRequestedTokenForImageBlocking = {};
     EventRegistrationToken m_webResourceRequestedTokenForImageReplacing = {};
+    EventRegistrationToken m_webResourceRequestedTokenForContentFilter = {};
     EventRegistrationToken m_webResourceRequestedTokenForUserAgent = {};
     EventRegistrationToken m_scriptDialogOpeningToken = {};
     EventRegistrationToken m_permissionRequestedToken = {};
@@ -0,0 +1,178 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "StringInterner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+StringInterner::StringInterner(size_t capacityInChars)
+    : m_capacityInChars(capacityInChars), m_generations(c_tagCount)
+{
+    Rehash(1024);
+}
+
+namespace
+{
+uint64_t ReadWord(const unsigned char* bytes)
+{
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+uint64_t MixWord(uint64_t lane, uint64_t word)
+{
+    lane = (lane ^ word) * 0x9e3779b97f4a7c15ull;
+    return (lane << 31) | (lane >> 33);
+}
+} // namespace
+
+uint32_t StringInterner::Hash(std::wstring_view value)
+{
+    // Headers and URIs are hundreds of characters, and every event interns
+    // them, so they are hashed 8 bytes at a time in four independent lanes
+    // rather than one code unit at a time.
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(value.data());
+    size_t size = value.size() * sizeof(wchar_t);
+    uint64_t lane0 = size;
+    uint64_t lane1 = 0x243f6a8885a308d3ull;
+    uint64_t lane2 = 0x13198a2e03707344ull;
+    uint64_t lane3 = 0xa4093822299f31d0ull;
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32)
+    {
+        lane0 = MixWord(lane0, ReadWord(bytes + offset));
+        lane1 = MixWord(lane1, ReadWord(bytes + offset + 8));
+        lane2 = MixWord(lane2, ReadWord(bytes + offset + 16));
+        lane3 = MixWord(lane3, ReadWord(bytes + offset + 24));
+    }
+    for (; offset + 8 <= size; offset += 8)
+    {
+        lane0 = MixWord(lane0, ReadWord(bytes + offset));
+    }
+    if (offset < size)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + offset, size - offset);
+        lane1 = MixWord(lane1, word);
+    }
+    // Fold the lanes, then mix so that the low bits, which pick the bucket,
+    // depend on every byte.
+    uint64_t hash = lane0 ^ (lane1 * 0xc2b2ae3d27d4eb4full) ^ ((lane2 << 17) | (lane2 >> 47)) ^
+                    (lane3 * 0x165667b19e3779f9ull);
+    hash ^= hash >> 29;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 32;
+    return static_cast<uint32_t>(hash);
+}
+
+uint32_t StringInterner::Intern(std::wstring_view value)
+{
+    uint32_t tag = GetGenerationTag(m_generation);
+    Generation& generation = m_generations[tag];
+    uint32_t hash = Hash(value);
+    size_t mask = m_buckets.size() - 1;
+    size_t bucket = hash & mask;
+    while (m_buckets[bucket] != 0)
+    {
+        uint32_t index = m_buckets[bucket] - 1;
+        const Entry& entry = generation.entries[index];
+        if (entry.hash == hash && EntryText(generation, entry) == value)
+        {
+            return (tag << c_indexBits) | index;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+
+    if (generation.chars.size() + value.size() > m_capacityInChars ||
+        generation.entries.size() == c_indexMask)
+    {
+        if (!StartGeneration())
+        {
+            return c_noString;
+        }
+        return Intern(value.substr(0, m_capacityInChars));
+    }
+
+    uint32_t index = static_cast<uint32_t>(generation.entries.size());
+    generation.entries.push_back({generation.chars.size(), value.size(), hash});
+    generation.chars.append(value);
+    m_buckets[bucket] = index + 1;
+    // Keep the load factor at or below one half.
+    if (generation.entries.size() * 2 > m_buckets.size())
+    {
+        Rehash(m_buckets.size() * 2);
+    }
+    return (tag << c_indexBits) | index;
+}
+
+bool StringInterner::TryGet(uint32_t id, std::wstring_view* value) const
+{
+    uint32_t tag = GetTag(id);
+    uint32_t index = GetIndex(id);
+    // Released generations are left empty, so their ids fail the index check.
+    if (id == c_noString || index >= m_generations[tag].entries.size())
+    {
+        return false;
+    }
+    *value = EntryText(m_generations[tag], m_generations[tag].entries[index]);
+    return true;
+}
+
+bool StringInterner::StartGeneration()
+{
+    // The next generation's tag is still in use by the oldest one.
+    if (m_generation - m_oldestGeneration + 1 == c_tagCount - 1)
+    {
+        return false;
+    }
+    ++m_generation;
+    // The generation after a full one is likely to fill up too, so it takes
+    // the buffers of the last released generation, whose pages are already
+    // committed, or allocates them at full size rather than growing them by
+    // copying.
+    Generation& generation = m_generations[GetGenerationTag(m_generation)];
+    generation = std::move(m_spareGeneration);
+    m_spareGeneration = Generation();
+    generation.chars.reserve(m_capacityInChars);
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    return true;
+}
+
+void StringInterner::ReleaseGenerationsBefore(uint64_t generation)
+{
+    generation = (std::min)(generation, m_generation);
+    for (; m_oldestGeneration < generation; ++m_oldestGeneration)
+    {
+        // Keep one released generation's buffers for the next generation and
+        // give the rest of the memory back; a full generation holds up to the
+        // capacity.
+        Generation& released = m_generations[GetGenerationTag(m_oldestGeneration)];
+        if (m_spareGeneration.chars.capacity() < released.chars.capacity())
+        {
+            m_spareGeneration = std::move(released);
+            m_spareGeneration.chars.clear();
+            m_spareGeneration.entries.clear();
+        }
+        released = Generation();
+    }
+}
+
+void StringInterner::Rehash(size_t bucketCount)
+{
+    const Generation& generation = m_generations[GetGenerationTag(m_generation)];
+    m_buckets.assign(bucketCount, 0);
+    size_t mask = bucketCount - 1;
+    for (uint32_t index = 0; index < generation.entries.size(); ++index)
+    {
+        size_t bucket = generation.entries[index].hash & mask;
+        while (m_buckets[bucket] != 0)
+        {
+            bucket = (bucket + 1) & mask;
+        }
+        m_buckets[bucket] = index + 1;
+    }
+}
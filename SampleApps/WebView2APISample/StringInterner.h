@@ -0,0 +1,90 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Assigns a small integer id to each distinct string, so records can refer to
+// repeated strings such as URIs and header lists without copying them.
+//
+// Strings are added to the current generation. When its stored characters
+// would exceed the capacity, a new generation is started and the full one is
+// kept, so ids already handed out stay valid until the owner releases their
+// generation. Id 0 (c_noString) never refers to a string.
+//
+// Not thread-safe.
+class StringInterner
+{
+public:
+    static constexpr uint32_t c_noString = 0;
+
+    explicit StringInterner(size_t capacityInChars);
+
+    // Returns the id of value, adding it if it isn't already present. Returns
+    // c_noString if a new generation is needed but all of them are in use.
+    uint32_t Intern(std::wstring_view value);
+    // Returns false if id is c_noString or its generation has been released.
+    // The view is only valid until the next call to Intern. Once released, a
+    // generation's tag is reused, so ids must not outlive their generation.
+    bool TryGet(uint32_t id, std::wstring_view* value) const;
+
+    // Generations are numbered from 0 in the order they are started.
+    uint64_t GetGeneration() const { return m_generation; }
+    uint64_t GetOldestGeneration() const { return m_oldestGeneration; }
+    // Free the generations before generation, other than the current one.
+    void ReleaseGenerationsBefore(uint64_t generation);
+
+    // An id is a generation tag and an index. The tags of the generations
+    // that haven't been released are distinct, and the indexes of one
+    // generation are small and dense, so they can index tables kept alongside.
+    static constexpr uint32_t c_tagCount = 256;
+    static uint32_t GetTag(uint32_t id) { return id >> c_indexBits; }
+    static uint32_t GetGenerationTag(uint64_t generation)
+    {
+        return static_cast<uint32_t>(generation % (c_tagCount - 1)) + 1;
+    }
+    static uint32_t GetIndex(uint32_t id) { return id & c_indexMask; }
+
+private:
+    static constexpr uint32_t c_indexBits = 24;
+    static constexpr uint32_t c_indexMask = (1u << c_indexBits) - 1;
+
+    struct Entry
+    {
+        size_t offset;
+        size_t length;
+        uint32_t hash;
+    };
+
+    struct Generation
+    {
+        // All strings of the generation, back to back.
+        std::wstring chars;
+        std::vector<Entry> entries;
+    };
+
+    static uint32_t Hash(std::wstring_view value);
+    bool StartGeneration();
+    void Rehash(size_t bucketCount);
+    static std::wstring_view EntryText(const Generation& generation, const Entry& entry)
+    {
+        return std::wstring_view(generation.chars.data() + entry.offset, entry.length);
+    }
+
+    size_t m_capacityInChars;
+    // Indexed by tag; tag 0 is never used, so that no valid id is 0.
+    std::vector<Generation> m_generations;
+    uint64_t m_generation = 0;
+    uint64_t m_oldestGeneration = 0;
+    // Emptied buffers of a released generation, reused by the next one.
+    Generation m_spareGeneration;
+    // Open-addressing hash table of the current generation's entry index + 1;
+    // 0 marks an empty bucket.
+    std::vector<uint32_t> m_buckets;
+};
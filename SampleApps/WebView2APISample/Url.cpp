@@ -0,0 +1,1963 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Url.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+constexpr uint32_t c_eof = UINT32_MAX;
+constexpr uint32_t c_replacementCharacter = 0xFFFD;
+
+// The ASCII code points a percent-encode set encodes, one bit each. Code points
+// beyond ASCII are always encoded.
+struct EncodeSet
+{
+    uint32_t words[4];
+};
+
+constexpr EncodeSet Extend(EncodeSet set, std::string_view characters)
+{
+    for (char c : characters)
+    {
+        set.words[c >> 5] |= uint32_t(1) << (c & 31);
+    }
+    return set;
+}
+
+constexpr EncodeSet MakeC0ControlSet()
+{
+    EncodeSet set = {};
+    set.words[0] = UINT32_MAX;
+    set.words[3] = uint32_t(1) << 31;
+    return set;
+}
+
+bool Contains(const EncodeSet& set, uint32_t c)
+{
+    return ((set.words[c >> 5] >> (c & 31)) & 1) != 0;
+}
+
+constexpr EncodeSet c_c0ControlSet = MakeC0ControlSet();
+constexpr EncodeSet c_fragmentSet = Extend(c_c0ControlSet, " \"<>`");
+constexpr EncodeSet c_querySet = Extend(c_c0ControlSet, " \"#<>");
+constexpr EncodeSet c_specialQuerySet = Extend(c_querySet, "'");
+constexpr EncodeSet c_pathSet = Extend(c_querySet, "?`{}");
+constexpr EncodeSet c_userinfoSet = Extend(c_pathSet, "/:;=@[\\]^|");
+
+constexpr EncodeSet MakeForbiddenHostSet()
+{
+    EncodeSet set = {};
+    set.words[0] = (uint32_t(1) << 0x00) | (uint32_t(1) << '\t') | (uint32_t(1) << '\n') |
+                   (uint32_t(1) << '\r');
+    return Extend(set, " #/:<>?@[\\]^|");
+}
+
+constexpr EncodeSet c_forbiddenHostSet = MakeForbiddenHostSet();
+constexpr EncodeSet c_forbiddenDomainSet = Extend(c_c0ControlSet, " #%/:<>?@[\\]^|");
+
+// The characters that end a path segment, query or opaque path.
+constexpr EncodeSet c_pathEndSet = Extend(EncodeSet{}, "/?#");
+constexpr EncodeSet c_specialPathEndSet = Extend(c_pathEndSet, "\\");
+constexpr EncodeSet c_queryEndSet = Extend(EncodeSet{}, "#");
+constexpr EncodeSet c_opaquePathEndSet = Extend(EncodeSet{}, "?#");
+
+struct SpecialScheme
+{
+    std::string_view name;
+    // -1 for none.
+    int defaultPort;
+};
+
+constexpr SpecialScheme c_specialSchemes[] = {
+    {"http", 80}, {"https", 443}, {"ws", 80}, {"wss", 443}, {"ftp", 21}, {"file", -1},
+};
+
+const SpecialScheme* FindSpecialScheme(std::string_view scheme)
+{
+    for (const SpecialScheme& special : c_specialSchemes)
+    {
+        if (special.name == scheme)
+        {
+            return &special;
+        }
+    }
+    return nullptr;
+}
+
+bool IsAsciiAlpha(uint32_t c)
+{
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+bool IsAsciiDigit(uint32_t c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool IsAsciiHexDigit(uint32_t c)
+{
+    return IsAsciiDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+int HexValue(uint32_t c)
+{
+    return IsAsciiDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+uint32_t ToAsciiLower(uint32_t c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+bool EqualsIgnoringAsciiCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() &&
+           std::equal(
+               a.begin(), a.end(), b.begin(),
+               [](char x, char y) { return ToAsciiLower(x) == ToAsciiLower(y); });
+}
+
+// Write a code point as UTF-8, and return the number of bytes.
+size_t EncodeUtf8(uint32_t c, uint8_t* bytes)
+{
+    if (c < 0x80)
+    {
+        bytes[0] = static_cast<uint8_t>(c);
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        bytes[0] = static_cast<uint8_t>(0xC0 | (c >> 6));
+        bytes[1] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        bytes[0] = static_cast<uint8_t>(0xE0 | (c >> 12));
+        bytes[1] = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+        bytes[2] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+        return 3;
+    }
+    bytes[0] = static_cast<uint8_t>(0xF0 | (c >> 18));
+    bytes[1] = static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3F));
+    bytes[2] = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+    bytes[3] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    return 4;
+}
+
+// Decode the UTF-8 code point at text[pos], as the Encoding Standard does: an
+// invalid sequence is U+FFFD, and ends before the first byte that can't
+// continue it.
+template <typename Byte> uint32_t DecodeUtf8(const Byte* text, size_t size, size_t* pos)
+{
+    uint32_t lead = static_cast<uint8_t>(text[(*pos)++]);
+    if (lead < 0x80)
+    {
+        return lead;
+    }
+    size_t needed;
+    uint32_t c;
+    uint8_t lower = 0x80;
+    uint8_t upper = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        needed = 1;
+        c = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        lower = lead == 0xE0 ? 0xA0 : 0x80;
+        upper = lead == 0xED ? 0x9F : 0xBF;
+        needed = 2;
+        c = lead & 0x0F;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        lower = lead == 0xF0 ? 0x90 : 0x80;
+        upper = lead == 0xF4 ? 0x8F : 0xBF;
+        needed = 3;
+        c = lead & 0x07;
+    }
+    else
+    {
+        return c_replacementCharacter;
+    }
+    for (size_t i = 0; i < needed; ++i)
+    {
+        if (*pos == size)
+        {
+            return c_replacementCharacter;
+        }
+        uint8_t byte = static_cast<uint8_t>(text[*pos]);
+        if (byte < lower || byte > upper)
+        {
+            return c_replacementCharacter;
+        }
+        lower = 0x80;
+        upper = 0xBF;
+        c = (c << 6) | (byte & 0x3F);
+        ++*pos;
+    }
+    return c;
+}
+
+// The ASCII letter or digit a mathematical alphanumeric symbol stands for, or 0
+// if it is in a style with gaps, which aren't mapped here.
+uint32_t MapMathematicalAlphanumeric(uint32_t c)
+{
+    // Bold, bold italic, bold script, bold Fraktur, sans-serif and its bold and
+    // italics, and monospace, which have all 52 letters.
+    constexpr uint32_t c_letterStyles[] = {
+        0x1D400, 0x1D468, 0x1D4D0, 0x1D56C, 0x1D5A0, 0x1D5D4, 0x1D608, 0x1D63C, 0x1D670,
+    };
+    for (uint32_t style : c_letterStyles)
+    {
+        if (c >= style && c < style + 52)
+        {
+            return c - style < 26 ? 'a' + (c - style) : 'a' + (c - style - 26);
+        }
+    }
+    if (c >= 0x1D7CE && c <= 0x1D7FF)
+    {
+        return '0' + (c - 0x1D7CE) % 10;
+    }
+    return 0;
+}
+
+// Unicode's lowercase of the capital letters of Latin-1, Greek and Cyrillic,
+// which is as much of UTS #46's mapping as this takes on without its tables.
+uint32_t ToSimpleLower(uint32_t c)
+{
+    if ((c >= 0xC0 && c <= 0xDE && c != 0xD7) || (c >= 0x391 && c <= 0x3AB && c != 0x3A2) ||
+        (c >= 0x410 && c <= 0x42F))
+    {
+        return c + 0x20;
+    }
+    if (c >= 0x400 && c <= 0x40F)
+    {
+        return c + 0x50;
+    }
+    return c;
+}
+
+enum class IdnaStatus
+{
+    Valid,
+    Ignored,
+    Disallowed,
+};
+
+// How UTS #46 treats a code point that isn't ASCII, after *c is mapped.
+IdnaStatus MapIdnaCodePoint(uint32_t* c)
+{
+    uint32_t code = *c;
+    if (code == 0xAD || code == 0x34F || (code >= 0x180B && code <= 0x180D) ||
+        code == 0x200B || code == 0x2060 || code == 0xFEFF || (code >= 0xFE00 && code <= 0xFE0F))
+    {
+        return IdnaStatus::Ignored;
+    }
+    if (code == 0x3002 || code == 0xFF0E || code == 0xFF61)
+    {
+        *c = '.';
+        return IdnaStatus::Valid;
+    }
+    if (code == 0xA0 || code == 0x3000)
+    {
+        *c = ' ';
+        return IdnaStatus::Valid;
+    }
+    if (code >= 0xFF01 && code <= 0xFF5E)
+    {
+        *c = ToAsciiLower(code - 0xFEE0);
+        return IdnaStatus::Valid;
+    }
+    if (code >= 0x1D400 && code <= 0x1D7FF)
+    {
+        *c = MapMathematicalAlphanumeric(code);
+        return *c != 0 ? IdnaStatus::Valid : IdnaStatus::Disallowed;
+    }
+    // UTS #46 maps enclosed alphanumerics, CJK compatibility characters and
+    // ideographs to other strings, which this doesn't have the tables for.
+    if ((code >= 0x2460 && code <= 0x24FF) || (code >= 0x3200 && code <= 0x33FF) ||
+        (code >= 0xF900 && code <= 0xFAFF))
+    {
+        return IdnaStatus::Disallowed;
+    }
+    if (code <= 0x9F || code == c_replacementCharacter || (code >= 0xFDD0 && code <= 0xFDEF) ||
+        (code & 0xFFFE) == 0xFFFE || (code >= 0xD800 && code <= 0xDFFF) ||
+        code == 0x2028 || code == 0x2029 || (code >= 0xE000 && code <= 0xF8FF))
+    {
+        return IdnaStatus::Disallowed;
+    }
+    *c = ToSimpleLower(code);
+    return IdnaStatus::Valid;
+}
+
+// Punycode, as RFC 3492 gives it.
+constexpr uint32_t c_punycodeBase = 36;
+constexpr uint32_t c_punycodeTMin = 1;
+constexpr uint32_t c_punycodeTMax = 26;
+constexpr uint32_t c_punycodeSkew = 38;
+constexpr uint32_t c_punycodeDamp = 700;
+constexpr uint32_t c_punycodeInitialBias = 72;
+constexpr uint32_t c_punycodeInitialN = 0x80;
+
+uint32_t AdaptPunycodeBias(uint32_t delta, uint32_t points, bool first)
+{
+    delta = first ? delta / c_punycodeDamp : delta / 2;
+    delta += delta / points;
+    uint32_t k = 0;
+    while (delta > ((c_punycodeBase - c_punycodeTMin) * c_punycodeTMax) / 2)
+    {
+        delta /= c_punycodeBase - c_punycodeTMin;
+        k += c_punycodeBase;
+    }
+    return k + (c_punycodeBase - c_punycodeTMin + 1) * delta / (delta + c_punycodeSkew);
+}
+
+char EncodePunycodeDigit(uint32_t digit)
+{
+    return static_cast<char>(digit < 26 ? 'a' + digit : '0' + digit - 26);
+}
+
+// Decode a Punycode label, without its "xn--", into code points. Returns false
+// if it isn't valid, or decodes to more than capacity code points.
+bool DecodePunycode(std::string_view input, uint32_t* output, size_t capacity, size_t* size)
+{
+    size_t count = 0;
+    size_t basic = input.rfind('-');
+    if (basic == std::string_view::npos)
+    {
+        basic = 0;
+    }
+    else
+    {
+        if (basic > capacity)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < basic; ++i)
+        {
+            if (static_cast<uint8_t>(input[i]) >= 0x80)
+            {
+                return false;
+            }
+            output[count++] = static_cast<uint8_t>(input[i]);
+        }
+        ++basic;
+    }
+    uint32_t n = c_punycodeInitialN;
+    uint32_t bias = c_punycodeInitialBias;
+    uint64_t i = 0;
+    for (size_t in = basic; in < input.size();)
+    {
+        uint64_t oldI = i;
+        uint64_t weight = 1;
+        for (uint32_t k = c_punycodeBase;; k += c_punycodeBase)
+        {
+            if (in == input.size())
+            {
+                return false;
+            }
+            uint32_t c = ToAsciiLower(static_cast<uint8_t>(input[in++]));
+            uint32_t digit;
+            if (c >= 'a' && c <= 'z')
+            {
+                digit = c - 'a';
+            }
+            else if (c >= '0' && c <= '9')
+            {
+                digit = c - '0' + 26;
+            }
+            else
+            {
+                return false;
+            }
+            i += digit * weight;
+            uint32_t t = k <= bias                     ? c_punycodeTMin
+                         : k >= bias + c_punycodeTMax ? c_punycodeTMax
+                                                      : k - bias;
+            if (i > UINT32_MAX)
+            {
+                return false;
+            }
+            if (digit < t)
+            {
+                break;
+            }
+            weight *= c_punycodeBase - t;
+            if (weight > UINT32_MAX)
+            {
+                return false;
+            }
+        }
+        bias = AdaptPunycodeBias(static_cast<uint32_t>(i - oldI), uint32_t(count + 1), oldI == 0);
+        n += static_cast<uint32_t>(i / (count + 1));
+        i %= count + 1;
+        if (n > 0x10FFFF || (n >= 0xD800 && n <= 0xDFFF) || count == capacity)
+        {
+            return false;
+        }
+        std::copy_backward(output + i, output + count, output + count + 1);
+        output[i++] = n;
+        ++count;
+    }
+    *size = count;
+    return true;
+}
+
+// The value of one part of an IPv4 address, which can be decimal, octal with
+// a leading 0, or hexadecimal with a leading 0x. Returns false if it isn't a
+// number; values too large to be a part are capped above UINT32_MAX.
+bool ParseIPv4Number(std::string_view text, uint64_t* value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    uint32_t radix = 10;
+    if (text.size() >= 2 && text[0] == '0' && (text[1] | 0x20) == 'x')
+    {
+        radix = 16;
+        text.remove_prefix(2);
+    }
+    else if (text.size() >= 2 && text[0] == '0')
+    {
+        radix = 8;
+        text.remove_prefix(1);
+    }
+    uint64_t result = 0;
+    for (char c : text)
+    {
+        uint32_t digit;
+        if (radix == 16 && IsAsciiHexDigit(c))
+        {
+            digit = HexValue(c);
+        }
+        else if (IsAsciiDigit(c) && uint32_t(c - '0') < radix)
+        {
+            digit = c - '0';
+        }
+        else
+        {
+            return false;
+        }
+        result = (std::min)(result * radix + digit, uint64_t(UINT32_MAX) + 1);
+    }
+    *value = result;
+    return true;
+}
+
+// Whether a domain's last label is a number, which makes it an IPv4 address.
+bool EndsInANumber(std::string_view domain)
+{
+    if (!domain.empty() && domain.back() == '.')
+    {
+        domain.remove_suffix(1);
+        if (domain.empty())
+        {
+            return false;
+        }
+    }
+    std::string_view last = domain.substr(domain.rfind('.') + 1);
+    if (!last.empty() && std::all_of(last.begin(), last.end(), IsAsciiDigit))
+    {
+        return true;
+    }
+    uint64_t value;
+    return ParseIPv4Number(last, &value);
+}
+
+bool ParseIPv4(std::string_view domain, uint32_t* address)
+{
+    if (!domain.empty() && domain.back() == '.' && domain.size() > 1)
+    {
+        domain.remove_suffix(1);
+    }
+    uint64_t numbers[4];
+    size_t count = 0;
+    while (true)
+    {
+        size_t dot = domain.find('.');
+        if (count == 4 || !ParseIPv4Number(domain.substr(0, dot), &numbers[count]))
+        {
+            return false;
+        }
+        ++count;
+        if (dot == std::string_view::npos)
+        {
+            break;
+        }
+        domain.remove_prefix(dot + 1);
+    }
+    for (size_t i = 0; i + 1 < count; ++i)
+    {
+        if (numbers[i] > 255)
+        {
+            return false;
+        }
+    }
+    if (numbers[count - 1] >= (uint64_t(1) << (8 * (5 - count))))
+    {
+        return false;
+    }
+    uint64_t result = numbers[count - 1];
+    for (size_t i = 0; i + 1 < count; ++i)
+    {
+        result += numbers[i] << (8 * (3 - i));
+    }
+    *address = static_cast<uint32_t>(result);
+    return true;
+}
+
+bool ParseIPv6(const uint32_t* input, size_t size, uint16_t address[8])
+{
+    std::fill(address, address + 8, uint16_t(0));
+    size_t pieceIndex = 0;
+    size_t compress = SIZE_MAX;
+    size_t p = 0;
+    auto at = [&](size_t i) { return i < size ? input[i] : c_eof; };
+    if (at(p) == ':')
+    {
+        if (at(p + 1) != ':')
+        {
+            return false;
+        }
+        p += 2;
+        compress = ++pieceIndex;
+    }
+    while (at(p) != c_eof)
+    {
+        if (pieceIndex == 8)
+        {
+            return false;
+        }
+        if (at(p) == ':')
+        {
+            if (compress != SIZE_MAX)
+            {
+                return false;
+            }
+            ++p;
+            compress = ++pieceIndex;
+            continue;
+        }
+        uint32_t value = 0;
+        size_t length = 0;
+        while (length < 4 && IsAsciiHexDigit(at(p)))
+        {
+            value = value * 0x10 + HexValue(at(p));
+            ++p;
+            ++length;
+        }
+        if (at(p) == '.')
+        {
+            // An IPv4 address in the last two pieces.
+            if (length == 0 || pieceIndex > 6)
+            {
+                return false;
+            }
+            p -= length;
+            size_t numbersSeen = 0;
+            while (at(p) != c_eof)
+            {
+                if (numbersSeen > 0)
+                {
+                    if (at(p) != '.' || numbersSeen >= 4)
+                    {
+                        return false;
+                    }
+                    ++p;
+                }
+                if (!IsAsciiDigit(at(p)))
+                {
+                    return false;
+                }
+                int piece = -1;
+                while (IsAsciiDigit(at(p)))
+                {
+                    int number = at(p) - '0';
+                    if (piece == 0)
+                    {
+                        return false;
+                    }
+                    piece = piece == -1 ? number : piece * 10 + number;
+                    if (piece > 255)
+                    {
+                        return false;
+                    }
+                    ++p;
+                }
+                address[pieceIndex] = static_cast<uint16_t>(address[pieceIndex] * 0x100 + piece);
+                ++numbersSeen;
+                if (numbersSeen == 2 || numbersSeen == 4)
+                {
+                    ++pieceIndex;
+                }
+            }
+            if (numbersSeen != 4)
+            {
+                return false;
+            }
+            break;
+        }
+        if (at(p) == ':')
+        {
+            ++p;
+            if (at(p) == c_eof)
+            {
+                return false;
+            }
+        }
+        else if (at(p) != c_eof)
+        {
+            return false;
+        }
+        address[pieceIndex++] = static_cast<uint16_t>(value);
+    }
+    if (compress != SIZE_MAX)
+    {
+        size_t swaps = pieceIndex - compress;
+        pieceIndex = 7;
+        while (pieceIndex != 0 && swaps > 0)
+        {
+            std::swap(address[pieceIndex], address[compress + swaps - 1]);
+            --pieceIndex;
+            --swaps;
+        }
+    }
+    else if (pieceIndex != 8)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool IsWindowsDriveLetter(std::string_view text)
+{
+    return text.size() == 2 && IsAsciiAlpha(text[0]) && (text[1] == ':' || text[1] == '|');
+}
+
+bool IsSingleDotSegment(std::string_view segment)
+{
+    return segment == "." || EqualsIgnoringAsciiCase(segment, "%2e");
+}
+
+bool IsDoubleDotSegment(std::string_view segment)
+{
+    return segment == ".." || EqualsIgnoringAsciiCase(segment, ".%2e") ||
+           EqualsIgnoringAsciiCase(segment, "%2e.") || EqualsIgnoringAsciiCase(segment, "%2e%2e");
+}
+} // namespace
+
+// The basic URL parser, over input of one kind of code unit, writing into a
+// Url. It follows the standard's state machine, with each group of states
+// as a function, and a position in the input in place of its pointer.
+template <typename Char> class UrlParser
+{
+public:
+    // Parse input into url, which is left empty if it isn't valid. base can be
+    // url itself.
+    static bool Parse(std::basic_string_view<Char> input, const Url* base, Url* url)
+    {
+        if (base == url)
+        {
+            Url copy(*base);
+            return Parse(input, &copy, url);
+        }
+        url->Clear();
+        if (!UrlParser(input, base, url).Run())
+        {
+            url->Clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+    UrlParser(std::basic_string_view<Char> input, const Url* base, Url* url)
+        : m_input(input.data()), m_end(input.size()), m_base(base), m_url(*url)
+    {
+    }
+
+    bool Run();
+    // The code point at pos, after any tabs and newlines, which the parser
+    // ignores, and the position after it; c_eof at the end.
+    uint32_t At(size_t pos, size_t* next) const
+    {
+        // Most URLs are printable ASCII.
+        if (pos < m_end)
+        {
+            uint32_t c = static_cast<std::make_unsigned_t<Char>>(m_input[pos]);
+            if (c >= 0x20 && c < 0x7F)
+            {
+                *next = pos + 1;
+                return c;
+            }
+        }
+        return DecodeAt(pos, next);
+    }
+    uint32_t DecodeAt(size_t pos, size_t* next) const;
+    uint32_t At(size_t pos) const
+    {
+        size_t next;
+        return At(pos, &next);
+    }
+    // Whether the input from pos starts with a Windows drive letter, as "C:"
+    // followed by the end or a path, query or fragment.
+    bool StartsWithWindowsDriveLetter(size_t pos) const;
+    bool IsSlash(uint32_t c) const { return c == '/' || (m_url.m_special && c == '\\'); }
+
+    bool ParseScheme(size_t* pos);
+    bool ParseNoScheme(size_t pos);
+    bool ParseRelative(size_t pos);
+    bool ParseFile(size_t pos);
+    bool ParseFileHost(size_t pos);
+    bool ParseAuthority(size_t pos);
+    bool ParseHost(const uint32_t* host, size_t size);
+    bool ParseDomain(const uint32_t* domain, size_t size);
+    bool ParsePathStart(size_t pos);
+    bool ParsePath(size_t pos);
+    bool ParseOpaquePath(size_t pos);
+    bool ParseQuery(size_t pos);
+    bool ParseFragment(size_t pos);
+    bool Finish();
+
+    // Copy parts of the base URL, which has the same scheme as this one.
+    void CopyBaseAuthority();
+    void CopyBasePath();
+    void CopyBaseQuery();
+    void ShortenPath();
+    void AppendEncoded(uint32_t c, const EncodeSet& set);
+    // Append the code points from *pos up to the first of end, or the end of
+    // the input, encoded with set. Returns that code point, or c_eof, with *pos
+    // at it and *next after it.
+    uint32_t AppendEncodedUntil(
+        size_t* pos, size_t* next, const EncodeSet& set, const EncodeSet& end);
+    void AppendHostFromBase();
+
+    const Char* m_input;
+    size_t m_end;
+    const Url* m_base;
+    Url& m_url;
+};
+
+template <typename Char> uint32_t UrlParser<Char>::DecodeAt(size_t pos, size_t* next) const
+{
+    while (pos < m_end && (m_input[pos] == '\t' || m_input[pos] == '\n' || m_input[pos] == '\r'))
+    {
+        ++pos;
+    }
+    if (pos == m_end)
+    {
+        *next = pos;
+        return c_eof;
+    }
+    if constexpr (sizeof(Char) == 1)
+    {
+        uint32_t c = DecodeUtf8(m_input, m_end, &pos);
+        *next = pos;
+        return c;
+    }
+    else if constexpr (sizeof(Char) == 2)
+    {
+        uint32_t c = static_cast<uint16_t>(m_input[pos++]);
+        if (c >= 0xD800 && c <= 0xDBFF && pos < m_end)
+        {
+            uint32_t low = static_cast<uint16_t>(m_input[pos]);
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                ++pos;
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+            }
+        }
+        *next = pos;
+        return c >= 0xD800 && c <= 0xDFFF ? c_replacementCharacter : c;
+    }
+    else
+    {
+        uint32_t c = static_cast<uint32_t>(m_input[pos]);
+        *next = pos + 1;
+        return (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF ? c_replacementCharacter : c;
+    }
+}
+
+template <typename Char> bool UrlParser<Char>::StartsWithWindowsDriveLetter(size_t pos) const
+{
+    size_t next;
+    if (!IsAsciiAlpha(At(pos, &next)))
+    {
+        return false;
+    }
+    uint32_t c = At(next, &next);
+    if (c != ':' && c != '|')
+    {
+        return false;
+    }
+    c = At(next);
+    return c == c_eof || c == '/' || c == '\\' || c == '?' || c == '#';
+}
+
+template <typename Char> bool UrlParser<Char>::Run()
+{
+    // Leading and trailing C0 controls and spaces are ignored.
+    size_t begin = 0;
+    while (begin < m_end && static_cast<uint32_t>(m_input[begin]) <= 0x20)
+    {
+        ++begin;
+    }
+    while (m_end > begin && static_cast<uint32_t>(m_input[m_end - 1]) <= 0x20)
+    {
+        --m_end;
+    }
+    size_t pos = begin;
+    if (!ParseScheme(&pos))
+    {
+        return ParseNoScheme(begin);
+    }
+    std::string_view scheme = m_url.GetScheme();
+    if (scheme == "file")
+    {
+        return ParseFile(pos);
+    }
+    size_t next;
+    uint32_t c = At(pos, &next);
+    if (m_url.m_special)
+    {
+        if (m_base && m_base->GetScheme() == scheme && !(c == '/' && At(next) == '/'))
+        {
+            return ParseRelative(pos);
+        }
+        while (c == '/' || c == '\\')
+        {
+            pos = next;
+            c = At(pos, &next);
+        }
+        return ParseAuthority(pos);
+    }
+    if (c == '/')
+    {
+        size_t afterSlashes;
+        if (At(next, &afterSlashes) == '/')
+        {
+            return ParseAuthority(afterSlashes);
+        }
+        m_url.m_hostBegin = m_url.m_hostEnd = m_url.m_size;
+        m_url.m_authorityEnd = m_url.m_size;
+        return ParsePath(next);
+    }
+    return ParseOpaquePath(pos);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseScheme(size_t* pos)
+{
+    size_t next;
+    uint32_t c = At(*pos, &next);
+    if (!IsAsciiAlpha(c))
+    {
+        return false;
+    }
+    while (IsAsciiAlpha(c) || IsAsciiDigit(c) || c == '+' || c == '-' || c == '.')
+    {
+        m_url.Append(static_cast<char>(ToAsciiLower(c)));
+        c = At(next, &next);
+    }
+    if (c != ':')
+    {
+        m_url.Clear();
+        return false;
+    }
+    *pos = next;
+    m_url.m_schemeEnd = m_url.m_size;
+    m_url.Append(':');
+    m_url.m_special = FindSpecialScheme(m_url.GetScheme()) != nullptr;
+    return true;
+}
+
+template <typename Char> bool UrlParser<Char>::ParseNoScheme(size_t pos)
+{
+    uint32_t c = At(pos);
+    if (!m_base || (m_base->m_opaquePath && c != '#'))
+    {
+        return false;
+    }
+    m_url.Append(m_base->GetHref().substr(0, m_base->m_schemeEnd + 1));
+    m_url.m_schemeEnd = m_base->m_schemeEnd;
+    m_url.m_special = m_base->m_special;
+    if (m_base->m_opaquePath)
+    {
+        CopyBaseAuthority();
+        CopyBasePath();
+        CopyBaseQuery();
+        m_url.m_opaquePath = true;
+        size_t next;
+        At(pos, &next);
+        return ParseFragment(next);
+    }
+    if (m_url.GetScheme() == "file")
+    {
+        return ParseFile(pos);
+    }
+    return ParseRelative(pos);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseRelative(size_t pos)
+{
+    size_t next;
+    uint32_t c = At(pos, &next);
+    if (IsSlash(c))
+    {
+        size_t afterSlash;
+        uint32_t second = At(next, &afterSlash);
+        if (IsSlash(second))
+        {
+            pos = afterSlash;
+            if (m_url.m_special)
+            {
+                while ((c = At(pos, &next)) == '/' || c == '\\')
+                {
+                    pos = next;
+                }
+            }
+            return ParseAuthority(pos);
+        }
+        CopyBaseAuthority();
+        return ParsePath(next);
+    }
+    CopyBaseAuthority();
+    CopyBasePath();
+    if (c == '#')
+    {
+        CopyBaseQuery();
+        return ParseFragment(next);
+    }
+    if (c == '?')
+    {
+        m_url.m_pathEnd = m_url.m_size;
+        return ParseQuery(next);
+    }
+    if (c == c_eof)
+    {
+        CopyBaseQuery();
+        return Finish();
+    }
+    ShortenPath();
+    return ParsePath(pos);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseFile(size_t pos)
+{
+    m_url.m_special = true;
+    bool baseIsFile = m_base && m_base->GetScheme() == "file";
+    size_t next;
+    uint32_t c = At(pos, &next);
+    if (c == '/' || c == '\\')
+    {
+        size_t afterSlash;
+        uint32_t second = At(next, &afterSlash);
+        if (second == '/' || second == '\\')
+        {
+            return ParseFileHost(afterSlash);
+        }
+        m_url.Append("//");
+        if (baseIsFile)
+        {
+            AppendHostFromBase();
+            std::string_view basePath = m_base->GetPath();
+            if (!StartsWithWindowsDriveLetter(next) && basePath.size() >= 3 &&
+                (basePath.size() == 3 || basePath[3] == '/') &&
+                IsWindowsDriveLetter(basePath.substr(1, 2)) && basePath[2] == ':')
+            {
+                m_url.Append(basePath.substr(0, 3));
+            }
+        }
+        else
+        {
+            m_url.m_hostBegin = m_url.m_hostEnd = m_url.m_size;
+            m_url.m_hostType = UrlHostType::Empty;
+            m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+        }
+        return ParsePath(next);
+    }
+    m_url.Append("//");
+    if (!baseIsFile)
+    {
+        m_url.m_hostBegin = m_url.m_hostEnd = m_url.m_size;
+        m_url.m_hostType = UrlHostType::Empty;
+        m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+        return ParsePath(pos);
+    }
+    AppendHostFromBase();
+    CopyBasePath();
+    if (c == c_eof)
+    {
+        CopyBaseQuery();
+        return Finish();
+    }
+    if (c == '?')
+    {
+        m_url.m_pathEnd = m_url.m_size;
+        return ParseQuery(next);
+    }
+    if (c == '#')
+    {
+        CopyBaseQuery();
+        return ParseFragment(next);
+    }
+    if (StartsWithWindowsDriveLetter(pos))
+    {
+        m_url.m_size = m_url.m_pathBegin;
+    }
+    else
+    {
+        ShortenPath();
+    }
+    return ParsePath(pos);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseFileHost(size_t pos)
+{
+    uint32_t host[c_maxUrlHostSize];
+    size_t size = 0;
+    size_t end = pos;
+    size_t next;
+    for (uint32_t c = At(end, &next);
+         c != c_eof && c != '/' && c != '\\' && c != '?' && c != '#'; c = At(end, &next))
+    {
+        if (size == c_maxUrlHostSize)
+        {
+            return false;
+        }
+        host[size++] = c;
+        end = next;
+    }
+    m_url.Append("//");
+    if (size == 2 && IsAsciiAlpha(host[0]) && (host[1] == ':' || host[1] == '|'))
+    {
+        // "file://C:/" is a path, which has no host.
+        m_url.m_hostBegin = m_url.m_hostEnd = m_url.m_size;
+        m_url.m_hostType = UrlHostType::Empty;
+        m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+        return ParsePath(pos);
+    }
+    m_url.m_hostBegin = m_url.m_size;
+    if (size != 0 && !ParseHost(host, size))
+    {
+        return false;
+    }
+    if (size == 0 || m_url.GetHost() == "localhost")
+    {
+        m_url.m_size = m_url.m_hostEnd = m_url.m_hostBegin;
+        m_url.m_hostType = UrlHostType::Empty;
+    }
+    m_url.m_authorityEnd = m_url.m_size;
+    return ParsePathStart(end);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseAuthority(size_t pos)
+{
+    m_url.Append("//");
+    // Find the end of the authority, and the last '@' in it, which ends the
+    // credentials.
+    size_t end = pos;
+    size_t at = SIZE_MAX;
+    size_t hostStart = pos;
+    size_t next;
+    for (uint32_t c = At(end, &next); c != c_eof && !IsSlash(c) && c != '?' && c != '#';
+         c = At(end, &next))
+    {
+        if (c == '@')
+        {
+            at = end;
+            hostStart = next;
+        }
+        end = next;
+    }
+    m_url.m_usernameBegin = m_url.m_usernameEnd = m_url.m_size;
+    if (at != SIZE_MAX)
+    {
+        bool password = false;
+        for (size_t p = pos; p < at;)
+        {
+            uint32_t c = At(p, &p);
+            if (c == ':' && !password)
+            {
+                password = true;
+                m_url.m_usernameEnd = m_url.m_size;
+                m_url.Append(':');
+                m_url.m_passwordBegin = m_url.m_size;
+                continue;
+            }
+            AppendEncoded(c, c_userinfoSet);
+        }
+        if (!password)
+        {
+            m_url.m_usernameEnd = m_url.m_size;
+            m_url.m_passwordBegin = m_url.m_size;
+        }
+        m_url.m_passwordEnd = m_url.m_size;
+        if (m_url.m_passwordBegin == m_url.m_passwordEnd && password)
+        {
+            // An empty password isn't written.
+            m_url.m_size = m_url.m_passwordBegin = m_url.m_passwordEnd = m_url.m_usernameEnd;
+        }
+        if (m_url.m_usernameBegin == m_url.m_size)
+        {
+            m_url.m_passwordBegin = m_url.m_passwordEnd = m_url.m_size;
+        }
+        else
+        {
+            m_url.Append('@');
+        }
+    }
+    else
+    {
+        m_url.m_passwordBegin = m_url.m_passwordEnd = m_url.m_size;
+    }
+
+    // The host ends at a ':' outside brackets, which starts the port.
+    uint32_t host[c_maxUrlHostSize];
+    size_t size = 0;
+    bool insideBrackets = false;
+    size_t p = hostStart;
+    size_t portStart = SIZE_MAX;
+    while (p < end)
+    {
+        uint32_t c = At(p, &next);
+        if (c == c_eof)
+        {
+            break;
+        }
+        if (c == ':' && !insideBrackets)
+        {
+            portStart = next;
+            break;
+        }
+        insideBrackets = c == '[' ? true : c == ']' ? false : insideBrackets;
+        if (size == c_maxUrlHostSize)
+        {
+            return false;
+        }
+        host[size++] = c;
+        p = next;
+    }
+    if (size == 0 && (m_url.m_special || portStart != SIZE_MAX || at != SIZE_MAX))
+    {
+        return false;
+    }
+    m_url.m_hostBegin = m_url.m_size;
+    if (size == 0)
+    {
+        m_url.m_hostEnd = m_url.m_size;
+        m_url.m_hostType = UrlHostType::Empty;
+    }
+    else if (!ParseHost(host, size))
+    {
+        return false;
+    }
+
+    if (portStart != SIZE_MAX)
+    {
+        uint32_t port = 0;
+        bool hasDigits = false;
+        for (p = portStart; p < end;)
+        {
+            uint32_t c = At(p, &p);
+            if (c == c_eof)
+            {
+                break;
+            }
+            if (!IsAsciiDigit(c))
+            {
+                return false;
+            }
+            port = port * 10 + (c - '0');
+            if (port > 65535)
+            {
+                return false;
+            }
+            hasDigits = true;
+        }
+        const SpecialScheme* special = FindSpecialScheme(m_url.GetScheme());
+        if (hasDigits && !(special && special->defaultPort == static_cast<int>(port)))
+        {
+            m_url.m_port = static_cast<int>(port);
+            char digits[8];
+            size_t count = 0;
+            do
+            {
+                digits[count++] = static_cast<char>('0' + port % 10);
+                port /= 10;
+            } while (port != 0);
+            m_url.Append(':');
+            while (count != 0)
+            {
+                m_url.Append(digits[--count]);
+            }
+        }
+    }
+    m_url.m_authorityEnd = m_url.m_size;
+    return ParsePathStart(end);
+}
+
+template <typename Char> bool UrlParser<Char>::ParseHost(const uint32_t* host, size_t size)
+{
+    m_url.m_hostBegin = m_url.m_size;
+    if (host[0] == '[')
+    {
+        uint16_t address[8];
+        if (host[size - 1] != ']' || !ParseIPv6(host + 1, size - 2, address))
+        {
+            return false;
+        }
+        // The longest run of two or more zero pieces, the first if there are
+        // several, is written as "::".
+        size_t compressBegin = 8;
+        size_t compressSize = 1;
+        for (size_t i = 0; i < 8;)
+        {
+            size_t run = 0;
+            while (i + run < 8 && address[i + run] == 0)
+            {
+                ++run;
+            }
+            if (run > compressSize)
+            {
+                compressBegin = i;
+                compressSize = run;
+            }
+            i += run == 0 ? 1 : run;
+        }
+        m_url.Append('[');
+        for (size_t i = 0; i < 8; ++i)
+        {
+            if (i == compressBegin)
+            {
+                m_url.Append(i == 0 ? "::" : ":");
+                i += compressSize - 1;
+                continue;
+            }
+            char hex[5];
+            size_t count = 0;
+            uint32_t piece = address[i];
+            do
+            {
+                hex[count++] = "0123456789abcdef"[piece & 0xF];
+                piece >>= 4;
+            } while (piece != 0);
+            while (count != 0)
+            {
+                m_url.Append(hex[--count]);
+            }
+            if (i != 7)
+            {
+                m_url.Append(':');
+            }
+        }
+        m_url.Append(']');
+        m_url.m_hostEnd = m_url.m_size;
+        m_url.m_hostType = UrlHostType::IPv6;
+        return true;
+    }
+    if (!m_url.m_special)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (host[i] < 0x80 && Contains(c_forbiddenHostSet, host[i]))
+            {
+                return false;
+            }
+            AppendEncoded(host[i], c_c0ControlSet);
+        }
+        m_url.m_hostEnd = m_url.m_size;
+        m_url.m_hostType = UrlHostType::Opaque;
+        return true;
+    }
+
+    if (std::all_of(host, host + size, [](uint32_t c) { return c < 0x80 && c != '%'; }))
+    {
+        return ParseDomain(host, size);
+    }
+
+    // Percent-decode the host, and decode it as UTF-8.
+    uint8_t bytes[c_maxUrlHostSize * 4];
+    size_t byteCount = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (host[i] == '%' && i + 2 < size && IsAsciiHexDigit(host[i + 1]) &&
+            IsAsciiHexDigit(host[i + 2]))
+        {
+            bytes[byteCount++] =
+                static_cast<uint8_t>(HexValue(host[i + 1]) * 16 + HexValue(host[i + 2]));
+            i += 2;
+        }
+        else
+        {
+            byteCount += EncodeUtf8(host[i], bytes + byteCount);
+        }
+    }
+    // Each code point decodes from at least one code point of the host.
+    uint32_t domain[c_maxUrlHostSize];
+    size_t domainSize = 0;
+    for (size_t i = 0; i < byteCount;)
+    {
+        domain[domainSize++] = DecodeUtf8(bytes, byteCount, &i);
+    }
+    return ParseDomain(domain, domainSize);
+}
+
+// Map a domain to ASCII, as UTS #46's ToASCII does with the URL Standard's
+// options, as far as UrlParser takes it on; then check that it is a valid host,
+// and parse it as an IPv4 address if it ends in a number.
+template <typename Char> bool UrlParser<Char>::ParseDomain(const uint32_t* domain, size_t size)
+{
+    uint32_t mapped[c_maxUrlHostSize];
+    size_t mappedSize = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        uint32_t c = domain[i];
+        if (c < 0x80)
+        {
+            c = ToAsciiLower(c);
+        }
+        else
+        {
+            IdnaStatus status = MapIdnaCodePoint(&c);
+            if (status == IdnaStatus::Ignored)
+            {
+                continue;
+            }
+            if (status == IdnaStatus::Disallowed)
+            {
+                return false;
+            }
+        }
+        // Punycode is only letters, digits and '-', so a host that is going to
+        // have a forbidden code point has it here.
+        if (c < 0x80 && Contains(c_forbiddenDomainSet, c))
+        {
+            return false;
+        }
+        mapped[mappedSize++] = c;
+    }
+    if (mappedSize == 0)
+    {
+        return false;
+    }
+
+    for (size_t labelBegin = 0; labelBegin <= mappedSize;)
+    {
+        size_t labelEnd = labelBegin;
+        bool ascii = true;
+        while (labelEnd < mappedSize && mapped[labelEnd] != '.')
+        {
+            ascii = ascii && mapped[labelEnd] < 0x80;
+            ++labelEnd;
+        }
+        const uint32_t* label = mapped + labelBegin;
+        size_t labelSize = labelEnd - labelBegin;
+        size_t outputBegin = m_url.m_size;
+        if (ascii)
+        {
+            m_url.Grow(labelSize);
+            char* out = m_url.m_data + m_url.m_size;
+            for (size_t i = 0; i < labelSize; ++i)
+            {
+                out[i] = static_cast<char>(label[i]);
+            }
+            m_url.m_size += static_cast<uint32_t>(labelSize);
+            std::string_view written = m_url.GetHref().substr(outputBegin);
+            if (written.size() >= 4 && written.substr(0, 4) == "xn--")
+            {
+                // A Punycode label has to decode to a label that isn't all ASCII,
+                // and that would be left as it is by the mapping.
+                uint32_t decoded[c_maxUrlHostSize];
+                size_t decodedSize;
+                if (!DecodePunycode(written.substr(4), decoded, c_maxUrlHostSize, &decodedSize) ||
+                    std::all_of(
+                        decoded, decoded + decodedSize, [](uint32_t c) { return c < 0x80; }))
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < decodedSize; ++i)
+                {
+                    uint32_t c = decoded[i];
+                    if (c < 0x80 ? c != ToAsciiLower(c) || c == '.'
+                                 : MapIdnaCodePoint(&c) != IdnaStatus::Valid || c != decoded[i])
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // Encode the label as Punycode.
+            m_url.Append("xn--");
+            size_t basicCount = 0;
+            for (size_t i = 0; i < labelSize; ++i)
+            {
+                if (label[i] < 0x80)
+                {
+                    m_url.Append(static_cast<char>(label[i]));
+                    ++basicCount;
+                }
+            }
+            if (basicCount != 0)
+            {
+                m_url.Append('-');
+            }
+            uint32_t n = c_punycodeInitialN;
+            uint32_t delta = 0;
+            uint32_t bias = c_punycodeInitialBias;
+            for (size_t handled = basicCount; handled < labelSize; ++delta, ++n)
+            {
+                uint32_t next = UINT32_MAX;
+                for (size_t i = 0; i < labelSize; ++i)
+                {
+                    if (label[i] >= n && label[i] < next)
+                    {
+                        next = label[i];
+                    }
+                }
+                delta += (next - n) * static_cast<uint32_t>(handled + 1);
+                n = next;
+                for (size_t i = 0; i < labelSize; ++i)
+                {
+                    if (label[i] < n)
+                    {
+                        ++delta;
+                    }
+                    if (label[i] != n)
+                    {
+                        continue;
+                    }
+                    uint32_t q = delta;
+                    for (uint32_t k = c_punycodeBase;; k += c_punycodeBase)
+                    {
+                        uint32_t t = k <= bias                     ? c_punycodeTMin
+                                     : k >= bias + c_punycodeTMax ? c_punycodeTMax
+                                                                  : k - bias;
+                        if (q < t)
+                        {
+                            break;
+                        }
+                        m_url.Append(EncodePunycodeDigit(t + (q - t) % (c_punycodeBase - t)));
+                        q = (q - t) / (c_punycodeBase - t);
+                    }
+                    m_url.Append(EncodePunycodeDigit(q));
+                    bias = AdaptPunycodeBias(
+                        delta, static_cast<uint32_t>(handled + 1), handled == basicCount);
+                    delta = 0;
+                    ++handled;
+                }
+            }
+        }
+        if (labelEnd == mappedSize)
+        {
+            break;
+        }
+        m_url.Append('.');
+        labelBegin = labelEnd + 1;
+    }
+
+    std::string_view ascii = m_url.GetHref().substr(m_url.m_hostBegin);
+    if (EndsInANumber(ascii))
+    {
+        uint32_t address;
+        if (!ParseIPv4(ascii, &address))
+        {
+            return false;
+        }
+        m_url.m_size = m_url.m_hostBegin;
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            uint32_t part = (address >> shift) & 0xFF;
+            if (part >= 100)
+            {
+                m_url.Append(static_cast<char>('0' + part / 100));
+            }
+            if (part >= 10)
+            {
+                m_url.Append(static_cast<char>('0' + part / 10 % 10));
+            }
+            m_url.Append(static_cast<char>('0' + part % 10));
+            if (shift != 0)
+            {
+                m_url.Append('.');
+            }
+        }
+        m_url.m_hostType = UrlHostType::IPv4;
+    }
+    else
+    {
+        m_url.m_hostType = UrlHostType::Domain;
+    }
+    m_url.m_hostEnd = m_url.m_size;
+    return true;
+}
+
+template <typename Char> bool UrlParser<Char>::ParsePathStart(size_t pos)
+{
+    m_url.m_pathBegin = m_url.m_size;
+    size_t next;
+    uint32_t c = At(pos, &next);
+    if (m_url.m_special)
+    {
+        return ParsePath(c == '/' || c == '\\' ? next : pos);
+    }
+    if (c == '?')
+    {
+        m_url.m_pathEnd = m_url.m_size;
+        return ParseQuery(next);
+    }
+    if (c == '#')
+    {
+        m_url.m_pathEnd = m_url.m_size;
+        return ParseFragment(next);
+    }
+    if (c == c_eof)
+    {
+        m_url.m_pathEnd = m_url.m_size;
+        return Finish();
+    }
+    return ParsePath(c == '/' ? next : pos);
+}
+
+template <typename Char> bool UrlParser<Char>::ParsePath(size_t pos)
+{
+    if (m_url.m_pathBegin < m_url.m_authorityEnd)
+    {
+        m_url.m_pathBegin = m_url.m_authorityEnd;
+    }
+    bool file = m_url.GetScheme() == "file";
+    size_t next;
+    uint32_t c;
+    while (true)
+    {
+        uint32_t segmentStart = m_url.m_size;
+        m_url.Append('/');
+        uint32_t segmentBegin = m_url.m_size;
+        c = AppendEncodedUntil(
+            &pos, &next, c_pathSet, m_url.m_special ? c_specialPathEndSet : c_pathEndSet);
+        bool slash = IsSlash(c);
+        std::string_view segment = m_url.GetHref().substr(segmentBegin);
+        if (IsDoubleDotSegment(segment))
+        {
+            m_url.m_size = segmentStart;
+            ShortenPath();
+            if (!slash)
+            {
+                m_url.Append('/');
+            }
+        }
+        else if (IsSingleDotSegment(segment))
+        {
+            m_url.m_size = segmentStart;
+            if (!slash)
+            {
+                m_url.Append('/');
+            }
+        }
+        else if (file && segmentStart == m_url.m_pathBegin && IsWindowsDriveLetter(segment))
+        {
+            m_url.m_data[segmentBegin + 1] = ':';
+        }
+        if (!slash)
+        {
+            break;
+        }
+        pos = next;
+    }
+    m_url.m_pathEnd = m_url.m_size;
+    if (c == '?')
+    {
+        return ParseQuery(next);
+    }
+    if (c == '#')
+    {
+        return ParseFragment(next);
+    }
+    return Finish();
+}
+
+template <typename Char> bool UrlParser<Char>::ParseOpaquePath(size_t pos)
+{
+    m_url.m_hostBegin = m_url.m_hostEnd = m_url.m_size;
+    m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+    m_url.m_opaquePath = true;
+    size_t next;
+    uint32_t c;
+    c = AppendEncodedUntil(&pos, &next, c_c0ControlSet, c_opaquePathEndSet);
+    m_url.m_pathEnd = m_url.m_size;
+    if (c == '?')
+    {
+        return ParseQuery(next);
+    }
+    if (c == '#')
+    {
+        return ParseFragment(next);
+    }
+    return Finish();
+}
+
+template <typename Char> bool UrlParser<Char>::ParseQuery(size_t pos)
+{
+    m_url.m_queryBegin = m_url.m_size;
+    m_url.Append('?');
+    const EncodeSet& set = m_url.m_special ? c_specialQuerySet : c_querySet;
+    size_t next;
+    uint32_t c;
+    c = AppendEncodedUntil(&pos, &next, set, c_queryEndSet);
+    if (c == '#')
+    {
+        return ParseFragment(next);
+    }
+    return Finish();
+}
+
+template <typename Char> bool UrlParser<Char>::ParseFragment(size_t pos)
+{
+    m_url.m_fragmentBegin = m_url.m_size;
+    m_url.Append('#');
+    size_t next;
+    AppendEncodedUntil(&pos, &next, c_fragmentSet, EncodeSet{});
+    return Finish();
+}
+
+template <typename Char> bool UrlParser<Char>::Finish()
+{
+    if (m_url.m_queryBegin == Url::c_none && m_url.m_fragmentBegin == Url::c_none)
+    {
+        m_url.m_pathEnd = m_url.m_size;
+    }
+    // A path that starts with "//" in a URL without a host would read as one,
+    // so "/." goes before it.
+    std::string_view path = m_url.GetPath();
+    if (m_url.m_hostType == UrlHostType::None && !m_url.m_opaquePath && path.size() > 1 &&
+        path[0] == '/' && path[1] == '/')
+    {
+        m_url.Grow(2);
+        std::memmove(
+            m_url.m_data + m_url.m_pathBegin + 2, m_url.m_data + m_url.m_pathBegin,
+            m_url.m_size - m_url.m_pathBegin);
+        m_url.m_data[m_url.m_pathBegin] = '/';
+        m_url.m_data[m_url.m_pathBegin + 1] = '.';
+        m_url.m_size += 2;
+        m_url.m_pathBegin += 2;
+        m_url.m_pathEnd += 2;
+        for (uint32_t* offset : {&m_url.m_queryBegin, &m_url.m_fragmentBegin})
+        {
+            if (*offset != Url::c_none)
+            {
+                *offset += 2;
+            }
+        }
+    }
+    m_url.m_valid = true;
+    return true;
+}
+
+template <typename Char> void UrlParser<Char>::CopyBaseAuthority()
+{
+    // Offsets in the base move by the difference in where the authority starts,
+    // which is only the scheme's if both are the same.
+    uint32_t from = m_base->m_schemeEnd + 1;
+    uint32_t delta = m_url.m_size - from;
+    m_url.Append(m_base->GetHref().substr(from, m_base->m_authorityEnd - from));
+    m_url.m_usernameBegin = m_base->m_usernameBegin + delta;
+    m_url.m_usernameEnd = m_base->m_usernameEnd + delta;
+    m_url.m_passwordBegin = m_base->m_passwordBegin + delta;
+    m_url.m_passwordEnd = m_base->m_passwordEnd + delta;
+    m_url.m_hostBegin = m_base->m_hostBegin + delta;
+    m_url.m_hostEnd = m_base->m_hostEnd + delta;
+    m_url.m_hostType = m_base->m_hostType;
+    m_url.m_port = m_base->m_port;
+    m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+}
+
+template <typename Char> void UrlParser<Char>::AppendHostFromBase()
+{
+    m_url.m_usernameBegin = m_url.m_usernameEnd = m_url.m_size;
+    m_url.m_passwordBegin = m_url.m_passwordEnd = m_url.m_size;
+    m_url.m_hostBegin = m_url.m_size;
+    m_url.Append(m_base->GetHost());
+    m_url.m_hostEnd = m_url.m_size;
+    m_url.m_hostType = m_base->m_hostType;
+    m_url.m_authorityEnd = m_url.m_pathBegin = m_url.m_size;
+}
+
+template <typename Char> void UrlParser<Char>::CopyBasePath()
+{
+    m_url.m_pathBegin = m_url.m_size;
+    m_url.Append(m_base->GetPath());
+    m_url.m_pathEnd = m_url.m_size;
+}
+
+template <typename Char> void UrlParser<Char>::CopyBaseQuery()
+{
+    if (m_base->HasQuery())
+    {
+        m_url.m_queryBegin = m_url.m_size;
+        m_url.Append('?');
+        m_url.Append(m_base->GetQuery());
+    }
+}
+
+// Remove the path's last segment, unless it is a file URL's drive letter.
+template <typename Char> void UrlParser<Char>::ShortenPath()
+{
+    std::string_view path = m_url.GetHref().substr(m_url.m_pathBegin);
+    if (m_url.GetScheme() == "file" && path.size() == 3 && path[2] == ':' &&
+        IsWindowsDriveLetter(path.substr(1)))
+    {
+        return;
+    }
+    size_t slash = path.rfind('/');
+    if (slash != std::string_view::npos)
+    {
+        m_url.m_size = m_url.m_pathBegin + static_cast<uint32_t>(slash);
+    }
+}
+
+template <typename Char>
+uint32_t UrlParser<Char>::AppendEncodedUntil(
+    size_t* pos, size_t* next, const EncodeSet& set, const EncodeSet& end)
+{
+    const Char* input = m_input;
+    size_t inputEnd = m_end;
+    while (true)
+    {
+        // Copy the ASCII that is left as it is through a local pointer, which
+        // the compiler can keep in a register, up to what the URL has room for.
+        size_t p = *pos;
+        size_t limit = p + (std::min)(inputEnd - p, size_t(m_url.m_capacity - m_url.m_size));
+        char* out = m_url.m_data + m_url.m_size;
+        for (; p < limit; ++p)
+        {
+            uint32_t c = static_cast<std::make_unsigned_t<Char>>(input[p]);
+            if (c >= 0x80 || Contains(set, c) || Contains(end, c))
+            {
+                break;
+            }
+            *out++ = static_cast<char>(c);
+        }
+        m_url.m_size += static_cast<uint32_t>(p - *pos);
+        *pos = p;
+        uint32_t c = At(p, next);
+        if (c == c_eof || (c < 0x80 && Contains(end, c)))
+        {
+            return c;
+        }
+        AppendEncoded(c, set);
+        *pos = *next;
+    }
+}
+
+template <typename Char> void UrlParser<Char>::AppendEncoded(uint32_t c, const EncodeSet& set)
+{
+    if (c < 0x80 && !Contains(set, c))
+    {
+        m_url.Append(static_cast<char>(c));
+        return;
+    }
+    uint8_t bytes[4];
+    size_t count = EncodeUtf8(c, bytes);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_url.Append('%');
+        m_url.Append("0123456789ABCDEF"[bytes[i] >> 4]);
+        m_url.Append("0123456789ABCDEF"[bytes[i] & 0xF]);
+    }
+}
+
+Url::Url() : m_data(m_inline)
+{
+}
+
+Url::Url(const Url& other) : m_data(m_inline)
+{
+    *this = other;
+}
+
+Url& Url::operator=(const Url& other)
+{
+    if (this == &other)
+    {
+        return *this;
+    }
+    Clear();
+    Append(other.GetHref());
+    m_schemeEnd = other.m_schemeEnd;
+    m_usernameBegin = other.m_usernameBegin;
+    m_usernameEnd = other.m_usernameEnd;
+    m_passwordBegin = other.m_passwordBegin;
+    m_passwordEnd = other.m_passwordEnd;
+    m_hostBegin = other.m_hostBegin;
+    m_hostEnd = other.m_hostEnd;
+    m_authorityEnd = other.m_authorityEnd;
+    m_pathBegin = other.m_pathBegin;
+    m_pathEnd = other.m_pathEnd;
+    m_queryBegin = other.m_queryBegin;
+    m_fragmentBegin = other.m_fragmentBegin;
+    m_port = other.m_port;
+    m_hostType = other.m_hostType;
+    m_opaquePath = other.m_opaquePath;
+    m_special = other.m_special;
+    m_valid = other.m_valid;
+    return *this;
+}
+
+void Url::Clear()
+{
+    m_size = 0;
+    m_schemeEnd = m_usernameBegin = m_usernameEnd = m_passwordBegin = m_passwordEnd = 0;
+    m_hostBegin = m_hostEnd = m_authorityEnd = m_pathBegin = m_pathEnd = 0;
+    m_queryBegin = m_fragmentBegin = c_none;
+    m_port = -1;
+    m_hostType = UrlHostType::None;
+    m_opaquePath = m_special = m_valid = false;
+}
+
+void Url::Append(std::string_view text)
+{
+    if (m_capacity - m_size < text.size())
+    {
+        Grow(text.size());
+    }
+    std::memcpy(m_data + m_size, text.data(), text.size());
+    m_size += static_cast<uint32_t>(text.size());
+}
+
+void Url::Grow(size_t extra)
+{
+    if (m_capacity - m_size >= extra)
+    {
+        return;
+    }
+    size_t capacity = (std::max)(size_t(m_capacity) * 2, m_size + extra);
+    std::unique_ptr<char[]> heap(new char[capacity]);
+    std::memcpy(heap.get(), m_data, m_size);
+    m_heap = std::move(heap);
+    m_data = m_heap.get();
+    m_capacity = static_cast<uint32_t>(capacity);
+}
+
+bool Url::Parse(std::string_view input, const Url* base)
+{
+    return UrlParser<char>::Parse(input, base, this);
+}
+
+bool Url::Parse(std::wstring_view input, const Url* base)
+{
+    return UrlParser<wchar_t>::Parse(input, base, this);
+}
+
+bool Url::Parse(std::u16string_view input, const Url* base)
+{
+    return UrlParser<char16_t>::Parse(input, base, this);
+}
+
+std::string_view Url::GetQuery() const
+{
+    if (m_queryBegin == c_none)
+    {
+        return {};
+    }
+    return Slice(m_queryBegin + 1, m_fragmentBegin == c_none ? m_size : m_fragmentBegin);
+}
+
+std::string_view Url::GetFragment() const
+{
+    return m_fragmentBegin == c_none ? std::string_view() : Slice(m_fragmentBegin + 1, m_size);
+}
+
+UrlOrigin Url::GetOrigin() const
+{
+    UrlOrigin origin;
+    std::string_view scheme = GetScheme();
+    if (scheme == "blob")
+    {
+        auto url = std::make_unique<Url>();
+        if (url->Parse(GetPath()) && (url->GetScheme() == "http" || url->GetScheme() == "https"))
+        {
+            origin = url->GetOrigin();
+            origin.m_blobUrl = std::move(url);
+        }
+        return origin;
+    }
+    if (m_special && scheme != "file")
+    {
+        origin.m_scheme = scheme;
+        origin.m_host = GetHost();
+        origin.m_port = m_port;
+    }
+    return origin;
+}
+
+bool UrlOrigin::IsSameOrigin(const UrlOrigin& other) const
+{
+    return !IsOpaque() && m_scheme == other.m_scheme && m_host == other.m_host &&
+           m_port == other.m_port;
+}
+
+bool UrlOrigin::IsSameSite(const UrlOrigin& other) const
+{
+    return !IsOpaque() && m_scheme == other.m_scheme &&
+           (m_host == other.m_host || GetUrlSite(m_host) == GetUrlSite(other.m_host));
+}
+
+std::string_view GetUrlSite(std::string_view host)
+{
+    if (!host.empty() && host.back() == '.')
+    {
+        host.remove_suffix(1);
+    }
+    if (host.empty() || host.front() == '[' ||
+        host.find_first_not_of("0123456789.") == std::string_view::npos)
+    {
+        return host;
+    }
+    size_t last = host.rfind('.');
+    if (last == std::string_view::npos)
+    {
+        return host;
+    }
+    size_t second = last == 0 ? std::string_view::npos : host.rfind('.', last - 1);
+    if (second == std::string_view::npos)
+    {
+        return host;
+    }
+    std::string_view secondLabel = host.substr(second + 1, last - second - 1);
+    if (host.size() - last - 1 == 2 && second > 0 &&
+        (secondLabel == "co" || secondLabel == "com" || secondLabel == "net" ||
+         secondLabel == "org" || secondLabel == "gov" || secondLabel == "edu" ||
+         secondLabel == "ac" || secondLabel == "ne" || secondLabel == "or"))
+    {
+        size_t third = host.rfind('.', second - 1);
+        return third == std::string_view::npos ? host : host.substr(third + 1);
+    }
+    return host.substr(second + 1);
+}
+
+bool DomainToAscii(std::string_view domain, std::string* ascii)
+{
+    if (domain.empty() || domain.find_first_of(":/\\?#@") != std::string_view::npos)
+    {
+        return false;
+    }
+    std::string input = "http://";
+    input.append(domain);
+    Url url;
+    if (!url.Parse(input))
+    {
+        return false;
+    }
+    ascii->assign(url.GetHost());
+    return true;
+}
@@ -0,0 +1,219 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Utf8Decoder.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UTF8_DECODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr uint32_t c_replacementChar = 0xFFFD;
+
+// Copy the leading ASCII bytes of input to output, widening them. Returns the
+// number copied.
+size_t CopyAscii(const char* input, size_t length, wchar_t* output)
+{
+    size_t i = 0;
+#if UTF8_DECODER_SSE2
+    if (sizeof(wchar_t) == 2)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= length; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+            // The high bit of every byte is clear only if all 16 are ASCII.
+            if (_mm_movemask_epi8(bytes) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(output + i), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(output + i + 8), _mm_unpackhi_epi8(bytes, zero));
+        }
+    }
+#endif
+    for (; i < length && static_cast<uint8_t>(input[i]) < 0x80; ++i)
+    {
+        output[i] = static_cast<wchar_t>(input[i]);
+    }
+    return i;
+}
+
+size_t CharsNeeded(uint32_t codePoint)
+{
+    return sizeof(wchar_t) == 2 && codePoint >= 0x10000 ? 2 : 1;
+}
+
+// Write codePoint, which must fit, and return the number of characters used.
+size_t WriteCodePoint(uint32_t codePoint, wchar_t* output)
+{
+    if (CharsNeeded(codePoint) == 2)
+    {
+        codePoint -= 0x10000;
+        output[0] = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+        output[1] = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        return 2;
+    }
+    output[0] = static_cast<wchar_t>(codePoint);
+    return 1;
+}
+} // namespace
+
+bool Utf8Decoder::WriteHeld(wchar_t* output, size_t capacity, size_t* written)
+{
+    if (*written + CharsNeeded(m_held) > capacity)
+    {
+        return false;
+    }
+    *written += WriteCodePoint(m_held, output + *written);
+    m_held = 0;
+    return true;
+}
+
+Utf8Decoder::Result Utf8Decoder::Decode(std::string_view input, wchar_t* output, size_t capacity)
+{
+    size_t read = 0;
+    size_t written = 0;
+    if (m_held != 0 && !WriteHeld(output, capacity, &written))
+    {
+        return {0, 0};
+    }
+
+    // Write a decoded code point, or hold it if there is no room. U+0000 is
+    // only ever written by CopyAscii, so it is never held.
+    auto emit = [&](uint32_t codePoint)
+    {
+        m_held = codePoint;
+        return WriteHeld(output, capacity, &written);
+    };
+
+    while (read < input.size())
+    {
+        if (m_bytesNeeded == 0)
+        {
+            size_t ascii = CopyAscii(
+                input.data() + read, (std::min)(input.size() - read, capacity - written),
+                output + written);
+            read += ascii;
+            written += ascii;
+            if (read == input.size())
+            {
+                break;
+            }
+
+            uint8_t byte = static_cast<uint8_t>(input[read]);
+            if (byte < 0x80)
+            {
+                // The output is full.
+                break;
+            }
+            ++read;
+            if (byte >= 0xC2 && byte <= 0xDF)
+            {
+                m_bytesNeeded = 1;
+                m_codePoint = byte & 0x1F;
+            }
+            else if (byte >= 0xE0 && byte <= 0xEF)
+            {
+                // Exclude overlong forms and surrogates.
+                m_lowerBoundary = byte == 0xE0 ? 0xA0 : 0x80;
+                m_upperBoundary = byte == 0xED ? 0x9F : 0xBF;
+                m_bytesNeeded = 2;
+                m_codePoint = byte & 0x0F;
+            }
+            else if (byte >= 0xF0 && byte <= 0xF4)
+            {
+                // Exclude overlong forms and code points above U+10FFFF.
+                m_lowerBoundary = byte == 0xF0 ? 0x90 : 0x80;
+                m_upperBoundary = byte == 0xF4 ? 0x8F : 0xBF;
+                m_bytesNeeded = 3;
+                m_codePoint = byte & 0x07;
+            }
+            else if (!emit(c_replacementChar))
+            {
+                break;
+            }
+            continue;
+        }
+
+        uint8_t byte = static_cast<uint8_t>(input[read]);
+        if (byte < m_lowerBoundary || byte > m_upperBoundary)
+        {
+            // The sequence so far is replaced, and the byte is decoded again
+            // as the start of the next one.
+            *this = Utf8Decoder();
+            if (!emit(c_replacementChar))
+            {
+                break;
+            }
+            continue;
+        }
+        ++read;
+        m_lowerBoundary = 0x80;
+        m_upperBoundary = 0xBF;
+        m_codePoint = (m_codePoint << 6) | (byte & 0x3F);
+        if (++m_bytesSeen == m_bytesNeeded)
+        {
+            uint32_t codePoint = m_codePoint;
+            *this = Utf8Decoder();
+            if (!emit(codePoint))
+            {
+                break;
+            }
+        }
+    }
+    return {read, written};
+}
+
+size_t Utf8Decoder::Finish(wchar_t* output, size_t capacity)
+{
+    size_t written = 0;
+    if (m_held != 0 && !WriteHeld(output, capacity, &written))
+    {
+        return written;
+    }
+    if (m_bytesNeeded != 0)
+    {
+        *this = Utf8Decoder();
+        m_held = c_replacementChar;
+        WriteHeld(output, capacity, &written);
+    }
+    return written;
+}
+
+size_t ReadUtf8Preview(const ByteSource& source, wchar_t* output, size_t capacity, bool* truncated)
+{
+    Utf8Decoder decoder;
+    char buffer[256];
+    size_t written = 0;
+    *truncated = false;
+    while (true)
+    {
+        // Once the output is full, a few more bytes are enough to tell whether
+        // anything follows.
+        size_t wanted = (std::min)(sizeof(buffer), capacity - written + 4);
+        size_t read = source(buffer, wanted);
+        if (read == 0)
+        {
+            written += decoder.Finish(output + written, capacity - written);
+            *truncated = decoder.HasHeldChar();
+            return written;
+        }
+
+        Utf8Decoder::Result result =
+            decoder.Decode(std::string_view(buffer, read), output + written, capacity - written);
+        written += result.charsWritten;
+        if (result.bytesRead < read || decoder.HasHeldChar())
+        {
+            *truncated = true;
+            return written;
+        }
+    }
+}
@@ -0,0 +1,64 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// Incremental UTF-8 to UTF-16 decoding, for text that arrives in pieces such as
+// a response body read from a stream. A sequence split between two pieces is
+// carried over, and malformed input becomes U+FFFD following the WHATWG
+// Encoding Standard, one replacement per maximal invalid subpart.
+//
+// Output goes to a fixed buffer and stops on a code point boundary, never
+// between the two halves of a surrogate pair. Runs of ASCII are found and
+// widened with SSE2 where available. On platforms where wchar_t is 32 bits,
+// code points are written unsplit.
+class Utf8Decoder
+{
+public:
+    struct Result
+    {
+        size_t bytesRead;
+        size_t charsWritten;
+    };
+
+    // Decode input into output. Stops early if output is full; bytes that
+    // weren't read must be passed again. A code point that was decoded but
+    // didn't fit is held (see HasHeldChar) and written first next time.
+    Result Decode(std::string_view input, wchar_t* output, size_t capacity);
+    // Call at the end of the input: an unfinished sequence becomes U+FFFD.
+    // Returns the number of characters written.
+    size_t Finish(wchar_t* output, size_t capacity);
+
+    bool HasHeldChar() const { return m_held != 0; }
+    void Reset() { *this = Utf8Decoder(); }
+
+private:
+    // Write the held code point if it fits. Returns false if it doesn't.
+    bool WriteHeld(wchar_t* output, size_t capacity, size_t* written);
+
+    // The code point of the sequence being decoded, so far.
+    uint32_t m_codePoint = 0;
+    uint32_t m_bytesSeen = 0;
+    uint32_t m_bytesNeeded = 0;
+    // Allowed range of the next continuation byte.
+    uint8_t m_lowerBoundary = 0x80;
+    uint8_t m_upperBoundary = 0xBF;
+    // A decoded code point waiting for room in the output, or 0.
+    uint32_t m_held = 0;
+};
+
+// Pulls up to size bytes into buffer, like IStream::Read. Returns the number of
+// bytes read; 0 means the end of the data, or an error.
+using ByteSource = std::function<size_t(void* buffer, size_t size)>;
+
+// Decode the start of UTF-8 text from source into output, reading only as much
+// as is needed, so large bodies are never buffered. Returns the number of
+// characters written, which is at most capacity; output isn't NUL-terminated.
+// *truncated is set if there is more text after what was written.
+size_t ReadUtf8Preview(const ByteSource& source, wchar_t* output, size_t capacity, bool* truncated);
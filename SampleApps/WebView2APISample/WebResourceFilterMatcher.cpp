@@ -0,0 +1,403 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "WebResourceFilterMatcher.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+enum FilterFlags : uint32_t
+{
+    // The run starts the filter, so it has to start the URI.
+    FilterRunIsPrefix = 1 << 0,
+    // The run ends the filter, so it has to end the URI.
+    FilterRunIsSuffix = 1 << 1,
+    // The filter is its run, with at most a '*' on either side, so the run being
+    // in the right place is a match.
+    FilterRunIsEnough = 1 << 2,
+};
+
+// Filters that are matched in full and don't match are remembered, so a run
+// that ends more than once in a URI doesn't match its filters again, for up to
+// this many filters a request.
+constexpr size_t c_maxCheckedFilters = 32;
+
+// States this close to the root have a table of transitions, as long as the
+// tables take no more than c_maxDenseTargets entries in all.
+constexpr uint32_t c_maxDenseDepth = 2;
+constexpr size_t c_maxDenseTargets = 64 * 1024;
+
+bool IsWildcard(wchar_t c)
+{
+    return c == L'*' || c == L'?';
+}
+
+// The longest run of characters in pattern that aren't wildcards, or the first
+// of the longest.
+std::wstring_view FindLiteralRun(std::wstring_view pattern)
+{
+    std::wstring_view longest;
+    size_t start = 0;
+    while (start < pattern.size())
+    {
+        while (start < pattern.size() && IsWildcard(pattern[start]))
+        {
+            ++start;
+        }
+        size_t end = start;
+        while (end < pattern.size() && !IsWildcard(pattern[end]))
+        {
+            ++end;
+        }
+        if (end - start > longest.size())
+        {
+            longest = pattern.substr(start, end - start);
+        }
+        start = end;
+    }
+    return longest;
+}
+} // namespace
+
+WebResourceFilterMatcher::WebResourceFilterMatcher()
+    : m_denseStateCount(1), m_states(1), m_denseTargets(1)
+{
+}
+
+WebResourceFilterMatcher::WebResourceFilterMatcher(const std::vector<Filter>& filters)
+{
+    // The trie of runs, by class: each state's children, and the filters whose
+    // run ends at it.
+    std::vector<std::vector<uint32_t>> runOutputs(1);
+    std::vector<std::vector<std::pair<uint16_t, uint32_t>>> children(1);
+    std::unordered_map<uint64_t, uint32_t> transitions;
+    std::unordered_map<wchar_t, uint16_t> otherClasses;
+    auto getOrAddClass = [&](wchar_t c) -> uint16_t
+    {
+        uint16_t* charClass;
+        if (static_cast<uint32_t>(c) < 128)
+        {
+            charClass = &m_asciiClasses[c];
+        }
+        else
+        {
+            charClass = &otherClasses[c];
+        }
+        if (*charClass == 0)
+        {
+            *charClass = m_classCount++;
+        }
+        return *charClass;
+    };
+
+    for (const Filter& filter : filters)
+    {
+        if (filter.handler >= c_maxWebResourceFilterHandlers)
+        {
+            continue;
+        }
+        std::wstring_view pattern = filter.uri;
+        std::wstring_view run = FindLiteralRun(pattern);
+        CompiledFilter compiled = {};
+        compiled.offset = static_cast<uint32_t>(m_strings.size());
+        compiled.size = static_cast<uint32_t>(pattern.size());
+        compiled.runSize = static_cast<uint32_t>(run.size());
+        compiled.contexts = filter.contexts;
+        compiled.handler = filter.handler;
+        m_strings.append(pattern);
+        m_allHandlers |= uint64_t(1) << filter.handler;
+
+        uint32_t index = static_cast<uint32_t>(m_filters.size());
+        if (run.empty())
+        {
+            m_filters.push_back(compiled);
+            m_unanchored.push_back(index);
+            continue;
+        }
+        size_t before = run.data() - pattern.data();
+        size_t after = pattern.size() - before - run.size();
+        if (before == 0)
+        {
+            compiled.flags |= FilterRunIsPrefix;
+        }
+        if (after == 0)
+        {
+            compiled.flags |= FilterRunIsSuffix;
+        }
+        if ((before == 0 || (before == 1 && pattern.front() == L'*')) &&
+            (after == 0 || (after == 1 && pattern.back() == L'*')))
+        {
+            compiled.flags |= FilterRunIsEnough;
+        }
+        m_filters.push_back(compiled);
+
+        uint32_t state = 0;
+        for (wchar_t c : run)
+        {
+            uint16_t charClass = getOrAddClass(c);
+            uint64_t key = (uint64_t(state) << 16) | charClass;
+            auto found = transitions.find(key);
+            if (found != transitions.end())
+            {
+                state = found->second;
+                continue;
+            }
+            uint32_t next = static_cast<uint32_t>(runOutputs.size());
+            runOutputs.emplace_back();
+            children.emplace_back();
+            children[state].emplace_back(charClass, next);
+            transitions.emplace(key, next);
+            state = next;
+        }
+        runOutputs[state].push_back(index);
+    }
+    m_otherClasses.assign(otherClasses.begin(), otherClasses.end());
+    std::sort(m_otherClasses.begin(), m_otherClasses.end());
+
+    // Number the states breadth first, so that each state's suffixes, which are
+    // shallower, come before it, and the shallow states that most characters of
+    // a URI step through come first. Those get a table of transitions by class.
+    std::vector<uint32_t> order(1, 0);
+    std::vector<uint32_t> depths(1, 0);
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        std::sort(children[order[i]].begin(), children[order[i]].end());
+        for (const auto& child : children[order[i]])
+        {
+            order.push_back(child.second);
+            depths.push_back(depths[i] + 1);
+        }
+    }
+    std::vector<uint32_t> numbers(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+        numbers[order[i]] = i;
+    }
+    size_t maxDenseStates = (std::max)(c_maxDenseTargets / m_classCount, size_t(1));
+    while (m_denseStateCount < order.size() && m_denseStateCount < maxDenseStates &&
+           depths[m_denseStateCount] <= c_maxDenseDepth)
+    {
+        ++m_denseStateCount;
+    }
+    m_denseTargets.assign(m_denseStateCount * m_classCount, 0);
+
+    m_states.resize(order.size());
+    for (uint32_t state = 0; state < m_states.size(); ++state)
+    {
+        State& entry = m_states[state];
+        entry.edgesBegin = static_cast<uint32_t>(m_edgeClasses.size());
+        for (const auto& child : children[order[state]])
+        {
+            m_edgeClasses.push_back(child.first);
+            m_edgeTargets.push_back(numbers[child.second]);
+        }
+        entry.edgesEnd = static_cast<uint32_t>(m_edgeClasses.size());
+        const std::vector<uint32_t>& outputs = runOutputs[order[state]];
+        entry.outputsBegin = static_cast<uint32_t>(m_outputs.size());
+        m_outputs.insert(m_outputs.end(), outputs.begin(), outputs.end());
+        entry.outputsEnd = static_cast<uint32_t>(m_outputs.size());
+    }
+
+    // Link each state to its longest proper suffix that is a state, in order, so
+    // that every suffix is linked before it is needed.
+    for (uint32_t state = 0; state < m_states.size(); ++state)
+    {
+        State& entry = m_states[state];
+        if (state != 0)
+        {
+            const State& fail = m_states[entry.fail];
+            entry.nextOutput =
+                fail.outputsBegin != fail.outputsEnd ? entry.fail : fail.nextOutput;
+            const State& next = m_states[entry.nextOutput];
+            entry.handlers = next.handlers;
+            entry.contexts = next.contexts;
+            for (uint32_t output = entry.outputsBegin; output < entry.outputsEnd; ++output)
+            {
+                const CompiledFilter& filter = m_filters[m_outputs[output]];
+                entry.handlers |= uint64_t(1) << filter.handler;
+                entry.contexts |= filter.contexts;
+            }
+        }
+        if (state < m_denseStateCount)
+        {
+            // A character without a transition here steps as it would from the
+            // suffix.
+            uint32_t* targets = &m_denseTargets[size_t(state) * m_classCount];
+            if (state != 0)
+            {
+                std::copy_n(&m_denseTargets[size_t(entry.fail) * m_classCount], m_classCount,
+                            targets);
+            }
+            for (uint32_t edge = entry.edgesBegin; edge < entry.edgesEnd; ++edge)
+            {
+                targets[m_edgeClasses[edge]] = m_edgeTargets[edge];
+            }
+        }
+        for (uint32_t edge = entry.edgesBegin; edge < entry.edgesEnd; ++edge)
+        {
+            m_states[m_edgeTargets[edge]].fail =
+                state == 0 ? 0 : Step(entry.fail, m_edgeClasses[edge]);
+        }
+    }
+}
+
+uint16_t WebResourceFilterMatcher::GetClass(wchar_t c) const
+{
+    if (static_cast<uint32_t>(c) < 128)
+    {
+        return m_asciiClasses[c];
+    }
+    auto found = std::lower_bound(
+        m_otherClasses.begin(), m_otherClasses.end(), std::make_pair(c, uint16_t(0)));
+    return found != m_otherClasses.end() && found->first == c ? found->second : 0;
+}
+
+// The state after state on a character of a class, following suffix links
+// until a state has a transition for it.
+uint32_t WebResourceFilterMatcher::Step(uint32_t state, uint16_t charClass) const
+{
+    while (state >= m_denseStateCount)
+    {
+        const State& entry = m_states[state];
+        for (uint32_t edge = entry.edgesBegin; edge < entry.edgesEnd; ++edge)
+        {
+            if (m_edgeClasses[edge] == charClass)
+            {
+                return m_edgeTargets[edge];
+            }
+            if (m_edgeClasses[edge] > charClass)
+            {
+                break;
+            }
+        }
+        state = entry.fail;
+    }
+    return m_denseTargets[size_t(state) * m_classCount + charClass];
+}
+
+uint64_t WebResourceFilterMatcher::Match(std::wstring_view uri, uint32_t context) const
+{
+    uint64_t result = 0;
+    uint32_t checked[c_maxCheckedFilters];
+    size_t checkedCount = 0;
+    for (uint32_t filter : m_unanchored)
+    {
+        MatchFilter(filter, uri, 0, context, &result, checked, &checkedCount);
+    }
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < uri.size() && result != m_allHandlers; ++i)
+    {
+        uint16_t charClass = GetClass(uri[i]);
+        if (charClass == 0)
+        {
+            state = 0;
+            continue;
+        }
+        state = Step(state, charClass);
+        const State& entry = m_states[state];
+        if ((entry.handlers & ~result) == 0 || (entry.contexts & context) == 0)
+        {
+            continue;
+        }
+        uint32_t output = entry.outputsBegin != entry.outputsEnd ? state : entry.nextOutput;
+        for (; output != 0; output = m_states[output].nextOutput)
+        {
+            const State& outputEntry = m_states[output];
+            for (uint32_t o = outputEntry.outputsBegin; o < outputEntry.outputsEnd; ++o)
+            {
+                MatchFilter(m_outputs[o], uri, i + 1, context, &result, checked, &checkedCount);
+            }
+        }
+    }
+    return result;
+}
+
+void WebResourceFilterMatcher::MatchFilter(
+    uint32_t filter, std::wstring_view uri, size_t end, uint32_t context, uint64_t* result,
+    uint32_t* checked, size_t* checkedCount) const
+{
+    const CompiledFilter& compiled = m_filters[filter];
+    uint64_t handler = uint64_t(1) << compiled.handler;
+    if ((*result & handler) != 0 || (compiled.contexts & context) == 0)
+    {
+        return;
+    }
+    if (compiled.runSize != 0)
+    {
+        if (((compiled.flags & FilterRunIsPrefix) && end != compiled.runSize) ||
+            ((compiled.flags & FilterRunIsSuffix) && end != uri.size()))
+        {
+            return;
+        }
+        if (compiled.flags & FilterRunIsEnough)
+        {
+            *result |= handler;
+            return;
+        }
+    }
+    if (std::find(checked, checked + *checkedCount, filter) != checked + *checkedCount)
+    {
+        return;
+    }
+    if (MatchWildcard(std::wstring_view(m_strings).substr(compiled.offset, compiled.size), uri))
+    {
+        *result |= handler;
+    }
+    else if (*checkedCount < c_maxCheckedFilters)
+    {
+        checked[(*checkedCount)++] = filter;
+    }
+}
+
+bool WebResourceFilterMatcher::MatchWildcard(std::wstring_view pattern, std::wstring_view uri)
+{
+    // Match greedily, and on a mismatch go back to the last '*' and let it take
+    // one more character. Whatever an earlier '*' would take instead, the last
+    // one can take too, so no further back is needed.
+    size_t p = 0;
+    size_t u = 0;
+    size_t star = std::wstring_view::npos;
+    size_t starUri = 0;
+    while (u < uri.size())
+    {
+        if (p < pattern.size() && pattern[p] == L'*')
+        {
+            star = p++;
+            starUri = u;
+        }
+        else if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == uri[u]))
+        {
+            ++p;
+            ++u;
+        }
+        else if (star != std::wstring_view::npos)
+        {
+            p = star + 1;
+            u = ++starUri;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == L'*')
+    {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+size_t WebResourceFilterMatcher::GetMemoryUsage() const
+{
+    return m_strings.capacity() * sizeof(wchar_t) +
+           m_filters.capacity() * sizeof(CompiledFilter) +
+           m_unanchored.capacity() * sizeof(uint32_t) + sizeof(m_asciiClasses) +
+           m_otherClasses.capacity() * sizeof(m_otherClasses[0]) +
+           m_states.capacity() * sizeof(State) + m_denseTargets.capacity() * sizeof(uint32_t) +
+           m_edgeClasses.capacity() * sizeof(uint16_t) +
+           m_edgeTargets.capacity() * sizeof(uint32_t) + m_outputs.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,120 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Answers which of a set of WebResourceRequested handlers want a request, from
+// the URI filters they were added with, in one pass over the request's URI.
+//
+// A filter is a wildcard string as AddWebResourceRequestedFilter takes it, in
+// which '*' matches any run of characters and '?' any one character, and which
+// has to match the whole URI. Each filter is found through its longest run of
+// literal characters: the runs of every filter are compiled into one
+// Aho-Corasick automaton, which reports each run where it ends in the URI, and
+// only the filters whose run is there are matched in full. A filter that is a
+// run with a '*' on either side, such as "https://example.com/*", needs no more
+// than the run being in the right place. Filters with no literal characters,
+// such as "*", are matched for every request.
+
+// The most handlers a matcher can tell apart, one to a bit of Match's result.
+constexpr uint32_t c_maxWebResourceFilterHandlers = 64;
+
+class WebResourceFilterMatcher
+{
+public:
+    struct Filter
+    {
+        std::wstring uri;
+        // A bit for each resource context the filter applies to.
+        uint32_t contexts = 0;
+        // Below c_maxWebResourceFilterHandlers. A handler can have any number
+        // of filters.
+        uint32_t handler = 0;
+    };
+
+    WebResourceFilterMatcher();
+    // Compile filters. Filters whose handler is out of range are skipped.
+    explicit WebResourceFilterMatcher(const std::vector<Filter>& filters);
+
+    // The handlers with a filter that matches uri and applies to context, a
+    // single context bit, as bit (1 << handler).
+    uint64_t Match(std::wstring_view uri, uint32_t context) const;
+
+    size_t GetFilterCount() const { return m_filters.size(); }
+    size_t GetStateCount() const { return m_states.size(); }
+    size_t GetMemoryUsage() const;
+
+    // Whether a wildcard string matches the whole of uri.
+    static bool MatchWildcard(std::wstring_view pattern, std::wstring_view uri);
+
+private:
+    struct CompiledFilter
+    {
+        // The filter's wildcard string, in m_strings.
+        uint32_t offset;
+        uint32_t size;
+        // The size of its longest literal run, which the automaton finds.
+        uint32_t runSize;
+        uint32_t contexts;
+        uint32_t handler;
+        uint32_t flags;
+    };
+
+    struct State
+    {
+        // The state's transitions, in m_edgeClasses and m_edgeTargets, by class.
+        uint32_t edgesBegin;
+        uint32_t edgesEnd;
+        // The state of the longest proper suffix of this state's text that is a
+        // state, and the nearest such state that ends any run.
+        uint32_t fail;
+        uint32_t nextOutput;
+        // The filters whose run ends at this state, in m_outputs.
+        uint32_t outputsBegin;
+        uint32_t outputsEnd;
+        // The handlers and contexts of the filters of every run that ends at
+        // this state, so that a state whose filters can't add to the result is
+        // passed over.
+        uint64_t handlers;
+        uint32_t contexts;
+    };
+
+    uint16_t GetClass(wchar_t c) const;
+    uint32_t Step(uint32_t state, uint16_t charClass) const;
+    // Add filter's handler to result if it matches uri, given that its run ends
+    // at end.
+    void MatchFilter(
+        uint32_t filter, std::wstring_view uri, size_t end, uint32_t context, uint64_t* result,
+        uint32_t* checked, size_t* checkedCount) const;
+
+    std::wstring m_strings;
+    std::vector<CompiledFilter> m_filters;
+    // Filters with no literal run.
+    std::vector<uint32_t> m_unanchored;
+    uint64_t m_allHandlers = 0;
+
+    // Characters map to classes, and the automaton steps by class. Class 0 is
+    // every character that is in no run.
+    uint16_t m_asciiClasses[128] = {};
+    // Sorted by character.
+    std::vector<std::pair<wchar_t, uint16_t>> m_otherClasses;
+    uint16_t m_classCount = 1;
+
+    // State 0 is the root. The first m_denseStateCount states, the root and
+    // those closest to it, have their transitions as a table by class, which
+    // includes those taken through their suffixes; the others have edges.
+    uint32_t m_denseStateCount = 0;
+    std::vector<State> m_states;
+    std::vector<uint32_t> m_denseTargets;
+    std::vector<uint16_t> m_edgeClasses;
+    std::vector<uint32_t> m_edgeTargets;
+    std::vector<uint32_t> m_outputs;
+};
@@ -0,0 +1,188 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stdafx.h"
+
+#include "WebResourceRequestedDispatcher.h"
+
+#include "CheckFailure.h"
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+// The matcher's bits for a resource context, in which ALL is every context.
+uint32_t GetContextBits(COREWEBVIEW2_WEB_RESOURCE_CONTEXT context)
+{
+    if (context == COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL || context >= 32)
+    {
+        return ~uint32_t(0);
+    }
+    return uint32_t(1) << context;
+}
+} // namespace
+
+WebResourceRequestedDispatcher::WebResourceRequestedDispatcher(ICoreWebView2* webView)
+    : m_webView(webView)
+{
+    m_webView2_22 = m_webView.try_query<ICoreWebView2_22>();
+    CHECK_FAILURE(m_webView->add_WebResourceRequested(
+        Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+            [this](ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+            { return OnWebResourceRequested(sender, args); })
+            .Get(),
+        &m_webResourceRequestedToken));
+}
+
+WebResourceRequestedDispatcher::~WebResourceRequestedDispatcher()
+{
+    m_webView->remove_WebResourceRequested(m_webResourceRequestedToken);
+}
+
+HRESULT WebResourceRequestedDispatcher::Add(
+    PCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds,
+    ICoreWebView2WebResourceRequestedEventHandler* handler, EventRegistrationToken* token)
+{
+    if (!uri || !handler)
+    {
+        return E_POINTER;
+    }
+    if (m_registrations.size() >= c_maxWebResourceFilterHandlers)
+    {
+        return E_OUTOFMEMORY;
+    }
+    // Without ICoreWebView2_22, a filter only gets the requests of documents.
+    if (!m_webView2_22 && sourceKinds != COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT)
+    {
+        return E_NOINTERFACE;
+    }
+    m_registrations.push_back({m_nextToken++, uri, context, sourceKinds, handler});
+    if (!IsFilterShared(m_registrations.size() - 1))
+    {
+        HRESULT hr =
+            m_webView2_22
+                ? m_webView2_22->AddWebResourceRequestedFilterWithRequestSourceKinds(
+                      uri, context, sourceKinds)
+                : m_webView->AddWebResourceRequestedFilter(uri, context);
+        if (FAILED(hr))
+        {
+            m_registrations.pop_back();
+            return hr;
+        }
+    }
+    UpdateMatcher();
+    if (token)
+    {
+        token->value = m_registrations.back().token;
+    }
+    return S_OK;
+}
+
+HRESULT WebResourceRequestedDispatcher::Remove(EventRegistrationToken token)
+{
+    for (size_t i = 0; i < m_registrations.size(); ++i)
+    {
+        const Registration& registration = m_registrations[i];
+        if (registration.token != token.value)
+        {
+            continue;
+        }
+        HRESULT hr = S_OK;
+        if (!IsFilterShared(i))
+        {
+            hr = m_webView2_22
+                     ? m_webView2_22->RemoveWebResourceRequestedFilterWithRequestSourceKinds(
+                           registration.uri.c_str(), registration.context,
+                           registration.sourceKinds)
+                     : m_webView->RemoveWebResourceRequestedFilter(
+                           registration.uri.c_str(), registration.context);
+        }
+        m_registrations.erase(m_registrations.begin() + i);
+        UpdateMatcher();
+        return hr;
+    }
+    return S_OK;
+}
+
+HRESULT WebResourceRequestedDispatcher::OnWebResourceRequested(
+    ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args)
+{
+    if (m_registrations.empty())
+    {
+        return S_OK;
+    }
+    wil::com_ptr<ICoreWebView2WebResourceRequest> request;
+    CHECK_FAILURE(args->get_Request(&request));
+    wil::unique_cotaskmem_string uri;
+    CHECK_FAILURE(request->get_Uri(&uri));
+    COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+    CHECK_FAILURE(args->get_ResourceContext(&context));
+    uint64_t handlers = m_matcher.Match(uri.get(), GetContextBits(context));
+    if (handlers == 0)
+    {
+        return S_OK;
+    }
+
+    // The WebView only raises a request for a filter whose source kinds include
+    // the request's, but it may be another handler's filter.
+    COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKind =
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT;
+    wil::com_ptr<ICoreWebView2WebResourceRequestedEventArgs2> args2;
+    if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&args2))))
+    {
+        CHECK_FAILURE(args2->get_RequestedSourceKind(&sourceKind));
+    }
+    // A handler can remove itself or others, so the ones to run are taken first.
+    // They are kept on the stack rather than in a member, as a handler that
+    // shows a dialog can receive the next request before it returns.
+    wil::com_ptr<ICoreWebView2WebResourceRequestedEventHandler>
+        matched[c_maxWebResourceFilterHandlers];
+    size_t matchedCount = 0;
+    for (size_t i = 0; i < m_registrations.size(); ++i)
+    {
+        if ((handlers & (uint64_t(1) << i)) != 0 &&
+            (m_registrations[i].sourceKinds & sourceKind) != 0)
+        {
+            matched[matchedCount++] = m_registrations[i].handler;
+        }
+    }
+    HRESULT result = S_OK;
+    for (size_t i = 0; i < matchedCount; ++i)
+    {
+        HRESULT hr = matched[i]->Invoke(sender, args);
+        if (SUCCEEDED(result))
+        {
+            result = hr;
+        }
+    }
+    return result;
+}
+
+bool WebResourceRequestedDispatcher::IsFilterShared(size_t index) const
+{
+    const Registration& registration = m_registrations[index];
+    for (size_t i = 0; i < m_registrations.size(); ++i)
+    {
+        const Registration& other = m_registrations[i];
+        if (i != index && other.context == registration.context &&
+            other.sourceKinds == registration.sourceKinds && other.uri == registration.uri)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WebResourceRequestedDispatcher::UpdateMatcher()
+{
+    std::vector<WebResourceFilterMatcher::Filter> filters;
+    for (size_t i = 0; i < m_registrations.size(); ++i)
+    {
+        filters.push_back(
+            {m_registrations[i].uri, GetContextBits(m_registrations[i].context),
+             static_cast<uint32_t>(i)});
+    }
+    m_matcher = WebResourceFilterMatcher(filters);
+}
@@ -0,0 +1,70 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "stdafx.h"
+
+#include <string>
+#include <vector>
+
+#include "WebResourceFilterMatcher.h"
+
+// Passes a WebView's WebResourceRequested events on to the handlers added to
+// it, each of which only gets the requests that match its own filter.
+//
+// The WebView raises the event for every handler once a request matches any
+// filter, so with a "*" filter added, as the event monitor adds, every handler
+// would run for every request and check it again. This adds one handler to the
+// WebView instead, and finds the handlers that want a request with a
+// WebResourceFilterMatcher of every handler's filter, in one pass over its URI.
+// Handlers run in the order they were added.
+//
+// It adds each handler's filter to the WebView too, once for all the handlers
+// with the same filter, so that the requests are raised at all.
+class WebResourceRequestedDispatcher
+{
+public:
+    explicit WebResourceRequestedDispatcher(ICoreWebView2* webView);
+    ~WebResourceRequestedDispatcher();
+    WebResourceRequestedDispatcher(const WebResourceRequestedDispatcher&) = delete;
+    WebResourceRequestedDispatcher& operator=(const WebResourceRequestedDispatcher&) = delete;
+
+    // Add a handler for the requests that match a filter, as
+    // AddWebResourceRequestedFilterWithRequestSourceKinds and
+    // add_WebResourceRequested would. At most c_maxWebResourceFilterHandlers
+    // handlers can be added at once. token can be null if the handler is never
+    // removed.
+    HRESULT Add(
+        PCWSTR uri, COREWEBVIEW2_WEB_RESOURCE_CONTEXT context,
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds,
+        ICoreWebView2WebResourceRequestedEventHandler* handler, EventRegistrationToken* token);
+    // Remove a handler, and its filter if no other handler has it. Removing a
+    // token that isn't added does nothing.
+    HRESULT Remove(EventRegistrationToken token);
+
+private:
+    struct Registration
+    {
+        int64_t token;
+        std::wstring uri;
+        COREWEBVIEW2_WEB_RESOURCE_CONTEXT context;
+        COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS sourceKinds;
+        wil::com_ptr<ICoreWebView2WebResourceRequestedEventHandler> handler;
+    };
+
+    HRESULT OnWebResourceRequested(
+        ICoreWebView2* sender, ICoreWebView2WebResourceRequestedEventArgs* args);
+    // Whether another registration has the same filter as m_registrations[index].
+    bool IsFilterShared(size_t index) const;
+    void UpdateMatcher();
+
+    wil::com_ptr<ICoreWebView2> m_webView;
+    wil::com_ptr<ICoreWebView2_22> m_webView2_22;
+    EventRegistrationToken m_webResourceRequestedToken = {};
+    // In the order they were added. Registration i is handler i of m_matcher.
+    std::vector<Registration> m_registrations;
+    WebResourceFilterMatcher m_matcher;
+    int64_t m_nextToken = 1;
+};
@@ -112,6 +112,8 @@
 #define IDM_INJECT_SCRIPT_WITH_RESULT   245
 #define IDM_TOGGLE_CUSTOM_CRASH_REPORTING  246
 #define IDM_GET_FAILURE_REPORT_FOLDER      247
+#define IDM_TOGGLE_HEAP_SAMPLING_VIA_CDP 248
+#define IDM_EXPORT_HEAP_SAMPLES         249
 #define IDM_TOGGLE_TRACKING_PREVENTION     251
 #define IDM_TRACKING_PREVENTION_LEVEL_NONE       252
 #define IDM_TRACKING_PREVENTION_LEVEL_BASIC     253
@@ -147,6 +149,7 @@
 #define IDM_SCENARIO_AUTHENTICATION     2000
 #define IDM_SCENARIO_POST_WEB_MESSAGE   2001
 #define IDM_SCENARIO_WEB_VIEW_EVENT_MONITOR 2002
+#define IDM_SCENARIO_WEB_VIEW_EVENT_MONITOR_LATENCY 2043
 #define IDM_SCENARIO_ADD_HOST_OBJECT    2003
 #define IDM_SCENARIO_DOM_CONTENT_LOADED 2004
 #define IDM_SCENARIO_NAVIGATEWITHWEBRESOURCEREQUEST 2005
@@ -227,6 +230,7 @@
 #define ID_SETTINGS_NON_CLIENT_REGION_SUPPORT_ENABLED 32805
 #define IDM_SCENARIO_THROTTLING_CONTROL 32807
 #define IDM_SCENARIO_SCREEN_CAPTURE 32809
+#define ID_SETTINGS_CONTENT_FILTER 32810
 #define IDC_STATIC                      -1
 // Next default values for new objects
 //
@@ -234,7 +238,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
 #define _APS_NEXT_RESOURCE_VALUE        245
-#define _APS_NEXT_COMMAND_VALUE         32810
+#define _APS_NEXT_COMMAND_VALUE         32811
 #define _APS_NEXT_CONTROL_VALUE         1015
 #define _APS_NEXT_SYMED_VALUE           110
 #endif
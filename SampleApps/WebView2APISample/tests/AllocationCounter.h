@@ -0,0 +1,12 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstddef>
+
+// The number of times operator new has been called in this process. Linking
+// AllocationCounter.cpp replaces the global operator new to count them, so
+// that a test or benchmark can check that a code path doesn't allocate.
+size_t GetAllocationCount();
@@ -0,0 +1,128 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Reads 200 files of 4-64 KB once each, as the app does at startup, from loose
+// files and from an archive of them that is opened and mapped first, touching
+// every page of each entry as a response stream would. On POSIX systems it
+// also does so cold, after asking the operating system to drop the files from
+// its cache; elsewhere, and with --quick, only warm.
+
+#include "AssetArchive.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define ASSET_BENCHMARK_COLD 1
+#endif
+
+#include "Benchmark.h"
+
+namespace
+{
+const char c_directory[] = "AssetArchiveBenchmark.files";
+const char c_archivePath[] = "AssetArchiveBenchmark.pak";
+
+#ifdef ASSET_BENCHMARK_COLD
+// Drop a file from the operating system's cache, once it is on disk.
+void Evict(const std::filesystem::path& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return;
+    }
+    fsync(file);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(file);
+}
+#endif
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t rounds = quick ? 1 : 20;
+    std::filesystem::create_directories(c_directory);
+    std::vector<std::filesystem::path> files;
+    std::vector<std::wstring> paths;
+    AssetArchiveWriter writer;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        std::string name = "asset" + std::to_string(i) + ".js";
+        std::string content(4096 << (i % 5), char('a' + i % 26));
+        files.push_back(std::filesystem::path(c_directory) / name);
+        std::ofstream(files.back(), std::ios::binary) << content;
+        paths.push_back(L"assets/" + std::wstring(name.begin(), name.end()));
+        writer.Add(paths.back(), "text/javascript", {content.begin(), content.end()});
+    }
+    if (!writer.Write(c_archivePath, true))
+    {
+        std::fprintf(stderr, "Can't write %s\n", c_archivePath);
+        return 1;
+    }
+
+    size_t total = 0;
+    auto readLoose = [&]()
+    {
+        std::vector<uint8_t> bytes;
+        for (const std::filesystem::path& file : files)
+        {
+            AssetCache::LoadFile(file.wstring(), &bytes);
+            total += bytes[bytes.size() / 2];
+        }
+    };
+    auto readArchive = [&]()
+    {
+        std::shared_ptr<AssetArchive> archive = AssetArchive::Open(c_archivePath);
+        for (const std::wstring& path : paths)
+        {
+            AssetPtr asset = archive->GetAsset(path);
+            for (size_t i = 0; i < asset->size; i += 4096)
+            {
+                total += asset->data[i];
+            }
+        }
+    };
+
+    bool cold = false;
+#ifdef ASSET_BENCHMARK_COLD
+    cold = !quick;
+#endif
+    for (int pass = cold ? 0 : 1; pass < 2; ++pass)
+    {
+        double looseSeconds = 0;
+        double archiveSeconds = 0;
+        for (size_t round = 0; round < rounds; ++round)
+        {
+#ifdef ASSET_BENCHMARK_COLD
+            if (pass == 0)
+            {
+                for (const std::filesystem::path& file : files)
+                {
+                    Evict(file);
+                }
+                Evict(c_archivePath);
+            }
+#endif
+            looseSeconds += MeasureSeconds(readLoose);
+            archiveSeconds += MeasureSeconds(readArchive);
+        }
+        const char* state = pass == 0 ? "cold" : "warm";
+        std::printf("%s\n", state);
+        ReportRate("  loose files, open and read", rounds * files.size(), looseSeconds);
+        ReportRate("  archive, open once and map", rounds * files.size(), archiveSeconds);
+    }
+    KeepResult(total);
+    std::filesystem::remove_all(c_directory);
+    std::filesystem::remove(c_archivePath);
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AssetArchive.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+const char c_archivePath[] = "AssetArchiveTests.pak";
+const char c_corruptPath[] = "AssetArchiveTests.corrupt.pak";
+
+// Writes the archive the tests read: four entries, one of them empty and one
+// large enough to span pages.
+bool WriteTestArchive()
+{
+    AssetArchiveWriter writer;
+    TEST_CHECK(writer.Add(L"assets/b.txt", "text/plain", {'b'}));
+    TEST_CHECK(writer.Add(L"assets\\A.html", "text/html", {'<', 'a'}));
+    TEST_CHECK(writer.Add(L"assets/empty", "", {}));
+    TEST_CHECK(writer.Add(L"assets/sub/ü.js", "text/javascript", std::vector<uint8_t>(100000, 7)));
+    return writer.Write(c_archivePath, true);
+}
+
+std::vector<char> ReadFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const char* path, const std::vector<char>& bytes, size_t size)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), size);
+}
+
+// Paths are normalized, and can't be added twice in different case.
+void TestWriterPaths()
+{
+    AssetArchiveWriter writer;
+    TEST_CHECK(writer.Add(L"assets/a.html", "text/html", {}));
+    TEST_CHECK(!writer.Add(L"assets/A.HTML", "text/html", {}));
+    TEST_CHECK(!writer.Add(L"./assets//a.html", "text/html", {}));
+    TEST_CHECK(!writer.Add(L"../x", "", {}));
+    TEST_CHECK(!writer.Add(L"", "", {}));
+    TEST_CHECK(writer.GetItemCount() == 1);
+}
+
+void TestRoundTrip()
+{
+    TEST_CHECK(WriteTestArchive());
+    std::shared_ptr<AssetArchive> archive = AssetArchive::Open(c_archivePath);
+    TEST_CHECK(archive && archive->GetItemCount() == 4 && archive->HasHashes());
+    if (!archive)
+    {
+        return;
+    }
+    // Entries are in path order, ignoring case, and their data is aligned.
+    for (size_t i = 0; i < archive->GetItemCount(); ++i)
+    {
+        AssetArchiveItem item = archive->GetItem(i);
+        TEST_CHECK(reinterpret_cast<uintptr_t>(item.data) % c_assetArchiveAlignment == 0);
+        TEST_CHECK(item.hash == HashAssetBytes(item.data, item.size));
+        if (i > 0)
+        {
+            TEST_CHECK(CompareAssetPaths(archive->GetItem(i - 1).path, item.path) < 0);
+        }
+    }
+
+    AssetArchiveItem item;
+    TEST_CHECK(archive->Find(L"./assets/a.html", &item));
+    TEST_CHECK(item.path == "assets/A.html" && item.size == 2 && item.contentType == "text/html");
+    TEST_CHECK(archive->Find(L"assets/sub/../sub/ü.js", &item) && item.size == 100000);
+    TEST_CHECK(item.data[0] == 7 && item.data[99999] == 7);
+    // Only ASCII case is ignored.
+    TEST_CHECK(!archive->Find(L"assets/sub/Ü.js", &item));
+    TEST_CHECK(archive->Find(L"assets/empty", &item) && item.size == 0);
+    TEST_CHECK(archive->FindKey("ASSETS/B.TXT", &item) && item.size == 1);
+    TEST_CHECK(!archive->Find(L"assets/c", &item));
+    TEST_CHECK(!archive->Find(L"assets", &item));
+    TEST_CHECK(!archive->Find(L"", &item));
+    TEST_CHECK(!archive->Find(L"../assets/b.txt", &item));
+
+    // An archive without hashes.
+    AssetArchiveWriter writer;
+    TEST_CHECK(writer.Add(L"a", "", {1, 2, 3}));
+    TEST_CHECK(writer.Write(c_corruptPath, false));
+    std::shared_ptr<AssetArchive> noHashes = AssetArchive::Open(c_corruptPath);
+    TEST_CHECK(noHashes && !noHashes->HasHashes());
+    TEST_CHECK(noHashes && noHashes->Find(L"a", &item) && item.hash == 0);
+}
+
+// An asset keeps its archive mapped until the last stream over it is gone.
+void TestAssetLifetime()
+{
+    std::shared_ptr<AssetArchive> archive = AssetArchive::Open(c_archivePath);
+    TEST_CHECK(archive);
+    if (!archive)
+    {
+        return;
+    }
+    AssetArchiveItem item;
+    AssetPtr asset = archive->GetAsset(L"assets/B.txt", &item);
+    TEST_CHECK(asset && asset->size == 1 && asset->data[0] == 'b');
+    TEST_CHECK(asset->key == L"assets/B.txt" && item.path == "assets/b.txt");
+    TEST_CHECK(asset->hasHash && asset->hash == item.hash);
+    TEST_CHECK(!archive->GetAsset(L"assets/none"));
+
+    std::weak_ptr<AssetArchive> weak = archive;
+    archive.reset();
+    TEST_CHECK(!weak.expired());
+    {
+        AssetStream stream(asset);
+        asset.reset();
+        char c = 0;
+        TEST_CHECK(stream.Read(&c, 1) == 1 && c == 'b');
+        TEST_CHECK(!weak.expired());
+    }
+    TEST_CHECK(weak.expired());
+}
+
+void TestEmptyArchive()
+{
+    AssetArchiveWriter writer;
+    TEST_CHECK(writer.Write(c_corruptPath, false));
+    std::shared_ptr<AssetArchive> archive = AssetArchive::Open(c_corruptPath);
+    AssetArchiveItem item;
+    TEST_CHECK(archive && archive->GetItemCount() == 0 && !archive->Find(L"x", &item));
+    TEST_CHECK(!AssetArchive::Open("AssetArchiveTests.missing.pak"));
+}
+
+// Every truncation is rejected, and random bit flips in the index are either
+// rejected or leave an archive whose entries all lie within the file.
+void TestCorruption()
+{
+    TEST_CHECK(WriteTestArchive());
+    std::vector<char> bytes = ReadFile(c_archivePath);
+    size_t indexEnd = sizeof(AssetArchiveHeader) + 4 * sizeof(AssetArchiveEntry) + 64;
+    TEST_CHECK(bytes.size() > indexEnd);
+    for (size_t size = 0; size < bytes.size(); size += size < indexEnd ? 1 : 4093)
+    {
+        WriteFile(c_corruptPath, bytes, size);
+        TEST_CHECK(!AssetArchive::Open(c_corruptPath));
+    }
+
+    std::mt19937 random(1);
+    int opened = 0;
+    for (int i = 0; i < 5000; ++i)
+    {
+        std::vector<char> copy = bytes;
+        for (int flip = 0; flip < 3; ++flip)
+        {
+            copy[random() % indexEnd] ^= char(1 << (random() % 8));
+        }
+        WriteFile(c_corruptPath, copy, copy.size());
+        std::shared_ptr<AssetArchive> archive = AssetArchive::Open(c_corruptPath);
+        if (!archive)
+        {
+            continue;
+        }
+        ++opened;
+        for (size_t j = 0; j < archive->GetItemCount(); ++j)
+        {
+            // Reading every byte lets AddressSanitizer catch an entry that
+            // points outside the mapping.
+            AssetArchiveItem entry = archive->GetItem(j);
+            HashAssetBytes(entry.data, entry.size);
+            AssetArchiveItem found;
+            TEST_CHECK(archive->FindKey(entry.path, &found) && found.data == entry.data);
+        }
+    }
+    std::printf("  %d of 5000 corrupted archives opened\n", opened);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestWriterPaths);
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestAssetLifetime);
+    RUN_TEST(TestEmptyArchive);
+    RUN_TEST(TestCorruption);
+    std::filesystem::remove(c_archivePath);
+    std::filesystem::remove(c_corruptPath);
+    return ReportTestResults();
+}
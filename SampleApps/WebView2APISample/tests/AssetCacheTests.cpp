@@ -0,0 +1,341 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "AssetCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A loader over files in memory, which counts its loads and can be slowed
+// down.
+struct MemoryFiles
+{
+    std::map<std::wstring, std::vector<uint8_t>> files;
+    // The last write times of files that have one.
+    std::map<std::wstring, int64_t> times;
+    std::atomic<int> loads{0};
+    std::chrono::milliseconds delay{0};
+
+    AssetCache::Loader GetLoader()
+    {
+        return [this](
+                   const std::wstring& path, size_t maxBytes, AssetFileInfo* info,
+                   std::vector<uint8_t>* bytes)
+        {
+            ++loads;
+            std::this_thread::sleep_for(delay);
+            auto file = files.find(path);
+            if (file == files.end())
+            {
+                return false;
+            }
+            info->size = file->second.size();
+            auto time = times.find(path);
+            info->lastWriteTime = time == times.end() ? 0 : time->second;
+            if (file->second.size() <= maxBytes)
+            {
+                *bytes = file->second;
+            }
+            return true;
+        };
+    }
+};
+
+std::vector<uint8_t> MakeBytes(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        bytes[i] = uint8_t(seed + i * 7);
+    }
+    return bytes;
+}
+
+void TestNormalizeKey()
+{
+    TEST_CHECK(AssetCache::NormalizeKey(L"a\\b.js") == L"a/b.js");
+    TEST_CHECK(AssetCache::NormalizeKey(L"./a//b/../c.js") == L"a/c.js");
+    TEST_CHECK(AssetCache::NormalizeKey(L"a/./") == L"a");
+    TEST_CHECK(AssetCache::NormalizeKey(L"A/B") == L"A/B");
+    TEST_CHECK(AssetCache::NormalizeKey(L"").empty());
+    TEST_CHECK(AssetCache::NormalizeKey(L"../a").empty());
+    TEST_CHECK(AssetCache::NormalizeKey(L"a/..").empty());
+    TEST_CHECK(AssetCache::NormalizeKey(L"a/b/../../..").empty());
+}
+
+void TestHitsAndMisses()
+{
+    MemoryFiles files;
+    files.files[L"a/index.html"] = MakeBytes(100, 1);
+    AssetCache cache(AssetCache::Options(), files.GetLoader());
+    AssetPtr first = cache.Get(L"a/index.html");
+    AssetPtr second = cache.Get(L"a\\.\\index.html");
+    TEST_CHECK(first && first == second);
+    TEST_CHECK(first->key == L"a/index.html");
+    TEST_CHECK(first->size == 100 && first->bytes == files.files[L"a/index.html"]);
+    // The hash of a file that was read is of its bytes.
+    TEST_CHECK(first->hasHash && !first->hashIsWeak);
+    TEST_CHECK(first->hash == HashAssetBytes(first->data, first->size));
+    TEST_CHECK(!cache.Get(L"missing.js"));
+    TEST_CHECK(!cache.Get(L"../escape.js"));
+    AssetCache::Stats stats = cache.GetStats();
+    TEST_CHECK(stats.hits == 1 && stats.misses == 2 && stats.failedLoads == 1);
+    TEST_CHECK(stats.assetCount == 1 && stats.bytes == 100);
+    TEST_CHECK(files.loads == 2);
+
+    cache.Clear();
+    TEST_CHECK(cache.Get(L"a/index.html") != first);
+    TEST_CHECK(files.loads == 3);
+}
+
+// The least recently used files are evicted once maxBytes is reached, and a
+// file larger than maxAssetBytes stays on disk.
+void TestEviction()
+{
+    MemoryFiles files;
+    for (int i = 0; i < 4; ++i)
+    {
+        files.files[L"f" + std::to_wstring(i)] = MakeBytes(400, uint8_t(i));
+    }
+    files.files[L"large"] = MakeBytes(2000, 9);
+    AssetCache::Options options;
+    options.maxBytes = 1000;
+    options.maxAssetBytes = 1000;
+    AssetCache cache(options, files.GetLoader());
+    cache.Get(L"f0");
+    cache.Get(L"f1");
+    cache.Get(L"f0");
+    cache.Get(L"f2");
+    AssetCache::Stats stats = cache.GetStats();
+    TEST_CHECK(stats.evictions == 1 && stats.assetCount == 2 && stats.bytes == 800);
+    int loads = files.loads;
+    cache.Get(L"f0");
+    TEST_CHECK(files.loads == loads);
+    cache.Get(L"f1");
+    TEST_CHECK(files.loads == loads + 1);
+
+    AssetPtr large = cache.Get(L"large");
+    TEST_CHECK(large && large->isOnDisk && !large->data && large->size == 2000);
+    // Of what the loader said about it, which makes a weak ETag.
+    AssetFileInfo info;
+    info.size = 2000;
+    TEST_CHECK(large->hasHash && large->hashIsWeak);
+    TEST_CHECK(large->hash == HashAssetBytes(reinterpret_cast<uint8_t*>(&info), sizeof(info)));
+    TEST_CHECK(cache.GetStats().assetCount == 2);
+}
+
+// Threads asking for a file that is loading wait for that load.
+void TestSharedLoads()
+{
+    MemoryFiles files;
+    files.files[L"app.js"] = MakeBytes(1000, 3);
+    files.delay = std::chrono::milliseconds(50);
+    AssetCache cache(AssetCache::Options(), files.GetLoader());
+    std::vector<AssetPtr> results(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        threads.emplace_back([&, i]() { results[i] = cache.Get(L"app.js"); });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (const AssetPtr& result : results)
+    {
+        TEST_CHECK(result && result == results[0]);
+    }
+    AssetCache::Stats stats = cache.GetStats();
+    TEST_CHECK(files.loads == 1);
+    TEST_CHECK(stats.misses == 1);
+    TEST_CHECK(stats.hits + stats.sharedLoads == results.size() - 1);
+}
+
+// A cached file is checked at most once every checkInterval, and is read again
+// if its size or time has changed.
+void TestChangedFiles()
+{
+    MemoryFiles files;
+    files.files[L"app.js"] = MakeBytes(100, 1);
+    AssetCache::Options options;
+    options.checkInterval = std::chrono::milliseconds(50);
+    AssetCache cache(options, files.GetLoader());
+    AssetPtr first = cache.Get(L"app.js");
+    TEST_CHECK(first && cache.Get(L"app.js") == first);
+    TEST_CHECK(files.loads == 1 && cache.GetStats().checks == 0);
+
+    // Same size, newer time: not seen until the interval has passed.
+    files.files[L"app.js"] = MakeBytes(100, 2);
+    files.times[L"app.js"] = 1;
+    TEST_CHECK(cache.Get(L"app.js") == first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    AssetPtr second = cache.Get(L"app.js");
+    TEST_CHECK(second && second != first && second->bytes == files.files[L"app.js"]);
+    TEST_CHECK(second && second->hash != first->hash);
+    AssetCache::Stats stats = cache.GetStats();
+    TEST_CHECK(stats.checks == 1 && stats.changes == 1 && stats.misses == 2);
+    TEST_CHECK(stats.assetCount == 1 && stats.bytes == 100);
+    TEST_CHECK(files.loads == 3);
+
+    // Unchanged: one check, and the cached asset.
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    TEST_CHECK(cache.GetWithoutLoading(L"app.js") == second);
+    TEST_CHECK(cache.GetStats().checks == 2 && files.loads == 4);
+
+    // A new size, then gone.
+    files.files[L"app.js"] = MakeBytes(120, 3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    AssetPtr third = cache.Get(L"app.js");
+    TEST_CHECK(third && third->size == 120 && cache.GetStats().bytes == 120);
+    files.files.erase(L"app.js");
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    TEST_CHECK(!cache.Get(L"app.js"));
+    stats = cache.GetStats();
+    TEST_CHECK(stats.changes == 3 && stats.assetCount == 0 && stats.bytes == 0);
+}
+
+// A loader that throws fails the load for every thread waiting on it, and
+// leaves the file to be loaded again by the next request.
+void TestThrowingLoader()
+{
+    MemoryFiles files;
+    files.files[L"app.js"] = MakeBytes(100, 4);
+    files.delay = std::chrono::milliseconds(50);
+    std::atomic<bool> fail{true};
+    AssetCache::Loader loader = files.GetLoader();
+    AssetCache cache(
+        AssetCache::Options(),
+        [&](const std::wstring& path, size_t maxBytes, AssetFileInfo* info,
+            std::vector<uint8_t>* bytes)
+        {
+            bool loaded = loader(path, maxBytes, info, bytes);
+            if (fail)
+            {
+                throw std::runtime_error("read failed");
+            }
+            return loaded;
+        });
+    std::atomic<int> thrown{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                try
+                {
+                    cache.Get(L"app.js");
+                }
+                catch (const std::runtime_error&)
+                {
+                    ++thrown;
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    TEST_CHECK(thrown == 4);
+    TEST_CHECK(cache.GetStats().failedLoads >= 1);
+
+    fail = false;
+    AssetPtr asset = cache.Get(L"app.js");
+    TEST_CHECK(asset && asset->size == 100);
+    TEST_CHECK(cache.Get(L"app.js") == asset);
+}
+
+// Files on disk, read through the default loader.
+void TestFilesOnDisk()
+{
+    std::filesystem::path directory = "AssetCacheTests.files";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::vector<uint8_t> big = MakeBytes(300000, 5);
+    std::ofstream(directory / "big.bin", std::ios::binary)
+        .write(reinterpret_cast<const char*>(big.data()), big.size());
+    std::ofstream(directory / "small.js", std::ios::binary) << "console.log(1);";
+
+    AssetCache::Options options;
+    options.maxAssetBytes = 100000;
+    AssetCache cache(options);
+    AssetPtr small = cache.Get(L"AssetCacheTests.files/small.js");
+    TEST_CHECK(small && !small->isOnDisk && small->size == 15);
+    TEST_CHECK(std::memcmp(small->data, "console.log(1);", 15) == 0);
+
+    AssetPtr onDisk = cache.Get(L"AssetCacheTests.files/big.bin");
+    TEST_CHECK(onDisk && onDisk->isOnDisk && onDisk->size == big.size() && onDisk->hasHash);
+    TEST_CHECK(onDisk && onDisk->hashIsWeak);
+    TEST_CHECK(cache.GetStats().assetCount == 1);
+
+    // A range of an asset on disk, read by two copies of a stream.
+    AssetStream stream(onDisk, 1000, 50000);
+    std::vector<uint8_t> buffer(70000);
+    TEST_CHECK(stream.Read(buffer.data(), 30000) == 30000);
+    TEST_CHECK(std::memcmp(buffer.data(), big.data() + 1000, 30000) == 0);
+    AssetStream copy = stream;
+    TEST_CHECK(stream.Read(buffer.data(), 30000) == 20000);
+    TEST_CHECK(std::memcmp(buffer.data(), big.data() + 31000, 20000) == 0);
+    TEST_CHECK(copy.Read(buffer.data(), 10) == 10);
+    TEST_CHECK(std::memcmp(buffer.data(), big.data() + 31000, 10) == 0);
+    TEST_CHECK(copy.Seek(-5, AssetSeekOrigin::End) && copy.Read(buffer.data(), 100) == 5);
+    TEST_CHECK(std::memcmp(buffer.data(), big.data() + 50995, 5) == 0);
+
+    // A file that grows gets a new ETag hash.
+    std::ofstream(directory / "big.bin", std::ios::binary | std::ios::app) << "x";
+    AssetPtr grown = cache.Get(L"AssetCacheTests.files/big.bin");
+    TEST_CHECK(grown && grown->size == big.size() + 1);
+    TEST_CHECK(grown && grown->hash != onDisk->hash);
+
+    // Only describing a file doesn't load it, and returns the cached one.
+    AssetPtr described = cache.GetWithoutLoading(L"AssetCacheTests.files/big.bin");
+    TEST_CHECK(described && described->isOnDisk);
+    TEST_CHECK(cache.GetWithoutLoading(L"AssetCacheTests.files/small.js") == small);
+    TEST_CHECK(!cache.GetWithoutLoading(L"AssetCacheTests.files/none.js"));
+}
+
+void TestStreamSeek()
+{
+    auto asset = std::make_shared<Asset>();
+    asset->bytes = MakeBytes(100, 0);
+    asset->data = asset->bytes.data();
+    asset->size = asset->bytes.size();
+    AssetStream stream(asset, 10, 20);
+    uint64_t position = 0;
+    TEST_CHECK(stream.GetSize() == 20 && stream.GetData() == asset->data + 10);
+    TEST_CHECK(stream.Seek(5, AssetSeekOrigin::Begin, &position) && position == 5);
+    TEST_CHECK(stream.Seek(3, AssetSeekOrigin::Current, &position) && position == 8);
+    TEST_CHECK(!stream.Seek(-9, AssetSeekOrigin::Current) && stream.GetPosition() == 8);
+    TEST_CHECK(stream.Seek(10, AssetSeekOrigin::End, &position) && position == 30);
+    uint8_t byte = 0;
+    TEST_CHECK(stream.Read(&byte, 1) == 0);
+    TEST_CHECK(stream.Seek(-1, AssetSeekOrigin::End) && stream.Read(&byte, 1) == 1);
+    TEST_CHECK(byte == asset->bytes[29]);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestNormalizeKey);
+    RUN_TEST(TestHitsAndMisses);
+    RUN_TEST(TestEviction);
+    RUN_TEST(TestSharedLoads);
+    RUN_TEST(TestThrowingLoader);
+    RUN_TEST(TestChangedFiles);
+    RUN_TEST(TestFilesOnDisk);
+    RUN_TEST(TestStreamSeek);
+    return ReportTestResults();
+}
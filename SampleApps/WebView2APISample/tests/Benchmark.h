@@ -0,0 +1,56 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Timing for the benchmarks of the portable modules. Every benchmark takes
+// --quick, which ctest passes: it then runs a small fraction of its iterations,
+// which only checks that it still works. Timings are only meaningful from a
+// full run of a build without sanitizers.
+
+inline bool IsQuickRun(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Full or quick iteration count.
+inline size_t Iterations(bool quick, size_t full)
+{
+    return quick ? (full / 1000 > 0 ? full / 1000 : 1) : full;
+}
+
+// Wall time of a call in seconds.
+template <typename Function> double MeasureSeconds(Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keep the compiler from discarding a result that is otherwise unused.
+inline volatile size_t g_benchmarkResult = 0;
+inline void KeepResult(size_t value)
+{
+    g_benchmarkResult = value;
+}
+
+// Print the time per operation and the operation rate.
+inline void ReportRate(const char* name, size_t operations, double seconds)
+{
+    double nanoseconds = operations ? seconds * 1e9 / operations : 0;
+    double perSecond = seconds > 0 ? operations / seconds : 0;
+    std::printf("%-48s %10.1f ns/op %12.0f op/s\n", name, nanoseconds, perSecond);
+}
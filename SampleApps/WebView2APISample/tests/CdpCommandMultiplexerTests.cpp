@@ -0,0 +1,285 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpCommandMultiplexer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace std::chrono;
+
+namespace
+{
+constexpr int32_t c_failed = -2147467259; // E_FAIL
+
+// A DevTools protocol endpoint that completes each command after a random
+// latency of up to maxLatency, in simulated time, and fails one in ten. It
+// never answers sessions in silentSessions, and answers right away, from
+// inside the endpoint call, while synchronous is set.
+struct SimulatedEndpoint
+{
+    steady_clock::time_point now;
+    milliseconds maxLatency{200};
+    std::set<std::wstring> silentSessions;
+    bool synchronous = false;
+    std::mt19937 random{7};
+    std::multimap<steady_clock::time_point, uint64_t> completions;
+    std::map<std::wstring, size_t> inFlight;
+    std::map<std::wstring, size_t> maxInFlight;
+    std::map<uint64_t, std::wstring> sessions;
+    std::vector<std::wstring> methods;
+    CdpCommandMultiplexer multiplexer;
+
+    explicit SimulatedEndpoint(size_t maxInFlightPerSession)
+        : multiplexer(
+              {maxInFlightPerSession},
+              [this](
+                  uint64_t commandId, const std::wstring& sessionId, const std::wstring& method,
+                  const std::wstring&) { OnSend(commandId, sessionId, method); },
+              [this]() { return now; })
+    {
+    }
+
+    void OnSend(uint64_t commandId, const std::wstring& sessionId, const std::wstring& method)
+    {
+        methods.push_back(method);
+        if (synchronous)
+        {
+            multiplexer.OnCommandCompleted(commandId, 0, L"{\"sync\":1}");
+            return;
+        }
+        size_t count = ++inFlight[sessionId];
+        maxInFlight[sessionId] = (std::max)(maxInFlight[sessionId], count);
+        sessions[commandId] = sessionId;
+        if (!silentSessions.count(sessionId))
+        {
+            milliseconds latency(random() % (maxLatency.count() + 1));
+            completions.emplace(now + latency, commandId);
+        }
+    }
+
+    // Deliver completions and expire timeouts in order until the given time.
+    void RunFor(milliseconds duration)
+    {
+        steady_clock::time_point until = now + duration;
+        for (;;)
+        {
+            steady_clock::time_point completion =
+                completions.empty() ? steady_clock::time_point::max() : completions.begin()->first;
+            steady_clock::time_point deadline = multiplexer.GetNextDeadline();
+            if ((std::min)(completion, deadline) > until)
+            {
+                break;
+            }
+            if (deadline < completion)
+            {
+                now = deadline;
+                multiplexer.ExpireCommands();
+                continue;
+            }
+            uint64_t commandId = completions.begin()->second;
+            completions.erase(completions.begin());
+            now = completion;
+            --inFlight[sessions[commandId]];
+            int32_t error = random() % 10 == 0 ? c_failed : 0;
+            multiplexer.OnCommandCompleted(commandId, error, L"{\"usedSize\":1}");
+        }
+        now = until;
+        multiplexer.ExpireCommands();
+    }
+};
+
+// How many callbacks ran, in all and with each status.
+struct Tally
+{
+    std::map<CdpCommandStatus, int> statuses;
+    int callbacks = 0;
+
+    CdpCommandMultiplexer::Callback Count()
+    {
+        return [this](const CdpCommandResult& result)
+        {
+            ++callbacks;
+            ++statuses[result.status];
+        };
+    }
+};
+
+// Commands with and without timeouts, some canceled, over 10 sessions: each
+// callback runs once, whatever the command's outcome.
+void TestLatencyAndTimeouts()
+{
+    SimulatedEndpoint endpoint(4);
+    Tally tally;
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 1000; ++i)
+    {
+        ids.push_back(endpoint.multiplexer.Send(
+            L"S" + std::to_wstring(i % 10), L"Runtime.getHeapUsage", L"{}",
+            milliseconds(i % 3 == 0 ? 0 : 300), tally.Count()));
+    }
+    int canceled = 0;
+    for (size_t i = 0; i < ids.size(); i += 7)
+    {
+        canceled += endpoint.multiplexer.Cancel(ids[i]);
+    }
+    TEST_CHECK(tally.callbacks == canceled);
+    endpoint.RunFor(seconds(100));
+
+    TEST_CHECK(tally.callbacks == 1000);
+    TEST_CHECK(tally.statuses[CdpCommandStatus::Canceled] == canceled);
+    // 100 commands per session, 4 at a time, each taking up to 200 ms, so the
+    // later ones with a 300 ms timeout expire in the queue.
+    TEST_CHECK(tally.statuses[CdpCommandStatus::TimedOut] > 0);
+    TEST_CHECK(tally.statuses[CdpCommandStatus::Failed] > 0);
+    TEST_CHECK(endpoint.multiplexer.GetPendingCount() == 0);
+    TEST_CHECK(endpoint.multiplexer.GetInFlightCount() == 0);
+    TEST_CHECK(!endpoint.multiplexer.Cancel(ids[1]));
+}
+
+// Without timeouts, which free a command's place before the endpoint answers,
+// each session has exactly its limit in flight while it has a queue.
+void TestInFlightLimit()
+{
+    SimulatedEndpoint endpoint(4);
+    Tally tally;
+    for (int i = 0; i < 500; ++i)
+    {
+        endpoint.multiplexer.Send(
+            L"W" + std::to_wstring(i % 5), L"Z", L"{}", milliseconds(0), tally.Count());
+    }
+    TEST_CHECK(endpoint.multiplexer.GetInFlightCount() == 20);
+    endpoint.RunFor(seconds(100));
+    TEST_CHECK(tally.callbacks == 500);
+    TEST_CHECK(endpoint.maxInFlight.size() == 5);
+    for (const auto& session : endpoint.maxInFlight)
+    {
+        TEST_CHECK(session.second == 4);
+    }
+}
+
+// Queued commands of a session are sent in the order they were sent to the
+// multiplexer.
+void TestQueueOrder()
+{
+    SimulatedEndpoint endpoint(2);
+    Tally tally;
+    for (int i = 0; i < 20; ++i)
+    {
+        endpoint.multiplexer.Send(
+            L"S", L"M" + std::to_wstring(i), L"{}", milliseconds(0), tally.Count());
+    }
+    TEST_CHECK(endpoint.multiplexer.GetInFlightCount() == 2);
+    TEST_CHECK(endpoint.multiplexer.GetPendingCount() == 20);
+    endpoint.RunFor(seconds(10));
+    TEST_CHECK(tally.callbacks == 20);
+    TEST_CHECK(endpoint.methods.size() == 20);
+    for (size_t i = 0; i < endpoint.methods.size(); ++i)
+    {
+        TEST_CHECK(endpoint.methods[i] == L"M" + std::to_wstring(i));
+    }
+}
+
+// A gather reports once, in session order, even if a session never answers.
+void TestGather()
+{
+    SimulatedEndpoint endpoint(4);
+    endpoint.silentSessions.insert(L"B");
+    std::vector<std::wstring> sessions{L"", L"A", L"B", L"C"};
+    int gathered = 0;
+    endpoint.multiplexer.Gather(
+        sessions, L"Runtime.getHeapUsage", L"{}", milliseconds(500),
+        [&](std::vector<CdpGatherResult>& results)
+        {
+            ++gathered;
+            TEST_CHECK(results.size() == sessions.size());
+            for (size_t i = 0; i < results.size() && i < sessions.size(); ++i)
+            {
+                TEST_CHECK(results[i].sessionId == sessions[i]);
+            }
+            TEST_CHECK(
+                results.size() > 2 && results[2].result.status == CdpCommandStatus::TimedOut);
+        });
+    endpoint.RunFor(milliseconds(499));
+    TEST_CHECK(gathered == 0);
+    endpoint.RunFor(milliseconds(1));
+    TEST_CHECK(gathered == 1);
+    TEST_CHECK(endpoint.multiplexer.GetPendingCount() == 0);
+}
+
+// Canceling a gather reports it right away, and its callback can send more.
+void TestGatherCancel()
+{
+    SimulatedEndpoint endpoint(4);
+    Tally tally;
+    std::vector<std::wstring> sessions{L"", L"A", L"B"};
+    int gathered = 0;
+    uint64_t gather = endpoint.multiplexer.Gather(
+        sessions, L"X", L"{}", milliseconds(0),
+        [&](std::vector<CdpGatherResult>& results)
+        {
+            ++gathered;
+            for (const CdpGatherResult& result : results)
+            {
+                TEST_CHECK(result.result.status == CdpCommandStatus::Canceled);
+            }
+            endpoint.multiplexer.Send(L"A", L"Y", L"{}", milliseconds(10), tally.Count());
+        });
+    TEST_CHECK(endpoint.multiplexer.Cancel(gather));
+    TEST_CHECK(gathered == 1);
+    TEST_CHECK(!endpoint.multiplexer.Cancel(gather));
+    endpoint.RunFor(seconds(1));
+    TEST_CHECK(tally.callbacks == 1);
+
+    // Results of the canceled commands that arrive later are dropped.
+    TEST_CHECK(endpoint.multiplexer.GetPendingCount() == 0);
+}
+
+// An endpoint may complete a command before it returns.
+void TestSynchronousCompletion()
+{
+    SimulatedEndpoint endpoint(4);
+    endpoint.synchronous = true;
+    int gathered = 0;
+    endpoint.multiplexer.Gather(
+        {L"", L"A", L"B"}, L"X", L"{}", milliseconds(10),
+        [&](std::vector<CdpGatherResult>& results)
+        {
+            ++gathered;
+            for (const CdpGatherResult& result : results)
+            {
+                TEST_CHECK(result.result.json == L"{\"sync\":1}");
+            }
+        });
+    TEST_CHECK(gathered == 1);
+    endpoint.multiplexer.Gather(
+        {}, L"X", L"{}", milliseconds(10),
+        [&](std::vector<CdpGatherResult>& results)
+        {
+            ++gathered;
+            TEST_CHECK(results.empty());
+        });
+    TEST_CHECK(gathered == 2);
+    TEST_CHECK(endpoint.multiplexer.GetPendingCount() == 0);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestLatencyAndTimeouts);
+    RUN_TEST(TestInFlightLimit);
+    RUN_TEST(TestQueueOrder);
+    RUN_TEST(TestGather);
+    RUN_TEST(TestGatherCancel);
+    RUN_TEST(TestSynchronousCompletion);
+    return ReportTestResults();
+}
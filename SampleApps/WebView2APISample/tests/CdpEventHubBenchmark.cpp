@@ -0,0 +1,116 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Dispatches Runtime.consoleAPICalled events to 1, 4 and 16 subscribers, half
+// of them reading the parameters and a quarter filtered to a session, against
+// a receiver per subscriber that parses each event itself. Then dispatches
+// them paced at 100k events/s for a second, and counts the events that took
+// longer than their 10 us share.
+
+#include "CdpEventHub.h"
+
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+#include "Benchmark.h"
+
+namespace
+{
+const wchar_t c_event[] = L"Runtime.consoleAPICalled";
+const wchar_t c_parameters[] =
+    LR"({"type":"log","args":[{"type":"string","value":"hello world"},{"type":"object",)"
+    LR"("description":"Object","preview":{"type":"object","overflow":false,"properties":)"
+    LR"([{"name":"a","type":"number","value":"1"},{"name":"b","type":"string","value":"two"}]}}],)"
+    LR"("executionContextId":3,"timestamp":1760000000000.5,"stackTrace":{"callFrames":)"
+    LR"([{"functionName":"f","url":"https://example.com/app.js","lineNumber":10,)"
+    LR"("columnNumber":4}]}})";
+
+const wchar_t* SessionOf(size_t event)
+{
+    return event % 2 ? L"S7" : L"";
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t events = Iterations(quick, 200000);
+    size_t pacedEvents = Iterations(quick, 100000);
+    size_t total = 0;
+    for (int subscribers : {1, 4, 16})
+    {
+        CdpEventHub hub(
+            [](const std::wstring&) { return true; }, [](const std::wstring&) {},
+            [](std::wstring_view) { return std::wstring_view(L"T"); });
+        for (int i = 0; i < subscribers; ++i)
+        {
+            if (i % 4 == 1)
+            {
+                hub.Subscribe(
+                    c_event, [&](const CdpEvent& event) { total += event.GetName().size(); });
+            }
+            else if (i % 4 == 3)
+            {
+                hub.Subscribe(
+                    c_event, [&](const CdpEvent&) { ++total; },
+                    {std::wstring(L"S7"), std::nullopt});
+            }
+            else
+            {
+                hub.Subscribe(
+                    c_event,
+                    [&](const CdpEvent& event)
+                    { total += event.GetParameters()[L"type"].GetStringOr().size(); });
+            }
+        }
+        std::printf("%d subscriber(s)\n", subscribers);
+
+        double seconds = MeasureSeconds(
+            [&]()
+            {
+                for (size_t i = 0; i < events; ++i)
+                {
+                    hub.Dispatch(c_event, SessionOf(i), c_parameters);
+                }
+            });
+        ReportRate("  CdpEventHub", events, seconds);
+
+        JsonDocument document;
+        seconds = MeasureSeconds(
+            [&]()
+            {
+                for (size_t i = 0; i < events; ++i)
+                {
+                    for (int s = 0; s < subscribers; ++s)
+                    {
+                        document.Parse(c_parameters);
+                        total += document.GetRoot()[L"type"].GetStringOr().size();
+                    }
+                }
+            });
+        ReportRate("  a receiver and a parse per subscriber", events, seconds);
+
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point start = Clock::now();
+        size_t overBudget = 0;
+        for (size_t i = 0; i < pacedEvents; ++i)
+        {
+            Clock::time_point due = start + std::chrono::microseconds(10 * i);
+            while (Clock::now() < due)
+            {
+            }
+            hub.Dispatch(c_event, SessionOf(i), c_parameters);
+            overBudget += Clock::now() > due + std::chrono::microseconds(10);
+        }
+        const CdpEventHub::Stats& stats = hub.GetStats();
+        std::printf(
+            "  paced at 100k events/s: %zu of %zu over budget; %llu parses, %llu deliveries\n",
+            overBudget, pacedEvents, static_cast<unsigned long long>(stats.parses),
+            static_cast<unsigned long long>(stats.deliveries));
+    }
+    KeepResult(total);
+    return 0;
+}
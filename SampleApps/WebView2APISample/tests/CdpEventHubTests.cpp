@@ -0,0 +1,177 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpEventHub.h"
+
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "TestHarness.h"
+
+namespace
+{
+// The receivers a hub has added, which fail for "Bad.event", and a target for
+// session S1.
+struct Receivers
+{
+    std::multiset<std::wstring> added;
+    CdpEventHub hub{
+        [this](const std::wstring& name)
+        {
+            added.insert(name);
+            return name != L"Bad.event";
+        },
+        [this](const std::wstring& name) { added.erase(added.find(name)); },
+        [](std::wstring_view sessionId)
+        { return sessionId == L"S1" ? std::wstring_view(L"T1") : std::wstring_view(); }};
+};
+
+void TestFilters()
+{
+    Receivers receivers;
+    CdpEventHub& hub = receivers.hub;
+    int all = 0;
+    int session = 0;
+    int target = 0;
+    hub.Subscribe(L"E", [&](const CdpEvent&) { ++all; });
+    hub.Subscribe(
+        L"E",
+        [&](const CdpEvent& event)
+        {
+            ++session;
+            TEST_CHECK(event.GetSessionId() == L"S1");
+            TEST_CHECK(event.GetParameters()[L"x"].Exists());
+        },
+        {std::wstring(L"S1"), std::nullopt});
+    hub.Subscribe(
+        L"E",
+        [&](const CdpEvent& event)
+        {
+            ++target;
+            TEST_CHECK(event.GetTargetId() == L"T1");
+            TEST_CHECK(event.GetParameters()[L"x"].Exists());
+        },
+        {std::nullopt, std::wstring(L"T1")});
+    TEST_CHECK(receivers.added.count(L"E") == 1);
+    TEST_CHECK(hub.GetSubscriberCount(L"E") == 3);
+
+    hub.Dispatch(L"E", L"", LR"({"x":1})");
+    hub.Dispatch(L"E", L"S1", LR"({"x":1})");
+    hub.Dispatch(L"Other", L"S1", LR"({"x":1})");
+    TEST_CHECK(all == 2 && session == 1 && target == 1);
+    // The second event was parsed once for both of the subscribers that read it.
+    TEST_CHECK(hub.GetStats().parses == 1);
+    TEST_CHECK(hub.GetStats().events == 2 && hub.GetStats().deliveries == 4);
+}
+
+// An event whose receiver can't be added isn't subscribed to.
+void TestFailedReceiver()
+{
+    Receivers receivers;
+    TEST_CHECK(receivers.hub.Subscribe(L"Bad.event", [](const CdpEvent&) {}) == 0);
+    TEST_CHECK(receivers.hub.GetSubscriberCount(L"Bad.event") == 0);
+    TEST_CHECK(receivers.hub.GetReceiverCount() == 0);
+}
+
+void TestTypedEvents()
+{
+    Receivers receivers;
+    int attached = 0;
+    receivers.hub.SubscribeAs<CdpTargetEvent>(
+        L"Target.attachedToTarget",
+        [&](const CdpTargetEvent& event)
+        {
+            ++attached;
+            TEST_CHECK(event.sessionId == L"S9" && event.targetId == L"T9");
+            TEST_CHECK(event.type == L"worker" && event.url == L"u");
+        });
+    receivers.hub.Dispatch(
+        L"Target.attachedToTarget", L"",
+        LR"({"sessionId":"S9","targetInfo":{"targetId":"T9","type":"worker","url":"u"}})");
+    // Parameters that aren't an object are skipped.
+    receivers.hub.Dispatch(L"Target.attachedToTarget", L"", L"bad");
+    receivers.hub.Dispatch(L"Target.attachedToTarget", L"", L"[1]");
+    TEST_CHECK(attached == 1);
+}
+
+// Handlers that unsubscribe, subscribe and dispatch a nested event.
+void TestReentrancy()
+{
+    Receivers receivers;
+    CdpEventHub& hub = receivers.hub;
+    int first = 0;
+    int self = 0;
+    int late = 0;
+    int nested = 0;
+    uint64_t firstId = hub.Subscribe(L"E", [&](const CdpEvent&) { ++first; });
+    uint64_t selfId = 0;
+    selfId = hub.Subscribe(
+        L"E",
+        [&](const CdpEvent& event)
+        {
+            ++self;
+            TEST_CHECK(hub.Unsubscribe(selfId));
+            TEST_CHECK(hub.Unsubscribe(firstId));
+            hub.Subscribe(L"E", [&](const CdpEvent&) { ++late; });
+            hub.Subscribe(
+                L"N",
+                [&](const CdpEvent& inner)
+                {
+                    ++nested;
+                    TEST_CHECK(inner.GetParameters()[L"y"].Exists());
+                });
+            hub.Dispatch(L"N", L"", LR"({"y":2})");
+            // The nested event didn't reparse over this one.
+            TEST_CHECK(event.GetParameters()[L"x"].Exists());
+        });
+    hub.Dispatch(L"E", L"", LR"({"x":1})");
+    TEST_CHECK(first == 1 && self == 1 && late == 0 && nested == 1);
+    hub.Dispatch(L"E", L"", LR"({"x":1})");
+    TEST_CHECK(first == 1 && self == 1 && late == 1);
+    TEST_CHECK(hub.GetSubscriberCount(L"E") == 1);
+    TEST_CHECK(!hub.Unsubscribe(selfId));
+}
+
+// The last subscriber to leave removes the receiver, and Clear() and the
+// destructor remove the rest.
+void TestReceiverLifetime()
+{
+    std::multiset<std::wstring> added;
+    {
+        CdpEventHub hub(
+            [&](const std::wstring& name)
+            {
+                added.insert(name);
+                return true;
+            },
+            [&](const std::wstring& name) { added.erase(added.find(name)); });
+        uint64_t a = hub.Subscribe(L"A", [](const CdpEvent&) {});
+        uint64_t b = hub.Subscribe(L"A", [](const CdpEvent&) {});
+        TEST_CHECK(added.count(L"A") == 1);
+        hub.Unsubscribe(a);
+        TEST_CHECK(added.count(L"A") == 1);
+        hub.Unsubscribe(b);
+        TEST_CHECK(added.count(L"A") == 0);
+
+        hub.Subscribe(L"B", [](const CdpEvent&) {});
+        hub.Subscribe(L"C", [](const CdpEvent&) {});
+        hub.Clear();
+        TEST_CHECK(added.empty() && hub.GetReceiverCount() == 0);
+        hub.Subscribe(L"D", [](const CdpEvent&) {});
+    }
+    TEST_CHECK(added.empty());
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestFilters);
+    RUN_TEST(TestFailedReceiver);
+    RUN_TEST(TestTypedEvents);
+    RUN_TEST(TestReentrancy);
+    RUN_TEST(TestReceiverLifetime);
+    return ReportTestResults();
+}
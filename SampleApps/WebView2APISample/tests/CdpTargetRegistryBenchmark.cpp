@@ -0,0 +1,62 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Times attaching 100k sessions, each to its own target, finding each session
+// and reading its label, and detaching them all again.
+
+#include "CdpTargetRegistry.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+int main(int argc, char** argv)
+{
+    size_t targets = Iterations(IsQuickRun(argc, argv), 100000);
+    std::vector<std::wstring> ids;
+    for (size_t i = 0; i < targets; ++i)
+    {
+        ids.push_back(L"2F0B6E2C1D8A4F6A9C3E5B7D" + std::to_wstring(i));
+    }
+
+    CdpTargetRegistry registry;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (const std::wstring& id : ids)
+            {
+                registry.AttachSession(id, id, L"dedicated_worker,https://example.com/worker.js");
+            }
+        });
+    ReportRate("AttachSession", targets, seconds);
+
+    constexpr size_t c_lookupRounds = 10;
+    size_t length = 0;
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < c_lookupRounds; ++round)
+            {
+                for (const std::wstring& id : ids)
+                {
+                    length += registry.GetTargetLabel(registry.FindSession(id)).size();
+                }
+            }
+        });
+    KeepResult(length);
+    ReportRate("FindSession and GetTargetLabel", targets * c_lookupRounds, seconds);
+
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (const std::wstring& id : ids)
+            {
+                registry.DetachSession(id);
+            }
+        });
+    ReportRate("DetachSession", targets, seconds);
+    return registry.GetSessionCount() == 0 && registry.GetTargetCount() == 0 ? 0 : 1;
+}
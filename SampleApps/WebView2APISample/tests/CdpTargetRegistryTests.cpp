@@ -0,0 +1,204 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CdpTargetRegistry.h"
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "TestHarness.h"
+
+namespace
+{
+void TestAttachAndDetach()
+{
+    CdpTargetRegistry registry;
+    CdpSessionHandle first = registry.AttachSession(L"S1", L"T1", L"worker,a.js");
+    CdpSessionHandle second = registry.AttachSession(L"S2", L"T1", L"worker,b.js");
+    TEST_CHECK(registry.GetSessionCount() == 2 && registry.GetTargetCount() == 1);
+    TEST_CHECK(registry.GetTargetLabel(first) == L"worker,b.js");
+    TEST_CHECK(registry.GetSessionId(second) == L"S2");
+    TEST_CHECK(registry.GetTargetId(second) == L"T1");
+
+    // The target stays while a session is attached to it.
+    TEST_CHECK(registry.DetachSession(L"S1"));
+    TEST_CHECK(!registry.DetachSession(L"S1"));
+    TEST_CHECK(registry.GetTargetCount() == 1);
+    TEST_CHECK(registry.SetTargetLabel(L"T1", L"iframe,c.html"));
+    TEST_CHECK(registry.GetTargetLabel(second) == L"iframe,c.html");
+    TEST_CHECK(registry.DetachSession(L"S2"));
+    TEST_CHECK(registry.GetTargetCount() == 0);
+    TEST_CHECK(!registry.SetTargetLabel(L"T1", L"x"));
+}
+
+// A session that attaches again moves to the new target and keeps its handle.
+void TestReattach()
+{
+    CdpTargetRegistry registry;
+    CdpSessionHandle session = registry.AttachSession(L"S", L"T1", L"one");
+    CdpSessionHandle again = registry.AttachSession(L"S", L"T2", L"two");
+    TEST_CHECK(again.index == session.index && again.generation == session.generation);
+    TEST_CHECK(registry.GetTargetId(session) == L"T2");
+    TEST_CHECK(registry.GetSessionCount() == 1 && registry.GetTargetCount() == 1);
+}
+
+// A handle of a detached session stays stale once its slot is reused.
+void TestStaleHandles()
+{
+    CdpTargetRegistry registry;
+    CdpSessionHandle stale = registry.AttachSession(L"old", L"T", L"label");
+    registry.DetachSession(L"old");
+    CdpSessionHandle reused = registry.AttachSession(L"new", L"T2", L"label2");
+    TEST_CHECK(reused.index == stale.index);
+    TEST_CHECK(!registry.IsValid(stale) && registry.IsValid(reused));
+    TEST_CHECK(registry.GetSessionId(stale).empty());
+    TEST_CHECK(registry.GetTargetLabel(stale).empty());
+    TEST_CHECK(!registry.IsValid(CdpSessionHandle()));
+    TEST_CHECK(registry.FindSession(L"old").IsNull());
+}
+
+// Random attaches, detaches and label changes, checked against maps of what
+// the registry should hold.
+void TestAgainstModel()
+{
+    CdpTargetRegistry registry;
+    std::map<std::wstring, std::wstring> sessionTargets;
+    std::map<std::wstring, std::wstring> targetLabels;
+    std::map<std::wstring, int> targetSessions;
+    std::vector<std::pair<std::wstring, CdpSessionHandle>> handles;
+    auto release = [&](const std::wstring& target)
+    {
+        if (--targetSessions[target] == 0)
+        {
+            targetSessions.erase(target);
+            targetLabels.erase(target);
+        }
+    };
+    std::mt19937 random(1);
+    for (int i = 0; i < 100000; ++i)
+    {
+        std::wstring session = L"S" + std::to_wstring(random() % 20000);
+        std::wstring target = L"T" + std::to_wstring(random() % 8000);
+        std::wstring label = L"worker," + std::to_wstring(i);
+        switch (random() % 4)
+        {
+        case 0:
+        case 1:
+        {
+            CdpSessionHandle handle = registry.AttachSession(session, target, label);
+            auto found = sessionTargets.find(session);
+            if (found != sessionTargets.end())
+            {
+                release(found->second);
+            }
+            sessionTargets[session] = target;
+            ++targetSessions[target];
+            targetLabels[target] = label;
+            handles.emplace_back(session, handle);
+            break;
+        }
+        case 2:
+        {
+            auto found = sessionTargets.find(session);
+            TEST_CHECK(registry.DetachSession(session) == (found != sessionTargets.end()));
+            if (found != sessionTargets.end())
+            {
+                release(found->second);
+                sessionTargets.erase(found);
+            }
+            break;
+        }
+        default:
+            TEST_CHECK(
+                registry.SetTargetLabel(target, label) == (targetLabels.count(target) != 0));
+            if (targetLabels.count(target))
+            {
+                targetLabels[target] = label;
+            }
+        }
+
+        if (i % 997 == 0)
+        {
+            TEST_CHECK(registry.GetSessionCount() == sessionTargets.size());
+            TEST_CHECK(registry.GetTargetCount() == targetLabels.size());
+            for (const auto& entry : sessionTargets)
+            {
+                CdpSessionHandle handle = registry.FindSession(entry.first);
+                TEST_CHECK(registry.IsValid(handle));
+                TEST_CHECK(registry.GetSessionId(handle) == entry.first);
+                TEST_CHECK(registry.GetTargetId(handle) == entry.second);
+                TEST_CHECK(registry.GetTargetLabel(handle) == targetLabels[entry.second]);
+            }
+            for (const auto& entry : handles)
+            {
+                TEST_CHECK(
+                    !registry.IsValid(entry.second) ||
+                    registry.GetSessionId(entry.second) == entry.first);
+            }
+            size_t visited = 0;
+            registry.ForEachSession([&](CdpSessionHandle) { ++visited; });
+            TEST_CHECK(visited == sessionTargets.size());
+        }
+    }
+}
+
+// 100k targets attached and detached twice over, with lookups in between that
+// mustn't allocate.
+void TestStress()
+{
+    constexpr int c_targets = 100000;
+    std::vector<std::wstring> ids;
+    for (int i = 0; i < c_targets; ++i)
+    {
+        ids.push_back(L"2F0B6E2C1D8A4F6A9C3E5B7D" + std::to_wstring(i));
+    }
+    CdpTargetRegistry registry;
+    for (int round = 0; round < 2; ++round)
+    {
+        for (const std::wstring& id : ids)
+        {
+            registry.AttachSession(id, id, L"dedicated_worker,https://example.com/worker.js");
+        }
+        TEST_CHECK(registry.GetSessionCount() == c_targets);
+        TEST_CHECK(registry.GetTargetCount() == c_targets);
+
+        size_t allocations = GetAllocationCount();
+        size_t found = 0;
+        for (const std::wstring& id : ids)
+        {
+            CdpSessionHandle session = registry.FindSession(id);
+            found +=
+                registry.GetTargetId(session) == id && !registry.GetTargetLabel(session).empty();
+        }
+        TEST_CHECK(GetAllocationCount() == allocations);
+        TEST_CHECK(found == c_targets);
+
+        // Detach every other one first, so that the hash tables have holes.
+        for (size_t i = 0; i < ids.size(); i += 2)
+        {
+            TEST_CHECK(registry.DetachSession(ids[i]));
+        }
+        for (size_t i = 1; i < ids.size(); i += 2)
+        {
+            TEST_CHECK(registry.IsValid(registry.FindSession(ids[i])));
+            TEST_CHECK(registry.DetachSession(ids[i]));
+        }
+        TEST_CHECK(registry.GetSessionCount() == 0 && registry.GetTargetCount() == 0);
+    }
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestAttachAndDetach);
+    RUN_TEST(TestReattach);
+    RUN_TEST(TestStaleHandles);
+    RUN_TEST(TestAgainstModel);
+    RUN_TEST(TestStress);
+    return ReportTestResults();
+}
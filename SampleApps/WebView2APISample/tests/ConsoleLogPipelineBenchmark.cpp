@@ -0,0 +1,134 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Pushes Runtime.consoleAPICalled events from 1 and 4 threads, as fast as they
+// can, into a pipeline with the default queue and no rate limit. Reports the
+// cost of Push(), the time until the log accounts for every event, and how
+// many were dropped. Fails if the log doesn't account for every event.
+
+#include "ConsoleLogPipeline.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+std::wstring MakeEvent(int producer, int message, int64_t timestamp)
+{
+    return LR"({"type":"log","args":[{"type":"string","value":"message )" +
+           std::to_wstring(message) + LR"("},{"type":"number","value":)" +
+           std::to_wstring(producer) +
+           LR"(,"description":"1"},{"type":"object","className":"Object",)"
+           LR"("description":"Object","preview":{"type":"object","overflow":false,)"
+           LR"("properties":[{"name":"a","type":"number","value":"1"}]}}],)"
+           LR"("executionContextId":1,"timestamp":)" +
+           std::to_wstring(timestamp) + L"}";
+}
+
+// Counts the events a log accounts for: written, repeated or dropped.
+struct Accounting
+{
+    uint64_t written = 0;
+    uint64_t repeated = 0;
+    uint64_t dropped = 0;
+
+    void Count(std::string_view line)
+    {
+        std::string text(line.substr(25));
+        if (text.find("dropped because") != std::string::npos)
+        {
+            dropped += std::strtoull(text.c_str() + 1, nullptr, 10);
+        }
+        else if (text.find("(last message repeated ") != std::string::npos)
+        {
+            repeated += std::strtoull(text.c_str() + text.find("repeated ") + 9, nullptr, 10);
+        }
+        else
+        {
+            ++written;
+        }
+    }
+};
+
+bool Run(int producers, size_t eventsPerProducer)
+{
+    std::vector<std::vector<std::wstring>> events(producers);
+    for (int producer = 0; producer < producers; ++producer)
+    {
+        for (size_t i = 0; i < eventsPerProducer; ++i)
+        {
+            // Every tenth message repeats the one before.
+            int message = int(i % 10 == 9 ? i - 1 : i);
+            events[producer].push_back(MakeEvent(producer, message, 1760000000000 + i));
+        }
+    }
+
+    std::filesystem::create_directories("ConsoleLogBenchmark");
+    ConsoleLogPipeline::Options options;
+    options.path = "ConsoleLogBenchmark/ConsoleLog.txt";
+    options.messagesPerSecond = 0;
+    Accounting accounting;
+    options.echo = [&accounting](std::string_view line) { accounting.Count(line); };
+
+    std::atomic<int64_t> pushNanoseconds{0};
+    size_t total = producers * eventsPerProducer;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            ConsoleLogPipeline pipeline(options);
+            std::vector<std::thread> threads;
+            for (int producer = 0; producer < producers; ++producer)
+            {
+                threads.emplace_back(
+                    [&, producer]()
+                    {
+                        std::wstring source =
+                            producer == 0 ? L"" : L"worker," + std::to_wstring(producer);
+                        double pushSeconds = MeasureSeconds(
+                            [&]()
+                            {
+                                for (const std::wstring& event : events[producer])
+                                {
+                                    pipeline.Push(source, event);
+                                }
+                            });
+                        pushNanoseconds += int64_t(pushSeconds * 1e9);
+                    });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+            // The destructor writes what is still queued.
+        });
+
+    std::string name = std::to_string(producers) + " producer(s), Push";
+    ReportRate(name.c_str(), total, pushNanoseconds / 1e9 / producers);
+    name = std::to_string(producers) + " producer(s), end to end";
+    ReportRate(name.c_str(), total, seconds);
+    std::printf(
+        "  %llu written, %llu repeated, %llu dropped\n",
+        static_cast<unsigned long long>(accounting.written),
+        static_cast<unsigned long long>(accounting.repeated),
+        static_cast<unsigned long long>(accounting.dropped));
+    return accounting.written + accounting.repeated + accounting.dropped == total;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t events = Iterations(IsQuickRun(argc, argv), 400000);
+    bool accounted = Run(1, events) && Run(4, events / 4);
+    std::filesystem::remove_all("ConsoleLogBenchmark");
+    return accounted ? 0 : 1;
+}
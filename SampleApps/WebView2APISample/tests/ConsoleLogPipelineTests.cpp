@@ -0,0 +1,224 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ConsoleLogPipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A directory of its own for each test's log files.
+std::filesystem::path MakeLogDirectory(const char* name)
+{
+    std::filesystem::path directory = std::filesystem::path("ConsoleLogs") / name;
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+// Options that log to a directory and echo each line, without its timestamp
+// and CRLF, to lines. lines may only be read once the pipeline is destroyed.
+ConsoleLogPipeline::Options MakeOptions(const char* name, std::vector<std::string>* lines)
+{
+    ConsoleLogPipeline::Options options;
+    options.path = MakeLogDirectory(name) / "ConsoleLog.txt";
+    options.echo = [lines](std::string_view line)
+    {
+        // "2025-10-09T08:53:20.000Z " and "\r\n".
+        lines->emplace_back(line.substr(25, line.size() - 27));
+    };
+    return options;
+}
+
+std::wstring MakeEvent(const std::string& type, const std::string& text, int64_t timestamp)
+{
+    std::string json = R"({"type":")" + type + R"(","args":[{"type":"string","value":")" + text +
+                       R"("}],"executionContextId":1,"timestamp":)" +
+                       std::to_string(timestamp) + "}";
+    return std::wstring(json.begin(), json.end());
+}
+
+constexpr int64_t c_time = 1760000000000;
+
+void TestFormatting()
+{
+    std::vector<std::string> lines;
+    {
+        ConsoleLogPipeline pipeline(MakeOptions("Formatting", &lines));
+        pipeline.Push(
+            L"",
+            LR"({"type":"warning","args":[{"type":"string","value":"x =é\n"},)"
+            LR"({"type":"number","unserializableValue":"NaN"},{"type":"number","value":1.5},)"
+            LR"({"type":"object","description":"Object"},{"type":"undefined"}],)"
+            LR"("timestamp":1760000000000})");
+        pipeline.Push(
+            L"worker,https://example.com/w.js", MakeEvent("error", "from worker", c_time));
+        pipeline.Push(L"", L"not json");
+    }
+    TEST_CHECK(lines.size() == 3);
+    if (lines.size() == 3)
+    {
+        TEST_CHECK(lines[0] == "warning: x =\xC3\xA9\n NaN 1.5 Object undefined");
+        TEST_CHECK(lines[1] == "(from worker,https://example.com/w.js) error: from worker");
+        TEST_CHECK(lines[2] == "not json");
+    }
+}
+
+// A run of identical messages is written once with a count, and each source
+// is limited to burstMessages, then messagesPerSecond.
+void TestRepeatsAndRateLimit()
+{
+    std::vector<std::string> lines;
+    ConsoleLogPipeline::Stats stats;
+    {
+        ConsoleLogPipeline::Options options = MakeOptions("RateLimit", &lines);
+        options.messagesPerSecond = 1;
+        options.burstMessages = 3;
+        ConsoleLogPipeline pipeline(options);
+        pipeline.Push(L"", MakeEvent("log", "a", c_time));
+        pipeline.Push(L"", MakeEvent("log", "a", c_time + 1));
+        pipeline.Push(L"", MakeEvent("log", "a", c_time + 2));
+        pipeline.Push(L"", MakeEvent("log", "b", c_time + 3));
+        pipeline.Push(L"", MakeEvent("log", "c", c_time + 4));
+        pipeline.Push(L"", MakeEvent("log", "d", c_time + 5));
+        pipeline.Push(L"", MakeEvent("log", "e", c_time + 6));
+        pipeline.Push(L"w", MakeEvent("log", "w", c_time + 6));
+        // Two seconds later the page has two tokens back.
+        pipeline.Push(L"", MakeEvent("log", "f", c_time + 2006));
+        // Wait for the writer thread to catch up.
+        while (pipeline.GetStats().linesWritten < 7)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        stats = pipeline.GetStats();
+    }
+    const char* const expected[] = {
+        "log: a", "(last message repeated 2 more times)", "log: b", "log: c", "(from w) log: w",
+        "(2 messages suppressed by rate limit)", "log: f",
+    };
+    TEST_CHECK(lines.size() == std::size(expected));
+    for (size_t i = 0; i < lines.size() && i < std::size(expected); ++i)
+    {
+        TEST_CHECK(lines[i] == expected[i]);
+    }
+    TEST_CHECK(stats.received == 9);
+    TEST_CHECK(stats.repeated == 2);
+    TEST_CHECK(stats.rateLimited == 2);
+    TEST_CHECK(stats.dropped == 0);
+}
+
+// The log is rotated once it would grow past maxFileBytes, keeping maxFiles
+// files that hold the latest lines.
+void TestRotation()
+{
+    std::vector<std::string> lines;
+    ConsoleLogPipeline::Options options = MakeOptions("Rotation", &lines);
+    options.maxFileBytes = 400;
+    options.maxFiles = 3;
+    options.messagesPerSecond = 0;
+    {
+        ConsoleLogPipeline pipeline(options);
+        for (int i = 0; i < 100; ++i)
+        {
+            pipeline.Push(L"", MakeEvent("log", "message " + std::to_string(i), c_time + i));
+        }
+    }
+    std::filesystem::path directory = options.path.parent_path();
+    std::vector<std::string> kept;
+    for (const char* name : {"ConsoleLog.2.txt", "ConsoleLog.1.txt", "ConsoleLog.txt"})
+    {
+        std::filesystem::path path = directory / name;
+        TEST_CHECK(std::filesystem::exists(path));
+        TEST_CHECK(std::filesystem::file_size(path) <= options.maxFileBytes);
+        std::ifstream file(path, std::ios::binary);
+        for (std::string line; std::getline(file, line);)
+        {
+            kept.push_back(line.substr(25, line.size() - 26));
+        }
+    }
+    TEST_CHECK(!std::filesystem::exists(directory / "ConsoleLog.3.txt"));
+    TEST_CHECK(lines.size() == 100);
+    TEST_CHECK(!kept.empty() && kept.size() < lines.size());
+    for (size_t i = 0; i < kept.size() && i < lines.size(); ++i)
+    {
+        TEST_CHECK(kept[i] == lines[lines.size() - kept.size() + i]);
+    }
+}
+
+// With a small queue and several producers, every event pushed is either
+// written, counted as a repeat, or counted as dropped in the log.
+void TestDropAccounting()
+{
+    constexpr int c_producers = 4;
+    constexpr int c_events = 5000;
+    std::vector<std::string> lines;
+    std::atomic<int> rejected{0};
+    {
+        ConsoleLogPipeline::Options options = MakeOptions("Drops", &lines);
+        options.queueCapacity = 16;
+        options.messagesPerSecond = 0;
+        ConsoleLogPipeline pipeline(options);
+        std::vector<std::thread> producers;
+        for (int producer = 0; producer < c_producers; ++producer)
+        {
+            producers.emplace_back(
+                [&, producer]()
+                {
+                    std::wstring source = L"worker," + std::to_wstring(producer);
+                    for (int i = 0; i < c_events; ++i)
+                    {
+                        // Every tenth message repeats the one before.
+                        int message = i % 10 == 9 ? i - 1 : i;
+                        rejected += !pipeline.Push(
+                            source, MakeEvent("log", std::to_string(message), c_time + i));
+                    }
+                });
+        }
+        for (std::thread& thread : producers)
+        {
+            thread.join();
+        }
+    }
+    uint64_t written = 0;
+    uint64_t repeated = 0;
+    uint64_t dropped = 0;
+    for (const std::string& line : lines)
+    {
+        if (line.find("dropped because") != std::string::npos)
+        {
+            dropped += std::strtoull(line.c_str() + 1, nullptr, 10);
+        }
+        else if (line.find("(last message repeated ") != std::string::npos)
+        {
+            repeated += std::strtoull(line.c_str() + line.find("repeated ") + 9, nullptr, 10);
+        }
+        else
+        {
+            ++written;
+        }
+    }
+    TEST_CHECK(dropped == uint64_t(rejected));
+    TEST_CHECK(written + repeated + dropped == c_producers * c_events);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestFormatting);
+    RUN_TEST(TestRepeatsAndRateLimit);
+    RUN_TEST(TestRotation);
+    RUN_TEST(TestDropAccounting);
+    return ReportTestResults();
+}
@@ -0,0 +1,87 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ContentEncoding.h"
+
+#include <cstdio>
+#include <string>
+
+#include "TestHarness.h"
+
+namespace
+{
+const ContentCodings c_gzip = ToContentCodings(ContentCoding::Gzip);
+const ContentCodings c_all = c_gzip | ToContentCodings(ContentCoding::Zstd);
+
+bool Negotiates(const wchar_t* acceptEncoding, ContentCodings available, ContentCoding expected)
+{
+    ContentCoding coding = NegotiateContentCoding(acceptEncoding, available);
+    if (coding != expected)
+    {
+        std::fprintf(
+            stderr, "  \"%ls\" negotiated %ls\n", acceptEncoding,
+            std::wstring(GetContentCodingName(coding)).c_str());
+    }
+    return coding == expected;
+}
+
+void TestPreferences()
+{
+    TEST_CHECK(Negotiates(L"", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"gzip, deflate, br, zstd", c_all, ContentCoding::Zstd));
+    TEST_CHECK(Negotiates(L"gzip, deflate, br, zstd", c_gzip, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip, deflate, br", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;q=0.5, zstd;q=0.4", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"br", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"zstd", 0, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"GZIP", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"x-gzip", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;level=9", c_all, ContentCoding::Gzip));
+}
+
+// "*" and identity, which is acceptable unless refused.
+void TestWildcardAndIdentity()
+{
+    TEST_CHECK(Negotiates(L"*", c_all, ContentCoding::Zstd));
+    TEST_CHECK(Negotiates(L"*;q=0", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"gzip;q=0.5,*;q=0.9", c_all, ContentCoding::Zstd));
+    TEST_CHECK(Negotiates(L"zstd;q=0", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"identity;q=0, gzip;q=0.1", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;q=0.3, identity;q=0.5", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"gzip ; Q = 0.3 , identity;q=0.2", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;q=0, gzip", c_all, ContentCoding::Identity));
+}
+
+// Weights have at most three decimals and are at most 1, and malformed
+// elements are skipped.
+void TestMalformed()
+{
+    TEST_CHECK(Negotiates(L"gzip;q=1.000", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;q=0.001", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gzip;q=1.5", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"gzip;q=0.0001", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L"gzip;q=", c_all, ContentCoding::Identity));
+    TEST_CHECK(Negotiates(L",,gzip,,", c_all, ContentCoding::Gzip));
+    TEST_CHECK(Negotiates(L"gz ip", c_all, ContentCoding::Identity));
+}
+
+void TestNamesAndSuffixes()
+{
+    TEST_CHECK(GetContentCodingName(ContentCoding::Gzip) == L"gzip");
+    TEST_CHECK(GetContentCodingName(ContentCoding::Zstd) == L"zstd");
+    TEST_CHECK(GetContentCodingName(ContentCoding::Identity) == L"identity");
+    TEST_CHECK(GetContentCodingSuffix(ContentCoding::Gzip) == L".gz");
+    TEST_CHECK(GetContentCodingSuffix(ContentCoding::Zstd) == L".zst");
+    TEST_CHECK(GetContentCodingSuffix(ContentCoding::Identity).empty());
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestPreferences);
+    RUN_TEST(TestWildcardAndIdentity);
+    RUN_TEST(TestMalformed);
+    RUN_TEST(TestNamesAndSuffixes);
+    return ReportTestResults();
+}
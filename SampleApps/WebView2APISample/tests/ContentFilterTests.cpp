@@ -0,0 +1,358 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ContentFilter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "TestHarness.h"
+
+namespace
+{
+using Result = ContentFilterResult;
+
+Result Match(
+    const ContentFilter& filter, const std::wstring& url, const std::wstring& documentUrl,
+    ContentFilterTypes type = ContentFilterScript)
+{
+    ContentFilterRequest request;
+    request.url = url;
+    request.documentUrl = documentUrl;
+    request.type = type;
+    return filter.Match(request);
+}
+
+bool IsReferenceSeparator(char c)
+{
+    return !std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.' &&
+           c != '%';
+}
+
+// Whether pattern matches url from position on, by plain backtracking.
+bool ReferenceMatchAt(const char* pattern, const std::string& url, size_t position, bool endAnchor)
+{
+    for (; *pattern != '\0'; ++pattern)
+    {
+        if (*pattern == '*')
+        {
+            for (size_t next = position; next <= url.size(); ++next)
+            {
+                if (ReferenceMatchAt(pattern + 1, url, next, endAnchor))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (position == url.size())
+        {
+            // ^ also matches the end of the URL.
+            if (*pattern != '^')
+            {
+                return false;
+            }
+            continue;
+        }
+        char c = url[position++];
+        if (*pattern == '^' ? !IsReferenceSeparator(c)
+                            : std::tolower(static_cast<unsigned char>(c)) != *pattern)
+        {
+            return false;
+        }
+    }
+    return !endAnchor || position == url.size();
+}
+
+// Whether a rule without options matches url, the slow and obvious way, to
+// check the filter by. As in the filter, a * beside an anchor cancels it.
+bool ReferenceMatch(std::string pattern, const std::string& url)
+{
+    bool hostAnchor = pattern.rfind("||", 0) == 0;
+    bool startAnchor = !hostAnchor && pattern.rfind("|", 0) == 0;
+    pattern.erase(0, hostAnchor ? 2 : startAnchor ? 1 : 0);
+    bool endAnchor = !pattern.empty() && pattern.back() == '|';
+    if (endAnchor)
+    {
+        pattern.pop_back();
+    }
+    hostAnchor = hostAnchor && (pattern.empty() || pattern.front() != '*');
+    startAnchor = startAnchor && (pattern.empty() || pattern.front() != '*');
+    endAnchor = endAnchor && (pattern.empty() || pattern.back() != '*');
+
+    std::vector<size_t> starts;
+    if (hostAnchor)
+    {
+        // The start of the host, or of one of its labels.
+        size_t host = url.find("://") + 3;
+        size_t hostEnd = std::min(url.find_first_of("/?#:", host), url.size());
+        starts.push_back(host);
+        for (size_t i = host; i < hostEnd; ++i)
+        {
+            if (url[i] == '.')
+            {
+                starts.push_back(i + 1);
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i <= (startAnchor ? 0 : url.size()); ++i)
+        {
+            starts.push_back(i);
+        }
+    }
+    for (size_t start : starts)
+    {
+        if (ReferenceMatchAt(pattern.c_str(), url, start, endAnchor))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char c_list[] = "[Adblock Plus 2.0]\n"
+                      "! comment\n"
+                      "||ads.example.com^\n"
+                      "|https://start.test/ad\n"
+                      "/banner/*/img^\n"
+                      "swf|\n"
+                      "||cdn.tracker.net^$third-party\n"
+                      "/ad.png$image,domain=a.com|~b.a.com\n"
+                      "@@||example.com/ads.js$script\n"
+                      "||example.com/ads.js\n"
+                      "||evil.org^$important\n"
+                      "@@||evil.org^\n"
+                      "example.com##.ad\n"
+                      "/^regex$/\n"
+                      "||popup.com^$popup\n"
+                      "||x.com^$~image\n"
+                      "||mc.com/Path$match-case\n"
+                      "&adid=\n"
+                      "||fp.com^$~third-party\n"
+                      "||gtld.co.uk^$third-party\n";
+
+void TestStats()
+{
+    ContentFilter filter(c_list);
+    const ContentFilter::Stats& stats = filter.GetStats();
+    TEST_CHECK(stats.blockingRules == 13 && stats.exceptionRules == 2);
+    TEST_CHECK(stats.elementHidingRules == 1 && stats.unsupportedRules == 2);
+    TEST_CHECK(filter.GetMemoryUsage() > 0);
+}
+
+void TestPatterns()
+{
+    ContentFilter filter(c_list);
+    TEST_CHECK(Match(filter, L"https://ads.example.com/x.js", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://sub.ads.example.com:8080/", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://ads.example.com", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"HTTPS://ADS.EXAMPLE.COM/", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://badads.example.com/", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://ads.example.community/", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://start.test/adverts", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"http://x.test/https://start.test/ad", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"http://x.test/banner/1/2/img?x", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"http://x.test/banner/1/2/imgs", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"http://x.test/banner/img", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"http://x.test/movie.swf", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"http://x.test/movie.swf?x", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://q.test/?a=1&ADID=5", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://mc.com/Path", L"") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://mc.com/path", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://popup.com/", L"") == Result::NoMatch);
+
+    // A long URL is matched without allocating.
+    std::wstring longUrl = L"https://x.test/" + std::wstring(400, L'a') + L"/movie.swf";
+    size_t allocations = GetAllocationCount();
+    TEST_CHECK(Match(filter, longUrl, L"") == Result::Block);
+    TEST_CHECK(GetAllocationCount() == allocations);
+    TEST_CHECK(Match(filter, std::wstring(5000, L'a'), L"") == Result::NoMatch);
+}
+
+void TestOptions()
+{
+    ContentFilter filter(c_list);
+    TEST_CHECK(
+        Match(filter, L"https://cdn.tracker.net/t.js", L"https://news.com/") == Result::Block);
+    TEST_CHECK(
+        Match(filter, L"https://cdn.tracker.net/t.js", L"https://www.tracker.net/") ==
+        Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://cdn.tracker.net/t.js", L"") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://fp.com/x", L"https://www.fp.com/") == Result::Block);
+    TEST_CHECK(Match(filter, L"https://fp.com/x", L"https://other.com/") == Result::NoMatch);
+    // Sites under co.uk are two labels below it.
+    TEST_CHECK(
+        Match(filter, L"https://gtld.co.uk/x", L"https://www.gtld.co.uk/") == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://gtld.co.uk/x", L"https://other.co.uk/") == Result::Block);
+
+    const wchar_t adImage[] = L"https://img.test/ad.png";
+    TEST_CHECK(Match(filter, adImage, L"https://www.a.com/", ContentFilterImage) == Result::Block);
+    TEST_CHECK(
+        Match(filter, adImage, L"https://x.b.a.com/", ContentFilterImage) == Result::NoMatch);
+    TEST_CHECK(Match(filter, adImage, L"https://c.com/", ContentFilterImage) == Result::NoMatch);
+    TEST_CHECK(Match(filter, adImage, L"https://a.com/", ContentFilterScript) == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://x.com/a", L"", ContentFilterImage) == Result::NoMatch);
+    TEST_CHECK(Match(filter, L"https://x.com/a", L"", ContentFilterFont) == Result::Block);
+}
+
+// A page's own document is never blocked, though a frame's is, and the
+// document that made a request comes from its Referer or Origin header.
+void TestRequestSources()
+{
+    ContentFilter filter(c_list);
+    const wchar_t page[] = L"https://ads.example.com/index.html";
+    TEST_CHECK(Match(filter, page, L"", ContentFilterSubdocument) == Result::Block);
+    TEST_CHECK(Match(filter, page, L"", ContentFilterDocument) == Result::NoMatch);
+    TEST_CHECK(
+        Match(filter, page, L"https://other.com/", ContentFilterDocument) == Result::NoMatch);
+
+    const wchar_t tracker[] = L"https://cdn.tracker.net/t.js";
+    std::wstring frame(GetContentFilterDocumentUrl(L"https://news.com/frame.html", L""));
+    TEST_CHECK(frame == L"https://news.com/frame.html");
+    TEST_CHECK(Match(filter, tracker, frame) == Result::Block);
+    // Referer is preferred to Origin, which is only its site.
+    std::wstring sameSite(
+        GetContentFilterDocumentUrl(L"https://www.tracker.net/", L"https://news.com"));
+    TEST_CHECK(Match(filter, tracker, sameSite) == Result::NoMatch);
+    std::wstring origin(GetContentFilterDocumentUrl(L"", L"https://news.com"));
+    TEST_CHECK(origin == L"https://news.com");
+    TEST_CHECK(Match(filter, tracker, origin) == Result::Block);
+    TEST_CHECK(Match(filter, tracker, L"https://www.tracker.net") == Result::NoMatch);
+    TEST_CHECK(GetContentFilterDocumentUrl(L"", L"null").empty());
+    TEST_CHECK(GetContentFilterDocumentUrl(L"", L"").empty());
+}
+
+// Exceptions unblock requests, except those blocked by $important rules.
+void TestExceptions()
+{
+    ContentFilter filter(c_list);
+    const wchar_t adsScript[] = L"https://example.com/ads.js";
+    TEST_CHECK(Match(filter, adsScript, L"", ContentFilterScript) == Result::Exception);
+    TEST_CHECK(Match(filter, adsScript, L"", ContentFilterImage) == Result::Block);
+    TEST_CHECK(Match(filter, L"https://evil.org/x", L"") == Result::Block);
+    ContentFilter onlyException("@@||example.com^");
+    TEST_CHECK(Match(onlyException, adsScript, L"") == Result::NoMatch);
+}
+
+// A random rule without options, so that it can be checked by ReferenceMatch().
+std::string RandomRule(std::mt19937& random)
+{
+    const char* parts[] = {"ad", "ads", "banner", "x", "com",  "/",   ".",   "-",  "^",
+                           "*",  "?",   "=",      "&", "1",    "img", "track", "%20"};
+    std::string rule;
+    uint32_t anchor = random() % 3;
+    if (anchor == 0)
+    {
+        rule = "||";
+    }
+    else if (anchor == 1 && random() % 2)
+    {
+        rule = "|";
+    }
+    for (uint32_t i = 0, count = 1 + random() % 5; i < count; ++i)
+    {
+        rule += parts[random() % 17];
+    }
+    if (random() % 5 == 0)
+    {
+        rule += "|";
+    }
+    return rule;
+}
+
+std::string RandomUrl(std::mt19937& random)
+{
+    const char* parts[] = {"ad", "ads", "banner", "x", "com", "/",   ".", "-", "?",
+                           "=",  "&",   "1",      "img", "track", "%20", "_", ":"};
+    std::string url = "https://";
+    for (uint32_t i = 0, count = 1 + random() % 3; i < count; ++i)
+    {
+        url += (i ? "." : "") + std::string(parts[random() % 5]);
+    }
+    url += "/";
+    for (uint32_t i = 0, count = random() % 6; i < count; ++i)
+    {
+        url += parts[random() % 17];
+    }
+    return url;
+}
+
+// Random rules, alone and a hundred to a filter, agree with the reference
+// matcher on random URLs; so the index never loses a rule.
+void TestAgainstReference()
+{
+    std::mt19937 random(7);
+    int checked = 0;
+    int blocked = 0;
+    for (int round = 0; round < 1000; ++round)
+    {
+        std::string rule = RandomRule(random);
+        ContentFilter filter(rule);
+        if (filter.GetStats().blockingRules != 1)
+        {
+            continue;
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            std::string url = RandomUrl(random);
+            bool expected = ReferenceMatch(rule, url);
+            bool block = Match(filter, std::wstring(url.begin(), url.end()), L"") == Result::Block;
+            TEST_CHECK(block == expected);
+            if (block != expected)
+            {
+                std::fprintf(stderr, "  rule %s, URL %s\n", rule.c_str(), url.c_str());
+            }
+            ++checked;
+            blocked += block;
+        }
+    }
+    for (int round = 0; round < 50; ++round)
+    {
+        std::string list;
+        std::vector<std::string> rules;
+        for (int i = 0; i < 100; ++i)
+        {
+            std::string rule = RandomRule(random);
+            if (ContentFilter(rule).GetStats().blockingRules == 1)
+            {
+                list += rule + "\n";
+                rules.push_back(rule);
+            }
+        }
+        ContentFilter filter(list);
+        for (int i = 0; i < 100; ++i)
+        {
+            std::string url = RandomUrl(random);
+            bool expected = false;
+            for (const std::string& rule : rules)
+            {
+                expected = expected || ReferenceMatch(rule, url);
+            }
+            TEST_CHECK(
+                (Match(filter, std::wstring(url.begin(), url.end()), L"") == Result::Block) ==
+                expected);
+            ++checked;
+        }
+    }
+    std::printf("  %d checks against the reference matcher, %d blocked\n", checked, blocked);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestStats);
+    RUN_TEST(TestPatterns);
+    RUN_TEST(TestOptions);
+    RUN_TEST(TestRequestSources);
+    RUN_TEST(TestExceptions);
+    RUN_TEST(TestAgainstReference);
+    return ReportTestResults();
+}
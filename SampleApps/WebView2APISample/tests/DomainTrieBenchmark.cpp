@@ -0,0 +1,121 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Builds a DomainTrie from 100k random domains, writes it and maps it back in,
+// and looks up 1M hosts: a quarter under a blocked domain, a quarter blocked
+// domains themselves and half not blocked. Compares the lookups with the
+// linear suffix scan ShouldBlockUri did before, over a sample of the hosts.
+
+#include "DomainTrie.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t domainCount = Iterations(quick, 100000);
+    size_t hostCount = Iterations(quick, 1000000);
+    std::mt19937 random(42);
+    const char* topLevel[] = {"com", "net", "org", "io", "de", "co.uk", "ru", "info"};
+    auto word = [&]()
+    {
+        std::string text(4 + random() % 10, ' ');
+        for (char& c : text)
+        {
+            c = static_cast<char>('a' + random() % 26);
+        }
+        return text;
+    };
+    std::vector<std::string> domains;
+    for (size_t i = 0; i < domainCount; ++i)
+    {
+        std::string domain = word() + "." + topLevel[random() % 8];
+        domains.push_back(random() % 3 == 0 ? word() + "." + domain : domain);
+    }
+    std::vector<std::wstring> hosts;
+    for (size_t i = 0; i < hostCount; ++i)
+    {
+        uint32_t kind = random() % 4;
+        std::string host = kind == 0   ? "www." + domains[random() % domains.size()]
+                           : kind == 1 ? domains[random() % domains.size()]
+                                       : "cdn." + word() + "." + topLevel[random() % 8];
+        hosts.emplace_back(host.begin(), host.end());
+    }
+
+    DomainTrie trie;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (const std::string& domain : domains)
+            {
+                trie.Add(domain);
+            }
+        });
+    ReportRate("build, per domain", domains.size(), seconds);
+    std::printf(
+        "  %zu domains, %zu bytes, %.1f bytes per domain\n", trie.GetDomainCount(),
+        trie.GetMemoryUsage(), double(trie.GetMemoryUsage()) / trie.GetDomainCount());
+
+    const char path[] = "DomainTrieBenchmark.trie";
+    trie.Write(path);
+    std::unique_ptr<DomainTrie> mapped;
+    seconds = MeasureSeconds([&]() { mapped = DomainTrie::Open(path); });
+    ReportRate("open and check a written trie", 1, seconds);
+
+    size_t hits = 0;
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (const std::wstring& host : hosts)
+            {
+                hits += trie.Contains(host);
+            }
+        });
+    ReportRate("Contains", hosts.size(), seconds);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (const std::wstring& host : hosts)
+            {
+                hits += mapped->Contains(host);
+            }
+        });
+    ReportRate("Contains, mapped", hosts.size(), seconds);
+
+    std::vector<std::wstring> list;
+    for (const std::string& domain : domains)
+    {
+        list.emplace_back(domain.begin(), domain.end());
+    }
+    size_t scanned = quick ? hosts.size() : 2000;
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < scanned; ++i)
+            {
+                const std::wstring& host = hosts[i];
+                for (const std::wstring& domain : list)
+                {
+                    if (host.size() >= domain.size() &&
+                        host.compare(host.size() - domain.size(), domain.size(), domain) == 0 &&
+                        (host.size() == domain.size() ||
+                         host[host.size() - domain.size() - 1] == L'.'))
+                    {
+                        ++hits;
+                        break;
+                    }
+                }
+            }
+        });
+    ReportRate("linear suffix scan", scanned, seconds);
+    KeepResult(hits);
+    std::filesystem::remove(path);
+    return 0;
+}
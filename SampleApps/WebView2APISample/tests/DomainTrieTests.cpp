@@ -0,0 +1,241 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DomainTrie.h"
+
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "TestHarness.h"
+
+namespace
+{
+const char c_triePath[] = "DomainTrieTests.trie";
+const char c_corruptPath[] = "DomainTrieTests.corrupt.trie";
+
+std::string ToLower(std::string text)
+{
+    for (char& c : text)
+    {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// Whether host or a domain it is under is in domains, by trying each suffix.
+bool ContainsNaive(const std::set<std::string>& domains, std::string host)
+{
+    host = ToLower(host);
+    for (;;)
+    {
+        if (domains.count(host))
+        {
+            return true;
+        }
+        size_t dot = host.find('.');
+        if (dot == std::string::npos)
+        {
+            return false;
+        }
+        host = host.substr(dot + 1);
+    }
+}
+
+void TestAddAndContains()
+{
+    DomainTrie trie;
+    TEST_CHECK(trie.Add(L"Example.COM"));
+    TEST_CHECK(trie.Add(" *.ads.net "));
+    TEST_CHECK(trie.Add(".tracker.org."));
+    TEST_CHECK(!trie.Add(""));
+    TEST_CHECK(!trie.Add("a..b"));
+    TEST_CHECK(!trie.Add(std::string(256, 'a')));
+    TEST_CHECK(trie.Add(std::string(255, 'a')));
+    TEST_CHECK(trie.GetDomainCount() == 4);
+
+    TEST_CHECK(trie.Contains(L"example.com"));
+    TEST_CHECK(trie.Contains(L"WWW.example.com."));
+    TEST_CHECK(!trie.Contains(L"badexample.com"));
+    TEST_CHECK(!trie.Contains(L"com"));
+    TEST_CHECK(trie.Contains(L"x.y.ads.net"));
+    TEST_CHECK(trie.Contains("tracker.org"));
+    TEST_CHECK(!trie.Contains(L""));
+    TEST_CHECK(!trie.Contains(L"."));
+    TEST_CHECK(!trie.Contains(L"example..org"));
+
+    // Domains that aren't ASCII are kept as the Punycode that Url gives hosts.
+    TEST_CHECK(trie.Add(L"bücher.de"));
+    TEST_CHECK(trie.Contains("www.xn--bcher-kva.de"));
+    TEST_CHECK(trie.Contains(L"www.bücher.DE"));
+    TEST_CHECK(trie.Contains(L"www.BÜCHER.de"));
+    TEST_CHECK(!trie.Contains(L"www.bucher.de"));
+    std::vector<std::wstring> domains = trie.GetDomains();
+    TEST_CHECK(domains.size() == 5);
+    TEST_CHECK(
+        std::set<std::wstring>(domains.begin(), domains.end()).count(L"xn--bcher-kva.de") == 1);
+    TEST_CHECK(!trie.Add(L"bücher.de/path") && !trie.Add(L"bücher.de:80"));
+
+    // Lookups don't allocate, with either width.
+    size_t allocations = GetAllocationCount();
+    bool found = trie.Contains(L"a.b.c.www.example.com") && trie.Contains("q.ads.net") &&
+                 !trie.Contains(L"nothing.example.org");
+    TEST_CHECK(found && GetAllocationCount() == allocations);
+}
+
+// A domain that is removed stops blocking, but domains added under it stay.
+void TestRemove()
+{
+    DomainTrie trie;
+    TEST_CHECK(trie.Add(L"example.com") && trie.Add(L"www.example.com"));
+    TEST_CHECK(trie.Remove(L"Example.com"));
+    TEST_CHECK(!trie.Remove(L"example.com"));
+    TEST_CHECK(!trie.Remove(L"other.com"));
+    TEST_CHECK(!trie.Contains(L"example.com") && !trie.Contains(L"mail.example.com"));
+    TEST_CHECK(trie.Contains(L"a.www.example.com"));
+    TEST_CHECK(trie.GetDomainCount() == 1);
+    TEST_CHECK(trie.Add(L"example.com") && trie.Contains(L"mail.example.com"));
+
+    // An IDN is removed by its Unicode or its Punycode form.
+    TEST_CHECK(trie.Add("\xEF\xBD\x82\xC3\xBC\x63her.de"));
+    TEST_CHECK(trie.Contains("xn--bcher-kva.de"));
+    TEST_CHECK(trie.Remove(L"BÜCHER.de") && !trie.Contains("xn--bcher-kva.de"));
+    TEST_CHECK(trie.Add(L"bücher.de") && trie.Remove(L"xn--bcher-kva.de"));
+    trie.Clear();
+    TEST_CHECK(trie.GetDomainCount() == 0 && !trie.Contains(L"www.example.com"));
+}
+
+// A written trie maps back in, and is copied the first time it is changed.
+void TestWriteAndOpen()
+{
+    DomainTrie trie;
+    TEST_CHECK(trie.Add("www.example.com") && trie.Add("ads.net") && trie.Add("tracker.org"));
+    TEST_CHECK(trie.Write(c_triePath));
+    std::unique_ptr<DomainTrie> mapped = DomainTrie::Open(c_triePath);
+    TEST_CHECK(mapped);
+    if (!mapped)
+    {
+        return;
+    }
+    TEST_CHECK(mapped->GetDomainCount() == 3 && mapped->GetMemoryUsage() > 0);
+    TEST_CHECK(mapped->Contains(L"a.www.example.com") && mapped->Contains("q.ads.net"));
+    TEST_CHECK(!mapped->Contains(L"example.com"));
+
+    DomainTrie moved = std::move(*mapped);
+    mapped.reset();
+    TEST_CHECK(moved.Contains(L"q.ads.net"));
+    TEST_CHECK(moved.Add("new.io") && moved.Contains(L"new.io") && moved.Contains(L"q.ads.net"));
+    TEST_CHECK(moved.Remove(L"ads.net") && !moved.Contains(L"q.ads.net"));
+    // The file is unchanged.
+    std::unique_ptr<DomainTrie> reopened = DomainTrie::Open(c_triePath);
+    TEST_CHECK(reopened && reopened->Contains(L"q.ads.net") && !reopened->Contains(L"new.io"));
+    TEST_CHECK(!DomainTrie::Open("DomainTrieTests.missing.trie"));
+}
+
+// Random adds and removes of domains over a few labels, checked against the
+// naive suffix check, in memory and mapped.
+void TestRandomLists()
+{
+    std::mt19937 random(1);
+    const char* labels[] = {"a", "b", "com", "net", "x", "ads", "Www", "org", "io", "cdn"};
+    auto randomDomain = [&]()
+    {
+        std::string domain;
+        for (uint32_t i = 0, count = 1 + random() % 4; i < count; ++i)
+        {
+            domain += (i ? "." : "") + std::string(labels[random() % 10]);
+        }
+        return domain;
+    };
+    for (int round = 0; round < 200; ++round)
+    {
+        DomainTrie trie;
+        std::set<std::string> domains;
+        for (int i = 0; i < 50; ++i)
+        {
+            std::string domain = randomDomain();
+            if (random() % 4 == 0)
+            {
+                TEST_CHECK(
+                    trie.Remove(std::wstring(domain.begin(), domain.end())) ==
+                    (domains.erase(ToLower(domain)) == 1));
+            }
+            else
+            {
+                trie.Add(domain);
+                domains.insert(ToLower(domain));
+            }
+        }
+        TEST_CHECK(trie.GetDomainCount() == domains.size());
+        TEST_CHECK(trie.Write(c_triePath));
+        std::unique_ptr<DomainTrie> mapped = DomainTrie::Open(c_triePath);
+        TEST_CHECK(mapped);
+        for (int i = 0; i < 200 && mapped; ++i)
+        {
+            std::string host = randomDomain();
+            bool expected = ContainsNaive(domains, host);
+            TEST_CHECK(trie.Contains(std::wstring(host.begin(), host.end())) == expected);
+            TEST_CHECK(mapped->Contains(host) == expected);
+        }
+    }
+}
+
+// Every truncation of a trie file is rejected, and every file with a flipped
+// bit is either rejected or safe to use.
+void TestCorruption()
+{
+    DomainTrie trie;
+    for (const char* domain : {"www.example.com", "ads.net", "tracker.org", "bücher.de"})
+    {
+        trie.Add(domain);
+    }
+    TEST_CHECK(trie.Write(c_triePath));
+    std::ifstream file(c_triePath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)), {});
+    for (size_t size = 0; size < bytes.size(); ++size)
+    {
+        std::ofstream(c_corruptPath, std::ios::binary | std::ios::trunc) << bytes.substr(0, size);
+        TEST_CHECK(!DomainTrie::Open(c_corruptPath));
+    }
+    int opened = 0;
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            std::string copy = bytes;
+            copy[i] ^= static_cast<char>(1 << bit);
+            std::ofstream(c_corruptPath, std::ios::binary | std::ios::trunc) << copy;
+            std::unique_ptr<DomainTrie> corrupt = DomainTrie::Open(c_corruptPath);
+            if (corrupt)
+            {
+                ++opened;
+                corrupt->Contains(L"a.www.example.com");
+                corrupt->Contains("zz.q.ads.net");
+                corrupt->GetDomains();
+                corrupt->Add("new.io");
+            }
+        }
+    }
+    std::printf("  %d of %zu files with a flipped bit opened\n", opened, bytes.size() * 8);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestAddAndContains);
+    RUN_TEST(TestRemove);
+    RUN_TEST(TestWriteAndOpen);
+    RUN_TEST(TestRandomLists);
+    RUN_TEST(TestCorruption);
+    std::filesystem::remove(c_triePath);
+    std::filesystem::remove(c_corruptPath);
+    return ReportTestResults();
+}
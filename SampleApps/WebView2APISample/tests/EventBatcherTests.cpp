@@ -0,0 +1,183 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventBatcher.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "TestHarness.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+struct Batch
+{
+    uint64_t first;
+    size_t count;
+    uint64_t dropped;
+};
+
+// An EventBatcher with a clock that only moves when told to, and a sink that
+// keeps the batches it is sent.
+struct FakeReceiver
+{
+    explicit FakeReceiver(EventBatcher::Options options)
+        : batcher(
+              options,
+              [this](uint64_t first, size_t count, uint64_t dropped)
+              { batches.push_back({first, count, dropped}); },
+              [this]() { return now; })
+    {
+    }
+
+    bool LastBatchIs(uint64_t first, size_t count, uint64_t dropped) const
+    {
+        return !batches.empty() && batches.back().first == first &&
+               batches.back().count == count && batches.back().dropped == dropped;
+    }
+
+    std::chrono::steady_clock::time_point now{};
+    std::vector<Batch> batches;
+    EventBatcher batcher;
+};
+
+EventBatcher::Options MakeOptions()
+{
+    EventBatcher::Options options;
+    options.flushInterval = 16ms;
+    options.maxBatchEvents = 4;
+    return options;
+}
+
+// A request is answered on the first tick after the flush interval.
+void TestFlushesOnTick()
+{
+    FakeReceiver receiver(MakeOptions());
+    receiver.batcher.OnRangeRequested(0);
+    receiver.batcher.OnEventsAvailable(0, 2);
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.empty());
+
+    receiver.now += 15ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.empty());
+
+    receiver.now += 1ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.size() == 1);
+    TEST_CHECK(receiver.LastBatchIs(0, 2, 0));
+    TEST_CHECK(!receiver.batcher.HasPendingRequest());
+}
+
+// Nothing is sent without a request, or when there is nothing new.
+void TestWaitsForRequestAndEvents()
+{
+    FakeReceiver receiver(MakeOptions());
+    receiver.batcher.OnEventsAvailable(0, 3);
+    receiver.now += 100ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.empty());
+
+    receiver.batcher.OnRangeRequested(3);
+    receiver.now += 100ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.empty());
+    TEST_CHECK(receiver.batcher.HasPendingRequest());
+
+    receiver.batcher.OnEventsAvailable(0, 4);
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.LastBatchIs(3, 1, 0));
+}
+
+// A full batch is sent right away, whether it fills up while the request is
+// outstanding or is already there when the request comes.
+void TestFullBatchIsSentImmediately()
+{
+    FakeReceiver receiver(MakeOptions());
+    receiver.batcher.OnRangeRequested(0);
+    receiver.batcher.OnEventsAvailable(0, 3);
+    TEST_CHECK(receiver.batches.empty());
+    receiver.batcher.OnEventsAvailable(0, 10);
+    TEST_CHECK(receiver.LastBatchIs(0, 4, 0));
+
+    receiver.batcher.OnRangeRequested(4);
+    TEST_CHECK(receiver.LastBatchIs(4, 4, 0));
+
+    receiver.batcher.OnRangeRequested(8);
+    TEST_CHECK(receiver.batches.size() == 2);
+    receiver.now += 16ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.LastBatchIs(8, 2, 0));
+}
+
+// Events that were overwritten before the receiver asked for them are
+// reported as dropped, and the batch starts at the oldest one left.
+void TestReportsDroppedEvents()
+{
+    FakeReceiver receiver(MakeOptions());
+    receiver.batcher.OnEventsAvailable(0, 2);
+    receiver.batcher.OnRangeRequested(0);
+    receiver.now += 16ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.LastBatchIs(0, 2, 0));
+
+    receiver.batcher.OnEventsAvailable(5, 7);
+    receiver.batcher.OnRangeRequested(2);
+    receiver.now += 16ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.LastBatchIs(5, 2, 3));
+    TEST_CHECK(receiver.batcher.GetDroppedCount() == 3);
+
+    receiver.batcher.OnEventsAvailable(100, 200);
+    receiver.batcher.OnRangeRequested(7);
+    TEST_CHECK(receiver.LastBatchIs(100, 4, 93));
+    TEST_CHECK(receiver.batcher.GetDroppedCount() == 96);
+}
+
+// Flush() answers at once, and a flush restarts the interval.
+void TestFlushRestartsInterval()
+{
+    FakeReceiver receiver(MakeOptions());
+    receiver.batcher.OnEventsAvailable(0, 1);
+    receiver.batcher.OnRangeRequested(0);
+    receiver.now += 10ms;
+    receiver.batcher.Flush();
+    TEST_CHECK(receiver.LastBatchIs(0, 1, 0));
+
+    receiver.batcher.OnEventsAvailable(0, 2);
+    receiver.batcher.OnRangeRequested(1);
+    receiver.now += 10ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.batches.size() == 1);
+    receiver.now += 6ms;
+    receiver.batcher.OnTick();
+    TEST_CHECK(receiver.LastBatchIs(1, 1, 0));
+}
+
+// A batch size of zero is treated as one.
+void TestZeroBatchSize()
+{
+    EventBatcher::Options options = MakeOptions();
+    options.maxBatchEvents = 0;
+    FakeReceiver receiver(options);
+    TEST_CHECK(receiver.batcher.GetOptions().maxBatchEvents == 1);
+    receiver.batcher.OnEventsAvailable(0, 5);
+    receiver.batcher.OnRangeRequested(0);
+    TEST_CHECK(receiver.LastBatchIs(0, 1, 0));
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestFlushesOnTick);
+    RUN_TEST(TestWaitsForRequestAndEvents);
+    RUN_TEST(TestFullBatchIsSentImmediately);
+    RUN_TEST(TestReportsDroppedEvents);
+    RUN_TEST(TestFlushRestartsInterval);
+    RUN_TEST(TestZeroBatchSize);
+    return ReportTestResults();
+}
@@ -0,0 +1,257 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Pushes millions of synthetic WebResourceRequested events through an
+// EventRing and a StringInterner the way the event monitor records them, then
+// renders JSON only for the newest batch, as the event view asks for it. For
+// comparison, it also renders every event as it is recorded, which is what the
+// monitor did before the ring.
+
+#include "EventRing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JsonWriter.h"
+#include "MonitorEvent.h"
+#include "StringInterner.h"
+
+namespace
+{
+constexpr size_t c_ringCapacity = 1 << 16;
+constexpr size_t c_batchEvents = 256;
+
+struct Session
+{
+    std::vector<std::wstring> uris;
+    std::vector<std::wstring> headers;
+};
+
+Session MakeSession()
+{
+    Session session;
+    for (int i = 0; i < 50000; ++i)
+    {
+        session.uris.push_back(
+            L"https://www.example.com/assets/" + std::to_wstring(i % 97) + L"/resource-" +
+            std::to_wstring(i) + L".js?v=20240131");
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        session.headers.push_back(
+            L"[{\"name\":\"Accept\",\"value\":\"*/*\"},{\"name\":\"Referer\",\"value\":"
+            L"\"https://www.example.com/page" +
+            std::to_wstring(i) +
+            L"\"},{\"name\":\"User-Agent\",\"value\":\"Mozilla/5.0 (Windows NT 10.0; Win64; "
+            L"x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\"}]");
+    }
+    return session;
+}
+
+// The strings of the events [first, first + count), copied out of the session.
+// An event handler interns strings it has just been handed, which are in the
+// cache, so the session's strings are staged outside the measured time rather
+// than read at random from a table larger than the cache.
+struct StagedEvents
+{
+    uint64_t first = 0;
+    size_t count = 0;
+    std::vector<std::wstring> uris = std::vector<std::wstring>(c_batchEvents);
+    std::vector<std::wstring> headers = std::vector<std::wstring>(c_batchEvents);
+
+    void Stage(const Session& session, uint64_t firstEvent, size_t eventCount)
+    {
+        first = firstEvent;
+        count = eventCount;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t event = first + i;
+            uris[i] = session.uris[(event * 7919) % session.uris.size()];
+            headers[i] = session.headers[event % session.headers.size()];
+        }
+    }
+};
+
+// Stages the events in batches and returns the time spent in record for them.
+template <typename RecordFunction>
+double MeasureRecording(const Session& session, size_t events, RecordFunction&& record)
+{
+    StagedEvents staged;
+    double seconds = 0;
+    for (uint64_t first = 0; first < events; first += c_batchEvents)
+    {
+        staged.Stage(session, first, (std::min)(c_batchEvents, size_t(events - first)));
+        seconds += MeasureSeconds(
+            [&]()
+            {
+                for (size_t i = 0; i < staged.count; ++i)
+                {
+                    record(staged.first + i, staged.uris[i], staged.headers[i]);
+                }
+            });
+    }
+    return seconds;
+}
+
+// Records events as the monitor does, releasing each interner generation once
+// the ring no longer holds any record that refers to it. The interner is
+// smaller than the monitor's so that generations turn over in the run.
+class Recorder
+{
+public:
+    Recorder() : m_ring(c_ringCapacity), m_strings(1 << 20) {}
+
+    void Record(uint64_t i, std::wstring_view uri, std::wstring_view headers)
+    {
+        MonitorEventRecord record = {};
+        record.timestamp = static_cast<int64_t>(i);
+        record.navigationId = i / 50;
+        record.kind = MonitorEventKind::WebResourceRequested;
+        record.uriId = Intern(uri);
+        record.headersId = Intern(headers);
+        record.argsId = Intern(L"GET");
+        uint64_t sequence = m_ring.Push(record);
+        if (m_strings.GetGeneration() != m_recordedGeneration)
+        {
+            m_recordedGeneration = m_strings.GetGeneration();
+            m_releases.push_back({m_recordedGeneration, sequence});
+        }
+        while (!m_releases.empty() && m_releases.front().sequence <= m_ring.Begin())
+        {
+            m_strings.ReleaseGenerationsBefore(m_releases.front().generation);
+            m_releases.pop_front();
+        }
+    }
+
+    void Render(JsonWriter& json, const MonitorEventRecord& record)
+    {
+        json.BeginObject();
+        json.Key(L"kind").String(L"event");
+        json.Key(L"name").String(MonitorEventKindToString(record.kind));
+        json.Key(L"args").BeginObject();
+        json.Key(L"request").BeginObject();
+        json.Key(L"content").Null();
+        json.Key(L"headers");
+        WriteString(json, record.headersId, true);
+        json.Key(L"method");
+        WriteString(json, record.argsId, false);
+        json.Key(L"uri");
+        WriteString(json, record.uriId, false);
+        json.EndObject();
+        json.Key(L"response").Null();
+        json.EndObject();
+        json.EndObject();
+    }
+
+    const EventRing<MonitorEventRecord>& GetRing() const { return m_ring; }
+    uint64_t GetFailedInterns() const { return m_failedInterns; }
+    uint64_t GetGenerationCount() const { return m_strings.GetGeneration() + 1; }
+
+private:
+    struct Release
+    {
+        uint64_t generation;
+        uint64_t sequence;
+    };
+
+    uint32_t Intern(std::wstring_view value)
+    {
+        uint32_t id = m_strings.Intern(value);
+        m_failedInterns += id == StringInterner::c_noString;
+        return id;
+    }
+
+    void WriteString(JsonWriter& json, uint32_t id, bool isJson)
+    {
+        std::wstring_view value;
+        if (!m_strings.TryGet(id, &value))
+        {
+            json.Null();
+        }
+        else if (isJson)
+        {
+            json.RawValue(value);
+        }
+        else
+        {
+            json.String(value);
+        }
+    }
+
+    EventRing<MonitorEventRecord> m_ring;
+    StringInterner m_strings;
+    uint64_t m_recordedGeneration = 0;
+    std::deque<Release> m_releases;
+    uint64_t m_failedInterns = 0;
+};
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t events = Iterations(IsQuickRun(argc, argv), 5000000);
+    Session session = MakeSession();
+    JsonWriter json;
+    size_t length = 0;
+
+    Recorder recorder;
+    double seconds = MeasureRecording(
+        session, events,
+        [&](uint64_t i, std::wstring_view uri, std::wstring_view headers)
+        { recorder.Record(i, uri, headers); });
+    ReportRate("record (intern + push)", events, seconds);
+
+    // The view asks for one batch at a time; render the newest ones.
+    const EventRing<MonitorEventRecord>& ring = recorder.GetRing();
+    size_t rendered = 0;
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (uint64_t first = ring.Begin(); first + c_batchEvents <= ring.End();
+                 first += c_batchEvents)
+            {
+                json.Reset();
+                json.BeginArray();
+                for (uint64_t sequence = first; sequence < first + c_batchEvents; ++sequence)
+                {
+                    MonitorEventRecord record;
+                    if (ring.TryRead(sequence, &record))
+                    {
+                        recorder.Render(json, record);
+                        ++rendered;
+                    }
+                }
+                json.EndArray();
+                length += json.GetString().size();
+            }
+        });
+    ReportRate("render a requested batch, per event", rendered, seconds);
+
+    // What recording cost when every event was rendered as it happened.
+    Recorder eager;
+    seconds = MeasureRecording(
+        session, events,
+        [&](uint64_t i, std::wstring_view uri, std::wstring_view headers)
+        {
+            eager.Record(i, uri, headers);
+            MonitorEventRecord record;
+            if (eager.GetRing().TryRead(i, &record))
+            {
+                json.Reset();
+                eager.Render(json, record);
+                length += json.GetString().size();
+            }
+        });
+    ReportRate("record and render every event", events, seconds);
+    KeepResult(length);
+
+    std::printf(
+        "  %llu interner generations, %llu failed interns\n",
+        static_cast<unsigned long long>(recorder.GetGenerationCount()),
+        static_cast<unsigned long long>(recorder.GetFailedInterns()));
+    return recorder.GetFailedInterns() == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventRing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "TestHarness.h"
+
+namespace
+{
+struct Record
+{
+    uint64_t sequence;
+    uint64_t doubled;
+    int64_t negated;
+};
+
+Record MakeRecord(uint64_t sequence)
+{
+    return {sequence, sequence * 2, -static_cast<int64_t>(sequence)};
+}
+
+void TestCapacityIsRoundedUp()
+{
+    TEST_CHECK(EventRing<Record>(1).Capacity() == 1);
+    TEST_CHECK(EventRing<Record>(5).Capacity() == 8);
+    TEST_CHECK(EventRing<Record>(64).Capacity() == 64);
+}
+
+void TestPushAndRead()
+{
+    EventRing<Record> ring(4);
+    Record record;
+    TEST_CHECK(ring.Begin() == 0 && ring.End() == 0);
+    TEST_CHECK(!ring.TryRead(0, &record));
+
+    for (uint64_t sequence = 0; sequence < 3; ++sequence)
+    {
+        TEST_CHECK(ring.Push(MakeRecord(sequence)) == sequence);
+    }
+    TEST_CHECK(ring.Begin() == 0 && ring.End() == 3);
+    TEST_CHECK(ring.TryRead(2, &record) && record.doubled == 4);
+    TEST_CHECK(!ring.TryRead(3, &record));
+}
+
+// Once full, each push overwrites the oldest record.
+void TestOverwritesOldest()
+{
+    EventRing<Record> ring(4);
+    for (uint64_t sequence = 0; sequence < 10; ++sequence)
+    {
+        ring.Push(MakeRecord(sequence));
+    }
+    TEST_CHECK(ring.Begin() == 6 && ring.End() == 10);
+    Record record;
+    TEST_CHECK(!ring.TryRead(5, &record));
+    for (uint64_t sequence = 6; sequence < 10; ++sequence)
+    {
+        TEST_CHECK(ring.TryRead(sequence, &record) && record.sequence == sequence);
+    }
+    // The slot of 10 holds 6, which mustn't be returned for 10 or 2.
+    TEST_CHECK(!ring.TryRead(10, &record));
+    TEST_CHECK(!ring.TryRead(2, &record));
+}
+
+// Readers on other threads never see a record that was torn by the producer
+// overwriting it while they copied it.
+void TestConcurrentReadersSeeWholeRecords()
+{
+    constexpr uint64_t c_pushes = 1000000;
+    EventRing<Record> ring(64);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> torn{0};
+    std::atomic<uint64_t> reads{0};
+
+    auto read = [&]()
+    {
+        uint64_t localReads = 0;
+        // A last pass after the producer is done, so that a reader that only
+        // starts then still reads the records left in the ring.
+        for (bool last = false; !last;)
+        {
+            last = done.load(std::memory_order_acquire);
+            uint64_t end = ring.End();
+            for (uint64_t sequence = ring.Begin(); sequence < end; ++sequence)
+            {
+                Record record;
+                if (ring.TryRead(sequence, &record))
+                {
+                    ++localReads;
+                    if (record.sequence != sequence || record.doubled != sequence * 2 ||
+                        record.negated != -static_cast<int64_t>(sequence))
+                    {
+                        torn.fetch_add(1);
+                    }
+                }
+            }
+        }
+        reads.fetch_add(localReads);
+    };
+    std::thread reader1(read);
+    std::thread reader2(read);
+    for (uint64_t sequence = 0; sequence < c_pushes; ++sequence)
+    {
+        ring.Push(MakeRecord(sequence));
+    }
+    done.store(true, std::memory_order_release);
+    reader1.join();
+    reader2.join();
+
+    TEST_CHECK(torn.load() == 0);
+    TEST_CHECK(reads.load() > 0);
+    TEST_CHECK(ring.End() == c_pushes);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestCapacityIsRoundedUp);
+    RUN_TEST(TestPushAndRead);
+    RUN_TEST(TestOverwritesOldest);
+    RUN_TEST(TestConcurrentReadersSeeWholeRecords);
+    return ReportTestResults();
+}
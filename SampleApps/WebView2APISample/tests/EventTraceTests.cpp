@@ -0,0 +1,243 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "EventTrace.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MonitorEvent.h"
+#include "TestHarness.h"
+
+namespace
+{
+// Also read by the EventTraceTool test.
+const char c_tracePath[] = "EventTraceTests.trace";
+const char c_damagedPath[] = "EventTraceTests.damaged.trace";
+constexpr uint64_t c_eventCount = 5000;
+
+std::wstring MakeUri(uint64_t sequence)
+{
+    return L"https://example.com/page" + std::to_wstring(sequence) + L"/é";
+}
+
+std::string ExpectedUri(uint64_t sequence)
+{
+    return "https://example.com/page" + std::to_string(sequence) + "/\xc3\xa9";
+}
+
+bool WriteTrace(const char* path)
+{
+    EventTraceWriter writer;
+    if (!writer.Open(path))
+    {
+        return false;
+    }
+    for (uint64_t i = 0; i < c_eventCount; ++i)
+    {
+        EventTraceEvent event = {};
+        event.timestamp = static_cast<int64_t>(i) * 1500;
+        event.navigationId = i / 10;
+        event.kind = static_cast<uint16_t>(
+            i % 3 == 0 ? MonitorEventKind::NavigationStarting
+                       : MonitorEventKind::WebResourceRequested);
+        std::wstring json = L"{\"kind\":\"event\",\"i\":" + std::to_wstring(i) + L"}";
+        if (!writer.Append(event, MakeUri(i), json))
+        {
+            return false;
+        }
+    }
+    writer.Close();
+    return true;
+}
+
+std::vector<char> ReadFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const char* path, const std::vector<char>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+// Read every event from the given sequence number on, checking that each is
+// the one that was written. Returns the number read.
+uint64_t ReadFrom(const EventTraceReader& reader, uint64_t sequence, bool* allMatch)
+{
+    uint64_t offset = reader.Seek(sequence);
+    EventTraceEntry entry;
+    uint64_t count = 0;
+    while (reader.Next(&offset, &entry))
+    {
+        uint64_t expected = sequence + count;
+        *allMatch = *allMatch && entry.event.sequence == expected &&
+                    entry.uri == ExpectedUri(expected) &&
+                    entry.json == "{\"kind\":\"event\",\"i\":" + std::to_string(expected) + "}";
+        ++count;
+    }
+    return count;
+}
+
+void TestRoundTrip()
+{
+    TEST_CHECK(WriteTrace(c_tracePath));
+    EventTraceReader reader;
+    TEST_CHECK(reader.Open(c_tracePath));
+    TEST_CHECK(reader.GetEventCount() == c_eventCount);
+
+    bool allMatch = true;
+    TEST_CHECK(ReadFrom(reader, 0, &allMatch) == c_eventCount);
+    TEST_CHECK(allMatch);
+}
+
+// Seeking lands on the event asked for, through the index blocks and in the
+// events after the last one.
+void TestSeek()
+{
+    EventTraceReader reader;
+    TEST_CHECK(reader.Open(c_tracePath));
+    for (uint64_t sequence :
+         {uint64_t(1), uint64_t(c_eventTraceIndexInterval - 1), uint64_t(c_eventTraceIndexInterval),
+          uint64_t(3000), uint64_t(4095), uint64_t(4096), c_eventCount - 1})
+    {
+        bool allMatch = true;
+        TEST_CHECK(ReadFrom(reader, sequence, &allMatch) == c_eventCount - sequence);
+        TEST_CHECK(allMatch);
+    }
+    EventTraceEntry entry;
+    uint64_t offset = reader.Seek(c_eventCount);
+    TEST_CHECK(!reader.Next(&offset, &entry));
+}
+
+void TestRejectsOtherFiles()
+{
+    EventTraceReader reader;
+    TEST_CHECK(!reader.Open("EventTraceTests.missing"));
+    WriteFile(c_damagedPath, std::vector<char>(100, 'x'));
+    TEST_CHECK(!reader.Open(c_damagedPath));
+}
+
+// A trace cut off by a crash, with unwritten bytes after the committed size,
+// is readable up to the last committed event.
+void TestReadsUpToCommittedSize()
+{
+    std::vector<char> bytes = ReadFile(c_tracePath);
+    EventTraceReader reader;
+    TEST_CHECK(reader.Open(c_tracePath));
+    uint64_t offset = reader.Seek(1234);
+
+    EventTraceFileHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    header.committedSize = offset;
+    header.eventCount = 1234;
+    memcpy(bytes.data(), &header, sizeof(header));
+    std::fill(bytes.begin() + offset, bytes.end(), '\xcd');
+    WriteFile(c_damagedPath, bytes);
+
+    EventTraceReader damaged;
+    TEST_CHECK(damaged.Open(c_damagedPath));
+    bool allMatch = true;
+    TEST_CHECK(ReadFrom(damaged, 0, &allMatch) == 1234);
+    TEST_CHECK(allMatch);
+    TEST_CHECK(ReadFrom(damaged, 1000, &allMatch) == 234);
+    TEST_CHECK(allMatch);
+}
+
+// An index block that points at itself falls back to scanning instead of
+// looping.
+void TestIndexLoop()
+{
+    std::vector<char> bytes = ReadFile(c_tracePath);
+    EventTraceFileHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    EventTraceIndex index;
+    size_t indexOffset = header.lastIndexOffset + sizeof(EventTraceBlockHeader);
+    memcpy(&index, bytes.data() + indexOffset, sizeof(index));
+    index.previousIndexOffset = header.lastIndexOffset;
+    memcpy(bytes.data() + indexOffset, &index, sizeof(index));
+    WriteFile(c_damagedPath, bytes);
+
+    EventTraceReader reader;
+    TEST_CHECK(reader.Open(c_damagedPath));
+    bool allMatch = true;
+    TEST_CHECK(ReadFrom(reader, 10, &allMatch) == c_eventCount - 10);
+    TEST_CHECK(allMatch);
+}
+
+// Shortened and corrupted traces are either rejected or read without reading
+// outside the file; AddressSanitizer catches anything else.
+void TestDamagedTraces()
+{
+    const std::vector<char> bytes = ReadFile(c_tracePath);
+    std::mt19937 random(5);
+    for (int iteration = 0; iteration < 200; ++iteration)
+    {
+        std::vector<char> damaged = bytes;
+        if (iteration % 2 == 0)
+        {
+            damaged.resize(random() % bytes.size());
+        }
+        for (int flip = 0; flip < 20; ++flip)
+        {
+            if (!damaged.empty())
+            {
+                damaged[random() % damaged.size()] = static_cast<char>(random());
+            }
+        }
+        WriteFile(c_damagedPath, damaged);
+
+        EventTraceReader reader;
+        if (!reader.Open(c_damagedPath))
+        {
+            continue;
+        }
+        for (uint64_t sequence : {uint64_t(0), uint64_t(2500), c_eventCount - 1})
+        {
+            uint64_t offset = reader.Seek(sequence);
+            EventTraceEntry entry;
+            uint64_t count = 0;
+            while (count <= c_eventCount && reader.Next(&offset, &entry))
+            {
+                ++count;
+            }
+            TEST_CHECK(count <= c_eventCount);
+        }
+    }
+    std::filesystem::remove(c_damagedPath);
+}
+
+void TestWriteUtf8()
+{
+    char out[64];
+    std::wstring value = L"aé€";
+    size_t size = WriteUtf8(value, out);
+    TEST_CHECK(std::string(out, size) == "a\xc3\xa9\xe2\x82\xac");
+
+    // A surrogate pair, and an unpaired surrogate.
+    std::wstring surrogates = {wchar_t(0xD83D), wchar_t(0xDE00), wchar_t(0xDC00), L'x'};
+    size = WriteUtf8(surrogates, out);
+    TEST_CHECK(std::string(out, size) == "\xf0\x9f\x98\x80\xef\xbf\xbdx");
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestSeek);
+    RUN_TEST(TestRejectsOtherFiles);
+    RUN_TEST(TestReadsUpToCommittedSize);
+    RUN_TEST(TestIndexLoop);
+    RUN_TEST(TestDamagedTraces);
+    RUN_TEST(TestWriteUtf8);
+    return ReportTestResults();
+}
@@ -0,0 +1,335 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Size and encode time of the batches the event monitor posts to the event
+// view for a 100k-event browsing session, in each of the wire formats it has
+// used. It fails unless the current format sends at least 5 times fewer bytes
+// than the inline one.
+//
+// The session is synthetic: each page load fires the navigation events with
+// the WebView's title and source, then 40 subresource requests and responses
+// that share the page's request headers and the site's response headers.
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JsonWriter.h"
+#include "MonitorEvent.h"
+#include "StringInterner.h"
+
+namespace
+{
+constexpr size_t c_sessionEvents = 100000;
+constexpr size_t c_batchEvents = 256;
+constexpr size_t c_minStringRefLength = 16;
+constexpr size_t c_resourcesPerPage = 40;
+
+std::wstring HeadersJson(const std::wstring& referer, const std::wstring& accept)
+{
+    return L"[{\"name\":\"Accept\",\"value\":\"" + accept +
+           L"\"},{\"name\":\"Accept-Language\",\"value\":\"en-US,en;q=0.9\"},"
+           L"{\"name\":\"Referer\",\"value\":\"" +
+           referer +
+           L"\"},{\"name\":\"User-Agent\",\"value\":\"Mozilla/5.0 (Windows NT 10.0; Win64; "
+           L"x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36 "
+           L"Edg/120.0.0.0\"},{\"name\":\"sec-ch-ua\",\"value\":\"\\\"Chromium\\\";v=\\\"120\\\""
+           L"\"}]";
+}
+
+std::vector<MonitorEventRecord> RecordSession(StringInterner& strings)
+{
+    std::vector<MonitorEventRecord> session;
+    const uint32_t response = strings.Intern(
+        L"{\"headers\":[\"Cache-Control: max-age=31536000\",\"Content-Encoding: br\","
+        L"\"Server: ExampleServer/1.0\"],\"reasonPhrase\":\"OK\",\"statusCode\":200}");
+    const uint32_t get = strings.Intern(L"GET");
+    for (uint64_t page = 0; session.size() < c_sessionEvents; ++page)
+    {
+        std::wstring pageUri = L"https://www.example.com/articles/" +
+                               std::to_wstring(page % 300) + L"/a-long-and-descriptive-slug";
+        MonitorEventRecord navigation = {};
+        navigation.navigationId = page;
+        navigation.uriId = strings.Intern(pageUri);
+        navigation.headersId =
+            strings.Intern(HeadersJson(L"https://www.example.com/", L"text/html"));
+        navigation.titleId =
+            strings.Intern(L"Article " + std::to_wstring(page % 300) + L" - Example News");
+        navigation.sourceId = navigation.uriId;
+        navigation.flags = c_monitorEventHasWebView | c_monitorEventCanGoBack;
+        for (MonitorEventKind kind :
+             {MonitorEventKind::NavigationStarting, MonitorEventKind::SourceChanged,
+              MonitorEventKind::ContentLoading, MonitorEventKind::HistoryChanged})
+        {
+            navigation.kind = kind;
+            session.push_back(navigation);
+        }
+
+        uint32_t headers = strings.Intern(HeadersJson(pageUri, L"*/*"));
+        for (size_t resource = 0; resource < c_resourcesPerPage; ++resource)
+        {
+            MonitorEventRecord request = {};
+            request.navigationId = page;
+            request.kind = MonitorEventKind::WebResourceRequested;
+            request.uriId = strings.Intern(
+                L"https://static.example.com/assets/" +
+                std::to_wstring((page * 7 + resource) % 500) + L".js");
+            request.headersId = headers;
+            request.argsId = get;
+            session.push_back(request);
+            request.kind = MonitorEventKind::WebResourceResponseReceived;
+            request.detailId = response;
+            session.push_back(request);
+        }
+
+        for (MonitorEventKind kind :
+             {MonitorEventKind::DOMContentLoaded, MonitorEventKind::NavigationCompleted})
+        {
+            navigation.kind = kind;
+            navigation.flags |= c_monitorEventIsSuccess;
+            session.push_back(navigation);
+        }
+    }
+    session.resize(c_sessionEvents);
+    return session;
+}
+
+// How a batch writes its events: every string inline, as before string
+// interning; strings of 16 or more characters as {"$": id} references, as the
+// monitor first did; or each event as [shape, values...], as it does now.
+enum class WireFormat
+{
+    Inline,
+    StringRefs,
+    Shapes,
+};
+
+// Writes batches of events the way the monitor's PostEventBatch and
+// RenderEvent do, for the events that this session has.
+class BatchWriter
+{
+public:
+    BatchWriter(StringInterner& strings, WireFormat format) : m_strings(strings), m_format(format)
+    {
+    }
+
+    const std::wstring& WriteBatch(const MonitorEventRecord* records, size_t count)
+    {
+        m_json.Reset();
+        m_json.BeginObject();
+        m_json.Key(L"kind").String(L"events");
+        m_json.Key(L"events").BeginArray();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (m_format == WireFormat::Shapes)
+            {
+                WriteEventWithShape(records[i]);
+            }
+            else
+            {
+                WriteEvent(m_json, records[i], m_format == WireFormat::StringRefs);
+            }
+        }
+        m_json.EndArray();
+        if (m_format != WireFormat::Inline)
+        {
+            m_json.Key(L"strings").BeginObject();
+            for (const UnsentString& string : m_unsentStrings)
+            {
+                std::wstring_view value;
+                m_strings.TryGet(string.id, &value);
+                m_json.Key(string.id);
+                string.isJson ? m_json.RawValue(value) : m_json.String(value);
+            }
+            m_unsentStrings.clear();
+            m_json.EndObject();
+        }
+        m_json.EndObject();
+        return m_json.GetString();
+    }
+
+private:
+    struct UnsentString
+    {
+        uint32_t id;
+        bool isJson;
+    };
+
+    void WriteEventWithShape(const MonitorEventRecord& record)
+    {
+        m_shapeJson.Reset();
+        m_shapeValues.clear();
+        WriteEvent(m_shapeJson, record, true);
+        uint32_t shapeId = m_strings.Intern(m_shapeJson.GetString());
+        UseString(shapeId, true);
+        m_json.BeginArray();
+        m_json.UInt(shapeId);
+        for (uint64_t value : m_shapeValues)
+        {
+            m_json.UInt(value);
+        }
+        m_json.EndArray();
+    }
+
+    void WriteEvent(JsonWriter& json, const MonitorEventRecord& record, bool useRefs)
+    {
+        json.BeginObject();
+        json.Key(L"kind").String(L"event");
+        json.Key(L"name").String(MonitorEventKindToString(record.kind));
+        json.Key(L"args").BeginObject();
+        json.Key(L"navigationId");
+        WriteNumber(json, record.navigationId);
+        if (record.kind == MonitorEventKind::WebResourceRequested ||
+            record.kind == MonitorEventKind::WebResourceResponseReceived)
+        {
+            json.Key(L"request").BeginObject();
+            json.Key(L"content").Null();
+            json.Key(L"headers");
+            WriteString(json, record.headersId, true, useRefs);
+            json.Key(L"method");
+            WriteString(json, record.argsId, false, useRefs);
+            json.Key(L"uri");
+            WriteString(json, record.uriId, false, useRefs);
+            json.EndObject();
+            json.Key(L"response");
+            WriteString(json, record.detailId, true, useRefs);
+        }
+        else if (record.kind == MonitorEventKind::NavigationStarting)
+        {
+            json.Key(L"requestHeaders");
+            WriteString(json, record.headersId, true, useRefs);
+            json.Key(L"uri");
+            WriteString(json, record.uriId, false, useRefs);
+        }
+        json.EndObject();
+        if (record.flags & c_monitorEventHasWebView)
+        {
+            json.Key(L"webview").BeginObject();
+            json.Key(L"documentTitle");
+            WriteString(json, record.titleId, false, useRefs);
+            json.Key(L"source");
+            WriteString(json, record.sourceId, false, useRefs);
+            json.Key(L"canGoBack").Bool(record.flags & c_monitorEventCanGoBack);
+            json.Key(L"canGoForward").Bool(record.flags & c_monitorEventCanGoForward);
+            json.EndObject();
+        }
+        json.EndObject();
+    }
+
+    void WriteNumber(JsonWriter& json, uint64_t value)
+    {
+        if (m_format == WireFormat::Shapes)
+        {
+            json.BeginObject().Key(L"?").String(L"value").EndObject();
+            m_shapeValues.push_back(value);
+        }
+        else
+        {
+            json.UInt(value);
+        }
+    }
+
+    void WriteString(JsonWriter& json, uint32_t id, bool isJson, bool useRefs)
+    {
+        std::wstring_view value;
+        if (!m_strings.TryGet(id, &value))
+        {
+            json.Null();
+        }
+        else if (useRefs && (value.size() >= c_minStringRefLength ||
+                                (isJson && m_format == WireFormat::Shapes)))
+        {
+            UseString(id, isJson);
+            if (m_format == WireFormat::Shapes)
+            {
+                json.BeginObject().Key(L"?").String(L"string").EndObject();
+                m_shapeValues.push_back(id);
+            }
+            else
+            {
+                json.BeginObject().Key(L"$").UInt(id).EndObject();
+            }
+        }
+        else if (isJson)
+        {
+            json.RawValue(value);
+        }
+        else
+        {
+            json.String(value);
+        }
+    }
+
+    void UseString(uint32_t id, bool isJson)
+    {
+        uint32_t index = StringInterner::GetIndex(id);
+        if (index >= m_sentStrings.size())
+        {
+            m_sentStrings.resize(index + 1);
+        }
+        if (!m_sentStrings[index])
+        {
+            m_sentStrings[index] = true;
+            m_unsentStrings.push_back({id, isJson});
+        }
+    }
+
+    StringInterner& m_strings;
+    WireFormat m_format;
+    JsonWriter m_json;
+    JsonWriter m_shapeJson;
+    std::vector<uint64_t> m_shapeValues;
+    // The session fits in one interner generation, so indexes are enough.
+    std::vector<bool> m_sentStrings;
+    std::vector<UnsentString> m_unsentStrings;
+};
+
+size_t Measure(
+    const char* name, StringInterner& strings, const std::vector<MonitorEventRecord>& session,
+    WireFormat format, size_t passes)
+{
+    size_t bytes = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                BatchWriter writer(strings, format);
+                bytes = 0;
+                for (size_t first = 0; first < session.size(); first += c_batchEvents)
+                {
+                    size_t count = (std::min)(c_batchEvents, session.size() - first);
+                    // Messages are posted as UTF-16.
+                    bytes += writer.WriteBatch(&session[first], count).size() * 2;
+                }
+            }
+        });
+    std::printf(
+        "%-32s %8.2f MB on the wire %8.1f ms to encode\n", name, bytes / 1e6,
+        seconds * 1e3 / passes);
+    return bytes;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t passes = IsQuickRun(argc, argv) ? 1 : 10;
+    StringInterner strings(64 * 1024 * 1024);
+    std::vector<MonitorEventRecord> session = RecordSession(strings);
+    if (strings.GetGeneration() != 0)
+    {
+        std::fprintf(stderr, "The session should fit in one interner generation\n");
+        return 1;
+    }
+    size_t inlineBytes =
+        Measure("strings inline", strings, session, WireFormat::Inline, passes);
+    Measure("string references", strings, session, WireFormat::StringRefs, passes);
+    size_t shapeBytes = Measure("shapes (now)", strings, session, WireFormat::Shapes, passes);
+    double reduction = static_cast<double>(inlineBytes) / shapeBytes;
+    std::printf("  shapes send %.1fx fewer bytes than inline strings\n", reduction);
+    // The event monitor's target.
+    return reduction >= 5 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compresses the sample's sources and assets, as AssetPacker --gzip does text
+// files, and reports the throughput and the ratio for each kind of file. The
+// build defines SAMPLE_SOURCE_DIR. To compare with gzip -6, run
+// gzip -6 -c on the same files.
+
+#include "GzipEncoder.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t rounds = quick ? 1 : 5;
+    std::filesystem::path sample(SAMPLE_SOURCE_DIR);
+    for (const char* extension : {".cpp", ".h", ".html", ".js"})
+    {
+        std::vector<std::vector<uint8_t>> files;
+        size_t bytes = 0;
+        for (const std::filesystem::path& directory : {sample, sample / "assets"})
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(directory))
+            {
+                if (entry.path().extension() != extension || (quick && files.size() == 4))
+                {
+                    continue;
+                }
+                std::ifstream file(entry.path(), std::ios::binary);
+                files.emplace_back(
+                    std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                bytes += files.back().size();
+            }
+        }
+        size_t compressedBytes = 0;
+        double seconds = MeasureSeconds(
+            [&]()
+            {
+                for (size_t round = 0; round < rounds; ++round)
+                {
+                    compressedBytes = 0;
+                    for (const std::vector<uint8_t>& file : files)
+                    {
+                        compressedBytes += GzipCompress(file.data(), file.size()).size();
+                    }
+                }
+            });
+        std::string name = std::string("GzipCompress, ") + extension + " files, bytes";
+        ReportRate(name.c_str(), rounds * bytes, seconds);
+        std::printf(
+            "  %zu files, %zu bytes, compressed to %.1f%%\n", files.size(), bytes,
+            bytes ? 100.0 * compressedBytes / bytes : 0.0);
+    }
+    return 0;
+}
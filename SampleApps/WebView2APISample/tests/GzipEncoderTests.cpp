@@ -0,0 +1,443 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "GzipEncoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A strict gzip decoder, after zlib's puff, that the encoder's output is
+// checked against. It fails on anything RFC 1951 and RFC 1952 don't allow,
+// including codes that are over-subscribed or incomplete.
+class Inflater
+{
+public:
+    // Decode a gzip file, or return false if it isn't valid.
+    bool Gunzip(const std::vector<uint8_t>& file, std::vector<uint8_t>* output)
+    {
+        m_input = &file;
+        m_position = 10;
+        m_bitBuffer = 0;
+        m_bitCount = 0;
+        m_failed = false;
+        m_output = output;
+        output->clear();
+        // Magic, deflate, and no optional fields.
+        if (file.size() < 18 || file[0] != 0x1f || file[1] != 0x8b || file[2] != 8 ||
+            file[3] != 0)
+        {
+            return false;
+        }
+        bool last = false;
+        while (!last)
+        {
+            last = Bits(1) == 1;
+            uint32_t type = Bits(2);
+            bool ok = type == 0 ? Stored() : type == 1 ? Fixed() : type == 2 && Dynamic();
+            if (!ok || m_failed)
+            {
+                return false;
+            }
+        }
+        if (m_position + 8 != file.size())
+        {
+            return false;
+        }
+        uint32_t crc = ReadLittleEndian(m_position);
+        uint32_t size = ReadLittleEndian(m_position + 4);
+        return crc == UpdateCrc32(0, output->data(), output->size()) &&
+               size == static_cast<uint32_t>(output->size());
+    }
+
+private:
+    // Canonical Huffman code: the count of codes of each length, and the
+    // symbols in code order.
+    struct Huffman
+    {
+        uint16_t counts[16];
+        uint16_t symbols[288];
+    };
+
+    uint32_t ReadLittleEndian(size_t at) const
+    {
+        const std::vector<uint8_t>& input = *m_input;
+        return input[at] | input[at + 1] << 8 | input[at + 2] << 16 |
+               uint32_t(input[at + 3]) << 24;
+    }
+
+    uint32_t Bits(uint32_t count)
+    {
+        uint64_t value = m_bitBuffer;
+        while (m_bitCount < count)
+        {
+            if (m_position >= m_input->size())
+            {
+                m_failed = true;
+                return 0;
+            }
+            value |= uint64_t((*m_input)[m_position++]) << m_bitCount;
+            m_bitCount += 8;
+        }
+        m_bitBuffer = value >> count;
+        m_bitCount -= count;
+        return static_cast<uint32_t>(value & ((uint64_t(1) << count) - 1));
+    }
+
+    bool Stored()
+    {
+        m_bitBuffer = 0;
+        m_bitCount = 0;
+        if (m_position + 4 > m_input->size())
+        {
+            return false;
+        }
+        uint32_t length = (*m_input)[m_position] | (*m_input)[m_position + 1] << 8;
+        uint32_t complement = (*m_input)[m_position + 2] | (*m_input)[m_position + 3] << 8;
+        m_position += 4;
+        if (length != (~complement & 0xffff) || m_position + length > m_input->size())
+        {
+            return false;
+        }
+        m_output->insert(
+            m_output->end(), m_input->begin() + m_position,
+            m_input->begin() + m_position + length);
+        m_position += length;
+        return true;
+    }
+
+    // Build a code from lengths. Returns false if it is over-subscribed, or
+    // incomplete with more than one code.
+    static bool Build(Huffman* code, const uint8_t* lengths, uint32_t count)
+    {
+        uint16_t offsets[16] = {};
+        for (uint16_t& c : code->counts)
+        {
+            c = 0;
+        }
+        for (uint32_t symbol = 0; symbol < count; ++symbol)
+        {
+            ++code->counts[lengths[symbol]];
+        }
+        if (code->counts[0] == count)
+        {
+            return true;
+        }
+        int left = 1;
+        for (int length = 1; length < 16; ++length)
+        {
+            left = left * 2 - code->counts[length];
+            if (left < 0)
+            {
+                return false;
+            }
+        }
+        for (int length = 1; length < 15; ++length)
+        {
+            offsets[length + 1] = offsets[length] + code->counts[length];
+        }
+        for (uint32_t symbol = 0; symbol < count; ++symbol)
+        {
+            if (lengths[symbol] != 0)
+            {
+                code->symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+            }
+        }
+        return left == 0 || count - code->counts[0] == 1;
+    }
+
+    int Decode(const Huffman& code)
+    {
+        int value = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length < 16; ++length)
+        {
+            value |= static_cast<int>(Bits(1));
+            int count = code.counts[length];
+            if (value - count < first)
+            {
+                return code.symbols[index + value - first];
+            }
+            index += count;
+            first = (first + count) << 1;
+            value <<= 1;
+        }
+        m_failed = true;
+        return 0;
+    }
+
+    bool Codes(const Huffman& literals, const Huffman& distances)
+    {
+        static const uint16_t lengthBase[29] = {
+            3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+            31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t lengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const uint16_t distanceBase[30] = {
+            1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+            33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+            1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const uint8_t distanceExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12,
+            12, 13, 13};
+        for (;;)
+        {
+            int symbol = Decode(literals);
+            if (m_failed || symbol > 285)
+            {
+                return false;
+            }
+            if (symbol < 256)
+            {
+                m_output->push_back(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == 256)
+            {
+                return true;
+            }
+            symbol -= 257;
+            uint32_t length = lengthBase[symbol] + Bits(lengthExtra[symbol]);
+            int distanceSymbol = Decode(distances);
+            if (m_failed || distanceSymbol > 29)
+            {
+                return false;
+            }
+            uint32_t distance = distanceBase[distanceSymbol] + Bits(distanceExtra[distanceSymbol]);
+            if (distance > m_output->size())
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < length; ++i)
+            {
+                m_output->push_back((*m_output)[m_output->size() - distance]);
+            }
+        }
+    }
+
+    bool Fixed()
+    {
+        uint8_t lengths[288 + 30];
+        for (int symbol = 0; symbol < 288; ++symbol)
+        {
+            lengths[symbol] = symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+        }
+        for (int symbol = 0; symbol < 30; ++symbol)
+        {
+            lengths[288 + symbol] = 5;
+        }
+        Huffman literals;
+        Huffman distances;
+        Build(&literals, lengths, 288);
+        Build(&distances, lengths + 288, 30);
+        return Codes(literals, distances);
+    }
+
+    bool Dynamic()
+    {
+        static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                          11, 4,  12, 3, 13, 2, 14, 1, 15};
+        uint32_t literalCount = Bits(5) + 257;
+        uint32_t distanceCount = Bits(5) + 1;
+        uint32_t codeLengthCount = Bits(4) + 4;
+        if (literalCount > 286 || distanceCount > 30)
+        {
+            return false;
+        }
+        uint8_t lengths[286 + 30] = {};
+        for (uint32_t i = 0; i < codeLengthCount; ++i)
+        {
+            lengths[order[i]] = static_cast<uint8_t>(Bits(3));
+        }
+        Huffman lengthCode;
+        if (!Build(&lengthCode, lengths, 19))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < 19; ++i)
+        {
+            lengths[i] = 0;
+        }
+        uint32_t index = 0;
+        while (index < literalCount + distanceCount)
+        {
+            int symbol = Decode(lengthCode);
+            if (m_failed)
+            {
+                return false;
+            }
+            if (symbol < 16)
+            {
+                lengths[index++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t repeated = 0;
+            uint32_t repeat = 0;
+            if (symbol == 16)
+            {
+                if (index == 0)
+                {
+                    return false;
+                }
+                repeated = lengths[index - 1];
+                repeat = 3 + Bits(2);
+            }
+            else
+            {
+                repeat = symbol == 17 ? 3 + Bits(3) : 11 + Bits(7);
+            }
+            if (index + repeat > literalCount + distanceCount)
+            {
+                return false;
+            }
+            while (repeat-- > 0)
+            {
+                lengths[index++] = repeated;
+            }
+        }
+        if (lengths[256] == 0)
+        {
+            return false;
+        }
+        Huffman literals;
+        Huffman distances;
+        return Build(&literals, lengths, literalCount) &&
+               Build(&distances, lengths + literalCount, distanceCount) &&
+               Codes(literals, distances);
+    }
+
+    const std::vector<uint8_t>* m_input = nullptr;
+    size_t m_position = 0;
+    uint64_t m_bitBuffer = 0;
+    uint32_t m_bitCount = 0;
+    bool m_failed = false;
+    std::vector<uint8_t>* m_output = nullptr;
+};
+
+bool RoundTrips(const std::vector<uint8_t>& data, size_t* compressedSize = nullptr)
+{
+    std::vector<uint8_t> compressed = GzipCompress(data.data(), data.size());
+    if (compressedSize)
+    {
+        *compressedSize = compressed.size();
+    }
+    std::vector<uint8_t> output;
+    return Inflater().Gunzip(compressed, &output) && output == data;
+}
+
+void TestCrc32()
+{
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_CHECK(UpdateCrc32(0, check, sizeof(check)) == 0xCBF43926);
+    TEST_CHECK(UpdateCrc32(UpdateCrc32(0, check, 4), check + 4, 5) == 0xCBF43926);
+    TEST_CHECK(UpdateCrc32(0, nullptr, 0) == 0);
+}
+
+void TestSmallInputs()
+{
+    TEST_CHECK(RoundTrips({}));
+    TEST_CHECK(RoundTrips({'a'}));
+    TEST_CHECK(RoundTrips({0, 0, 0}));
+    TEST_CHECK(RoundTrips(std::vector<uint8_t>(258 * 3 + 1, 'x')));
+    std::vector<uint8_t> allBytes;
+    for (int i = 0; i < 256; ++i)
+    {
+        allBytes.push_back(static_cast<uint8_t>(i));
+    }
+    TEST_CHECK(RoundTrips(allBytes));
+
+    // The decoder checks the trailer, so a round trip means something.
+    std::vector<uint8_t> compressed = GzipCompress(allBytes.data(), allBytes.size());
+    std::vector<uint8_t> output;
+    compressed[compressed.size() - 8] ^= 1;
+    TEST_CHECK(!Inflater().Gunzip(compressed, &output));
+}
+
+// Random inputs of three kinds: noise over small and large alphabets, short
+// repeats, and repeats from near the end of the window.
+void TestRandomInputs()
+{
+    std::mt19937 random(1);
+    for (int test = 0; test < 120; ++test)
+    {
+        size_t size = random() % (test < 40 ? 100 : 200000);
+        std::vector<uint8_t> data(size);
+        uint32_t alphabet = 1 + random() % 256;
+        uint32_t mode = random() % 3;
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (mode == 1 && i > 10 && random() % 4)
+            {
+                data[i] = data[i - 1 - random() % 10];
+            }
+            else if (mode == 2 && i > 40000 && random() % 8)
+            {
+                data[i] = data[i - 32000 - random() % 700];
+            }
+            else
+            {
+                data[i] = static_cast<uint8_t>(random() % alphabet);
+            }
+        }
+        bool roundTrips = RoundTrips(data);
+        TEST_CHECK(roundTrips);
+        if (!roundTrips)
+        {
+            std::fprintf(stderr, "  input %d, %zu bytes, mode %u\n", test, size, mode);
+        }
+    }
+}
+
+// Symbol counts that follow the Fibonacci sequence make optimal Huffman codes
+// longer than the 15 bits DEFLATE allows, so the encoder has to limit them.
+void TestLengthLimitedCodes()
+{
+    std::vector<uint8_t> data;
+    uint64_t previous = 1;
+    uint64_t count = 1;
+    for (uint8_t symbol = 0; symbol < 24; ++symbol)
+    {
+        data.insert(data.end(), static_cast<size_t>(count), symbol);
+        uint64_t next = previous + count;
+        previous = count;
+        count = next;
+    }
+    // Shuffled, so that the counts show as literals rather than runs.
+    std::shuffle(data.begin(), data.end(), std::mt19937(3));
+    TEST_CHECK(RoundTrips(data));
+}
+
+// Repetitive text compresses well.
+void TestCompressionRatio()
+{
+    std::string text;
+    for (int i = 0; i < 2000; ++i)
+    {
+        text += "function handler" + std::to_string(i % 37) +
+                "(event) { return event.detail; }\n";
+    }
+    std::vector<uint8_t> data(text.begin(), text.end());
+    size_t compressedSize = 0;
+    TEST_CHECK(RoundTrips(data, &compressedSize));
+    TEST_CHECK(compressedSize * 20 < data.size());
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestCrc32);
+    RUN_TEST(TestSmallInputs);
+    RUN_TEST(TestRandomInputs);
+    RUN_TEST(TestLengthLimitedCodes);
+    RUN_TEST(TestCompressionRatio);
+    return ReportTestResults();
+}
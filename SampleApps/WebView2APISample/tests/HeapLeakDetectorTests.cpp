@@ -0,0 +1,105 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapLeakDetector.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A synthetic heap sampled every second for a number of hours: a 20 MB base,
+// garbage that builds up and is collected at random in a sawtooth, noise, and
+// an occasional 40 MB burst. On top, growth at a steady rate, and a one-time
+// 10 MB step at stepHour.
+HeapLeakReport Simulate(double growthPerHour, double stepHour, double hours, unsigned seed)
+{
+    HeapTimeSeries series;
+    std::mt19937 random(seed);
+    std::normal_distribution<double> noise(0, 200000);
+    double garbage = 0;
+    for (int64_t time = 0; time < int64_t(hours * 3600) * 1000; time += 1000)
+    {
+        double hour = time / 3600000.0;
+        garbage += 100000 + std::abs(noise(random)) / 4;
+        if (garbage > 8e6 || random() % 97 == 0)
+        {
+            garbage = 0;
+        }
+        double used = 20e6 + growthPerHour * hour + (hour >= stepHour ? 10e6 : 0) + garbage +
+                      noise(random);
+        if (random() % 500 == 0)
+        {
+            used += 40e6;
+        }
+        series.Add(time, used, used * 1.5);
+    }
+    return DetectHeapLeak(series);
+}
+
+// Over 20 seeds: no flat heap or one-time step is reported, and every leak of
+// 5 MB an hour is.
+void TestGrowthCurves()
+{
+    int falsePositives = 0;
+    int missedLeaks = 0;
+    int reportedSteps = 0;
+    for (unsigned seed = 1; seed <= 20; ++seed)
+    {
+        falsePositives += Simulate(0, 1e9, 1.5, seed).suspected;
+        HeapLeakReport leak = Simulate(5e6, 1e9, 1.5, seed);
+        missedLeaks += !leak.suspected;
+        TEST_CHECK(std::abs(leak.slopeBytesPerHour - 5e6) < 0.5e6);
+        reportedSteps += Simulate(0, 0.75, 1.5, seed).suspected;
+    }
+    std::printf(
+        "false positives %d, missed leaks %d, reported steps %d\n", falsePositives,
+        missedLeaks, reportedSteps);
+    TEST_CHECK(falsePositives == 0);
+    TEST_CHECK(missedLeaks == 0);
+    TEST_CHECK(reportedSteps == 0);
+}
+
+// Growth below minSlopeBytesPerHour isn't reported.
+void TestSlowGrowth()
+{
+    TEST_CHECK(!Simulate(0.3e6, 1e9, 1.5, 3).suspected);
+}
+
+// Too few minutes to decide.
+void TestTooFewSamples()
+{
+    HeapLeakReport report = Simulate(50e6, 1e9, 5.0 / 60, 1);
+    TEST_CHECK(!report.suspected);
+    TEST_CHECK(report.sampleCount < HeapLeakOptions().minSamples);
+}
+
+void TestTheilSenSlope()
+{
+    // The outliers at 3 and 6 don't move the slope.
+    double times[] = {0, 1, 2, 3, 4, 5, 6};
+    double values[] = {0, 2, 4, 100, 8, 10, -50};
+    double risingFraction = 0;
+    TEST_CHECK(GetTheilSenSlope(times, values, 7, &risingFraction) == 2);
+    TEST_CHECK(risingFraction > 0.5 && risingFraction < 1);
+
+    double sameTime[] = {1, 1};
+    TEST_CHECK(GetTheilSenSlope(sameTime, values, 2, &risingFraction) == 0);
+    TEST_CHECK(risingFraction == 0);
+    TEST_CHECK(GetTheilSenSlope(times, values, 1) == 0);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestGrowthCurves);
+    RUN_TEST(TestSlowGrowth);
+    RUN_TEST(TestTooFewSamples);
+    RUN_TEST(TestTheilSenSlope);
+    return ReportTestResults();
+}
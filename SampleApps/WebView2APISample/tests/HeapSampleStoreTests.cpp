@@ -0,0 +1,74 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapSampleStore.h"
+
+#include <string>
+
+#include "JsonReader.h"
+#include "JsonWriter.h"
+#include "TestHarness.h"
+
+namespace
+{
+void AddSamples(HeapSampleStore& store)
+{
+    store.Add(L"A", L"worker,\"x\"", 0, 1, 2);
+    store.Add(L"B", L"page", 0, 3, 4);
+    store.Add(L"A", L"worker,\"x\"", 1500, 5, 6);
+}
+
+// Rows end in CRLF, as in RFC 4180.
+void TestCsv()
+{
+    HeapSampleStore store;
+    AddSamples(store);
+    std::wstring csv;
+    store.WriteCsv(csv);
+    TEST_CHECK(
+        csv == L"targetId,label,tier,time,count,usedMin,usedMax,usedMean,totalMean\r\n"
+               L"A,\"worker,\"\"x\"\"\",second,0,1,1,1,1,2\r\n"
+               L"A,\"worker,\"\"x\"\"\",second,1000,1,5,5,5,6\r\n"
+               L"A,\"worker,\"\"x\"\"\",minute,0,1,1,1,1,2\r\n"
+               L"B,page,second,0,1,3,3,3,4\r\n");
+}
+
+void TestJson()
+{
+    HeapSampleStore store;
+    AddSamples(store);
+    JsonWriter json;
+    store.WriteJson(json);
+    JsonDocument document;
+    TEST_CHECK(document.Parse(json.GetString()));
+    JsonValue target = document.GetRoot()[L"targets"].GetElement(0);
+    TEST_CHECK(target[L"targetId"].GetStringOr() == L"A");
+    TEST_CHECK(target[L"label"].GetStringOr() == L"worker,\"x\"");
+    TEST_CHECK(target[L"leak"].GetType() == JsonType::Object);
+    JsonValue second = target[L"tiers"][L"second"];
+    TEST_CHECK(second.GetElement(1)[L"usedMin"].GetRawJson() == L"5");
+    TEST_CHECK(second.GetElement(1)[L"time"].GetRawJson() == L"1000");
+    TEST_CHECK(!second.GetElement(2).Exists());
+}
+
+// Targets that are no longer attached are forgotten.
+void TestRetain()
+{
+    HeapSampleStore store;
+    AddSamples(store);
+    TEST_CHECK(store.GetTargetCount() == 2);
+    store.Retain({L"B", L"C"});
+    TEST_CHECK(store.GetTargetCount() == 1);
+    TEST_CHECK(!store.GetTarget(L"A") && store.GetTarget(L"B"));
+    TEST_CHECK(store.GetTarget(L"B")->label == L"page");
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestCsv);
+    RUN_TEST(TestJson);
+    RUN_TEST(TestRetain);
+    return ReportTestResults();
+}
@@ -0,0 +1,74 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HeapTimeSeries.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "TestHarness.h"
+
+namespace
+{
+constexpr int64_t c_second = 1000;
+constexpr int64_t c_hour = 3600 * c_second;
+
+// Three hours of a sample every 250 ms, each the time itself.
+void TestTiers()
+{
+    HeapTimeSeries series;
+    for (int64_t time = 0; time < 3 * c_hour + 5 * c_second; time += 250)
+    {
+        series.Add(time, double(time), 0);
+    }
+    TEST_CHECK(series.GetSampleCount(HeapTier::Second) == 601);
+    TEST_CHECK(series.GetCompleteSampleCount(HeapTier::Second) == 600);
+    TEST_CHECK(series.GetCompleteSampleCount(HeapTier::Minute) == 180);
+    TEST_CHECK(series.GetCompleteSampleCount(HeapTier::Hour) == 2);
+
+    HeapSample minute = series.GetSample(HeapTier::Minute, 0);
+    TEST_CHECK(minute.time == 0 && minute.count == 240);
+    TEST_CHECK(minute.usedMin == 0 && minute.usedMax == 59750);
+    HeapSample hour = series.GetSample(HeapTier::Hour, 1);
+    TEST_CHECK(hour.time == c_hour && hour.count == 14400);
+    TEST_CHECK(std::abs(hour.usedMean - (c_hour + 2 * c_hour - 250) / 2.0) < 1e-3);
+
+    // The second tier keeps its latest 600 periods, and the one in progress.
+    TEST_CHECK(series.GetSample(HeapTier::Second, 0).time == 3 * c_hour + 4 * c_second - 600000);
+    TEST_CHECK(series.GetSample(HeapTier::Second, 599).time == 3 * c_hour + 3 * c_second);
+    TEST_CHECK(series.GetSample(HeapTier::Second, 600).time == 3 * c_hour + 4 * c_second);
+}
+
+void TestCombinedSample()
+{
+    HeapTimeSeries series;
+    series.Add(1000, 10, 100);
+    series.Add(1200, 30, 300);
+    series.Add(1900, 20, 200);
+    TEST_CHECK(series.GetSampleCount(HeapTier::Second) == 1);
+    HeapSample sample = series.GetSample(HeapTier::Second, 0);
+    TEST_CHECK(sample.time == 1000 && sample.count == 3);
+    TEST_CHECK(sample.usedMin == 10 && sample.usedMax == 30);
+    TEST_CHECK(sample.usedMean == 20 && sample.totalMean == 200);
+}
+
+// Samples from before the current second are ignored.
+void TestOutOfOrder()
+{
+    HeapTimeSeries series;
+    series.Add(5000, 1, 1);
+    series.Add(4999, 100, 100);
+    series.Add(0, 100, 100);
+    TEST_CHECK(series.GetSampleCount(HeapTier::Second) == 1);
+    TEST_CHECK(series.GetSample(HeapTier::Second, 0).usedMax == 1);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestTiers);
+    RUN_TEST(TestCombinedSample);
+    RUN_TEST(TestOutOfOrder);
+    return ReportTestResults();
+}
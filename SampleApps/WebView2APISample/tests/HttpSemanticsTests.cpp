@@ -0,0 +1,229 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "HttpSemantics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// The ranges a header parses to, as "offset+size" each followed by a space.
+std::wstring ParseRanges(const std::wstring& range, uint64_t size, RangeStatus* status)
+{
+    std::vector<ByteRange> ranges;
+    *status = ParseRange(range, size, &ranges);
+    std::wstring text;
+    for (const ByteRange& byteRange : ranges)
+    {
+        text += std::to_wstring(byteRange.offset) + L"+" + std::to_wstring(byteRange.size) + L" ";
+    }
+    return text;
+}
+
+RangeStatus GetRangeStatus(const std::wstring& range, uint64_t size)
+{
+    std::vector<ByteRange> ranges;
+    return ParseRange(range, size, &ranges);
+}
+
+void TestEntityTags()
+{
+    std::wstring etag = FormatEntityTag(0x1234);
+    TEST_CHECK(etag == L"\"0000000000001234\"");
+    TEST_CHECK(FormatEntityTag(UINT64_MAX) == L"\"ffffffffffffffff\"");
+
+    TEST_CHECK(MatchesIfNoneMatch(etag, etag));
+    TEST_CHECK(MatchesIfNoneMatch(L"*", etag));
+    TEST_CHECK(MatchesIfNoneMatch(L"W/" + etag, etag));
+    TEST_CHECK(MatchesIfNoneMatch(L"\"a\", " + etag, etag));
+    TEST_CHECK(MatchesIfNoneMatch(L"\"a,b\" ,, W/" + etag + L" ", etag));
+    TEST_CHECK(!MatchesIfNoneMatch(L"\"a\"", etag));
+    TEST_CHECK(!MatchesIfNoneMatch(L"", etag));
+    TEST_CHECK(!MatchesIfNoneMatch(L"0000000000001234", etag));
+    // Malformed lists match nothing: a missing comma, an unterminated tag, and
+    // "*" with other members.
+    TEST_CHECK(!MatchesIfNoneMatch(L"\"a\" " + etag, etag));
+    TEST_CHECK(!MatchesIfNoneMatch(L"\"unterminated, " + etag, etag));
+    TEST_CHECK(!MatchesIfNoneMatch(L"*, " + etag + L"x", etag));
+
+    // If-Range compares strongly, and never matches a date.
+    TEST_CHECK(MatchesIfRange(etag, etag));
+    TEST_CHECK(MatchesIfRange(L" " + etag + L" ", etag));
+    TEST_CHECK(!MatchesIfRange(L"W/" + etag, etag));
+    TEST_CHECK(!MatchesIfRange(L"Wed, 21 Oct 2015 07:28:00 GMT", etag));
+    TEST_CHECK(!MatchesIfRange(L"\"x\"", etag));
+    TEST_CHECK(!MatchesIfRange(etag + L", " + etag, etag));
+
+    // A weak tag matches If-None-Match, but never If-Range.
+    std::wstring weak = FormatEntityTag(0x1234, true);
+    TEST_CHECK(weak == L"W/" + etag);
+    TEST_CHECK(MatchesIfNoneMatch(weak, weak));
+    TEST_CHECK(MatchesIfNoneMatch(etag, weak));
+    TEST_CHECK(!MatchesIfRange(weak, weak));
+    TEST_CHECK(!MatchesIfRange(etag, weak));
+}
+
+void TestSatisfiableRanges()
+{
+    RangeStatus status;
+    TEST_CHECK(ParseRanges(L"bytes=0-499", 10000, &status) == L"0+500 ");
+    TEST_CHECK(status == RangeStatus::Satisfiable);
+    TEST_CHECK(ParseRanges(L"Bytes=9500-", 10000, &status) == L"9500+500 ");
+    TEST_CHECK(ParseRanges(L"bytes=-500", 10000, &status) == L"9500+500 ");
+    TEST_CHECK(ParseRanges(L"bytes=-20000", 10000, &status) == L"0+10000 ");
+    TEST_CHECK(ParseRanges(L"bytes=0-0,-1", 10000, &status) == L"0+1 9999+1 ");
+    TEST_CHECK(ParseRanges(L"bytes=0-99999", 10000, &status) == L"0+10000 ");
+    TEST_CHECK(
+        ParseRanges(L"bytes=0-18446744073709551616000", 10000, &status) == L"0+10000 ");
+    // Ranges that don't start within the content are dropped if others do.
+    TEST_CHECK(ParseRanges(L"bytes=20000-30000, 9999-", 10000, &status) == L"9999+1 ");
+    TEST_CHECK(status == RangeStatus::Satisfiable);
+}
+
+// Ranges are kept in the order asked for unless any overlap or are close, and
+// then all of them are coalesced in order of offset.
+void TestCoalescing()
+{
+    RangeStatus status;
+    TEST_CHECK(ParseRanges(L"bytes=500-600, 0-99", 10000, &status) == L"500+101 0+100 ");
+    TEST_CHECK(ParseRanges(L"bytes=500-700,601-999", 10000, &status) == L"500+500 ");
+    TEST_CHECK(ParseRanges(L"bytes=500-600,0-99,601-700", 10000, &status) == L"0+100 500+201 ");
+    TEST_CHECK(ParseRanges(L"bytes=0-99,150-199", 10000, &status) == L"0+200 ");
+    TEST_CHECK(ParseRanges(L"bytes=0-99,1000-1099", 10000, &status) == L"0+100 1000+100 ");
+}
+
+void TestUnsatisfiableAndIgnored()
+{
+    TEST_CHECK(GetRangeStatus(L"bytes=10000-", 10000) == RangeStatus::Unsatisfiable);
+    TEST_CHECK(GetRangeStatus(L"bytes=-0", 10000) == RangeStatus::Unsatisfiable);
+    TEST_CHECK(GetRangeStatus(L"bytes=0-", 0) == RangeStatus::Unsatisfiable);
+    TEST_CHECK(GetRangeStatus(L"bytes=-5", 0) == RangeStatus::Unsatisfiable);
+
+    for (const wchar_t* range :
+         {L"bytes=5-3", L"bytes=a-3", L"bytes=-", L"bytes=", L"bytes=1", L"items=0-5",
+          L"bytes=0-5,x", L"bytes = 0-5", L"bytes=0 - 5", L"", L"bytes=--5", L"bytes=0-5-"})
+    {
+        TEST_CHECK(GetRangeStatus(range, 10000) == RangeStatus::Ignored);
+    }
+    // More than 64 ranges aren't worth answering.
+    std::wstring many = L"bytes=";
+    for (int i = 0; i < 65; ++i)
+    {
+        many += std::to_wstring(i * 200) + L"-" + std::to_wstring(i * 200) + L",";
+    }
+    TEST_CHECK(GetRangeStatus(many, 100000) == RangeStatus::Ignored);
+}
+
+// Random lists of ranges: the result lies within the content, covers every
+// byte asked for that exists, and doesn't overlap itself.
+void TestRandomRanges()
+{
+    std::mt19937 random(5);
+    for (int test = 0; test < 20000; ++test)
+    {
+        uint64_t size = random() % 3000;
+        std::vector<bool> asked(size);
+        std::wstring header = L"bytes=";
+        int count = 1 + random() % 6;
+        for (int i = 0; i < count; ++i)
+        {
+            uint64_t first = random() % 3200;
+            uint64_t last = first + random() % 400;
+            if (random() % 4 == 0)
+            {
+                uint64_t suffix = random() % 200;
+                header += L"-" + std::to_wstring(suffix);
+                first = size - std::min(suffix, size);
+                last = size - 1;
+            }
+            else
+            {
+                header += std::to_wstring(first) + L"-" + std::to_wstring(last);
+            }
+            for (uint64_t byte = first; byte <= last && byte < size; ++byte)
+            {
+                asked[byte] = true;
+            }
+            header += i + 1 < count ? L"," : L"";
+        }
+
+        std::vector<ByteRange> ranges;
+        RangeStatus status = ParseRange(header, size, &ranges);
+        bool anyAsked = std::find(asked.begin(), asked.end(), true) != asked.end();
+        TEST_CHECK(status == (anyAsked ? RangeStatus::Satisfiable : RangeStatus::Unsatisfiable));
+        std::vector<int> covered(size);
+        for (const ByteRange& range : ranges)
+        {
+            TEST_CHECK(range.size > 0 && range.offset + range.size <= size);
+            for (uint64_t byte = range.offset; byte < range.offset + range.size && byte < size;
+                 ++byte)
+            {
+                ++covered[byte];
+            }
+        }
+        for (uint64_t byte = 0; byte < size; ++byte)
+        {
+            TEST_CHECK(covered[byte] <= 1 && (!asked[byte] || covered[byte] == 1));
+        }
+    }
+}
+
+void TestContentRange()
+{
+    TEST_CHECK(FormatContentRange({0, 500}, 10000) == L"bytes 0-499/10000");
+    TEST_CHECK(FormatContentRange({9999, 1}, 10000) == L"bytes 9999-9999/10000");
+    TEST_CHECK(FormatUnsatisfiedContentRange(10000) == L"bytes */10000");
+}
+
+void TestMultipart()
+{
+    std::string content = "0123456789abcdefghij";
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(content.data());
+    std::vector<ByteRange> ranges = {{0, 2}, {10, 3}};
+    std::vector<uint8_t> body =
+        BuildMultipartByteRanges(data, content.size(), ranges, "text/plain", "B");
+    TEST_CHECK(
+        std::string(body.begin(), body.end()) ==
+        "--B\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/20\r\n\r\n01\r\n"
+        "--B\r\nContent-Type: text/plain\r\nContent-Range: bytes 10-12/20\r\n\r\nabc\r\n"
+        "--B--\r\n");
+
+    // A reader only gets asked for the bytes of the ranges.
+    uint64_t bytesRead = 0;
+    std::vector<uint8_t> readBody;
+    TEST_CHECK(BuildMultipartByteRanges(
+        [&](const ByteRange& range, uint8_t* buffer)
+        {
+            bytesRead += range.size;
+            std::copy(data + range.offset, data + range.offset + range.size, buffer);
+            return true;
+        },
+        content.size(), ranges, "text/plain", "B", &readBody));
+    TEST_CHECK(readBody == body && bytesRead == 5);
+
+    // A reader that fails fails the body.
+    TEST_CHECK(!BuildMultipartByteRanges(
+        [](const ByteRange&, uint8_t*) { return false; }, content.size(), ranges, "text/plain",
+        "B", &readBody));
+    TEST_CHECK(readBody.empty());
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestEntityTags);
+    RUN_TEST(TestSatisfiableRanges);
+    RUN_TEST(TestCoalescing);
+    RUN_TEST(TestUnsatisfiableAndIgnored);
+    RUN_TEST(TestRandomRanges);
+    RUN_TEST(TestContentRange);
+    RUN_TEST(TestMultipart);
+    return ReportTestResults();
+}
@@ -0,0 +1,73 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Answers image requests as Settings -> Replace images did before
+// ImageReplacer, by opening and reading the replacement file for each one,
+// against ImageReplacer choosing a rule and handing out a view of bytes it
+// read once. Each request reads the first 64 bytes of its response.
+
+#include "ImageReplacer.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+int main(int argc, char** argv)
+{
+    size_t requests = Iterations(IsQuickRun(argc, argv), 200000);
+    const char directory[] = "ImageReplacerBenchmark.files";
+    std::filesystem::create_directories(directory);
+    std::filesystem::path small = std::filesystem::path(directory) / "small.png";
+    std::filesystem::path any = std::filesystem::path(directory) / "any.jpg";
+    // The sizes of the sample's AppStartPageBackground.png and
+    // EdgeWebView2-80.jpg.
+    std::ofstream(small, std::ios::binary) << std::string(62111, 'p');
+    std::ofstream(any, std::ios::binary) << std::string(2770, 'j');
+    const wchar_t* uris[] = {
+        L"https://example.com/images/photo.jpg?w=640", L"https://example.com/a/b/icon.png?w=64"};
+    size_t total = 0;
+    uint8_t buffer[64];
+
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            std::vector<uint8_t> bytes;
+            for (size_t i = 0; i < requests; ++i)
+            {
+                AssetCache::LoadFile(any.wstring(), &bytes);
+                total += bytes[0];
+            }
+        });
+    ReportRate("open and read the file per request", requests, seconds);
+
+    ImageReplacer replacer(
+        {{"image/png", 320, small.wstring()}, {"image/*", 0, any.wstring()}},
+        ImageReplacer::Options());
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < requests; ++i)
+            {
+                ImageReplacer::Replacement replacement;
+                replacer.GetReplacement(uris[i % 2], true, &replacement);
+                AssetStream stream(std::move(replacement.asset));
+                total += stream.Read(buffer, sizeof(buffer));
+            }
+        });
+    ReportRate("ImageReplacer, rule and view", requests, seconds);
+    KeepResult(total);
+
+    ImageReplacer::Stats stats = replacer.GetStats();
+    std::printf(
+        "  %llu requests, %llu file checks, %llu loads\n",
+        static_cast<unsigned long long>(stats.requests),
+        static_cast<unsigned long long>(stats.checks),
+        static_cast<unsigned long long>(stats.loads));
+    std::filesystem::remove_all(directory);
+    return 0;
+}
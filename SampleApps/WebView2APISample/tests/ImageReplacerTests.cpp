@@ -0,0 +1,169 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ImageReplacer.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+const char c_directory[] = "ImageReplacerTests.files";
+
+// Write a file of size bytes under c_directory, and return its path.
+std::wstring WriteImage(const std::string& name, size_t size)
+{
+    std::filesystem::create_directories(c_directory);
+    std::filesystem::path path = std::filesystem::path(c_directory) / name;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << std::string(size, 'i');
+    return path.wstring();
+}
+
+ImageReplacer::Options ShortCheckInterval()
+{
+    ImageReplacer::Options options;
+    options.checkInterval = std::chrono::milliseconds(50);
+    return options;
+}
+
+void TestParseRules()
+{
+    std::vector<ImageReplacer::Rule> rules = ImageReplacer::ParseRules(
+        "# comment\n\nimage/PNG 320 small.png\r\nimage/png 0 x\nbad\nimage/gif 12a x\n"
+        "image/* * default.jpg\nimage/* * a b\n");
+    TEST_CHECK(rules.size() == 2);
+    if (rules.size() == 2)
+    {
+        TEST_CHECK(rules[0].mimeType == "image/png" && rules[0].maxWidth == 320);
+        TEST_CHECK(rules[0].path == L"small.png");
+        TEST_CHECK(rules[1].mimeType == "image/*" && rules[1].maxWidth == 0);
+        TEST_CHECK(rules[1].path == L"default.jpg");
+    }
+    TEST_CHECK(ImageReplacer::ParseRules("").empty());
+}
+
+void TestRequestedWidth()
+{
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png?x=1&w=200#f") == 200);
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png?Width=64") == 64);
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png?w=&w=9") == 9);
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png#w=64") == 0);
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png?sw=64") == 0);
+    TEST_CHECK(ImageReplacer::GetRequestedWidth(L"https://a/b.png") == 0);
+}
+
+// Rules choose by type and width, and each file is read once however many
+// requests it answers.
+void TestRules()
+{
+    std::wstring small = WriteImage("small.png", 50);
+    std::wstring any = WriteImage("any.jpg", 100);
+    ImageReplacer replacer(
+        {{"image/png", 320, small}, {"image/*", 0, any}}, ImageReplacer::Options());
+    ImageReplacer::Replacement first;
+    ImageReplacer::Replacement replacement;
+    TEST_CHECK(replacer.GetReplacement(L"https://x/y.png?w=100", true, &first));
+    TEST_CHECK(first.contentType == "image/png" && first.asset->size == 50);
+    TEST_CHECK(replacer.GetReplacement(L"https://x/y.png?w=1000", true, &replacement));
+    TEST_CHECK(replacement.contentType == "image/jpeg" && replacement.asset->size == 100);
+    TEST_CHECK(replacer.GetReplacement(L"https://x/y.png", true, &replacement));
+    TEST_CHECK(replacement.asset->size == 100);
+    // image/* covers image requests whose URL has no image extension.
+    TEST_CHECK(replacer.GetReplacement(L"https://x/photo.php?id=1", true, &replacement));
+    TEST_CHECK(replacer.GetReplacement(L"https://x/image", true, &replacement));
+    TEST_CHECK(replacement.asset->size == 100);
+    // Only image requests are replaced.
+    TEST_CHECK(!replacer.GetReplacement(L"https://x/y.png", false, &replacement));
+    TEST_CHECK(replacer.GetReplacement(L"https://x/z.png?width=64", true, &replacement));
+    TEST_CHECK(replacement.asset == first.asset);
+
+    ImageReplacer::Stats stats = replacer.GetStats();
+    TEST_CHECK(stats.requests == 7 && stats.loads == 2 && stats.failedLoads == 0);
+
+    // No rule applies.
+    ImageReplacer narrow({{"image/png", 0, small}}, ImageReplacer::Options());
+    TEST_CHECK(!narrow.GetReplacement(L"https://x/y.gif", true, &replacement));
+}
+
+// A changed file is read again after the check interval; the views of the old
+// bytes stay valid, and a file that goes missing keeps being served.
+void TestRefresh()
+{
+    std::wstring path = WriteImage("changing.jpg", 100);
+    ImageReplacer replacer({{"image/*", 0, path}}, ShortCheckInterval());
+    ImageReplacer::Replacement before;
+    ImageReplacer::Replacement after;
+    TEST_CHECK(replacer.GetReplacement(L"a.jpg", true, &before));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    TEST_CHECK(replacer.GetReplacement(L"a.jpg", true, &after) && after.asset == before.asset);
+    TEST_CHECK(replacer.GetStats().loads == 1);
+
+    std::ofstream(std::filesystem::path(path), std::ios::binary | std::ios::app) << "extra";
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    TEST_CHECK(replacer.GetReplacement(L"a.jpg", true, &after) && after.asset != before.asset);
+    TEST_CHECK(after.asset->size == 105 && before.asset->size == 100);
+    AssetStream oldView(before.asset);
+    char byte = 0;
+    TEST_CHECK(oldView.Read(&byte, 1) == 1 && byte == 'i');
+    TEST_CHECK(replacer.GetStats().loads == 2);
+
+    std::filesystem::remove(path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    ImageReplacer::Replacement missing;
+    TEST_CHECK(replacer.GetReplacement(L"a.jpg", true, &missing));
+    TEST_CHECK(missing.asset == after.asset);
+
+    ImageReplacer neverRead({{"image/*", 0, L"ImageReplacerTests.missing.jpg"}}, {});
+    TEST_CHECK(!neverRead.GetReplacement(L"a.jpg", true, &missing));
+    TEST_CHECK(neverRead.GetStats().checks == 1 && neverRead.GetStats().loads == 0);
+}
+
+// Requests from several threads share one read of the file.
+void TestThreads()
+{
+    std::wstring path = WriteImage("shared.jpg", 1000);
+    ImageReplacer replacer({{"image/*", 0, path}}, ShortCheckInterval());
+    std::vector<std::thread> threads;
+    std::vector<AssetPtr> assets(4);
+    for (size_t i = 0; i < assets.size(); ++i)
+    {
+        threads.emplace_back(
+            [&, i]()
+            {
+                for (int request = 0; request < 1000; ++request)
+                {
+                    ImageReplacer::Replacement replacement;
+                    replacer.GetReplacement(L"https://x/a.jpg", true, &replacement);
+                    assets[i] = replacement.asset;
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (const AssetPtr& asset : assets)
+    {
+        TEST_CHECK(asset && asset == assets[0]);
+    }
+    TEST_CHECK(replacer.GetStats().requests == 4000 && replacer.GetStats().loads == 1);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestParseRules);
+    RUN_TEST(TestRequestedWidth);
+    RUN_TEST(TestRules);
+    RUN_TEST(TestRefresh);
+    RUN_TEST(TestThreads);
+    std::filesystem::remove_all(c_directory);
+    return ReportTestResults();
+}
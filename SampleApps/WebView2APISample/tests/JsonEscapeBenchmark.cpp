@@ -0,0 +1,171 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares AppendJsonEscaped with the per-character loop of the event
+// monitor's old EncodeQuote, on request header values and URLs, for UTF-8,
+// UTF-16 and wide strings. The monitor escapes std::wstring, which is UTF-16 on
+// Windows, so the UTF-16 rows measure the code it runs there; wchar_t is 32
+// bits elsewhere.
+
+#include "JsonEscape.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+const char* const c_headerValues[] = {
+    "*/*",
+    "gzip, deflate, br, zstd",
+    "en-US,en;q=0.9,de;q=0.8",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+    "Chrome/120.0.0.0 Safari/537.36 Edg/120.0.0.0",
+    "\"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Microsoft Edge\";v=\"120\"",
+    "max-age=0",
+    "session=3a7f9c1e2b4d6f8a0c2e4a6b8d0f1e3c; theme=dark; consent=yes",
+};
+
+const char* const c_urls[] = {
+    "https://www.example.com/",
+    "https://www.example.com/assets/scripts/app.bundle.js?v=20240131&lang=en-US",
+    "https://cdn.example.net/images/products/2024/01/31/large/sku-1234567890.webp",
+    "https://api.example.com/v2/search?q=json%20escaping&page=3&sort=relevance&fields="
+    "title,url,snippet",
+    "https://fonts.example.com/css2?family=Segoe+UI:wght@400;600&display=swap",
+    "data:text/plain;base64,SGVsbG8sIFdvcmxkIQ==",
+};
+
+std::vector<std::string> MakeCorpus(const char* const* begin, const char* const* end)
+{
+    std::vector<std::string> corpus;
+    for (int copy = 0; copy < 64; ++copy)
+    {
+        for (const char* const* item = begin; item != end; ++item)
+        {
+            corpus.emplace_back(*item);
+        }
+    }
+    return corpus;
+}
+
+template <typename CharT>
+std::vector<std::basic_string<CharT>> Widen(const std::vector<std::string>& corpus)
+{
+    std::vector<std::basic_string<CharT>> wide;
+    for (const std::string& value : corpus)
+    {
+        wide.emplace_back(value.begin(), value.end());
+    }
+    return wide;
+}
+
+// The loop of the old EncodeQuote, which missed the other control characters.
+template <typename CharT> void AppendEscapedPerCharacter(
+    std::basic_string<CharT>& out, const std::basic_string<CharT>& raw)
+{
+    for (CharT c : raw)
+    {
+        switch (c)
+        {
+        case '\b':
+            out.push_back('\\');
+            out.push_back('b');
+            break;
+        case '\f':
+            out.push_back('\\');
+            out.push_back('f');
+            break;
+        case '\n':
+            out.push_back('\\');
+            out.push_back('n');
+            break;
+        case '\r':
+            out.push_back('\\');
+            out.push_back('r');
+            break;
+        case '\t':
+            out.push_back('\\');
+            out.push_back('t');
+            break;
+        case '\\':
+            out.push_back('\\');
+            out.push_back('\\');
+            break;
+        case '"':
+            out.push_back('\\');
+            out.push_back('"');
+            break;
+        default:
+            out.push_back(c);
+        }
+    }
+}
+
+template <typename CharT, typename Escape> void Run(
+    const char* name, const std::vector<std::basic_string<CharT>>& corpus, size_t passes,
+    Escape escape)
+{
+    size_t bytes = 0;
+    for (const auto& value : corpus)
+    {
+        bytes += value.size() * sizeof(CharT);
+    }
+    std::basic_string<CharT> out;
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                for (const auto& value : corpus)
+                {
+                    out.clear();
+                    escape(out, value);
+                    total += out.size();
+                }
+            }
+        });
+    KeepResult(total);
+    std::printf(
+        "%-48s %10.1f ns/string %8.0f MB/s\n", name, seconds * 1e9 / (passes * corpus.size()),
+        bytes * passes / seconds / 1e6);
+}
+
+template <typename CharT> void RunCorpus(
+    const char* vectorName, const char* loopName,
+    const std::vector<std::basic_string<CharT>>& corpus, size_t passes)
+{
+    Run(vectorName, corpus, passes,
+        [](std::basic_string<CharT>& out, const std::basic_string<CharT>& value)
+        { AppendJsonEscaped(out, value); });
+    Run(loopName, corpus, passes,
+        [](std::basic_string<CharT>& out, const std::basic_string<CharT>& value)
+        { AppendEscapedPerCharacter(out, value); });
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t passes = Iterations(IsQuickRun(argc, argv), 20000);
+    std::vector<std::string> headers =
+        MakeCorpus(std::begin(c_headerValues), std::end(c_headerValues));
+    std::vector<std::string> urls = MakeCorpus(std::begin(c_urls), std::end(c_urls));
+
+    RunCorpus("headers, UTF-8, AppendJsonEscaped", "headers, UTF-8, per character", headers,
+        passes);
+    RunCorpus("URLs, UTF-8, AppendJsonEscaped", "URLs, UTF-8, per character", urls, passes);
+    RunCorpus("headers, UTF-16, AppendJsonEscaped", "headers, UTF-16, per character",
+        Widen<char16_t>(headers), passes);
+    RunCorpus("URLs, UTF-16, AppendJsonEscaped", "URLs, UTF-16, per character",
+        Widen<char16_t>(urls), passes);
+    RunCorpus("headers, wide, AppendJsonEscaped", "headers, wide, per character",
+        Widen<wchar_t>(headers), passes);
+    RunCorpus("URLs, wide, AppendJsonEscaped", "URLs, wide, per character",
+        Widen<wchar_t>(urls), passes);
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonEscape.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A plain escaper to compare with, which writes the same short escapes.
+template <typename CharT> std::basic_string<CharT> ReferenceEscape(
+    const std::basic_string<CharT>& value)
+{
+    static const char c_hexDigits[] = "0123456789abcdef";
+    std::basic_string<CharT> out;
+    for (CharT c : value)
+    {
+        uint32_t unit = static_cast<std::make_unsigned_t<CharT>>(c);
+        const char* escape = nullptr;
+        switch (unit)
+        {
+        case '\b':
+            escape = "\\b";
+            break;
+        case '\f':
+            escape = "\\f";
+            break;
+        case '\n':
+            escape = "\\n";
+            break;
+        case '\r':
+            escape = "\\r";
+            break;
+        case '\t':
+            escape = "\\t";
+            break;
+        case '\\':
+            escape = "\\\\";
+            break;
+        case '"':
+            escape = "\\\"";
+            break;
+        }
+        if (escape)
+        {
+            out.append(escape, escape + 2);
+        }
+        else if (unit < 0x20)
+        {
+            const char hex[] = {
+                '\\', 'u', '0', '0', c_hexDigits[unit >> 4], c_hexDigits[unit & 0xF]};
+            out.append(hex, hex + 6);
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+template <typename CharT> size_t ReferenceFind(const std::basic_string<CharT>& value)
+{
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        uint32_t unit = static_cast<std::make_unsigned_t<CharT>>(value[i]);
+        if (unit < 0x20 || unit == '"' || unit == '\\')
+        {
+            return i;
+        }
+    }
+    return value.size();
+}
+
+void TestKnownEscapes()
+{
+    std::string narrow;
+    AppendJsonEscaped(narrow, std::string_view("a\"b\\c\x01\n\x1f\xc3\xa9 end", 14));
+    TEST_CHECK(narrow == "a\\\"b\\\\c\\u0001\\n\\u001f\xc3\xa9 end");
+
+    std::wstring wide;
+    AppendJsonEscaped(wide, L"x\ty\x7f\x7é€");
+    TEST_CHECK(wide == L"x\\ty\x7f\\u0007é€");
+
+    TEST_CHECK(FindJsonEscape(std::string_view("no escapes here")) == 15);
+    TEST_CHECK(FindJsonEscape(std::wstring_view(L"")) == 0);
+
+    std::u16string utf16;
+    AppendJsonEscaped(utf16, u"x\ty\x7f\x7\u00e9\u20ac\"");
+    TEST_CHECK(utf16 == u"x\\ty\x7f\\u0007\u00e9\u20ac\\\"");
+}
+
+// Appending keeps what is already in the output.
+void TestAppends()
+{
+    std::string out = "prefix:";
+    AppendJsonEscaped(out, std::string_view("\""));
+    AppendJsonEscaped(out, std::string_view(""));
+    TEST_CHECK(out == "prefix:\\\"");
+}
+
+// Random strings, mostly of plain characters, with escapes at every position
+// and of every length around the vector widths, against the reference.
+template <typename CharT> void FuzzAgainstReference(uint32_t maxUnit)
+{
+    std::mt19937 random(1);
+    for (int iteration = 0; iteration < 100000; ++iteration)
+    {
+        size_t length = random() % 100;
+        std::basic_string<CharT> value(length, CharT('a'));
+        for (CharT& c : value)
+        {
+            uint32_t kind = random() % 16;
+            uint32_t unit = kind < 12  ? 0x20 + random() % 0x60
+                            : kind == 12 ? random() % 0x20
+                            : kind == 13 ? (random() % 2 ? '"' : '\\')
+                                         : 0x80 + random() % (maxUnit - 0x80);
+            c = static_cast<CharT>(unit);
+        }
+        std::basic_string<CharT> escaped;
+        AppendJsonEscaped(escaped, value);
+        TEST_CHECK(escaped == ReferenceEscape(value));
+        TEST_CHECK(
+            FindJsonEscape(std::basic_string_view<CharT>(value)) == ReferenceFind(value));
+        if (g_testFailures)
+        {
+            return;
+        }
+    }
+}
+
+void TestUtf8AgainstReference()
+{
+    FuzzAgainstReference<char>(0x100);
+}
+
+// wchar_t is UTF-16 on Windows and 32 bits elsewhere, where code units above
+// 0x7FFFFFFF check the signed compare of the 32-bit vector path.
+void TestWideAgainstReference()
+{
+    FuzzAgainstReference<wchar_t>(sizeof(wchar_t) == 2 ? 0x10000 : 0xFFFFFFFF);
+}
+
+void TestUtf16AgainstReference()
+{
+    FuzzAgainstReference<char16_t>(0x10000);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestKnownEscapes);
+    RUN_TEST(TestAppends);
+    RUN_TEST(TestUtf8AgainstReference);
+    RUN_TEST(TestWideAgainstReference);
+    RUN_TEST(TestUtf16AgainstReference);
+    return ReportTestResults();
+}
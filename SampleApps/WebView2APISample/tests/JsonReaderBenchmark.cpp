@@ -0,0 +1,140 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares JsonDocument with the GetJSONStringField and GetJSONIntegerField
+// helpers it replaced, on Target.attachedToTarget and
+// Runtime.consoleAPICalled payloads in the form the DevTools protocol sends
+// them, reading the fields the sample reads.
+
+#include "JsonReader.h"
+
+#include <cstdio>
+#include <cwchar>
+#include <string>
+
+#include "Benchmark.h"
+
+namespace
+{
+// The old helpers from ScriptComponent.cpp, with _wtoi64 spelled portably.
+std::wstring GetJSONStringField(const wchar_t* JsonMessage, const wchar_t* fieldName)
+{
+    std::wstring message(JsonMessage);
+    std::wstring startSubStr = L"\"";
+    startSubStr.append(fieldName);
+    startSubStr.append(L"\":\"");
+    std::string::size_type start = message.find(startSubStr);
+    if (start == std::wstring::npos)
+        return std::wstring();
+    start += startSubStr.length();
+    std::string::size_type end = message.find(L'\"', start);
+    if (end == std::wstring::npos)
+        return std::wstring();
+    return message.substr(start, end - start);
+}
+
+int64_t GetJSONIntegerField(const wchar_t* JsonMessage, const wchar_t* fieldName)
+{
+    std::wstring message(JsonMessage);
+    std::wstring startSubStr = L"\"";
+    startSubStr.append(fieldName);
+    startSubStr.append(L"\":");
+    std::string::size_type start = message.find(startSubStr);
+    if (start == std::wstring::npos)
+        return 0;
+    start += startSubStr.length();
+    return std::wcstoll(message.substr(start).c_str(), nullptr, 10);
+}
+
+const wchar_t c_attachedToTarget[] =
+    LR"({"sessionId":"7D3A6C0C4E7F2B1A9E0D5C8B3A2F1E0D","targetInfo":{"targetId":)"
+    LR"("C1F0A93B7E2D4C6A8B0E1F2D3C4B5A69","type":"worker","title":)"
+    LR"("https://appassets.example/ScenarioDedicatedWorker.js","url":)"
+    LR"("https://appassets.example/ScenarioDedicatedWorker.js","attached":true,)"
+    LR"("canAccessOpener":false,"browserContextId":"2F4E6A8C0B1D3F5E7A9C0B2D4F6E8A1C"},)"
+    LR"("waitingForDebugger":false})";
+
+std::wstring MakeConsoleApiCalled(size_t messageLength)
+{
+    return LR"({"type":"log","args":[{"type":"string","value":")" +
+           std::wstring(messageLength, L'x') +
+           LR"("},{"type":"object","className":"Object","description":"Object",)"
+           LR"("objectId":"-1234567890123456789.4.5","preview":{"type":"object",)"
+           LR"("description":"Object","overflow":false,"properties":[{"name":"a",)"
+           LR"("type":"number","value":"1"},{"name":"b","type":"string","value":"two"}]}}],)"
+           LR"("executionContextId":4,"timestamp":1712345678901.123,"stackTrace":)"
+           LR"({"callFrames":[{"functionName":"","scriptId":"35","url":)"
+           LR"("https://appassets.example/page.html","lineNumber":12,"columnNumber":16}]}})";
+}
+
+template <typename Function> void Measure(const char* name, size_t iterations, Function&& read)
+{
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                total += read();
+            }
+        });
+    KeepResult(total);
+    ReportRate(name, iterations, seconds);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t iterations = Iterations(IsQuickRun(argc, argv), 200000);
+    JsonDocument document;
+
+    Measure(
+        "attachedToTarget, old helpers", iterations,
+        []()
+        {
+            return GetJSONStringField(c_attachedToTarget, L"sessionId").size() +
+                   GetJSONStringField(c_attachedToTarget, L"targetId").size() +
+                   GetJSONStringField(c_attachedToTarget, L"type").size() +
+                   GetJSONStringField(c_attachedToTarget, L"url").size();
+        });
+    Measure(
+        "attachedToTarget, JsonDocument", iterations,
+        [&]()
+        {
+            document.Parse(c_attachedToTarget);
+            JsonValue root = document.GetRoot();
+            JsonValue targetInfo = root[L"targetInfo"];
+            return root[L"sessionId"].GetStringOr().size() +
+                   targetInfo[L"targetId"].GetStringOr().size() +
+                   targetInfo[L"type"].GetStringOr().size() +
+                   targetInfo[L"url"].GetStringOr().size();
+        });
+
+    for (size_t messageLength : {size_t(20), size_t(2000), size_t(100000)})
+    {
+        std::wstring console = MakeConsoleApiCalled(messageLength);
+        size_t consoleIterations = iterations * 20 / (20 + messageLength / 100);
+        std::string suffix = ", " + std::to_string(console.size()) + " chars";
+        Measure(
+            ("consoleAPICalled, old helpers" + suffix).c_str(), consoleIterations,
+            [&]()
+            {
+                return GetJSONStringField(console.c_str(), L"type").size() +
+                       static_cast<size_t>(
+                           GetJSONIntegerField(console.c_str(), L"executionContextId"));
+            });
+        Measure(
+            ("consoleAPICalled, JsonDocument" + suffix).c_str(), consoleIterations,
+            [&]()
+            {
+                document.Parse(console);
+                JsonValue root = document.GetRoot();
+                int64_t context = 0;
+                root[L"executionContextId"].GetInt64(&context);
+                return root[L"type"].GetStringOr().size() + root[L"args"].GetRawJson().size() +
+                       static_cast<size_t>(context);
+            });
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonReader.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "TestHarness.h"
+
+namespace
+{
+struct ConformanceCase
+{
+    const char* name;
+    const char* json;
+};
+
+// Cases from JSONTestSuite (https://github.com/nst/JSONTestSuite), named after
+// its files. y_ cases must be accepted and n_ cases rejected.
+const ConformanceCase c_accepted[] = {
+    {"y_array_empty", "[]"},
+    {"y_object_empty", "{}"},
+    {"y_array_with_1_and_newline", "[1\n]"},
+    {"y_array_with_leading_space", " [1]"},
+    {"y_structure_whitespace_array", " [] "},
+    {"y_number_0e1", "[0e1]"},
+    {"y_number_minus_zero", "[-0]"},
+    {"y_number_negative_one", "[-1]"},
+    {"y_number_real_capital_e", "[1E22]"},
+    {"y_number_real_fraction_exponent", "[123.456e78]"},
+    {"y_number_real_neg_exp", "[1e-2]"},
+    {"y_number_real_pos_exponent", "[1e+2]"},
+    {"y_number_huge_exp", "[0.4e00669999999999999999999999999999999999999999999999999]"},
+    {"y_number_very_big_negative_int", "[-237462374673276894279832749832423479823246327846]"},
+    {"y_structure_lonely_int", "42"},
+    {"y_structure_lonely_string", "\"asd\""},
+    {"y_structure_lonely_null", "null"},
+    {"y_structure_lonely_true", "true"},
+    {"y_structure_trailing_newline", "[\"a\"]\n"},
+    {"y_string_allowed_escapes", "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"]"},
+    {"y_string_escaped_null", "[\"a\\u0000b\"]"},
+    {"y_string_surrogates_U+1D11E_MUSICAL_SYMBOL_G_CLEF", "[\"\\uD834\\uDd1e\"]"},
+    {"y_string_1_2_3_bytes_UTF-8_sequences", "[\"\\u0060\\u012a\\u12AB\"]"},
+    {"y_string_utf8", "[\"\xe2\x82\xac\xf0\x9d\x84\x9e\"]"},
+    {"y_string_unescaped_char_delete", "[\"\x7f\"]"},
+    {"y_string_accepted_surrogate_pair", "[\"\\uD801\\udc37\"]"},
+    {"y_string_lone_second_surrogate", "[\"\\uDFAA\"]"},
+    {"y_object_duplicated_key", "{\"a\":\"b\",\"a\":\"c\"}"},
+    {"y_object_empty_key", "{\"\":0}"},
+    {"y_object_with_newlines", "{\n\"a\": \"b\"\n}"},
+    {"y_object_extreme_numbers", "{ \"min\": -1.0e+28, \"max\": 1.0e+28 }"},
+    {"y_structure_true_in_array", "[true]"},
+    {"y_array_heterogeneous", "[null, 1, \"1\", {}]"},
+    {"y_object_simple", "{\"a\":[]}"},
+};
+
+const ConformanceCase c_rejected[] = {
+    {"n_structure_no_data", ""},
+    {"n_array_unclosed", "["},
+    {"n_structure_lone-invalid-utf-8", "\xe5"},
+    {"n_array_extra_comma", "[\"\",]"},
+    {"n_array_just_comma", "[,]"},
+    {"n_array_double_comma", "[1,,2]"},
+    {"n_array_1_true_without_comma", "[1 true]"},
+    {"n_array_unclosed_with_object_inside", "[{}"},
+    {"n_array_incomplete", "[\"x\""},
+    {"n_object_trailing_comma", "{\"id\":0,}"},
+    {"n_object_missing_value", "{\"a\":"},
+    {"n_object_missing_colon", "{\"a\" b}"},
+    {"n_object_non_string_key", "{1:1}"},
+    {"n_object_single_quote", "{'a':0}"},
+    {"n_object_unquoted_key", "{a: \"b\"}"},
+    {"n_object_bracket_key", "{[: \"x\"}\n"},
+    {"n_number_with_leading_zero", "[012]"},
+    {"n_number_neg_int_starting_with_zero", "[-012]"},
+    {"n_number_minus_space_1", "[- 1]"},
+    {"n_number_real_without_fractional_part", "[1.]"},
+    {"n_number_starting_with_dot", "[.123]"},
+    {"n_number_0_capital_E", "[0E]"},
+    {"n_number_0_capital_E+", "[0E+]"},
+    {"n_number_+1", "[+1]"},
+    {"n_number_hex_1_digit", "[0x1]"},
+    {"n_number_NaN", "[NaN]"},
+    {"n_number_infinity", "[Infinity]"},
+    {"n_incomplete_true", "[tru]"},
+    {"n_incomplete_null", "[nul]"},
+    {"n_string_unescaped_tab", "[\"\t\"]"},
+    {"n_string_unescaped_newline", "[\"new\nline\"]"},
+    {"n_string_escape_x", "[\"\\x00\"]"},
+    {"n_string_incomplete_surrogate_escape_invalid", "[\"\\uD800\\uD800\\x\"]"},
+    {"n_string_1_surrogate_then_escape_u1", "[\"\\uD800\\u1\"]"},
+    {"n_string_single_quote", "['single quote']"},
+    {"n_string_no_quotes_with_bad_escape", "[\\n]"},
+    {"n_string_invalid_utf8_after_escape", "[\"\\\xe5\"]"},
+    {"n_string_unclosed", "[\"a"},
+    {"n_structure_trailing_#", "{\"a\":\"b\"}#{}"},
+    {"n_structure_double_array", "[][]"},
+    {"n_structure_object_followed_by_closing_object", "{}}"},
+    {"n_structure_array_with_extra_array_close", "[1]]"},
+    {"n_structure_close_unopened_array", "1]"},
+    {"n_structure_UTF8_BOM_no_data", "\xef\xbb\xbf"},
+    {"n_structure_capitalized_True", "[True]"},
+    {"n_structure_object_with_trailing_garbage", "{\"a\": true} \"x\""},
+    {"n_structure_mismatched_brackets", "[1}"},
+    // Invalid UTF-8 inside strings, which the reader checks in UTF-8 text.
+    {"n_string_invalid_utf-8", "[\"\xff\"]"},
+    {"n_string_overlong_sequence_2_bytes", "[\"\xc0\xaf\"]"},
+    {"n_string_UTF-16_surrogate_in_UTF-8", "[\"\xed\xa0\x80\"]"},
+};
+
+std::wstring Widen(const char* text)
+{
+    std::string narrow(text);
+    return std::wstring(narrow.begin(), narrow.end());
+}
+
+bool IsAscii(const char* text)
+{
+    for (; *text; ++text)
+    {
+        if (static_cast<unsigned char>(*text) >= 0x80)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TestConformance()
+{
+    for (const ConformanceCase& testCase : c_accepted)
+    {
+        Utf8JsonDocument utf8;
+        JsonDocument wide;
+        bool accepted = utf8.Parse(testCase.json) && utf8.GetRoot().Exists();
+        if (IsAscii(testCase.json))
+        {
+            accepted = accepted && wide.Parse(Widen(testCase.json));
+        }
+        if (!accepted)
+        {
+            std::fprintf(stderr, "rejected %s\n", testCase.name);
+        }
+        TEST_CHECK(accepted);
+    }
+    for (const ConformanceCase& testCase : c_rejected)
+    {
+        Utf8JsonDocument utf8;
+        JsonDocument wide;
+        bool rejected = !utf8.Parse(testCase.json) && !utf8.GetRoot().Exists();
+        if (IsAscii(testCase.json))
+        {
+            rejected = rejected && !wide.Parse(Widen(testCase.json));
+        }
+        if (!rejected)
+        {
+            std::fprintf(stderr, "accepted %s\n", testCase.name);
+        }
+        TEST_CHECK(rejected);
+    }
+}
+
+// Nesting deeper than c_maxDepth is rejected rather than overflowing the stack.
+void TestDepthLimit()
+{
+    Utf8JsonDocument document;
+    TEST_CHECK(!document.Parse(std::string(100000, '[')));
+    std::string deep = std::string(1000, '[') + std::string(1000, ']');
+    TEST_CHECK(document.Parse(deep));
+    constexpr size_t c_maxDepth = Utf8JsonDocument::c_maxDepth;
+    TEST_CHECK(document.Parse(std::string(c_maxDepth, '[') + "1" + std::string(c_maxDepth, ']')));
+    TEST_CHECK(!document.Parse(
+        std::string(c_maxDepth + 1, '[') + "1" + std::string(c_maxDepth + 1, ']')));
+}
+
+// The fields of Target.attachedToTarget.
+void TestTargetAttached()
+{
+    std::wstring message =
+        LR"({"sessionId":"S1","targetInfo":{"targetId":"T\"1","type":"worker","title":"w",)"
+        LR"("url":"https://a/b.js","attached":true,"canAccessOpener":false,)"
+        LR"("browserContextId":"B"},"waitingForDebugger":false})";
+    JsonDocument document;
+    TEST_CHECK(document.Parse(message));
+    JsonValue root = document.GetRoot();
+    TEST_CHECK(root[L"sessionId"].GetStringOr() == L"S1");
+    TEST_CHECK(root[L"targetInfo"][L"targetId"].GetStringOr() == L"T\"1");
+    TEST_CHECK(root[L"targetInfo"][L"url"].GetStringOr() == L"https://a/b.js");
+    TEST_CHECK(!root[L"targetId"].Exists());
+    TEST_CHECK(root[L"targetId"][L"deeper"].GetStringOr(L"none") == L"none");
+
+    bool waiting = true;
+    TEST_CHECK(root[L"waitingForDebugger"].GetBool(&waiting) && !waiting);
+    std::wstring_view targetInfo = root[L"targetInfo"].GetRawJson();
+    TEST_CHECK(targetInfo.front() == L'{' && targetInfo.back() == L'}');
+}
+
+void TestNumbers()
+{
+    JsonDocument document;
+    TEST_CHECK(document.Parse(
+        L"{\"usedSize\":123456789,\"totalSize\":2.5e8,\"negative\":-7,\"huge\":1e400}"));
+    JsonValue root = document.GetRoot();
+    int64_t integer = 0;
+    double real = 0;
+    TEST_CHECK(root[L"usedSize"].GetInt64(&integer) && integer == 123456789);
+    TEST_CHECK(!root[L"totalSize"].GetInt64(&integer));
+    TEST_CHECK(root[L"totalSize"].GetDouble(&real) && real == 2.5e8);
+    TEST_CHECK(root[L"negative"].GetInt64(&integer) && integer == -7);
+
+    uint64_t unsignedInteger = 0;
+    Utf8JsonDocument limits;
+    TEST_CHECK(limits.Parse("[18446744073709551615,18446744073709551616,-1]"));
+    TEST_CHECK(
+        limits.GetRoot().GetElement(0).GetUInt64(&unsignedInteger) &&
+        unsignedInteger == UINT64_MAX);
+    TEST_CHECK(!limits.GetRoot().GetElement(1).GetUInt64(&unsignedInteger));
+    TEST_CHECK(!limits.GetRoot().GetElement(2).GetUInt64(&unsignedInteger));
+    TEST_CHECK(!root[L"usedSize"].GetString(nullptr));
+}
+
+// Escapes, including surrogate pairs, are decoded in the text's encoding.
+void TestEscapes()
+{
+    JsonDocument document;
+    TEST_CHECK(document.Parse(
+        L"{\"k\\u0065y\":\"a\\u00e9\\ud83d\\ude00\\n\",\"arr\":[1,{\"x\":[2]},\"s\"]}"));
+    JsonValue root = document.GetRoot();
+    std::wstring emoji =
+        sizeof(wchar_t) == 2 ? std::wstring{wchar_t(0xD83D), wchar_t(0xDE00)} : L"\U0001F600";
+    TEST_CHECK(root[L"key"].GetStringOr() == L"a\u00e9" + emoji + L"\n");
+    TEST_CHECK(root[L"arr"].GetElement(2).GetStringOr() == L"s");
+    TEST_CHECK(root[L"arr"].GetElement(1)[L"x"].GetElement(0).GetType() == JsonType::Number);
+    TEST_CHECK(!root[L"arr"].GetElement(3).Exists());
+
+    Utf8JsonDocument utf8;
+    TEST_CHECK(utf8.Parse(R"({"a":"\u00e9\ud83d\ude00\ud800"})"));
+    TEST_CHECK(utf8.GetRoot()["a"].GetStringOr() == "\xc3\xa9\xf0\x9f\x98\x80\xef\xbf\xbd");
+}
+
+void TestIteration()
+{
+    JsonDocument document;
+    TEST_CHECK(document.Parse(L"{\"first\":1,\"second\":[1,2,3]}"));
+    int members = 0;
+    document.GetRoot().ForEachMember(
+        [&](std::wstring_view name, JsonValue)
+        {
+            TEST_CHECK(name == (members == 0 ? L"first" : L"second"));
+            ++members;
+            return true;
+        });
+    TEST_CHECK(members == 2);
+
+    int elements = 0;
+    document.GetRoot()[L"second"].ForEachElement([&](JsonValue) { return ++elements < 2; });
+    TEST_CHECK(elements == 2);
+}
+
+// An invalid document has no values, and says where it went wrong.
+void TestInvalidDocument()
+{
+    JsonDocument document;
+    TEST_CHECK(!document.Parse(L"{\"a\":1"));
+    TEST_CHECK(!document.GetRoot().Exists());
+    TEST_CHECK(!document.GetRoot()[L"a"].Exists());
+    TEST_CHECK(!document.Parse(L"[1, x]"));
+    TEST_CHECK(document.GetErrorOffset() == 4);
+    TEST_CHECK(!document.Parse(static_cast<const wchar_t*>(nullptr)));
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestConformance);
+    RUN_TEST(TestDepthLimit);
+    RUN_TEST(TestTargetAttached);
+    RUN_TEST(TestNumbers);
+    RUN_TEST(TestEscapes);
+    RUN_TEST(TestIteration);
+    RUN_TEST(TestInvalidDocument);
+    return ReportTestResults();
+}
@@ -0,0 +1,96 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares JsonStructuralIndex with Utf8JsonDocument on multi-megabyte
+// Runtime.consoleAPICalled payloads with large argument previews, reading
+// one member after the arguments. The same benchmark is built a second time
+// as JsonStructuralIndexScalarBenchmark, with the scalar loop instead of SSE2.
+
+#include "JsonStructuralIndex.h"
+
+#include <cstdio>
+#include <string>
+
+#include "Benchmark.h"
+
+namespace
+{
+// A consoleAPICalled event with the given number of object arguments, each
+// previewing 30 properties of valueLength characters.
+std::string MakeConsoleApiCalled(size_t arguments, size_t valueLength)
+{
+    std::string json = R"({"type":"log","args":[)";
+    for (size_t i = 0; i < arguments; ++i)
+    {
+        json += R"({"type":"object","className":"Object","preview":{"type":"object",)"
+                R"("overflow":true,"properties":[)";
+        for (size_t j = 0; j < 30; ++j)
+        {
+            json += R"({"name":"p)" + std::to_string(j) + R"(","type":"string","value":")" +
+                    std::string(valueLength, 'v') + R"("},)";
+        }
+        json += R"({"name":"n","type":"number","value":"1.5e3"}]}},)";
+    }
+    json += R"({"type":"string","value":"last"}],"executionContextId":7,)"
+            R"("timestamp":1712345678901.123})";
+    return json;
+}
+
+template <typename Read>
+void Measure(const char* name, const std::string& json, size_t iterations, Read&& read)
+{
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                total += read();
+            }
+        });
+    KeepResult(total);
+    std::printf(
+        "%-48s %10.2f GB/s\n", name,
+        seconds > 0 ? double(json.size()) * iterations / seconds / 1e9 : 0);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+#if defined(JSON_INDEX_NO_SSE2)
+    std::printf("scalar loop\n");
+#endif
+    JsonStructuralIndex index;
+    Utf8JsonDocument document;
+    struct Payload
+    {
+        size_t arguments;
+        size_t valueLength;
+    };
+    for (Payload payload : {Payload{20, 30}, Payload{200, 300}, Payload{500, 1000}})
+    {
+        std::string json = MakeConsoleApiCalled(payload.arguments, payload.valueLength);
+        size_t iterations = quick ? 1 : 1 + 200000000 / json.size();
+        index.Build(json);
+        std::printf(
+            "%.2f MB, %zu tokens, %zu iterations\n", json.size() / 1e6, index.GetTokenCount(),
+            iterations);
+        Measure(
+            "  JsonStructuralIndex", json, iterations,
+            [&]()
+            {
+                index.Build(json);
+                return index.GetRoot()["executionContextId"].GetRawJson().size();
+            });
+        Measure(
+            "  Utf8JsonDocument", json, iterations,
+            [&]()
+            {
+                document.Parse(json);
+                return document.GetRoot()["executionContextId"].GetRawJson().size();
+            });
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonStructuralIndex.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "TestHarness.h"
+
+namespace
+{
+// A description of a value and everything in it, read through either reader,
+// so that the two can be compared.
+template <typename Value> std::string Describe(Value value, int depth)
+{
+    std::string description(1, char('0' + int(value.GetType())));
+    if (depth > 60)
+    {
+        return description;
+    }
+    std::string_view text;
+    if (value.GetString(&text))
+    {
+        description += "s:" + std::string(text);
+    }
+    int64_t integer;
+    if (value.GetInt64(&integer))
+    {
+        description += "i:" + std::to_string(integer);
+    }
+    double number;
+    if (value.GetDouble(&number))
+    {
+        description += "d:" + std::to_string(number);
+    }
+    bool boolean;
+    if (value.GetBool(&boolean))
+    {
+        description += boolean ? "T" : "F";
+    }
+    description += "r:" + std::string(value.GetRawJson());
+    value.ForEachMember(
+        [&](std::string_view name, Value member)
+        {
+            description += "{" + std::string(name) + "=" + Describe(member, depth + 1);
+            description += value[std::string(name).c_str()].GetRawJson();
+            return true;
+        });
+    size_t index = 0;
+    value.ForEachElement(
+        [&](Value element)
+        {
+            description += "[" + Describe(element, depth + 1);
+            description += value.GetElement(index++).GetRawJson();
+            return true;
+        });
+    return description;
+}
+
+// The index must accept exactly what Utf8JsonDocument accepts, and read the
+// same values from it.
+bool MatchesReader(const std::string& json)
+{
+    Utf8JsonDocument document;
+    JsonStructuralIndex index;
+    bool valid = document.Parse(json);
+    if (index.Build(json) != valid)
+    {
+        return false;
+    }
+    return !valid || Describe(document.GetRoot(), 0) == Describe(index.GetRoot(), 0);
+}
+
+void TestConsoleApiCalled()
+{
+    std::string json =
+        R"({"type":"log","args":[{"type":"string","value":"a \"quoted\" \u00e9"},)"
+        R"({"type":"number","value":42,"description":"42"}],"executionContextId":3,)"
+        R"("timestamp":1712345678901.5})";
+    JsonStructuralIndex index;
+    TEST_CHECK(index.Build(json));
+    JsonIndexedValue root = index.GetRoot();
+    TEST_CHECK(root["type"].GetStringOr() == "log");
+    TEST_CHECK(root["args"].GetElement(0)["value"].GetStringOr() == "a \"quoted\" \xC3\xA9");
+    int64_t value = 0;
+    TEST_CHECK(root["args"].GetElement(1)["value"].GetInt64(&value) && value == 42);
+    TEST_CHECK(!root["args"].GetElement(2).Exists());
+    TEST_CHECK(root["executionContextId"].GetRawJson() == "3");
+    double timestamp = 0;
+    TEST_CHECK(root["timestamp"].GetDouble(&timestamp) && timestamp == 1712345678901.5);
+    TEST_CHECK(!root["timestamp"].GetInt64(&value));
+    TEST_CHECK(!root["missing"].Exists());
+}
+
+// Strings and runs of backslashes that cross the 64-byte blocks of stage 1.
+void TestBlockBoundaries()
+{
+    for (size_t length = 0; length < 140; ++length)
+    {
+        for (size_t backslashes = 0; backslashes < 6; ++backslashes)
+        {
+            std::string text = std::string(length, 'a') + std::string(backslashes, '\\');
+            TEST_CHECK(MatchesReader("[\"" + text + "\"]"));
+            TEST_CHECK(MatchesReader("[\"" + text + "\",1]"));
+            TEST_CHECK(MatchesReader("{\"" + text + "\":[" + std::string(length, ' ') + "]}"));
+        }
+    }
+}
+
+void TestInvalidDocuments()
+{
+    const char* const invalid[] = {
+        "", " ", "[", "]", "[1,]", "{\"a\"}", "{\"a\":}", "{1:2}", "[1 2]", "\"\\x\"",
+        "\"a\x01\"", "\"\xC3\"", "[tru]", "[nul]", "01", "1.", "-", "[1]x", "{}{}",
+        "\"unterminated",
+    };
+    JsonStructuralIndex index;
+    for (const char* json : invalid)
+    {
+        TEST_CHECK(!index.Build(json));
+        TEST_CHECK(!index.GetRoot().Exists());
+    }
+    TEST_CHECK(!index.Build("[1, 2, x]"));
+    TEST_CHECK(index.GetErrorOffset() == 7);
+
+    // The index is reusable after a failure.
+    TEST_CHECK(index.Build("[true]"));
+    bool value = false;
+    TEST_CHECK(index.GetRoot().GetElement(0).GetBool(&value) && value);
+}
+
+// As in JsonDocument, an empty array or object doesn't count toward the depth.
+void TestDepthLimit()
+{
+    constexpr size_t c_maxDepth = JsonStructuralIndex::c_maxDepth;
+    JsonStructuralIndex index;
+    auto nested = [](size_t depth)
+    {
+        return std::string(depth, '[') + "1" + std::string(depth, ']');
+    };
+    TEST_CHECK(index.Build(nested(c_maxDepth)));
+    TEST_CHECK(!index.Build(nested(c_maxDepth + 1)));
+    TEST_CHECK(MatchesReader(nested(c_maxDepth)) && MatchesReader(nested(c_maxDepth + 1)));
+}
+
+// Looking up a member skips large siblings without reading them.
+void TestLargeDocument()
+{
+    std::string json = "{\"args\":[";
+    for (int i = 0; i < 2000; ++i)
+    {
+        json += "{\"name\":\"p" + std::to_string(i) + "\",\"value\":\"" + std::string(300, 'v') +
+                "\"},";
+    }
+    json += "{}],\"executionContextId\":7}";
+    JsonStructuralIndex index;
+    TEST_CHECK(index.Build(json));
+    TEST_CHECK(index.GetRoot()["executionContextId"].GetRawJson() == "7");
+    TEST_CHECK(index.GetRoot()["args"].GetElement(1999)["name"].GetStringOr() == "p1999");
+    TEST_CHECK(MatchesReader(json));
+}
+
+// Random edits of small documents, compared with Utf8JsonDocument.
+void TestAgainstReader()
+{
+    const char* const seeds[] = {
+        R"({"a":[1,2,{"bA":"x\\y\"z"}],"c":-1.5e3,"d":true,"e":null,"f":"😀",)"
+        R"("k\u0065":"\ud83d\ude00"})",
+        "[[],{},[{}],\"\",0, 1e5 ,false]",
+        R"({"type":"log","args":[{"type":"string","value":"hello \\ world"}],)"
+        R"("executionContextId":3})",
+    };
+    const char alphabet[] = "{}[],:\"\\u0123456789abcdefe+-.tnl \t\n\x01\x80\xC3\xA9\xF0";
+    std::mt19937 random(11);
+    for (int iteration = 0; iteration < 50000; ++iteration)
+    {
+        std::string json = seeds[random() % 3];
+        if (random() % 4 == 0)
+        {
+            json.insert(json.find('"') + 1, std::string(random() % 130, 'x'));
+        }
+        for (unsigned edits = random() % 4; edits > 0; --edits)
+        {
+            size_t position = random() % (json.size() + 1);
+            char c = alphabet[random() % (sizeof(alphabet) - 1)];
+            switch (random() % 3)
+            {
+            case 0:
+                if (position < json.size())
+                {
+                    json.erase(position, 1);
+                }
+                break;
+            case 1:
+                json.insert(json.begin() + position, c);
+                break;
+            default:
+                if (position < json.size())
+                {
+                    json[position] = c;
+                }
+            }
+        }
+        TEST_CHECK(MatchesReader(json));
+    }
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestConsoleApiCalled);
+    RUN_TEST(TestBlockBoundaries);
+    RUN_TEST(TestInvalidDocuments);
+    RUN_TEST(TestDepthLimit);
+    RUN_TEST(TestLargeDocument);
+    RUN_TEST(TestAgainstReader);
+    return ReportTestResults();
+}
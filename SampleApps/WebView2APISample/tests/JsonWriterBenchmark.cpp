@@ -0,0 +1,192 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares JsonWriter with the string concatenation that the event monitor
+// used before it, on a WebResourceRequested event with typical request
+// headers, for time and heap allocations per event.
+
+#include "JsonWriter.h"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "Benchmark.h"
+
+namespace
+{
+struct Request
+{
+    std::wstring method;
+    std::wstring uri;
+    std::vector<std::pair<std::wstring, std::wstring>> headers;
+};
+
+Request MakeRequest()
+{
+    Request request;
+    request.method = L"GET";
+    request.uri = L"https://www.example.com/assets/scripts/app.bundle.js?v=20240131&lang=en-US";
+    request.headers = {
+        {L"Accept", L"*/*"},
+        {L"Accept-Encoding", L"gzip, deflate, br"},
+        {L"Accept-Language", L"en-US,en;q=0.9"},
+        {L"Referer", L"https://www.example.com/"},
+        {L"Sec-Fetch-Dest", L"script"},
+        {L"Sec-Fetch-Mode", L"no-cors"},
+        {L"Sec-Fetch-Site", L"same-origin"},
+        {L"User-Agent",
+         L"Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+         L"Chrome/120.0.0.0 Safari/537.36 Edg/120.0.0.0"},
+        {L"sec-ch-ua", L"\"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\""},
+        {L"sec-ch-ua-mobile", L"?0"},
+        {L"sec-ch-ua-platform", L"\"Windows\""},
+    };
+    return request;
+}
+
+// The event monitor's EncodeQuote and RequestToJsonString before JsonWriter.
+std::wstring EncodeQuote(std::wstring raw)
+{
+    std::wstring encoded;
+    encoded.reserve(raw.length() + 10);
+    encoded.push_back(L'"');
+    for (size_t i = 0; i < raw.length(); ++i)
+    {
+        switch (raw[i])
+        {
+        case '\b':
+            encoded.append(L"\\b");
+            break;
+        case '\f':
+            encoded.append(L"\\f");
+            break;
+        case '\n':
+            encoded.append(L"\\n");
+            break;
+        case '\r':
+            encoded.append(L"\\r");
+            break;
+        case '\t':
+            encoded.append(L"\\t");
+            break;
+        case '\\':
+            encoded.append(L"\\\\");
+            break;
+        case '"':
+            encoded.append(L"\\\"");
+            break;
+        default:
+            encoded.push_back(raw[i]);
+        }
+    }
+    encoded.push_back(L'"');
+    return encoded;
+}
+
+std::wstring ConcatenateEvent(const Request& request)
+{
+    std::wstring headers = L"[";
+    for (size_t i = 0; i < request.headers.size(); ++i)
+    {
+        headers += L"{\"name\": " + EncodeQuote(request.headers[i].first) +
+                   L", \"value\": " + EncodeQuote(request.headers[i].second) + L"}";
+        if (i + 1 < request.headers.size())
+        {
+            headers += L", ";
+        }
+    }
+    headers += L"]";
+
+    std::wstring requestJson = L"{";
+    requestJson += L"\"content\": null, ";
+    requestJson += L"\"headers\": " + headers + L", ";
+    requestJson += L"\"method\": " + EncodeQuote(request.method) + L", ";
+    requestJson += L"\"uri\": " + EncodeQuote(request.uri) + L" ";
+    requestJson += L"}";
+
+    return L"{ \"kind\": \"event\", \"name\": \"WebResourceRequested\", \"args\": {"
+           L"\"request\": " +
+           requestJson + L", \"resourceContext\": \"Script\"}}";
+}
+
+void WriteEvent(JsonWriter& writer, const Request& request)
+{
+    writer.Reset();
+    writer.BeginObject()
+        .Key(L"kind")
+        .String(L"event")
+        .Key(L"name")
+        .String(L"WebResourceRequested")
+        .Key(L"args")
+        .BeginObject()
+        .Key(L"request")
+        .BeginObject()
+        .Key(L"content")
+        .Null()
+        .Key(L"headers")
+        .BeginArray();
+    for (const auto& header : request.headers)
+    {
+        writer.BeginObject()
+            .Key(L"name")
+            .String(header.first)
+            .Key(L"value")
+            .String(header.second)
+            .EndObject();
+    }
+    writer.EndArray()
+        .Key(L"method")
+        .String(request.method)
+        .Key(L"uri")
+        .String(request.uri)
+        .EndObject()
+        .Key(L"resourceContext")
+        .String(L"Script")
+        .EndObject()
+        .EndObject();
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t events = Iterations(IsQuickRun(argc, argv), 1000000);
+    Request request = MakeRequest();
+
+    size_t length = 0;
+    size_t allocations = GetAllocationCount();
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < events; ++i)
+            {
+                length += ConcatenateEvent(request).size();
+            }
+        });
+    ReportRate("concatenation", events, seconds);
+    std::printf(
+        "  %.1f allocations/event\n", double(GetAllocationCount() - allocations) / events);
+
+    JsonWriter writer;
+    WriteEvent(writer, request);
+    allocations = GetAllocationCount();
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < events; ++i)
+            {
+                WriteEvent(writer, request);
+                length += writer.GetString().size();
+            }
+        });
+    ReportRate("JsonWriter", events, seconds);
+    size_t writerAllocations = GetAllocationCount() - allocations;
+    std::printf("  %.1f allocations/event\n", double(writerAllocations) / events);
+    KeepResult(length);
+
+    // A reused writer must not allocate in steady state.
+    return writerAllocations == 0 ? 0 : 1;
+}
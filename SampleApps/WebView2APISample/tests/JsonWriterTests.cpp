@@ -0,0 +1,162 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "JsonWriter.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "AllocationCounter.h"
+#include "TestHarness.h"
+
+namespace
+{
+void TestObjectsAndArrays()
+{
+    JsonWriter writer;
+    writer.BeginObject()
+        .Key(L"kind")
+        .String(L"event")
+        .Key(L"args")
+        .BeginObject()
+        .Key(L"list")
+        .BeginArray()
+        .Int(1)
+        .BeginObject()
+        .EndObject()
+        .BeginArray()
+        .EndArray()
+        .Null()
+        .EndArray()
+        .Key(L"ok")
+        .Bool(true)
+        .EndObject()
+        .EndObject();
+    TEST_CHECK(
+        writer.GetString() ==
+        L"{\"kind\":\"event\",\"args\":{\"list\":[1,{},[],null],\"ok\":true}}");
+}
+
+void TestStrings()
+{
+    JsonWriter writer;
+    writer.BeginArray()
+        .String(L"quote \" backslash \\ tab \t")
+        .String(static_cast<const wchar_t*>(nullptr))
+        .BeginString()
+        .AppendToString(L"name")
+        .AppendToString(L": \x01")
+        .EndString()
+        .EndArray();
+    TEST_CHECK(
+        writer.GetString() ==
+        L"[\"quote \\\" backslash \\\\ tab \\t\",null,\"name: \\u0001\"]");
+
+    writer.Reset();
+    writer.BeginObject().Key(L"a\"b").String(L"").EndObject();
+    TEST_CHECK(writer.GetString() == L"{\"a\\\"b\":\"\"}");
+}
+
+void TestNumericKeys()
+{
+    JsonWriter writer;
+    writer.BeginObject()
+        .Key(uint64_t(0))
+        .Int(1)
+        .Key(uint32_t(16777301))
+        .String(L"uri")
+        .Key((std::numeric_limits<uint64_t>::max)())
+        .Null()
+        .EndObject();
+    TEST_CHECK(
+        writer.GetString() ==
+        L"{\"0\":1,\"16777301\":\"uri\",\"18446744073709551615\":null}");
+}
+
+void TestNumbers()
+{
+    JsonWriter writer;
+    writer.BeginArray()
+        .Int(0)
+        .Int(-5)
+        .Int((std::numeric_limits<int64_t>::min)())
+        .UInt((std::numeric_limits<uint64_t>::max)())
+        .Double(0.1)
+        .Double(-2.5e-300)
+        .Double(std::numeric_limits<double>::infinity())
+        .Double(std::numeric_limits<double>::quiet_NaN())
+        .EndArray();
+    TEST_CHECK(
+        writer.GetString() ==
+        L"[0,-5,-9223372036854775808,18446744073709551615,0.1,-2.5e-300,null,null]");
+}
+
+void TestRawValue()
+{
+    JsonWriter inner;
+    inner.BeginArray().Int(1).Int(2).EndArray();
+    JsonWriter writer;
+    writer.BeginObject().Key(L"a").RawValue(inner.GetString()).Key(L"b").Int(3).EndObject();
+    TEST_CHECK(writer.GetString() == L"{\"a\":[1,2],\"b\":3}");
+}
+
+// Commas must be right at any depth, not only the first few levels.
+void TestDeepNesting()
+{
+    constexpr int c_depth = 100;
+    JsonWriter writer;
+    std::wstring expected;
+    for (int i = 0; i < c_depth; ++i)
+    {
+        writer.BeginArray().Int(i);
+        expected += (i ? L",[" : L"[") + std::to_wstring(i);
+    }
+    for (int i = 0; i < c_depth; ++i)
+    {
+        writer.EndArray().Int(i);
+        expected += L"]," + std::to_wstring(i);
+    }
+    TEST_CHECK(writer.GetString() == expected);
+}
+
+// Once a writer has written its largest message, writing it again after
+// Reset() doesn't allocate.
+void TestResetKeepsCapacity()
+{
+    JsonWriter writer;
+    auto write = [&writer]()
+    {
+        writer.Reset();
+        writer.BeginObject();
+        for (int i = 0; i < 50; ++i)
+        {
+            writer.Key(L"value").String(L"some longer string value").Key(L"next").BeginObject();
+        }
+        for (int i = 0; i < 50; ++i)
+        {
+            writer.EndObject();
+        }
+        writer.EndObject();
+    };
+    write();
+    std::wstring first = writer.GetString();
+    size_t allocations = GetAllocationCount();
+    write();
+    TEST_CHECK(GetAllocationCount() == allocations);
+    TEST_CHECK(writer.GetString() == first);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestObjectsAndArrays);
+    RUN_TEST(TestStrings);
+    RUN_TEST(TestNumericKeys);
+    RUN_TEST(TestNumbers);
+    RUN_TEST(TestRawValue);
+    RUN_TEST(TestDeepNesting);
+    RUN_TEST(TestResetKeepsCapacity);
+    return ReportTestResults();
+}
@@ -0,0 +1,176 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// Every value falls in the bucket it is mapped to, the buckets leave no gaps,
+// and each is at most 1/32 of its lowest value wide.
+void TestBucketLayout()
+{
+    size_t lastIndex = LatencyHistogram::GetBucketIndex(LatencyHistogram::c_maxValue);
+    for (size_t index = 0; index < lastIndex; ++index)
+    {
+        uint64_t lowest = LatencyHistogram::GetBucketLowestValue(index);
+        uint64_t highest = LatencyHistogram::GetBucketHighestValue(index);
+        TEST_CHECK(LatencyHistogram::GetBucketIndex(lowest) == index);
+        TEST_CHECK(LatencyHistogram::GetBucketIndex(highest) == index);
+        TEST_CHECK(LatencyHistogram::GetBucketLowestValue(index + 1) == highest + 1);
+        TEST_CHECK((highest - lowest) * 32 <= lowest);
+    }
+    TEST_CHECK(
+        LatencyHistogram::GetBucketHighestValue(lastIndex) == LatencyHistogram::c_maxValue);
+    for (uint64_t value = 0; value < 64; ++value)
+    {
+        TEST_CHECK(LatencyHistogram::GetBucketIndex(value) == value);
+    }
+}
+
+void TestEmpty()
+{
+    LatencyHistogram histogram;
+    TEST_CHECK(histogram.GetCount() == 0);
+    TEST_CHECK(histogram.GetMin() == 0 && histogram.GetMax() == 0);
+    TEST_CHECK(histogram.GetMean() == 0);
+    TEST_CHECK(histogram.GetValueAtPercentile(50) == 0);
+}
+
+void TestSummary()
+{
+    LatencyHistogram histogram;
+    histogram.Record(10);
+    histogram.Record(30, 3);
+    histogram.Record(20, 0);
+    TEST_CHECK(histogram.GetCount() == 4);
+    TEST_CHECK(histogram.GetMin() == 10 && histogram.GetMax() == 30);
+    TEST_CHECK(histogram.GetMean() == 25);
+    TEST_CHECK(histogram.GetValueAtPercentile(0) == 10);
+    TEST_CHECK(histogram.GetValueAtPercentile(25) == 10);
+    TEST_CHECK(histogram.GetValueAtPercentile(50) == 30);
+    TEST_CHECK(histogram.GetValueAtPercentile(100) == 30);
+
+    histogram.Reset();
+    TEST_CHECK(histogram.GetCount() == 0 && histogram.GetMax() == 0);
+}
+
+// Values above the maximum are counted as the maximum.
+void TestClampsLargeValues()
+{
+    LatencyHistogram histogram;
+    histogram.Record(UINT64_MAX);
+    TEST_CHECK(histogram.GetMax() == LatencyHistogram::c_maxValue);
+    TEST_CHECK(histogram.GetValueAtPercentile(99) == LatencyHistogram::c_maxValue);
+}
+
+// A percentile is never below the exact one and at most 1/32 above it.
+void CheckAccuracy(std::vector<uint64_t> values)
+{
+    LatencyHistogram histogram;
+    for (uint64_t value : values)
+    {
+        histogram.Record(value);
+    }
+    std::sort(values.begin(), values.end());
+    for (double percentile : {0.0, 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0})
+    {
+        uint64_t rank = static_cast<uint64_t>(percentile / 100 * values.size() + 0.5);
+        uint64_t exact = values[(std::max)(rank, uint64_t(1)) - 1];
+        uint64_t reported = histogram.GetValueAtPercentile(percentile);
+        TEST_CHECK(reported >= exact);
+        TEST_CHECK(reported - exact <= exact / 32);
+    }
+    TEST_CHECK(histogram.GetMin() == values.front());
+    TEST_CHECK(histogram.GetMax() == values.back());
+}
+
+void TestAccuracyBounds()
+{
+    std::mt19937_64 random(8);
+    std::vector<uint64_t> uniform;
+    std::vector<uint64_t> logNormal;
+    std::vector<uint64_t> bimodal;
+    std::uniform_int_distribution<uint64_t> uniformDistribution(0, 10000000);
+    std::lognormal_distribution<double> logNormalDistribution(13, 1.5);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uniform.push_back(uniformDistribution(random));
+        logNormal.push_back(static_cast<uint64_t>(logNormalDistribution(random)));
+        bimodal.push_back(i % 10 == 0 ? 50000000 + random() % 1000000 : 200 + random() % 50);
+    }
+    CheckAccuracy(uniform);
+    CheckAccuracy(logNormal);
+    CheckAccuracy(bimodal);
+}
+
+void TestMerge()
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    LatencyHistogram both;
+    for (uint64_t value = 1; value < 100000; value += 7)
+    {
+        (value % 2 ? first : second).Record(value);
+        both.Record(value);
+    }
+    first.Merge(second);
+    TEST_CHECK(first.GetCount() == both.GetCount());
+    TEST_CHECK(first.GetMin() == both.GetMin() && first.GetMax() == both.GetMax());
+    TEST_CHECK(first.GetMean() == both.GetMean());
+    for (double percentile : {1.0, 50.0, 99.0})
+    {
+        TEST_CHECK(
+            first.GetValueAtPercentile(percentile) == both.GetValueAtPercentile(percentile));
+    }
+
+    LatencyHistogram empty;
+    first.Merge(empty);
+    TEST_CHECK(first.GetMin() == both.GetMin());
+}
+
+// Values recorded on several threads at once are all counted.
+void TestConcurrentRecording()
+{
+    LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (uint64_t thread = 0; thread < 4; ++thread)
+    {
+        threads.emplace_back(
+            [&histogram, thread]()
+            {
+                for (uint64_t value = 0; value < 100000; ++value)
+                {
+                    histogram.Record(value * 4 + thread);
+                }
+            });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    TEST_CHECK(histogram.GetCount() == 400000);
+    TEST_CHECK(histogram.GetMin() == 0 && histogram.GetMax() == 399999);
+    TEST_CHECK(histogram.GetMean() == 399999 / 2.0);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestBucketLayout);
+    RUN_TEST(TestEmpty);
+    RUN_TEST(TestSummary);
+    RUN_TEST(TestClampsLargeValues);
+    RUN_TEST(TestAccuracyBounds);
+    RUN_TEST(TestMerge);
+    RUN_TEST(TestConcurrentRecording);
+    return ReportTestResults();
+}
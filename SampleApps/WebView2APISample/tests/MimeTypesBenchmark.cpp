@@ -0,0 +1,103 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Picks the Content-Type of asset paths as ScenarioCustomSchemeNavigate did
+// before MimeTypes, with a chain of comparisons that takes the extension as a
+// new string each time, against GetMimeTypeForPath() and the header that
+// GetContentTypeHeader() builds from it.
+
+#include "MimeTypes.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+std::wstring GetHeadersBeforeMimeTypes(const std::wstring& assetsFilePath)
+{
+    std::wstring headers;
+    if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) == L"html")
+    {
+        headers = L"Content-Type: text/html";
+    }
+    else if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) == L"jpg")
+    {
+        headers = L"Content-Type: image/jpeg";
+    }
+    else if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) == L"png")
+    {
+        headers = L"Content-Type: image/png";
+    }
+    else if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) == L"css")
+    {
+        headers = L"Content-Type: text/css";
+    }
+    else if (assetsFilePath.substr(assetsFilePath.find_last_of(L".") + 1) == L"js")
+    {
+        headers = L"Content-Type: application/javascript";
+    }
+    return headers;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t rounds = Iterations(IsQuickRun(argc, argv), 500);
+    const wchar_t* names[] = {
+        L"ScenarioCustomScheme.html", L"EdgeWebView2-80.jpg", L"AppStartPageBackground.png",
+        L"style.css", L"AppStartPage.js", L"ScenarioCustomScheme.json", L"font.woff2",
+        L"movie.mp4"};
+    std::mt19937 random(7);
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < 4096; ++i)
+    {
+        paths.push_back(std::wstring(L"assets/") + names[random() % 8]);
+    }
+    size_t lookups = rounds * paths.size();
+    size_t total = 0;
+
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const std::wstring& path : paths)
+                {
+                    total += GetHeadersBeforeMimeTypes(path).size();
+                }
+            }
+        });
+    ReportRate("comparison chain, header", lookups, seconds);
+
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const std::wstring& path : paths)
+                {
+                    total += GetMimeTypeForPath(path).size();
+                }
+            }
+        });
+    ReportRate("GetMimeTypeForPath", lookups, seconds);
+
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const std::wstring& path : paths)
+                {
+                    total += GetContentTypeHeader(path).size();
+                }
+            }
+        });
+    ReportRate("GetContentTypeHeader", lookups, seconds);
+    KeepResult(total);
+    return 0;
+}
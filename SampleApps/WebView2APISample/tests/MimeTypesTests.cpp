@@ -0,0 +1,125 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MimeTypes.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+
+#include "TestHarness.h"
+
+namespace
+{
+// The table of MimeTypes.cpp, read from its source, whose path the build
+// defines as MIME_TYPES_SOURCE.
+std::map<std::string, std::string> ReadMimeTypeTable()
+{
+    std::ifstream file(MIME_TYPES_SOURCE, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(file)), {});
+    std::map<std::string, std::string> table;
+    size_t start = text.find("c_mimeTypes[] = {");
+    size_t end = text.find("};", start);
+    for (size_t entry = text.find("{\"", start); entry < end; entry = text.find("{\"", entry))
+    {
+        size_t extensionEnd = text.find('"', entry + 2);
+        size_t typeStart = text.find('"', extensionEnd + 1) + 1;
+        size_t typeEnd = text.find('"', typeStart);
+        table[text.substr(entry + 2, extensionEnd - entry - 2)] =
+            text.substr(typeStart, typeEnd - typeStart);
+        entry = typeEnd;
+    }
+    return table;
+}
+
+std::wstring Widen(const std::string& text)
+{
+    return std::wstring(text.begin(), text.end());
+}
+
+// Every extension in the table is found in any case, through both widths and
+// as the end of a path, and near misses aren't.
+void TestEveryEntry()
+{
+    std::map<std::string, std::string> table = ReadMimeTypeTable();
+    TEST_CHECK(table.size() > 300);
+    for (const auto& [extension, type] : table)
+    {
+        std::string upper = extension;
+        for (char& c : upper)
+        {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        TEST_CHECK(GetMimeTypeForExtension(extension) == type);
+        TEST_CHECK(GetMimeTypeForExtension(upper) == type);
+        TEST_CHECK(GetMimeTypeForExtension(Widen(extension)) == type);
+        TEST_CHECK(GetMimeTypeForExtension(Widen(upper)) == type);
+        TEST_CHECK(GetMimeTypeForPath("dir.d/file." + extension + "?q=1.png#x.css") == type);
+        TEST_CHECK(GetMimeTypeForPath(L"C:\\a.b\\F." + Widen(upper)) == type);
+
+        TEST_CHECK(GetMimeTypeForExtension("." + extension).empty());
+        std::wstring nonAscii = Widen(extension);
+        nonAscii[0] = wchar_t(0x100 + nonAscii[0]);
+        TEST_CHECK(GetMimeTypeForExtension(nonAscii).empty());
+        auto longer = table.find(extension + "q");
+        TEST_CHECK(
+            GetMimeTypeForExtension(extension + "q") ==
+            (longer == table.end() ? "" : longer->second));
+    }
+}
+
+void TestPaths()
+{
+    TEST_CHECK(GetMimeTypeForPath("noextension").empty());
+    TEST_CHECK(GetMimeTypeForPath("dir.html/noextension").empty());
+    TEST_CHECK(GetMimeTypeForPath("dir.html\\noextension").empty());
+    TEST_CHECK(GetMimeTypeForPath("file.").empty());
+    TEST_CHECK(GetMimeTypeForPath("").empty());
+    TEST_CHECK(GetMimeTypeForPath("?x.html").empty());
+    TEST_CHECK(GetMimeTypeForPath("#x.html").empty());
+    TEST_CHECK(GetMimeTypeForPath("file.html?") == "text/html");
+    TEST_CHECK(GetMimeTypeForPath("https://example.com/a.b/app.JS#top") == "text/javascript");
+    TEST_CHECK(GetMimeTypeForPath("archive.tar.gz") == GetMimeTypeForExtension("gz"));
+    TEST_CHECK(GetMimeTypeForExtension("").empty());
+    TEST_CHECK(GetMimeTypeForExtension(std::string(100, 'a')).empty());
+    TEST_CHECK(
+        GetContentTypeHeader(L"x.unknownext") == L"Content-Type: application/octet-stream");
+    TEST_CHECK(GetContentTypeHeader(L"assets/EdgeWebView2-80.jpg") == L"Content-Type: image/jpeg");
+    TEST_CHECK(GetContentTypeHeader(L"assets/Data.JSON") == L"Content-Type: application/json");
+}
+
+// Random short extensions are found only if they are in the table.
+void TestRandomExtensions()
+{
+    std::map<std::string, std::string> table = ReadMimeTypeTable();
+    const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    std::mt19937 random(7);
+    size_t found = 0;
+    for (int i = 0; i < 200000; ++i)
+    {
+        std::string extension(1 + random() % 5, ' ');
+        for (char& c : extension)
+        {
+            c = alphabet[random() % 36];
+        }
+        auto entry = table.find(extension);
+        std::string_view type = GetMimeTypeForExtension(extension);
+        TEST_CHECK(type == (entry == table.end() ? "" : entry->second));
+        found += !type.empty();
+    }
+    std::printf("  %zu of 200000 random extensions are in the table\n", found);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestEveryEntry);
+    RUN_TEST(TestPaths);
+    RUN_TEST(TestRandomExtensions);
+    return ReportTestResults();
+}
@@ -0,0 +1,201 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "StringInterner.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+bool Resolves(const StringInterner& interner, uint32_t id, std::wstring_view expected)
+{
+    std::wstring_view value;
+    return interner.TryGet(id, &value) && value == expected;
+}
+
+void TestSameStringSameId()
+{
+    StringInterner interner(1000);
+    uint32_t hello = interner.Intern(L"hello");
+    uint32_t world = interner.Intern(L"world");
+    TEST_CHECK(hello != StringInterner::c_noString);
+    TEST_CHECK(hello != world);
+    TEST_CHECK(interner.Intern(L"hello") == hello);
+    TEST_CHECK(Resolves(interner, hello, L"hello"));
+    TEST_CHECK(Resolves(interner, world, L"world"));
+    TEST_CHECK(Resolves(interner, interner.Intern(L""), L""));
+
+    std::wstring_view value;
+    TEST_CHECK(!interner.TryGet(StringInterner::c_noString, &value));
+}
+
+// Enough strings to grow the hash table several times.
+void TestManyStrings()
+{
+    StringInterner interner(1 << 20);
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < 20000; ++i)
+    {
+        ids.push_back(interner.Intern(L"https://example.com/" + std::to_wstring(i)));
+    }
+    for (int i = 0; i < 20000; ++i)
+    {
+        std::wstring uri = L"https://example.com/" + std::to_wstring(i);
+        TEST_CHECK(interner.Intern(uri) == ids[i]);
+        TEST_CHECK(Resolves(interner, ids[i], uri));
+    }
+    TEST_CHECK(interner.GetGeneration() == 0);
+}
+
+// Filling a generation starts a new one, and ids of the full one stay valid
+// until it is released.
+void TestIdsSurviveNewGeneration()
+{
+    StringInterner interner(100);
+    std::wstring title(40, L't');
+    std::wstring uri(40, L'u');
+    std::wstring headers(40, L'h');
+    uint32_t titleId = interner.Intern(title);
+    uint32_t uriId = interner.Intern(uri);
+    uint32_t headersId = interner.Intern(headers);
+    TEST_CHECK(interner.GetGeneration() == 1);
+    TEST_CHECK(StringInterner::GetTag(titleId) != StringInterner::GetTag(headersId));
+    TEST_CHECK(Resolves(interner, titleId, title));
+    TEST_CHECK(Resolves(interner, uriId, uri));
+    TEST_CHECK(Resolves(interner, headersId, headers));
+
+    // An old generation's strings are added again to the new one.
+    uint32_t newTitleId = interner.Intern(title);
+    TEST_CHECK(newTitleId != titleId);
+    TEST_CHECK(StringInterner::GetTag(newTitleId) == StringInterner::GetTag(headersId));
+
+    interner.ReleaseGenerationsBefore(1);
+    TEST_CHECK(interner.GetOldestGeneration() == 1);
+    TEST_CHECK(!Resolves(interner, titleId, title));
+    TEST_CHECK(!Resolves(interner, uriId, uri));
+    TEST_CHECK(Resolves(interner, headersId, headers));
+    TEST_CHECK(Resolves(interner, newTitleId, title));
+}
+
+// Generations started after a release reuse its buffers; what they held must
+// not leak into the new generation.
+void TestReleasedBuffersAreReused()
+{
+    StringInterner interner(64);
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::wstring value = L"string-" + std::to_wstring(i) + std::wstring(20, L'x');
+        uint32_t id = interner.Intern(value);
+        TEST_CHECK(Resolves(interner, id, value));
+        TEST_CHECK(interner.Intern(value) == id);
+        interner.ReleaseGenerationsBefore(interner.GetGeneration());
+    }
+    TEST_CHECK(interner.GetGeneration() > StringInterner::c_tagCount);
+    uint32_t id = interner.Intern(L"after");
+    TEST_CHECK(Resolves(interner, id, L"after"));
+}
+
+// Strings that differ in a single code unit, at any position and for lengths
+// that end in every part of a hashed word, get their own ids.
+void TestSimilarStringsAreDistinct()
+{
+    StringInterner interner(1 << 20);
+    std::vector<std::wstring> values;
+    for (size_t length = 0; length <= 40; ++length)
+    {
+        std::wstring base(length, L'a');
+        values.push_back(base);
+        for (size_t position = 0; position < length; ++position)
+        {
+            std::wstring value = base;
+            value[position] = L'b';
+            values.push_back(value);
+        }
+    }
+    std::vector<uint32_t> ids;
+    for (const std::wstring& value : values)
+    {
+        ids.push_back(interner.Intern(value));
+    }
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        TEST_CHECK(Resolves(interner, ids[i], values[i]));
+        TEST_CHECK(interner.Intern(values[i]) == ids[i]);
+    }
+    TEST_CHECK(interner.GetGeneration() == 0);
+}
+
+// The current generation is never released.
+void TestCurrentGenerationIsKept()
+{
+    StringInterner interner(100);
+    uint32_t id = interner.Intern(L"kept");
+    interner.ReleaseGenerationsBefore(10);
+    TEST_CHECK(interner.GetOldestGeneration() == 0);
+    TEST_CHECK(Resolves(interner, id, L"kept"));
+}
+
+// A string longer than a whole generation is cut to the capacity.
+void TestLongStringIsTruncated()
+{
+    StringInterner interner(8);
+    uint32_t id = interner.Intern(L"0123456789");
+    TEST_CHECK(Resolves(interner, id, L"01234567"));
+}
+
+// When every tag is in use, Intern fails rather than reusing the tag of a
+// generation whose ids may still be held.
+void TestFailsWhenAllTagsInUse()
+{
+    StringInterner interner(4);
+    uint32_t first = interner.Intern(L"abcd");
+    uint32_t last = 0;
+    int generationsStarted = 0;
+    for (int i = 0; i < 400; ++i)
+    {
+        last = interner.Intern(std::to_wstring(10000 + i));
+        if (last == StringInterner::c_noString)
+        {
+            break;
+        }
+        ++generationsStarted;
+    }
+    TEST_CHECK(last == StringInterner::c_noString);
+    TEST_CHECK(static_cast<uint32_t>(generationsStarted) == StringInterner::c_tagCount - 2);
+    TEST_CHECK(Resolves(interner, first, L"abcd"));
+
+    interner.ReleaseGenerationsBefore(10);
+    TEST_CHECK(!Resolves(interner, first, L"abcd"));
+    uint32_t again = interner.Intern(L"zzzz");
+    TEST_CHECK(Resolves(interner, again, L"zzzz"));
+}
+
+void TestGenerationTags()
+{
+    TEST_CHECK(StringInterner::GetGenerationTag(0) == 1);
+    TEST_CHECK(StringInterner::GetGenerationTag(254) == 255);
+    TEST_CHECK(StringInterner::GetGenerationTag(255) == 1);
+    uint32_t id = (7u << 24) | 42;
+    TEST_CHECK(StringInterner::GetTag(id) == 7);
+    TEST_CHECK(StringInterner::GetIndex(id) == 42);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestSameStringSameId);
+    RUN_TEST(TestManyStrings);
+    RUN_TEST(TestIdsSurviveNewGeneration);
+    RUN_TEST(TestReleasedBuffersAreReused);
+    RUN_TEST(TestSimilarStringsAreDistinct);
+    RUN_TEST(TestCurrentGenerationIsKept);
+    RUN_TEST(TestLongStringIsTruncated);
+    RUN_TEST(TestFailsWhenAllTagsInUse);
+    RUN_TEST(TestGenerationTags);
+    return ReportTestResults();
+}
@@ -0,0 +1,46 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <cstdio>
+
+// Checks for the unit tests of the portable modules. A failed check prints
+// where it failed and carries on, and ReportTestResults() then makes main
+// return nonzero so that ctest reports the test as failed.
+
+inline int g_testFailures = 0;
+
+#define TEST_CHECK(expression)                                                                   \
+    do                                                                                           \
+    {                                                                                            \
+        if (!(expression))                                                                       \
+        {                                                                                        \
+            std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #expression); \
+            ++g_testFailures;                                                                    \
+        }                                                                                        \
+    } while (false)
+
+// Run one test function, reporting its name if any of its checks fail.
+#define RUN_TEST(test)                                                                           \
+    do                                                                                           \
+    {                                                                                            \
+        int failuresBefore = g_testFailures;                                                     \
+        test();                                                                                  \
+        if (g_testFailures != failuresBefore)                                                    \
+        {                                                                                        \
+            std::fprintf(stderr, "FAILED: %s\n", #test);                                         \
+        }                                                                                        \
+    } while (false)
+
+inline int ReportTestResults()
+{
+    if (g_testFailures != 0)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", g_testFailures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Parses 2000 URLs of the kinds the sample checks on navigation and frame
+// events (web pages, virtual host assets, file URLs, IP hosts and relative
+// references), and compares pairs of them by origin as AreSitesSame does.
+// CreateUri isn't available off Windows, so the allocating approach it stands
+// for is measured as the RFC 3986 regular expression splitting each URL into
+// copies of its parts, which like an IUri and its BSTRs allocates every time.
+// Also times the separator replacement in AppWindow::GetLocalUri, before and
+// after.
+
+#include "Url.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+// What CreateUri gives the call sites: the parts, each its own string.
+struct SplitUri
+{
+    std::wstring scheme;
+    std::wstring authority;
+    std::wstring path;
+    std::wstring query;
+    std::wstring fragment;
+};
+
+bool SplitWithRegex(const std::wregex& regex, const std::wstring& uri, SplitUri* parts)
+{
+    std::wsmatch match;
+    if (!std::regex_match(uri, match, regex) || !match[2].matched)
+    {
+        return false;
+    }
+    parts->scheme = match[2].str();
+    parts->authority = match[4].str();
+    parts->path = match[5].str();
+    parts->query = match[7].str();
+    parts->fragment = match[9].str();
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t rounds = quick ? 1 : 200;
+    std::mt19937 random(3);
+    const char* hosts[] = {"www.bing.com", "login.microsoftonline.com", "appassets.example",
+                           "cdn.jsdelivr.net", "[::1]", "127.0.0.1:8080", "sub.example.co.uk"};
+    const char* paths[] = {"", "index.html", "assets/js", "api/v1/items", "a/../b/./c.png"};
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        std::string path = paths[random() % 5];
+        std::string url;
+        switch (random() % 4)
+        {
+        case 0:
+            url = "file:///C:/Users/Dev/WebView2Samples/SampleApps/WebView2APISample/x64/Debug/" +
+                  path;
+            break;
+        case 1:
+            url = "http://" + std::string(hosts[random() % 7]) + "/" + path + "#section-" +
+                  std::to_string(random() % 10);
+            break;
+        default:
+            url = "https://" + std::string(hosts[random() % 7]) + "/" + path + "?q=" +
+                  std::to_string(random() % 1000000) + "&lang=en-US";
+            break;
+        }
+        urls.push_back(url);
+    }
+    std::vector<std::u16string> utf16Urls;
+    std::vector<std::wstring> wideUrls;
+    for (const std::string& url : urls)
+    {
+        utf16Urls.emplace_back(url.begin(), url.end());
+        wideUrls.emplace_back(url.begin(), url.end());
+    }
+
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const std::string& url : urls)
+                {
+                    Url parsed;
+                    total += parsed.Parse(url) ? parsed.GetHref().size() : 0;
+                }
+            }
+        });
+    ReportRate("Url::Parse, UTF-8", rounds * urls.size(), seconds);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (const std::u16string& url : utf16Urls)
+                {
+                    Url parsed;
+                    total += parsed.Parse(url) ? parsed.GetHref().size() : 0;
+                }
+            }
+        });
+    ReportRate("Url::Parse, UTF-16", rounds * urls.size(), seconds);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                for (size_t i = 1; i < wideUrls.size(); ++i)
+                {
+                    Url first;
+                    Url second;
+                    total += first.Parse(wideUrls[i - 1]) && second.Parse(wideUrls[i]) &&
+                             first.GetOrigin().IsSameOrigin(second.GetOrigin());
+                }
+            }
+        });
+    ReportRate("parse two and compare origins", rounds * (urls.size() - 1), seconds);
+
+    // The regular expression of RFC 3986 appendix B.
+    std::wregex rfc3986(L"^(([^:/?#]+):)?(//([^/?#]*))?([^?#]*)(\\?([^#]*))?(#(.*))?");
+    size_t regexRounds = std::max<size_t>(1, rounds / 20);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t round = 0; round < regexRounds; ++round)
+            {
+                for (size_t i = 1; i < wideUrls.size(); ++i)
+                {
+                    SplitUri first;
+                    SplitUri second;
+                    total += SplitWithRegex(rfc3986, wideUrls[i - 1], &first) &&
+                             SplitWithRegex(rfc3986, wideUrls[i], &second) &&
+                             first.scheme == second.scheme && first.authority == second.authority;
+                }
+            }
+        });
+    ReportRate("split two with a regex, compare", regexRounds * (urls.size() - 1), seconds);
+
+    std::wstring relativePath = L"ScenarioVirtualHostMappingForSW\\sub\\page.html";
+    size_t replacements = Iterations(quick, 200000);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < replacements; ++i)
+            {
+                total += std::regex_replace(relativePath, std::wregex(L"\\\\"), L"/").size();
+            }
+        });
+    ReportRate("GetLocalUri separators, regex_replace", replacements, seconds);
+    seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < replacements; ++i)
+            {
+                std::wstring path = relativePath;
+                std::replace(path.begin(), path.end(), L'\\', L'/');
+                total += path.size();
+            }
+        });
+    ReportRate("GetLocalUri separators, std::replace", replacements, seconds);
+    KeepResult(total);
+    return 0;
+}
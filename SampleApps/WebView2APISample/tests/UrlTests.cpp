@@ -0,0 +1,302 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Url.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+#include "JsonReader.h"
+#include "TestHarness.h"
+
+namespace
+{
+// The UTF-8 text as wchar_t code units: UTF-16 or UTF-32. The data is valid
+// UTF-8, so this doesn't check it.
+std::wstring Widen(std::string_view utf8)
+{
+    std::wstring text;
+    for (size_t i = 0; i < utf8.size();)
+    {
+        unsigned char lead = static_cast<unsigned char>(utf8[i]);
+        size_t size = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+        uint32_t codePoint = size == 1 ? lead : lead & (0x7F >> size);
+        for (size_t j = 1; j < size; ++j)
+        {
+            codePoint = (codePoint << 6) | (utf8[i + j] & 0x3F);
+        }
+        i += size;
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            text += static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+            text += static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+        {
+            text += static_cast<wchar_t>(codePoint);
+        }
+    }
+    return text;
+}
+
+// The wchar_t text as UTF-16, keeping any lone surrogates.
+std::u16string ToUtf16(std::wstring_view text)
+{
+    std::u16string utf16;
+    for (wchar_t c : text)
+    {
+        uint32_t codePoint = static_cast<uint32_t>(c);
+        if (codePoint >= 0x10000)
+        {
+            utf16 += static_cast<char16_t>(0xD800 + ((codePoint - 0x10000) >> 10));
+            utf16 += static_cast<char16_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+        {
+            utf16 += static_cast<char16_t>(codePoint);
+        }
+    }
+    return utf16;
+}
+
+// The origin as the URL Standard serializes it.
+std::string SerializeOrigin(const Url& url)
+{
+    UrlOrigin origin = url.GetOrigin();
+    if (origin.IsOpaque())
+    {
+        return "null";
+    }
+    std::string text = std::string(origin.GetScheme()) + "://" + std::string(origin.GetHost());
+    return origin.GetPort() == -1 ? text : text + ":" + std::to_string(origin.GetPort());
+}
+
+// Parse input against base, and describe each way the result differs from
+// the test case, or an empty string if it doesn't.
+template <typename View>
+std::string CheckCase(View input, const Url* base, const Utf8JsonValue& test)
+{
+    Url url;
+    bool parsed = url.Parse(input, base);
+    bool failure = false;
+    test["failure"].GetBool(&failure);
+    if (failure || !parsed)
+    {
+        return failure == !parsed ? std::string()
+                                  : parsed ? "parsed as " + std::string(url.GetHref())
+                                           : "failed to parse";
+    }
+    std::string actual[] = {
+        std::string(url.GetHref()),
+        std::string(url.GetScheme()) + ":",
+        std::string(url.GetUsername()),
+        std::string(url.GetPassword()),
+        std::string(url.GetHost()),
+        url.GetPort() == -1 ? "" : std::to_string(url.GetPort()),
+        std::string(url.GetPath()),
+        url.GetQuery().empty() ? "" : "?" + std::string(url.GetQuery()),
+        url.GetFragment().empty() ? "" : "#" + std::string(url.GetFragment()),
+        SerializeOrigin(url)};
+    const char* names[] = {"href",     "protocol", "username", "password", "hostname",
+                           "port",     "pathname", "search",   "hash",     "origin"};
+    std::string differences;
+    for (size_t i = 0; i < std::size(names); ++i)
+    {
+        std::string_view expected;
+        // Cases that have no origin don't check it.
+        if (test[names[i]].GetString(&expected) && actual[i] != expected)
+        {
+            differences += std::string(names[i]) + " is " + actual[i] + "; ";
+        }
+    }
+    return differences;
+}
+
+// The URL parsing cases of the web-platform-tests, in data/urltestdata.json,
+// each parsed from UTF-8, UTF-16 and wchar_t input. The UTF-8 copy of an input
+// with a lone surrogate has U+FFFD for it, which the parser would write anyway.
+void TestWebPlatformTests()
+{
+    std::ifstream file(URL_TEST_DATA, std::ios::binary);
+    std::string json(std::istreambuf_iterator<char>(file), {});
+    std::wstring wideJson = Widen(json);
+    Utf8JsonDocument document;
+    JsonDocument wideDocument;
+    TEST_CHECK(document.Parse(json) && wideDocument.Parse(wideJson));
+
+    size_t cases = 0;
+    size_t failures = 0;
+    for (size_t index = 0;; ++index)
+    {
+        Utf8JsonValue test = document.GetRoot().GetElement(index);
+        if (!test.Exists())
+        {
+            break;
+        }
+        std::string_view input;
+        if (!test["input"].GetString(&input))
+        {
+            // A comment.
+            continue;
+        }
+        ++cases;
+        std::wstring_view wideInput =
+            wideDocument.GetRoot().GetElement(index)[L"input"].GetStringOr();
+        std::u16string utf16Input = ToUtf16(wideInput);
+
+        Url base;
+        std::string_view baseText;
+        if (test["base"].GetString(&baseText) && !base.Parse(baseText))
+        {
+            // Only a case that is to fail has a base that isn't a URL.
+            bool failure = false;
+            TEST_CHECK(test["failure"].GetBool(&failure) && failure);
+            continue;
+        }
+        const Url* basePointer = baseText.empty() ? nullptr : &base;
+        std::string differences[] = {
+            CheckCase(input, basePointer, test), CheckCase(utf16Input, basePointer, test),
+            CheckCase(wideInput, basePointer, test)};
+        const char* encodings[] = {"UTF-8", "UTF-16", "wchar_t"};
+        for (size_t i = 0; i < std::size(differences); ++i)
+        {
+            TEST_CHECK(differences[i].empty());
+            if (!differences[i].empty())
+            {
+                ++failures;
+                std::fprintf(
+                    stderr, "  %.*s (%s): %s\n", int(input.size()), input.data(), encodings[i],
+                    differences[i].c_str());
+            }
+        }
+    }
+    TEST_CHECK(cases > 800);
+    std::printf("  %zu web-platform-tests cases, %zu failures\n", cases, failures);
+}
+
+void TestRelativeAndCopies()
+{
+    Url base;
+    TEST_CHECK(base.Parse("https://example.com/a/b?x#y"));
+    Url relative;
+    TEST_CHECK(relative.Parse("../c", &base) && relative.GetHref() == "https://example.com/c");
+    // A URL can be resolved against itself.
+    TEST_CHECK(base.Parse("d", &base) && base.GetHref() == "https://example.com/a/d");
+
+    // Longer URLs move to the heap, and copies of either kind are whole.
+    std::string longHref = "https://example.com/" + std::string(5000, 'x') + "?q#f";
+    Url longUrl;
+    TEST_CHECK(longUrl.Parse(longHref) && longUrl.GetHref() == longHref);
+    TEST_CHECK(longUrl.GetQuery() == "q" && longUrl.GetFragment() == "f");
+    Url copy(longUrl);
+    TEST_CHECK(copy.GetHref() == longHref && copy.GetFragment() == "f");
+    copy = relative;
+    TEST_CHECK(copy.GetHref() == relative.GetHref() && copy.GetPath() == "/c");
+
+    Url invalid;
+    TEST_CHECK(!invalid.Parse("not a url") && !invalid.IsValid() && invalid.GetHref().empty());
+    TEST_CHECK(!invalid.Parse("https://exa mple.com/") && invalid.GetHost().empty());
+}
+
+// The URLs the sample compares: file URLs from Windows paths, virtual hosts
+// and blob: URLs.
+void TestSampleUrls()
+{
+    Url file;
+    TEST_CHECK(file.Parse(L"file:///C:\\Users\\me\\a b.html"));
+    TEST_CHECK(file.GetHref() == "file:///C:/Users/me/a%20b.html");
+    TEST_CHECK(file.GetHostType() == UrlHostType::Empty && file.GetOrigin().IsOpaque());
+    TEST_CHECK(file.Parse(L"file://server/share/x.html") && file.GetHost() == "server");
+
+    Url blob;
+    TEST_CHECK(blob.Parse(L"blob:https://sub.example.co.uk:8443/uuid"));
+    UrlOrigin blobOrigin = blob.GetOrigin();
+    TEST_CHECK(blobOrigin.GetHost() == "sub.example.co.uk" && blobOrigin.GetPort() == 8443);
+    Url site;
+    TEST_CHECK(site.Parse("https://www.example.co.uk/"));
+    TEST_CHECK(site.GetOrigin().IsSameSite(blobOrigin));
+    TEST_CHECK(!site.GetOrigin().IsSameOrigin(blobOrigin));
+
+    Url app;
+    Url other;
+    TEST_CHECK(app.Parse(L"https://appassets.example/index.html"));
+    TEST_CHECK(other.Parse(L"HTTPS://AppAssets.Example:443/x"));
+    TEST_CHECK(app.GetOrigin().IsSameOrigin(other.GetOrigin()));
+    TEST_CHECK(other.Parse(L"http://appassets.example/x"));
+    TEST_CHECK(!app.GetOrigin().IsSameOrigin(other.GetOrigin()));
+    TEST_CHECK(!app.GetOrigin().IsSameSite(other.GetOrigin()));
+    TEST_CHECK(other.Parse("about:blank") && other.GetOrigin().IsOpaque());
+    TEST_CHECK(!other.GetOrigin().IsSameOrigin(other.GetOrigin()));
+
+    TEST_CHECK(GetUrlSite("www.example.co.uk") == "example.co.uk");
+    TEST_CHECK(GetUrlSite("a.b.example.com") == "example.com");
+    TEST_CHECK(GetUrlSite("appassets.example") == "appassets.example");
+    TEST_CHECK(GetUrlSite("127.0.0.1") == "127.0.0.1");
+    TEST_CHECK(GetUrlSite("[::1]") == "[::1]");
+
+    std::string ascii;
+    TEST_CHECK(DomainToAscii("B\xC3\x9C" "CHER.de", &ascii) && ascii == "xn--bcher-kva.de");
+    TEST_CHECK(DomainToAscii("Example.COM", &ascii) && ascii == "example.com");
+    TEST_CHECK(!DomainToAscii("", &ascii));
+    TEST_CHECK(!DomainToAscii("a b.com", &ascii));
+    TEST_CHECK(!DomainToAscii("example.com:80", &ascii));
+    TEST_CHECK(!DomainToAscii("example.com/x", &ascii));
+}
+
+// Parsing, resolving and comparing URLs that fit inline doesn't allocate.
+void TestNoAllocations()
+{
+    Url page;
+    Url link;
+    size_t allocations = GetAllocationCount();
+    bool sameOrigin = page.Parse(L"https://www.bing.com/search?q=webview2#results") &&
+                      link.Parse(L"../images/x.png?y", &page) &&
+                      page.GetOrigin().IsSameOrigin(link.GetOrigin());
+    TEST_CHECK(GetAllocationCount() == allocations);
+    TEST_CHECK(sameOrigin && link.GetHref() == "https://www.bing.com/images/x.png?y");
+}
+
+// Random inputs, some relative to a base, don't trip the sanitizers, and the
+// href of each URL they parse to parses to itself.
+void TestRandomInputs()
+{
+    Url base;
+    TEST_CHECK(base.Parse("https://example.com/a/b?x#y"));
+    std::mt19937 random(1);
+    const char alphabet[] = "ab:/\\?#@[]%.12 \t\xc3\xa9\xe2\x80xn-fileshttp|";
+    size_t valid = 0;
+    for (int i = 0; i < 100000; ++i)
+    {
+        std::string input(random() % 40, ' ');
+        for (char& c : input)
+        {
+            c = alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+        Url url;
+        if (!url.Parse(input, i % 2 ? &base : nullptr))
+        {
+            continue;
+        }
+        ++valid;
+        Url reparsed;
+        TEST_CHECK(reparsed.Parse(url.GetHref()) && reparsed.GetHref() == url.GetHref());
+    }
+    std::printf("  %zu of 100000 random inputs are URLs\n", valid);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestWebPlatformTests);
+    RUN_TEST(TestRelativeAndCopies);
+    RUN_TEST(TestSampleUrls);
+    RUN_TEST(TestNoAllocations);
+    RUN_TEST(TestRandomInputs);
+    return ReportTestResults();
+}
@@ -0,0 +1,114 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Throughput of Utf8Decoder on response bodies of different scripts, decoded
+// in 4 KB pieces as they are read from a stream, and the cost of a preview of
+// the start of a large body.
+
+#include "Utf8Decoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+std::string Repeat(const std::string& text, size_t size)
+{
+    std::string body;
+    while (body.size() < size)
+    {
+        body += text;
+    }
+    return body;
+}
+
+void MeasureDecode(const char* name, const std::string& body, size_t passes)
+{
+    constexpr size_t c_pieceSize = 4096;
+    std::vector<wchar_t> output(c_pieceSize);
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                Utf8Decoder decoder;
+                size_t position = 0;
+                while (position < body.size())
+                {
+                    size_t piece = (std::min)(c_pieceSize, body.size() - position);
+                    Utf8Decoder::Result result = decoder.Decode(
+                        std::string_view(body.data() + position, piece), output.data(),
+                        output.size());
+                    position += result.bytesRead;
+                    total += result.charsWritten;
+                }
+                total += decoder.Finish(output.data(), output.size());
+            }
+        });
+    KeepResult(total);
+    std::printf(
+        "%-48s %10.0f MB/s\n", name, double(body.size()) * passes / seconds / 1e6);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    constexpr size_t c_bodySize = 1 << 20;
+    size_t passes = Iterations(quick, 500);
+
+    MeasureDecode(
+        "ASCII (HTML)",
+        Repeat("<div class=\"item\"><a href=\"/products/1234\">Product name</a></div>\n",
+            c_bodySize),
+        passes);
+    MeasureDecode(
+        "Latin with accents",
+        Repeat("Le caf\xc3\xa9 \xc3\xa0 c\xc3\xb4t\xc3\xa9 de l'h\xc3\xb4tel est ferm\xc3\xa9. ",
+            c_bodySize),
+        passes);
+    MeasureDecode(
+        "CJK",
+        Repeat("\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xe3\x81\xae\xe3\x83\x86\xe3\x82\xad"
+               "\xe3\x82\xb9\xe3\x83\x88\xe3\x80\x82",
+            c_bodySize),
+        passes);
+    MeasureDecode(
+        "emoji", Repeat("ok \xf0\x9f\x98\x80\xf0\x9f\x91\x8d\xf0\x9f\x8e\x89 ", c_bodySize),
+        passes);
+    MeasureDecode(
+        "malformed", Repeat("a\xc0\xaf\xed\xa0\x80\xff\xe2\x82", c_bodySize), passes);
+
+    // The preview of a response body reads only its start, whatever its size.
+    std::string body = Repeat("x", 64 << 20);
+    size_t previews = Iterations(quick, 1000000);
+    size_t total = 0;
+    double seconds = MeasureSeconds(
+        [&]()
+        {
+            for (size_t i = 0; i < previews; ++i)
+            {
+                size_t offset = 0;
+                ByteSource source = [&](void* buffer, size_t size)
+                {
+                    size = (std::min)(size, body.size() - offset);
+                    memcpy(buffer, body.data() + offset, size);
+                    offset += size;
+                    return size;
+                };
+                wchar_t preview[50];
+                bool truncated;
+                total += ReadUtf8Preview(source, preview, 50, &truncated);
+            }
+        });
+    KeepResult(total);
+    ReportRate("50-character preview of a 64 MB body", previews, seconds);
+    return 0;
+}
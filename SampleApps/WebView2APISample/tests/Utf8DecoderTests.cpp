@@ -0,0 +1,310 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Utf8Decoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+// The UTF-8 decoder of the WHATWG Encoding Standard, written out one byte at a
+// time as in the specification, with U+FFFD for each error.
+std::vector<uint32_t> ReferenceDecode(const std::string& bytes)
+{
+    std::vector<uint32_t> codePoints;
+    uint32_t codePoint = 0;
+    uint32_t bytesSeen = 0;
+    uint32_t bytesNeeded = 0;
+    uint8_t lower = 0x80;
+    uint8_t upper = 0xBF;
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        uint8_t byte = static_cast<uint8_t>(bytes[i]);
+        if (bytesNeeded == 0)
+        {
+            if (byte <= 0x7F)
+            {
+                codePoints.push_back(byte);
+            }
+            else if (byte >= 0xC2 && byte <= 0xDF)
+            {
+                bytesNeeded = 1;
+                codePoint = byte & 0x1F;
+            }
+            else if (byte >= 0xE0 && byte <= 0xEF)
+            {
+                lower = byte == 0xE0 ? 0xA0 : 0x80;
+                upper = byte == 0xED ? 0x9F : 0xBF;
+                bytesNeeded = 2;
+                codePoint = byte & 0xF;
+            }
+            else if (byte >= 0xF0 && byte <= 0xF4)
+            {
+                lower = byte == 0xF0 ? 0x90 : 0x80;
+                upper = byte == 0xF4 ? 0x8F : 0xBF;
+                bytesNeeded = 3;
+                codePoint = byte & 0x7;
+            }
+            else
+            {
+                codePoints.push_back(0xFFFD);
+            }
+            continue;
+        }
+        if (byte < lower || byte > upper)
+        {
+            codePoint = bytesNeeded = bytesSeen = 0;
+            lower = 0x80;
+            upper = 0xBF;
+            codePoints.push_back(0xFFFD);
+            // The byte is processed again as the start of a new sequence.
+            --i;
+            continue;
+        }
+        lower = 0x80;
+        upper = 0xBF;
+        codePoint = (codePoint << 6) | (byte & 0x3F);
+        if (++bytesSeen == bytesNeeded)
+        {
+            codePoints.push_back(codePoint);
+            codePoint = bytesNeeded = bytesSeen = 0;
+        }
+    }
+    if (bytesNeeded != 0)
+    {
+        codePoints.push_back(0xFFFD);
+    }
+    return codePoints;
+}
+
+std::wstring ToWide(const std::vector<uint32_t>& codePoints)
+{
+    std::wstring wide;
+    for (uint32_t codePoint : codePoints)
+    {
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            wide.push_back(static_cast<wchar_t>(0xD800 + ((codePoint - 0x10000) >> 10)));
+            wide.push_back(static_cast<wchar_t>(0xDC00 + ((codePoint - 0x10000) & 0x3FF)));
+        }
+        else
+        {
+            wide.push_back(static_cast<wchar_t>(codePoint));
+        }
+    }
+    return wide;
+}
+
+// Decode in one go with room for everything.
+std::wstring DecodeAll(const std::string& bytes)
+{
+    std::vector<wchar_t> output(bytes.size() + 1);
+    Utf8Decoder decoder;
+    Utf8Decoder::Result result = decoder.Decode(bytes, output.data(), output.size());
+    size_t written = result.charsWritten;
+    written += decoder.Finish(output.data() + written, output.size() - written);
+    return std::wstring(output.data(), written);
+}
+
+// Decode in random pieces into random small amounts of room, passing again
+// the bytes that weren't read, as a stream reader would.
+std::wstring DecodeInPieces(const std::string& bytes, std::mt19937& random)
+{
+    Utf8Decoder decoder;
+    std::wstring decoded;
+    wchar_t buffer[8];
+    size_t position = 0;
+    while (position < bytes.size())
+    {
+        size_t piece = (std::min)(size_t(1 + random() % 20), bytes.size() - position);
+        size_t capacity = random() % 6;
+        Utf8Decoder::Result result = decoder.Decode(
+            std::string_view(bytes.data() + position, piece), buffer, capacity);
+        decoded.append(buffer, result.charsWritten);
+        position += result.bytesRead;
+    }
+    do
+    {
+        decoded.append(buffer, decoder.Finish(buffer, random() % 3));
+    } while (decoder.HasHeldChar());
+    return decoded;
+}
+
+// Byte strings made of valid sequences, every kind of malformed one, and
+// sequences cut short.
+std::string MakeTestInput(std::mt19937& random)
+{
+    static const char* const c_pieces[] = {
+        "a", "hello world ", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+        // Overlong, surrogate, out of range, lone continuation, invalid bytes.
+        "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\x80", "\xbf",
+        "\xfe", "\xff", "\xc1",
+        // Truncated sequences.
+        "\xc3", "\xe2\x82", "\xf0\x9f", "\xf0\x9f\x98"};
+    std::string bytes;
+    size_t count = random() % 40;
+    for (size_t i = 0; i < count; ++i)
+    {
+        bytes += c_pieces[random() % (sizeof(c_pieces) / sizeof(c_pieces[0]))];
+    }
+    return bytes;
+}
+
+void TestValidText()
+{
+    TEST_CHECK(DecodeAll("plain ASCII text") == L"plain ASCII text");
+    TEST_CHECK(DecodeAll("caf\xc3\xa9 \xe2\x82\xac") == L"café €");
+    TEST_CHECK(DecodeAll("\xf0\x9f\x98\x80") == ToWide({0x1F600}));
+    TEST_CHECK(DecodeAll("") == L"");
+}
+
+// One U+FFFD per maximal subpart, as in the examples of the Unicode Standard
+// (table 3-8) and the Encoding Standard.
+void TestMalformedInput()
+{
+    TEST_CHECK(DecodeAll("\xc0\xaf") == ToWide({0xFFFD, 0xFFFD}));
+    TEST_CHECK(DecodeAll("\xe0\x80\xaf") == ToWide({0xFFFD, 0xFFFD, 0xFFFD}));
+    TEST_CHECK(DecodeAll("\xed\xa0\x80") == ToWide({0xFFFD, 0xFFFD, 0xFFFD}));
+    TEST_CHECK(DecodeAll("\xf4\x90\x80\x80") == ToWide({0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD}));
+    TEST_CHECK(
+        DecodeAll("\x61\xf1\x80\x80\xe1\x80\xc2\x62\x80\x63\x80\xbf\x64") ==
+        ToWide({0x61, 0xFFFD, 0xFFFD, 0xFFFD, 0x62, 0xFFFD, 0x63, 0xFFFD, 0xFFFD, 0x64}));
+}
+
+// A sequence cut off at the end of the input is one U+FFFD.
+void TestTruncatedInput()
+{
+    TEST_CHECK(DecodeAll("ab\xe2\x82") == ToWide({'a', 'b', 0xFFFD}));
+    TEST_CHECK(DecodeAll("\xf0\x9f\x98") == ToWide({0xFFFD}));
+    TEST_CHECK(DecodeAll("\xc3") == ToWide({0xFFFD}));
+}
+
+// A sequence split between two calls decodes as if it came in one.
+void TestSplitSequence()
+{
+    Utf8Decoder decoder;
+    wchar_t output[4];
+    Utf8Decoder::Result result = decoder.Decode("x\xf0\x9f", output, 4);
+    TEST_CHECK(result.bytesRead == 3 && result.charsWritten == 1);
+    result = decoder.Decode("\x98\x80y", output + 1, 3);
+    TEST_CHECK(result.bytesRead == 3);
+    std::wstring decoded(output, 1 + result.charsWritten);
+    TEST_CHECK(decoded == L"x" + ToWide({0x1F600}) + L"y");
+    TEST_CHECK(decoder.Finish(output, 4) == 0);
+}
+
+// Output stops on a code point boundary, and a code point that didn't fit is
+// written first the next time.
+void TestFullOutput()
+{
+    const std::string bytes = "ab\xf0\x9f\x98\x80" "c";
+    Utf8Decoder decoder;
+    wchar_t output[2];
+    Utf8Decoder::Result result = decoder.Decode(bytes, output, 2);
+    TEST_CHECK(result.charsWritten == 2 && output[0] == L'a' && output[1] == L'b');
+
+    std::wstring decoded(output, result.charsWritten);
+    size_t position = result.bytesRead;
+    for (int call = 0; call < 10 && (position < bytes.size() || decoder.HasHeldChar()); ++call)
+    {
+        result = decoder.Decode(std::string_view(bytes).substr(position), output, 2);
+        decoded.append(output, result.charsWritten);
+        position += result.bytesRead;
+    }
+    TEST_CHECK(decoded == L"ab" + ToWide({0x1F600}) + L"c");
+}
+
+void TestRandomInputAgainstReference()
+{
+    std::mt19937 random(6);
+    for (int iteration = 0; iteration < 20000; ++iteration)
+    {
+        std::string bytes = MakeTestInput(random);
+        std::wstring expected = ToWide(ReferenceDecode(bytes));
+        TEST_CHECK(DecodeAll(bytes) == expected);
+        TEST_CHECK(DecodeInPieces(bytes, random) == expected);
+        if (g_testFailures)
+        {
+            return;
+        }
+    }
+}
+
+// The preview is a prefix of the whole text that doesn't end inside a
+// surrogate pair, and is marked truncated exactly when text was left out.
+void TestPreview()
+{
+    std::mt19937 random(7);
+    for (int iteration = 0; iteration < 20000; ++iteration)
+    {
+        std::string bytes = MakeTestInput(random);
+        std::wstring expected = ToWide(ReferenceDecode(bytes));
+        size_t offset = 0;
+        size_t reads = 0;
+        ByteSource source = [&](void* buffer, size_t size)
+        {
+            size = (std::min)({size, size_t(1 + random() % 7), bytes.size() - offset});
+            memcpy(buffer, bytes.data() + offset, size);
+            offset += size;
+            ++reads;
+            return size;
+        };
+        wchar_t preview[16];
+        size_t capacity = random() % 16;
+        bool truncated = false;
+        size_t written = ReadUtf8Preview(source, preview, capacity, &truncated);
+
+        TEST_CHECK(written <= capacity);
+        TEST_CHECK(expected.compare(0, written, preview, written) == 0);
+        TEST_CHECK(truncated == (written < expected.size()));
+        if (sizeof(wchar_t) == 2 && written > 0)
+        {
+            TEST_CHECK(preview[written - 1] < 0xD800 || preview[written - 1] > 0xDBFF);
+        }
+        if (g_testFailures)
+        {
+            return;
+        }
+    }
+}
+
+// Only the start of a large body is read.
+void TestPreviewReadsLittle()
+{
+    std::string body(1 << 20, 'x');
+    size_t read = 0;
+    ByteSource source = [&](void* buffer, size_t size)
+    {
+        size = (std::min)(size, body.size() - read);
+        memcpy(buffer, body.data() + read, size);
+        read += size;
+        return size;
+    };
+    wchar_t preview[50];
+    bool truncated = false;
+    TEST_CHECK(ReadUtf8Preview(source, preview, 50, &truncated) == 50);
+    TEST_CHECK(truncated);
+    TEST_CHECK(read <= 256);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestValidText);
+    RUN_TEST(TestMalformedInput);
+    RUN_TEST(TestTruncatedInput);
+    RUN_TEST(TestSplitSequence);
+    RUN_TEST(TestFullOutput);
+    RUN_TEST(TestRandomInputAgainstReference);
+    RUN_TEST(TestPreview);
+    RUN_TEST(TestPreviewReadsLittle);
+    return ReportTestResults();
+}
@@ -0,0 +1,177 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compiles 5000 random URI filters for 64 handlers, of the shapes the
+// scenarios add (a site, a site's subdomains, a path, a file type, a query),
+// and answers 20000 requests, most of which no filter names. Compares Match()
+// with checking every filter in turn, as the handlers did each for their own,
+// both without and with a "*" filter such as the event monitor adds.
+
+#include "WebResourceFilterMatcher.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+using Filter = WebResourceFilterMatcher::Filter;
+
+constexpr uint32_t c_allContexts = 0xFFFFFFFF;
+
+// Every filter checked in turn, skipping those of handlers already found.
+uint64_t MatchEachFilter(
+    const std::vector<Filter>& filters, std::wstring_view uri, uint32_t context)
+{
+    uint64_t handlers = 0;
+    for (const Filter& filter : filters)
+    {
+        uint64_t bit = uint64_t(1) << filter.handler;
+        if (!(handlers & bit) && (filter.contexts & context) &&
+            WebResourceFilterMatcher::MatchWildcard(filter.uri, uri))
+        {
+            handlers |= bit;
+        }
+    }
+    return handlers;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = IsQuickRun(argc, argv);
+    size_t filterCount = quick ? 50 : 5000;
+    size_t requestCount = quick ? 200 : 20000;
+    size_t rounds = quick ? 1 : 20;
+    std::mt19937 random(7);
+    auto word = [&](uint32_t spread)
+    {
+        std::wstring text(3 + random() % spread, L' ');
+        for (wchar_t& c : text)
+        {
+            c = L"abcdefghijklmnopqrstuvwxyz0123456789"[random() % 36];
+        }
+        return text;
+    };
+    std::vector<std::wstring> hosts;
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < 2000; ++i)
+    {
+        hosts.push_back(word(8) + L"." + word(6) + (i % 3 ? L".com" : L".net"));
+    }
+    for (int i = 0; i < 500; ++i)
+    {
+        paths.push_back(word(8));
+    }
+    const wchar_t* extensions[] = {L".js",    L".png",  L".css", L".html",
+                                   L".jpg",   L".woff2", L".json", L""};
+
+    std::vector<Filter> filters;
+    for (size_t i = 0; i < filterCount; ++i)
+    {
+        Filter filter;
+        filter.handler = random() % (c_maxWebResourceFilterHandlers - 1);
+        filter.contexts = random() % 3 ? c_allContexts : 1u << (1 + random() % 16);
+        const std::wstring& host = hosts[random() % hosts.size()];
+        const std::wstring& path = paths[random() % paths.size()];
+        switch (random() % 6)
+        {
+        case 0:
+            filter.uri = L"https://" + host + L"/*";
+            break;
+        case 1:
+            filter.uri = L"*://*." + host + L"/*";
+            break;
+        case 2:
+            filter.uri = L"*/" + path + L"/*";
+            break;
+        case 3:
+            filter.uri = L"https://" + host + L"/" + path + L"/*" + extensions[random() % 7];
+            break;
+        case 4:
+            filter.uri = L"*" + path + extensions[random() % 7];
+            break;
+        default:
+            filter.uri = L"http?://" + host + L"/*?" + path + L"=*";
+            break;
+        }
+        filters.push_back(filter);
+    }
+    std::vector<Filter> withCatchAll = filters;
+    withCatchAll.push_back({L"*", c_allContexts, c_maxWebResourceFilterHandlers - 1});
+
+    // A tenth of the requests are to a filtered host, and a tenth of their
+    // path segments are filtered paths.
+    std::vector<std::wstring> uris;
+    std::vector<uint32_t> contexts;
+    for (size_t i = 0; i < requestCount; ++i)
+    {
+        std::wstring uri = L"https://" + (random() % 10 == 0 ? hosts[random() % hosts.size()]
+                                                             : word(8) + L"." + word(6) + L".org");
+        for (uint32_t j = 0, count = 1 + random() % 4; j < count; ++j)
+        {
+            uri += L"/" + (random() % 10 == 0 ? paths[random() % paths.size()] : word(10));
+        }
+        uri += extensions[random() % 8];
+        if (random() % 3 == 0)
+        {
+            uri += L"?" + word(6) + L"=" + word(12);
+        }
+        uris.push_back(uri);
+        contexts.push_back(1u << (1 + random() % 16));
+    }
+
+    for (const std::vector<Filter>* list : {&filters, &withCatchAll})
+    {
+        WebResourceFilterMatcher matcher;
+        double seconds = MeasureSeconds([&]() { matcher = WebResourceFilterMatcher(*list); });
+        std::printf(
+            "%zu filters%s: compiled in %.1f ms, %zu states, %zu KB\n", list->size(),
+            list == &filters ? "" : " with a \"*\" filter", seconds * 1e3,
+            matcher.GetStateCount(), matcher.GetMemoryUsage() / 1024);
+
+        size_t matched = 0;
+        size_t mismatches = 0;
+        for (size_t i = 0; i < uris.size(); ++i)
+        {
+            uint64_t handlers = matcher.Match(uris[i], contexts[i]);
+            matched += (handlers & ~(uint64_t(1) << (c_maxWebResourceFilterHandlers - 1))) != 0;
+            mismatches += handlers != MatchEachFilter(*list, uris[i], contexts[i]);
+        }
+        std::printf("  %zu of %zu requests matched a filter\n", matched, uris.size());
+        if (mismatches != 0)
+        {
+            std::fprintf(stderr, "%zu requests disagree with checking each filter\n", mismatches);
+            return 1;
+        }
+
+        uint64_t result = 0;
+        seconds = MeasureSeconds(
+            [&]()
+            {
+                for (size_t round = 0; round < rounds; ++round)
+                {
+                    for (size_t i = 0; i < uris.size(); ++i)
+                    {
+                        result += matcher.Match(uris[i], contexts[i]);
+                    }
+                }
+            });
+        ReportRate("  Match, one pass", rounds * uris.size(), seconds);
+        seconds = MeasureSeconds(
+            [&]()
+            {
+                for (size_t i = 0; i < uris.size(); ++i)
+                {
+                    result += MatchEachFilter(*list, uris[i], contexts[i]);
+                }
+            });
+        ReportRate("  each filter in turn", uris.size(), seconds);
+        KeepResult(size_t(result));
+    }
+    return 0;
+}
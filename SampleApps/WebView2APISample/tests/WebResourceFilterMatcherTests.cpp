@@ -0,0 +1,159 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "WebResourceFilterMatcher.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestHarness.h"
+
+namespace
+{
+using Filter = WebResourceFilterMatcher::Filter;
+
+constexpr uint32_t c_allContexts = 0xFFFFFFFF;
+constexpr uint32_t c_image = 1 << 3;
+constexpr uint32_t c_script = 1 << 6;
+
+// The obvious recursive wildcard match, to check the matcher by.
+bool NaiveWildcard(const wchar_t* pattern, const wchar_t* uri)
+{
+    if (*pattern == L'\0')
+    {
+        return *uri == L'\0';
+    }
+    if (*pattern == L'*')
+    {
+        return NaiveWildcard(pattern + 1, uri) ||
+               (*uri != L'\0' && NaiveWildcard(pattern, uri + 1));
+    }
+    return *uri != L'\0' && (*pattern == L'?' || *pattern == *uri) &&
+           NaiveWildcard(pattern + 1, uri + 1);
+}
+
+// Every filter checked in turn, as each handler would without the matcher.
+uint64_t NaiveMatch(const std::vector<Filter>& filters, const std::wstring& uri, uint32_t context)
+{
+    uint64_t handlers = 0;
+    for (const Filter& filter : filters)
+    {
+        if (filter.handler < c_maxWebResourceFilterHandlers && (filter.contexts & context) &&
+            NaiveWildcard(filter.uri.c_str(), uri.c_str()))
+        {
+            handlers |= uint64_t(1) << filter.handler;
+        }
+    }
+    return handlers;
+}
+
+void TestMatchWildcard()
+{
+    TEST_CHECK(WebResourceFilterMatcher::MatchWildcard(L"a*b*c", L"aXbYbc"));
+    TEST_CHECK(!WebResourceFilterMatcher::MatchWildcard(L"a*b?c", L"abc"));
+    TEST_CHECK(WebResourceFilterMatcher::MatchWildcard(L"**", L""));
+    TEST_CHECK(WebResourceFilterMatcher::MatchWildcard(L"?", L"é"));
+    TEST_CHECK(!WebResourceFilterMatcher::MatchWildcard(L"", L"a"));
+    TEST_CHECK(!WebResourceFilterMatcher::MatchWildcard(L"a*", L"ba"));
+}
+
+// Each kind of filter the scenarios add, and the handlers it reports.
+void TestFilters()
+{
+    std::vector<Filter> filters = {
+        {L"https://appassets.example/*", c_allContexts, 0},
+        {L"*", c_image, 1},
+        {L"custom-scheme*", c_allContexts, 2},
+        {L"*worker.js", c_allContexts, 3},
+        {L"*://*.example.com/*.png", c_allContexts, 4},
+        {L"https://a?c.test/", c_allContexts, 5},
+        {L"*ad*ad*", c_script, 6},
+        {L"exact", c_allContexts, 7},
+        {L"*été*", c_allContexts, 8},
+        {L"skipped", c_allContexts, c_maxWebResourceFilterHandlers},
+    };
+    WebResourceFilterMatcher matcher(filters);
+    TEST_CHECK(matcher.GetFilterCount() == 9);
+    TEST_CHECK(matcher.Match(L"https://appassets.example/x.html", c_script) == 1);
+    TEST_CHECK(matcher.Match(L"https://appassets.example/x.png", c_image) == 3);
+    TEST_CHECK(matcher.Match(L"xhttps://appassets.example/", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"custom-scheme:a", c_script) == 4);
+    TEST_CHECK(matcher.Match(L"https://x/worker.js", c_script) == 8);
+    TEST_CHECK(matcher.Match(L"https://x/worker.jsx", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"https://cdn.example.com/a/b.png", c_script) == 16);
+    TEST_CHECK(matcher.Match(L"https://example.com/a/b.png", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"https://abc.test/", c_script) == 32);
+    TEST_CHECK(matcher.Match(L"https://ac.test/", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"https://x/ad/ad", c_script) == 64);
+    TEST_CHECK(matcher.Match(L"https://x/ad/ad", c_image) == 2);
+    TEST_CHECK(matcher.Match(L"https://x/ad", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"exact", c_script) == 128);
+    TEST_CHECK(matcher.Match(L"exactly", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"https://x/été", c_script) == 256);
+    TEST_CHECK(matcher.Match(L"", c_script) == 0);
+    TEST_CHECK(matcher.Match(L"", c_image) == 2);
+    TEST_CHECK(matcher.GetMemoryUsage() > 0);
+
+    WebResourceFilterMatcher empty;
+    TEST_CHECK(empty.GetFilterCount() == 0);
+    TEST_CHECK(empty.Match(L"https://x/", c_allContexts) == 0);
+}
+
+// Random filters and URIs over a small alphabet, so that literal runs overlap
+// and repeat, agree with matching every filter in turn. Some rounds put many
+// filters on a few handlers and some have handlers out of range.
+void TestAgainstNaive()
+{
+    std::mt19937 random(1);
+    const wchar_t uriAlphabet[] = L"ab/.:c";
+    const wchar_t patternAlphabet[] = L"ab/.:c**?";
+    size_t checked = 0;
+    size_t matched = 0;
+    for (int round = 0; round < 2000; ++round)
+    {
+        std::vector<Filter> filters;
+        for (uint32_t i = 0, count = 1 + random() % (round < 1000 ? 10 : 300); i < count; ++i)
+        {
+            Filter filter;
+            for (uint32_t j = 0, size = random() % 9; j < size; ++j)
+            {
+                filter.uri += patternAlphabet[random() % 9];
+            }
+            filter.contexts = random() % 4 == 0 ? 1u << (random() % 4) : c_allContexts;
+            filter.handler = random() % (round % 3 == 0 ? 4 : c_maxWebResourceFilterHandlers + 2);
+            filters.push_back(filter);
+        }
+        WebResourceFilterMatcher matcher(filters);
+        for (int i = 0; i < 100; ++i)
+        {
+            std::wstring uri;
+            for (uint32_t j = 0, size = random() % 20; j < size; ++j)
+            {
+                uri += uriAlphabet[random() % 6];
+            }
+            uint32_t context = 1u << (random() % 5);
+            uint64_t expected = NaiveMatch(filters, uri, context);
+            uint64_t handlers = matcher.Match(uri, context);
+            TEST_CHECK(handlers == expected);
+            if (handlers != expected)
+            {
+                std::fprintf(stderr, "  round %d, URI %ls\n", round, uri.c_str());
+            }
+            ++checked;
+            matched += expected != 0;
+        }
+    }
+    std::printf("  %zu checks against the naive match, %zu matched\n", checked, matched);
+}
+} // namespace
+
+int main()
+{
+    RUN_TEST(TestMatchWildcard);
+    RUN_TEST(TestFilters);
+    RUN_TEST(TestAgainstNaive);
+    return ReportTestResults();
+}